@@ -15,18 +15,18 @@
 // ******************************************************************
 // * 0x005C - KeAlertResumeThread()
 // ******************************************************************
-XBSYSAPI EXPORTNUM(92) NTSTATUS NTAPI KeAlertResumeThread
+XBSYSAPI EXPORTNUM(92) ULONG NTAPI KeAlertResumeThread
 (
-	IN HANDLE ThreadHandle,
-	IN OUT PULONG PreviousSuspendCount
+	IN PKTHREAD Thread
 );
 
 // ******************************************************************
 // * 0x005D - KeAlertThread()
 // ******************************************************************
-XBSYSAPI EXPORTNUM(93) NTSTATUS NTAPI KeAlertThread
+XBSYSAPI EXPORTNUM(93) BOOLEAN NTAPI KeAlertThread
 (
-	IN HANDLE ThreadHandle
+	IN PKTHREAD Thread,
+	IN KPROCESSOR_MODE AlertMode
 );
 
 // ******************************************************************
@@ -88,6 +88,10 @@ BOOLEAN ObpLookupElementNameInDirectory(
 	OUT PVOID *ReturnedObject
 );
 
+POBJECT_DIRECTORY ObpDetachNamedObject(
+	IN PVOID Object
+);
+
 // ******************************************************************
 // * 0x00EF - ObCreateObject()
 // ******************************************************************
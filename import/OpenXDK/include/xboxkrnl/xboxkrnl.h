@@ -1580,7 +1580,7 @@ KOBJECTS, *PKOBJECTS;
 // ******************************************************************
 // * PKNORMAL_ROUTINE
 // ******************************************************************
-typedef VOID (*PKNORMAL_ROUTINE)
+typedef VOID (NTAPI *PKNORMAL_ROUTINE)
 (
 	IN PVOID NormalContext,
 	IN PVOID SystemArgument1,
@@ -1590,7 +1590,7 @@ typedef VOID (*PKNORMAL_ROUTINE)
 // ******************************************************************
 // * PKKERNEL_ROUTINE
 // ******************************************************************
-typedef VOID (*PKKERNEL_ROUTINE)
+typedef VOID (NTAPI *PKKERNEL_ROUTINE)
 (
 	IN struct _KAPC *Apc,
 	IN OUT PKNORMAL_ROUTINE *NormalRoutine,
@@ -1602,7 +1602,7 @@ typedef VOID (*PKKERNEL_ROUTINE)
 // ******************************************************************
 // * PKRUNDOWN_ROUTINE
 // ******************************************************************
-typedef VOID (*PKRUNDOWN_ROUTINE)
+typedef VOID (NTAPI *PKRUNDOWN_ROUTINE)
 (
 	IN struct _KAPC *Apc
 );
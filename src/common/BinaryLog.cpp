@@ -0,0 +1,1224 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "BinaryLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+std::atomic_bool g_BinaryLogEnabled = false;
+
+#define BINARY_LOG_ARG_LDOUBLE 'D' // long double, stored as a double (8 bytes)
+
+typedef struct _BinaryLogFormat {
+	uint32_t Id;
+	std::string Format;
+	std::string Kinds;
+	bool Supported; // false if a conversion of the format is unknown, then it's formatted by the caller
+} BinaryLogFormat;
+
+typedef struct _BinaryLogRing {
+	std::unique_ptr<uint8_t[]> Data;
+	alignas(64) std::atomic<uint64_t> Head; // only written by the owning thread
+	alignas(64) std::atomic<uint64_t> Tail; // only written by the drain thread
+	std::atomic<uint64_t> Dropped;
+	std::atomic_bool Retired;               // set when the owning thread exits
+} BinaryLogRing;
+
+// Per-thread state : the ring plus a small direct mapped cache of format lookups
+typedef struct _BinaryLogLocal {
+	std::shared_ptr<BinaryLogRing> Ring;
+	std::unique_ptr<uint8_t[]> Scratch;
+	// The Call record being built, apart from Scratch since rendering an argument may log a message
+	std::unique_ptr<uint8_t[]> Call;
+	size_t CallPos = 0;
+	struct {
+		const char* Format = nullptr;
+		const BinaryLogFormat* Entry = nullptr;
+	} Cache[256];
+
+	~_BinaryLogLocal()
+	{
+		if (Ring) {
+			Ring->Retired = true;
+		}
+	}
+} BinaryLogLocal;
+
+static thread_local BinaryLogLocal BinaryLogThreadState;
+
+// Guards the ring list and the format table
+static std::mutex BinaryLogMtx;
+static std::vector<std::shared_ptr<BinaryLogRing>> BinaryLogRings;
+static std::deque<BinaryLogFormat> BinaryLogFormats;
+static std::unordered_map<const char*, const BinaryLogFormat*> BinaryLogFormatIndex;
+
+// Guards opening and closing, the members below are only used by the drain thread while it runs
+static std::mutex BinaryLogStateMtx;
+static std::atomic_bool BinaryLogRunning = false;
+static std::thread BinaryLogDrainThread;
+static FILE* BinaryLogFile = nullptr;
+static size_t BinaryLogFormatsWritten = 0;
+// Number of entries in the format table, read by the drain thread without taking the lock
+static std::atomic<size_t> BinaryLogFormatCount = 0;
+
+static std::atomic<uint64_t> BinaryLogRecords = 0;
+static std::atomic<uint64_t> BinaryLogBytes = 0;
+static std::atomic<uint64_t> BinaryLogDropped = 0;
+
+// Drains and closes the log if the process exits normally while it's still open
+static struct BinaryLogCloser {
+	~BinaryLogCloser() { BinaryLog_Close(); }
+} BinaryLogAtExit;
+
+static inline uint64_t BinaryLog_Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t BinaryLog_Align(size_t Size)
+{
+	return (uint32_t)((Size + 7) & ~(size_t)7);
+}
+
+// Lists the arguments a printf format consumes, as BINARY_LOG_ARG_* kinds
+static bool BinaryLog_ParseKinds(const char* Format, std::string& Kinds)
+{
+	for (const char* p = Format; *p != '\0'; p++) {
+		if (*p != '%') {
+			continue;
+		}
+		p++;
+		if (*p == '%') {
+			continue;
+		}
+
+		while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) {
+			p++;
+		}
+		if (*p == '*') {
+			Kinds += BINARY_LOG_ARG_INT32;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9') {
+			p++;
+		}
+		if (*p == '.') {
+			p++;
+			if (*p == '*') {
+				Kinds += BINARY_LOG_ARG_INT32;
+				p++;
+			}
+			while (*p >= '0' && *p <= '9') {
+				p++;
+			}
+		}
+
+		bool Is64 = false;
+		bool IsWide = false;
+		bool IsLongDouble = false;
+		if (p[0] == 'h') {
+			p += (p[1] == 'h') ? 2 : 1;
+		}
+		else if (p[0] == 'l' && p[1] == 'l') {
+			Is64 = true;
+			p += 2;
+		}
+		else if (p[0] == 'l') {
+			Is64 = sizeof(long) == 8;
+			IsWide = true;
+			p++;
+		}
+		else if (p[0] == 'q' || p[0] == 'j') {
+			Is64 = true;
+			p++;
+		}
+		else if (p[0] == 'z' || p[0] == 't') {
+			Is64 = sizeof(size_t) == 8;
+			p++;
+		}
+		else if (p[0] == 'L') {
+			IsLongDouble = true;
+			p++;
+		}
+		else if (p[0] == 'w') {
+			IsWide = true;
+			p++;
+		}
+		else if (p[0] == 'I') {
+			if (p[1] == '6' && p[2] == '4') {
+				Is64 = true;
+				p += 3;
+			}
+			else if (p[1] == '3' && p[2] == '2') {
+				p += 3;
+			}
+			else {
+				Is64 = sizeof(size_t) == 8;
+				p++;
+			}
+		}
+
+		switch (*p) {
+			case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+				Kinds += Is64 ? BINARY_LOG_ARG_INT64 : BINARY_LOG_ARG_INT32;
+				break;
+			case 'c': case 'C':
+				Kinds += BINARY_LOG_ARG_INT32;
+				break;
+			case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+				Kinds += IsLongDouble ? BINARY_LOG_ARG_LDOUBLE : BINARY_LOG_ARG_DOUBLE;
+				break;
+			case 'p':
+				Kinds += BINARY_LOG_ARG_POINTER;
+				break;
+			case 's':
+				Kinds += IsWide ? BINARY_LOG_ARG_WSTRING : BINARY_LOG_ARG_STRING;
+				break;
+			case 'S':
+				Kinds += BINARY_LOG_ARG_WSTRING;
+				break;
+			case 'n':
+				Kinds += BINARY_LOG_ARG_IGNORED;
+				break;
+			default:
+				return false;
+		}
+	}
+
+	// Every argument takes at most 10 bytes, leave the rest for strings
+	return sizeof(BinaryLogRecord) + Kinds.size() * 10 <= BINARY_LOG_MAX_RECORD;
+}
+
+static const BinaryLogFormat* BinaryLog_LookupFormat(BinaryLogLocal& Local, const char* Format)
+{
+	// Argument names are short literals packed next to each other, so all address bits take part
+	auto& Cached = Local.Cache[(uint8_t)(((uint64_t)(uintptr_t)Format * 0x9E3779B97F4A7C15ull) >> 56)];
+	if (Cached.Format == Format) {
+		return Cached.Entry;
+	}
+
+	std::lock_guard<std::mutex> lock(BinaryLogMtx);
+
+	const BinaryLogFormat* Entry;
+	auto it = BinaryLogFormatIndex.find(Format);
+	if (it != BinaryLogFormatIndex.end()) {
+		Entry = it->second;
+	}
+	else {
+		BinaryLogFormat NewEntry;
+		NewEntry.Id = (uint32_t)BinaryLogFormats.size();
+		NewEntry.Format = Format;
+		NewEntry.Supported = BinaryLog_ParseKinds(Format, NewEntry.Kinds);
+		BinaryLogFormats.push_back(std::move(NewEntry));
+		Entry = &BinaryLogFormats.back();
+		BinaryLogFormatIndex.emplace(Format, Entry);
+		BinaryLogFormatCount.store(BinaryLogFormats.size(), std::memory_order_release);
+	}
+
+	Cached.Format = Format;
+	Cached.Entry = Entry;
+	return Entry;
+}
+
+static BinaryLogRing& BinaryLog_GetRing(BinaryLogLocal& Local)
+{
+	if (!Local.Ring) {
+		Local.Ring = std::make_shared<BinaryLogRing>();
+		Local.Ring->Data.reset(new uint8_t[BINARY_LOG_RING_SIZE]);
+		Local.Scratch.reset(new uint8_t[BINARY_LOG_MAX_RECORD]);
+		Local.Call.reset(new uint8_t[BINARY_LOG_MAX_RECORD]);
+
+		std::lock_guard<std::mutex> lock(BinaryLogMtx);
+		BinaryLogRings.push_back(Local.Ring);
+	}
+
+	return *Local.Ring;
+}
+
+void BinaryLog_InitThread()
+{
+	// Thread locals are destroyed in the reverse order of their construction
+	(void)&BinaryLogThreadState;
+}
+
+// Copies a record into the ring of this thread. When the ring is full, this waits for the
+// drain thread, so no record is lost unless the log is being closed
+static void BinaryLog_Push(BinaryLogRing& Ring, const uint8_t* Record, uint32_t Size)
+{
+	uint64_t Head = Ring.Head.load(std::memory_order_relaxed);
+	size_t Offset = Head & (BINARY_LOG_RING_SIZE - 1);
+	size_t Contiguous = BINARY_LOG_RING_SIZE - Offset;
+	size_t Needed = Size + ((Contiguous < Size) ? Contiguous : 0);
+
+	while (BINARY_LOG_RING_SIZE - (Head - Ring.Tail.load(std::memory_order_acquire)) < Needed) {
+		if (!BinaryLogRunning.load(std::memory_order_relaxed)) {
+			Ring.Dropped++;
+			return;
+		}
+		std::this_thread::yield();
+	}
+
+	if (Contiguous < Size) {
+		// Positions and sizes are multiples of 8, so there is room for the size and type
+		uint32_t Pad[2] = { (uint32_t)Contiguous, (uint32_t)BinaryLogType::Pad };
+		memcpy(&Ring.Data[Offset], Pad, sizeof(Pad));
+		Head += Contiguous;
+		Offset = 0;
+	}
+
+	memcpy(&Ring.Data[Offset], Record, Size);
+	Ring.Head.store(Head + Size, std::memory_order_release);
+}
+
+static inline void BinaryLog_SetHeader(uint8_t* Record, uint32_t Size, BinaryLogType Type, uint8_t Module, uint8_t Level, uint32_t FormatId, uint32_t ThreadId)
+{
+	BinaryLogRecord Header;
+	Header.Size = Size;
+	Header.Type = Type;
+	Header.Module = Module;
+	Header.Level = Level;
+	Header.Flags = 0;
+	Header.FormatId = FormatId;
+	Header.ThreadId = ThreadId;
+	Header.Timestamp = BinaryLog_Now();
+	memcpy(Record, &Header, sizeof(Header));
+}
+
+void BinaryLog_WriteArgs(uint32_t ThreadId, uint8_t Module, uint8_t Level, const char* Format, va_list Args)
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	BinaryLogRing& Ring = BinaryLog_GetRing(Local);
+	const BinaryLogFormat* Entry = BinaryLog_LookupFormat(Local, Format);
+
+	va_list ArgsCopy;
+	va_copy(ArgsCopy, Args);
+
+	if (!Entry->Supported) {
+		char* Text = (char*)&Local.Scratch[sizeof(BinaryLogRecord)];
+		int Length = vsnprintf(Text, BINARY_LOG_MAX_RECORD - sizeof(BinaryLogRecord), Format, ArgsCopy);
+		va_end(ArgsCopy);
+		if (Length >= 0) {
+			BinaryLog_WriteText(ThreadId, Module, Level, BinaryLogType::Line, Text, (size_t)Length);
+		}
+		return;
+	}
+
+	uint8_t* Record = Local.Scratch.get();
+	size_t Pos = sizeof(BinaryLogRecord);
+	const size_t KindCount = Entry->Kinds.size();
+	for (size_t k = 0; k < KindCount; k++) {
+		switch (Entry->Kinds[k]) {
+			case BINARY_LOG_ARG_INT32: {
+				int32_t Value = va_arg(ArgsCopy, int32_t);
+				memcpy(&Record[Pos], &Value, sizeof(Value));
+				Pos += sizeof(Value);
+				break;
+			}
+			case BINARY_LOG_ARG_INT64: {
+				int64_t Value = va_arg(ArgsCopy, int64_t);
+				memcpy(&Record[Pos], &Value, sizeof(Value));
+				Pos += sizeof(Value);
+				break;
+			}
+			case BINARY_LOG_ARG_DOUBLE: {
+				double Value = va_arg(ArgsCopy, double);
+				memcpy(&Record[Pos], &Value, sizeof(Value));
+				Pos += sizeof(Value);
+				break;
+			}
+			case BINARY_LOG_ARG_LDOUBLE: {
+				double Value = (double)va_arg(ArgsCopy, long double);
+				memcpy(&Record[Pos], &Value, sizeof(Value));
+				Pos += sizeof(Value);
+				break;
+			}
+			case BINARY_LOG_ARG_POINTER: {
+				uint64_t Value = (uintptr_t)va_arg(ArgsCopy, void*);
+				memcpy(&Record[Pos], &Value, sizeof(Value));
+				Pos += sizeof(Value);
+				break;
+			}
+			case BINARY_LOG_ARG_STRING:
+			case BINARY_LOG_ARG_WSTRING: {
+				// Leave room for the arguments after this one
+				size_t Room = BINARY_LOG_MAX_RECORD - Pos - sizeof(uint16_t) - (KindCount - k - 1) * 10;
+				uint16_t Length = 0;
+				if (Entry->Kinds[k] == BINARY_LOG_ARG_STRING) {
+					const char* Str = va_arg(ArgsCopy, const char*);
+					if (Str == nullptr) {
+						Length = 0xFFFF;
+					}
+					else {
+						while (Length < Room && Str[Length] != '\0') {
+							Record[Pos + sizeof(uint16_t) + Length] = Str[Length];
+							Length++;
+						}
+					}
+				}
+				else {
+					const wchar_t* Str = va_arg(ArgsCopy, const wchar_t*);
+					if (Str == nullptr) {
+						Length = 0xFFFF;
+					}
+					else {
+						// Render unicode as ANSI, like the console log does
+						while (Length < Room && Str[Length] != L'\0') {
+							Record[Pos + sizeof(uint16_t) + Length] = (Str[Length] <= 0xFF) ? (uint8_t)Str[Length] : '?';
+							Length++;
+						}
+					}
+				}
+				memcpy(&Record[Pos], &Length, sizeof(Length));
+				Pos += sizeof(uint16_t) + ((Length == 0xFFFF) ? 0 : Length);
+				break;
+			}
+			case BINARY_LOG_ARG_IGNORED:
+				(void)va_arg(ArgsCopy, void*);
+				break;
+		}
+	}
+	va_end(ArgsCopy);
+
+	uint32_t Size = BinaryLog_Align(Pos);
+	memset(&Record[Pos], 0, Size - Pos);
+	BinaryLog_SetHeader(Record, Size, BinaryLogType::Args, Module, Level, Entry->Id, ThreadId);
+	BinaryLog_Push(Ring, Record, Size);
+}
+
+void BinaryLog_WriteText(uint32_t ThreadId, uint8_t Module, uint8_t Level, BinaryLogType Type, const char* Text, size_t Length)
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	BinaryLogRing& Ring = BinaryLog_GetRing(Local);
+
+	Length = std::min(Length, BINARY_LOG_MAX_RECORD - sizeof(BinaryLogRecord));
+	uint8_t* Record = Local.Scratch.get();
+	// Text may already be in the scratch buffer (see BinaryLog_WriteArgs)
+	memmove(&Record[sizeof(BinaryLogRecord)], Text, Length);
+
+	size_t Pos = sizeof(BinaryLogRecord) + Length;
+	uint32_t Size = BinaryLog_Align(Pos);
+	memset(&Record[Pos], 0, Size - Pos);
+	BinaryLog_SetHeader(Record, Size, Type, Module, Level, (uint32_t)Length, ThreadId);
+	BinaryLog_Push(Ring, Record, Size);
+}
+
+void BinaryLog_BeginCall(uint32_t ThreadId, uint8_t Module, uint8_t Level, const char* Func, bool Result)
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	BinaryLog_GetRing(Local);
+	const BinaryLogFormat* Entry = BinaryLog_LookupFormat(Local, Func);
+
+	// The size is filled in by BinaryLog_EndCall
+	BinaryLog_SetHeader(Local.Call.get(), 0, BinaryLogType::Call, Module, Level, Entry->Id, ThreadId);
+	Local.Call[offsetof(BinaryLogRecord, Flags)] = Result ? BINARY_LOG_CALL_RESULT : 0;
+	Local.CallPos = sizeof(BinaryLogRecord);
+}
+
+// Reserves an argument of ValueSize bytes in the Call record, returns where its value goes
+static uint8_t* BinaryLog_CallArgStart(BinaryLogLocal& Local, const char* Name, bool Out, char Kind, size_t ValueSize)
+{
+	if (Local.CallPos + sizeof(uint32_t) + 2 + ValueSize > BINARY_LOG_MAX_RECORD) {
+		return nullptr;
+	}
+
+	uint32_t NameId = (Name != nullptr) ? BinaryLog_LookupFormat(Local, Name)->Id : UINT32_MAX;
+	uint8_t* Arg = &Local.Call[Local.CallPos];
+	memcpy(Arg, &NameId, sizeof(NameId));
+	Arg[sizeof(uint32_t)] = (uint8_t)Kind;
+	Arg[sizeof(uint32_t) + 1] = Out ? BINARY_LOG_CALL_OUT : 0;
+	Local.CallPos += sizeof(uint32_t) + 2 + ValueSize;
+	return Arg + sizeof(uint32_t) + 2;
+}
+
+void BinaryLog_CallArg(const char* Name, bool Out, char Kind, uint64_t Value)
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	const bool Is64 = (Kind == BINARY_LOG_ARG_INT64) || (Kind == BINARY_LOG_ARG_UINT64) || (Kind == BINARY_LOG_ARG_DOUBLE) || (Kind == BINARY_LOG_ARG_POINTER);
+	uint8_t* Arg = BinaryLog_CallArgStart(Local, Name, Out, Kind, Is64 ? sizeof(uint64_t) : sizeof(uint32_t));
+	if (Arg == nullptr) {
+		return;
+	}
+
+	if (Is64) {
+		memcpy(Arg, &Value, sizeof(uint64_t));
+	}
+	else {
+		uint32_t Value32 = (uint32_t)Value;
+		memcpy(Arg, &Value32, sizeof(Value32));
+	}
+}
+
+// Stores an address and up to Max characters, Char converts a character to ANSI
+template<class C, class F>
+static void BinaryLog_CallArgChars(const char* Name, bool Out, char Kind, const C* Str, int Max, F Char)
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	size_t Length = 0;
+	if (Str != nullptr) {
+		while ((int)Length < Max && Str[Length] != 0) {
+			Length++;
+		}
+		Length = std::min(Length, (size_t)0xFFFE);
+	}
+	uint8_t* Arg = BinaryLog_CallArgStart(Local, Name, Out, Kind, sizeof(uint64_t) + sizeof(uint16_t) + Length);
+	if (Arg == nullptr) {
+		return;
+	}
+
+	uint64_t Address = (uintptr_t)Str;
+	uint16_t Stored = (Str != nullptr) ? (uint16_t)Length : 0xFFFF;
+	memcpy(Arg, &Address, sizeof(Address));
+	memcpy(Arg + sizeof(Address), &Stored, sizeof(Stored));
+	for (size_t i = 0; i < Length; i++) {
+		Arg[sizeof(Address) + sizeof(Stored) + i] = Char(Str[i]);
+	}
+}
+
+void BinaryLog_CallArgString(const char* Name, bool Out, const char* Str, int Max)
+{
+	BinaryLog_CallArgChars(Name, Out, BINARY_LOG_ARG_STRING, Str, Max, [](char c) { return (uint8_t)c; });
+}
+
+void BinaryLog_CallArgWString(const char* Name, bool Out, const wchar_t* Str, int Max)
+{
+	// Render unicode as ANSI, like the console log does
+	BinaryLog_CallArgChars(Name, Out, BINARY_LOG_ARG_WSTRING, Str, Max, [](wchar_t c) { return (c <= 0xFF) ? (uint8_t)c : (uint8_t)'?'; });
+}
+
+void BinaryLog_CallArgText(const char* Name, bool Out, const char* Text, size_t Length)
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	// Texts are truncated to what's left of the record
+	size_t Room = BINARY_LOG_MAX_RECORD - std::min(BINARY_LOG_MAX_RECORD, Local.CallPos + sizeof(uint32_t) + 2 + sizeof(uint16_t));
+	Length = std::min({ Length, Room, (size_t)0xFFFE });
+	uint8_t* Arg = BinaryLog_CallArgStart(Local, Name, Out, BINARY_LOG_ARG_TEXT, sizeof(uint16_t) + Length);
+	if (Arg == nullptr) {
+		return;
+	}
+
+	uint16_t Stored = (uint16_t)Length;
+	memcpy(Arg, &Stored, sizeof(Stored));
+	memcpy(Arg + sizeof(Stored), Text, Length);
+}
+
+void BinaryLog_EndCall()
+{
+	BinaryLogLocal& Local = BinaryLogThreadState;
+	uint8_t* Record = Local.Call.get();
+
+	uint32_t Size = BinaryLog_Align(Local.CallPos);
+	memset(&Record[Local.CallPos], 0, Size - Local.CallPos);
+	memcpy(Record, &Size, sizeof(Size));
+	BinaryLog_Push(*Local.Ring, Record, Size);
+}
+
+static void BinaryLog_WriteFormats(uint32_t UpToId)
+{
+	std::lock_guard<std::mutex> lock(BinaryLogMtx);
+
+	while (BinaryLogFormatsWritten <= UpToId && BinaryLogFormatsWritten < BinaryLogFormats.size()) {
+		const BinaryLogFormat& Entry = BinaryLogFormats[BinaryLogFormatsWritten++];
+
+		size_t Pos = sizeof(BinaryLogRecord) + Entry.Format.size() + 1 + Entry.Kinds.size() + 1;
+		uint32_t Size = BinaryLog_Align(Pos);
+		uint8_t Header[sizeof(BinaryLogRecord)];
+		BinaryLog_SetHeader(Header, Size, BinaryLogType::Format, 0, 0, Entry.Id, 0);
+
+		static const uint8_t Zeroes[8] = { 0 };
+		fwrite(Header, 1, sizeof(Header), BinaryLogFile);
+		fwrite(Entry.Format.c_str(), 1, Entry.Format.size() + 1, BinaryLogFile);
+		fwrite(Entry.Kinds.c_str(), 1, Entry.Kinds.size() + 1, BinaryLogFile);
+		fwrite(Zeroes, 1, Size - Pos, BinaryLogFile);
+	}
+}
+
+// Writes out all complete records of a ring, returns the number of bytes drained
+static size_t BinaryLog_DrainRing(BinaryLogRing& Ring)
+{
+	uint64_t Tail = Ring.Tail.load(std::memory_order_relaxed);
+	const uint64_t Head = Ring.Head.load(std::memory_order_acquire);
+	const uint64_t Start = Tail;
+
+	while (Tail != Head) {
+		const uint8_t* Record = &Ring.Data[Tail & (BINARY_LOG_RING_SIZE - 1)];
+		uint32_t Size;
+		memcpy(&Size, Record, sizeof(Size));
+		BinaryLogType Type = (BinaryLogType)Record[offsetof(BinaryLogRecord, Type)];
+
+		if (Type != BinaryLogType::Pad) {
+			if (Type == BinaryLogType::Args) {
+				uint32_t FormatId;
+				memcpy(&FormatId, &Record[offsetof(BinaryLogRecord, FormatId)], sizeof(FormatId));
+				if (FormatId >= BinaryLogFormatsWritten) {
+					BinaryLog_WriteFormats(FormatId);
+				}
+			}
+			// A call refers to its function and argument names, which were all added before it
+			else if (Type == BinaryLogType::Call) {
+				if (BinaryLogFormatsWritten < BinaryLogFormatCount.load(std::memory_order_acquire)) {
+					BinaryLog_WriteFormats(UINT32_MAX);
+				}
+			}
+			fwrite(Record, 1, Size, BinaryLogFile);
+			BinaryLogRecords++;
+			BinaryLogBytes += Size;
+		}
+
+		Tail += Size;
+		Ring.Tail.store(Tail, std::memory_order_release);
+	}
+
+	uint64_t Dropped = Ring.Dropped.exchange(0);
+	if (Dropped > 0) {
+		uint8_t Record[sizeof(BinaryLogRecord)];
+		BinaryLog_SetHeader(Record, sizeof(Record), BinaryLogType::Dropped, 0, 0, (uint32_t)Dropped, 0);
+		fwrite(Record, 1, sizeof(Record), BinaryLogFile);
+		BinaryLogDropped += Dropped;
+	}
+
+	return (size_t)(Tail - Start);
+}
+
+static void BinaryLog_DrainLoop()
+{
+	std::vector<std::shared_ptr<BinaryLogRing>> Rings;
+	auto LastFlush = std::chrono::steady_clock::now();
+
+	for (;;) {
+		// Read the flag before draining, so the last pass sees everything pushed before closing
+		bool Running = BinaryLogRunning.load(std::memory_order_acquire);
+
+		{
+			std::lock_guard<std::mutex> lock(BinaryLogMtx);
+			Rings = BinaryLogRings;
+		}
+
+		size_t Drained = 0;
+		bool Retired = false;
+		for (auto& Ring : Rings) {
+			Drained += BinaryLog_DrainRing(*Ring);
+			Retired |= Ring->Retired.load(std::memory_order_relaxed);
+		}
+
+		// Rings of exited threads are released once they have been drained
+		if (Retired) {
+			std::lock_guard<std::mutex> lock(BinaryLogMtx);
+			BinaryLogRings.erase(std::remove_if(BinaryLogRings.begin(), BinaryLogRings.end(), [](const std::shared_ptr<BinaryLogRing>& Ring) {
+				return Ring->Retired && Ring->Tail.load() == Ring->Head.load();
+			}), BinaryLogRings.end());
+		}
+		Rings.clear();
+
+		if (!Running) {
+			break;
+		}
+
+		auto Now = std::chrono::steady_clock::now();
+		if (Now - LastFlush >= std::chrono::milliseconds(100)) {
+			fflush(BinaryLogFile);
+			LastFlush = Now;
+		}
+
+		if (Drained == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	fflush(BinaryLogFile);
+}
+
+static void BinaryLog_WriteNames(FILE* fp, const std::vector<std::string>& Names)
+{
+	uint32_t Count = (uint32_t)Names.size();
+	fwrite(&Count, sizeof(Count), 1, fp);
+	for (const auto& Name : Names) {
+		uint16_t Length = (uint16_t)std::min(Name.size(), (size_t)0xFFFF);
+		fwrite(&Length, sizeof(Length), 1, fp);
+		fwrite(Name.c_str(), 1, Length, fp);
+	}
+}
+
+bool BinaryLog_Open(const std::string& FilePath, bool Append, const std::vector<std::string>& ModuleNames, const std::vector<std::string>& LevelNames)
+{
+	std::lock_guard<std::mutex> lock(BinaryLogStateMtx);
+
+	if (BinaryLogRunning) {
+		return false;
+	}
+
+	BinaryLogFile = fopen(FilePath.c_str(), Append ? "ab" : "wb");
+	if (BinaryLogFile == nullptr) {
+		return false;
+	}
+
+	uint32_t Header[2] = { BINARY_LOG_MAGIC, BINARY_LOG_VERSION };
+	uint64_t Start = BinaryLog_Now();
+	fwrite(Header, sizeof(Header), 1, BinaryLogFile);
+	fwrite(&Start, sizeof(Start), 1, BinaryLogFile);
+	BinaryLog_WriteNames(BinaryLogFile, ModuleNames);
+	BinaryLog_WriteNames(BinaryLogFile, LevelNames);
+
+	// A new session needs the whole format table again
+	BinaryLogFormatsWritten = 0;
+	BinaryLogRunning = true;
+	BinaryLogDrainThread = std::thread(BinaryLog_DrainLoop);
+	g_BinaryLogEnabled = true;
+	return true;
+}
+
+void BinaryLog_Close()
+{
+	std::lock_guard<std::mutex> lock(BinaryLogStateMtx);
+
+	if (!BinaryLogRunning) {
+		return;
+	}
+
+	g_BinaryLogEnabled = false;
+	BinaryLogRunning = false;
+	BinaryLogDrainThread.join();
+
+	fclose(BinaryLogFile);
+	BinaryLogFile = nullptr;
+}
+
+BinaryLogStats BinaryLog_GetStats()
+{
+	BinaryLogStats Stats;
+	Stats.Records = BinaryLogRecords;
+	Stats.Bytes = BinaryLogBytes;
+	Stats.Dropped = BinaryLogDropped;
+	return Stats;
+}
+
+//
+// Decoder
+//
+
+static void BinaryLog_Append(std::string& Out, const char* Spec, ...)
+{
+	char Buffer[256];
+	va_list Args;
+	va_start(Args, Spec);
+	int Length = vsnprintf(Buffer, sizeof(Buffer), Spec, Args);
+	va_end(Args);
+	if (Length < 0) {
+		return;
+	}
+	if ((size_t)Length < sizeof(Buffer)) {
+		Out.append(Buffer, Length);
+		return;
+	}
+
+	size_t Pos = Out.size();
+	Out.resize(Pos + Length + 1);
+	va_start(Args, Spec);
+	vsnprintf(&Out[Pos], Length + 1, Spec, Args);
+	va_end(Args);
+	Out.resize(Pos + Length);
+}
+
+typedef struct _BinaryLogReader {
+	const uint8_t* Data;
+	size_t Size;
+	size_t Pos;
+
+	template<typename T>
+	bool Read(T& Value)
+	{
+		if (Pos + sizeof(T) > Size) {
+			return false;
+		}
+		memcpy(&Value, &Data[Pos], sizeof(T));
+		Pos += sizeof(T);
+		return true;
+	}
+
+	bool ReadString(std::string& Value, bool& IsNull)
+	{
+		uint16_t Length;
+		if (!Read(Length)) {
+			return false;
+		}
+		IsNull = (Length == 0xFFFF);
+		if (IsNull) {
+			Value.clear();
+			return true;
+		}
+		if (Pos + Length > Size) {
+			return false;
+		}
+		Value.assign((const char*)&Data[Pos], Length);
+		Pos += Length;
+		return true;
+	}
+} BinaryLogReader;
+
+// Renders a message with the stored arguments, one conversion at a time
+static void BinaryLog_Render(std::string& Out, const BinaryLogFormat& Entry, BinaryLogReader& Args)
+{
+	size_t k = 0;
+	auto ReadInt = [&](int64_t& Value) {
+		if (k >= Entry.Kinds.size()) {
+			return false;
+		}
+		if (Entry.Kinds[k++] == BINARY_LOG_ARG_INT64) {
+			return Args.Read(Value);
+		}
+		int32_t Value32;
+		if (!Args.Read(Value32)) {
+			return false;
+		}
+		Value = Value32;
+		return true;
+	};
+
+	for (const char* p = Entry.Format.c_str(); *p != '\0'; p++) {
+		if (*p != '%') {
+			Out += *p;
+			continue;
+		}
+		p++;
+		if (*p == '%') {
+			Out += '%';
+			continue;
+		}
+
+		std::string Spec = "%";
+		while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) {
+			Spec += *p++;
+		}
+		int64_t Star;
+		if (*p == '*') {
+			if (!ReadInt(Star)) {
+				break;
+			}
+			Spec += std::to_string(Star);
+			p++;
+		}
+		while (*p >= '0' && *p <= '9') {
+			Spec += *p++;
+		}
+		if (*p == '.') {
+			Spec += *p++;
+			if (*p == '*') {
+				if (!ReadInt(Star)) {
+					break;
+				}
+				Spec += std::to_string(Star);
+				p++;
+			}
+			while (*p >= '0' && *p <= '9') {
+				Spec += *p++;
+			}
+		}
+		while (*p != '\0' && strchr("hlqjztLwI", *p) != nullptr) {
+			if (*p == 'I' && ((p[1] == '6' && p[2] == '4') || (p[1] == '3' && p[2] == '2'))) {
+				p += 2;
+			}
+			p++;
+		}
+		if (*p == '\0' || k >= Entry.Kinds.size()) {
+			break;
+		}
+
+		const char Conversion = *p;
+		const char Kind = Entry.Kinds[k];
+		bool Ok = true;
+		switch (Kind) {
+			case BINARY_LOG_ARG_INT32:
+			case BINARY_LOG_ARG_INT64: {
+				int64_t Value;
+				if (!(Ok = ReadInt(Value))) {
+					break;
+				}
+				if (Conversion == 'c' || Conversion == 'C') {
+					BinaryLog_Append(Out, (Spec + "c").c_str(), (Value >= 0 && Value <= 0xFF) ? (int)Value : '?');
+				}
+				else if (Conversion == 'd' || Conversion == 'i') {
+					BinaryLog_Append(Out, (Spec + "ll" + Conversion).c_str(), (long long)Value);
+				}
+				else {
+					unsigned long long Unsigned = (Kind == BINARY_LOG_ARG_INT64) ? (unsigned long long)Value : (unsigned long long)(uint32_t)Value;
+					BinaryLog_Append(Out, (Spec + "ll" + Conversion).c_str(), Unsigned);
+				}
+				break;
+			}
+			case BINARY_LOG_ARG_DOUBLE:
+			case BINARY_LOG_ARG_LDOUBLE: {
+				double Value;
+				k++;
+				if ((Ok = Args.Read(Value))) {
+					BinaryLog_Append(Out, (Spec + Conversion).c_str(), Value);
+				}
+				break;
+			}
+			case BINARY_LOG_ARG_POINTER: {
+				uint64_t Value;
+				k++;
+				if ((Ok = Args.Read(Value))) {
+					// Like %p of the Windows runtime, which wrote these logs
+					BinaryLog_Append(Out, (Value >> 32) ? "%016llX" : "%08llX", (unsigned long long)Value);
+				}
+				break;
+			}
+			case BINARY_LOG_ARG_STRING:
+			case BINARY_LOG_ARG_WSTRING: {
+				std::string Value;
+				bool IsNull;
+				k++;
+				if ((Ok = Args.ReadString(Value, IsNull))) {
+					BinaryLog_Append(Out, (Spec + "s").c_str(), IsNull ? "(null)" : Value.c_str());
+				}
+				break;
+			}
+			default:
+				k++;
+				break;
+		}
+
+		if (!Ok) {
+			Out += "<truncated>";
+			break;
+		}
+	}
+}
+
+// Renders the characters of a string argument, escaped like output_char of the text log does
+static void BinaryLog_AppendEscaped(std::string& Out, const std::string& Value, bool Wide)
+{
+	for (char c : Value) {
+		switch (c) {
+			case '"': Out += "\\\""; break;
+			case '\\': Out += "\\\\"; break;
+			case '\a': Out += "\\a"; break;
+			case '\b': Out += "\\b"; break;
+			case '\f': Out += "\\f"; break;
+			case '\n': Out += "\\n"; break;
+			case '\r': Out += "\\r"; break;
+			case '\t': Out += "\\t"; break;
+			case '\v': Out += "\\v"; break;
+			default:
+				if ((uint8_t)c < 0x20 || c == 0x7F) {
+					BinaryLog_Append(Out, Wide ? "\\x%04X" : "\\x%02X", (uint8_t)c);
+				}
+				else {
+					Out += c;
+				}
+				break;
+		}
+	}
+}
+
+// Renders one argument value of a Call record
+static bool BinaryLog_RenderCallValue(std::string& Out, char Kind, BinaryLogReader& Args)
+{
+	switch (Kind) {
+		case BINARY_LOG_ARG_INT32:
+		case BINARY_LOG_ARG_UINT32:
+		case BINARY_LOG_ARG_HEX8:
+		case BINARY_LOG_ARG_HEX16:
+		case BINARY_LOG_ARG_HEX32: {
+			uint32_t Value;
+			if (!Args.Read(Value)) {
+				return false;
+			}
+			switch (Kind) {
+				case BINARY_LOG_ARG_INT32: BinaryLog_Append(Out, "%d", (int32_t)Value); break;
+				case BINARY_LOG_ARG_UINT32: BinaryLog_Append(Out, "%u", Value); break;
+				case BINARY_LOG_ARG_HEX8: BinaryLog_Append(Out, "0x%02X", Value); break;
+				case BINARY_LOG_ARG_HEX16: BinaryLog_Append(Out, "0x%04X", Value); break;
+				default: BinaryLog_Append(Out, "0x%08X", Value); break;
+			}
+			return true;
+		}
+		case BINARY_LOG_ARG_INT64:
+		case BINARY_LOG_ARG_UINT64:
+		case BINARY_LOG_ARG_DOUBLE:
+		case BINARY_LOG_ARG_POINTER: {
+			uint64_t Value;
+			if (!Args.Read(Value)) {
+				return false;
+			}
+			if (Kind == BINARY_LOG_ARG_INT64) {
+				BinaryLog_Append(Out, "%lld", (long long)Value);
+			}
+			else if (Kind == BINARY_LOG_ARG_UINT64) {
+				BinaryLog_Append(Out, "%llu", (unsigned long long)Value);
+			}
+			else if (Kind == BINARY_LOG_ARG_DOUBLE) {
+				// The default precision of an ostream
+				double Double;
+				memcpy(&Double, &Value, sizeof(Double));
+				BinaryLog_Append(Out, "%g", Double);
+			}
+			else {
+				// Like PVOID of the text log
+				BinaryLog_Append(Out, (Value >> 32) ? "0x%016llX" : "0x%08llX", (unsigned long long)Value);
+			}
+			return true;
+		}
+		case BINARY_LOG_ARG_STRING:
+		case BINARY_LOG_ARG_WSTRING: {
+			uint64_t Address;
+			std::string Value;
+			bool IsNull;
+			if (!Args.Read(Address) || !Args.ReadString(Value, IsNull)) {
+				return false;
+			}
+			Out += (Kind == BINARY_LOG_ARG_STRING) ? "(char *)" : "(wchar *)";
+			if (IsNull) {
+				Out += "NULL";
+				return true;
+			}
+			BinaryLog_Append(Out, "0x%08llX = \"", (unsigned long long)Address);
+			BinaryLog_AppendEscaped(Out, Value, Kind == BINARY_LOG_ARG_WSTRING);
+			Out += '"';
+			return true;
+		}
+		case BINARY_LOG_ARG_TEXT: {
+			std::string Value;
+			bool IsNull;
+			if (!Args.ReadString(Value, IsNull)) {
+				return false;
+			}
+			Out += Value;
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+// Renders a Call record the way LOG_FUNC_BEGIN up to LOG_FUNC_END (or LOG_FUNC_RESULT) of the text log does
+static void BinaryLog_RenderCall(std::string& Out, const BinaryLogRecord& Record, const std::string& Module,
+	const std::unordered_map<uint32_t, BinaryLogFormat>& Formats, BinaryLogReader& Args)
+{
+	auto NameOf = [&Formats](uint32_t Id) {
+		auto it = Formats.find(Id);
+		return (it != Formats.end()) ? it->second.Format.c_str() : "?";
+	};
+
+	BinaryLog_Append(Out, "[0x%04X] ", Record.ThreadId);
+	Out += Module;
+	Out += NameOf(Record.FormatId);
+	const bool Result = (Record.Flags & BINARY_LOG_CALL_RESULT) != 0;
+	Out += Result ? " returns " : "(";
+
+	bool HadArg = false;
+	while (Args.Pos < Args.Size) {
+		uint32_t NameId;
+		uint8_t Kind, Flags;
+		if (!Args.Read(NameId) || !Args.Read(Kind) || !Args.Read(Flags)) {
+			break;
+		}
+		// Only padding follows the last argument
+		if (NameId == 0 && Kind == 0) {
+			break;
+		}
+		if (!Result) {
+			const bool IsOut = (Flags & BINARY_LOG_CALL_OUT) != 0;
+			BinaryLog_Append(Out, IsOut ? "\n OUT %-18s : " : "\n   %-20s : ", (NameId != UINT32_MAX) ? NameOf(NameId) : "");
+		}
+		if (!BinaryLog_RenderCallValue(Out, (char)Kind, Args)) {
+			Out += "<truncated>";
+			break;
+		}
+		HadArg = true;
+	}
+
+	if (!Result) {
+		Out += HadArg ? "\n);" : ");";
+	}
+}
+
+static bool BinaryLog_ReadNames(FILE* In, std::vector<std::string>& Names)
+{
+	uint32_t Count;
+	if (fread(&Count, sizeof(Count), 1, In) != 1) {
+		return false;
+	}
+	for (uint32_t i = 0; i < Count; i++) {
+		uint16_t Length;
+		if (fread(&Length, sizeof(Length), 1, In) != 1) {
+			return false;
+		}
+		std::string Name(Length, '\0');
+		if (Length > 0 && fread(&Name[0], 1, Length, In) != Length) {
+			return false;
+		}
+		Names.push_back(std::move(Name));
+	}
+	return true;
+}
+
+// Renders one session, from its header up to the end of the file or the header of the next session
+static bool BinaryLog_DecodeSession(FILE* In, FILE* Out, bool Timestamps, bool& NextSession)
+{
+	uint32_t Header[2];
+	uint64_t Start;
+	std::vector<std::string> ModuleNames;
+	std::vector<std::string> LevelNames;
+	NextSession = false;
+	if (fread(Header, sizeof(Header), 1, In) != 1 || Header[0] != BINARY_LOG_MAGIC || Header[1] == 0 || Header[1] > BINARY_LOG_VERSION) {
+		return false;
+	}
+	if (fread(&Start, sizeof(Start), 1, In) != 1 || !BinaryLog_ReadNames(In, ModuleNames) || !BinaryLog_ReadNames(In, LevelNames)) {
+		return false;
+	}
+
+	// Records are drained one thread at a time, so they're read in full and sorted on their timestamp
+	std::vector<uint8_t> Data;
+	std::vector<size_t> Offsets;
+	std::unordered_map<uint32_t, BinaryLogFormat> Formats;
+	for (;;) {
+		BinaryLogRecord Record;
+		if (fread(&Record, sizeof(Record), 1, In) != 1) {
+			break; // End of the log, or a record cut short by a crash
+		}
+		// Sizes are a multiple of 8, so this can only be the start of the next session
+		if (Record.Size == BINARY_LOG_MAGIC) {
+			fseek(In, -(long)sizeof(Record), SEEK_CUR);
+			NextSession = true;
+			break;
+		}
+		if (Record.Size < sizeof(Record) || (Record.Size & 7) != 0) {
+			return false;
+		}
+
+		size_t Offset = Data.size();
+		Data.resize(Offset + Record.Size);
+		memcpy(&Data[Offset], &Record, sizeof(Record));
+		if (fread(&Data[Offset + sizeof(Record)], 1, Record.Size - sizeof(Record), In) != Record.Size - sizeof(Record)) {
+			Data.resize(Offset);
+			break;
+		}
+
+		if (Record.Type == BinaryLogType::Format) {
+			const char* Payload = (const char*)&Data[Offset + sizeof(Record)];
+			const char* End = (const char*)&Data[Offset + Record.Size];
+			BinaryLogFormat& Entry = Formats[Record.FormatId];
+			Entry.Id = Record.FormatId;
+			Entry.Format.assign(Payload, strnlen(Payload, End - Payload));
+			Payload += std::min((size_t)(End - Payload), Entry.Format.size() + 1);
+			Entry.Kinds.assign(Payload, strnlen(Payload, End - Payload));
+			Entry.Supported = true;
+			Data.resize(Offset);
+			continue;
+		}
+		Offsets.push_back(Offset);
+	}
+
+	auto TimestampOf = [&Data](size_t Offset) {
+		uint64_t Timestamp;
+		memcpy(&Timestamp, &Data[Offset + offsetof(BinaryLogRecord, Timestamp)], sizeof(Timestamp));
+		return Timestamp;
+	};
+	std::stable_sort(Offsets.begin(), Offsets.end(), [&](size_t a, size_t b) {
+		return TimestampOf(a) < TimestampOf(b);
+	});
+
+	std::string Line;
+	for (size_t Offset : Offsets) {
+		BinaryLogRecord Record;
+		memcpy(&Record, &Data[Offset], sizeof(Record));
+		const char* Payload = (const char*)&Data[Offset + sizeof(Record)];
+
+		Line.clear();
+		if (Timestamps) {
+			BinaryLog_Append(Line, "%12.6f ", (Record.Timestamp >= Start) ? (Record.Timestamp - Start) / 1e9 : 0.0);
+		}
+
+		if (Record.Type == BinaryLogType::Raw) {
+			Line.append(Payload, std::min((size_t)Record.FormatId, Record.Size - sizeof(Record)));
+			fwrite(Line.data(), 1, Line.size(), Out);
+			continue;
+		}
+
+		// Function logging carries no level, like the Raw records it replaces
+		if (Record.Type == BinaryLogType::Call) {
+			BinaryLogReader Args = { (const uint8_t*)Payload, Record.Size - sizeof(Record), 0 };
+			BinaryLog_RenderCall(Line, Record, (Record.Module < ModuleNames.size()) ? ModuleNames[Record.Module] : "???     ", Formats, Args);
+			Line += '\n';
+			fwrite(Line.data(), 1, Line.size(), Out);
+			continue;
+		}
+
+		BinaryLog_Append(Line, "[0x%04X] ", Record.ThreadId);
+		Line += (Record.Level < LevelNames.size()) ? LevelNames[Record.Level] : "???? : ";
+		Line += (Record.Module < ModuleNames.size()) ? ModuleNames[Record.Module] : "???     ";
+
+		switch (Record.Type) {
+			case BinaryLogType::Args: {
+				auto it = Formats.find(Record.FormatId);
+				if (it == Formats.end()) {
+					BinaryLog_Append(Line, "<unknown format %u>", Record.FormatId);
+					break;
+				}
+				BinaryLogReader Args = { (const uint8_t*)Payload, Record.Size - sizeof(Record), 0 };
+				BinaryLog_Render(Line, it->second, Args);
+				break;
+			}
+			case BinaryLogType::Line:
+				Line.append(Payload, std::min((size_t)Record.FormatId, Record.Size - sizeof(Record)));
+				break;
+			case BinaryLogType::Dropped:
+				BinaryLog_Append(Line, "%u records were dropped while closing the log", Record.FormatId);
+				break;
+			default:
+				BinaryLog_Append(Line, "<unknown record type %u>", (unsigned)Record.Type);
+				break;
+		}
+		Line += '\n';
+		fwrite(Line.data(), 1, Line.size(), Out);
+	}
+
+	return true;
+}
+
+bool BinaryLog_Decode(FILE* In, FILE* Out, bool Timestamps)
+{
+	bool NextSession;
+	if (!BinaryLog_DecodeSession(In, Out, Timestamps, NextSession)) {
+		return false;
+	}
+
+	// Same separator as the text log, between the sessions of a reboot
+	while (NextSession) {
+		fputs("\n------REBOOT------REBOOT------REBOOT------REBOOT------REBOOT------\n\n", Out);
+		if (!BinaryLog_DecodeSession(In, Out, Timestamps, NextSession)) {
+			return false;
+		}
+	}
+
+	return true;
+}
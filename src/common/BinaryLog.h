@@ -0,0 +1,166 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Asynchronous binary log. Instead of formatting a message on the calling thread, a call
+// pushes a compact record (timestamp, thread, module, level, format id and the raw argument
+// words) into a lock-free ring owned by that thread. A background thread drains all rings
+// to a file, which BinaryLog_Decode renders as text afterwards, in timestamp order.
+// When disabled, a log call costs a single relaxed load of g_BinaryLogEnabled
+
+extern std::atomic_bool g_BinaryLogEnabled;
+
+// Size of the ring of each logging thread, a power of two
+constexpr size_t BINARY_LOG_RING_SIZE = 256 * 1024;
+// Longest record, longer strings and texts are truncated
+constexpr size_t BINARY_LOG_MAX_RECORD = 64 * 1024;
+
+constexpr uint32_t BINARY_LOG_MAGIC = 0x4C425843; // "CXBL"
+constexpr uint32_t BINARY_LOG_VERSION = 2; // 2 : added Call records
+
+typedef enum class _BinaryLogType : uint8_t {
+	Pad = 0,   // skips to the start of the ring, never written to the file
+	Format,    // format table entry : format string, '\0', argument kinds
+	Args,      // printf-style message : argument words of the format with id FormatId
+	Line,      // message formatted by the caller, rendered with prefix and newline
+	Raw,       // text rendered as is (function logging, which carries its own prefix)
+	Dropped,   // records of this thread lost while the log was closing, count in FormatId
+	Call,      // logged function call : function name with id FormatId, then its arguments
+} BinaryLogType;
+
+// All records start with this header, and are padded to a multiple of 8 bytes
+typedef struct _BinaryLogRecord {
+	uint32_t Size;      // including this header and padding
+	BinaryLogType Type;
+	uint8_t Module;
+	uint8_t Level;
+	uint8_t Flags;      // BINARY_LOG_CALL_RESULT for Call, otherwise 0
+	uint32_t FormatId;  // for Args, Call (and the entry for Format), payload length for Line and Raw
+	uint32_t ThreadId;
+	uint64_t Timestamp; // in nanoseconds of the steady clock
+} BinaryLogRecord;
+static_assert(sizeof(BinaryLogRecord) == 24, "BinaryLogRecord must stay packed");
+
+// Argument kinds, one character per argument consumed by a format string
+#define BINARY_LOG_ARG_INT32   'i' // 4 bytes
+#define BINARY_LOG_ARG_INT64   'I' // 8 bytes
+#define BINARY_LOG_ARG_DOUBLE  'd' // 8 bytes
+#define BINARY_LOG_ARG_POINTER 'p' // 8 bytes
+#define BINARY_LOG_ARG_STRING  's' // uint16_t length (0xFFFF for null) followed by the characters
+#define BINARY_LOG_ARG_WSTRING 'w' // stored like a string, with unicode rendered as '?'
+#define BINARY_LOG_ARG_IGNORED 'n' // %n, nothing is stored
+
+// Call records store each argument as a uint32_t name id (a format table entry, 0xFFFFFFFF for
+// none), its kind, a flags byte (BINARY_LOG_CALL_OUT) and its value. Besides the kinds above :
+#define BINARY_LOG_ARG_UINT32  'u' // 4 bytes
+#define BINARY_LOG_ARG_UINT64  'U' // 8 bytes
+#define BINARY_LOG_ARG_HEX8    'b' // 4 bytes, rendered like hex1 of the text log
+#define BINARY_LOG_ARG_HEX16   'h' // 4 bytes, rendered like hex2
+#define BINARY_LOG_ARG_HEX32   'x' // 4 bytes, rendered like hex4
+#define BINARY_LOG_ARG_TEXT    't' // stored like a string, rendered as is
+// Strings and wide strings of a Call are preceded by their address (8 bytes), and rendered
+// like the sanitized_char_pointer of the text log
+
+#define BINARY_LOG_CALL_RESULT 0x01 // record flag : the call renders as the value it returns
+#define BINARY_LOG_CALL_OUT    0x01 // argument flag : an out argument
+
+// Opens FilePath and starts the drain thread. With Append set, a new session is added after the
+// ones already in the file (a reboot), instead of replacing them. ModuleNames and LevelNames are
+// stored in the session header, so the decoder renders modules and levels the way the console log does
+bool BinaryLog_Open(const std::string& FilePath, bool Append, const std::vector<std::string>& ModuleNames, const std::vector<std::string>& LevelNames);
+// Stops the drain thread after writing all pending records, and closes the file
+void BinaryLog_Close();
+// Sets up the state of the calling thread ahead of its first record. Objects with a thread_local
+// lifetime that log from their destructor call this first, so the state outlives them
+void BinaryLog_InitThread();
+// Records a printf-style message. Format must stay valid and unchanged for the lifetime of the
+// process (string literals), since it is identified by its address
+void BinaryLog_WriteArgs(uint32_t ThreadId, uint8_t Module, uint8_t Level, const char* Format, va_list Args);
+// Records an already formatted message (BinaryLogType::Line or BinaryLogType::Raw)
+void BinaryLog_WriteText(uint32_t ThreadId, uint8_t Module, uint8_t Level, BinaryLogType Type, const char* Text, size_t Length);
+
+// Records a logged function call without rendering its arguments : BeginCall starts a Call record
+// on the calling thread, each CallArg adds an argument, and EndCall pushes the record. Func and the
+// argument names are identified by their address, like formats. With Result set, the record holds
+// the single value the function returns. Arguments that no longer fit in a record are left out
+void BinaryLog_BeginCall(uint32_t ThreadId, uint8_t Module, uint8_t Level, const char* Func, bool Result);
+// Adds an integer, hexadecimal, double (its bits) or pointer argument
+void BinaryLog_CallArg(const char* Name, bool Out, char Kind, uint64_t Value);
+// Adds a string argument of at most Max characters, which is rendered with escapes
+void BinaryLog_CallArgString(const char* Name, bool Out, const char* Str, int Max);
+void BinaryLog_CallArgWString(const char* Name, bool Out, const wchar_t* Str, int Max);
+// Adds an argument rendered by the caller
+void BinaryLog_CallArgText(const char* Name, bool Out, const char* Text, size_t Length);
+void BinaryLog_EndCall();
+
+// Adds an argument by its type : integers, doubles and untyped pointers as words, C strings as their
+// characters. Returns false for other types, which the caller renders with BinaryLog_CallArgText
+template<class T>
+inline bool BinaryLog_CallArgValue(const char* Name, bool Out, const T& Value)
+{
+	if constexpr (std::is_integral_v<T>) {
+		if constexpr (sizeof(T) > sizeof(uint32_t)) {
+			BinaryLog_CallArg(Name, Out, std::is_signed_v<T> ? BINARY_LOG_ARG_INT64 : BINARY_LOG_ARG_UINT64, (uint64_t)Value);
+		}
+		else {
+			BinaryLog_CallArg(Name, Out, std::is_signed_v<T> ? BINARY_LOG_ARG_INT32 : BINARY_LOG_ARG_UINT32, (uint64_t)(int64_t)Value);
+		}
+	}
+	else if constexpr (std::is_floating_point_v<T>) {
+		double Double = (double)Value;
+		uint64_t Bits;
+		memcpy(&Bits, &Double, sizeof(Bits));
+		BinaryLog_CallArg(Name, Out, BINARY_LOG_ARG_DOUBLE, Bits);
+	}
+	else if constexpr (std::is_pointer_v<T> && std::is_void_v<std::remove_pointer_t<T>>) {
+		BinaryLog_CallArg(Name, Out, BINARY_LOG_ARG_POINTER, (uint64_t)(uintptr_t)Value);
+	}
+	else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+		BinaryLog_CallArgText(Name, Out, (Value != nullptr) ? Value : "", (Value != nullptr) ? strlen(Value) : 0);
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+typedef struct _BinaryLogStats {
+	uint64_t Records;
+	uint64_t Bytes;
+	uint64_t Dropped;
+} BinaryLogStats;
+
+BinaryLogStats BinaryLog_GetStats();
+
+// Renders a binary log as text, session after session. With Timestamps set, each message is
+// prefixed with the seconds since its session was opened. Returns false if the input is not a valid log
+bool BinaryLog_Decode(FILE* In, FILE* Out, bool Timestamps);
@@ -0,0 +1,67 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "ClockScale.h"
+
+// Calculates the multiplier and the shift that convert FromFrequency ticks to ToFrequency ticks. The quotient is
+// computed a bit at a time, since (ToFrequency << Shift) doesn't fit in 64 bits, but this only runs on rate changes
+void ClockScale_Init(ClockScale* Scale, uint64_t FromFrequency, uint64_t ToFrequency)
+{
+	Scale->BaseTicks = 0;
+	Scale->BaseValue = 0;
+	Scale->Multiplier = 0;
+	Scale->Shift = 0;
+
+	if (FromFrequency == 0) {
+		return;
+	}
+
+	uint64_t Quotient = ToFrequency / FromFrequency;
+	uint64_t Remainder = ToFrequency % FromFrequency;
+
+	while (Scale->Shift < 63 && Quotient < (1ull << 62)) {
+		Quotient <<= 1;
+		if (Remainder >= FromFrequency - Remainder) {
+			Quotient |= 1;
+			Remainder -= FromFrequency - Remainder;
+		}
+		else {
+			Remainder <<= 1;
+		}
+		Scale->Shift++;
+	}
+
+	Scale->Multiplier = Quotient;
+}
+
+// Changes the rates of the conversion, without making the converted ticks jump at the given source ticks
+void ClockScale_Rebase(ClockScale* Scale, uint64_t Ticks, uint64_t FromFrequency, uint64_t ToFrequency)
+{
+	uint64_t Value = ClockScale_Convert(Scale, Ticks);
+
+	ClockScale_Init(Scale, FromFrequency, ToFrequency);
+	Scale->BaseTicks = Ticks;
+	Scale->BaseValue = Value;
+}
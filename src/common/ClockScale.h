@@ -0,0 +1,73 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef CLOCKSCALE_H
+#define CLOCKSCALE_H
+
+#include <cstdint>
+
+/* Conversion of the ticks of a clock to the ticks of another clock, without divisions. It computes
+   BaseValue + (((Ticks - BaseTicks) * Multiplier) >> Shift) with a 128 bit intermediate product */
+typedef struct _ClockScale
+{
+	uint64_t Multiplier;                 // (ToFrequency << Shift) / FromFrequency
+	unsigned int Shift;                  // as large as possible while keeping Multiplier below 2^63
+	uint64_t BaseTicks;                  // source ticks of the last rate change
+	uint64_t BaseValue;                  // converted ticks of the last rate change
+}
+ClockScale;
+
+void ClockScale_Init(ClockScale* Scale, uint64_t FromFrequency, uint64_t ToFrequency);
+void ClockScale_Rebase(ClockScale* Scale, uint64_t Ticks, uint64_t FromFrequency, uint64_t ToFrequency);
+
+// (Delta * Multiplier) >> Shift, built from 32 bit partial products. Used where there is neither a 128 bit type nor
+// _umul128 (32 bit msvc), and always defined so that it can be checked on other hosts too
+static inline uint64_t ClockScale_MulShift32(uint64_t Delta, uint64_t Multiplier, unsigned int Shift)
+{
+	uint64_t Low = (uint64_t)(uint32_t)Delta * (uint32_t)Multiplier;
+	uint64_t Cross1 = (uint64_t)(uint32_t)Delta * (uint32_t)(Multiplier >> 32);
+	uint64_t Cross2 = (uint64_t)(uint32_t)(Delta >> 32) * (uint32_t)Multiplier;
+	uint64_t High = (uint64_t)(uint32_t)(Delta >> 32) * (uint32_t)(Multiplier >> 32);
+	uint64_t Middle = (Low >> 32) + (uint32_t)Cross1 + (uint32_t)Cross2;
+	Low = (Middle << 32) | (uint32_t)Low;
+	High += (Cross1 >> 32) + (Cross2 >> 32) + (Middle >> 32);
+	if (Shift == 0) {
+		return Low;
+	}
+	return (Low >> Shift) | (High << (64 - Shift));
+}
+
+// Converts the ticks of the source clock to the ticks of the destination clock
+static inline uint64_t ClockScale_Convert(const ClockScale* Scale, uint64_t Ticks)
+{
+	uint64_t Delta = Ticks - Scale->BaseTicks;
+#ifdef __SIZEOF_INT128__
+	return Scale->BaseValue + (uint64_t)(((unsigned __int128)Delta * Scale->Multiplier) >> Scale->Shift);
+#else
+	return Scale->BaseValue + ClockScale_MulShift32(Delta, Scale->Multiplier, Scale->Shift);
+#endif
+}
+
+#endif
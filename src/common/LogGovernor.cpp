@@ -0,0 +1,85 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "LogGovernor.h"
+
+#include <algorithm>
+
+// One message, in the units of m_Tokens
+static constexpr int64_t LOG_TOKEN_COST = 1000000000;
+
+bool LogRateLimiter::Admit(uint32_t Rate, uint64_t Now)
+{
+	if (Rate == 0) {
+		return true;
+	}
+
+	// Only the thread that moves the refill time forward adds the tokens of the elapsed time.
+	// The first refill (from time 0) fills the bucket
+	uint64_t LastRefill = m_LastRefill.load(std::memory_order_relaxed);
+	if (Now > LastRefill && m_LastRefill.compare_exchange_strong(LastRefill, Now, std::memory_order_relaxed)) {
+		const int64_t Burst = (int64_t)Rate * LOG_TOKEN_COST;
+		int64_t Elapsed = (int64_t)std::min<uint64_t>(Now - LastRefill, LOG_TOKEN_COST);
+		int64_t Tokens = m_Tokens.fetch_add(Elapsed * Rate, std::memory_order_relaxed) + Elapsed * Rate;
+		if (Tokens > Burst) {
+			m_Tokens.fetch_sub(Tokens - Burst, std::memory_order_relaxed);
+		}
+	}
+
+	if (m_Tokens.fetch_sub(LOG_TOKEN_COST, std::memory_order_relaxed) >= LOG_TOKEN_COST) {
+		return true;
+	}
+
+	m_Tokens.fetch_add(LOG_TOKEN_COST, std::memory_order_relaxed);
+	m_Suppressed.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+bool LogDeduplicator::Check(uint32_t Module, uint32_t Level, const char* Text, size_t Length, Repeats& Report)
+{
+	Report.Count = 0;
+
+	if (Module == m_Module && Level == m_Level && m_Text.compare(0, std::string::npos, Text, Length) == 0) {
+		if (++m_Repeats >= LOG_DEDUPLICATE_REPORT_EVERY) {
+			Report = { m_Module, m_Level, m_Repeats };
+			m_Repeats = 0;
+		}
+		return false;
+	}
+
+	if (m_Repeats > 0) {
+		Report = { m_Module, m_Level, m_Repeats };
+	}
+
+	m_Module = Module;
+	m_Level = Level;
+	m_Repeats = 0;
+	m_Text.assign(Text, Length);
+	return true;
+}
+
+void LogDeduplicator::TakeRepeats(Repeats& Report)
+{
+	Report = { m_Module, m_Level, m_Repeats };
+	m_Repeats = 0;
+}
@@ -0,0 +1,112 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Log governor : keeps hot log sites from flooding the log once DEBUG is enabled.
+// - LogSite samples a call site, logging its first N messages and then every Mth one;
+// - LogRateLimiter is a token bucket, limiting a module to a number of messages per second;
+// - LogDeduplicator replaces identical consecutive lines of a thread with a repeat count.
+// Each of them passes everything when its limit is 0 (the default).
+
+class LogSite
+{
+public:
+	constexpr LogSite() : m_Count(0) {}
+
+	// Returns true if this message of the site should be logged
+	inline bool Sample(uint32_t First, uint32_t Every)
+	{
+		if (First == 0 && Every == 0) {
+			return true;
+		}
+
+		uint32_t Count = m_Count.fetch_add(1, std::memory_order_relaxed);
+		if (Count < First) {
+			return true;
+		}
+
+		return Every != 0 && ((Count - First + 1) % Every) == 0;
+	}
+
+private:
+	std::atomic<uint32_t> m_Count;
+};
+
+// Outcome of the rate limit for one logged call, so its result is only logged along with its arguments
+enum class LogAdmission : uint8_t {
+	Unchecked = 0,
+	Admitted,
+	Refused,
+};
+
+// Rate limits a module can be set to, stored as the 4 bit index of the step (0 : no limit)
+constexpr uint32_t LOG_RATE_LIMIT_STEPS[16] = { 0, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000 };
+
+// Gives each expansion its own static LogSite, as every lambda has a distinct type
+#define LOG_SITE() ([]() -> LogSite& { static LogSite _logSite; return _logSite; }())
+
+class LogRateLimiter
+{
+public:
+	constexpr LogRateLimiter() : m_Tokens(0), m_LastRefill(0), m_Suppressed(0) {}
+
+	// Returns true if a message may pass at most Rate messages per second, with a burst of
+	// one second worth of messages. Now is a steady clock time in nanoseconds
+	bool Admit(uint32_t Rate, uint64_t Now);
+	// Returns the number of messages refused since the previous call
+	uint32_t TakeSuppressed() { return m_Suppressed.exchange(0, std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> m_Tokens; // scaled by LOG_TOKEN_COST, so a refill needs no division
+	std::atomic<uint64_t> m_LastRefill;
+	std::atomic<uint32_t> m_Suppressed;
+};
+
+// Repeats are reported at least this often during a long run of identical lines
+constexpr uint32_t LOG_DEDUPLICATE_REPORT_EVERY = 1000;
+
+class LogDeduplicator
+{
+public:
+	typedef struct {
+		uint32_t Module;
+		uint32_t Level;
+		uint32_t Count; // 0 if there's nothing to report
+	} Repeats;
+
+	// Returns true if Text differs from the previous message (and should be logged). When
+	// repeats of the previous message must be reported first, they're returned in Report
+	bool Check(uint32_t Module, uint32_t Level, const char* Text, size_t Length, Repeats& Report);
+	// Returns the repeats not reported yet in Report, the next identical message counts from 1 again
+	void TakeRepeats(Repeats& Report);
+
+private:
+	uint32_t m_Module = UINT32_MAX;
+	uint32_t m_Level = UINT32_MAX;
+	uint32_t m_Repeats = 0;
+	std::string m_Text;
+};
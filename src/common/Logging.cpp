@@ -26,6 +26,9 @@
 // ******************************************************************
 
 #include <windows.h> // for PULONG
+#include <algorithm> // for std::find
+#include <chrono> // for std::chrono::steady_clock
+#include <mutex> // for std::mutex
 
 #include "Logging.h"
 #include "common\Settings.hpp"
@@ -103,6 +106,11 @@ const char* g_EnumModules2String[to_underlying(CXBXR_MODULE::MAX)] = {
 };
 std::atomic_int g_CurrentLogLevel = to_underlying(LOG_LEVEL::INFO);
 std::atomic_bool g_CurrentLogPopupTestCase = true;
+std::atomic_uint g_LogSampleFirst = 0;
+std::atomic_uint g_LogSampleEvery = 0;
+std::atomic_uint g_LogRateLimit[to_underlying(CXBXR_MODULE::MAX)] = { 0 };
+std::atomic_bool g_LogDeduplicate = false;
+static LogRateLimiter g_LogRateLimiters[to_underlying(CXBXR_MODULE::MAX)];
 static bool g_disablePopupMessages = false;
 
 const char log_debug[] = "DEBUG: ";
@@ -112,9 +120,63 @@ const char log_error[] = "ERROR: ";
 const char log_fatal[] = "FATAL: ";
 const char log_unkwn[] = "???? : ";
 
+// The binary log identifies format strings by their address, so only formats in the read-only
+// sections of this module can be sent as is. Others (like std::string::c_str) are formatted first.
+static bool log_is_read_only_string(const char *str)
+{
+	typedef struct { uintptr_t Begin, End; } ReadOnlyRange;
+	static const std::vector<ReadOnlyRange> ranges = [] {
+		std::vector<ReadOnlyRange> ranges;
+		HMODULE hModule;
+		if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&log_is_read_only_string, &hModule)) {
+			PIMAGE_NT_HEADERS pNtHeaders = (PIMAGE_NT_HEADERS)((uint8_t *)hModule + ((PIMAGE_DOS_HEADER)hModule)->e_lfanew);
+			PIMAGE_SECTION_HEADER pSection = IMAGE_FIRST_SECTION(pNtHeaders);
+			for (WORD i = 0; i < pNtHeaders->FileHeader.NumberOfSections; i++, pSection++) {
+				if ((pSection->Characteristics & IMAGE_SCN_MEM_WRITE) == 0) {
+					uintptr_t Begin = (uintptr_t)hModule + pSection->VirtualAddress;
+					ranges.push_back({ Begin, Begin + pSection->Misc.VirtualSize });
+				}
+			}
+		}
+		return ranges;
+	}();
+
+	for (const auto &range : ranges) {
+		if ((uintptr_t)str >= range.Begin && (uintptr_t)str < range.End) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void EmuLogOutputBinary(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarningMessage, const va_list argp)
+{
+	if (log_is_read_only_string(szWarningMessage)) {
+		BinaryLog_WriteArgs(GetCurrentThreadId(), (uint8_t)cxbxr_module, (uint8_t)level, szWarningMessage, argp);
+		return;
+	}
+
+	va_list argp_size;
+	va_copy(argp_size, argp);
+	int length = vsnprintf(nullptr, 0, szWarningMessage, argp_size);
+	va_end(argp_size);
+	if (length < 0) {
+		return;
+	}
+
+	std::string message(length, '\0');
+	vsnprintf(&message[0], message.size() + 1, szWarningMessage, argp);
+	BinaryLog_WriteText(GetCurrentThreadId(), (uint8_t)cxbxr_module, (uint8_t)level, BinaryLogType::Line, message.c_str(), message.size());
+}
+
 // Do not use EmuLogOutput function outside of this file.
 void EmuLogOutput(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarningMessage, const va_list argp)
 {
+	if (g_BinaryLogEnabled.load(std::memory_order_relaxed)) {
+		EmuLogOutputBinary(cxbxr_module, level, szWarningMessage, argp);
+		return;
+	}
+
 	LOG_THREAD_INIT;
 
 	const char* level_str;
@@ -148,6 +210,17 @@ void EmuLogOutput(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarn
 
 	fflush(stdout);
 }
+
+void EmuLogOutputText(const CXBXR_MODULE cxbxr_module, const LOG_LEVEL level, const std::string& text)
+{
+	if (g_BinaryLogEnabled.load(std::memory_order_relaxed)) {
+		BinaryLog_WriteText(GetCurrentThreadId(), (uint8_t)cxbxr_module, (uint8_t)level, BinaryLogType::Raw, text.c_str(), text.size());
+		return;
+	}
+
+	std::cout << text;
+}
+
 inline void EmuLogOutputEx(const CXBXR_MODULE cxbxr_module, const LOG_LEVEL level, const char *szWarningMessage, ...)
 {
 	va_list argp;
@@ -156,6 +229,112 @@ inline void EmuLogOutputEx(const CXBXR_MODULE cxbxr_module, const LOG_LEVEL leve
 	va_end(argp);
 }
 
+bool log_rate_admit(const CXBXR_MODULE cxbxr_module)
+{
+	LogRateLimiter& limiter = g_LogRateLimiters[to_underlying(cxbxr_module)];
+	unsigned int rate = g_LogRateLimit[to_underlying(cxbxr_module)];
+	uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	if (!limiter.Admit(rate, now)) {
+		return false;
+	}
+
+	uint32_t suppressed = limiter.TakeSuppressed();
+	if (suppressed > 0) {
+		EmuLogOutputEx(cxbxr_module, LOG_LEVEL::WARNING, "%u messages were suppressed by the rate limit of %u per second", suppressed, rate);
+	}
+	return true;
+}
+
+// Deduplicator of one thread. The repeats it still holds back are reported when the thread
+// exits, and for all threads by log_flush_repeats
+class LogThreadDeduplicator
+{
+public:
+	LogThreadDeduplicator();
+	~LogThreadDeduplicator();
+
+	std::mutex Mutex; // Taken by the owning thread and by log_flush_repeats
+	LogDeduplicator Deduplicator;
+	uint32_t ThreadId;
+};
+
+static std::mutex g_LogDeduplicatorsMtx;
+static std::vector<LogThreadDeduplicator*> g_LogDeduplicators;
+
+LogThreadDeduplicator::LogThreadDeduplicator()
+{
+	// The report in the destructor still needs the binary log state of this thread
+	BinaryLog_InitThread();
+	ThreadId = GetCurrentThreadId();
+
+	std::lock_guard<std::mutex> lock(g_LogDeduplicatorsMtx);
+	g_LogDeduplicators.push_back(this);
+}
+
+LogThreadDeduplicator::~LogThreadDeduplicator()
+{
+	{
+		std::lock_guard<std::mutex> lock(g_LogDeduplicatorsMtx);
+		g_LogDeduplicators.erase(std::find(g_LogDeduplicators.begin(), g_LogDeduplicators.end(), this));
+	}
+
+	LogDeduplicator::Repeats report;
+	Deduplicator.TakeRepeats(report);
+	if (report.Count > 0) {
+		EmuLogOutputEx((CXBXR_MODULE)report.Module, (LOG_LEVEL)report.Level, "Last message repeated %u times", report.Count);
+	}
+}
+
+void log_flush_repeats()
+{
+	std::lock_guard<std::mutex> lock(g_LogDeduplicatorsMtx);
+
+	for (auto deduplicator : g_LogDeduplicators) {
+		LogDeduplicator::Repeats report;
+		{
+			std::lock_guard<std::mutex> thread_lock(deduplicator->Mutex);
+			deduplicator->Deduplicator.TakeRepeats(report);
+		}
+		if (report.Count > 0) {
+			EmuLogOutputEx((CXBXR_MODULE)report.Module, (LOG_LEVEL)report.Level, "Last message of thread 0x%04X repeated %u times", deduplicator->ThreadId, report.Count);
+		}
+	}
+}
+
+// Formats the message to compare it with the previous one of this thread, identical ones are only counted
+static void EmuLogOutputDeduplicated(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarningMessage, const va_list argp)
+{
+	thread_local std::vector<char> buffer(256);
+	thread_local LogThreadDeduplicator deduplicator;
+
+	va_list argp_copy;
+	va_copy(argp_copy, argp);
+	int length = vsnprintf(buffer.data(), buffer.size(), szWarningMessage, argp_copy);
+	va_end(argp_copy);
+	if (length < 0) {
+		return;
+	}
+	if ((size_t)length >= buffer.size()) {
+		buffer.resize(length + 1);
+		vsnprintf(buffer.data(), buffer.size(), szWarningMessage, argp);
+	}
+
+	LogDeduplicator::Repeats report;
+	bool is_new;
+	{
+		std::lock_guard<std::mutex> lock(deduplicator.Mutex);
+		is_new = deduplicator.Deduplicator.Check(to_underlying(cxbxr_module), to_underlying(level), buffer.data(), length, report);
+	}
+	if (report.Count > 0) {
+		EmuLogOutputEx((CXBXR_MODULE)report.Module, (LOG_LEVEL)report.Level, "Last message repeated %u times", report.Count);
+	}
+	if (is_new) {
+		LOG_CHECK_RATE_EX(cxbxr_module) {
+			EmuLogOutputEx(cxbxr_module, level, "%s", buffer.data());
+		}
+	}
+}
+
 // print out a custom message to the console or kernel debug log file
 void NTAPI EmuLogEx(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarningMessage, ...)
 {
@@ -171,7 +350,12 @@ void NTAPI EmuLogEx(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWa
 			va_list argp;
 			va_start(argp, szWarningMessage);
 
-			EmuLogOutput(cxbxr_module, level, szWarningMessage, argp);
+			if (g_LogDeduplicate) {
+				EmuLogOutputDeduplicated(cxbxr_module, level, szWarningMessage, argp);
+			}
+			else LOG_CHECK_RATE_EX(cxbxr_module) {
+				EmuLogOutput(cxbxr_module, level, szWarningMessage, argp);
+			}
 
 			va_end(argp);
 		}
@@ -196,6 +380,7 @@ void NTAPI EmuLogInit(LOG_LEVEL level, const char *szWarningMessage, ...)
 inline void log_get_settings()
 {
 	log_set_config(g_Settings->m_core.LogLevel, g_Settings->m_core.LoggedModules, g_Settings->m_core.bLogPopupTestCase);
+	log_set_governor(g_Settings->m_core.LogSampleFirst, g_Settings->m_core.LogSampleEvery, g_Settings->m_core.LogRateLimits, g_Settings->m_core.bLogDeduplicate);
 }
 
 inline void log_sync_config()
@@ -207,6 +392,14 @@ inline void log_sync_config()
 	g_EmuShared->GetLogModules(LoggedModules);
 	g_EmuShared->GetLogPopupTestCase(&LogPopupTestCase);
 	log_set_config(LogLevel, LoggedModules, LogPopupTestCase);
+
+	unsigned int LogSampleFirst, LogSampleEvery;
+	unsigned int LogRateLimits[NUM_INTEGERS_LOG_RATE];
+	bool LogDeduplicate;
+	g_EmuShared->GetLogSampling(&LogSampleFirst, &LogSampleEvery);
+	g_EmuShared->GetLogRateLimits(LogRateLimits);
+	g_EmuShared->GetLogDeduplicate(&LogDeduplicate);
+	log_set_governor(LogSampleFirst, LogSampleEvery, LogRateLimits, LogDeduplicate);
 }
 
 void log_set_config(int LogLevel, unsigned int* LoggedModules, bool LogPopupTestCase)
@@ -223,6 +416,35 @@ void log_set_config(int LogLevel, unsigned int* LoggedModules, bool LogPopupTest
 	g_CurrentLogPopupTestCase = LogPopupTestCase;
 }
 
+// Each module has its own rate limit, see log_get_rate_step
+void log_set_governor(unsigned int LogSampleFirst, unsigned int LogSampleEvery, unsigned int* LogRateLimits, bool LogDeduplicate)
+{
+	g_LogSampleFirst = LogSampleFirst;
+	g_LogSampleEvery = LogSampleEvery;
+	for (unsigned int index = to_underlying(CXBXR_MODULE::CXBXR); index < to_underlying(CXBXR_MODULE::MAX); index++) {
+		g_LogRateLimit[index] = LOG_RATE_LIMIT_STEPS[log_get_rate_step(LogRateLimits, (CXBXR_MODULE)index)];
+	}
+	// Repeats counted so far are reported now, instead of when the message changes
+	if (g_LogDeduplicate.exchange(LogDeduplicate) && !LogDeduplicate) {
+		log_flush_repeats();
+	}
+}
+
+static_assert(to_underlying(CXBXR_MODULE::MAX) <= NUM_INTEGERS_LOG_RATE * 8, "Every module needs its 4 bits in LogRateLimits");
+
+unsigned int log_get_rate_step(const unsigned int* LogRateLimits, const CXBXR_MODULE cxbxr_module)
+{
+	unsigned int index = to_underlying(cxbxr_module);
+	return (LogRateLimits[index / 8] >> ((index % 8) * 4)) & 0xF;
+}
+
+void log_set_rate_step(unsigned int* LogRateLimits, const CXBXR_MODULE cxbxr_module, unsigned int step)
+{
+	unsigned int index = to_underlying(cxbxr_module);
+	LogRateLimits[index / 8] &= ~(0xFu << ((index % 8) * 4));
+	LogRateLimits[index / 8] |= (step & 0xF) << ((index % 8) * 4);
+}
+
 // Generate active log filter output.
 void log_generate_active_filter_output(const CXBXR_MODULE cxbxr_module)
 {
@@ -231,6 +453,11 @@ void log_generate_active_filter_output(const CXBXR_MODULE cxbxr_module)
 
 	std::cout << generic_output_str << "Current log level: " << g_CurrentLogLevel << std::endl;
 
+	if (g_LogSampleFirst || g_LogSampleEvery || g_LogRateLimit[to_underlying(cxbxr_module)] || g_LogDeduplicate) {
+		std::cout << generic_output_str << "Log governor: sampled sites log " << g_LogSampleFirst << " then every " << g_LogSampleEvery
+			<< ", rate limit " << g_LogRateLimit[to_underlying(cxbxr_module)] << "/s, deduplicate " << (g_LogDeduplicate ? "on" : "off") << std::endl;
+	}
+
 	generic_output_str.append("Active log filter: ");
 	for (unsigned int index = to_underlying(CXBXR_MODULE::CXBXR); index < to_underlying(CXBXR_MODULE::MAX); index++) {
 		if (g_EnabledModules[index]) {
@@ -248,6 +475,14 @@ void log_init_popup_msg()
 	g_disablePopupMessages = vSettings.bFullScreen;
 }
 
+bool log_init_binary(const std::string& file_path, bool append)
+{
+	std::vector<std::string> module_names(std::begin(g_EnumModules2String), std::end(g_EnumModules2String));
+	std::vector<std::string> level_names = { log_debug, log_info, log_warn, log_error, log_fatal };
+
+	return BinaryLog_Open(file_path, append, module_names, level_names);
+}
+
 // TODO: Move PopupPlatformHandler into common GUI's window source code or use imgui in the future.
 // PopupPlatformHandler is intended to be use as internal wrapper function.
 static PopupReturn PopupPlatformHandler(const char* msg, const PopupReturn ret_default, const UINT uType, const HWND hWnd)
@@ -330,7 +565,7 @@ PopupReturn PopupCustomEx(const void* hwnd, const CXBXR_MODULE cxbxr_module, con
 	vsnprintf(Buffer.data(), Buffer.size(), message, argp);
 	va_end(argp);
 
-	EmuLogOutputEx(cxbxr_module, level, "Popup : %s", Buffer);
+	EmuLogOutputEx(cxbxr_module, level, "Popup : %s", Buffer.data());
 
 	// If user is using exclusive fullscreen, we need to refrain all popups.
 	if (g_disablePopupMessages) {
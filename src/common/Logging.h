@@ -31,7 +31,10 @@
 #include <iostream> // For std::cout
 #include <iomanip> // For std::setw
 #include <atomic> // For atomic_bool and atomic_uint
+#include <optional> // For std::optional
 #include "common\util\CxbxUtil.h" // For g_bPrintfOn and to_underlying
+#include "common\BinaryLog.h" // For g_BinaryLogEnabled
+#include "common\LogGovernor.h" // For LogSite
 
 // NOTE: using ERROR2 since windows.h imports an ERROR macro which would conflict otherwise
 typedef enum class _LOG_LEVEL {
@@ -117,6 +120,11 @@ extern std::atomic_bool g_EnabledModules[to_underlying(CXBXR_MODULE::MAX)];
 extern const char* g_EnumModules2String[to_underlying(CXBXR_MODULE::MAX)];
 extern std::atomic_int g_CurrentLogLevel;
 extern std::atomic_bool g_CurrentLogPopupTestCase;
+// Log governor, 0 (or false) disables each of these
+extern std::atomic_uint g_LogSampleFirst; // sampled sites log their first messages...
+extern std::atomic_uint g_LogSampleEvery; // ...then every Mth message
+extern std::atomic_uint g_LogRateLimit[to_underlying(CXBXR_MODULE::MAX)]; // messages per second, one of LOG_RATE_LIMIT_STEPS
+extern std::atomic_bool g_LogDeduplicate; // replace identical consecutive lines of a thread by a repeat count
 
 // print out a log message to the console or kernel debug log file if level is high enough
 void NTAPI EmuLogEx(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarningMessage, ...);
@@ -124,12 +132,28 @@ void NTAPI EmuLogInit(LOG_LEVEL level, const char *szWarningMessage, ...);
 
 #define EmuLog(level, fmt, ...) EmuLogEx(LOG_PREFIX, level, fmt, ##__VA_ARGS__)
 
+// Use EmuLogSampled for hot sites (per packet, per draw, ...), see LOG_CHECK_SAMPLED
+#define EmuLogSampled(level, fmt, ...) do { LOG_CHECK_SAMPLED(level) EmuLogEx(LOG_PREFIX, level, fmt, ##__VA_ARGS__); } while (0)
+
 extern inline void log_get_settings();
 
 extern inline void log_sync_config();
 
 void log_set_config(int LogLevel, unsigned int* LoggedModules, bool LogPopupTestCase);
 
+void log_set_governor(unsigned int LogSampleFirst, unsigned int LogSampleEvery, unsigned int* LogRateLimits, bool LogDeduplicate);
+
+// LogRateLimits holds the LOG_RATE_LIMIT_STEPS index of each module, 4 bits per module
+unsigned int log_get_rate_step(const unsigned int* LogRateLimits, const CXBXR_MODULE cxbxr_module);
+
+void log_set_rate_step(unsigned int* LogRateLimits, const CXBXR_MODULE cxbxr_module, unsigned int step);
+
+// Reports the repeats that deduplication still holds back, for every thread
+void log_flush_repeats();
+
+// Takes a token of the rate limit of the module, see LOG_CHECK_RATE_EX
+bool log_rate_admit(const CXBXR_MODULE cxbxr_module);
+
 void log_generate_active_filter_output(const CXBXR_MODULE cxbxr_module);
 
 // Use emulation environment to manage popup messages
@@ -137,6 +161,14 @@ void log_generate_active_filter_output(const CXBXR_MODULE cxbxr_module);
 // Then users will have a chance of popup message appear during start of emulation in full screen.
 void log_init_popup_msg();
 
+// Opens the binary log, which then receives all log output instead of the console.
+// After a reboot, append adds to the log of the previous boot instead of replacing it.
+// BinaryLog_Close (or the exit of the process) writes out the remaining records.
+bool log_init_binary(const std::string& file_path, bool append);
+
+// Writes text rendered by the function logging macros to the console, or to the binary log when open
+void EmuLogOutputText(const CXBXR_MODULE cxbxr_module, const LOG_LEVEL level, const std::string& text);
+
 typedef enum class _PopupIcon {
 	Unknown = 0,
 	Question,
@@ -336,6 +368,142 @@ extern thread_local std::string _logThreadPrefix;
 // Checks if this log should be printed or not
 #define LOG_CHECK_ENABLED(level) \
 	LOG_CHECK_ENABLED_EX(LOG_PREFIX, level)
+
+// Checks if this log should be printed, and samples the call site : it logs the first
+// g_LogSampleFirst messages, and then every g_LogSampleEvery-th message
+#define LOG_CHECK_SAMPLED_EX(cxbxr_module, level) \
+	LOG_CHECK_ENABLED_EX(cxbxr_module, level) if (LOG_SITE().Sample(g_LogSampleFirst, g_LogSampleEvery))
+
+#define LOG_CHECK_SAMPLED(level) \
+	LOG_CHECK_SAMPLED_EX(LOG_PREFIX, level)
+
+// Checks the rate limit of the module, which costs a single load when it has none
+#define LOG_CHECK_RATE_EX(cxbxr_module) \
+	if (g_LogRateLimit[to_underlying(cxbxr_module)].load(std::memory_order_relaxed) == 0 || log_rate_admit(cxbxr_module))
+
+// Checks the rate limit once per logged call : the result of the call follows what happened to its
+// arguments (see LOG_FUNC_BEGIN), and only takes a token of its own when the arguments weren't logged
+inline bool log_rate_admit_call(const CXBXR_MODULE cxbxr_module, LogAdmission& admission)
+{
+	if (admission == LogAdmission::Unchecked) {
+		LOG_CHECK_RATE_EX(cxbxr_module) {
+			admission = LogAdmission::Admitted;
+		}
+		else {
+			admission = LogAdmission::Refused;
+		}
+	}
+	return admission == LogAdmission::Admitted;
+}
+
+#define LOG_CHECK_RATE_CALL_EX(cxbxr_module) \
+	if (log_rate_admit_call(cxbxr_module, _logFuncAdmission))
+
+// Writes a << rendered expression to the console, or to the binary log when open
+#define LOG_OUTPUT(cxbxr_module, level, expr) \
+	do { \
+		if (g_BinaryLogEnabled.load(std::memory_order_relaxed)) { \
+			std::stringstream _logOutput; \
+			_logOutput << expr; \
+			EmuLogOutputText(cxbxr_module, level, _logOutput.str()); \
+		} \
+		else { \
+			std::cout << expr; \
+		} \
+	} while (0)
+
+// Records the sanitized types in the binary log the way their << operators render them
+inline bool BinaryLog_CallArgValue(const char* name, bool out, const Sanehex1& value) { BinaryLog_CallArg(name, out, BINARY_LOG_ARG_HEX8, value.value); return true; }
+inline bool BinaryLog_CallArgValue(const char* name, bool out, const Sanehex2& value) { BinaryLog_CallArg(name, out, BINARY_LOG_ARG_HEX16, value.value); return true; }
+inline bool BinaryLog_CallArgValue(const char* name, bool out, const Sanehex4& value) { BinaryLog_CallArg(name, out, BINARY_LOG_ARG_HEX32, value.value); return true; }
+inline bool BinaryLog_CallArgValue(const char* name, bool out, const Sanesanitized_char_pointer& value) { BinaryLog_CallArgString(name, out, value.value, value.max); return true; }
+inline bool BinaryLog_CallArgValue(const char* name, bool out, const Sanesanitized_wchar_pointer& value) { BinaryLog_CallArgWString(name, out, value.value, value.max); return true; }
+
+// Records an argument of the binary log that has no binary kind, as rendered by its << operator
+template<class R>
+inline void log_binary_arg_text(const char* name, bool out, R render)
+{
+	std::stringstream text;
+	render(text);
+	const std::string rendered = text.str();
+	BinaryLog_CallArgText(name, out, rendered.data(), rendered.size());
+}
+
+// Collects the arguments of a logged function call (see LOG_FUNC_BEGIN). With the binary log open,
+// they're recorded as words, and only types without a binary kind are rendered by their << operator.
+// Rendering is done by a lambda of the logging function, which sees the << operators of its namespace
+class LogFuncCall
+{
+public:
+	LogFuncCall(const CXBXR_MODULE cxbxr_module, const char* func, const std::string& func_prefix)
+		: m_module(cxbxr_module), m_binary(g_BinaryLogEnabled.load(std::memory_order_relaxed))
+	{
+		if (m_binary) {
+			BinaryLog_BeginCall(GetCurrentThreadId(), (uint8_t)cxbxr_module, (uint8_t)LOG_LEVEL::DEBUG, func, false);
+		}
+		else {
+			m_msg.emplace();
+			*m_msg << _logThreadPrefix << func_prefix << "(";
+		}
+	}
+
+	template<class T, class R>
+	void Arg(const char* name, bool out, const T& value, R render)
+	{
+		m_had_arg = true;
+		if (m_binary) {
+			if (!BinaryLog_CallArgValue(name, out, value)) {
+				log_binary_arg_text(name, out, render);
+			}
+			return;
+		}
+
+		if (out) {
+			*m_msg << LOG_ARG_OUT_START;
+		}
+		else {
+			*m_msg << LOG_ARG_START;
+		}
+		render(*m_msg << name << " : ");
+	}
+
+	void End()
+	{
+		if (m_binary) {
+			BinaryLog_EndCall();
+			return;
+		}
+
+		if (m_had_arg) *m_msg << "\n";
+		*m_msg << ");\n";
+		EmuLogOutputText(m_module, LOG_LEVEL::DEBUG, m_msg->str());
+	}
+
+private:
+	const CXBXR_MODULE m_module;
+	const bool m_binary;
+	bool m_had_arg = false;
+	std::optional<std::stringstream> m_msg; // only constructed for the console
+};
+
+// Logs the value a function returns, see LOG_FUNC_RESULT
+template<class T, class R>
+inline void log_func_result(const CXBXR_MODULE cxbxr_module, const char* func, const std::string& func_prefix, const T& value, R render)
+{
+	if (g_BinaryLogEnabled.load(std::memory_order_relaxed)) {
+		BinaryLog_BeginCall(GetCurrentThreadId(), (uint8_t)cxbxr_module, (uint8_t)LOG_LEVEL::DEBUG, func, true);
+		if (!BinaryLog_CallArgValue(nullptr, false, value)) {
+			log_binary_arg_text(nullptr, false, render);
+		}
+		BinaryLog_EndCall();
+	}
+	else {
+		render(std::cout << _logThreadPrefix << func_prefix << " returns ") << "\n";
+	}
+}
+
+// Renders an expression with the << operators visible where it's logged
+#define LOG_RENDER(expr) [&](std::ostream& _logOs) -> std::ostream& { return _logOs << expr; }
 
 #define LOG_THREAD_INIT \
 	if (_logThreadPrefix.length() == 0) { \
@@ -345,6 +513,7 @@ extern thread_local std::string _logThreadPrefix;
     }
 
 #define LOG_FUNC_INIT(func) \
+	static const char* const _logFuncName = (func != nullptr ? remove_emupatch_prefix(func) : ""); \
 	static thread_local std::string _logFuncPrefix; \
 	if (_logFuncPrefix.length() == 0) {	\
 		std::stringstream tmp; \
@@ -354,59 +523,57 @@ extern thread_local std::string _logThreadPrefix;
 
 #define LOG_INIT \
 	LOG_THREAD_INIT \
-	LOG_FUNC_INIT(__func__)
+	LOG_FUNC_INIT(__func__) \
+	LogAdmission _logFuncAdmission = LogAdmission::Unchecked;
 
 #define LOG_FINIT \
 	_logFuncPrefix.clear(); // Reset prefix, to show caller changes
 
 #define LOG_FUNC_BEGIN_NO_INIT \
 	do { if(g_bPrintfOn) { \
-		bool _had_arg = false; \
-		std::stringstream msg; \
-		msg << _logThreadPrefix << _logFuncPrefix << "(";
+		LogFuncCall _logCall(LOG_PREFIX, _logFuncName, _logFuncPrefix);
 
 #define LOG_FUNC_BEGIN \
 		LOG_INIT \
-		LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { \
+		LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) LOG_CHECK_RATE_CALL_EX(LOG_PREFIX) { \
 			LOG_FUNC_BEGIN_NO_INIT
 
 // LOG_FUNC_ARG writes output via all available ostream << operator overloads, sanitizing and adding detail where possible
 #define LOG_FUNC_ARG(arg) \
-		_had_arg = true; \
-		msg << LOG_ARG_START << #arg << " : " << _log_sanitize(arg);
+		_logCall.Arg(#arg, false, _log_sanitize(arg), LOG_RENDER(_log_sanitize(arg)));
 
 // LOG_FUNC_ARG_TYPE writes output using the overloaded << operator of the given type
 #define LOG_FUNC_ARG_TYPE(type, arg) \
-		_had_arg = true; \
-		msg << LOG_ARG_START << #arg << " : " << (type)arg;
+		_logCall.Arg(#arg, false, (type)arg, LOG_RENDER((type)arg));
 
 // LOG_FUNC_ARG_OUT prevents expansion of types, by only rendering as a pointer
 #define LOG_FUNC_ARG_OUT(arg) \
-		_had_arg = true; \
-		msg << LOG_ARG_OUT_START << #arg << " : " << hex4((uint32_t)arg);
+		_logCall.Arg(#arg, true, hex4((uint32_t)arg), LOG_RENDER(hex4((uint32_t)arg)));
 
 // LOG_FUNC_END closes off function and optional argument logging
 #define LOG_FUNC_END \
-			if (_had_arg) msg << "\n"; \
-			msg << ");\n"; \
-			std::cout << msg.str(); \
+			_logCall.End(); \
 		} } while (0); \
 	}
 
-// LOG_FUNC_RESULT logs the function return result
+// LOG_FUNC_RESULT logs the function return result, unless the rate limit dropped the arguments
 #define LOG_FUNC_RESULT(r) \
-	std::cout << _logThreadPrefix << _logFuncPrefix << " returns " << _log_sanitize(r) << "\n";
+	LOG_CHECK_RATE_CALL_EX(LOG_PREFIX) { \
+		log_func_result(LOG_PREFIX, _logFuncName, _logFuncPrefix, _log_sanitize(r), LOG_RENDER(_log_sanitize(r))); \
+	}
 
 // LOG_FUNC_RESULT_TYPE logs the function return result using the overloaded << operator of the given type
 #define LOG_FUNC_RESULT_TYPE(type, r) \
-	std::cout << _logThreadPrefix << _logFuncPrefix << " returns " << (type)r << "\n";
+	LOG_CHECK_RATE_CALL_EX(LOG_PREFIX) { \
+		log_func_result(LOG_PREFIX, _logFuncName, _logFuncPrefix, (type)r, LOG_RENDER((type)r)); \
+	}
 
 // LOG_FORWARD indicates that an api is implemented by a forward to another API
 #define LOG_FORWARD(api) \
 	LOG_INIT \
 	LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { \
 		do { if(g_bPrintfOn) { \
-			std::cout << _logThreadPrefix << _logFuncPrefix << " forwarding to "#api"...\n"; \
+			LOG_OUTPUT(LOG_PREFIX, LOG_LEVEL::DEBUG, _logThreadPrefix << _logFuncPrefix << " forwarding to "#api"...\n"); \
 		} } while (0); \
 	}
 
@@ -418,7 +585,7 @@ extern thread_local std::string _logThreadPrefix;
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
-					std::cout << _logThreadPrefix << "WARN: " << _logFuncPrefix << " ignored!\n"; \
+					LOG_OUTPUT(LOG_PREFIX, LOG_LEVEL::INFO, _logThreadPrefix << "WARN: " << _logFuncPrefix << " ignored!\n"); \
 					b_echoOnce = false; \
 				} \
 			} \
@@ -432,7 +599,7 @@ extern thread_local std::string _logThreadPrefix;
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
-					std::cout << _logThreadPrefix << "WARN: " << _logFuncPrefix << " unimplemented!\n"; \
+					LOG_OUTPUT(LOG_PREFIX, LOG_LEVEL::INFO, _logThreadPrefix << "WARN: " << _logFuncPrefix << " unimplemented!\n"); \
 					b_echoOnce = false; \
 				} \
 			} \
@@ -446,7 +613,7 @@ extern thread_local std::string _logThreadPrefix;
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
-					std::cout << _logThreadPrefix << "WARN: " << _logFuncPrefix << " incomplete!\n"; \
+					LOG_OUTPUT(LOG_PREFIX, LOG_LEVEL::INFO, _logThreadPrefix << "WARN: " << _logFuncPrefix << " incomplete!\n"); \
 					b_echoOnce = false; \
 				} \
 			} \
@@ -460,7 +627,7 @@ extern thread_local std::string _logThreadPrefix;
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
-					std::cout << _logThreadPrefix << "WARN: " << _logFuncPrefix << " not supported!\n"; \
+					LOG_OUTPUT(LOG_PREFIX, LOG_LEVEL::INFO, _logThreadPrefix << "WARN: " << _logFuncPrefix << " not supported!\n"); \
 					b_echoOnce = false; \
 				} \
 			} \
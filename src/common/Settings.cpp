@@ -97,6 +97,11 @@ static struct {
 	const char* LogLevel = "LogLevel";
 	const char* LoaderExecutable = "LoaderExecutable";
 	const char* LogPopupTestCase = "LogPopupTestCase";
+	const char* LogBinary = "LogBinary";
+	const char* LogSampleFirst = "LogSampleFirst";
+	const char* LogSampleEvery = "LogSampleEvery";
+	const char* LogRateLimits = "LogRateLimits";
+	const char* LogDeduplicate = "LogDeduplicate";
 } sect_core_keys;
 
 static const char* section_video = "video";
@@ -118,6 +123,8 @@ static struct {
 	const char* codec_xadpcm = "XADPCM";
 	const char* codec_unknown = "UnknownCodec";
 	const char* mute_on_unfocus = "MuteOnUnfocus";
+	const char* output = "Output";
+	const char* capture_trace = "CaptureTrace";
 } sect_audio_keys;
 
 static const char* section_network = "network";
@@ -362,6 +369,34 @@ bool Settings::LoadConfig()
 	}
 	m_core.bLogPopupTestCase = m_si.GetBoolValue(section_core, sect_core_keys.LogPopupTestCase, /*Default=*/true);
 
+	m_core.bLogBinary = m_si.GetBoolValue(section_core, sect_core_keys.LogBinary, /*Default=*/false);
+
+	m_core.LogSampleFirst = (unsigned short)m_si.GetLongValue(section_core, sect_core_keys.LogSampleFirst, /*Default=*/0);
+	m_core.LogSampleEvery = (unsigned short)m_si.GetLongValue(section_core, sect_core_keys.LogSampleEvery, /*Default=*/0);
+	si_list.clear();
+	index = 0;
+	list_max = std::size(m_core.LogRateLimits);
+	bRet = m_si.GetAllValues(section_core, sect_core_keys.LogRateLimits, si_list);
+	if (bRet) {
+		si_list_iterator = si_list.begin();
+		for (si_list_iterator; si_list_iterator != si_list.end(); si_list_iterator++) {
+			// Exit loop when the list has reached the limit.
+			if (index == list_max) {
+				break;
+			}
+			if (std::strncmp(si_list_iterator->pItem, "0x", 2) == 0) {
+				si_list_iterator->pItem += 2;
+			}
+			m_core.LogRateLimits[index] = std::strtoul(si_list_iterator->pItem, nullptr, 16);
+			index++;
+		}
+	}
+	while (index < list_max) {
+		m_core.LogRateLimits[index] = 0;
+		index++;
+	}
+	m_core.bLogDeduplicate = m_si.GetBoolValue(section_core, sect_core_keys.LogDeduplicate, /*Default=*/false);
+
 	m_core.bUseLoaderExec = m_si.GetBoolValue(section_core, sect_core_keys.LoaderExecutable, /*Default=*/true);
 
 	// ==== Core End ============
@@ -421,6 +456,10 @@ bool Settings::LoadConfig()
 
 	m_audio.mute_on_unfocus = m_si.GetBoolValue(section_audio, sect_audio_keys.mute_on_unfocus, /*Default=*/true, nullptr);
 
+	m_audio.output = m_si.GetLongValue(section_audio, sect_audio_keys.output, /*Default=*/AUDIO_OUTPUT_HOST, nullptr);
+
+	m_audio.capture_trace = m_si.GetBoolValue(section_audio, sect_audio_keys.capture_trace, /*Default=*/false, nullptr);
+
 	// ==== Audio End ===========
 
 	// ==== Network Begin =======
@@ -543,6 +582,20 @@ bool Settings::Save(std::string file_path)
 	}
 	m_si.SetBoolValue(section_core, sect_core_keys.LogPopupTestCase, m_core.bLogPopupTestCase, nullptr, true);
 
+	m_si.SetBoolValue(section_core, sect_core_keys.LogBinary, m_core.bLogBinary, nullptr, true);
+
+	m_si.SetLongValue(section_core, sect_core_keys.LogSampleFirst, m_core.LogSampleFirst, nullptr, false, true);
+	m_si.SetLongValue(section_core, sect_core_keys.LogSampleEvery, m_core.LogSampleEvery, nullptr, false, true);
+	stream.str("");
+	stream << "0x" << std::hex << m_core.LogRateLimits[0];
+	m_si.SetValue(section_core, sect_core_keys.LogRateLimits, stream.str().c_str(), nullptr, true);
+	for (int i = 1; i < NUM_INTEGERS_LOG_RATE; i++) {
+		stream.str("");
+		stream << "0x" << std::hex << m_core.LogRateLimits[i];
+		m_si.SetValue(section_core, sect_core_keys.LogRateLimits, stream.str().c_str(), nullptr, false);
+	}
+	m_si.SetBoolValue(section_core, sect_core_keys.LogDeduplicate, m_core.bLogDeduplicate, nullptr, true);
+
 	m_si.SetBoolValue(section_core, sect_core_keys.LoaderExecutable, m_core.bUseLoaderExec, nullptr, true);
 
 	// ==== Core End ============
@@ -574,6 +627,10 @@ bool Settings::Save(std::string file_path)
 	m_si.SetBoolValue(section_audio, sect_audio_keys.codec_unknown, m_audio.codec_unknown, nullptr, true);
 	m_si.SetBoolValue(section_audio, sect_audio_keys.mute_on_unfocus, m_audio.mute_on_unfocus, nullptr, true);
 
+	m_si.SetLongValue(section_audio, sect_audio_keys.output, m_audio.output, nullptr, false, true);
+
+	m_si.SetBoolValue(section_audio, sect_audio_keys.capture_trace, m_audio.capture_trace, nullptr, true);
+
 	// ==== Audio End ===========
 
 	// ==== Network Begin =======
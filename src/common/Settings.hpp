@@ -57,6 +57,8 @@ typedef enum _CXBX_DATA {
 // * Define number of integers required to store logging settings
 // ******************************************************************
 #define NUM_INTEGERS_LOG 2
+// Rate limit of each module, a 4 bit step of LOG_RATE_LIMIT_STEPS
+#define NUM_INTEGERS_LOG_RATE (NUM_INTEGERS_LOG * 4)
 
 enum {
 	LLE_NONE = 0,
@@ -66,6 +68,13 @@ enum {
 	LLE_USB = 1 << 3,
 };
 
+// Where DirectSound HLE output goes.
+enum {
+	AUDIO_OUTPUT_HOST = 0,     // Host DirectSound device
+	AUDIO_OUTPUT_NULL = 1,     // Software mixer, output discarded
+	AUDIO_OUTPUT_WAV = 2,      // Software mixer, output written to Audio.wav in the data folder
+};
+
 class Settings
 {
 public:
@@ -104,8 +113,11 @@ public:
 		bool bUseLoaderExec;
 		bool allowAdminPrivilege;
 		bool bLogPopupTestCase;
-		bool Reserved4 = 0;
-		int  Reserved99[10] = { 0 };
+		bool bLogBinary; // Write the log to EmuLog.bin in the data folder, see BinaryLog_Decode
+		bool bLogDeduplicate; // Log governor, see g_LogDeduplicate
+		unsigned short LogSampleFirst; // see g_LogSampleFirst
+		unsigned short LogSampleEvery;
+		unsigned int LogRateLimits[NUM_INTEGERS_LOG_RATE]; // see g_LogRateLimit
 	} m_core;
 	static_assert(sizeof(s_core) == 0x24C, assert_check_shared_memory(s_core));
 
@@ -130,7 +142,9 @@ public:
 		bool codec_xadpcm;
 		bool codec_unknown;
 		bool mute_on_unfocus;
-		int  Reserved99[14] = { 0 };
+		int  output; // See AUDIO_OUTPUT_* above
+		bool capture_trace; // Record DirectSound calls to DSoundTrace.bin in the data folder
+		int  Reserved99[12] = { 0 };
 	} m_audio;
 	static_assert(sizeof(s_audio) == 0x4C, assert_check_shared_memory(s_audio));
 
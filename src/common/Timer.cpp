@@ -31,6 +31,8 @@
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <queue>
+#include <condition_variable>
 #include "Timer.h"
 #include "common\util\CxbxUtil.h"
 #include "core\kernel\init\CxbxKrnl.h"
@@ -49,8 +51,36 @@
 static std::vector<TimerObject*> TimerList;
 // The frequency of the high resolution clock of the host
 uint64_t HostClockFrequency;
-// Lock to acquire when accessing TimerList
-std::mutex TimerMtx;
+// Lock to acquire when accessing TimerList, TimerQueue and the scheduling state of the timers
+std::mutex TimerMtx;
+
+// A deadline queued in the timer service. Starting or cancelling a timer doesn't search the queue, it
+// bumps the generation of the timer instead, and the deadlines of older generations are dropped when popped
+struct TimerDeadline
+{
+	uint64_t Deadline_NS;
+	uint64_t Generation;
+	TimerObject* Timer;
+
+	bool operator>(const TimerDeadline& Other) const
+	{
+		return Deadline_NS > Other.Deadline_NS;
+	}
+};
+
+// Min-heap of the pending deadlines of all the timers
+static std::priority_queue<TimerDeadline, std::vector<TimerDeadline>, std::greater<TimerDeadline>> TimerQueue;
+static std::once_flag TimerServiceOnce;
+#ifdef _WIN32
+static HANDLE TimerServiceWaitable; // the service thread sleeps on this until the next deadline
+static HANDLE TimerServiceKick;     // signalled when a timer gets an earlier deadline than the one slept on
+#else
+static std::condition_variable* TimerServiceCv; // never freed, since the service thread waits on it until the process ends
+#endif
+
+
+// Converts the host clock to nanoseconds
+static ClockScale HostClockToNs;
 
 
 // Returns the current time of the timer
@@ -59,7 +89,7 @@ uint64_t GetTime_NS(TimerObject* Timer)
 #ifdef _WIN32
 	LARGE_INTEGER li;
 	QueryPerformanceCounter(&li);
-	uint64_t Ret = Muldiv64(li.QuadPart, SCALE_S_IN_NS, (uint32_t)HostClockFrequency);
+	uint64_t Ret = ClockScale_Convert(&HostClockToNs, li.QuadPart);
 #elif __linux__
 	static struct timespec ts;
 	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
@@ -77,11 +107,11 @@ static inline uint64_t GetNextExpireTime(TimerObject* Timer)
 }
 
 // Deallocates the memory of the timer
-void Timer_Destroy(TimerObject* Timer)
+// Must be called with TimerMtx held
+static void Timer_Destroy(TimerObject* Timer)
 {
-	unsigned int index, i;
-	std::lock_guard<std::mutex>lock(TimerMtx);
-	
+	unsigned int index, i;
+
 	index = TimerList.size();
 	for (i = 0; i < index; i++) {
 		if (Timer == TimerList[i]) {
@@ -94,32 +124,150 @@ void Timer_Destroy(TimerObject* Timer)
 	TimerList.erase(TimerList.begin() + index);
 }
 
-// Thread that runs the timer
-void ClockThread(TimerObject* Timer)
-{
-	uint64_t NewExpireTime;
-
-	if (!Timer->Name.empty()) {
-		CxbxSetThreadName(Timer->Name.c_str());
-	}
-	if (Timer->CpuAffinity != nullptr) {
-		InitXboxThread(*Timer->CpuAffinity);
+// Queues a new deadline for the timer, invalidating the ones it already had
+// Must be called with TimerMtx held
+static void Timer_Arm(TimerObject* Timer, uint64_t Deadline_NS)
+{
+	Timer->Generation++;
+	Timer->Queued++;
+	TimerQueue.push({ Deadline_NS, Timer->Generation, Timer });
+
+	// Only wake the service thread if it's now sleeping past the new earliest deadline
+	if (TimerQueue.top().Timer == Timer && TimerQueue.top().Generation == Timer->Generation) {
+#ifdef _WIN32
+		SetEvent(TimerServiceKick);
+#else
+		TimerServiceCv->notify_one();
+#endif
+	}
+}
+
+// Sleeps until the given deadline (0 means no deadline) or until a timer is armed with an earlier one
+// Must be called with TimerMtx held, which is released while sleeping
+static void TimerService_Sleep(std::unique_lock<std::mutex>& Lock, uint64_t Deadline_NS)
+{
+#ifdef _WIN32
+	HANDLE Handles[2] = { TimerServiceKick, TimerServiceWaitable };
+	DWORD Count = 1;
+
+	if (Deadline_NS != 0) {
+		uint64_t Now = GetTime_NS(nullptr);
+		if (Deadline_NS <= Now) {
+			return;
+		}
+
+		// Relative due time, in 100 ns units
+		LARGE_INTEGER DueTime;
+		DueTime.QuadPart = -(LONGLONG)((Deadline_NS - Now + 99) / 100);
+		SetWaitableTimer(TimerServiceWaitable, &DueTime, 0, nullptr, nullptr, FALSE);
+		Count = 2;
+	}
+
+	Lock.unlock();
+	WaitForMultipleObjects(Count, Handles, FALSE, INFINITE);
+	Lock.lock();
+#else
+	if (Deadline_NS == 0) {
+		TimerServiceCv->wait(Lock);
+	}
+	else {
+		uint64_t Now = GetTime_NS(nullptr);
+		if (Deadline_NS > Now) {
+			TimerServiceCv->wait_for(Lock, std::chrono::nanoseconds(Deadline_NS - Now));
+		}
 	}
-	NewExpireTime = GetNextExpireTime(Timer);
+#endif
+}
 
+// The single thread that runs the callbacks of all the timers
+static void TimerServiceThread()
+{
+	bool XboxThreadInitialized = false;
+
+	CxbxSetThreadName("Timer service thread");
+
+	std::unique_lock<std::mutex> lock(TimerMtx);
 	while (true) {
-		if (GetTime_NS(Timer) > NewExpireTime) {
-			if (Timer->Exit.load()) {
+		if (TimerQueue.empty()) {
+			TimerService_Sleep(lock, 0);
+			continue;
+		}
+
+		TimerDeadline Next = TimerQueue.top();
+		if (GetTime_NS(Next.Timer) < Next.Deadline_NS) {
+			TimerService_Sleep(lock, Next.Deadline_NS);
+			continue;
+		}
+
+		TimerQueue.pop();
+		TimerObject* Timer = Next.Timer;
+		Timer->Queued--;
+		if (Timer->Exit.load()) {
+			// Free the timer once it has no more deadlines referencing it
+			if (Timer->Queued == 0) {
+				Timer_Destroy(Timer);
+			}
+			continue;
+		}
+
+		if (Next.Generation != Timer->Generation) {
+			// Cancelled or restarted since this deadline was queued
+			continue;
+		}
+
+		// Timers that run guest code (like the kernel clock) need the service thread to be an xbox thread.
+		// There's a single service thread, so it takes the affinity of the first of them
+		if (Timer->CpuAffinity != nullptr && !XboxThreadInitialized) {
+			InitXboxThread(*Timer->CpuAffinity);
+			XboxThreadInitialized = true;
+		}
+
+		Timer->Firing = true;
+		lock.unlock();
+		Timer->Callback(Timer->Opaque);
+		lock.lock();
+		Timer->Firing = false;
+
+		if (Timer->Exit.load()) {
+			if (Timer->Queued == 0) {
 				Timer_Destroy(Timer);
-				return;
 			}
-			Timer->Callback(Timer->Opaque);
-			NewExpireTime = GetNextExpireTime(Timer);
-		}
-		Sleep(1); // prevent burning the cpu
+			continue;
+		}
+
+		// Re-queue periodic timers from their previous deadline, so that the period doesn't drift by the
+		// wake up latency and the callback duration. If the timer fell more than a period behind, resync it
+		// to the current time instead of firing it back to back
+		if (Timer->Periodic && Next.Generation == Timer->Generation) {
+			uint64_t Period = Timer->ExpireTime_MS.load();
+			uint64_t Now = GetTime_NS(Timer);
+			uint64_t Deadline = Next.Deadline_NS + Period;
+			if (Deadline <= Now) {
+				Deadline = Now + Period;
+			}
+			Timer_Arm(Timer, Deadline);
+		}
 	}
 }
 
+// Starts the service thread the first time a timer is started
+static void TimerService_Init()
+{
+	std::call_once(TimerServiceOnce, [] {
+#ifdef _WIN32
+		// High resolution waitable timers are only available on Windows 10 1803 and later
+		TimerServiceWaitable = CreateWaitableTimerEx(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (TimerServiceWaitable == NULL) {
+			TimerServiceWaitable = CreateWaitableTimer(nullptr, FALSE, nullptr);
+		}
+		TimerServiceKick = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+#else
+		TimerServiceCv = new std::condition_variable;
+#endif
+		std::thread(TimerServiceThread).detach();
+	});
+}
+
 // Changes the expire time of a timer
 void Timer_ChangeExpireTime(TimerObject* Timer, uint64_t Expire_ms)
 {
@@ -129,7 +277,20 @@ void Timer_ChangeExpireTime(TimerObject* Timer, uint64_t Expire_ms)
 // Destroys the timer
 void Timer_Exit(TimerObject* Timer)
 {
+	std::lock_guard<std::mutex>lock(TimerMtx);
 	Timer->Exit.store(true);
+
+	// Otherwise, the service thread frees it when it drops its last deadline or its callback returns
+	if (Timer->Queued == 0 && !Timer->Firing) {
+		Timer_Destroy(Timer);
+	}
+}
+
+// Stops the timer without destroying it, it can be started again later
+void Timer_Cancel(TimerObject* Timer)
+{
+	std::lock_guard<std::mutex>lock(TimerMtx);
+	Timer->Generation++;
 }
 
 // Allocates the memory for the timer object
@@ -141,6 +302,10 @@ TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigne
 	pTimer->Callback = Callback;
 	pTimer->ExpireTime_MS.store(0);
 	pTimer->Exit.store(false);
+	pTimer->Generation = 0;
+	pTimer->Queued = 0;
+	pTimer->Periodic = false;
+	pTimer->Firing = false;
 	pTimer->Opaque = Arg;
 	Name.empty() ? pTimer->Name = "Unnamed thread" : pTimer->Name = Name;
 	pTimer->CpuAffinity = Affinity;
@@ -149,12 +314,25 @@ TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigne
 	return pTimer;
 }
 
-// Starts the timer
-// Expire_MS must be expressed in NS
-void Timer_Start(TimerObject* Timer, uint64_t Expire_MS)
-{
-	Timer->ExpireTime_MS.store(Expire_MS);
-	std::thread(ClockThread, Timer).detach();
+// Starts the timer, which then fires every Expire_MS until it's cancelled or destroyed
+// Expire_MS must be expressed in NS
+void Timer_Start(TimerObject* Timer, uint64_t Expire_MS)
+{
+	TimerService_Init();
+	std::lock_guard<std::mutex>lock(TimerMtx);
+	Timer->ExpireTime_MS.store(Expire_MS);
+	Timer->Periodic = true;
+	Timer_Arm(Timer, GetNextExpireTime(Timer));
+}
+
+// Starts the timer, which then fires only once after Expire_NS
+void Timer_StartOneShot(TimerObject* Timer, uint64_t Expire_NS)
+{
+	TimerService_Init();
+	std::lock_guard<std::mutex>lock(TimerMtx);
+	Timer->ExpireTime_MS.store(Expire_NS);
+	Timer->Periodic = false;
+	Timer_Arm(Timer, GetNextExpireTime(Timer));
 }
 
 // Retrives the frequency of the high resolution clock of the host
@@ -164,6 +342,7 @@ void Timer_Init()
 	LARGE_INTEGER freq;
 	QueryPerformanceFrequency(&freq);
 	HostClockFrequency = freq.QuadPart;
+	ClockScale_Init(&HostClockToNs, HostClockFrequency, SCALE_S_IN_NS);
 #elif __linux__
 	ClockFrequency = 0;
 #else
@@ -29,6 +29,8 @@
 #define TIMER_H
 
 #include <atomic>
+#include <cstdint>
+#include "ClockScale.h"
 
 #define SCALE_S_IN_NS  1000000000
 #define SCALE_MS_IN_NS 1000000
@@ -39,6 +41,13 @@
 #define SCALE_MS_IN_US 1000
 #define SCALE_US_IN_US 1
 
+#ifdef _WIN32
+// High resolution waitable timers need Windows 10 1803, older sdks don't define the flag
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
 /* typedef of the timer object and the callback function */
 typedef void(*TimerCB)(void*);
 typedef struct _TimerObject
@@ -48,8 +57,13 @@ typedef struct _TimerObject
 	std::atomic_bool Exit;               // indicates that the timer should be destroyed
 	TimerCB Callback;                    // function to call when the timer expires
 	void* Opaque;                        // opaque argument to pass to the callback
-	std::string Name;                    // the name of the timer thread (if any)
-	unsigned long* CpuAffinity;          // the cpu affinity of the timer thread (if any)
+	std::string Name;                    // the name of the timer (if any)
+	unsigned long* CpuAffinity;          // the cpu affinity of the timer service thread (if any)
+	// Scheduling state, owned by the timer service and protected by the timer lock
+	uint64_t Generation;                 // bumped by every start and cancel, invalidates the queued deadlines
+	unsigned int Queued;                 // deadlines of this timer still queued in the timer service
+	bool Periodic;                       // re-queue the timer after it fires
+	bool Firing;                         // the callback is running on the timer service thread
 }
 TimerObject;
 
@@ -58,6 +72,8 @@ extern uint64_t HostClockFrequency;
 /* Timer exported functions */
 TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigned long* Affinity);
 void Timer_Start(TimerObject* Timer, uint64_t Expire_MS);
+void Timer_StartOneShot(TimerObject* Timer, uint64_t Expire_NS);
+void Timer_Cancel(TimerObject* Timer);
 void Timer_Exit(TimerObject* Timer);
 void Timer_ChangeExpireTime(TimerObject* Timer, uint64_t Expire_ms);
 uint64_t GetTime_NS(TimerObject* Timer);
@@ -0,0 +1,171 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "Tracing.h"
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic_bool g_TraceEnabled = false;
+
+typedef struct _TraceEvent
+{
+	const char* Name;
+	const char* Category;
+	char Phase;           // 'X' for complete events, 'i' for instant ones
+	uint64_t Start_US;    // relative to the start of the trace
+	uint64_t Duration_US;
+	uint32_t ThreadId;
+}
+TraceEvent;
+
+static std::mutex TraceMtx;
+static std::vector<TraceEvent> TraceEvents;
+static std::string TraceFilePath;
+static std::chrono::steady_clock::time_point TraceStart;
+static std::chrono::steady_clock::time_point TraceEnd;
+
+// Small sequential thread ids keep the trace readable
+static uint32_t Trace_ThreadId()
+{
+	static std::atomic_uint32_t NextId = 1;
+	thread_local uint32_t Id = NextId++;
+	return Id;
+}
+
+static void Trace_WriteString(FILE* fp, const char* Str)
+{
+	fputc('"', fp);
+	for (; *Str != '\0'; Str++) {
+		unsigned char c = *Str;
+		if (c == '"' || c == '\\') {
+			fputc('\\', fp);
+			fputc(c, fp);
+		}
+		else if (c < 0x20) {
+			fprintf(fp, "\\u%04x", c);
+		}
+		else {
+			fputc(c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+void Trace_Init(const std::string& FilePath, uint64_t Duration_MS)
+{
+	std::lock_guard<std::mutex> lock(TraceMtx);
+
+	TraceFilePath = FilePath;
+	TraceEvents.clear();
+	TraceEvents.reserve(4096);
+	TraceStart = std::chrono::steady_clock::now();
+	TraceEnd = TraceStart + std::chrono::milliseconds(Duration_MS);
+	g_TraceEnabled = true;
+}
+
+void Trace_Flush()
+{
+	std::lock_guard<std::mutex> lock(TraceMtx);
+
+	if (!g_TraceEnabled) {
+		return;
+	}
+	g_TraceEnabled = false;
+
+	FILE* fp = fopen(TraceFilePath.c_str(), "wt");
+	if (fp == nullptr) {
+		TraceEvents.clear();
+		return;
+	}
+
+	fputs("{\"traceEvents\":[", fp);
+	for (size_t i = 0; i < TraceEvents.size(); i++) {
+		const TraceEvent& Event = TraceEvents[i];
+		fputs(i == 0 ? "\n{\"name\":" : ",\n{\"name\":", fp);
+		Trace_WriteString(fp, Event.Name);
+		fputs(",\"cat\":", fp);
+		Trace_WriteString(fp, Event.Category);
+		fprintf(fp, ",\"ph\":\"%c\",\"ts\":%llu,", Event.Phase, (unsigned long long)Event.Start_US);
+		if (Event.Phase == 'X') {
+			fprintf(fp, "\"dur\":%llu,", (unsigned long long)Event.Duration_US);
+		}
+		else {
+			fputs("\"s\":\"g\",", fp);
+		}
+		fprintf(fp, "\"pid\":1,\"tid\":%u}", Event.ThreadId);
+	}
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+	fclose(fp);
+
+	TraceEvents.clear();
+	TraceEvents.shrink_to_fit();
+}
+
+static void Trace_Record(const TraceEvent& Event, std::chrono::steady_clock::time_point Now)
+{
+	bool Expired;
+	{
+		std::lock_guard<std::mutex> lock(TraceMtx);
+		if (!g_TraceEnabled) {
+			return;
+		}
+		TraceEvents.push_back(Event);
+		Expired = Now >= TraceEnd;
+	}
+
+	// The first event past the end of the trace window writes out the file
+	if (Expired) {
+		Trace_Flush();
+	}
+}
+
+void Trace_AddEvent(const char* Name, const char* Category, std::chrono::steady_clock::time_point Start, std::chrono::steady_clock::time_point End)
+{
+	TraceEvent Event;
+	Event.Name = Name;
+	Event.Category = Category;
+	Event.Phase = 'X';
+	Event.Start_US = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Start - TraceStart).count();
+	Event.Duration_US = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(End - Start).count();
+	Event.ThreadId = Trace_ThreadId();
+	Trace_Record(Event, End);
+}
+
+void Trace_AddInstant(const char* Name, const char* Category)
+{
+	auto Now = std::chrono::steady_clock::now();
+
+	TraceEvent Event;
+	Event.Name = Name;
+	Event.Category = Category;
+	Event.Phase = 'i';
+	Event.Start_US = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Now - TraceStart).count();
+	Event.Duration_US = 0;
+	Event.ThreadId = Trace_ThreadId();
+	Trace_Record(Event, Now);
+}
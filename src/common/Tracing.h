@@ -0,0 +1,80 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Lightweight startup tracer. When enabled, scoped timers record complete events which are
+// written as a Chrome/Perfetto trace-event json file once the trace window has elapsed.
+// When disabled, a trace scope costs a single relaxed load of g_TraceEnabled
+
+extern std::atomic_bool g_TraceEnabled;
+
+// Starts tracing, events are recorded for Duration_MS milliseconds and then written to FilePath
+void Trace_Init(const std::string& FilePath, uint64_t Duration_MS);
+// Writes the recorded events (if any) and stops tracing
+void Trace_Flush();
+// Records a complete event. Start and End are relative to the steady clock
+void Trace_AddEvent(const char* Name, const char* Category, std::chrono::steady_clock::time_point Start, std::chrono::steady_clock::time_point End);
+// Records an instant event, like the first presented frame
+void Trace_AddInstant(const char* Name, const char* Category);
+
+class TraceScope
+{
+public:
+	TraceScope(const char* Name, const char* Category) : m_Name(nullptr)
+	{
+		if (g_TraceEnabled.load(std::memory_order_relaxed)) {
+			m_Name = Name;
+			m_Category = Category;
+			m_Start = std::chrono::steady_clock::now();
+		}
+	}
+	~TraceScope()
+	{
+		if (m_Name != nullptr) {
+			Trace_AddEvent(m_Name, m_Category, m_Start, std::chrono::steady_clock::now());
+		}
+	}
+
+private:
+	const char* m_Name;
+	const char* m_Category;
+	std::chrono::steady_clock::time_point m_Start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Times the enclosing scope. Name and Category must be string literals (or otherwise outlive the trace)
+#define TRACE_SCOPE(Name, Category) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(Name, Category)
+#define TRACE_FUNC(Category) TRACE_SCOPE(__func__, Category)
+
+#define TRACE_INSTANT(Name, Category) \
+	do { \
+		if (g_TraceEnabled.load(std::memory_order_relaxed)) { \
+			Trace_AddInstant(Name, Category); \
+		} \
+	} while (0)
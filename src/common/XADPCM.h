@@ -25,7 +25,7 @@
 #ifndef XBOXADPCM_H
 #define XBOXADPCM_H
 
-#include "common\xbe\Xbe.h"
+#include <cstdint>
 
 /*
   TXboxAdpcmDecoder  0.1.3
@@ -111,45 +111,131 @@ static int TXboxAdpcmDecoder_DecodeSample(int Code, TAdpcmState *State) {
     return(Result);
 }
 
-static int TXboxAdpcmDecoder_Decode_Memory(uint8_t *in, int inlen, uint8_t *out, const int FChannels) {
-    TAdpcmState FAdpcmState[2];
-    int16_t     Buffers[2][8];
-    uint32_t    CodeBuf;
-    int         i,
-        j,
-        c,
-        outlen;
-
-    inlen = (inlen / XBOX_ADPCM_SRCSIZE) / FChannels;
-
-    for (outlen = 0; inlen--; outlen++) {
-        for (c = 0; c < FChannels; c++) {
-            *out++ = in[0];
-            *out++ = in[1];
-            FAdpcmState[c].Predictor = in[0] | (in[1] << 8);    in += 2;
-            FAdpcmState[c].Index = in[0] | (in[1] << 8);    in += 2;
-            TXboxAdpcmDecoder_delimit(FAdpcmState[c].Index, 88, 0);
-            FAdpcmState[c].StepSize = StepTable[FAdpcmState[c].Index];
-        }
-        for (i = 0; i < 8; i++) {
-            for (c = 0; c < FChannels; c++) {
-                CodeBuf = in[0] | (in[1] << 8) | (in[2] << 16) | (in[3] << 24);
-                in += 4;
-                for (j = 0; j < 8; j++) {
-                    Buffers[c][j] = TXboxAdpcmDecoder_DecodeSample(CodeBuf & 15, &FAdpcmState[c]);
-                    CodeBuf >>= 4;
-                }
-            }
-            for (j = 0; j < 8; j++) {
-                for (c = 0; c < FChannels; c++) {
-                    *out++ = (Buffers[c][j]) & 0xff;
-                    *out++ = (Buffers[c][j] >> 8) & 0xff;
-                }
+// Branch free variant of TXboxAdpcmDecoder_DecodeSample, the state is kept in
+// plain ints so that the callers can keep it in registers across a block.
+static inline int16_t TXboxAdpcmDecoder_DecodeNibble(unsigned Code, int &Predictor, int &Index) {
+    int Step = StepTable[Index];
+    int Delta = (Step >> 3)
+              + (Step        & -(int)((Code >> 2) & 1))
+              + ((Step >> 1) & -(int)((Code >> 1) & 1))
+              + ((Step >> 2) & -(int)(Code & 1));
+    int Sign = -(int)((Code >> 3) & 1);
+
+    Predictor += (Delta ^ Sign) - Sign;
+    Predictor = Predictor > 32767 ? 32767 : Predictor;
+    Predictor = Predictor < -32768 ? -32768 : Predictor;
+    Index += IndexTable[Code];
+    Index = Index > 88 ? 88 : Index;
+    Index = Index < 0 ? 0 : Index;
+    return (int16_t)Predictor;
+}
+
+// Reads the per channel block header, which also is the first output sample.
+static inline void TXboxAdpcmDecoder_ReadHeader(const uint8_t *in, int &Predictor, int &Index) {
+    Predictor = (int16_t)(in[0] | (in[1] << 8));
+    // The index is stored as a word, but only its low byte was ever honoured.
+    Index = (int8_t)in[2];
+    Index = Index > 88 ? 88 : Index;
+    Index = Index < 0 ? 0 : Index;
+}
+
+// Decodes one self contained block of Channels * XBOX_ADPCM_SRCSIZE bytes into
+// Channels * XBOX_ADPCM_DSTSIZE bytes of interleaved 16 bit pcm. Blocks carry
+// their own predictor state, so any block can be decoded independently.
+static inline void TXboxAdpcmDecoder_DecodeBlock(const uint8_t *in, int16_t *out, const int Channels) {
+    for (int c = 0; c < Channels; c++) {
+        const uint8_t *Codes = in + 4 * Channels + 4 * c;
+        int16_t *Samples = out + c;
+        int Predictor, Index;
+
+        TXboxAdpcmDecoder_ReadHeader(in + 4 * c, Predictor, Index);
+        *Samples = (int16_t)Predictor;
+        Samples += Channels;
+        for (int i = 0; i < 8; i++, Codes += 4 * Channels) {
+            uint32_t CodeBuf = Codes[0] | (Codes[1] << 8) | (Codes[2] << 16) | ((uint32_t)Codes[3] << 24);
+            for (int j = 0; j < 8; j++, CodeBuf >>= 4) {
+                *Samples = TXboxAdpcmDecoder_DecodeNibble(CodeBuf & 15, Predictor, Index);
+                Samples += Channels;
             }
         }
     }
-    return(outlen * XBOX_ADPCM_DSTSIZE * FChannels);
 }
+
+// Stereo fast path: both channels are decoded in lockstep, which gives the cpu
+// two independent dependency chains to overlap and writes the frames in order.
+static inline void TXboxAdpcmDecoder_DecodeBlockStereo(const uint8_t *in, int16_t *out) {
+    int PredictorL, IndexL, PredictorR, IndexR;
+
+    TXboxAdpcmDecoder_ReadHeader(in, PredictorL, IndexL);
+    TXboxAdpcmDecoder_ReadHeader(in + 4, PredictorR, IndexR);
+    *out++ = (int16_t)PredictorL;
+    *out++ = (int16_t)PredictorR;
+    in += 8;
+    for (int i = 0; i < 8; i++, in += 8) {
+        uint32_t CodeL = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+        uint32_t CodeR = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+        for (int j = 0; j < 8; j++, CodeL >>= 4, CodeR >>= 4) {
+            *out++ = TXboxAdpcmDecoder_DecodeNibble(CodeL & 15, PredictorL, IndexL);
+            *out++ = TXboxAdpcmDecoder_DecodeNibble(CodeR & 15, PredictorR, IndexR);
+        }
+    }
+}
+
+// Mono fast path: two consecutive blocks are decoded in lockstep for the same reason.
+static inline void TXboxAdpcmDecoder_DecodeBlockMonoPair(const uint8_t *in, int16_t *out) {
+    const uint8_t *in2 = in + XBOX_ADPCM_SRCSIZE;
+    int16_t *out2 = out + XBOX_ADPCM_DSTSIZE / 2;
+    int Predictor1, Index1, Predictor2, Index2;
+
+    TXboxAdpcmDecoder_ReadHeader(in, Predictor1, Index1);
+    TXboxAdpcmDecoder_ReadHeader(in2, Predictor2, Index2);
+    *out++ = (int16_t)Predictor1;
+    *out2++ = (int16_t)Predictor2;
+    in += 4;
+    in2 += 4;
+    for (int i = 0; i < 8; i++, in += 4, in2 += 4) {
+        uint32_t Code1 = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+        uint32_t Code2 = in2[0] | (in2[1] << 8) | (in2[2] << 16) | ((uint32_t)in2[3] << 24);
+        for (int j = 0; j < 8; j++, Code1 >>= 4, Code2 >>= 4) {
+            *out++ = TXboxAdpcmDecoder_DecodeNibble(Code1 & 15, Predictor1, Index1);
+            *out2++ = TXboxAdpcmDecoder_DecodeNibble(Code2 & 15, Predictor2, Index2);
+        }
+    }
+}
+
+// Decodes BlockCount consecutive blocks, picking the fast path for the channel layout.
+static inline void TXboxAdpcmDecoder_DecodeBlocks(const uint8_t *in, int16_t *out, int BlockCount, const int Channels) {
+    if (Channels == 2) {
+        for (; BlockCount > 0; BlockCount--) {
+            TXboxAdpcmDecoder_DecodeBlockStereo(in, out);
+            in += 2 * XBOX_ADPCM_SRCSIZE;
+            out += XBOX_ADPCM_DSTSIZE;
+        }
+    } else if (Channels == 1) {
+        for (; BlockCount > 1; BlockCount -= 2) {
+            TXboxAdpcmDecoder_DecodeBlockMonoPair(in, out);
+            in += 2 * XBOX_ADPCM_SRCSIZE;
+            out += XBOX_ADPCM_DSTSIZE;
+        }
+        if (BlockCount > 0) {
+            TXboxAdpcmDecoder_DecodeBlock(in, out, 1);
+        }
+    } else {
+        for (; BlockCount > 0; BlockCount--) {
+            TXboxAdpcmDecoder_DecodeBlock(in, out, Channels);
+            in += Channels * XBOX_ADPCM_SRCSIZE;
+            out += Channels * (XBOX_ADPCM_DSTSIZE / 2);
+        }
+    }
+}
+
+static int TXboxAdpcmDecoder_Decode_Memory(uint8_t *in, int inlen, uint8_t *out, const int FChannels) {
+    int BlockCount = (inlen / XBOX_ADPCM_SRCSIZE) / FChannels;
+
+    TXboxAdpcmDecoder_DecodeBlocks(in, (int16_t*)out, BlockCount, FChannels);
+    return(BlockCount * XBOX_ADPCM_DSTSIZE * FChannels);
+}
+
 static int TXboxAdpcmDecoder_guess_output_size(int SourceSize) {
     return((SourceSize / XBOX_ADPCM_SRCSIZE) * XBOX_ADPCM_DSTSIZE);
 }
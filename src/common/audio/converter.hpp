@@ -25,6 +25,45 @@
 #pragma once
 
 #include <cstdint>
+#include <cmath>
+
+// Conversions below are table driven, titles may update pitch and volume of many voices every frame.
+struct converter_tables {
+    // 2^(n / 4096), one octave of pitch. Pitch is integer, so every step is covered exactly.
+    double pitch2ratio[4096];
+    // log2(1 + n / 1024), interpolated for mantissa bits below the table resolution.
+    double log2_mantissa[1024 + 1];
+    // 48000 * 2^n for n in [-17, 17], scale of each pitch octave.
+    double octave2freq[35];
+    // 10^(-n / 2000), one decade of millibels. Other decades are a multiply away.
+    float  volume2gain[2000];
+
+    converter_tables() {
+        for (int i = 0; i < 4096; i++) {
+            pitch2ratio[i] = exp2(i / 4096.0);
+        }
+        for (int i = 0; i < 35; i++) {
+            octave2freq[i] = ldexp(48000.0, i - 17);
+        }
+        for (int i = 0; i <= 1024; i++) {
+            log2_mantissa[i] = log2(1.0 + i / 1024.0);
+        }
+        for (int i = 0; i < 2000; i++) {
+            volume2gain[i] = static_cast<float>(pow(10.0, -i / 2000.0));
+        }
+    }
+};
+
+inline const converter_tables& converter_get_tables() {
+    static const converter_tables tables;
+    return tables;
+}
+
+// 48000 * 2^(pitch / 4096) without rounding, pitch octave must be within [-17, 17].
+static inline double converter_pitch2freq_exact(int32_t pitch) {
+    const converter_tables& tables = converter_get_tables();
+    return tables.pitch2ratio[pitch & 0xFFF] * tables.octave2freq[(pitch >> 12) + 17];
+}
 
 // Convert frequency to pitch helper
 static inline int32_t converter_freq2pitch(uint32_t freq) {
@@ -41,11 +80,81 @@ static inline int32_t converter_freq2pitch(uint32_t freq) {
 
     // Convert pitch to hertz
     hertz = exp((pitch / pitchRatio) * log(2)) * hertzRatio;*/
-    return static_cast<int32_t>(log2(freq / 48000.0f) * 4096.0f);
+    if (freq == 0) {
+        return INT32_MIN;
+    }
+    const converter_tables& tables = converter_get_tables();
+
+    // log2(freq) = exponent + log2(mantissa), mantissa is the bits below the leading one.
+    uint32_t mantissa = freq;
+    int32_t exponent = 31;
+    for (int32_t shift = 16; shift > 0; shift >>= 1) {
+        if ((mantissa >> (32 - shift)) == 0) {
+            mantissa <<= shift;
+            exponent -= shift;
+        }
+    }
+    uint32_t index = (mantissa >> 21) & 0x3FF;
+    double fraction = (mantissa & 0x1FFFFF) / double(0x200000);
+    double log2_freq = exponent + tables.log2_mantissa[index] + (tables.log2_mantissa[index + 1] - tables.log2_mantissa[index]) * fraction;
+
+    // log2(48000) = 15.5507...
+    double pitch_approx = (log2_freq - 15.550746785383243) * 4096.0;
+    int32_t pitch = static_cast<int32_t>(pitch_approx);
+
+    // Interpolation is off by far less than 1/100 of a pitch step. Only when that close to the next step,
+    // settle it against the exact pitch table. Pitch is truncated toward zero, like a plain cast would do.
+    double distance = pitch_approx - pitch;
+    if (distance > -0.01 && distance < 0.01) {
+        if (freq >= 48000) {
+            if (converter_pitch2freq_exact(pitch) > freq) {
+                pitch--;
+            }
+        } else {
+            if (converter_pitch2freq_exact(pitch) < freq) {
+                pitch++;
+            }
+        }
+    } else if (distance > 0.99 || distance < -0.99) {
+        if (freq >= 48000) {
+            if (converter_pitch2freq_exact(pitch + 1) <= freq) {
+                pitch++;
+            }
+        } else {
+            if (converter_pitch2freq_exact(pitch - 1) >= freq) {
+                pitch--;
+            }
+        }
+    }
+    return pitch;
 }
 
 // Convert pitch to frequency helper
 static inline uint32_t converter_pitch2freq(int32_t pitch) {
     //* See research documentation above for conversion example.
-    return static_cast<uint32_t>(exp((pitch / 4096.0f) * log(2)) * 48000.0f);
+    int32_t octave = pitch >> 12;
+    // 48 KHz shifted up by 16 octaves is past uint32_t range, down by 16 octaves is below 1 Hz.
+    if (octave >= 16) {
+        return UINT32_MAX;
+    } else if (octave < -16) {
+        return 0;
+    }
+    double freq = converter_pitch2freq_exact(pitch);
+    return freq < 4294967295.0 ? static_cast<uint32_t>(freq) : UINT32_MAX;
+}
+
+// Convert volume in millibels (100 mB = 1 dB) to linear gain helper
+static inline float converter_volume2gain(int32_t volume) {
+    if (volume >= 0) {
+        return 1.0f;
+    }
+    const converter_tables& tables = converter_get_tables();
+    uint32_t attenuation = static_cast<uint32_t>(-(int64_t)volume);
+    uint32_t decades = attenuation / 2000;
+    // Beyond 8 decades gain is below float precision of any sample anyway.
+    if (decades >= 8) {
+        return 0.0f;
+    }
+    static const float decade2gain[8] = { 1e0f, 1e-1f, 1e-2f, 1e-3f, 1e-4f, 1e-5f, 1e-6f, 1e-7f };
+    return tables.volume2gain[attenuation % 2000] * decade2gain[decades];
 }
@@ -50,7 +50,20 @@ A million repetitions of "a"
 
 #include <stdio.h>
 #include <string.h>
+#include <iterator> // For std::size
+#include <tmmintrin.h> // SSSE3
+#include <immintrin.h> // SHA
 #include "EmuSha.h"
+#include "common/util/CPUID.h"
+
+// MSVC exposes all intrinsics unconditionally, gcc/clang need them enabled per function
+#if defined(__GNUC__) || defined(__clang__)
+#define SHA1_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SHA1_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#else
+#define SHA1_TARGET_SSSE3
+#define SHA1_TARGET_SHANI
+#endif
 
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
@@ -77,7 +90,7 @@ A million repetitions of "a"
 
 
 /* Hash a single 512-bit block. This is the core of the algorithm. */
-void SHA1Transform(uint32_t state[5], const unsigned char buffer[64])
+static void SHA1TransformBlock_NoSIMD(uint32_t state[5], const unsigned char buffer[64])
 {
 	uint32_t a, b, c, d, e;
 
@@ -199,6 +212,268 @@ void SHA1Transform(uint32_t state[5], const unsigned char buffer[64])
 #endif
 }
 
+// Default implementation
+static void SHA1Transform_NoSIMD(uint32_t state[5], const unsigned char* data, uint32_t blocks)
+{
+	for (; blocks > 0; blocks--, data += 64) {
+		SHA1TransformBlock_NoSIMD(state, data);
+	}
+}
+
+/* SSSE3 implementation: the message schedule is expanded four words at a time and
+the round constants are pre-added, which leaves only the round function in scalar code */
+#define RW(f,v,w,x,y,z,i) z+=f(w,x,y)+wk[i]+rol(v,5);w=rol(w,30);
+#define F0(w,x,y) ((w&(x^y))^y)
+#define F1(w,x,y) (w^x^y)
+#define F2(w,x,y) (((w|x)&y)|(w&x))
+
+SHA1_TARGET_SSSE3 static inline __m128i rol_epi32(__m128i v, int bits)
+{
+	return _mm_or_si128(_mm_slli_epi32(v, bits), _mm_srli_epi32(v, 32 - bits));
+}
+
+SHA1_TARGET_SSSE3 static void SHA1Transform_SSSE3(uint32_t state[5], const unsigned char* data, uint32_t blocks)
+{
+	const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	const __m128i k[4] = {
+		_mm_set1_epi32(0x5A827999), _mm_set1_epi32(0x6ED9EBA1),
+		_mm_set1_epi32(0x8F1BBCDC), _mm_set1_epi32(0xCA62C1D6)
+	};
+	__m128i w[20];
+	alignas(16) uint32_t wk[80];
+
+	for (; blocks > 0; blocks--, data += 64) {
+		for (int i = 0; i < 4; i++) {
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), bswap);
+		}
+		// W[t] = rol1(W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]). The last lane depends on the first one
+		// of the same vector, so it's computed with W[t] = 0 and fixed up afterwards
+		for (int i = 4; i < 8; i++) {
+			__m128i tmp = _mm_xor_si128(w[i - 4], _mm_alignr_epi8(w[i - 3], w[i - 4], 8));
+			tmp = _mm_xor_si128(tmp, w[i - 2]);
+			tmp = _mm_xor_si128(tmp, _mm_srli_si128(w[i - 1], 4));
+			__m128i fix = _mm_slli_si128(tmp, 12);
+			w[i] = _mm_xor_si128(rol_epi32(tmp, 1), rol_epi32(fix, 2));
+		}
+		// From t = 32 onwards the equivalent W[t] = rol2(W[t-6] ^ W[t-16] ^ W[t-28] ^ W[t-32])
+		// has no dependency inside a vector
+		for (int i = 8; i < 20; i++) {
+			__m128i tmp = _mm_xor_si128(_mm_alignr_epi8(w[i - 1], w[i - 2], 8), w[i - 4]);
+			tmp = _mm_xor_si128(tmp, w[i - 7]);
+			tmp = _mm_xor_si128(tmp, w[i - 8]);
+			w[i] = rol_epi32(tmp, 2);
+		}
+		for (int i = 0; i < 20; i++) {
+			_mm_store_si128((__m128i*)&wk[i * 4], _mm_add_epi32(w[i], k[i / 5]));
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+		RW(F0, a, b, c, d, e, 0);
+		RW(F0, e, a, b, c, d, 1);
+		RW(F0, d, e, a, b, c, 2);
+		RW(F0, c, d, e, a, b, 3);
+		RW(F0, b, c, d, e, a, 4);
+		RW(F0, a, b, c, d, e, 5);
+		RW(F0, e, a, b, c, d, 6);
+		RW(F0, d, e, a, b, c, 7);
+		RW(F0, c, d, e, a, b, 8);
+		RW(F0, b, c, d, e, a, 9);
+		RW(F0, a, b, c, d, e, 10);
+		RW(F0, e, a, b, c, d, 11);
+		RW(F0, d, e, a, b, c, 12);
+		RW(F0, c, d, e, a, b, 13);
+		RW(F0, b, c, d, e, a, 14);
+		RW(F0, a, b, c, d, e, 15);
+		RW(F0, e, a, b, c, d, 16);
+		RW(F0, d, e, a, b, c, 17);
+		RW(F0, c, d, e, a, b, 18);
+		RW(F0, b, c, d, e, a, 19);
+		RW(F1, a, b, c, d, e, 20);
+		RW(F1, e, a, b, c, d, 21);
+		RW(F1, d, e, a, b, c, 22);
+		RW(F1, c, d, e, a, b, 23);
+		RW(F1, b, c, d, e, a, 24);
+		RW(F1, a, b, c, d, e, 25);
+		RW(F1, e, a, b, c, d, 26);
+		RW(F1, d, e, a, b, c, 27);
+		RW(F1, c, d, e, a, b, 28);
+		RW(F1, b, c, d, e, a, 29);
+		RW(F1, a, b, c, d, e, 30);
+		RW(F1, e, a, b, c, d, 31);
+		RW(F1, d, e, a, b, c, 32);
+		RW(F1, c, d, e, a, b, 33);
+		RW(F1, b, c, d, e, a, 34);
+		RW(F1, a, b, c, d, e, 35);
+		RW(F1, e, a, b, c, d, 36);
+		RW(F1, d, e, a, b, c, 37);
+		RW(F1, c, d, e, a, b, 38);
+		RW(F1, b, c, d, e, a, 39);
+		RW(F2, a, b, c, d, e, 40);
+		RW(F2, e, a, b, c, d, 41);
+		RW(F2, d, e, a, b, c, 42);
+		RW(F2, c, d, e, a, b, 43);
+		RW(F2, b, c, d, e, a, 44);
+		RW(F2, a, b, c, d, e, 45);
+		RW(F2, e, a, b, c, d, 46);
+		RW(F2, d, e, a, b, c, 47);
+		RW(F2, c, d, e, a, b, 48);
+		RW(F2, b, c, d, e, a, 49);
+		RW(F2, a, b, c, d, e, 50);
+		RW(F2, e, a, b, c, d, 51);
+		RW(F2, d, e, a, b, c, 52);
+		RW(F2, c, d, e, a, b, 53);
+		RW(F2, b, c, d, e, a, 54);
+		RW(F2, a, b, c, d, e, 55);
+		RW(F2, e, a, b, c, d, 56);
+		RW(F2, d, e, a, b, c, 57);
+		RW(F2, c, d, e, a, b, 58);
+		RW(F2, b, c, d, e, a, 59);
+		RW(F1, a, b, c, d, e, 60);
+		RW(F1, e, a, b, c, d, 61);
+		RW(F1, d, e, a, b, c, 62);
+		RW(F1, c, d, e, a, b, 63);
+		RW(F1, b, c, d, e, a, 64);
+		RW(F1, a, b, c, d, e, 65);
+		RW(F1, e, a, b, c, d, 66);
+		RW(F1, d, e, a, b, c, 67);
+		RW(F1, c, d, e, a, b, 68);
+		RW(F1, b, c, d, e, a, 69);
+		RW(F1, a, b, c, d, e, 70);
+		RW(F1, e, a, b, c, d, 71);
+		RW(F1, d, e, a, b, c, 72);
+		RW(F1, c, d, e, a, b, 73);
+		RW(F1, b, c, d, e, a, 74);
+		RW(F1, a, b, c, d, e, 75);
+		RW(F1, e, a, b, c, d, 76);
+		RW(F1, d, e, a, b, c, 77);
+		RW(F1, c, d, e, a, b, 78);
+		RW(F1, b, c, d, e, a, 79);
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+
+	memset(wk, 0, sizeof(wk));
+}
+
+#undef RW
+#undef F0
+#undef F1
+#undef F2
+
+// SHA extensions implementation, four rounds per sha1rnds4
+#define SHA1_ROUNDS4(e_in, e_out, msg, abcd_in, abcd_out, f) \
+	e_in = _mm_sha1nexte_epu32(e_in, msg); \
+	e_out = abcd_in; \
+	abcd_out = _mm_sha1rnds4_epu32(abcd_in, e_in, f);
+
+SHA1_TARGET_SHANI static void SHA1Transform_SHANI(uint32_t state[5], const unsigned char* data, uint32_t blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+	__m128i e1;
+
+	for (; blocks > 0; blocks--, data += 64) {
+		const __m128i abcd_save = abcd;
+		const __m128i e_save = e0;
+		__m128i msg[4];
+
+		for (int i = 0; i < 4; i++) {
+			msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), bswap);
+		}
+
+		// Rounds 0-3
+		e0 = _mm_add_epi32(e0, msg[0]);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		// Rounds 4-15, the message schedule of the following group is interleaved
+		SHA1_ROUNDS4(e1, e0, msg[1], abcd, abcd, 0);
+		msg[0] = _mm_sha1msg1_epu32(msg[0], msg[1]);
+		SHA1_ROUNDS4(e0, e1, msg[2], abcd, abcd, 0);
+		msg[1] = _mm_sha1msg1_epu32(msg[1], msg[2]);
+		msg[0] = _mm_xor_si128(msg[0], msg[2]);
+		SHA1_ROUNDS4(e1, e0, msg[3], abcd, abcd, 0);
+		msg[0] = _mm_sha1msg2_epu32(msg[0], msg[3]);
+		msg[2] = _mm_sha1msg1_epu32(msg[2], msg[3]);
+		msg[1] = _mm_xor_si128(msg[1], msg[3]);
+
+		// Rounds 16-79, the message schedule runs three groups ahead of the rounds
+		SHA1_ROUNDS4(e0, e1, msg[0], abcd, abcd, 0);
+		msg[1] = _mm_sha1msg2_epu32(msg[1], msg[0]);
+		msg[3] = _mm_sha1msg1_epu32(msg[3], msg[0]);
+		msg[2] = _mm_xor_si128(msg[2], msg[0]);
+		SHA1_ROUNDS4(e1, e0, msg[1], abcd, abcd, 1);
+		msg[2] = _mm_sha1msg2_epu32(msg[2], msg[1]);
+		msg[0] = _mm_sha1msg1_epu32(msg[0], msg[1]);
+		msg[3] = _mm_xor_si128(msg[3], msg[1]);
+		SHA1_ROUNDS4(e0, e1, msg[2], abcd, abcd, 1);
+		msg[3] = _mm_sha1msg2_epu32(msg[3], msg[2]);
+		msg[1] = _mm_sha1msg1_epu32(msg[1], msg[2]);
+		msg[0] = _mm_xor_si128(msg[0], msg[2]);
+		SHA1_ROUNDS4(e1, e0, msg[3], abcd, abcd, 1);
+		msg[0] = _mm_sha1msg2_epu32(msg[0], msg[3]);
+		msg[2] = _mm_sha1msg1_epu32(msg[2], msg[3]);
+		msg[1] = _mm_xor_si128(msg[1], msg[3]);
+		SHA1_ROUNDS4(e0, e1, msg[0], abcd, abcd, 1);
+		msg[1] = _mm_sha1msg2_epu32(msg[1], msg[0]);
+		msg[3] = _mm_sha1msg1_epu32(msg[3], msg[0]);
+		msg[2] = _mm_xor_si128(msg[2], msg[0]);
+		SHA1_ROUNDS4(e1, e0, msg[1], abcd, abcd, 1);
+		msg[2] = _mm_sha1msg2_epu32(msg[2], msg[1]);
+		msg[0] = _mm_sha1msg1_epu32(msg[0], msg[1]);
+		msg[3] = _mm_xor_si128(msg[3], msg[1]);
+		SHA1_ROUNDS4(e0, e1, msg[2], abcd, abcd, 2);
+		msg[3] = _mm_sha1msg2_epu32(msg[3], msg[2]);
+		msg[1] = _mm_sha1msg1_epu32(msg[1], msg[2]);
+		msg[0] = _mm_xor_si128(msg[0], msg[2]);
+		SHA1_ROUNDS4(e1, e0, msg[3], abcd, abcd, 2);
+		msg[0] = _mm_sha1msg2_epu32(msg[0], msg[3]);
+		msg[2] = _mm_sha1msg1_epu32(msg[2], msg[3]);
+		msg[1] = _mm_xor_si128(msg[1], msg[3]);
+		SHA1_ROUNDS4(e0, e1, msg[0], abcd, abcd, 2);
+		msg[1] = _mm_sha1msg2_epu32(msg[1], msg[0]);
+		msg[3] = _mm_sha1msg1_epu32(msg[3], msg[0]);
+		msg[2] = _mm_xor_si128(msg[2], msg[0]);
+		SHA1_ROUNDS4(e1, e0, msg[1], abcd, abcd, 2);
+		msg[2] = _mm_sha1msg2_epu32(msg[2], msg[1]);
+		msg[0] = _mm_sha1msg1_epu32(msg[0], msg[1]);
+		msg[3] = _mm_xor_si128(msg[3], msg[1]);
+		SHA1_ROUNDS4(e0, e1, msg[2], abcd, abcd, 2);
+		msg[3] = _mm_sha1msg2_epu32(msg[3], msg[2]);
+		msg[1] = _mm_sha1msg1_epu32(msg[1], msg[2]);
+		msg[0] = _mm_xor_si128(msg[0], msg[2]);
+		SHA1_ROUNDS4(e1, e0, msg[3], abcd, abcd, 3);
+		msg[0] = _mm_sha1msg2_epu32(msg[0], msg[3]);
+		msg[2] = _mm_sha1msg1_epu32(msg[2], msg[3]);
+		msg[1] = _mm_xor_si128(msg[1], msg[3]);
+		SHA1_ROUNDS4(e0, e1, msg[0], abcd, abcd, 3);
+		msg[1] = _mm_sha1msg2_epu32(msg[1], msg[0]);
+		msg[3] = _mm_sha1msg1_epu32(msg[3], msg[0]);
+		msg[2] = _mm_xor_si128(msg[2], msg[0]);
+		SHA1_ROUNDS4(e1, e0, msg[1], abcd, abcd, 3);
+		msg[2] = _mm_sha1msg2_epu32(msg[2], msg[1]);
+		msg[0] = _mm_sha1msg1_epu32(msg[0], msg[1]);
+		msg[3] = _mm_xor_si128(msg[3], msg[1]);
+		SHA1_ROUNDS4(e0, e1, msg[2], abcd, abcd, 3);
+		msg[3] = _mm_sha1msg2_epu32(msg[3], msg[2]);
+		SHA1_ROUNDS4(e1, e0, msg[3], abcd, abcd, 3);
+
+		// Combine state
+		e0 = _mm_sha1nexte_epu32(e0, e_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+#undef SHA1_ROUNDS4
+
 /* SHA1Init - Initialize new context */
 void SHA1Init(SHA1_CTX* context)
 {
@@ -212,7 +487,7 @@ void SHA1Init(SHA1_CTX* context)
 }
 
 /* Run your data through this. */
-void SHA1Update(SHA1_CTX* context, const unsigned char* data, uint32_t len)
+static void SHA1UpdateWith(SHA1TransformFunc SHA1Transform, SHA1_CTX* context, const unsigned char* data, uint32_t len)
 {
 	uint32_t i;
 
@@ -226,10 +501,12 @@ void SHA1Update(SHA1_CTX* context, const unsigned char* data, uint32_t len)
 	if ((j + len) > 63)
 	{
 		memcpy(&context->buffer[j], data, (i = 64 - j));
-		SHA1Transform(context->state, context->buffer);
-		for (; i + 63 < len; i += 64)
+		SHA1Transform(context->state, context->buffer, 1);
+		if (i + 63 < len)
 		{
-			SHA1Transform(context->state, &data[i]);
+			uint32_t blocks = (len - i) / 64;
+			SHA1Transform(context->state, &data[i], blocks);
+			i += blocks * 64;
 		}
 		j = 0;
 	}
@@ -240,7 +517,7 @@ void SHA1Update(SHA1_CTX* context, const unsigned char* data, uint32_t len)
 
 
 /* Add padding and return the message digest. */
-void SHA1Final(unsigned char digest[A_SHA_DIGEST_LEN], SHA1_CTX* context)
+static void SHA1FinalWith(SHA1TransformFunc SHA1Transform, unsigned char digest[A_SHA_DIGEST_LEN], SHA1_CTX* context)
 {
 	unsigned i;
 
@@ -272,13 +549,13 @@ void SHA1Final(unsigned char digest[A_SHA_DIGEST_LEN], SHA1_CTX* context)
 	}
 #endif
 	c = 0200;
-	SHA1Update(context, &c, 1);
+	SHA1UpdateWith(SHA1Transform, context, &c, 1);
 	while ((context->count[0] & 504) != 448)
 	{
 		c = 0000;
-		SHA1Update(context, &c, 1);
+		SHA1UpdateWith(SHA1Transform, context, &c, 1);
 	}
-	SHA1Update(context, finalcount, 8); /* Should cause a SHA1Transform() */
+	SHA1UpdateWith(SHA1Transform, context, finalcount, 8); /* Should cause a SHA1Transform() */
 	for (i = 0; i < A_SHA_DIGEST_LEN; i++)
 	{
 		digest[i] = (unsigned char)
@@ -289,6 +566,80 @@ void SHA1Final(unsigned char digest[A_SHA_DIGEST_LEN], SHA1_CTX* context)
 	memset(&finalcount, '\0', sizeof(finalcount));
 }
 
+// Test vectors from FIPS PUB 180-1, plus one which crosses several blocks in a single update
+bool SHA1TestCore(SHA1TransformFunc Transform)
+{
+	static const struct {
+		const char* Message;
+		uint32_t Repeat;
+		uint32_t Digest[5];
+	} vectors[] = {
+		{ "abc", 1, { 0xA9993E36, 0x4706816A, 0xBA3E2571, 0x7850C26C, 0x9CD0D89D } },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, { 0x84983E44, 0x1C3BD26E, 0xBAAE4AA1, 0xF95129E5, 0xE54670F1 } },
+		{ "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 10000, { 0x34AA973C, 0xD4C4DAA4, 0xF61EEB2B, 0xDBAD2731, 0x6534016F } },
+	};
+
+	for (const auto& vector : vectors) {
+		SHA1_CTX ctx;
+		unsigned char digest[A_SHA_DIGEST_LEN];
+		uint32_t len = (uint32_t)strlen(vector.Message);
+
+		SHA1Init(&ctx);
+		for (uint32_t i = 0; i < vector.Repeat; i++) {
+			SHA1UpdateWith(Transform, &ctx, (const unsigned char*)vector.Message, len);
+		}
+		SHA1FinalWith(Transform, digest, &ctx);
+
+		for (unsigned i = 0; i < A_SHA_DIGEST_LEN; i++) {
+			if (digest[i] != (unsigned char)(vector.Digest[i >> 2] >> ((3 - (i & 3)) * 8))) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static const SHA1Core SHA1Cores[] = {
+	{ "SHA", SHA1Transform_SHANI },
+	{ "SSSE3", SHA1Transform_SSSE3 },
+	{ "NoSIMD", SHA1Transform_NoSIMD },
+};
+
+static bool SHA1IsSupported(SHA1TransformFunc Transform)
+{
+	SimdCaps supports;
+	if (Transform == SHA1Transform_SHANI)
+		return supports.SHA() && supports.SSE41();
+	if (Transform == SHA1Transform_SSSE3)
+		return supports.SSSE3();
+	return true;
+}
+
+// Detect SIMD support once at startup, and select the fastest implementation which also passes the test vectors
+static const SHA1Core& SHA1SelectCore()
+{
+	for (const SHA1Core& core : SHA1Cores) {
+		if (SHA1IsSupported(core.Transform) && SHA1TestCore(core.Transform)) {
+			return core;
+		}
+	}
+
+	return SHA1Cores[std::size(SHA1Cores) - 1];
+}
+
+static const SHA1Core& SHA1ActiveCore = SHA1SelectCore();
+
+void SHA1Update(SHA1_CTX* context, const unsigned char* data, uint32_t len)
+{
+	SHA1UpdateWith(SHA1ActiveCore.Transform, context, data, len);
+}
+
+void SHA1Final(unsigned char digest[A_SHA_DIGEST_LEN], SHA1_CTX* context)
+{
+	SHA1FinalWith(SHA1ActiveCore.Transform, digest, context);
+}
+
 void CalcSHA1Hash(unsigned char digest[A_SHA_DIGEST_LEN], const unsigned char* data, uint32_t len)
 {
 	SHA1_CTX ctx;
@@ -298,3 +649,20 @@ void CalcSHA1Hash(unsigned char digest[A_SHA_DIGEST_LEN], const unsigned char* d
 	SHA1Update(&ctx, data, len);
 	SHA1Final(digest, &ctx);
 }
+
+std::vector<SHA1Core> SHA1GetCores()
+{
+	std::vector<SHA1Core> cores;
+	for (const SHA1Core& core : SHA1Cores) {
+		if (SHA1IsSupported(core.Transform)) {
+			cores.push_back(core);
+		}
+	}
+
+	return cores;
+}
+
+const SHA1Core& SHA1GetActiveCore()
+{
+	return SHA1ActiveCore;
+}
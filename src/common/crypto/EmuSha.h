@@ -28,6 +28,7 @@
 #define EMUSHA_H
 
 #include "stdint.h"
+#include <vector>
 
 #define A_SHA_DIGEST_LEN 20
 
@@ -43,4 +44,20 @@ void SHA1Update(SHA1_CTX* context, const unsigned char* data, uint32_t len);
 void SHA1Final(unsigned char digest[A_SHA_DIGEST_LEN], SHA1_CTX* context);
 void CalcSHA1Hash(unsigned char digest[A_SHA_DIGEST_LEN], const unsigned char* data, uint32_t len);
 
+// The block transforms behind SHA1Update, exposed for verification and benchmarking
+typedef void(*SHA1TransformFunc)(uint32_t state[5], const unsigned char* data, uint32_t blocks);
+
+typedef struct _SHA1Core
+{
+	const char* Name;
+	SHA1TransformFunc Transform;
+} SHA1Core;
+
+// Returns the transforms supported by the host cpu, fastest first
+std::vector<SHA1Core> SHA1GetCores();
+// Returns the transform selected at startup
+const SHA1Core& SHA1GetActiveCore();
+// Runs the FIPS PUB 180-1 test vectors through the given transform
+bool SHA1TestCore(SHA1TransformFunc Transform);
+
 #endif
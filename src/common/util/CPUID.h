@@ -11,6 +11,7 @@ typedef unsigned __int32  uint32_t;
 
 #else
 #include <stdint.h>
+#include <bitset>
 #endif
 
 class CPUID {
@@ -46,6 +47,7 @@ public:
 	const bool SSE42(void) { return f_1.ECX()[20]; }
 	const bool AVX(void) { return f_1.ECX()[1]; }
 	const bool AVX2(void) { return f_7.EBX()[5]; }
+	const bool SHA(void) { return f_7.EBX()[29]; }
 
 private:
 	const CPUID f_1 = CPUID(1);
@@ -230,6 +230,35 @@ class EmuShared : public Mutex
 		void GetLogPopupTestCase(bool *value) { Lock(); *value = m_core.bLogPopupTestCase; Unlock(); }
 		void SetLogPopupTestCase(const bool value) { Lock(); m_core.bLogPopupTestCase = value; Unlock(); }
 
+		// ******************************************************************
+		// * Binary log value Accessors
+		// ******************************************************************
+		void GetLogBinary(bool *value) { Lock(); *value = m_core.bLogBinary; Unlock(); }
+
+		// ******************************************************************
+		// * Log governor value Accessors
+		// ******************************************************************
+		void GetLogSampling(unsigned int *first, unsigned int *every) { Lock(); *first = m_core.LogSampleFirst; *every = m_core.LogSampleEvery; Unlock(); }
+		void SetLogSampling(const unsigned int first, const unsigned int every) { Lock(); m_core.LogSampleFirst = first; m_core.LogSampleEvery = every; Unlock(); }
+		void GetLogRateLimits(unsigned int *value)
+		{
+			Lock();
+			for (int i = 0; i < NUM_INTEGERS_LOG_RATE; ++i) {
+				value[i] = m_core.LogRateLimits[i];
+			}
+			Unlock();
+		}
+		void SetLogRateLimits(unsigned int *value)
+		{
+			Lock();
+			for (int i = 0; i < NUM_INTEGERS_LOG_RATE; ++i) {
+				m_core.LogRateLimits[i] = value[i];
+			}
+			Unlock();
+		}
+		void GetLogDeduplicate(bool *value) { Lock(); *value = m_core.bLogDeduplicate; Unlock(); }
+		void SetLogDeduplicate(const bool value) { Lock(); m_core.bLogDeduplicate = value; Unlock(); }
+
 		// ******************************************************************
 		// * File storage location
 		// ******************************************************************
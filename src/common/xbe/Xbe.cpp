@@ -37,6 +37,10 @@ namespace xboxkrnl
 #include <filesystem> // filesystem related functions available on C++ 17
 #include <locale> // For ctime
 #include <array>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
 #include "devices\LED.h" // For LED::Sequence
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlPrintUEM
 #include "common\crypto\EmuSha.h" // For the SHA functions
@@ -828,6 +832,40 @@ bool Xbe::CheckSectionIntegrity(uint32_t sectionIndex)
     }
 }
 
+uint32_t Xbe::CheckSectionsIntegrity(std::vector<bool> &results)
+{
+    uint32_t NumSections = m_Header.dwSections;
+    results.assign(NumSections, true);
+
+    // Sections are hashed independently, so let a few workers pull them from a shared index.
+    // Results are collected in a plain array since std::vector<bool> can't be written concurrently
+    std::unique_ptr<bool[]> Valid(new bool[NumSections]);
+    std::atomic<uint32_t> NextSection(0);
+    auto Worker = [&]() {
+        for (uint32_t i = NextSection++; i < NumSections; i = NextSection++) {
+            Valid[i] = CheckSectionIntegrity(i);
+        }
+    };
+
+    uint32_t NumWorkers = std::min<uint32_t>(std::max(1u, std::thread::hardware_concurrency()), NumSections);
+    std::vector<std::future<void>> Workers;
+    for (uint32_t i = 1; i < NumWorkers; i++) {
+        Workers.emplace_back(std::async(std::launch::async, Worker));
+    }
+    Worker();
+    for (auto &w : Workers) {
+        w.wait();
+    }
+
+    uint32_t NumCorrupted = 0;
+    for (uint32_t i = 0; i < NumSections; i++) {
+        results[i] = Valid[i];
+        NumCorrupted += Valid[i] ? 0 : 1;
+    }
+
+    return NumCorrupted;
+}
+
 // ported from Dxbx's XbeExplorer
 XbeType Xbe::GetXbeType()
 {
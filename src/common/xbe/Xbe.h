@@ -30,6 +30,7 @@
 #include "common/xbox/Types.hpp"
 
 #include <cstdio>
+#include <vector>
 
 
 //#include <windef.h> // For MAX_PATH
@@ -69,6 +70,9 @@ class Xbe : public Error
         // verify the integrity of an xbe section
         bool CheckSectionIntegrity(uint32_t sectionIndex);
 
+        // verify the integrity of all xbe sections in parallel, returns the number of corrupted sections
+        uint32_t CheckSectionsIntegrity(std::vector<bool> &results);
+
         // import logo bitmap from raw monochrome data
         void ImportLogoBitmap(const uint8_t x_Gray[100*17]);
 
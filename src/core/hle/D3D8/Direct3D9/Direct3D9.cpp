@@ -45,6 +45,7 @@ namespace xboxkrnl
 #include "CxbxVersion.h"
 #include "core\kernel\init\CxbxKrnl.h"
 #include "core\kernel\support\Emu.h"
+#include "core\kernel\exports\EmuKrnl.h" // For HalPrintInterruptStats, KePrintDpcStats
 #include "EmuShared.h"
 #ifdef INCLUDE_DBG_CONSOLE
 #include "gui\DbgConsole.h"
@@ -56,12 +57,15 @@ namespace xboxkrnl
 #include "core\hle\D3D8\XbPixelShader.h" // For DxbxUpdateActivePixelShader
 #include "core\hle\D3D8\XbPushBuffer.h"
 #include "core\kernel\memory-manager\VMManager.h" // for g_VMManager
+#include "core\kernel\memory-manager\PoolManager.h" // for g_PoolManager
+#include "core\hle\DSOUND\DirectSound\DirectSound.hpp" // For DSoundPrint*Stats
 #include "core\hle\XAPI\Xapi.h" // For EMUPATCH
 #include "core\hle\D3D8\XbConvert.h"
 #include "Logging.h"
 #include "..\XbD3D8Logging.h"
 #include "core\hle\Intercept.hpp" // for bLLE_GPU
 #include "devices\video\nv2a.h" // For GET_MASK, NV_PGRAPH_CONTROL_0, PUSH_METHOD
+#include "devices\Xbox.h" // For g_APU
 #include "gui/resource/ResCxbx.h"
 #include "RenderStates.h"
 #include "TextureStates.h"
@@ -70,6 +74,7 @@ namespace xboxkrnl
 #include "common\input\SdlJoystick.h"
 #include "common/util/strConverter.hpp" // for utf8_to_utf16
 #include "VertexShaderSource.h"
+#include "Tracing.h"
 
 #include <assert.h>
 #include <process.h>
@@ -1928,6 +1933,20 @@ static LRESULT WINAPI EmuMsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPar
             else if (wParam == VK_F1)
             {
                 VertexBufferConverter.PrintStats();
+                HalPrintInterruptStats();
+                KePrintDpcStats();
+                g_PoolManager.PrintPoolStats();
+                DSoundPrintLockStats();
+                DSoundPrintBufferCacheStats();
+            }
+            else if (wParam == VK_F3)
+            {
+                // Capture the LLE voice processor, to be rendered offline by cxbxr-tool render-apu
+                if (g_APU != nullptr) {
+                    std::string dumpPath = std::string(szFolder_CxbxReloadedData) + "\\APUVoices.bin";
+                    bool bSaved = g_APU->SaveVoiceDump(dumpPath.c_str());
+                    printf("APU voice dump %s: %s\n", bSaved ? "written" : "failed", dumpPath.c_str());
+                }
             }
             else if (wParam == VK_F6)
             {
@@ -2270,14 +2289,17 @@ static DWORD WINAPI EmuCreateDeviceProxy(LPVOID)
 				g_EmuCDPD.HostPresentationParameters.EnableAutoDepthStencil = FALSE;
 
                 // redirect to windows Direct3D
-                g_EmuCDPD.hRet = g_pDirect3D->CreateDevice(
-                    g_EmuCDPD.Adapter,
-                    g_EmuCDPD.DeviceType,
-                    g_EmuCDPD.hFocusWindow,
-                    g_EmuCDPD.BehaviorFlags,
-                    &g_EmuCDPD.HostPresentationParameters,
-                    &g_pD3DDevice
-                );
+                {
+                    TRACE_SCOPE("IDirect3D::CreateDevice", "d3d");
+                    g_EmuCDPD.hRet = g_pDirect3D->CreateDevice(
+                        g_EmuCDPD.Adapter,
+                        g_EmuCDPD.DeviceType,
+                        g_EmuCDPD.hFocusWindow,
+                        g_EmuCDPD.BehaviorFlags,
+                        &g_EmuCDPD.HostPresentationParameters,
+                        &g_pD3DDevice
+                    );
+                }
 				DEBUG_D3DRESULT(g_EmuCDPD.hRet, "IDirect3D::CreateDevice");
 
                 if(FAILED(g_EmuCDPD.hRet))
@@ -4985,6 +5007,8 @@ DWORD WINAPI XTL::EMUPATCH(D3DDevice_Swap)
 {
 	LOG_FUNC_ONE_ARG(Flags);
 
+	TRACE_INSTANT("D3DDevice_Swap", "d3d");
+
 	// TODO: Ensure this flag is always the same across library versions
 	if (Flags != 0 && Flags != CXBX_SWAP_PRESENT_FORWARD)
 			EmuLog(LOG_LEVEL::WARNING, "XTL::EmuD3DDevice_Swap: Flags != 0");
@@ -5,12 +5,15 @@
 #include "Logging.h"
 #include "util/hasher.h"
 #include "core/kernel/support/Emu.h"
+#include "Tracing.h"
 
 VertexShaderSource g_VertexShaderSource = VertexShaderSource();
 // FIXME : This should really be released and created in step with the D3D device lifecycle rather than being a thing on its own
 // (And the ResetD3DDevice method should be removed)
 
 ID3DBlob* AsyncCreateVertexShader(IntermediateVertexShader intermediateShader, ShaderKey key) {
+	TRACE_FUNC("shader");
+
 	// HACK set thread affinity every call to reduce interference with Xbox main thread
 	// TODO use a thread pool library for better control over workers
 	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
@@ -61,6 +61,7 @@
 #include "core\hle\D3D8\XbD3D8Logging.h" // For D3DErrorString()
 
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup()
+#include "Tracing.h"
 
 #include <assert.h> // assert()
 #include <process.h>
@@ -5855,6 +5856,8 @@ PSH_RECOMPILED_SHADER XTL_EmuRecompilePshDef(XTL::X_D3DPIXELSHADERDEF *pPSDef)
 
 PSH_RECOMPILED_SHADER DxbxRecompilePixelShader(XTL::X_D3DPIXELSHADERDEF *pPSDef)
 {
+  TRACE_FUNC("shader");
+
 static const
   char *szDiffusePixelShader =
     "ps_2_x\n"
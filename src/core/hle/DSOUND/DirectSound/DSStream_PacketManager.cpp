@@ -379,3 +379,36 @@ bool DSStream_Packet_Flush(
     pThis->Xb_Status = 0;
     return false;
 }
+
+// Estimate when the current packet next needs attention, either to upload more of its data to the host
+// buffer or to complete it, from the bytes left ahead of the write cursor and the host's byte rate.
+DWORD DSStream_Packet_NextDeadline(
+    XTL::X_CDirectSoundStream* pThis
+    )
+{
+    // Nothing is playing, only a title's call (Process, Pause, Flush) can change that.
+    if (pThis->Host_BufferPacketArray.size() == 0 || pThis->Host_isProcessing == false ||
+        (pThis->EmuFlags & (DSE_FLAG_PAUSE | DSE_FLAG_SYNCHPLAYBACK_CONTROL)) > 0) {
+        return INFINITE;
+    }
+
+    DWORD dwAvgBytesPerSec = pThis->EmuBufferDesc.lpwfxFormat->nAvgBytesPerSec;
+    if (dwAvgBytesPerSec == 0) {
+        return INFINITE;
+    }
+
+    vector_hvp_iterator packetCurrent = pThis->Host_BufferPacketArray.begin();
+    DWORD dwBytesLeft = packetCurrent->xmp_data.dwMaxSize - packetCurrent->bufPlayed;
+
+    // DSStream_Packet_UploadPartial writes again once less than a second of written data is left to play.
+    if (packetCurrent->bufWrittenBytes < packetCurrent->xmp_data.dwMaxSize) {
+        DWORD dwUploadAt = packetCurrent->bufPlayed + dwAvgBytesPerSec;
+        DWORD dwBytesToUpload = packetCurrent->bufWrittenBytes > dwUploadAt ? packetCurrent->bufWrittenBytes - dwUploadAt : 0;
+        if (dwBytesToUpload < dwBytesLeft) {
+            dwBytesLeft = dwBytesToUpload;
+        }
+    }
+
+    // Round up so the packet is done by the time the worker wakes up.
+    return DWORD((uint64_t(dwBytesLeft) * 1000 + dwAvgBytesPerSec - 1) / dwAvgBytesPerSec);
+}
@@ -41,4 +41,6 @@ extern bool DSStream_Packet_Process(XTL::X_CDirectSoundStream* pThis);
 
 extern void DSStream_Packet_FlushEx_Reset(XTL::X_CDirectSoundStream* pThis);
 
-extern bool DSStream_Packet_Flush(XTL::X_CDirectSoundStream* pThis);
+extern bool DSStream_Packet_Flush(XTL::X_CDirectSoundStream* pThis);
+
+extern DWORD DSStream_Packet_NextDeadline(XTL::X_CDirectSoundStream* pThis);
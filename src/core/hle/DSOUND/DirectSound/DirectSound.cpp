@@ -105,6 +105,9 @@ uint32_t GetAPUTime()
 
 // Managed memory xbox audio variables
 static std::thread dsound_thread;
+// Bounds in milliseconds of the stream worker's wait between deadlines.
+#define DSOUND_STREAM_WAIT_MIN 10
+#define DSOUND_STREAM_WAIT_MAX 300
 static void dsound_thread_worker(LPVOID);
 
 #include "DirectSoundInline.hpp"
@@ -145,6 +148,13 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreate)
 
     if (!initialized) {
         dsound_thread = std::thread(dsound_thread_worker, nullptr);
+
+        if (g_XBAudio.capture_trace) {
+            std::string tracePath = std::string(szFolder_CxbxReloadedData) + "\\DSoundTrace.bin";
+            if (!g_DSoundTrace.Open(tracePath.c_str())) {
+                EmuLog(LOG_LEVEL::WARNING, "Unable to open %s for DirectSound call capture", tracePath.c_str());
+            }
+        }
     }
 
 	ResetApuTimer();
@@ -153,7 +163,12 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreate)
     g_bDSoundCreateCalled = TRUE;
 
     if (!initialized || g_pDSound8 == nullptr) {
-        hRet = DirectSoundCreate8(&g_XBAudio.adapterGUID, &g_pDSound8, nullptr);
+        if (g_XBAudio.output != AUDIO_OUTPUT_HOST) {
+            hRet = SoftwareDSoundCreate(g_XBAudio.output, &g_pDSound8);
+        }
+        else {
+            hRet = DirectSoundCreate8(&g_XBAudio.adapterGUID, &g_pDSound8, nullptr);
+        }
 
         LPCSTR dsErrorMsg = nullptr;
 
@@ -386,21 +401,47 @@ static void dsound_thread_worker(LPVOID nullPtr)
 {
 	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
 
+    DWORD dwWaitTime = DSOUND_STREAM_WAIT_MAX;
     while (true) {
+        // Sleep until the earliest stream deadline, or until a title's Process/Flush/Pause call wakes us up.
         // Testcase: Gauntlet Dark Legacy, if Sleep(1) then intro videos start to starved often
-        // unless console is open with logging enabled. This is the cause of stopping intro videos often.
-        Sleep(300);
+        // unless console is open with logging enabled. This is why the wait is never shorter than DSOUND_STREAM_WAIT_MIN.
+        // The old fixed period is kept as an upper bound so streams are still polled while idle.
+        WaitForSingleObject(g_DSoundStreamEvent, dwWaitTime);
         // Enforce mutex guard lock only occur inside below bracket for proper compile build.
         {
             DSoundMutexGuardLock;
 
             xboxkrnl::LARGE_INTEGER getTime;
             xboxkrnl::KeQuerySystemTime(&getTime);
-            DirectSoundDoWork_Stream(getTime);
+            dwWaitTime = DirectSoundDoWork_Stream(getTime);
+        }
+        if (dwWaitTime < DSOUND_STREAM_WAIT_MIN) {
+            dwWaitTime = DSOUND_STREAM_WAIT_MIN;
+        } else if (dwWaitTime > DSOUND_STREAM_WAIT_MAX) {
+            dwWaitTime = DSOUND_STREAM_WAIT_MAX;
         }
     }
 }
 
+void DSoundPrintLockStats()
+{
+    printf("DSound Lock Acquires (Contended): Global %u (%u), Buffer/Stream %u (%u), Listener %u (%u)\n",
+        g_DSoundGlobalLockCounters.Acquires.load(), g_DSoundGlobalLockCounters.Contentions.load(),
+        g_DSoundObjectLockCounters.Acquires.load(), g_DSoundObjectLockCounters.Contentions.load(),
+        g_DSoundListenerLockCounters.Acquires.load(), g_DSoundListenerLockCounters.Contentions.load());
+}
+
+void DSoundPrintBufferCacheStats()
+{
+    uint64_t requested = g_DSoundBufferCacheCounters.RequestedBytes.load();
+    uint64_t uploaded = g_DSoundBufferCacheCounters.UploadedBytes.load();
+
+    printf("DSound Buffer Cache Uploads: %llu of %llu bytes (%llu%%)\n",
+        (unsigned long long)uploaded, (unsigned long long)requested,
+        (unsigned long long)(requested != 0 ? uploaded * 100 / requested : 0));
+}
+
 // Kismet given name for RadWolfie's experiment major issue in the mutt.
 #define DirectSuicideWork XTL::EMUPATCH(DirectSoundDoWork)
 
@@ -413,7 +454,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSound_CommitDeferredSettings)
 (
     X_CDirectSound*         pThis)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_ONE_ARG(pThis);
 
@@ -589,7 +630,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_GetCaps)
     if (pDSCaps) {
         pDSCaps->dwFreeBufferSGEs = DSoundSGEFreeBuffer();
         // To prevent pass down overflow size.
-        pDSCaps->dwMemoryAllocated = (XTL_DS_SGE_SIZE_MAX < g_dwXbMemAllocated ? XTL_DS_SGE_SIZE_MAX : g_dwXbMemAllocated);
+        pDSCaps->dwMemoryAllocated = (XTL_DS_SGE_SIZE_MAX < g_dwXbMemAllocated.load() ? XTL_DS_SGE_SIZE_MAX : g_dwXbMemAllocated.load());
 
         // TODO: What are the max values for 2D and 3D Buffers? Once discover, then perform real time update in global variable.
         pDSCaps->dwFree2DBuffers = (pDSCaps->dwFreeBufferSGEs == 0 ? 0 : 0x200 /* TODO: Replace me to g_dwFree2DBuffers*/ );
@@ -679,7 +720,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetAllParameters)
     LPCDS3DLISTENER         pDS3DListenerParameters,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -701,7 +742,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetDistanceFactor)
     FLOAT           fDistanceFactor,
     DWORD           dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -723,7 +764,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetDopplerFactor)
     FLOAT           fDopplerFactor,
     DWORD           dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -796,7 +837,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetOrientation)
     FLOAT           zTop,
     DWORD           dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -835,7 +876,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetPosition)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -859,7 +900,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetRolloffFactor)
     FLOAT           fRolloffFactor,
     DWORD           dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -872,6 +913,9 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetRolloffFactor)
     return hRet;
 }
 
+// How often CDirectSound_SynchPlayback goes over the buffers and streams that other threads were holding
+#define DSOUND_SYNCHPLAYBACK_PASSES 16
+
 // ******************************************************************
 // * patch: CDirectSound_SynchPlayback
 // ******************************************************************
@@ -879,37 +923,62 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSound_SynchPlayback)
 (
     LPDIRECTSOUND8 pThis)
 {
-    DSoundMutexGuardLock;
-
 	LOG_FUNC_ONE_ARG(pThis);
 
     //TODO: Test case Rayman 3 - Hoodlum Havoc, Battlestar Galactica, Miami Vice, and ...?
 
-    vector_ds_buffer::iterator ppDSBuffer = g_pDSoundBufferCache.begin();
-    for (; ppDSBuffer != g_pDSoundBufferCache.end(); ppDSBuffer++) {
-        EmuDirectSoundBuffer* pDSBuffer = (*ppDSBuffer)->emuDSBuffer;
-        if (pDSBuffer->X_BufferCache == nullptr) {
-            continue;
-        }
+    // A buffer or stream can be held by a thread that waits for g_DSoundMutex, like one inside a title's packet
+    // completion callback. So the objects are only try-locked, and the busy ones are retried after g_DSoundMutex
+    // has been let go, which lets their owner finish. When the caller already held g_DSoundMutex that can't help,
+    // so after a few passes the busy ones are skipped like DoWork does, and start on the next SynchPlayback.
+    bool bBusy;
+    unsigned uPasses = 0;
+    do {
+        bBusy = false;
+        {
+            DSoundMutexGuardLock;
 
-        if ((pDSBuffer->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
-            DSoundBufferSynchPlaybackFlagRemove(pDSBuffer->EmuFlags);
-            EmuLog(LOG_LEVEL::DEBUG, "SynchPlayback - pDSBuffer: %08X; EmuPlayFlags: %08X", *ppDSBuffer, pDSBuffer->EmuPlayFlags);
-            pDSBuffer->EmuDirectSoundBuffer8->Play(0, 0, pDSBuffer->EmuPlayFlags);
+            vector_ds_buffer::iterator ppDSBuffer = g_pDSoundBufferCache.begin();
+            for (; ppDSBuffer != g_pDSoundBufferCache.end(); ppDSBuffer++) {
+                EmuDirectSoundBuffer* pDSBuffer = (*ppDSBuffer)->emuDSBuffer;
+                std::unique_lock<DSoundMutex> guardObject(pDSBuffer->Host_Mutex, std::try_to_lock);
+                if (!guardObject.owns_lock()) {
+                    bBusy = true;
+                    continue;
+                }
+                if (pDSBuffer->X_BufferCache == nullptr) {
+                    continue;
+                }
+
+                if ((pDSBuffer->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
+                    DSoundBufferSynchPlaybackFlagRemove(pDSBuffer->EmuFlags);
+                    EmuLog(LOG_LEVEL::DEBUG, "SynchPlayback - pDSBuffer: %08X; EmuPlayFlags: %08X", *ppDSBuffer, pDSBuffer->EmuPlayFlags);
+                    pDSBuffer->EmuDirectSoundBuffer8->Play(0, 0, pDSBuffer->EmuPlayFlags);
+                }
+            }
+
+            vector_ds_stream::iterator ppDSStream = g_pDSoundStreamCache.begin();
+            for (; ppDSStream != g_pDSoundStreamCache.end(); ppDSStream++) {
+                std::unique_lock<DSoundMutex> guardObject((*ppDSStream)->Host_Mutex, std::try_to_lock);
+                if (!guardObject.owns_lock()) {
+                    bBusy = true;
+                    continue;
+                }
+                if ((*ppDSStream)->Host_BufferPacketArray.size() == 0) {
+                    continue;
+                }
+                if (((*ppDSStream)->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
+                    DSoundBufferSynchPlaybackFlagRemove((*ppDSStream)->EmuFlags);
+                    EmuLog(LOG_LEVEL::DEBUG, "SynchPlayback - pDSStream: %08X; EmuPlayFlags: %08X", *ppDSStream, (*ppDSStream)->EmuPlayFlags);
+                    DSStream_Packet_Process((*ppDSStream));
+                }
+            }
         }
-    }
 
-    vector_ds_stream::iterator ppDSStream = g_pDSoundStreamCache.begin();
-    for (; ppDSStream != g_pDSoundStreamCache.end(); ppDSStream++) {
-        if ((*ppDSStream)->Host_BufferPacketArray.size() == 0) {
-            continue;
-        }
-        if (((*ppDSStream)->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
-            DSoundBufferSynchPlaybackFlagRemove((*ppDSStream)->EmuFlags);
-            EmuLog(LOG_LEVEL::DEBUG, "SynchPlayback - pDSStream: %08X; EmuPlayFlags: %08X", *ppDSStream, (*ppDSStream)->EmuPlayFlags);
-            DSStream_Packet_Process((*ppDSStream));
+        if (bBusy) {
+            SwitchToThread();
         }
-    }
+    } while (bBusy && ++uPasses < DSOUND_SYNCHPLAYBACK_PASSES);
 
     //EmuLog(LOG_LEVEL::DEBUG, "Buffer started: %u; Stream started: %u", debugSynchBufferCount, debugSynchStreamCount);
 
@@ -923,8 +992,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SynchPlayback)
 (
     LPDIRECTSOUND8          pThis)
 {
-    DSoundMutexGuardLock;
-
+    // No DSoundMutexGuardLock here, CDirectSound_SynchPlayback has to be able to let go of it.
 	LOG_FORWARD("CDirectSound_SynchPlayback");
 
     return XTL::EMUPATCH(CDirectSound_SynchPlayback)(pThis);
@@ -941,7 +1009,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetVelocity)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -29,6 +29,10 @@
 #include "core\kernel\init\CxbxKrnl.h"
 #include "core\hle\DSOUND\XbDSoundTypes.h"
 #include "core\hle\DSOUND\common\XbInternalStruct.hpp"
+#include "core\hle\DSOUND\common\DSoundBufferCache.hpp"
+
+#include <atomic>
+#include <mutex>
 
 typedef struct IDirectSound3DListener8* LPDIRECTSOUND3DLISTENER8;
 typedef struct IDirectSound3DBuffer8* LPDIRECTSOUND3DBUFFER8;
@@ -43,6 +47,48 @@ void CxbxInitAudio();
 }
 #endif
 
+// Acquire counts shared by every lock of one kind (global, per buffer/stream, listener).
+struct DSoundLockCounters {
+    std::atomic<uint32_t> Acquires;
+    std::atomic<uint32_t> Contentions;
+};
+
+extern DSoundLockCounters g_DSoundGlobalLockCounters;
+extern DSoundLockCounters g_DSoundObjectLockCounters;
+extern DSoundLockCounters g_DSoundListenerLockCounters;
+
+extern void DSoundPrintLockStats();
+extern void DSoundPrintBufferCacheStats();
+
+// Recursive mutex that counts how often a thread had to wait for it.
+class DSoundMutex {
+    public:
+        DSoundMutex() : m_Counters(g_DSoundObjectLockCounters) {}
+        explicit DSoundMutex(DSoundLockCounters &Counters) : m_Counters(Counters) {}
+
+        void lock() {
+            m_Counters.Acquires++;
+            if (!m_Mutex.try_lock()) {
+                m_Counters.Contentions++;
+                m_Mutex.lock();
+            }
+        }
+        bool try_lock() {
+            bool bLocked = m_Mutex.try_lock();
+            if (bLocked) {
+                m_Counters.Acquires++;
+            }
+            return bLocked;
+        }
+        void unlock() {
+            m_Mutex.unlock();
+        }
+
+    private:
+        std::recursive_mutex    m_Mutex;
+        DSoundLockCounters     &m_Counters;
+};
+
 namespace XTL {
 
 #undef FIELD_OFFSET     // prevent macro redefinition warnings
@@ -71,6 +117,14 @@ typedef struct _DSoundBuffer_Lock {
     DWORD   dwLockFlags;
 } DSoundBuffer_Lock;
 
+// Last frequency and volume handed to host buffer, repeated updates ending up with the same values are skipped.
+// Initial values are never handed to host, so the first update always goes through.
+struct DSoundHostParams {
+    DSoundHostParams() : dwFrequency(0), lVolume(DSBVOLUME_MAX + 1) {}
+    DWORD   dwFrequency;
+    LONG    lVolume;
+};
+
 // ******************************************************************
 // * X_CDirectSoundBuffer
 // ******************************************************************
@@ -104,13 +158,16 @@ struct EmuDirectSoundBuffer
     DWORD                   EmuRegionPlayLength;
     DWORD                   X_BufferCacheSize;
     DSoundBuffer_Lock       Host_lock;
+    DSoundHostParams        Host_params;
     DSoundBuffer_Lock       X_lock;
+    DSoundBufferCache       X_BufferCacheTracker; // Storage of X_BufferCache unless DSE_FLAG_BUFFER_EXTERNAL is set
     REFERENCE_TIME          Xb_rtPauseEx;
     REFERENCE_TIME          Xb_rtStopEx;
     LONG                    Xb_VolumeMixbin;
     X_DSENVOLOPEDESC        Xb_EnvolopeDesc;
     X_DSVOICEPROPS          Xb_VoiceProperties;
     DWORD                   Xb_Flags;
+    DSoundMutex             Host_Mutex;
 };
 
 struct XbHybridDSBuffer : DSBUFFER_S::DSBUFFER_I {
@@ -261,6 +318,7 @@ class X_CDirectSoundStream
         // cached data
         LPDIRECTSOUNDBUFFER8                    EmuDirectSoundBuffer8;
         LPDIRECTSOUND3DBUFFER8                  EmuDirectSound3DBuffer8;
+        DSoundHostParams                        Host_params;
         PVOID                                   X_BufferCache; // Not really needed...
         DSBUFFERDESC                            EmuBufferDesc;
         PVOID                                   EmuLockPtr1;
@@ -284,6 +342,7 @@ class X_CDirectSoundStream
         DWORD                                   Host_dwLastWritePos;
         DWORD                                   Xb_Flags;
         DWORD                                   Xb_Status;
+        DSoundMutex                             Host_Mutex;
 };
 
 // ******************************************************************
@@ -65,6 +65,11 @@ void DirectSoundDoWork_Buffer(xboxkrnl::LARGE_INTEGER &time)
     vector_ds_buffer::iterator ppDSBuffer = g_pDSoundBufferCache.begin();
     for (; ppDSBuffer != g_pDSoundBufferCache.end(); ppDSBuffer++) {
         XTL::EmuDirectSoundBuffer* pThis = ((*ppDSBuffer)->emuDSBuffer);
+        // Skip buffers a title thread is working on, they will be handled on the next call.
+        std::unique_lock<DSoundMutex> guardObject(pThis->Host_Mutex, std::try_to_lock);
+        if (!guardObject.owns_lock()) {
+            continue;
+        }
         if (pThis->Host_lock.pLockPtr1 == nullptr || pThis->EmuBufferToggle != XTL::X_DSB_TOGGLE_DEFAULT) {
             continue;
         }
@@ -74,6 +79,7 @@ void DirectSoundDoWork_Buffer(xboxkrnl::LARGE_INTEGER &time)
                             pThis->EmuBufferDesc,
                             pThis->Host_lock,
                             pThis->X_BufferCache,
+                            pThis->X_BufferCacheTracker,
                             pThis->X_lock.dwLockOffset,
                             pThis->X_lock.dwLockBytes1,
                             pThis->X_lock.dwLockBytes2);
@@ -99,7 +105,7 @@ ULONG WINAPI XTL::EMUPATCH(IDirectSoundBuffer_AddRef)
 (
     XbHybridDSBuffer*       pHybridThis)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_ONE_ARG(pHybridThis);
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
@@ -128,9 +134,9 @@ XTL::EmuDirectSoundBuffer::~EmuDirectSoundBuffer()
         free(this->EmuBufferDesc.lpwfxFormat);
     }
     if (this->X_BufferCache != xbnullptr && (this->EmuFlags & DSE_FLAG_BUFFER_EXTERNAL) == 0) {
-        free(this->X_BufferCache);
         DSoundSGEMemDealloc(this->X_BufferCacheSize);
     }
+    this->X_BufferCacheTracker.Release();
 }
 
 // ******************************************************************
@@ -151,6 +157,8 @@ ULONG WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Release)
         uRet = pThis->EmuDirectSoundBuffer8->Release();
 
         if (uRet == 0) {
+            g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_RELEASE, pHybridThis);
+
             size_t size = sizeof(SharedDSBuffer) - sizeof(XbHybridDSBuffer);
             SharedDSBuffer* pSharedThis = reinterpret_cast<SharedDSBuffer*>(reinterpret_cast<uint8_t*>(pHybridThis) - size);
             delete pSharedThis;
@@ -227,7 +235,8 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
 
         // We have to set DSBufferDesc last due to EmuFlags must be either 0 or previously written value to preserve other flags.
         GeneratePCMFormat(DSBufferDesc, pdsbd->lpwfxFormat, pdsbd->dwFlags, pEmuBuffer->EmuFlags, pdsbd->dwBufferBytes,
-                          &pEmuBuffer->X_BufferCache, pEmuBuffer->X_BufferCacheSize, pEmuBuffer->Xb_VoiceProperties, pdsbd->lpMixBinsOutput,
+                          &pEmuBuffer->X_BufferCache, pEmuBuffer->X_BufferCacheSize, &pEmuBuffer->X_BufferCacheTracker,
+                          pEmuBuffer->Xb_VoiceProperties, pdsbd->lpMixBinsOutput,
                           pHybridBuffer->p_CDSVoice);
         pEmuBuffer->EmuBufferDesc = DSBufferDesc;
 
@@ -247,14 +256,19 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
             if (pdsbd->dwFlags & DSBCAPS_CTRL3D) {
                 DSound3DBufferCreate(pEmuBuffer->EmuDirectSoundBuffer8, pEmuBuffer->EmuDirectSound3DBuffer8);
             }
+            SoftwareDSoundBuffer_SetMixBins(pEmuBuffer->EmuDirectSoundBuffer8, pEmuBuffer->Xb_VoiceProperties);
 
             DSoundDebugMuteFlag(pEmuBuffer->X_BufferCacheSize, pEmuBuffer->EmuFlags);
 
             // Pre-set volume to enforce silence if one of audio codec is disabled.
-            HybridDirectSoundBuffer_SetVolume(pEmuBuffer->EmuDirectSoundBuffer8, 0L, pEmuBuffer->EmuFlags,
+            HybridDirectSoundBuffer_SetVolume(pEmuBuffer->EmuDirectSoundBuffer8, pEmuBuffer->Host_params, 0L, pEmuBuffer->EmuFlags,
                 pEmuBuffer->Xb_VolumeMixbin, pHybridBuffer->p_CDSVoice);
 
             g_pDSoundBufferCache.push_back(pHybridBuffer);
+
+            DSoundTraceFormat traceFormat = DSoundTraceGetFormat(pdsbd->lpwfxFormat);
+            g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_CREATE, pHybridBuffer, pdsbd->dwFlags, pdsbd->dwBufferBytes,
+                                 &traceFormat, sizeof(traceFormat));
         }
     }
 
@@ -291,7 +305,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetCurrentPosition)
     OUT PDWORD                  pdwCurrentPlayCursor,
     OUT PDWORD                  pdwCurrentWriteCursor)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -313,13 +327,15 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetCurrentPosition)
     XbHybridDSBuffer*       pHybridThis,
     DWORD                   dwNewPosition)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
 		LOG_FUNC_ARG(dwNewPosition)
 		LOG_FUNC_END;
 
+    g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_POSITION, pHybridThis, dwNewPosition);
+
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
     dwNewPosition = DSoundBufferGetPCMBufferSize(pThis->EmuFlags, dwNewPosition);
 
@@ -341,7 +357,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetStatus)
     XbHybridDSBuffer*       pHybridThis,
     OUT LPDWORD             pdwStatus)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -381,7 +397,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetVoiceProperties)
     XbHybridDSBuffer*       pHybridThis,
     OUT X_DSVOICEPROPS*     pVoiceProps)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pHybridThis)
@@ -413,7 +429,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
     LPDWORD                 pdwAudioBytes2,
     DWORD                   dwFlags)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -436,6 +452,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
                         pThis->X_BufferCache,
+                        pThis->X_BufferCacheTracker,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
                         pThis->X_lock.dwLockBytes2);
@@ -477,6 +494,11 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
         }
     }
 
+    // Host lock maps the whole cache, anything written through this lock has to reach it.
+    pThis->X_BufferCacheTracker.SetHostBase(0, pThis->X_BufferCacheSize);
+    pThis->X_BufferCacheTracker.BeginLock(dwOffset, pThis->X_lock.dwLockBytes1,
+                                          pThis->Host_lock.pLockPtr2 != nullptr ? pThis->X_lock.dwLockBytes2 : 0);
+
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -492,7 +514,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Unlock)
     DWORD                   pdwAudioBytes2
     )
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pHybridThis)
@@ -503,17 +525,18 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Unlock)
         LOG_FUNC_END;
 
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
+    if (g_DSoundTrace.IsOpen() && pThis->X_BufferCache != xbnullptr && ppvAudioPtr1 != xbnullptr) {
+        g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_DATA, pHybridThis, pThis->X_lock.dwLockOffset, 0, ppvAudioPtr1, pdwAudioBytes1);
+        if (ppvAudioPtr2 != xbnullptr) {
+            g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_DATA, pHybridThis, 0, 0, ppvAudioPtr2, pdwAudioBytes2);
+        }
+    }
+
+    // Lock pointers are handed out straight from X_BufferCache, so there is nothing to copy back.
+    // Narrow the pending upload down to what title reports as written.
     // TODO: Find out why pThis->EmuLockPtr1 is nullptr... (workaround atm is to check if it is not a nullptr.)
     if (pThis->X_BufferCache != xbnullptr && pThis->Host_lock.pLockPtr1 != nullptr) {
-
-        memcpy_s((PBYTE)pThis->X_BufferCache + pThis->X_lock.dwLockOffset,
-                 pThis->X_BufferCacheSize - pThis->X_lock.dwLockOffset,
-                 pThis->X_lock.pLockPtr1,
-                 pThis->X_lock.dwLockBytes1);
-
-        if (pThis->Host_lock.pLockPtr2 != nullptr) {
-            memcpy_s(pThis->X_BufferCache, pThis->X_BufferCacheSize, pThis->X_lock.pLockPtr2, pThis->X_lock.dwLockBytes2);
-        }
+        pThis->X_BufferCacheTracker.EndLock(pdwAudioBytes1, ppvAudioPtr2 != xbnullptr ? pdwAudioBytes2 : 0);
     }
 
     DSoundGenericUnlock(pThis->EmuFlags,
@@ -521,6 +544,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Unlock)
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
                         pThis->X_BufferCache,
+                        pThis->X_BufferCacheTracker,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
                         pThis->X_lock.dwLockBytes2);
@@ -537,19 +561,22 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Pause)
     XbHybridDSBuffer*       pHybridThis,
     DWORD                   dwPause)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
 		LOG_FUNC_ARG(dwPause)
 		LOG_FUNC_END;
 
+    g_DSoundTrace.Record(DSOUND_TRACE_PAUSE, pHybridThis, dwPause);
+
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
     DSoundGenericUnlock(pThis->EmuFlags,
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
                         pThis->X_BufferCache,
+                        pThis->X_BufferCacheTracker,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
                         pThis->X_lock.dwLockBytes2);
@@ -570,7 +597,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PauseEx)
     REFERENCE_TIME          rtTimestamp,
     DWORD                   dwPause)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -578,6 +605,8 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PauseEx)
 		LOG_FUNC_ARG(dwPause)
 		LOG_FUNC_END;
 
+    g_DSoundTrace.Record(DSOUND_TRACE_PAUSE, pHybridThis, dwPause);
+
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
     HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
                                                  1, rtTimestamp, pThis->Xb_rtPauseEx);
@@ -595,7 +624,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Play)
     DWORD                   dwReserved2,
     DWORD                   dwFlags)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -605,11 +634,18 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Play)
 		LOG_FUNC_END;
 
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
+    // Title writes into its own buffer don't go through Lock/Unlock, capture the contents as they are played.
+    if ((pThis->EmuFlags & DSE_FLAG_BUFFER_EXTERNAL) > 0) {
+        g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_DATA, pHybridThis, 0, 0, pThis->X_BufferCache, pThis->X_BufferCacheSize);
+    }
+    g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_PLAY, pHybridThis, dwFlags);
+
     DSoundGenericUnlock(pThis->EmuFlags,
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
                         pThis->X_BufferCache,
+                        pThis->X_BufferCacheTracker,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
                         pThis->X_lock.dwLockBytes2);
@@ -658,7 +694,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PlayEx)
     REFERENCE_TIME        rtTimeStamp,
     DWORD                 dwFlags)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -685,7 +721,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetAllParameters)
     X_DS3DBUFFER*            pc3DBufferParameters,
     DWORD                    dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -708,7 +744,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
     LPVOID                  pvBufferData,
     DWORD                   dwBufferBytes)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pHybridThis)
@@ -726,6 +762,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
                             pThis->EmuBufferDesc,
                             pThis->Host_lock,
                             xbnullptr,
+                            pThis->X_BufferCacheTracker,
                             pThis->X_lock.dwLockOffset,
                             pThis->X_lock.dwLockBytes1,
                             pThis->X_lock.dwLockBytes2);
@@ -752,10 +789,12 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
         // Confirmed it perform a reset to default.
         DSoundBufferRegionSetDefault(pThis);
 
-        GenerateXboxBufferCache(pThis->EmuBufferDesc, pThis->EmuFlags, dwBufferBytes, &pThis->X_BufferCache, pThis->X_BufferCacheSize);
+        GenerateXboxBufferCache(pThis->EmuBufferDesc, pThis->EmuFlags, dwBufferBytes, &pThis->X_BufferCache, pThis->X_BufferCacheSize,
+                                pThis->X_BufferCacheTracker);
 
         // Copy if given valid pointer.
         memcpy_s(pThis->X_BufferCache, pThis->X_BufferCacheSize, pvBufferData, dwBufferBytes);
+        pThis->X_BufferCacheTracker.MarkDirty(0, dwBufferBytes);
 
         pThis->EmuFlags  ^= DSE_FLAG_BUFFER_EXTERNAL;
 
@@ -767,11 +806,12 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
     } else if (pvBufferData != xbnullptr) {
         // Free internal buffer cache if exist
         if ((pThis->EmuFlags & DSE_FLAG_BUFFER_EXTERNAL) == 0) {
-            free(pThis->X_BufferCache);
             DSoundSGEMemDealloc(pThis->X_BufferCacheSize);
         }
+        pThis->X_BufferCacheTracker.Release();
         pThis->X_BufferCache = pvBufferData;
         pThis->X_BufferCacheSize = dwBufferBytes;
+        pThis->X_BufferCacheTracker.MarkDirty(0, dwBufferBytes);
         pThis->EmuFlags |= DSE_FLAG_BUFFER_EXTERNAL;
 
         DSoundDebugMuteFlag(pThis->X_BufferCacheSize, pThis->EmuFlags);
@@ -781,6 +821,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
 
     }
 
+    if (hRet == DS_OK) {
+        g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_RESIZE, pHybridThis, dwBufferBytes);
+        if (pvBufferData != xbnullptr) {
+            g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_DATA, pHybridThis, 0, 0, pvBufferData, dwBufferBytes);
+        }
+    }
+
     return hRet;
 }
 
@@ -794,7 +841,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetConeAngles)
     DWORD                   dwOutsideConeAngle,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -820,7 +867,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetConeOrientation)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -845,7 +892,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetConeOutsideVolume)
     LONG                    lConeOutsideVolume,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -868,7 +915,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetDistanceFactor)
     FLOAT                   flDistanceFactor,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -890,7 +937,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetDopplerFactor)
     FLOAT                   flDopplerFactor,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -911,7 +958,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetEG)
     XbHybridDSBuffer*       pHybridThis,
     X_DSENVOLOPEDESC*       pEnvelopeDesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -936,7 +983,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFilter)
     XbHybridDSBuffer*       pHybridThis,
     X_DSFILTERDESC*         pFilterDesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -959,7 +1006,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFormat)
     XbHybridDSBuffer*       pHybridThis,
     LPCWAVEFORMATEX         pwfxFormat)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -967,12 +1014,18 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFormat)
 		LOG_FUNC_END;
 
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-    HRESULT hRet = HybridDirectSoundBuffer_SetFormat(pThis->EmuDirectSoundBuffer8, pwfxFormat, pThis->Xb_Flags,
+    HRESULT hRet = HybridDirectSoundBuffer_SetFormat(pThis->EmuDirectSoundBuffer8, pThis->Host_params, pwfxFormat, pThis->Xb_Flags,
                                                      pThis->EmuBufferDesc, pThis->EmuFlags,
                                                      pThis->EmuPlayFlags, pThis->EmuDirectSound3DBuffer8,
                                                      0, pThis->X_BufferCache, pThis->X_BufferCacheSize,
                                                      pThis->Xb_VoiceProperties, xbnullptr, pHybridThis->p_CDSVoice);
 
+    DSoundTraceFormat traceFormat = DSoundTraceGetFormat(pwfxFormat);
+    g_DSoundTrace.Record(DSOUND_TRACE_FORMAT, pHybridThis, 0, 0, &traceFormat, sizeof(traceFormat));
+
+    // Host buffer got recreated in the new format.
+    pThis->X_BufferCacheTracker.MarkDirty(0, pThis->X_BufferCacheSize);
+
     return hRet;
 }
 
@@ -984,15 +1037,17 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFrequency)
     XbHybridDSBuffer*       pHybridThis,
     DWORD                   dwFrequency)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
 		LOG_FUNC_ARG(dwFrequency)
 		LOG_FUNC_END;
 
+    g_DSoundTrace.Record(DSOUND_TRACE_FREQUENCY, pHybridThis, dwFrequency);
+
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency,
+    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, pThis->Host_params, dwFrequency,
                                                         pHybridThis->p_CDSVoice);
 
     return hRet;
@@ -1006,7 +1061,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetHeadroom)
     XbHybridDSBuffer*       pHybridThis,
     DWORD                   dwHeadroom)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1014,7 +1069,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetHeadroom)
 		LOG_FUNC_END;
 
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-    HRESULT hRet = HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, dwHeadroom,
+    HRESULT hRet = HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, pThis->Host_params, dwHeadroom,
                                                        pThis->Xb_VolumeMixbin, pThis->EmuFlags,
                                                        pHybridThis->p_CDSVoice);
 
@@ -1030,7 +1085,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetI3DL2Source)
     X_DSI3DL2BUFFER*        pds3db,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1055,7 +1110,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetLFO) //Low Frequency Oscillat
     XbHybridDSBuffer*       pHybridThis,
     LPCDSLFODESC            pLFODesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1078,7 +1133,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetLoopRegion)
     DWORD                   dwLoopStart,
     DWORD                   dwLoopLength)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1120,7 +1175,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMaxDistance)
     FLOAT                   flMaxDistance,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1143,7 +1198,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMinDistance)
     FLOAT                   flMinDistance,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1165,7 +1220,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBins)
     XbHybridDSBuffer*       pHybridThis,
     DWORD                   dwMixBinMask)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
     HRESULT hRet = DS_OK;
     X_LPDSMIXBINS pMixBins = reinterpret_cast<X_LPDSMIXBINS>(dwMixBinMask);
 
@@ -1184,7 +1239,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBins)
             LOG_FUNC_END;
 
         EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-        hRet = HybridDirectSoundBuffer_SetMixBins(pThis->Xb_VoiceProperties, pMixBins, pThis->EmuBufferDesc.lpwfxFormat, pThis->EmuBufferDesc);
+        hRet = HybridDirectSoundBuffer_SetMixBins(pThis->EmuDirectSoundBuffer8, pThis->Xb_VoiceProperties, pMixBins, pThis->EmuBufferDesc.lpwfxFormat, pThis->EmuBufferDesc);
     }
 
     return hRet;
@@ -1200,7 +1255,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBinVolumes_12)
     DWORD                   dwMixBinMask,
     const LONG*             alVolumes)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pHybridThis)
@@ -1225,7 +1280,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBinVolumes_8)
     XbHybridDSBuffer*       pHybridThis,
     X_LPDSMIXBINS           pMixBins)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1233,7 +1288,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBinVolumes_8)
 		LOG_FUNC_END;
 
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-    HRESULT hRet = HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pMixBins, pThis->Xb_VoiceProperties,
+    HRESULT hRet = HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pThis->Host_params, pMixBins, pThis->Xb_VoiceProperties,
                                                               pThis->EmuFlags, pThis->Xb_VolumeMixbin, pHybridThis->p_CDSVoice);
 
     return hRet;
@@ -1248,7 +1303,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMode)
     DWORD                   dwMode,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1271,7 +1326,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetNotificationPositions)
     DWORD                   dwNotifyCount,
     LPCDSBPOSITIONNOTIFY    paNotifies)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1316,7 +1371,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetOutputBuffer)
     XbHybridDSBuffer*   pHybridThis,
     XbHybridDSBuffer*   pOutputBuffer)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1340,15 +1395,17 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPitch)
     XbHybridDSBuffer*       pHybridThis,
     LONG                    lPitch)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
 		LOG_FUNC_ARG(lPitch)
 		LOG_FUNC_END;
 
+    g_DSoundTrace.Record(DSOUND_TRACE_PITCH, pHybridThis, lPitch);
+
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch,
+    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, pThis->Host_params, lPitch,
                                                     pHybridThis->p_CDSVoice);
 
     return hRet;
@@ -1363,7 +1420,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPlayRegion)
     DWORD                   dwPlayStart,
     DWORD                   dwPlayLength)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1410,7 +1467,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPosition)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1436,7 +1493,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetRolloffCurve)
     DWORD                   dwPointCount,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1461,7 +1518,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetRolloffFactor)
     FLOAT                   flRolloffFactor,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1487,7 +1544,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetVelocity)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -1511,15 +1568,17 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetVolume)
     XbHybridDSBuffer*       pHybridThis,
     LONG                    lVolume)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
 		LOG_FUNC_ARG(lVolume)
 		LOG_FUNC_END;
 
+    g_DSoundTrace.Record(DSOUND_TRACE_VOLUME, pHybridThis, lVolume);
+
     EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
-    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags,
+    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, pThis->Host_params, lVolume, pThis->EmuFlags,
                                                      pThis->Xb_VolumeMixbin, pHybridThis->p_CDSVoice);
 
     return hRet;
@@ -1532,13 +1591,15 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Stop)
 (
     XbHybridDSBuffer*       pHybridThis)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_ONE_ARG(pHybridThis);
 
     HRESULT hRet = D3D_OK;
 
     if (pHybridThis != nullptr) {
+        g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_STOP, pHybridThis);
+
         // TODO : Test Stop (emulated via Stop + SetCurrentPosition(0)) :
         EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
         hRet = pThis->EmuDirectSoundBuffer8->Stop();
@@ -1557,7 +1618,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_StopEx)
     REFERENCE_TIME          rtTimeStamp,
     DWORD                   dwFlags)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pHybridThis)
@@ -1577,6 +1638,8 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_StopEx)
 
     // Only flags can be process here.
     } else {
+        g_DSoundTrace.Record(DSOUND_TRACE_BUFFER_STOP, pHybridThis);
+
         if (dwFlags == X_DSBSTOPEX_IMMEDIATE) {
             hRet = pThis->EmuDirectSoundBuffer8->Stop();
             pThis->Xb_rtStopEx = 0LL;
@@ -1651,7 +1714,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Set3DVoiceData)
     DWORD a2
 )
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pHybridThis)
@@ -1671,7 +1734,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Use3DVoiceData)
     XbHybridDSBuffer*       pHybridThis,
     LPUNKNOWN               pUnknown)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pHybridThis->emuDSBuffer);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pHybridThis)
@@ -34,7 +34,12 @@ namespace xboxkrnl {
 #include "DirectSoundGlobal.hpp"
 
 Settings::s_audio            g_XBAudio = { 0 };
-std::recursive_mutex         g_DSoundMutex;
+DSoundLockCounters           g_DSoundGlobalLockCounters;
+DSoundLockCounters           g_DSoundObjectLockCounters;
+DSoundLockCounters           g_DSoundListenerLockCounters;
+DSoundMutex                  g_DSoundMutex(g_DSoundGlobalLockCounters);
+DSoundMutex                  g_DSoundListenerMutex(g_DSoundListenerLockCounters);
+HANDLE                       g_DSoundStreamEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
 //Currently disabled since below may not be needed since under -6,400 is just silence yet accepting up to -10,000
 // Xbox to PC volume ratio format (-10,000 / -6,400 )
@@ -48,8 +53,8 @@ LPDIRECTSOUNDBUFFER          g_pDSoundPrimaryBuffer = nullptr;
 LPDIRECTSOUNDBUFFER8         g_pDSoundPrimaryBuffer8 = nullptr;
 LPDIRECTSOUND3DLISTENER8     g_pDSoundPrimary3DListener8 = nullptr;
 int                          g_bDSoundCreateCalled = FALSE;
-unsigned int                        g_iDSoundSynchPlaybackCounter = 0;
+std::atomic<unsigned int>           g_iDSoundSynchPlaybackCounter(0);
 // Managed memory xbox audio variables
-DWORD                               g_dwXbMemAllocated = 0;
+std::atomic<DWORD>                  g_dwXbMemAllocated(0);
 DWORD                               g_dwFree2DBuffers = 0;
 DWORD                               g_dwFree3DBuffers = 0;
@@ -35,8 +35,16 @@
 #include "common/Settings.hpp"
 
 extern Settings::s_audio            g_XBAudio;
-extern std::recursive_mutex         g_DSoundMutex;
-#define DSoundMutexGuardLock        std::lock_guard<std::recursive_mutex> guard(g_DSoundMutex)
+// Lock order is g_DSoundMutex, then a buffer's or stream's own Host_Mutex, then g_DSoundListenerMutex.
+// g_DSoundMutex guards DirectSound creation, the buffer/stream caches and any walk over them.
+extern DSoundMutex                  g_DSoundMutex;
+extern DSoundMutex                  g_DSoundListenerMutex;
+#define DSoundMutexGuardLock        std::lock_guard<DSoundMutex> guard(g_DSoundMutex)
+#define DSoundObjectGuardLock(pObj) std::lock_guard<DSoundMutex> guardObject((pObj)->Host_Mutex)
+#define DSoundListenerGuardLock     std::lock_guard<DSoundMutex> guardListener(g_DSoundListenerMutex)
+// Auto-reset event the stream worker thread waits on between packet deadlines.
+extern HANDLE                       g_DSoundStreamEvent;
+#define DSoundStreamWorkerWake()    SetEvent(g_DSoundStreamEvent)
 
 //Currently disabled since below may not be needed since under -6,400 is just silence yet accepting up to -10,000
 // Xbox to PC volume ratio format (-10,000 / -6,400 )
@@ -55,9 +63,9 @@ extern LPDIRECTSOUNDBUFFER          g_pDSoundPrimaryBuffer;
 extern LPDIRECTSOUNDBUFFER8         g_pDSoundPrimaryBuffer8;
 extern LPDIRECTSOUND3DLISTENER8     g_pDSoundPrimary3DListener8;
 extern int                          g_bDSoundCreateCalled;
-extern unsigned int                        g_iDSoundSynchPlaybackCounter;
+extern std::atomic<unsigned int>           g_iDSoundSynchPlaybackCounter;
 // Managed memory xbox audio variables
-extern DWORD                               g_dwXbMemAllocated;
+extern std::atomic<DWORD>                  g_dwXbMemAllocated;
 extern DWORD                               g_dwFree2DBuffers;
 extern DWORD                               g_dwFree3DBuffers;
 
@@ -73,4 +81,5 @@ extern DWORD                               g_dwFree3DBuffers;
     " function, and file name to https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/issues/485"); } return hRet; }
 
 extern void DirectSoundDoWork_Buffer(xboxkrnl::LARGE_INTEGER& time);
-extern void DirectSoundDoWork_Stream(xboxkrnl::LARGE_INTEGER& time);
+// Returns how many milliseconds the worker may wait before the next stream needs servicing.
+extern DWORD DirectSoundDoWork_Stream(xboxkrnl::LARGE_INTEGER& time);
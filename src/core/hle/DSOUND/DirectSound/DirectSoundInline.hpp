@@ -31,11 +31,13 @@
 #include "common/XADPCM.h"
 #include "core/hle/DSOUND/XbDSoundTypes.h"
 #include "core/hle/DSOUND/common/windows/WFXformat.hpp"
+#include "core/hle/DSOUND/common/windows/SoftwareDSound.hpp"
+#include "core/hle/DSOUND/common/DSoundTrace.hpp"
 
 #include <mmreg.h>
 
-#define DSoundBufferGetPCMBufferSize(EmuFlags, size) (EmuFlags & DSE_FLAG_XADPCM) > 0 ? DWORD((size / float(XBOX_ADPCM_SRCSIZE)) * XBOX_ADPCM_DSTSIZE) : size
-#define DSoundBufferGetXboxBufferSize(EmuFlags, size) (EmuFlags & DSE_FLAG_XADPCM) > 0 ? DWORD((size / float(XBOX_ADPCM_DSTSIZE)) * XBOX_ADPCM_SRCSIZE) : size
+#define DSoundBufferGetPCMBufferSize(EmuFlags, size) ((((EmuFlags) & DSE_FLAG_XADPCM) > 0) ? DWORD(((size) / float(XBOX_ADPCM_SRCSIZE)) * XBOX_ADPCM_DSTSIZE) : (size))
+#define DSoundBufferGetXboxBufferSize(EmuFlags, size) ((((EmuFlags) & DSE_FLAG_XADPCM) > 0) ? DWORD(((size) / float(XBOX_ADPCM_DSTSIZE)) * XBOX_ADPCM_SRCSIZE) : (size))
 
 typedef struct IDirectSound3DBuffer8* LPDIRECTSOUND3DBUFFER8;
 typedef LONGLONG REFERENCE_TIME;
@@ -89,35 +91,42 @@ static void DSoundBufferOutputXBtoHost(DWORD emuFlags, DSBUFFERDESC &DSBufferDes
     }
 }
 
+static inline DSoundTraceFormat DSoundTraceGetFormat(LPCWAVEFORMATEX Xb_lpwfxFormat) {
+    DSoundTraceFormat format = { 0 };
+    if (Xb_lpwfxFormat != xbnullptr) {
+        format.FormatTag = Xb_lpwfxFormat->wFormatTag;
+        format.Channels = Xb_lpwfxFormat->nChannels;
+        format.SamplesPerSec = Xb_lpwfxFormat->nSamplesPerSec;
+        format.BitsPerSample = Xb_lpwfxFormat->wBitsPerSample;
+        format.BlockAlign = Xb_lpwfxFormat->nBlockAlign;
+    }
+    return format;
+}
+
 static inline void GenerateXboxBufferCache(
     DSBUFFERDESC   &DSBufferDesc,
     DWORD          &dwEmuFlags,
     DWORD           X_BufferSizeRequest,
     LPVOID*         X_BufferCache,
-    DWORD          &X_BufferCacheSize) {
+    DWORD          &X_BufferCacheSize,
+    DSoundBufferCache& X_BufferCacheTracker) {
 
     // Generate xbox buffer cache size
     // If the size is the same, don't realloc
     if (X_BufferCacheSize != X_BufferSizeRequest) {
-        // Check if buffer cache exist, then copy over old ones.
+        // Check if buffer cache exist, then keep old contents. Capacity grows geometrically,
+        // so a buffer resized back and forth does not realloc every time.
         if (*X_BufferCache != xbnullptr && (dwEmuFlags & DSE_FLAG_BUFFER_EXTERNAL) == 0) {
-            LPVOID tempBuffer = *X_BufferCache;
-            *X_BufferCache = malloc(X_BufferSizeRequest);
-
             // This will perform partial alloc/dealloc instead of call twice for alloc and dealloc functions.
             DSoundSGEMemAlloc(X_BufferSizeRequest - X_BufferCacheSize);
-
-            // Don't copy over the limit.
-            if (X_BufferCacheSize > X_BufferSizeRequest) {
-                X_BufferCacheSize = X_BufferSizeRequest;
-            }
-            memcpy_s(*X_BufferCache, X_BufferSizeRequest, tempBuffer, X_BufferCacheSize);
-            free(tempBuffer);
         } else {
-            *X_BufferCache = calloc(1, X_BufferSizeRequest);
+            // External buffer belongs to title, start from an empty cache.
+            X_BufferCacheTracker.Release();
             DSoundSGEMemAlloc(X_BufferSizeRequest);
         }
+        *X_BufferCache = X_BufferCacheTracker.Resize(X_BufferSizeRequest);
         X_BufferCacheSize = X_BufferSizeRequest;
+        X_BufferCacheTracker.MarkDirty(0, X_BufferCacheSize);
     }
 }
 
@@ -253,6 +262,7 @@ static inline void GeneratePCMFormat(
     DWORD           X_BufferSizeRequest,
     LPVOID*         X_BufferCache,
     DWORD          &X_BufferCacheSize,
+    DSoundBufferCache* X_BufferCacheTracker,
     XTL::X_DSVOICEPROPS& Xb_VoiceProperties,
     XTL::X_LPDSMIXBINS mixbins_output,
     XTL::CDirectSoundVoice* Xb_Voice)
@@ -319,7 +329,7 @@ static inline void GeneratePCMFormat(
         X_BufferSizeRequest = DSBSIZE_MAX;
     }
     if (X_BufferCache != nullptr) {
-        GenerateXboxBufferCache(DSBufferDesc, dwEmuFlags, X_BufferSizeRequest, X_BufferCache, X_BufferCacheSize);
+        GenerateXboxBufferCache(DSBufferDesc, dwEmuFlags, X_BufferSizeRequest, X_BufferCache, X_BufferCacheSize, *X_BufferCacheTracker);
     }
 
     // Handle DSound Buffer only
@@ -328,12 +338,60 @@ static inline void GeneratePCMFormat(
     }
 }
 
+// Converts only the parts of [X_Offset, X_Offset + X_dwBytes) changed since the last upload,
+// pHostPtr receives the converted X_Offset.
+static inline void DSoundBufferUploadDirty(
+    DWORD                   dwEmuFlags,
+    DSBUFFERDESC           &DSBufferDesc,
+    DSoundBufferCache      &X_BufferCacheTracker,
+    LPVOID                  X_BufferCache,
+    DWORD                   X_Offset,
+    DWORD                   X_dwBytes,
+    LPVOID                  pHostPtr,
+    DWORD                   dwHostBytes)
+{
+    // XADPCM can only be decoded in whole blocks.
+    DWORD X_dwAlign = (dwEmuFlags & DSE_FLAG_XADPCM) > 0 ? XBOX_ADPCM_SRCSIZE * DSBufferDesc.lpwfxFormat->nChannels
+                                                         : DSBufferDesc.lpwfxFormat->nBlockAlign;
+    if (X_dwAlign == 0) {
+        X_dwAlign = 1;
+    }
+
+    // Title writes into its own buffer are not tracked, always convert the whole range.
+    if ((dwEmuFlags & DSE_FLAG_BUFFER_EXTERNAL) > 0) {
+        X_BufferCacheTracker.MarkDirty(X_Offset, X_dwBytes);
+    }
+
+    X_BufferCacheTracker.Upload(X_Offset, X_dwBytes, X_dwAlign, [&](uint32_t X_dwRangeOffset, uint32_t X_dwRangeBytes) -> uint32_t {
+        DWORD X_dwRangeDelta = X_dwRangeOffset - X_Offset;
+        DWORD dwHostOffset = DSoundBufferGetPCMBufferSize(dwEmuFlags, X_dwRangeDelta);
+        DWORD dwHostRangeBytes = DSoundBufferGetPCMBufferSize(dwEmuFlags, X_dwRangeBytes);
+
+        if (dwHostOffset >= dwHostBytes) {
+            return 0;
+        }
+        // Only convert what fits in the host range, in whole blocks, the rest stays dirty.
+        if (dwHostRangeBytes > dwHostBytes - dwHostOffset) {
+            DWORD X_dwFitBytes = DSoundBufferGetXboxBufferSize(dwEmuFlags, dwHostBytes - dwHostOffset);
+            X_dwRangeBytes = X_dwFitBytes / X_dwAlign * X_dwAlign;
+            if (X_dwRangeBytes == 0) {
+                return 0;
+            }
+            dwHostRangeBytes = DSoundBufferGetPCMBufferSize(dwEmuFlags, X_dwRangeBytes);
+        }
+        DSoundBufferOutputXBtoHost(dwEmuFlags, DSBufferDesc, (PBYTE)X_BufferCache + X_dwRangeOffset, X_dwRangeBytes,
+                                   (PBYTE)pHostPtr + dwHostOffset, dwHostRangeBytes);
+        return X_dwRangeBytes;
+    });
+}
+
 static inline void DSoundGenericUnlock(
     DWORD                   dwEmuFlags,
     LPDIRECTSOUNDBUFFER8    pDSBuffer,
     DSBUFFERDESC           &DSBufferDesc,
     XTL::DSoundBuffer_Lock &Host_lock,
     LPVOID                  X_BufferCache,
+    DSoundBufferCache      &X_BufferCacheTracker,
     DWORD                   X_Offset,
     DWORD                   X_dwLockBytes1,
     DWORD                   X_dwLockBytes2)
@@ -343,11 +401,11 @@ static inline void DSoundGenericUnlock(
 
 
         if (X_BufferCache != xbnullptr) {
-            DSoundBufferOutputXBtoHost(dwEmuFlags, DSBufferDesc, ((PBYTE)X_BufferCache + X_Offset), X_dwLockBytes1, Host_lock.pLockPtr1, Host_lock.dwLockBytes1);
+            DSoundBufferUploadDirty(dwEmuFlags, DSBufferDesc, X_BufferCacheTracker, X_BufferCache, X_Offset, X_dwLockBytes1, Host_lock.pLockPtr1, Host_lock.dwLockBytes1);
 
             if (Host_lock.pLockPtr2 != nullptr) {
 
-                DSoundBufferOutputXBtoHost(dwEmuFlags, DSBufferDesc, X_BufferCache, X_dwLockBytes2, Host_lock.pLockPtr2, Host_lock.dwLockBytes2);
+                DSoundBufferUploadDirty(dwEmuFlags, DSBufferDesc, X_BufferCacheTracker, X_BufferCache, 0, X_dwLockBytes2, Host_lock.pLockPtr2, Host_lock.dwLockBytes2);
             }
         }
 
@@ -417,6 +475,7 @@ static inline void DSoundBufferTransferSettings(
     LPDIRECTSOUNDBUFFER8       &pDSBufferNew,
     LPDIRECTSOUND3DBUFFER8     &pDS3DBufferOld,
     LPDIRECTSOUND3DBUFFER8     &pDS3DBufferNew,
+    XTL::DSoundHostParams      &Host_params,
     XTL::CDirectSoundVoice*     Xb_Voice)
 {
     LONG lVolume, lPan;
@@ -429,9 +488,13 @@ static inline void DSoundBufferTransferSettings(
     // if sync current frequency used (then use pitch only).
     uint32_t freq = converter_pitch2freq(Xb_Voice->GetPitch());
     pDSBufferNew->SetFrequency(freq);
+    Host_params.dwFrequency = freq;
 
     pDSBufferOld->GetVolume(&lVolume);
     pDSBufferNew->SetVolume(lVolume);
+    Host_params.lVolume = lVolume;
+
+    SoftwareDSoundBuffer_TransferMixBins(pDSBufferOld, pDSBufferNew);
 
     if (pDS3DBufferOld != nullptr && pDS3DBufferNew != nullptr) {
         pDS3DBufferOld->GetAllParameters(&ds3dBuffer);
@@ -449,6 +512,7 @@ static inline void DSoundBufferReCreate(
     LPDIRECTSOUND3DBUFFER8     &pDS3DBuffer,
     LPDIRECTSOUNDBUFFER8       &pDSBufferNew,
     LPDIRECTSOUND3DBUFFER8     &pDS3DBufferNew,
+    XTL::DSoundHostParams      &Host_params,
     XTL::CDirectSoundVoice*     Xb_Voice) {
 
 
@@ -458,7 +522,7 @@ static inline void DSoundBufferReCreate(
         DSound3DBufferCreate(pDSBufferNew, pDS3DBufferNew);
     }
 
-    DSoundBufferTransferSettings(pDSBuffer, pDSBufferNew, pDS3DBuffer, pDS3DBufferNew, Xb_Voice);
+    DSoundBufferTransferSettings(pDSBuffer, pDSBufferNew, pDS3DBuffer, pDS3DBufferNew, Host_params, Xb_Voice);
 }
 
 static inline void DSoundBufferRelease(
@@ -509,7 +573,7 @@ static inline void DSoundBufferResizeSetSize(
     LPDIRECTSOUND3DBUFFER8       pDS3DBufferNew = nullptr;
 
     DSoundBufferReCreate(pThis->EmuDirectSoundBuffer8, pThis->EmuBufferDesc, pThis->EmuDirectSound3DBuffer8,
-                         pDSBufferNew, pDS3DBufferNew, pHybridThis->p_CDSVoice);
+                         pDSBufferNew, pDS3DBufferNew, pThis->Host_params, pHybridThis->p_CDSVoice);
 
     // release old buffer
     DSoundBufferRelease(pThis->EmuDirectSoundBuffer8, pThis->EmuDirectSound3DBuffer8, refCount);
@@ -530,8 +594,15 @@ static inline void DSoundBufferResizeUpdate(
     DWORD                       Xb_dwByteLength) {
 
     XTL::EmuDirectSoundBuffer* pThis = pHybridThis->emuDSBuffer;
+    LPDIRECTSOUNDBUFFER8 pDSBufferOld = pThis->EmuDirectSoundBuffer8;
     DSoundBufferResizeSetSize(pHybridThis, hRet, Xb_dwByteLength);
 
+    // A new host buffer starts out empty, and moving the region shifts everything in it.
+    if (pThis->EmuDirectSoundBuffer8 != pDSBufferOld) {
+        pThis->X_BufferCacheTracker.MarkDirty(0, pThis->X_BufferCacheSize);
+    }
+    pThis->X_BufferCacheTracker.SetHostBase(Xb_dwStartOffset, pThis->X_BufferCacheSize);
+
     hRet = pThis->EmuDirectSoundBuffer8->Lock(0, 0, &pThis->Host_lock.pLockPtr1, &pThis->Host_lock.dwLockBytes1,
                                               nullptr, nullptr, DSBLOCK_ENTIREBUFFER);
     if (hRet != DS_OK) {
@@ -542,6 +613,7 @@ static inline void DSoundBufferResizeUpdate(
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
                         pThis->X_BufferCache,
+                        pThis->X_BufferCacheTracker,
                         Xb_dwStartOffset,
                         Xb_dwByteLength,
                         0);
@@ -599,6 +671,7 @@ static inline void DSoundBufferRegenWithNewFormat(
     DSBUFFERDESC               &DSBufferDesc,
     DWORD                       PlayFlags,
     LPDIRECTSOUND3DBUFFER8     &pDS3DBuffer,
+    XTL::DSoundHostParams      &Host_params,
     XTL::CDirectSoundVoice*   Xb_Voice)
 {
     DWORD refCount, dwPlayCursor, dwStatus;
@@ -606,7 +679,7 @@ static inline void DSoundBufferRegenWithNewFormat(
     LPDIRECTSOUND3DBUFFER8       pDS3DBufferNew = nullptr;
 
     DSoundBufferReCreate(pDSBuffer, DSBufferDesc, pDS3DBuffer,
-                         pDSBufferNew, pDS3DBufferNew, Xb_Voice);
+                         pDSBufferNew, pDS3DBufferNew, Host_params, Xb_Voice);
 
     HRESULT hRet = pDSBuffer->GetStatus(&dwStatus);
 
@@ -658,12 +731,14 @@ static inline void DSoundBufferSynchPlaybackFlagRemove(
 
     )
 {
-    if (g_iDSoundSynchPlaybackCounter == 0) {
-        return;
-    }
-
     if ((dwEmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
-        g_iDSoundSynchPlaybackCounter--;
+        // Counter is shared by all buffers and streams, which are only locked individually.
+        unsigned int count = g_iDSoundSynchPlaybackCounter;
+        do {
+            if (count == 0) {
+                return;
+            }
+        } while (!g_iDSoundSynchPlaybackCounter.compare_exchange_weak(count, count - 1));
         dwEmuFlags ^= DSE_FLAG_SYNCHPLAYBACK_CONTROL;
     }
 }
@@ -673,19 +748,23 @@ static inline HRESULT DSoundBufferSynchPlaybackFlagAdd(
 
     )
 {
-    if (g_iDSoundSynchPlaybackCounter >= DSOUND_MAX_SYNCHPLAYBACK_AUDIO) {
-        return DSERR_GENERIC;
-    }
-
     if ((dwEmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) == 0) {
-        g_iDSoundSynchPlaybackCounter++;
+        unsigned int count = g_iDSoundSynchPlaybackCounter;
+        do {
+            if (count >= DSOUND_MAX_SYNCHPLAYBACK_AUDIO) {
+                return DSERR_GENERIC;
+            }
+        } while (!g_iDSoundSynchPlaybackCounter.compare_exchange_weak(count, count + 1));
         dwEmuFlags |= DSE_FLAG_SYNCHPLAYBACK_CONTROL;
+    } else if (g_iDSoundSynchPlaybackCounter >= DSOUND_MAX_SYNCHPLAYBACK_AUDIO) {
+        return DSERR_GENERIC;
     }
     return DS_OK;
 }
 
 static inline HRESULT DSoundBufferUpdateHostVolume(
     LPDIRECTSOUNDBUFFER8    pDSBuffer,
+    XTL::DSoundHostParams  &Host_params,
     uint32_t                dwEmuFlags,
     int32_t                 volume
 
@@ -714,8 +793,15 @@ static inline HRESULT DSoundBufferUpdateHostVolume(
     if ((dwEmuFlags & DSE_FLAG_DEBUG_MUTE) > 0) {
         volume = DSBVOLUME_MIN;
     }
+    if (Host_params.lVolume == volume) {
+        return DS_OK;
+    }
 
-    return pDSBuffer->SetVolume(volume);
+    HRESULT hRet = pDSBuffer->SetVolume(volume);
+    if (hRet == DS_OK) {
+        Host_params.lVolume = volume;
+    }
+    return hRet;
 }
 
 //TODO: RadWolfie - Need to implement DirectSoundBuffer create support. Or not able to do so due to all three classes function differently.
@@ -968,6 +1054,8 @@ static inline HRESULT HybridDirectSound3DBuffer_SetAllParameters(
             RETURN_RESULT_CHECK(hRet);
         }
 
+        DSoundListenerGuardLock;
+
         hRet = g_pDSoundPrimary3DListener8->SetDistanceFactor(pDS3DBufferParams->flDistanceFactor, dwApply);
         if (hRet != DS_OK) {
             RETURN_RESULT_CHECK(hRet);
@@ -1109,6 +1197,7 @@ static inline HRESULT HybridDirectSoundBuffer_SetFilter(
 //IDirectSoundBuffer
 static inline HRESULT HybridDirectSoundBuffer_SetFormat(
     LPDIRECTSOUNDBUFFER8   &pDSBuffer,
+    XTL::DSoundHostParams  &Host_params,
     LPCWAVEFORMATEX         Xb_pwfxFormat,
     DWORD                   Xb_flags,
     DSBUFFERDESC           &BufferDesc,
@@ -1126,11 +1215,11 @@ static inline HRESULT HybridDirectSoundBuffer_SetFormat(
 
     if (X_BufferAllocate) {
         GeneratePCMFormat(BufferDesc, Xb_pwfxFormat, Xb_flags, dwEmuFlags, X_BufferCacheSize,
-                          xbnullptr, X_BufferCacheSize, Xb_VoiceProperties, mixbins_output, Xb_Voice);
+                          xbnullptr, X_BufferCacheSize, nullptr, Xb_VoiceProperties, mixbins_output, Xb_Voice);
     // Don't allocate for DS Stream class, it is using straight from the source.
     } else {
         GeneratePCMFormat(BufferDesc, Xb_pwfxFormat, Xb_flags, dwEmuFlags, 0,
-                          xbnullptr, X_BufferCacheSize, Xb_VoiceProperties, mixbins_output, Xb_Voice);
+                          xbnullptr, X_BufferCacheSize, nullptr, Xb_VoiceProperties, mixbins_output, Xb_Voice);
     }
     HRESULT hRet = DS_OK;
     if ((void*)g_pDSoundPrimaryBuffer == (void*)pDSBuffer) {
@@ -1141,18 +1230,19 @@ static inline HRESULT HybridDirectSoundBuffer_SetFormat(
             // Allocate at least 5 second worth of bytes in PCM format.
             BufferDesc.dwBufferBytes = BufferDesc.lpwfxFormat->nAvgBytesPerSec * 5;
         }
-        DSoundBufferRegenWithNewFormat(pDSBuffer, BufferDesc, dwPlayFlags, pDS3DBuffer, Xb_Voice);
+        DSoundBufferRegenWithNewFormat(pDSBuffer, BufferDesc, dwPlayFlags, pDS3DBuffer, Host_params, Xb_Voice);
     }
 
     RETURN_RESULT_CHECK(hRet);
 }
 
-static HRESULT HybridDirectSoundBuffer_SetPitch(LPDIRECTSOUNDBUFFER8, LONG, XTL::CDirectSoundVoice*);
+static HRESULT HybridDirectSoundBuffer_SetPitch(LPDIRECTSOUNDBUFFER8, XTL::DSoundHostParams&, LONG, XTL::CDirectSoundVoice*);
 
 //IDirectSoundStream
 //IDirectSoundBuffer
 static inline HRESULT HybridDirectSoundBuffer_SetFrequency(
     LPDIRECTSOUNDBUFFER8 pDSBuffer,
+    XTL::DSoundHostParams& Host_params,
     DWORD               dwFrequency,
     XTL::CDirectSoundVoice* Xb_Voice)
 {
@@ -1160,18 +1250,19 @@ static inline HRESULT HybridDirectSoundBuffer_SetFrequency(
 
     int32_t pitch = converter_freq2pitch((dwFrequency!=0 ? dwFrequency : Xb_Voice->GetFrequencyDefault()));
 
-    hRet = HybridDirectSoundBuffer_SetPitch(pDSBuffer, pitch, Xb_Voice);
+    hRet = HybridDirectSoundBuffer_SetPitch(pDSBuffer, Host_params, pitch, Xb_Voice);
 
     RETURN_RESULT_CHECK(hRet);
 }
 
-static HRESULT HybridDirectSoundBuffer_SetVolume(LPDIRECTSOUNDBUFFER8, LONG, DWORD, LONG, XTL::CDirectSoundVoice*);
+static HRESULT HybridDirectSoundBuffer_SetVolume(LPDIRECTSOUNDBUFFER8, XTL::DSoundHostParams&, LONG, DWORD, LONG, XTL::CDirectSoundVoice*);
 
 //IDirectSoundStream
 //IDirectSoundBuffer
 // NOTE: 0 to 10,000; For initialize value would be 3D default to 0 and 2D default to 600.
 static inline HRESULT HybridDirectSoundBuffer_SetHeadroom(
     LPDIRECTSOUNDBUFFER8 pDSBuffer,
+    XTL::DSoundHostParams& Host_params,
     DWORD               dwHeadroom,
     LONG                Xb_volumeMixbin,
     DWORD               dwEmuFlags,
@@ -1184,7 +1275,7 @@ static inline HRESULT HybridDirectSoundBuffer_SetHeadroom(
         hRet = DS_OK;
         Xb_Voice->SetHeadroom(dwHeadroom);
         int32_t volume = Xb_Voice->GetVolume();
-        hRet = DSoundBufferUpdateHostVolume(pDSBuffer, dwEmuFlags, volume);
+        hRet = DSoundBufferUpdateHostVolume(pDSBuffer, Host_params, dwEmuFlags, volume);
     }
 
     return DS_OK;
@@ -1271,6 +1362,7 @@ static inline HRESULT HybridDirectSoundBuffer_SetMixBins(
 //IDirectSoundBuffer x2
 static inline HRESULT HybridDirectSoundBuffer_SetMixBinVolumes_8(
     LPDIRECTSOUNDBUFFER8 pDSBuffer,
+    XTL::DSoundHostParams& Host_params,
     XTL::X_LPDSMIXBINS   pMixBins,
     XTL::X_DSVOICEPROPS& Xb_VoiceProperties,
     DWORD                EmuFlags,
@@ -1313,10 +1405,13 @@ static inline HRESULT HybridDirectSoundBuffer_SetMixBinVolumes_8(
                     counter--;
                 }
             }
-            if (counter > 0) {
+            // Software mixer applies each mixbin volume on its own.
+            if (SoftwareDSoundBuffer_SetMixBins(pDSBuffer, Xb_VoiceProperties)) {
+                hRet = DS_OK;
+            } else if (counter > 0) {
                 Xb_volumeMixBin = volume / (LONG)counter;
                 int32_t Xb_volume = Xb_Voice->GetVolume();
-                hRet = HybridDirectSoundBuffer_SetVolume(pDSBuffer, Xb_volume, EmuFlags,
+                hRet = HybridDirectSoundBuffer_SetVolume(pDSBuffer, Host_params, Xb_volume, EmuFlags,
                                                          Xb_volumeMixBin, Xb_Voice);
             } else {
                 hRet = DS_OK;
@@ -1368,6 +1463,7 @@ static inline HRESULT HybridDirectSoundBuffer_SetOutputBuffer(
 //IDirectSoundBuffer
 static inline HRESULT HybridDirectSoundBuffer_SetPitch(
     LPDIRECTSOUNDBUFFER8 pDSBuffer,
+    XTL::DSoundHostParams& Host_params,
     LONG                lPitch,
     XTL::CDirectSoundVoice* Xb_Voice)
 {
@@ -1375,8 +1471,16 @@ static inline HRESULT HybridDirectSoundBuffer_SetPitch(
     Xb_Voice->SetPitch(lPitch);
     // Convert pitch back to frequency
     uint32_t setFrequency = converter_pitch2freq(lPitch);
+    if (Host_params.dwFrequency == setFrequency) {
+        return DS_OK;
+    }
+
+    HRESULT hRet = pDSBuffer->SetFrequency(setFrequency);
+    if (hRet == DS_OK) {
+        Host_params.dwFrequency = setFrequency;
+    }
 
-    RETURN_RESULT_CHECK(pDSBuffer->SetFrequency(setFrequency));
+    RETURN_RESULT_CHECK(hRet);
 }
 /*
 //Only has one function, this is not a requirement.
@@ -1457,6 +1561,7 @@ static inline HRESULT HybridDirectSound3DBuffer_SetVelocity(
 // 100 millibels (mB) = 1 dB
 static inline HRESULT HybridDirectSoundBuffer_SetVolume(
     LPDIRECTSOUNDBUFFER8    pDSBuffer,
+    XTL::DSoundHostParams  &Host_params,
     LONG                    lVolume,
     DWORD                   dwEmuFlags,
     LONG                    Xb_volumeMixbin,
@@ -1472,7 +1577,7 @@ static inline HRESULT HybridDirectSoundBuffer_SetVolume(
     lVolume = Xb_Voice->GetVolume();
     lVolume += Xb_volumeMixbin;
 
-    HRESULT hRet = DSoundBufferUpdateHostVolume(pDSBuffer, dwEmuFlags, lVolume);
+    HRESULT hRet = DSoundBufferUpdateHostVolume(pDSBuffer, Host_params, dwEmuFlags, lVolume);
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1524,6 +1629,7 @@ static inline HRESULT HybridDirectSoundBuffer_GetVoiceProperties(
 }
 
 static inline HRESULT HybridDirectSoundBuffer_SetMixBins(
+    LPDIRECTSOUNDBUFFER8 pDSBuffer,
     XTL::X_DSVOICEPROPS& Xb_VoiceProperties,
     XTL::X_LPDSMIXBINS   in_MixBins,
     LPCWAVEFORMATEX      pwfxFormat,
@@ -1533,6 +1639,7 @@ static inline HRESULT HybridDirectSoundBuffer_SetMixBins(
     HRESULT ret = DS_OK;
 
     GenerateMixBinDefault(Xb_VoiceProperties, pwfxFormat, in_MixBins, ((BufferDesc.dwFlags & DSBCAPS_CTRL3D) > 0));
+    SoftwareDSoundBuffer_SetMixBins(pDSBuffer, Xb_VoiceProperties);
 
     return ret;
 }
@@ -90,15 +90,34 @@ XTL::X_CDirectSoundStream::_vtbl XTL::X_CDirectSoundStream::vtbl =
 // ******************************************************************
 // * patch: DirectSoundDoWork (stream)
 // ******************************************************************
-void DirectSoundDoWork_Stream(xboxkrnl::LARGE_INTEGER& time)
+// Milliseconds until the given xbox system time (100ns units), zero if it already passed.
+static inline DWORD DirectSoundDoWork_Stream_TimeUntil(REFERENCE_TIME rtDeadline, REFERENCE_TIME rtNow)
 {
+    if (rtDeadline <= rtNow) {
+        return 0;
+    }
+    REFERENCE_TIME rtWait = (rtDeadline - rtNow + 9999) / 10000;
+    return rtWait < INFINITE ? DWORD(rtWait) : INFINITE - 1;
+}
+
+DWORD DirectSoundDoWork_Stream(xboxkrnl::LARGE_INTEGER& time)
+{
+    DWORD dwWaitTime = INFINITE;
+
     // Actually, DirectSoundStream need to process buffer packets here.
     vector_ds_stream::iterator ppDSStream = g_pDSoundStreamCache.begin();
     for (; ppDSStream != g_pDSoundStreamCache.end(); ppDSStream++) {
-        if ((*ppDSStream)->Host_BufferPacketArray.size() == 0) {
+        XTL::X_CDirectSoundStream* pThis = (*ppDSStream);
+        // A title thread holding the stream may call back into global functions, so never block on it here.
+        // The stream is serviced by that thread right now anyway, come back shortly instead.
+        std::unique_lock<DSoundMutex> guardObject(pThis->Host_Mutex, std::try_to_lock);
+        if (!guardObject.owns_lock()) {
+            dwWaitTime = 0;
+            continue;
+        }
+        if (pThis->Host_BufferPacketArray.size() == 0) {
             continue;
         }
-        XTL::X_CDirectSoundStream* pThis = (*ppDSStream);
         // TODO: Do we need this in async thread loop?
         if (pThis->Xb_rtPauseEx != 0LL && pThis->Xb_rtPauseEx <= time.QuadPart) {
             pThis->Xb_rtPauseEx = 0LL;
@@ -114,7 +133,23 @@ void DirectSoundDoWork_Stream(xboxkrnl::LARGE_INTEGER& time)
         } else {
             DSStream_Packet_Process(pThis);
         }
+
+        // Track the earliest deadline among all streams, including pending timed pause and flush requests.
+        DWORD dwStreamWait = DSStream_Packet_NextDeadline(pThis);
+        if (pThis->Xb_rtPauseEx != 0LL) {
+            DWORD dwPauseWait = DirectSoundDoWork_Stream_TimeUntil(pThis->Xb_rtPauseEx, time.QuadPart);
+            dwStreamWait = dwPauseWait < dwStreamWait ? dwPauseWait : dwStreamWait;
+        }
+        if ((pThis->EmuFlags & DSE_FLAG_FLUSH_ASYNC) > 0) {
+            DWORD dwFlushWait = DirectSoundDoWork_Stream_TimeUntil(pThis->Xb_rtFlushEx, time.QuadPart);
+            dwStreamWait = dwFlushWait < dwStreamWait ? dwFlushWait : dwStreamWait;
+        }
+        if (dwStreamWait < dwWaitTime) {
+            dwWaitTime = dwStreamWait;
+        }
     }
+
+    return dwWaitTime;
 }
 
 // ******************************************************************
@@ -124,7 +159,7 @@ ULONG WINAPI XTL::EMUPATCH(CDirectSoundStream_AddRef)
 (
     X_CDirectSoundStream*   pThis)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_ONE_ARG(pThis);
 
@@ -149,6 +184,8 @@ ULONG WINAPI XTL::EMUPATCH(CDirectSoundStream_Release)
         uRet = pThis->EmuDirectSoundBuffer8->Release();
 
         if (uRet == 0) {
+            g_DSoundTrace.Record(DSOUND_TRACE_STREAM_RELEASE, pThis);
+
             if (pThis->EmuDirectSound3DBuffer8 != nullptr) {
                 pThis->EmuDirectSound3DBuffer8->Release();
             }
@@ -236,7 +273,7 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateStream)
 
         // We have to set DSBufferDesc last due to EmuFlags must be either 0 or previously written value to preserve other flags.
         GeneratePCMFormat(DSBufferDesc, pdssd->lpwfxFormat, pdssd->dwFlags, (*ppStream)->EmuFlags, 0,
-                          xbnullptr, (*ppStream)->X_BufferCacheSize, (*ppStream)->Xb_VoiceProperties, pdssd->lpMixBinsOutput,
+                          xbnullptr, (*ppStream)->X_BufferCacheSize, nullptr, (*ppStream)->Xb_VoiceProperties, pdssd->lpMixBinsOutput,
                           &(*ppStream)->Xb_Voice);
 
         // Test case: Star Wars: KotOR has one packet greater than 5 seconds worth. Increasing to 10 seconds allow stream to work until
@@ -272,14 +309,19 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateStream)
             if (DSBufferDesc.dwFlags & DSBCAPS_CTRL3D) {
                 DSound3DBufferCreate((*ppStream)->EmuDirectSoundBuffer8, (*ppStream)->EmuDirectSound3DBuffer8);
             }
+            SoftwareDSoundBuffer_SetMixBins((*ppStream)->EmuDirectSoundBuffer8, (*ppStream)->Xb_VoiceProperties);
 
             DSoundDebugMuteFlag((*ppStream)->EmuBufferDesc.dwBufferBytes, (*ppStream)->EmuFlags);
 
             // Pre-set volume to enforce silence if one of audio codec is disabled.
-            HybridDirectSoundBuffer_SetVolume((*ppStream)->EmuDirectSoundBuffer8, 0L, (*ppStream)->EmuFlags,
+            HybridDirectSoundBuffer_SetVolume((*ppStream)->EmuDirectSoundBuffer8, (*ppStream)->Host_params, 0L, (*ppStream)->EmuFlags,
                 (*ppStream)->Xb_VolumeMixbin, &(*ppStream)->Xb_Voice);
 
             g_pDSoundStreamCache.push_back(*ppStream);
+
+            DSoundTraceFormat traceFormat = DSoundTraceGetFormat(pdssd->lpwfxFormat);
+            g_DSoundTrace.Record(DSOUND_TRACE_STREAM_CREATE, *ppStream, pdssd->dwFlags, pdssd->dwMaxAttachedPackets,
+                                 &traceFormat, sizeof(traceFormat));
         }
     }
 
@@ -333,12 +375,14 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Discontinuity)
 (
     X_CDirectSoundStream*   pThis)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_ONE_ARG(pThis);
 
     // default ret = DSERR_GENERIC
 
+    g_DSoundTrace.Record(DSOUND_TRACE_STREAM_DISCONTINUITY, pThis);
+
     // Perform check if packets exist, then mark the last submited packet as end of stream.
     if (!pThis->Host_BufferPacketArray.empty()) {
         pThis->Host_BufferPacketArray.back().isStreamEnd = true;
@@ -354,14 +398,18 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Flush)
 (
     X_CDirectSoundStream*   pThis)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_ONE_ARG(pThis);
 
+    g_DSoundTrace.Record(DSOUND_TRACE_STREAM_FLUSH, pThis);
+
     DSoundBufferSynchPlaybackFlagRemove(pThis->EmuFlags);
 
     while (DSStream_Packet_Flush(pThis));
 
+    DSoundStreamWorkerWake();
+
     return DS_OK;
 }
 
@@ -374,7 +422,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_FlushEx)
     REFERENCE_TIME          rtTimeStamp,
     DWORD                   dwFlags)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -409,6 +457,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_FlushEx)
         else {
             pThis->Xb_rtFlushEx = rtTimeStamp;
         }
+        DSoundStreamWorkerWake();
 
         pThis->EmuFlags |= DSE_FLAG_FLUSH_ASYNC;
 
@@ -436,7 +485,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetInfo)
     X_CDirectSoundStream*   pThis,
     OUT LPXMEDIAINFO            pInfo)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -461,7 +510,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetStatus)
     X_CDirectSoundStream*   pThis,
     OUT DWORD*              pdwStatus)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -501,7 +550,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetVoiceProperties)
     OUT X_DSVOICEPROPS*     pVoiceProps
 )
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
  LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
         LOG_FUNC_ARG_OUT(pVoiceProps)
@@ -525,8 +574,6 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Pause)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwPause)
 {
-    DSoundMutexGuardLock;
-
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
 		LOG_FUNC_ARG(dwPause)
@@ -537,6 +584,10 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Pause)
 		return STATUS_SUCCESS;
 	}
 
+    DSoundObjectGuardLock(pThis);
+
+    g_DSoundTrace.Record(DSOUND_TRACE_PAUSE, pThis, dwPause);
+
     HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
                                                  pThis->Host_isProcessing, 0LL, pThis->Xb_rtPauseEx);
 
@@ -558,6 +609,8 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Pause)
         DSStream_Packet_Process(pThis);
     }
 
+    DSoundStreamWorkerWake();
+
     return hRet;
 }
 
@@ -570,7 +623,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_PauseEx)
     REFERENCE_TIME          rtTimestamp,
     DWORD                   dwPause)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -581,9 +634,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_PauseEx)
     // This function wasn't part of the XDK until 4721. (Same as IDirectSoundBuffer_PauseEx?)
     // TODO: Implement time stamp feature (a thread maybe?)
 
+    g_DSoundTrace.Record(DSOUND_TRACE_PAUSE, pThis, dwPause);
+
     HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags, 
                                                 pThis->Host_isProcessing, rtTimestamp, pThis->Xb_rtPauseEx);
 
+    DSoundStreamWorkerWake();
+
     return hRet;
 }
 
@@ -596,7 +653,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Process)
     PXMEDIAPACKET           pInputBuffer,
     PXMEDIAPACKET           pOutputBuffer)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -638,6 +695,9 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Process)
 
                 pThis->Host_BufferPacketArray.push_back(packet_input);
 
+                g_DSoundTrace.Record(DSOUND_TRACE_STREAM_PACKET, pThis, pInputBuffer->dwMaxSize, 0,
+                                     pInputBuffer->pvBuffer, pInputBuffer->dwMaxSize);
+
                 if (pInputBuffer->pdwStatus != xbnullptr) {
                     (*pInputBuffer->pdwStatus) = XMP_STATUS_PENDING;
                 }
@@ -655,6 +715,8 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Process)
                     pThis->Xb_Status |= X_DSSSTATUS_PAUSED;
                 }
                 DSStream_Packet_Process(pThis);
+                // Let the worker recompute its deadline now that the stream has more data.
+                DSoundStreamWorkerWake();
             // Once full it needs to change status to flushed when cannot hold any more packets.
             } else {
                 if (pInputBuffer->pdwStatus != xbnullptr) {
@@ -687,7 +749,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetAllParameters)
     X_DS3DBUFFER*           pc3DBufferParameters,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -710,7 +772,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetConeAngles)
     DWORD                   dwOutsideConeAngle,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -735,7 +797,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetConeOrientation)
     D3DVALUE                z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -759,7 +821,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetConeOutsideVolume)
     LONG                    lConeOutsideVolume,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -781,7 +843,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetDistanceFactor)
     FLOAT                   flDistanceFactor,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -803,7 +865,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetDopplerFactor)
     FLOAT                   flDopplerFactor,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundListenerGuardLock;
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -824,7 +886,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetEG)
     X_CDirectSoundStream*   pThis,
     X_DSENVOLOPEDESC*       pEnvelopeDesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -848,7 +910,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetEG)
     X_CDirectSoundStream*   pThis,
     X_DSENVOLOPEDESC*       pEnvelopeDesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetEG");
 
@@ -863,7 +925,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFilter)
     X_CDirectSoundStream*   pThis,
     X_DSFILTERDESC*         pFilterDesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -885,7 +947,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetFilter)
     X_CDirectSoundStream*   pThis,
     X_DSFILTERDESC*         pFilterDesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetFilter");
 
@@ -900,7 +962,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFormat)
     X_CDirectSoundStream*   pThis,
     LPCWAVEFORMATEX         pwfxFormat)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -909,12 +971,15 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFormat)
 
     while (DSStream_Packet_Flush(pThis));
 
-    HRESULT hRet = HybridDirectSoundBuffer_SetFormat(pThis->EmuDirectSoundBuffer8, pwfxFormat, pThis->Xb_Flags,
+    HRESULT hRet = HybridDirectSoundBuffer_SetFormat(pThis->EmuDirectSoundBuffer8, pThis->Host_params, pwfxFormat, pThis->Xb_Flags,
                                                      pThis->EmuBufferDesc, pThis->EmuFlags, pThis->EmuPlayFlags,
                                                      pThis->EmuDirectSound3DBuffer8, 0, pThis->X_BufferCache,
                                                      pThis->X_BufferCacheSize, pThis->Xb_VoiceProperties,
                                                      xbnullptr, &pThis->Xb_Voice);
 
+    DSoundTraceFormat traceFormat = DSoundTraceGetFormat(pwfxFormat);
+    g_DSoundTrace.Record(DSOUND_TRACE_FORMAT, pThis, 0, 0, &traceFormat, sizeof(traceFormat));
+
     return hRet;
 }
 
@@ -926,14 +991,16 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFrequency)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwFrequency)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
 		LOG_FUNC_ARG(dwFrequency)
 		LOG_FUNC_END;
 
-    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency, &pThis->Xb_Voice);
+    g_DSoundTrace.Record(DSOUND_TRACE_FREQUENCY, pThis, dwFrequency);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, pThis->Host_params, dwFrequency, &pThis->Xb_Voice);
 
     return hRet;
 }
@@ -946,7 +1013,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetFrequency)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwFrequency)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetFrequency");
 
@@ -961,14 +1028,14 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetHeadroom)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwHeadroom)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
 		LOG_FUNC_ARG(dwHeadroom)
 		LOG_FUNC_END;
 
-    HRESULT hRet = HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, dwHeadroom,
+    HRESULT hRet = HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, pThis->Host_params, dwHeadroom,
                                                        pThis->Xb_VolumeMixbin, pThis->EmuFlags, &pThis->Xb_Voice);
 
     return hRet;
@@ -982,7 +1049,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetHeadroom)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwHeadroom)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetHeadroom");
 
@@ -998,7 +1065,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetI3DL2Source)
     X_DSI3DL2BUFFER*        pds3db,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1023,7 +1090,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetLFO)
     X_CDirectSoundStream*   pThis,
     LPCDSLFODESC            pLFODesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -1045,7 +1112,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetLFO)
     X_CDirectSoundStream*   pThis,
     LPCDSLFODESC            pLFODesc)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetLFO");
 
@@ -1061,7 +1128,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMaxDistance)
     D3DVALUE                flMaxDistance,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1083,7 +1150,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMinDistance)
     D3DVALUE                fMinDistance,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1104,7 +1171,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBins)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwMixBinMask) // Also can be X_LPDSMIXBINS (4039+)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
     HRESULT hRet = DS_OK;
     X_LPDSMIXBINS pMixBins = reinterpret_cast<X_LPDSMIXBINS>(dwMixBinMask);
 
@@ -1122,7 +1189,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBins)
             LOG_FUNC_ARG(pMixBins)
             LOG_FUNC_END;
 
-        hRet = HybridDirectSoundBuffer_SetMixBins(pThis->Xb_VoiceProperties, pMixBins, pThis->EmuBufferDesc.lpwfxFormat, pThis->EmuBufferDesc);
+        hRet = HybridDirectSoundBuffer_SetMixBins(pThis->EmuDirectSoundBuffer8, pThis->Xb_VoiceProperties, pMixBins, pThis->EmuBufferDesc.lpwfxFormat, pThis->EmuBufferDesc);
     }
 
 
@@ -1137,7 +1204,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetMixBins)
     X_CDirectSoundStream*   pThis,
     DWORD                   dwMixBinMask) // Also can be X_LPDSMIXBINS (4039+)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetMixBins");
 
@@ -1153,7 +1220,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMode)
     DWORD                   dwMode,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1176,7 +1243,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBinVolumes_12)
     DWORD                   dwMixBinMask,
     const LONG*             alVolumes)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1201,14 +1268,14 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBinVolumes_8)
     X_CDirectSoundStream*   pThis,
     X_LPDSMIXBINS           pMixBins)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
 		LOG_FUNC_ARG(pMixBins)
 		LOG_FUNC_END;
 
-    HRESULT hRet = HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pMixBins, pThis->Xb_VoiceProperties,
+    HRESULT hRet = HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pThis->Host_params, pMixBins, pThis->Xb_VoiceProperties,
                                                               pThis->EmuFlags, pThis->Xb_VolumeMixbin, &pThis->Xb_Voice);
 
     return hRet;
@@ -1222,7 +1289,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetOutputBuffer)
     X_CDirectSoundStream*   pThis,
     XbHybridDSBuffer*       pOutputBuffer)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1246,14 +1313,16 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetPitch)
     X_CDirectSoundStream*   pThis,
     LONG                    lPitch)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
         LOG_FUNC_ARG(lPitch)
         LOG_FUNC_END;
 
-    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch, &pThis->Xb_Voice);
+    g_DSoundTrace.Record(DSOUND_TRACE_PITCH, pThis, lPitch);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, pThis->Host_params, lPitch, &pThis->Xb_Voice);
 
     return hRet;
 }
@@ -1266,7 +1335,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetPitch)
     X_CDirectSoundStream*   pThis,
     LONG                    lPitch)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FORWARD("CDirectSoundStream_SetPitch");
 
@@ -1284,7 +1353,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetPosition)
     D3DVALUE                z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1309,7 +1378,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetRolloffCurve)
     DWORD                   dwPointCount,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1332,7 +1401,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetRolloffFactor)
     FLOAT                   fRolloffFactor,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1358,7 +1427,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetVelocity)
     D3DVALUE                z,
     DWORD                   dwApply)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1381,14 +1450,16 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetVolume)
     X_CDirectSoundStream*   pThis,
     LONG                    lVolume)
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
 		LOG_FUNC_ARG(lVolume)
 		LOG_FUNC_END;
 
-    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags,
+    g_DSoundTrace.Record(DSOUND_TRACE_VOLUME, pThis, lVolume);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, pThis->Host_params, lVolume, pThis->EmuFlags,
                                                      pThis->Xb_VolumeMixbin, &pThis->Xb_Voice);
 
     return hRet;
@@ -1403,7 +1474,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetVolume)
     LONG                    lVolume
 )
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FORWARD("CDirectSoundStream_SetVolume");
 
@@ -1419,7 +1490,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_Set3DVoiceData)
     DWORD a2
 )
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -1440,7 +1511,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_Use3DVoiceData)
     DWORD a2
 )
 {
-    DSoundMutexGuardLock;
+    DSoundObjectGuardLock(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
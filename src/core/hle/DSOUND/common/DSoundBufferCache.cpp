@@ -0,0 +1,227 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <cstdlib>
+#include <cstring>
+#include "DSoundBufferCache.hpp"
+
+DSoundBufferCacheCounters g_DSoundBufferCacheCounters;
+
+DSoundBufferCache::DSoundBufferCache()
+{
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Capacity = 0;
+    m_WriteWatch = false;
+    m_HostBase = 0;
+    m_LockPending = false;
+    m_LockOffset = 0;
+    m_LockLength1 = 0;
+    m_LockLength2 = 0;
+}
+
+DSoundBufferCache::~DSoundBufferCache()
+{
+    Release();
+}
+
+static uint8_t* DSoundBufferCacheAlloc(uint32_t Capacity, bool &WriteWatch)
+{
+#ifdef _WIN32
+    if (Capacity >= DSOUND_BUFFER_CACHE_WATCH_MIN) {
+        void* pData = VirtualAlloc(nullptr, Capacity, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE);
+        if (pData != nullptr) {
+            WriteWatch = true;
+            return static_cast<uint8_t*>(pData);
+        }
+    }
+#endif
+    WriteWatch = false;
+    return static_cast<uint8_t*>(calloc(1, Capacity));
+}
+
+static void DSoundBufferCacheFree(uint8_t* pData, bool WriteWatch)
+{
+#ifdef _WIN32
+    if (WriteWatch) {
+        VirtualFree(pData, 0, MEM_RELEASE);
+        return;
+    }
+#endif
+    free(pData);
+}
+
+void* DSoundBufferCache::Resize(uint32_t Size)
+{
+    if (Size <= m_Capacity) {
+        if (Size > m_Size) {
+            memset(m_Data + m_Size, 0, Size - m_Size);
+        }
+        m_Size = Size;
+        return m_Data;
+    }
+
+    uint32_t capacity = m_Capacity * 2;
+    if (capacity < Size) {
+        capacity = Size;
+    }
+
+    bool writeWatch;
+    uint8_t* pData = DSoundBufferCacheAlloc(capacity, writeWatch);
+    if (pData == nullptr) {
+        return nullptr;
+    }
+    if (m_Data != nullptr) {
+        memcpy(pData, m_Data, m_Size);
+        DSoundBufferCacheFree(m_Data, m_WriteWatch);
+    }
+
+    m_Data = pData;
+    m_Size = Size;
+    m_Capacity = capacity;
+    m_WriteWatch = writeWatch;
+    if (m_WriteWatch) {
+        m_WatchPages.resize(capacity / 0x1000 + 1);
+    }
+    return m_Data;
+}
+
+void DSoundBufferCache::Release()
+{
+    if (m_Data != nullptr) {
+        DSoundBufferCacheFree(m_Data, m_WriteWatch);
+    }
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Capacity = 0;
+    m_WriteWatch = false;
+    m_LockPending = false;
+}
+
+void DSoundBufferCache::MarkDirty(uint32_t Offset, uint32_t Length)
+{
+    if (Length == 0) {
+        return;
+    }
+
+    uint32_t begin = Offset, end = Offset + Length;
+
+    // Find first range ending at or after begin, then merge everything touching [begin, end).
+    auto first = m_Dirty.begin();
+    while (first != m_Dirty.end() && first->second < begin) {
+        first++;
+    }
+    auto last = first;
+    while (last != m_Dirty.end() && last->first <= end) {
+        if (last->first < begin) {
+            begin = last->first;
+        }
+        if (last->second > end) {
+            end = last->second;
+        }
+        last++;
+    }
+    first = m_Dirty.erase(first, last);
+    m_Dirty.insert(first, Range(begin, end));
+}
+
+void DSoundBufferCache::ClearDirty(uint32_t Begin, uint32_t End)
+{
+    m_Scratch.clear();
+    for (const Range& range : m_Dirty) {
+        if (range.second <= Begin || range.first >= End) {
+            m_Scratch.push_back(range);
+            continue;
+        }
+        if (range.first < Begin) {
+            m_Scratch.push_back(Range(range.first, Begin));
+        }
+        if (range.second > End) {
+            m_Scratch.push_back(Range(End, range.second));
+        }
+    }
+    m_Dirty.swap(m_Scratch);
+}
+
+void DSoundBufferCache::BeginLock(uint32_t Offset, uint32_t Length1, uint32_t Length2)
+{
+    FlushLock();
+    if (m_WriteWatch) {
+        return;
+    }
+    m_LockPending = true;
+    m_LockOffset = Offset;
+    m_LockLength1 = Length1;
+    m_LockLength2 = Length2;
+}
+
+void DSoundBufferCache::EndLock(uint32_t Written1, uint32_t Written2)
+{
+    if (!m_LockPending) {
+        return;
+    }
+    m_LockPending = false;
+    MarkDirty(m_LockOffset, Written1 < m_LockLength1 ? Written1 : m_LockLength1);
+    MarkDirty(0, Written2 < m_LockLength2 ? Written2 : m_LockLength2);
+}
+
+void DSoundBufferCache::FlushLock()
+{
+    // Title did not tell what it wrote, assume the whole lock region.
+    if (m_LockPending) {
+        EndLock(m_LockLength1, m_LockLength2);
+    }
+}
+
+void DSoundBufferCache::SetHostBase(uint32_t Base, uint32_t Size)
+{
+    if (m_HostBase != Base) {
+        m_HostBase = Base;
+        MarkDirty(0, Size);
+    }
+}
+
+void DSoundBufferCache::CollectWrites()
+{
+#ifdef _WIN32
+    if (!m_WriteWatch) {
+        return;
+    }
+
+    ULONG_PTR count = m_WatchPages.size();
+    DWORD granularity;
+    if (GetWriteWatch(WRITE_WATCH_FLAG_RESET, m_Data, m_Capacity, m_WatchPages.data(), &count, &granularity) != 0) {
+        MarkDirty(0, m_Size);
+        return;
+    }
+    for (ULONG_PTR i = 0; i < count; i++) {
+        uint32_t offset = static_cast<uint32_t>(static_cast<uint8_t*>(m_WatchPages[i]) - m_Data);
+        if (offset < m_Size) {
+            MarkDirty(offset, offset + granularity > m_Size ? m_Size - offset : granularity);
+        }
+    }
+#endif
+}
@@ -0,0 +1,161 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Smallest storage using page write tracking, smaller ones would mostly waste
+// address space to the allocation granularity.
+#define DSOUND_BUFFER_CACHE_WATCH_MIN 0x8000
+
+// Bytes asked to be uploaded to host buffers against bytes actually converted.
+struct DSoundBufferCacheCounters {
+    std::atomic<uint64_t> RequestedBytes;
+    std::atomic<uint64_t> UploadedBytes;
+};
+
+extern DSoundBufferCacheCounters g_DSoundBufferCacheCounters;
+
+// Xbox side copy of a DirectSound buffer. Keeps track of which bytes changed
+// since they were last uploaded to the host buffer, so only those get converted.
+class DSoundBufferCache {
+public:
+    DSoundBufferCache();
+    ~DSoundBufferCache();
+
+    // Storage is only used when the title did not hand over its own buffer.
+    // Capacity grows geometrically, contents up to the smaller size are kept and new bytes are zero.
+    void* Resize(uint32_t Size);
+    void Release();
+    void* GetData() const { return m_Data; }
+    uint32_t GetCapacity() const { return m_Capacity; }
+    // Writes into the storage are tracked per page, lock regions are not needed then.
+    bool IsWriteTracked() const { return m_WriteWatch; }
+
+    void MarkDirty(uint32_t Offset, uint32_t Length);
+    // A lock region is assumed written once it is closed, unless EndLock narrows it
+    // down to the byte counts given by the title on unlock.
+    void BeginLock(uint32_t Offset, uint32_t Length1, uint32_t Length2);
+    void EndLock(uint32_t Written1, uint32_t Written2);
+    // Xbox offset stored at host buffer offset 0, everything is uploaded again when it changes.
+    void SetHostBase(uint32_t Base, uint32_t Size);
+
+    // Calls UploadRange(Offset, Length) for every dirty part within [Offset, Offset + Length),
+    // widened to multiples of Align counted from Offset. UploadRange returns how many bytes from
+    // Offset it converted, only those are marked clean. Returns the sum of them.
+    template<class F>
+    uint32_t Upload(uint32_t Offset, uint32_t Length, uint32_t Align, F UploadRange);
+
+private:
+    typedef std::pair<uint32_t, uint32_t> Range; // [first, second)
+
+    void FlushLock();
+    void CollectWrites();
+    void ClearDirty(uint32_t Begin, uint32_t End);
+
+    uint8_t*  m_Data;
+    uint32_t  m_Size;
+    uint32_t  m_Capacity;
+    bool      m_WriteWatch;
+    uint32_t  m_HostBase;
+    bool      m_LockPending;
+    uint32_t  m_LockOffset;
+    uint32_t  m_LockLength1;
+    uint32_t  m_LockLength2;
+    std::vector<Range> m_Dirty; // Sorted and disjoint
+    std::vector<Range> m_Scratch;
+    std::vector<Range> m_Uploaded;
+    std::vector<void*> m_WatchPages;
+};
+
+template<class F>
+uint32_t DSoundBufferCache::Upload(uint32_t Offset, uint32_t Length, uint32_t Align, F UploadRange)
+{
+    FlushLock();
+    CollectWrites();
+
+    if (Align == 0) {
+        Align = 1;
+    }
+
+    const uint32_t end = Offset + Length;
+    uint32_t uploaded = 0, runBegin = 0, runEnd = 0;
+    bool run = false;
+
+    m_Uploaded.clear();
+    auto uploadRun = [&]() {
+        uint32_t done = UploadRange(runBegin, runEnd - runBegin);
+        if (done > runEnd - runBegin) {
+            done = runEnd - runBegin;
+        }
+        if (done > 0) {
+            m_Uploaded.push_back(Range(runBegin, runBegin + done));
+            uploaded += done;
+        }
+    };
+
+    for (const Range& range : m_Dirty) {
+        if (range.second <= Offset) {
+            continue;
+        }
+        if (range.first >= end) {
+            break;
+        }
+        uint32_t begin = range.first > Offset ? range.first : Offset;
+        uint32_t finish = range.second < end ? range.second : end;
+        begin = Offset + (begin - Offset) / Align * Align;
+        finish = Offset + (finish - Offset + Align - 1) / Align * Align;
+        if (finish > end) {
+            finish = end;
+        }
+
+        // Ranges widened into each other are uploaded as one.
+        if (run && begin <= runEnd) {
+            if (finish > runEnd) {
+                runEnd = finish;
+            }
+            continue;
+        }
+        if (run) {
+            uploadRun();
+        }
+        runBegin = begin;
+        runEnd = finish;
+        run = true;
+    }
+    if (run) {
+        uploadRun();
+    }
+
+    // A range the host side had no room for stays dirty for the next upload.
+    for (const Range& range : m_Uploaded) {
+        ClearDirty(range.first, range.second);
+    }
+
+    g_DSoundBufferCacheCounters.RequestedBytes += Length;
+    g_DSoundBufferCacheCounters.UploadedBytes += uploaded;
+    return uploaded;
+}
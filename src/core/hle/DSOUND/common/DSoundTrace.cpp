@@ -0,0 +1,110 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstring>
+#include "DSoundTrace.hpp"
+
+DSoundTraceRecorder g_DSoundTrace;
+
+static uint64_t TraceClockMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+DSoundTraceRecorder::DSoundTraceRecorder()
+{
+    m_Enabled = false;
+    m_File = nullptr;
+    m_StartTime = 0;
+    m_LastFlushTime = 0;
+}
+
+DSoundTraceRecorder::~DSoundTraceRecorder()
+{
+    Close();
+}
+
+bool DSoundTraceRecorder::Open(const char* szPath)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (m_File != nullptr) {
+        return true;
+    }
+    m_File = fopen(szPath, "wb");
+    if (m_File == nullptr) {
+        return false;
+    }
+
+    DSoundTraceHeader header = { DSOUND_TRACE_MAGIC, DSOUND_TRACE_VERSION };
+    fwrite(&header, sizeof(header), 1, m_File);
+    m_StartTime = TraceClockMicroseconds();
+    m_LastFlushTime = 0;
+    m_Enabled = true;
+    return true;
+}
+
+void DSoundTraceRecorder::Close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_Enabled = false;
+    if (m_File != nullptr) {
+        fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+void DSoundTraceRecorder::Write(uint32_t Type, const void* pObject, uint32_t Arg0, uint32_t Arg1, const void* pPayload, uint32_t PayloadBytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (m_File == nullptr) {
+        return;
+    }
+    if (pPayload == nullptr) {
+        PayloadBytes = 0;
+    }
+
+    DSoundTraceRecord record;
+    record.Type = Type;
+    record.Object = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pObject));
+    record.Time = TraceClockMicroseconds() - m_StartTime;
+    record.Args[0] = Arg0;
+    record.Args[1] = Arg1;
+    record.PayloadBytes = PayloadBytes;
+    record.Reserved = 0;
+
+    fwrite(&record, sizeof(record), 1, m_File);
+    if (PayloadBytes != 0) {
+        fwrite(pPayload, PayloadBytes, 1, m_File);
+    }
+
+    // Emulation may end without a chance to close the file, keep at most a second unwritten.
+    if (record.Time - m_LastFlushTime >= 1000000) {
+        fflush(m_File);
+        m_LastFlushTime = record.Time;
+    }
+}
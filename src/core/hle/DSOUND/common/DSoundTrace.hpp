@@ -0,0 +1,114 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+// Capture of the DirectSound HLE buffer and stream calls, with timestamps and the
+// data titles hand over. The recorder doesn't depend on Windows, so the file format
+// below is all a tool needs to read a trace back, cxbxr-tool replay-dsound does.
+
+#define DSOUND_TRACE_MAGIC      0x54445843 // "CXDT"
+#define DSOUND_TRACE_VERSION    1
+
+// Same values as X_DSBPLAY_*
+#define DSOUND_TRACE_PLAY_LOOPING   0x00000001
+#define DSOUND_TRACE_PLAY_FROMSTART 0x00000002
+
+// Same value as WAVE_FORMAT_XBOX_ADPCM
+#define DSOUND_TRACE_FORMAT_XADPCM  0x0069
+
+enum DSoundTraceType : uint32_t {
+    DSOUND_TRACE_BUFFER_CREATE = 1,     // Args: flags, bytes. Payload: DSoundTraceFormat
+    DSOUND_TRACE_BUFFER_RELEASE,
+    DSOUND_TRACE_BUFFER_DATA,           // Args: offset, bytes. Payload: bytes written by title
+    DSOUND_TRACE_BUFFER_RESIZE,         // Args: bytes
+    DSOUND_TRACE_BUFFER_PLAY,           // Args: flags
+    DSOUND_TRACE_BUFFER_STOP,
+    DSOUND_TRACE_BUFFER_POSITION,       // Args: offset
+    DSOUND_TRACE_STREAM_CREATE,         // Args: flags, max attached packets. Payload: DSoundTraceFormat
+    DSOUND_TRACE_STREAM_RELEASE,
+    DSOUND_TRACE_STREAM_PACKET,         // Args: bytes. Payload: packet contents
+    DSOUND_TRACE_STREAM_FLUSH,
+    DSOUND_TRACE_STREAM_DISCONTINUITY,
+    DSOUND_TRACE_PAUSE,                 // Args: pause. Buffers and streams
+    DSOUND_TRACE_FORMAT,                // Payload: DSoundTraceFormat
+    DSOUND_TRACE_FREQUENCY,             // Args: frequency
+    DSOUND_TRACE_PITCH,                 // Args: pitch
+    DSOUND_TRACE_VOLUME,                // Args: volume in mB
+};
+
+struct DSoundTraceHeader {
+    uint32_t Magic;
+    uint32_t Version;
+};
+
+struct DSoundTraceRecord {
+    uint32_t Type;
+    uint32_t Object;        // Xbox address of the buffer or stream
+    uint64_t Time;          // Microseconds since capture started
+    uint32_t Args[2];
+    uint32_t PayloadBytes;  // Follows the record
+    uint32_t Reserved;
+};
+
+// Xbox format of a buffer or stream, FormatTag is zero if title gave none.
+struct DSoundTraceFormat {
+    uint16_t FormatTag;
+    uint16_t Channels;
+    uint32_t SamplesPerSec;
+    uint16_t BitsPerSample;
+    uint16_t BlockAlign;
+};
+
+class DSoundTraceRecorder {
+public:
+    DSoundTraceRecorder();
+    ~DSoundTraceRecorder();
+
+    bool Open(const char* szPath);
+    void Close();
+    bool IsOpen() const { return m_Enabled; }
+
+    // Cheap enough to leave in every patch, nothing happens until Open succeeded.
+    void Record(uint32_t Type, const void* pObject, uint32_t Arg0 = 0, uint32_t Arg1 = 0,
+                const void* pPayload = nullptr, uint32_t PayloadBytes = 0) {
+        if (m_Enabled) {
+            Write(Type, pObject, Arg0, Arg1, pPayload, PayloadBytes);
+        }
+    }
+
+private:
+    void Write(uint32_t Type, const void* pObject, uint32_t Arg0, uint32_t Arg1, const void* pPayload, uint32_t PayloadBytes);
+
+    std::atomic<bool> m_Enabled;
+    std::mutex m_Mutex;
+    FILE*      m_File;
+    uint64_t   m_StartTime;
+    uint64_t   m_LastFlushTime;
+};
+
+extern DSoundTraceRecorder g_DSoundTrace;
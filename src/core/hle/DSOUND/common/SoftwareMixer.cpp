@@ -0,0 +1,399 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <cmath>
+#include <cstring>
+#include "SoftwareMixer.hpp"
+#include "common/audio/converter.hpp"
+
+static const float PI_F = 3.14159265358979f;
+
+// Volume and mixbin levels are in mB, where 100 mB = 1 dB.
+static inline float MilliBelToGain(int32_t mB)
+{
+    if (mB <= -10000) {
+        return 0.0f;
+    }
+    return converter_volume2gain(mB);
+}
+
+// Folds a mixbin into the stereo output. Back speakers and center are mixed
+// in at -3dB, LFE, I3DL2 and FX sends are dropped. 3D bins carry the azimuth
+// pan of the voice, the back 3D bins are left out since the pan already covers them.
+static inline bool MixBinToStereo(uint32_t MixBin, float PanLeft, float PanRight, float& Left, float& Right)
+{
+    switch (MixBin) {
+        case 0: Left = 1.0f;     Right = 0.0f;     return true; // FRONT_LEFT
+        case 1: Left = 0.0f;     Right = 1.0f;     return true; // FRONT_RIGHT
+        case 2: Left = 0.7071f;  Right = 0.7071f;  return true; // FRONT_CENTER
+        case 4: Left = 0.7071f;  Right = 0.0f;     return true; // BACK_LEFT
+        case 5: Left = 0.0f;     Right = 0.7071f;  return true; // BACK_RIGHT
+        case 6: Left = PanLeft;  Right = 0.0f;     return true; // 3D_FRONT_LEFT
+        case 7: Left = 0.0f;     Right = PanRight; return true; // 3D_FRONT_RIGHT
+        default:
+            return false;
+    }
+}
+
+SoftwareMixerWavSink::SoftwareMixerWavSink(const char* szPath)
+{
+    m_DataBytes = 0;
+    m_HeaderDataBytes = 0;
+    m_File = fopen(szPath, "wb");
+    if (m_File != nullptr) {
+        WriteHeader();
+    }
+}
+
+SoftwareMixerWavSink::~SoftwareMixerWavSink()
+{
+    if (m_File != nullptr) {
+        WriteHeader();
+        fclose(m_File);
+    }
+}
+
+void SoftwareMixerWavSink::WriteHeader()
+{
+    const uint16_t channels = 2, bitsPerSample = 16, formatTag = 1 /*WAVE_FORMAT_PCM*/;
+    const uint16_t blockAlign = channels * bitsPerSample / 8;
+    const uint32_t sampleRate = SOFTWARE_MIXER_RATE, byteRate = sampleRate * blockAlign;
+    const uint32_t fmtSize = 16, riffSize = 36 + m_DataBytes;
+
+    fseek(m_File, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, m_File);
+    fwrite(&riffSize, 4, 1, m_File);
+    fwrite("WAVEfmt ", 1, 8, m_File);
+    fwrite(&fmtSize, 4, 1, m_File);
+    fwrite(&formatTag, 2, 1, m_File);
+    fwrite(&channels, 2, 1, m_File);
+    fwrite(&sampleRate, 4, 1, m_File);
+    fwrite(&byteRate, 4, 1, m_File);
+    fwrite(&blockAlign, 2, 1, m_File);
+    fwrite(&bitsPerSample, 2, 1, m_File);
+    fwrite("data", 1, 4, m_File);
+    fwrite(&m_DataBytes, 4, 1, m_File);
+    fseek(m_File, 0, SEEK_END);
+    m_HeaderDataBytes = m_DataBytes;
+}
+
+void SoftwareMixerWavSink::Write(const int16_t* pFrames, uint32_t FrameCount)
+{
+    if (m_File == nullptr) {
+        return;
+    }
+    m_DataBytes += static_cast<uint32_t>(fwrite(pFrames, 4, FrameCount, m_File)) * 4;
+    // Keep the header close to valid in case the emulator is terminated without a clean shutdown, without
+    // seeking back to it on every period. The destructor writes the final sizes.
+    if (m_DataBytes - m_HeaderDataBytes >= SOFTWARE_MIXER_RATE * 4 * SOFTWARE_MIXER_WAV_PATCH) {
+        WriteHeader();
+        fflush(m_File);
+    }
+}
+
+SoftwareMixer::SoftwareMixer(std::unique_ptr<SoftwareMixerSink> Sink) : m_Sink(std::move(Sink))
+{
+    ListenerPosition = { 0.0f, 0.0f, 0.0f };
+    ListenerRolloffFactor = 1.0f;
+    m_Accumulator.resize(SOFTWARE_MIXER_RING_FRAMES * 2);
+    m_RingRead = 0;
+    m_RingWrite = 0;
+    m_RingCount = 0;
+    m_MixedFrames = 0;
+    m_VoiceFrames = 0;
+}
+
+SoftwareMixer::~SoftwareMixer()
+{
+    Flush();
+}
+
+SoftwareMixerVoice* SoftwareMixer::CreateVoice(uint32_t BufferBytes, uint16_t Channels, uint16_t BitsPerSample, uint32_t Frequency)
+{
+    std::unique_ptr<SoftwareMixerVoice> voice(new SoftwareMixerVoice);
+
+    voice->Data.resize(BufferBytes);
+    SetVoiceFormat(voice.get(), Channels, BitsPerSample, Frequency);
+    voice->Playing = false;
+    voice->Looping = false;
+    voice->Position = 0;
+    voice->Volume = 0;
+    voice->Pan = 0;
+    voice->MixBinCount = 0;
+    voice->Is3D = false;
+    voice->Mode3D = SOFTWARE_MIXER_3D_NORMAL;
+    voice->Position3D = { 0.0f, 0.0f, 0.0f };
+    voice->MinDistance = 1.0f;           // DS3D_DEFAULTMINDISTANCE
+    voice->MaxDistance = 1000000000.0f;  // DS3D_DEFAULTMAXDISTANCE
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    m_Voices.push_back(std::move(voice));
+    return m_Voices.back().get();
+}
+
+void SoftwareMixer::DestroyVoice(SoftwareMixerVoice* pVoice)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (auto it = m_Voices.begin(); it != m_Voices.end(); it++) {
+        if (it->get() == pVoice) {
+            m_Voices.erase(it);
+            break;
+        }
+    }
+}
+
+void SoftwareMixer::SetVoiceFormat(SoftwareMixerVoice* pVoice, uint16_t Channels, uint16_t BitsPerSample, uint32_t Frequency)
+{
+    if (Channels == 0) {
+        Channels = 1;
+    }
+    if (BitsPerSample != 8) {
+        BitsPerSample = 16;
+    }
+    pVoice->Channels = Channels;
+    pVoice->BitsPerSample = BitsPerSample;
+    pVoice->BlockAlign = Channels * BitsPerSample / 8;
+    pVoice->Frequency = Frequency;
+    pVoice->FrameCount = static_cast<uint32_t>(pVoice->Data.size() / pVoice->BlockAlign);
+    if ((pVoice->Position >> 32) >= pVoice->FrameCount) {
+        pVoice->Position = 0;
+    }
+}
+
+template<bool Is16Bit>
+static inline float ReadSample(const uint8_t* pData, uint32_t Index)
+{
+    if (Is16Bit) {
+        int16_t sample;
+        memcpy(&sample, pData + Index * 2, sizeof(sample));
+        return static_cast<float>(sample);
+    }
+    return static_cast<float>(static_cast<int>(pData[Index]) - 128);
+}
+
+template<bool Is16Bit>
+static uint32_t ResampleVoice(SoftwareMixerVoice& Voice, const float (*Matrix)[2], uint32_t MixChannels, float* pOut, uint32_t FrameCount)
+{
+    const uint8_t* pData = Voice.Data.data();
+    const uint32_t channels = Voice.Channels;
+    const uint32_t frameTotal = Voice.FrameCount;
+    const uint64_t end = static_cast<uint64_t>(frameTotal) << 32;
+    const uint64_t step = (static_cast<uint64_t>(Voice.Frequency) << 32) / SOFTWARE_MIXER_RATE;
+    uint64_t position = Voice.Position;
+    uint32_t frame;
+
+    for (frame = 0; frame < FrameCount; frame++) {
+        const uint32_t index = static_cast<uint32_t>(position >> 32);
+        const float fraction = static_cast<uint32_t>(position) * (1.0f / 4294967296.0f);
+        uint32_t next = index + 1;
+        if (next >= frameTotal) {
+            next = Voice.Looping ? 0 : index;
+        }
+
+        float left = 0.0f, right = 0.0f;
+        for (uint32_t ch = 0; ch < MixChannels; ch++) {
+            const float s0 = ReadSample<Is16Bit>(pData, index * channels + ch);
+            const float s1 = ReadSample<Is16Bit>(pData, next * channels + ch);
+            const float sample = s0 + (s1 - s0) * fraction;
+            left += sample * Matrix[ch][0];
+            right += sample * Matrix[ch][1];
+        }
+        pOut[frame * 2] += left;
+        pOut[frame * 2 + 1] += right;
+
+        position += step;
+        if (position >= end) {
+            if (!Voice.Looping) {
+                Voice.Playing = false;
+                position = 0;
+                frame++;
+                break;
+            }
+            position %= end;
+        }
+    }
+
+    Voice.Position = position;
+    return frame;
+}
+
+void SoftwareMixer::MixVoice(SoftwareMixerVoice& Voice, float* pOut, uint32_t FrameCount)
+{
+    if (Voice.FrameCount == 0 || Voice.Frequency == 0) {
+        return;
+    }
+
+    const uint32_t channels = Voice.Channels < SOFTWARE_MIXER_MIXBIN_MAX ? Voice.Channels : SOFTWARE_MIXER_MIXBIN_MAX;
+    float gain = MilliBelToGain(Voice.Volume);
+    float panLeft = 1.0f, panRight = 1.0f;
+
+    // Inverse distance rolloff as done by DirectSound, listener orientation is not taken into account.
+    if (Voice.Is3D && Voice.Mode3D != SOFTWARE_MIXER_3D_DISABLE) {
+        SoftwareMixerVector relative = Voice.Position3D;
+        if (Voice.Mode3D == SOFTWARE_MIXER_3D_NORMAL) {
+            relative.x -= ListenerPosition.x;
+            relative.y -= ListenerPosition.y;
+            relative.z -= ListenerPosition.z;
+        }
+        const float length = sqrtf(relative.x * relative.x + relative.y * relative.y + relative.z * relative.z);
+        const float minDistance = Voice.MinDistance > 0.0f ? Voice.MinDistance : 1.0f;
+        float distance = length;
+        if (distance < minDistance) {
+            distance = minDistance;
+        }
+        if (distance > Voice.MaxDistance && Voice.MaxDistance > minDistance) {
+            distance = Voice.MaxDistance;
+        }
+        gain *= minDistance / (minDistance + ListenerRolloffFactor * (distance - minDistance));
+
+        // Equal power pan from the lateral offset, listener faces +z with +x to the right.
+        const float lateral = length > 0.0f ? relative.x / length : 0.0f;
+        const float angle = (lateral + 1.0f) * (PI_F / 4.0f);
+        panLeft = cosf(angle);
+        panRight = sinf(angle);
+    }
+
+    float matrix[SOFTWARE_MIXER_MIXBIN_MAX][2] = {};
+    float left, right;
+
+    if (Voice.MixBinCount == 0) {
+        if (channels == 1) {
+            matrix[0][0] = 1.0f;
+            matrix[0][1] = 1.0f;
+        }
+        else {
+            for (uint32_t ch = 0; ch < channels; ch++) {
+                if (MixBinToStereo(ch, panLeft, panRight, left, right)) {
+                    matrix[ch][0] = left;
+                    matrix[ch][1] = right;
+                }
+            }
+        }
+    }
+    else {
+        // A mono voice feeds every mixbin, otherwise channel i feeds mixbin i.
+        for (uint32_t i = 0; i < Voice.MixBinCount && i < SOFTWARE_MIXER_MIXBIN_MAX; i++) {
+            const uint32_t ch = channels == 1 ? 0 : i;
+            if (ch >= channels || !MixBinToStereo(Voice.MixBins[i].MixBin, panLeft, panRight, left, right)) {
+                continue;
+            }
+            const float binGain = MilliBelToGain(Voice.MixBins[i].Volume);
+            matrix[ch][0] += left * binGain;
+            matrix[ch][1] += right * binGain;
+        }
+    }
+
+    // DirectSound pan law, attenuate the opposite side only.
+    float gainLeft = gain, gainRight = gain;
+    if (Voice.Pan > 0) {
+        gainLeft *= MilliBelToGain(-Voice.Pan);
+    }
+    else if (Voice.Pan < 0) {
+        gainRight *= MilliBelToGain(Voice.Pan);
+    }
+
+    // Fold sample normalization into the matrix as well.
+    const float scale = Voice.BitsPerSample == 16 ? 1.0f / 32768.0f : 1.0f / 128.0f;
+    gainLeft *= scale;
+    gainRight *= scale;
+    for (uint32_t ch = 0; ch < channels; ch++) {
+        matrix[ch][0] *= gainLeft;
+        matrix[ch][1] *= gainRight;
+    }
+    uint32_t mixed;
+    if (Voice.BitsPerSample == 16) {
+        mixed = ResampleVoice<true>(Voice, matrix, channels, pOut, FrameCount);
+    }
+    else {
+        mixed = ResampleVoice<false>(Voice, matrix, channels, pOut, FrameCount);
+    }
+
+    m_VoiceFrames += mixed;
+}
+
+void SoftwareMixer::Render(uint32_t FrameCount)
+{
+    float* pAccumulator = m_Accumulator.data();
+    memset(pAccumulator, 0, FrameCount * 2 * sizeof(float));
+
+    for (auto& voice : m_Voices) {
+        if (voice->Playing) {
+            MixVoice(*voice, pAccumulator, FrameCount);
+        }
+    }
+
+    for (uint32_t frame = 0; frame < FrameCount; frame++) {
+        for (uint32_t ch = 0; ch < 2; ch++) {
+            float sample = pAccumulator[frame * 2 + ch] * 32768.0f;
+            if (sample > 32767.0f) {
+                sample = 32767.0f;
+            }
+            else if (sample < -32768.0f) {
+                sample = -32768.0f;
+            }
+            m_Ring[m_RingWrite * 2 + ch] = static_cast<int16_t>(sample);
+        }
+        m_RingWrite = (m_RingWrite + 1) % SOFTWARE_MIXER_RING_FRAMES;
+    }
+    m_RingCount += FrameCount;
+    m_MixedFrames += FrameCount;
+}
+
+void SoftwareMixer::Drain(uint32_t FrameCount)
+{
+    while (FrameCount > 0) {
+        uint32_t chunk = SOFTWARE_MIXER_RING_FRAMES - m_RingRead;
+        if (chunk > FrameCount) {
+            chunk = FrameCount;
+        }
+        m_Sink->Write(&m_Ring[m_RingRead * 2], chunk);
+        m_RingRead = (m_RingRead + chunk) % SOFTWARE_MIXER_RING_FRAMES;
+        m_RingCount -= chunk;
+        FrameCount -= chunk;
+    }
+}
+
+void SoftwareMixer::Process(uint32_t FrameCount)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    while (FrameCount > 0) {
+        uint32_t chunk = SOFTWARE_MIXER_RING_FRAMES - m_RingCount;
+        if (chunk > FrameCount) {
+            chunk = FrameCount;
+        }
+        Render(chunk);
+        FrameCount -= chunk;
+
+        while (m_RingCount >= SOFTWARE_MIXER_PERIOD) {
+            Drain(SOFTWARE_MIXER_PERIOD);
+        }
+    }
+}
+
+void SoftwareMixer::Flush()
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    Drain(m_RingCount);
+}
@@ -0,0 +1,150 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Portable software mixer used when DirectSound HLE output is not routed to a
+// host audio device. Nothing in here depends on Windows, so it can be driven
+// directly by a benchmark or headless run.
+
+#define SOFTWARE_MIXER_RATE         48000 // Output rate, same as Xbox APU
+#define SOFTWARE_MIXER_MIXBIN_MAX   8     // Same as X_DSVOICEPROPS::MixBinVolumePairs
+#define SOFTWARE_MIXER_RING_FRAMES  4096  // Stereo frames held before handed to the sink
+#define SOFTWARE_MIXER_PERIOD       480   // Frames handed to the sink at once (10ms)
+#define SOFTWARE_MIXER_WAV_PATCH    5     // Seconds of output between two updates of the wav header
+
+// Same values as DS3DMODE_*
+enum {
+    SOFTWARE_MIXER_3D_NORMAL = 0,
+    SOFTWARE_MIXER_3D_HEADRELATIVE = 1,
+    SOFTWARE_MIXER_3D_DISABLE = 2,
+};
+
+struct SoftwareMixerVector {
+    float x, y, z;
+};
+
+// Same layout as X_DSMIXBINVOLUMEPAIR
+struct SoftwareMixerMixBin {
+    uint32_t MixBin;
+    int32_t  Volume; // mB
+};
+
+// Receives the final 16 bit stereo output.
+class SoftwareMixerSink {
+public:
+    virtual ~SoftwareMixerSink() = default;
+    virtual void Write(const int16_t* pFrames, uint32_t FrameCount) = 0;
+};
+
+class SoftwareMixerNullSink : public SoftwareMixerSink {
+public:
+    void Write(const int16_t*, uint32_t) override {}
+};
+
+class SoftwareMixerWavSink : public SoftwareMixerSink {
+public:
+    SoftwareMixerWavSink(const char* szPath);
+    ~SoftwareMixerWavSink();
+    bool IsOpen() const { return m_File != nullptr; }
+    void Write(const int16_t* pFrames, uint32_t FrameCount) override;
+
+private:
+    void WriteHeader();
+
+    FILE*    m_File;
+    uint32_t m_DataBytes;
+    uint32_t m_HeaderDataBytes; // m_DataBytes as last written to the header
+};
+
+struct SoftwareMixerVoice {
+    // Host side PCM data, written by the owner of the voice.
+    std::vector<uint8_t> Data;
+    uint16_t Channels;
+    uint16_t BitsPerSample;  // 8 (unsigned) or 16 (signed)
+    uint16_t BlockAlign;
+    uint32_t Frequency;
+    uint32_t FrameCount;
+
+    bool     Playing;
+    bool     Looping;
+    uint64_t Position;       // 32.32 fixed point frame position
+    int32_t  Volume;         // mB, DSBVOLUME_MIN to DSBVOLUME_MAX
+    int32_t  Pan;            // mB, DSBPAN_LEFT to DSBPAN_RIGHT
+
+    // When MixBinCount is zero, channels are routed as their speaker position.
+    uint32_t MixBinCount;
+    SoftwareMixerMixBin MixBins[SOFTWARE_MIXER_MIXBIN_MAX];
+
+    bool     Is3D;
+    uint32_t Mode3D;
+    SoftwareMixerVector Position3D;
+    float    MinDistance;
+    float    MaxDistance;
+};
+
+class SoftwareMixer {
+public:
+    SoftwareMixer(std::unique_ptr<SoftwareMixerSink> Sink);
+    ~SoftwareMixer();
+
+    // Voice and listener members may only be changed while holding Mutex.
+    std::mutex Mutex;
+
+    SoftwareMixerVoice* CreateVoice(uint32_t BufferBytes, uint16_t Channels, uint16_t BitsPerSample, uint32_t Frequency);
+    void DestroyVoice(SoftwareMixerVoice* pVoice);
+    // Changes format of an existing voice, buffer size is unchanged.
+    static void SetVoiceFormat(SoftwareMixerVoice* pVoice, uint16_t Channels, uint16_t BitsPerSample, uint32_t Frequency);
+
+    SoftwareMixerVector ListenerPosition;
+    float ListenerRolloffFactor;
+
+    // Mix FrameCount output frames and pass them through the ring to the sink.
+    void Process(uint32_t FrameCount);
+    // Hand anything still held in the ring to the sink.
+    void Flush();
+
+    // Output frames mixed and sum of frames mixed for each playing voice.
+    uint64_t GetMixedFrames() const { return m_MixedFrames; }
+    uint64_t GetVoiceFrames() const { return m_VoiceFrames; }
+
+private:
+    void MixVoice(SoftwareMixerVoice& Voice, float* pOut, uint32_t FrameCount);
+    void Render(uint32_t FrameCount);
+    void Drain(uint32_t FrameCount);
+
+    std::unique_ptr<SoftwareMixerSink> m_Sink;
+    std::vector<std::unique_ptr<SoftwareMixerVoice>> m_Voices;
+    std::vector<float> m_Accumulator;
+    int16_t  m_Ring[SOFTWARE_MIXER_RING_FRAMES * 2];
+    uint32_t m_RingRead;
+    uint32_t m_RingWrite;
+    uint32_t m_RingCount;
+    uint64_t m_MixedFrames;
+    uint64_t m_VoiceFrames;
+};
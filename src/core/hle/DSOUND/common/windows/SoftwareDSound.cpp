@@ -0,0 +1,1295 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define LOG_PREFIX CXBXR_MODULE::DSOUND
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "SoftwareDSound.hpp"
+#include "core/kernel/init/CxbxKrnl.h" // For szFolder_CxbxReloadedData
+#include "common/Settings.hpp" // For AUDIO_OUTPUT_*
+#include "Logging.h"
+
+// Private interface id, only used to recognize our own buffers behind LPDIRECTSOUNDBUFFER8.
+static const GUID IID_SoftwareDSoundBuffer = { 0x6b2a3f4e, 0x1c5d, 0x4a7e, { 0x9b, 0x21, 0x3e, 0x48, 0xd0, 0x5c, 0x77, 0x19 } };
+
+class SoftwareDSound;
+class SoftwareDSoundBuffer;
+class SoftwareDSoundPrimaryBuffer;
+
+// The 3D interfaces are reference counted on their own, like host DirectSound does,
+// while keeping the owning buffer alive.
+class SoftwareDSound3DBuffer : public IDirectSound3DBuffer8 {
+public:
+    SoftwareDSound3DBuffer(SoftwareDSoundBuffer* pOwner);
+
+    STDMETHOD(QueryInterface)(REFIID riid, LPVOID* ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(GetAllParameters)(LPDS3DBUFFER pDs3dBuffer) override;
+    STDMETHOD(GetConeAngles)(LPDWORD pdwInsideConeAngle, LPDWORD pdwOutsideConeAngle) override;
+    STDMETHOD(GetConeOrientation)(D3DVECTOR* pvOrientation) override;
+    STDMETHOD(GetConeOutsideVolume)(LPLONG plConeOutsideVolume) override;
+    STDMETHOD(GetMaxDistance)(D3DVALUE* pflMaxDistance) override;
+    STDMETHOD(GetMinDistance)(D3DVALUE* pflMinDistance) override;
+    STDMETHOD(GetMode)(LPDWORD pdwMode) override;
+    STDMETHOD(GetPosition)(D3DVECTOR* pvPosition) override;
+    STDMETHOD(GetVelocity)(D3DVECTOR* pvVelocity) override;
+    STDMETHOD(SetAllParameters)(LPCDS3DBUFFER pcDs3dBuffer, DWORD dwApply) override;
+    STDMETHOD(SetConeAngles)(DWORD dwInsideConeAngle, DWORD dwOutsideConeAngle, DWORD dwApply) override;
+    STDMETHOD(SetConeOrientation)(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+    STDMETHOD(SetConeOutsideVolume)(LONG lConeOutsideVolume, DWORD dwApply) override;
+    STDMETHOD(SetMaxDistance)(D3DVALUE flMaxDistance, DWORD dwApply) override;
+    STDMETHOD(SetMinDistance)(D3DVALUE flMinDistance, DWORD dwApply) override;
+    STDMETHOD(SetMode)(DWORD dwMode, DWORD dwApply) override;
+    STDMETHOD(SetPosition)(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+    STDMETHOD(SetVelocity)(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+
+private:
+    // Deferred settings are applied immediately, there is no hardware to batch them for.
+    void Apply();
+
+    SoftwareDSoundBuffer* m_pOwner;
+    std::atomic<ULONG>    m_RefCount;
+    DS3DBUFFER            m_Params;
+};
+
+class SoftwareDSoundBuffer : public IDirectSoundBuffer8 {
+public:
+    SoftwareDSoundBuffer(SoftwareDSound* pDevice, SoftwareMixerVoice* pVoice, DWORD dwFlags);
+    ~SoftwareDSoundBuffer();
+
+    STDMETHOD(QueryInterface)(REFIID riid, LPVOID* ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(GetCaps)(LPDSBCAPS pDSBufferCaps) override;
+    STDMETHOD(GetCurrentPosition)(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor) override;
+    STDMETHOD(GetFormat)(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten) override;
+    STDMETHOD(GetVolume)(LPLONG plVolume) override;
+    STDMETHOD(GetPan)(LPLONG plPan) override;
+    STDMETHOD(GetFrequency)(LPDWORD pdwFrequency) override;
+    STDMETHOD(GetStatus)(LPDWORD pdwStatus) override;
+    STDMETHOD(Initialize)(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc) override;
+    STDMETHOD(Lock)(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                    LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags) override;
+    STDMETHOD(Play)(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags) override;
+    STDMETHOD(SetCurrentPosition)(DWORD dwNewPosition) override;
+    STDMETHOD(SetFormat)(LPCWAVEFORMATEX pcfxFormat) override;
+    STDMETHOD(SetVolume)(LONG lVolume) override;
+    STDMETHOD(SetPan)(LONG lPan) override;
+    STDMETHOD(SetFrequency)(DWORD dwFrequency) override;
+    STDMETHOD(Stop)() override;
+    STDMETHOD(Unlock)(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2) override;
+    STDMETHOD(Restore)() override;
+    STDMETHOD(SetFX)(DWORD dwEffectsCount, LPDSEFFECTDESC pDSFXDesc, LPDWORD pdwResultCodes) override;
+    STDMETHOD(AcquireResources)(DWORD dwFlags, DWORD dwEffectsCount, LPDWORD pdwResultCodes) override;
+    STDMETHOD(GetObjectInPath)(REFGUID rguidObject, DWORD dwIndex, REFGUID rguidInterface, LPVOID* ppObject) override;
+
+    SoftwareMixer*      GetMixer();
+    SoftwareMixerVoice* GetVoice() { return m_pVoice; }
+
+private:
+    SoftwareDSound*        m_pDevice;
+    SoftwareMixerVoice*    m_pVoice;
+    DWORD                  m_Flags;
+    DWORD                  m_OriginalFrequency;
+    std::atomic<ULONG>     m_RefCount;
+    SoftwareDSound3DBuffer m_3DBuffer;
+};
+
+class SoftwareDSound3DListener : public IDirectSound3DListener8 {
+public:
+    SoftwareDSound3DListener(SoftwareDSoundPrimaryBuffer* pOwner);
+
+    STDMETHOD(QueryInterface)(REFIID riid, LPVOID* ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(GetAllParameters)(LPDS3DLISTENER pListener) override;
+    STDMETHOD(GetDistanceFactor)(D3DVALUE* pflDistanceFactor) override;
+    STDMETHOD(GetDopplerFactor)(D3DVALUE* pflDopplerFactor) override;
+    STDMETHOD(GetOrientation)(D3DVECTOR* pvOrientFront, D3DVECTOR* pvOrientTop) override;
+    STDMETHOD(GetPosition)(D3DVECTOR* pvPosition) override;
+    STDMETHOD(GetRolloffFactor)(D3DVALUE* pflRolloffFactor) override;
+    STDMETHOD(GetVelocity)(D3DVECTOR* pvVelocity) override;
+    STDMETHOD(SetAllParameters)(LPCDS3DLISTENER pcListener, DWORD dwApply) override;
+    STDMETHOD(SetDistanceFactor)(D3DVALUE flDistanceFactor, DWORD dwApply) override;
+    STDMETHOD(SetDopplerFactor)(D3DVALUE flDopplerFactor, DWORD dwApply) override;
+    STDMETHOD(SetOrientation)(D3DVALUE xFront, D3DVALUE yFront, D3DVALUE zFront,
+                              D3DVALUE xTop, D3DVALUE yTop, D3DVALUE zTop, DWORD dwApply) override;
+    STDMETHOD(SetPosition)(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+    STDMETHOD(SetRolloffFactor)(D3DVALUE flRolloffFactor, DWORD dwApply) override;
+    STDMETHOD(SetVelocity)(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+    STDMETHOD(CommitDeferredSettings)() override;
+
+private:
+    void Apply();
+
+    SoftwareDSoundPrimaryBuffer* m_pOwner;
+    std::atomic<ULONG>           m_RefCount;
+    DS3DLISTENER                 m_Params;
+};
+
+// Primary buffer only exists to hand out the listener, mixing happens in SoftwareMixer.
+class SoftwareDSoundPrimaryBuffer : public IDirectSoundBuffer {
+public:
+    SoftwareDSoundPrimaryBuffer(SoftwareDSound* pDevice);
+    ~SoftwareDSoundPrimaryBuffer();
+
+    STDMETHOD(QueryInterface)(REFIID riid, LPVOID* ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(GetCaps)(LPDSBCAPS pDSBufferCaps) override;
+    STDMETHOD(GetCurrentPosition)(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor) override;
+    STDMETHOD(GetFormat)(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten) override;
+    STDMETHOD(GetVolume)(LPLONG plVolume) override;
+    STDMETHOD(GetPan)(LPLONG plPan) override;
+    STDMETHOD(GetFrequency)(LPDWORD pdwFrequency) override;
+    STDMETHOD(GetStatus)(LPDWORD pdwStatus) override;
+    STDMETHOD(Initialize)(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc) override;
+    STDMETHOD(Lock)(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                    LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags) override;
+    STDMETHOD(Play)(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags) override;
+    STDMETHOD(SetCurrentPosition)(DWORD dwNewPosition) override;
+    STDMETHOD(SetFormat)(LPCWAVEFORMATEX pcfxFormat) override;
+    STDMETHOD(SetVolume)(LONG lVolume) override;
+    STDMETHOD(SetPan)(LONG lPan) override;
+    STDMETHOD(SetFrequency)(DWORD dwFrequency) override;
+    STDMETHOD(Stop)() override;
+    STDMETHOD(Unlock)(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2) override;
+    STDMETHOD(Restore)() override;
+
+    SoftwareMixer* GetMixer();
+
+private:
+    SoftwareDSound*          m_pDevice;
+    std::atomic<ULONG>       m_RefCount;
+    SoftwareDSound3DListener m_Listener;
+};
+
+class SoftwareDSound : public IDirectSound8 {
+public:
+    SoftwareDSound(std::unique_ptr<SoftwareMixerSink> Sink);
+    ~SoftwareDSound();
+
+    STDMETHOD(QueryInterface)(REFIID riid, LPVOID* ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(CreateSoundBuffer)(LPCDSBUFFERDESC pcDSBufferDesc, LPDIRECTSOUNDBUFFER* ppDSBuffer, LPUNKNOWN pUnkOuter) override;
+    STDMETHOD(GetCaps)(LPDSCAPS pDSCaps) override;
+    STDMETHOD(DuplicateSoundBuffer)(LPDIRECTSOUNDBUFFER pDSBufferOriginal, LPDIRECTSOUNDBUFFER* ppDSBufferDuplicate) override;
+    STDMETHOD(SetCooperativeLevel)(HWND hwnd, DWORD dwLevel) override;
+    STDMETHOD(Compact)() override;
+    STDMETHOD(GetSpeakerConfig)(LPDWORD pdwSpeakerConfig) override;
+    STDMETHOD(SetSpeakerConfig)(DWORD dwSpeakerConfig) override;
+    STDMETHOD(Initialize)(LPCGUID pcGuidDevice) override;
+    STDMETHOD(VerifyCertification)(LPDWORD pdwCertified) override;
+
+    SoftwareMixer* GetMixer() { return m_Mixer.get(); }
+
+private:
+    void PumpWorker();
+
+    std::unique_ptr<SoftwareMixer> m_Mixer;
+    std::atomic<ULONG>             m_RefCount;
+    std::atomic<bool>              m_PumpRunning;
+    std::thread                    m_Pump;
+};
+
+static void SoftwareDSound_FillFormat(LPWAVEFORMATEX pwfxFormat, WORD nChannels, WORD wBitsPerSample, DWORD nSamplesPerSec)
+{
+    pwfxFormat->wFormatTag = WAVE_FORMAT_PCM;
+    pwfxFormat->nChannels = nChannels;
+    pwfxFormat->nSamplesPerSec = nSamplesPerSec;
+    pwfxFormat->wBitsPerSample = wBitsPerSample;
+    pwfxFormat->nBlockAlign = nChannels * wBitsPerSample / 8;
+    pwfxFormat->nAvgBytesPerSec = nSamplesPerSec * pwfxFormat->nBlockAlign;
+    pwfxFormat->cbSize = 0;
+}
+
+// ******************************************************************
+// * SoftwareDSound3DBuffer
+// ******************************************************************
+SoftwareDSound3DBuffer::SoftwareDSound3DBuffer(SoftwareDSoundBuffer* pOwner) : m_pOwner(pOwner), m_RefCount(0)
+{
+    m_Params = { 0 };
+    m_Params.dwSize = sizeof(DS3DBUFFER);
+    m_Params.dwInsideConeAngle = DS3D_DEFAULTCONEANGLE;
+    m_Params.dwOutsideConeAngle = DS3D_DEFAULTCONEANGLE;
+    m_Params.vConeOrientation = { 0.0f, 0.0f, 1.0f };
+    m_Params.lConeOutsideVolume = DS3D_DEFAULTCONEOUTSIDEVOLUME;
+    m_Params.flMinDistance = DS3D_DEFAULTMINDISTANCE;
+    m_Params.flMaxDistance = DS3D_DEFAULTMAXDISTANCE;
+    m_Params.dwMode = DS3DMODE_NORMAL;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::QueryInterface(REFIID riid, LPVOID* ppvObject)
+{
+    return m_pOwner->QueryInterface(riid, ppvObject);
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSound3DBuffer::AddRef()
+{
+    ULONG refCount = ++m_RefCount;
+    m_pOwner->AddRef();
+    return refCount;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSound3DBuffer::Release()
+{
+    ULONG refCount = --m_RefCount;
+    m_pOwner->Release();
+    return refCount;
+}
+
+void SoftwareDSound3DBuffer::Apply()
+{
+    SoftwareMixer* pMixer = m_pOwner->GetMixer();
+    SoftwareMixerVoice* pVoice = m_pOwner->GetVoice();
+    std::lock_guard<std::mutex> lock(pMixer->Mutex);
+
+    pVoice->Position3D = { m_Params.vPosition.x, m_Params.vPosition.y, m_Params.vPosition.z };
+    pVoice->MinDistance = m_Params.flMinDistance;
+    pVoice->MaxDistance = m_Params.flMaxDistance;
+    pVoice->Mode3D = m_Params.dwMode;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetAllParameters(LPDS3DBUFFER pDs3dBuffer)
+{
+    if (pDs3dBuffer == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pDs3dBuffer = m_Params;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetConeAngles(LPDWORD pdwInsideConeAngle, LPDWORD pdwOutsideConeAngle)
+{
+    if (pdwInsideConeAngle != nullptr) {
+        *pdwInsideConeAngle = m_Params.dwInsideConeAngle;
+    }
+    if (pdwOutsideConeAngle != nullptr) {
+        *pdwOutsideConeAngle = m_Params.dwOutsideConeAngle;
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetConeOrientation(D3DVECTOR* pvOrientation)
+{
+    if (pvOrientation == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pvOrientation = m_Params.vConeOrientation;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetConeOutsideVolume(LPLONG plConeOutsideVolume)
+{
+    if (plConeOutsideVolume == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *plConeOutsideVolume = m_Params.lConeOutsideVolume;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetMaxDistance(D3DVALUE* pflMaxDistance)
+{
+    if (pflMaxDistance == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pflMaxDistance = m_Params.flMaxDistance;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetMinDistance(D3DVALUE* pflMinDistance)
+{
+    if (pflMinDistance == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pflMinDistance = m_Params.flMinDistance;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetMode(LPDWORD pdwMode)
+{
+    if (pdwMode == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pdwMode = m_Params.dwMode;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetPosition(D3DVECTOR* pvPosition)
+{
+    if (pvPosition == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pvPosition = m_Params.vPosition;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::GetVelocity(D3DVECTOR* pvVelocity)
+{
+    if (pvVelocity == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pvVelocity = m_Params.vVelocity;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetAllParameters(LPCDS3DBUFFER pcDs3dBuffer, DWORD dwApply)
+{
+    if (pcDs3dBuffer == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    m_Params = *pcDs3dBuffer;
+    m_Params.dwSize = sizeof(DS3DBUFFER);
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetConeAngles(DWORD dwInsideConeAngle, DWORD dwOutsideConeAngle, DWORD dwApply)
+{
+    m_Params.dwInsideConeAngle = dwInsideConeAngle;
+    m_Params.dwOutsideConeAngle = dwOutsideConeAngle;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetConeOrientation(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    m_Params.vConeOrientation = { x, y, z };
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetConeOutsideVolume(LONG lConeOutsideVolume, DWORD dwApply)
+{
+    m_Params.lConeOutsideVolume = lConeOutsideVolume;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetMaxDistance(D3DVALUE flMaxDistance, DWORD dwApply)
+{
+    m_Params.flMaxDistance = flMaxDistance;
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetMinDistance(D3DVALUE flMinDistance, DWORD dwApply)
+{
+    m_Params.flMinDistance = flMinDistance;
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetMode(DWORD dwMode, DWORD dwApply)
+{
+    if (dwMode > DS3DMODE_DISABLE) {
+        return DSERR_INVALIDPARAM;
+    }
+    m_Params.dwMode = dwMode;
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    m_Params.vPosition = { x, y, z };
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DBuffer::SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    // Doppler is not simulated.
+    m_Params.vVelocity = { x, y, z };
+    return DS_OK;
+}
+
+// ******************************************************************
+// * SoftwareDSoundBuffer
+// ******************************************************************
+SoftwareDSoundBuffer::SoftwareDSoundBuffer(SoftwareDSound* pDevice, SoftwareMixerVoice* pVoice, DWORD dwFlags)
+    : m_pDevice(pDevice), m_pVoice(pVoice), m_Flags(dwFlags), m_RefCount(1), m_3DBuffer(this)
+{
+    m_OriginalFrequency = pVoice->Frequency;
+    m_pVoice->Is3D = (dwFlags & DSBCAPS_CTRL3D) != 0;
+    m_pDevice->AddRef();
+}
+
+SoftwareDSoundBuffer::~SoftwareDSoundBuffer()
+{
+    m_pDevice->GetMixer()->DestroyVoice(m_pVoice);
+    m_pDevice->Release();
+}
+
+SoftwareMixer* SoftwareDSoundBuffer::GetMixer()
+{
+    return m_pDevice->GetMixer();
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::QueryInterface(REFIID riid, LPVOID* ppvObject)
+{
+    if (ppvObject == nullptr) {
+        return E_POINTER;
+    }
+
+    if (IsEqualIID(riid, IID_IUnknown) || IsEqualIID(riid, IID_IDirectSoundBuffer) || IsEqualIID(riid, IID_IDirectSoundBuffer8)) {
+        *ppvObject = static_cast<IDirectSoundBuffer8*>(this);
+        AddRef();
+    }
+    else if (IsEqualIID(riid, IID_IDirectSound3DBuffer) && (m_Flags & DSBCAPS_CTRL3D) != 0) {
+        *ppvObject = static_cast<IDirectSound3DBuffer8*>(&m_3DBuffer);
+        m_3DBuffer.AddRef();
+    }
+    else if (IsEqualIID(riid, IID_SoftwareDSoundBuffer)) {
+        *ppvObject = this;
+        AddRef();
+    }
+    else {
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    return S_OK;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSoundBuffer::AddRef()
+{
+    return ++m_RefCount;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSoundBuffer::Release()
+{
+    ULONG refCount = --m_RefCount;
+    if (refCount == 0) {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetCaps(LPDSBCAPS pDSBufferCaps)
+{
+    if (pDSBufferCaps == nullptr || pDSBufferCaps->dwSize < sizeof(DSBCAPS)) {
+        return DSERR_INVALIDPARAM;
+    }
+    pDSBufferCaps->dwFlags = m_Flags | DSBCAPS_LOCSOFTWARE;
+    pDSBufferCaps->dwBufferBytes = static_cast<DWORD>(m_pVoice->Data.size());
+    pDSBufferCaps->dwUnlockTransferRate = 0;
+    pDSBufferCaps->dwPlayCpuOverhead = 0;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+
+    DWORD dwPlayCursor = static_cast<DWORD>(m_pVoice->Position >> 32) * m_pVoice->BlockAlign;
+    DWORD dwWriteCursor = dwPlayCursor;
+
+    // Same as host DirectSound, the write cursor stays slightly ahead of play cursor while playing.
+    if (m_pVoice->Playing && !m_pVoice->Data.empty()) {
+        dwWriteCursor = (dwPlayCursor + (m_pVoice->Frequency / 100) * m_pVoice->BlockAlign) % static_cast<DWORD>(m_pVoice->Data.size());
+    }
+    if (pdwCurrentPlayCursor != nullptr) {
+        *pdwCurrentPlayCursor = dwPlayCursor;
+    }
+    if (pdwCurrentWriteCursor != nullptr) {
+        *pdwCurrentWriteCursor = dwWriteCursor;
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten)
+{
+    if (pwfxFormat == nullptr) {
+        if (pdwSizeWritten == nullptr) {
+            return DSERR_INVALIDPARAM;
+        }
+        *pdwSizeWritten = sizeof(WAVEFORMATEX);
+        return DS_OK;
+    }
+    if (dwSizeAllocated < sizeof(WAVEFORMATEX)) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    SoftwareDSound_FillFormat(pwfxFormat, m_pVoice->Channels, m_pVoice->BitsPerSample, m_pVoice->Frequency);
+    if (pdwSizeWritten != nullptr) {
+        *pdwSizeWritten = sizeof(WAVEFORMATEX);
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetVolume(LPLONG plVolume)
+{
+    if (plVolume == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *plVolume = m_pVoice->Volume;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetPan(LPLONG plPan)
+{
+    if (plPan == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *plPan = m_pVoice->Pan;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetFrequency(LPDWORD pdwFrequency)
+{
+    if (pdwFrequency == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pdwFrequency = m_pVoice->Frequency;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetStatus(LPDWORD pdwStatus)
+{
+    if (pdwStatus == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    DWORD dwStatus = 0;
+    if (m_pVoice->Playing) {
+        dwStatus |= DSBSTATUS_PLAYING;
+        if (m_pVoice->Looping) {
+            dwStatus |= DSBSTATUS_LOOPING;
+        }
+    }
+    *pdwStatus = dwStatus;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc)
+{
+    return DSERR_ALREADYINITIALIZED;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::Lock(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                                        LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
+{
+    if (ppvAudioPtr1 == nullptr || pdwAudioBytes1 == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    const DWORD dwBufferBytes = static_cast<DWORD>(m_pVoice->Data.size());
+
+    if ((dwFlags & DSBLOCK_FROMWRITECURSOR) != 0) {
+        GetCurrentPosition(nullptr, &dwOffset);
+    }
+    if ((dwFlags & DSBLOCK_ENTIREBUFFER) != 0) {
+        dwBytes = dwBufferBytes;
+    }
+    if (dwOffset >= dwBufferBytes || dwBytes == 0 || dwBytes > dwBufferBytes) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    // Voice data is never reallocated, writes through the pointers land directly in the voice.
+    uint8_t* pData = m_pVoice->Data.data();
+    DWORD dwBytes1 = dwBytes;
+    if (dwOffset + dwBytes > dwBufferBytes) {
+        dwBytes1 = dwBufferBytes - dwOffset;
+    }
+    *ppvAudioPtr1 = pData + dwOffset;
+    *pdwAudioBytes1 = dwBytes1;
+
+    if (ppvAudioPtr2 != nullptr) {
+        *ppvAudioPtr2 = dwBytes1 < dwBytes ? pData : nullptr;
+    }
+    if (pdwAudioBytes2 != nullptr) {
+        *pdwAudioBytes2 = dwBytes - dwBytes1;
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags)
+{
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    m_pVoice->Playing = true;
+    m_pVoice->Looping = (dwFlags & DSBPLAY_LOOPING) != 0;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::SetCurrentPosition(DWORD dwNewPosition)
+{
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    if (dwNewPosition >= m_pVoice->Data.size()) {
+        return DSERR_INVALIDPARAM;
+    }
+    m_pVoice->Position = static_cast<uint64_t>(dwNewPosition / m_pVoice->BlockAlign) << 32;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::SetFormat(LPCWAVEFORMATEX pcfxFormat)
+{
+    if (pcfxFormat == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    SoftwareMixer::SetVoiceFormat(m_pVoice, pcfxFormat->nChannels, pcfxFormat->wBitsPerSample, pcfxFormat->nSamplesPerSec);
+    m_OriginalFrequency = pcfxFormat->nSamplesPerSec;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::SetVolume(LONG lVolume)
+{
+    if (lVolume < DSBVOLUME_MIN || lVolume > DSBVOLUME_MAX) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    m_pVoice->Volume = lVolume;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::SetPan(LONG lPan)
+{
+    if (lPan < DSBPAN_LEFT || lPan > DSBPAN_RIGHT) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    m_pVoice->Pan = lPan;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::SetFrequency(DWORD dwFrequency)
+{
+    if (dwFrequency == DSBFREQUENCY_ORIGINAL) {
+        dwFrequency = m_OriginalFrequency;
+    }
+    else if (dwFrequency < DSBFREQUENCY_MIN || dwFrequency > DSBFREQUENCY_MAX) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    m_pVoice->Frequency = dwFrequency;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::Stop()
+{
+    std::lock_guard<std::mutex> lock(GetMixer()->Mutex);
+    m_pVoice->Playing = false;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2)
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::Restore()
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::SetFX(DWORD dwEffectsCount, LPDSEFFECTDESC pDSFXDesc, LPDWORD pdwResultCodes)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::AcquireResources(DWORD dwFlags, DWORD dwEffectsCount, LPDWORD pdwResultCodes)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+STDMETHODIMP SoftwareDSoundBuffer::GetObjectInPath(REFGUID rguidObject, DWORD dwIndex, REFGUID rguidInterface, LPVOID* ppObject)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+// ******************************************************************
+// * SoftwareDSound3DListener
+// ******************************************************************
+SoftwareDSound3DListener::SoftwareDSound3DListener(SoftwareDSoundPrimaryBuffer* pOwner) : m_pOwner(pOwner), m_RefCount(0)
+{
+    m_Params = { 0 };
+    m_Params.dwSize = sizeof(DS3DLISTENER);
+    m_Params.vOrientFront = { 0.0f, 0.0f, 1.0f };
+    m_Params.vOrientTop = { 0.0f, 1.0f, 0.0f };
+    m_Params.flDistanceFactor = DS3D_DEFAULTDISTANCEFACTOR;
+    m_Params.flRolloffFactor = DS3D_DEFAULTROLLOFFFACTOR;
+    m_Params.flDopplerFactor = DS3D_DEFAULTDOPPLERFACTOR;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::QueryInterface(REFIID riid, LPVOID* ppvObject)
+{
+    return m_pOwner->QueryInterface(riid, ppvObject);
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSound3DListener::AddRef()
+{
+    ULONG refCount = ++m_RefCount;
+    m_pOwner->AddRef();
+    return refCount;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSound3DListener::Release()
+{
+    ULONG refCount = --m_RefCount;
+    m_pOwner->Release();
+    return refCount;
+}
+
+void SoftwareDSound3DListener::Apply()
+{
+    SoftwareMixer* pMixer = m_pOwner->GetMixer();
+    std::lock_guard<std::mutex> lock(pMixer->Mutex);
+
+    pMixer->ListenerPosition = { m_Params.vPosition.x, m_Params.vPosition.y, m_Params.vPosition.z };
+    pMixer->ListenerRolloffFactor = m_Params.flRolloffFactor;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetAllParameters(LPDS3DLISTENER pListener)
+{
+    if (pListener == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pListener = m_Params;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetDistanceFactor(D3DVALUE* pflDistanceFactor)
+{
+    if (pflDistanceFactor == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pflDistanceFactor = m_Params.flDistanceFactor;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetDopplerFactor(D3DVALUE* pflDopplerFactor)
+{
+    if (pflDopplerFactor == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pflDopplerFactor = m_Params.flDopplerFactor;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetOrientation(D3DVECTOR* pvOrientFront, D3DVECTOR* pvOrientTop)
+{
+    if (pvOrientFront == nullptr || pvOrientTop == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pvOrientFront = m_Params.vOrientFront;
+    *pvOrientTop = m_Params.vOrientTop;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetPosition(D3DVECTOR* pvPosition)
+{
+    if (pvPosition == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pvPosition = m_Params.vPosition;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetRolloffFactor(D3DVALUE* pflRolloffFactor)
+{
+    if (pflRolloffFactor == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pflRolloffFactor = m_Params.flRolloffFactor;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::GetVelocity(D3DVECTOR* pvVelocity)
+{
+    if (pvVelocity == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pvVelocity = m_Params.vVelocity;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetAllParameters(LPCDS3DLISTENER pcListener, DWORD dwApply)
+{
+    if (pcListener == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    m_Params = *pcListener;
+    m_Params.dwSize = sizeof(DS3DLISTENER);
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetDistanceFactor(D3DVALUE flDistanceFactor, DWORD dwApply)
+{
+    // Attenuation only depends on distance ratios, so the unit does not matter.
+    m_Params.flDistanceFactor = flDistanceFactor;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetDopplerFactor(D3DVALUE flDopplerFactor, DWORD dwApply)
+{
+    m_Params.flDopplerFactor = flDopplerFactor;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetOrientation(D3DVALUE xFront, D3DVALUE yFront, D3DVALUE zFront,
+                                                      D3DVALUE xTop, D3DVALUE yTop, D3DVALUE zTop, DWORD dwApply)
+{
+    m_Params.vOrientFront = { xFront, yFront, zFront };
+    m_Params.vOrientTop = { xTop, yTop, zTop };
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    m_Params.vPosition = { x, y, z };
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetRolloffFactor(D3DVALUE flRolloffFactor, DWORD dwApply)
+{
+    if (flRolloffFactor < DS3D_MINROLLOFFFACTOR || flRolloffFactor > DS3D_MAXROLLOFFFACTOR) {
+        return DSERR_INVALIDPARAM;
+    }
+    m_Params.flRolloffFactor = flRolloffFactor;
+    Apply();
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    m_Params.vVelocity = { x, y, z };
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound3DListener::CommitDeferredSettings()
+{
+    return DS_OK;
+}
+
+// ******************************************************************
+// * SoftwareDSoundPrimaryBuffer
+// ******************************************************************
+SoftwareDSoundPrimaryBuffer::SoftwareDSoundPrimaryBuffer(SoftwareDSound* pDevice)
+    : m_pDevice(pDevice), m_RefCount(1), m_Listener(this)
+{
+    m_pDevice->AddRef();
+}
+
+SoftwareDSoundPrimaryBuffer::~SoftwareDSoundPrimaryBuffer()
+{
+    m_pDevice->Release();
+}
+
+SoftwareMixer* SoftwareDSoundPrimaryBuffer::GetMixer()
+{
+    return m_pDevice->GetMixer();
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::QueryInterface(REFIID riid, LPVOID* ppvObject)
+{
+    if (ppvObject == nullptr) {
+        return E_POINTER;
+    }
+
+    if (IsEqualIID(riid, IID_IUnknown) || IsEqualIID(riid, IID_IDirectSoundBuffer)) {
+        *ppvObject = static_cast<IDirectSoundBuffer*>(this);
+        AddRef();
+    }
+    else if (IsEqualIID(riid, IID_IDirectSound3DListener)) {
+        *ppvObject = static_cast<IDirectSound3DListener8*>(&m_Listener);
+        m_Listener.AddRef();
+    }
+    else {
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    return S_OK;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSoundPrimaryBuffer::AddRef()
+{
+    return ++m_RefCount;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSoundPrimaryBuffer::Release()
+{
+    ULONG refCount = --m_RefCount;
+    if (refCount == 0) {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetCaps(LPDSBCAPS pDSBufferCaps)
+{
+    if (pDSBufferCaps == nullptr || pDSBufferCaps->dwSize < sizeof(DSBCAPS)) {
+        return DSERR_INVALIDPARAM;
+    }
+    pDSBufferCaps->dwFlags = DSBCAPS_PRIMARYBUFFER | DSBCAPS_CTRL3D | DSBCAPS_LOCSOFTWARE;
+    pDSBufferCaps->dwBufferBytes = SOFTWARE_MIXER_RING_FRAMES * 4;
+    pDSBufferCaps->dwUnlockTransferRate = 0;
+    pDSBufferCaps->dwPlayCpuOverhead = 0;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten)
+{
+    if (pwfxFormat == nullptr || dwSizeAllocated < sizeof(WAVEFORMATEX)) {
+        return DSERR_INVALIDPARAM;
+    }
+    SoftwareDSound_FillFormat(pwfxFormat, 2, 16, SOFTWARE_MIXER_RATE);
+    if (pdwSizeWritten != nullptr) {
+        *pdwSizeWritten = sizeof(WAVEFORMATEX);
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetVolume(LPLONG plVolume)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetPan(LPLONG plPan)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetFrequency(LPDWORD pdwFrequency)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::GetStatus(LPDWORD pdwStatus)
+{
+    if (pdwStatus == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pdwStatus = DSBSTATUS_PLAYING | DSBSTATUS_LOOPING;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc)
+{
+    return DSERR_ALREADYINITIALIZED;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::Lock(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                                               LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags)
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::SetCurrentPosition(DWORD dwNewPosition)
+{
+    return DSERR_INVALIDCALL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::SetFormat(LPCWAVEFORMATEX pcfxFormat)
+{
+    // Output format of the mixer is fixed.
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::SetVolume(LONG lVolume)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::SetPan(LONG lPan)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::SetFrequency(DWORD dwFrequency)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::Stop()
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+STDMETHODIMP SoftwareDSoundPrimaryBuffer::Restore()
+{
+    return DS_OK;
+}
+
+// ******************************************************************
+// * SoftwareDSound
+// ******************************************************************
+SoftwareDSound::SoftwareDSound(std::unique_ptr<SoftwareMixerSink> Sink)
+    : m_Mixer(new SoftwareMixer(std::move(Sink))), m_RefCount(1), m_PumpRunning(true)
+{
+    m_Pump = std::thread(&SoftwareDSound::PumpWorker, this);
+}
+
+SoftwareDSound::~SoftwareDSound()
+{
+    m_PumpRunning = false;
+    m_Pump.join();
+    m_Mixer->Flush();
+
+    EmuLog(LOG_LEVEL::INFO, "Software mixer: %llu frames mixed, %llu voice frames",
+           m_Mixer->GetMixedFrames(), m_Mixer->GetVoiceFrames());
+}
+
+// Mixes in step with wall clock time, so the amount of audio produced matches how long the title ran.
+void SoftwareDSound::PumpWorker()
+{
+    auto start = std::chrono::steady_clock::now();
+    uint64_t framesRendered = 0;
+
+    while (m_PumpRunning) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        uint64_t framesTarget = static_cast<uint64_t>(elapsed) * SOFTWARE_MIXER_RATE / 1000000;
+        if (framesTarget > framesRendered) {
+            m_Mixer->Process(static_cast<uint32_t>(framesTarget - framesRendered));
+            framesRendered = framesTarget;
+        }
+    }
+}
+
+STDMETHODIMP SoftwareDSound::QueryInterface(REFIID riid, LPVOID* ppvObject)
+{
+    if (ppvObject == nullptr) {
+        return E_POINTER;
+    }
+
+    if (IsEqualIID(riid, IID_IUnknown) || IsEqualIID(riid, IID_IDirectSound) || IsEqualIID(riid, IID_IDirectSound8)) {
+        *ppvObject = static_cast<IDirectSound8*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSound::AddRef()
+{
+    return ++m_RefCount;
+}
+
+STDMETHODIMP_(ULONG) SoftwareDSound::Release()
+{
+    ULONG refCount = --m_RefCount;
+    if (refCount == 0) {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP SoftwareDSound::CreateSoundBuffer(LPCDSBUFFERDESC pcDSBufferDesc, LPDIRECTSOUNDBUFFER* ppDSBuffer, LPUNKNOWN pUnkOuter)
+{
+    if (pcDSBufferDesc == nullptr || ppDSBuffer == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    if (pUnkOuter != nullptr) {
+        return DSERR_NOAGGREGATION;
+    }
+
+    if ((pcDSBufferDesc->dwFlags & DSBCAPS_PRIMARYBUFFER) != 0) {
+        *ppDSBuffer = new SoftwareDSoundPrimaryBuffer(this);
+        return DS_OK;
+    }
+
+    LPCWAVEFORMATEX pwfxFormat = pcDSBufferDesc->lpwfxFormat;
+    if (pwfxFormat == nullptr || pwfxFormat->nChannels == 0 || pcDSBufferDesc->dwBufferBytes < DSBSIZE_MIN || pcDSBufferDesc->dwBufferBytes > DSBSIZE_MAX) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    SoftwareMixerVoice* pVoice = m_Mixer->CreateVoice(pcDSBufferDesc->dwBufferBytes, pwfxFormat->nChannels,
+                                                      pwfxFormat->wBitsPerSample, pwfxFormat->nSamplesPerSec);
+    *ppDSBuffer = new SoftwareDSoundBuffer(this, pVoice, pcDSBufferDesc->dwFlags);
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound::GetCaps(LPDSCAPS pDSCaps)
+{
+    if (pDSCaps == nullptr || pDSCaps->dwSize < sizeof(DSCAPS)) {
+        return DSERR_INVALIDPARAM;
+    }
+    DWORD dwSize = pDSCaps->dwSize;
+    memset(pDSCaps, 0, dwSize);
+    pDSCaps->dwSize = dwSize;
+    pDSCaps->dwFlags = DSCAPS_PRIMARYSTEREO | DSCAPS_PRIMARY16BIT | DSCAPS_EMULDRIVER |
+                       DSCAPS_SECONDARYMONO | DSCAPS_SECONDARYSTEREO | DSCAPS_SECONDARY8BIT | DSCAPS_SECONDARY16BIT;
+    pDSCaps->dwMinSecondarySampleRate = DSBFREQUENCY_MIN;
+    pDSCaps->dwMaxSecondarySampleRate = DSBFREQUENCY_MAX;
+    pDSCaps->dwPrimaryBuffers = 1;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound::DuplicateSoundBuffer(LPDIRECTSOUNDBUFFER pDSBufferOriginal, LPDIRECTSOUNDBUFFER* ppDSBufferDuplicate)
+{
+    return DSERR_UNSUPPORTED;
+}
+
+STDMETHODIMP SoftwareDSound::SetCooperativeLevel(HWND hwnd, DWORD dwLevel)
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound::Compact()
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound::GetSpeakerConfig(LPDWORD pdwSpeakerConfig)
+{
+    if (pdwSpeakerConfig == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pdwSpeakerConfig = DSSPEAKER_STEREO;
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound::SetSpeakerConfig(DWORD dwSpeakerConfig)
+{
+    return DS_OK;
+}
+
+STDMETHODIMP SoftwareDSound::Initialize(LPCGUID pcGuidDevice)
+{
+    return DSERR_ALREADYINITIALIZED;
+}
+
+STDMETHODIMP SoftwareDSound::VerifyCertification(LPDWORD pdwCertified)
+{
+    if (pdwCertified == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+    *pdwCertified = DS_UNCERTIFIED;
+    return DS_OK;
+}
+
+// ******************************************************************
+// * Software DirectSound entry points
+// ******************************************************************
+HRESULT SoftwareDSoundCreate(int Output, LPDIRECTSOUND8* ppDS8)
+{
+    if (ppDS8 == nullptr) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    std::unique_ptr<SoftwareMixerSink> sink;
+
+    if (Output == AUDIO_OUTPUT_WAV) {
+        std::string wavPath = std::string(szFolder_CxbxReloadedData) + "\\Audio.wav";
+        std::unique_ptr<SoftwareMixerWavSink> wavSink(new SoftwareMixerWavSink(wavPath.c_str()));
+
+        if (wavSink->IsOpen()) {
+            EmuLog(LOG_LEVEL::INFO, "Software mixer output to %s", wavPath.c_str());
+            sink = std::move(wavSink);
+        }
+        else {
+            EmuLog(LOG_LEVEL::WARNING, "Unable to create %s, software mixer output is discarded", wavPath.c_str());
+        }
+    }
+    if (sink == nullptr) {
+        sink.reset(new SoftwareMixerNullSink);
+    }
+
+    *ppDS8 = new SoftwareDSound(std::move(sink));
+    return DS_OK;
+}
+
+static SoftwareDSoundBuffer* SoftwareDSoundBuffer_Get(LPDIRECTSOUNDBUFFER8 pDSBuffer)
+{
+    SoftwareDSoundBuffer* pBuffer = nullptr;
+
+    if (pDSBuffer == nullptr || FAILED(pDSBuffer->QueryInterface(IID_SoftwareDSoundBuffer, (LPVOID*)&pBuffer))) {
+        return nullptr;
+    }
+    // Only borrowed, caller still holds its own reference.
+    pBuffer->Release();
+    return pBuffer;
+}
+
+bool SoftwareDSoundBuffer_SetMixBins(LPDIRECTSOUNDBUFFER8 pDSBuffer, DWORD dwMixBinCount, const SoftwareMixerMixBin* pMixBins)
+{
+    SoftwareDSoundBuffer* pBuffer = SoftwareDSoundBuffer_Get(pDSBuffer);
+    if (pBuffer == nullptr) {
+        return false;
+    }
+
+    SoftwareMixerVoice* pVoice = pBuffer->GetVoice();
+    std::lock_guard<std::mutex> lock(pBuffer->GetMixer()->Mutex);
+
+    pVoice->MixBinCount = dwMixBinCount < SOFTWARE_MIXER_MIXBIN_MAX ? dwMixBinCount : SOFTWARE_MIXER_MIXBIN_MAX;
+    for (DWORD i = 0; i < pVoice->MixBinCount; i++) {
+        pVoice->MixBins[i] = pMixBins[i];
+    }
+    return true;
+}
+
+bool SoftwareDSoundBuffer_TransferMixBins(LPDIRECTSOUNDBUFFER8 pDSBufferOld, LPDIRECTSOUNDBUFFER8 pDSBufferNew)
+{
+    SoftwareDSoundBuffer* pBufferOld = SoftwareDSoundBuffer_Get(pDSBufferOld);
+    if (pBufferOld == nullptr) {
+        return false;
+    }
+
+    SoftwareMixerMixBin mixBins[SOFTWARE_MIXER_MIXBIN_MAX];
+    DWORD dwMixBinCount;
+    {
+        SoftwareMixerVoice* pVoice = pBufferOld->GetVoice();
+        std::lock_guard<std::mutex> lock(pBufferOld->GetMixer()->Mutex);
+
+        dwMixBinCount = pVoice->MixBinCount;
+        for (DWORD i = 0; i < dwMixBinCount; i++) {
+            mixBins[i] = pVoice->MixBins[i];
+        }
+    }
+
+    return SoftwareDSoundBuffer_SetMixBins(pDSBufferNew, dwMixBinCount, mixBins);
+}
@@ -0,0 +1,52 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <dsound.h>
+#include "core/hle/DSOUND/common/SoftwareMixer.hpp"
+
+// DirectSound8 device implemented on top of SoftwareMixer, used in place of the
+// host device when the audio output setting is not AUDIO_OUTPUT_HOST.
+HRESULT SoftwareDSoundCreate(int Output, LPDIRECTSOUND8* ppDS8);
+
+// Mixbin routing has no host DirectSound equivalent, so it is passed on through
+// these instead. They return false and do nothing for host buffers.
+bool SoftwareDSoundBuffer_SetMixBins(LPDIRECTSOUNDBUFFER8 pDSBuffer, DWORD dwMixBinCount, const SoftwareMixerMixBin* pMixBins);
+bool SoftwareDSoundBuffer_TransferMixBins(LPDIRECTSOUNDBUFFER8 pDSBufferOld, LPDIRECTSOUNDBUFFER8 pDSBufferNew);
+
+template<class T>
+static inline bool SoftwareDSoundBuffer_SetMixBins(LPDIRECTSOUNDBUFFER8 pDSBuffer, const T& Xb_VoiceProperties)
+{
+    SoftwareMixerMixBin mixBins[SOFTWARE_MIXER_MIXBIN_MAX];
+    DWORD count = Xb_VoiceProperties.dwMixBinCount;
+
+    if (count > SOFTWARE_MIXER_MIXBIN_MAX) {
+        count = SOFTWARE_MIXER_MIXBIN_MAX;
+    }
+    for (DWORD i = 0; i < count; i++) {
+        mixBins[i].MixBin = Xb_VoiceProperties.MixBinVolumePairs[i].dwMixBin;
+        mixBins[i].Volume = Xb_VoiceProperties.MixBinVolumePairs[i].lVolume;
+    }
+
+    return SoftwareDSoundBuffer_SetMixBins(pDSBuffer, count, mixBins);
+}
@@ -45,6 +45,7 @@
 #include "Intercept.hpp"
 #include "Patches.hpp"
 #include "common\util\hasher.h"
+#include "Tracing.h"
 
 #include <Shlwapi.h>
 #include <shlobj.h>
@@ -322,6 +323,8 @@ void EmuUpdateLLEStatus(uint32_t XbLibScan)
 // NOTE: EmuHLEIntercept do not get to be in XbSymbolDatabase, do the intecept in Cxbx project only.
 void EmuHLEIntercept(Xbe::Header *pXbeHeader)
 {
+	TRACE_FUNC("hle");
+
 	Xbe::LibraryVersion *pLibraryVersion = (Xbe::LibraryVersion*)pXbeHeader->dwLibraryVersionsAddr;
 
 	uint16_t xdkVersion = 0;
@@ -32,6 +32,7 @@
 #include "core\hle\DSOUND\DirectSound\DirectSound.hpp"
 #include "Patches.hpp"
 #include "Intercept.hpp"
+#include "Tracing.h"
 
 #include <map>
 #include <unordered_map>
@@ -428,6 +429,8 @@ inline void EmuInstallPatch(const std::string FunctionName, const xbaddr Functio
 
 void EmuInstallPatches()
 {
+	TRACE_FUNC("hle");
+
 	for (const auto& it : g_SymbolAddresses) {
 		EmuInstallPatch(it.first, it.second);
 	}
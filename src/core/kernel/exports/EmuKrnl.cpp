@@ -162,7 +162,7 @@ void CallSoftwareInterrupt(const xboxkrnl::KIRQL SoftwareIrql)
 		KiUnexpectedInterrupt();
 		break;
 	case APC_LEVEL: // = 1 // HalpApcInterrupt        
-		EmuLog(LOG_LEVEL::WARNING, "Unimplemented Software Interrupt (APC)"); // TODO : ExecuteApcQueue();
+		xboxkrnl::KiDeliverApc(xboxkrnl::KernelMode);
 		break;
 	case DISPATCH_LEVEL: // = 2
 		ExecuteDpcQueue();
@@ -50,15 +50,40 @@ xboxkrnl::PLIST_ENTRY RemoveTailList(xboxkrnl::PLIST_ENTRY pListHead);
 extern xboxkrnl::LAUNCH_DATA_PAGE DefaultLaunchDataPage;
 extern xboxkrnl::PKINTERRUPT EmuInterruptList[MAX_BUS_INTERRUPT_LEVEL + 1];
 
+class HalSystemInterrupt;
+
+// Interrupt controller model : a bit per bus interrupt level that is set when an interrupt becomes pending,
+// and an event that wakes the interrupt thread (see CxbxKrnlInterruptThread)
+void HalSignalInterrupt(HalSystemInterrupt *Interrupt);
+uint32_t HalTakePendingInterrupts();
+void HalKeepPendingInterrupts(uint32_t Mask);
+extern HANDLE HalInterruptEvent;
+
+// Histogram of the interrupt delivery latency, from the assertion of the line to the entry of the isr
+void HalRecordInterruptLatency(LONGLONG AssertedTicks);
+void HalPrintInterruptStats();
+
+// Histograms of the dpc latency, from KeInsertQueueDpc to the start of the routine, and of the dpc execution time
+void KePrintDpcStats();
+
 class HalSystemInterrupt {
 public:
 	void Assert(bool state) {
 		// If the interrupt was marked as Asserted, and was previously not, set the pending flag too!
-		if (m_Asserted == 0 && state == 1) {
+		bool raised = (m_Asserted == 0 && state == 1);
+		if (raised) {
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			m_AssertedTicks = now.QuadPart;
 			m_Pending = true;
 		}
 
 		m_Asserted = state;
+
+		// Signal only now, so that the interrupt thread already sees the interrupt as pending
+		if (raised) {
+			HalSignalInterrupt(this);
+		}
 	};
 
 	void Enable() {
@@ -88,6 +113,12 @@ public:
 			m_Pending = false;
 		}
 
+		// Only the first delivery after the assertion counts, latched interrupts are re-triggered until deasserted
+		if (m_AssertedTicks != 0) {
+			HalRecordInterruptLatency(m_AssertedTicks);
+			m_AssertedTicks = 0;
+		}
+
 		__try {
 			BOOLEAN(__stdcall *ServiceRoutine)(xboxkrnl::PKINTERRUPT, void*) = (BOOLEAN(__stdcall *)(xboxkrnl::PKINTERRUPT, void*))Interrupt->ServiceRoutine;
 			BOOLEAN result = ServiceRoutine(Interrupt, Interrupt->ServiceContext);
@@ -102,6 +133,7 @@ private:
 	bool m_Enabled = false;
 	xboxkrnl::KINTERRUPT_MODE m_InterruptMode;
 	bool m_Pending = false;
+	LONGLONG m_AssertedTicks = 0;
 };
 
 extern HalSystemInterrupt HalSystemInterrupts[MAX_BUS_INTERRUPT_LEVEL + 1];
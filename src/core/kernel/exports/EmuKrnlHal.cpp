@@ -50,13 +50,22 @@ namespace xboxkrnl
 #include "common/util/strConverter.hpp" // for utf16_to_ascii
 #include "core\kernel\memory-manager\VMManager.h"
 #include "common/util/cliConfig.hpp"
+#include "Timer.h" // For HostClockFrequency
 
 #include <algorithm> // for std::replace
+#include <atomic>
 #include <locale>
 #include <codecvt>
 
+// Interrupt delivery latency buckets : bucket n counts the deliveries that took less than 2^n us (but
+// at least 2^(n-1) us), the last one counts everything slower
+#define INTERRUPT_LATENCY_BUCKETS 16
+
 volatile DWORD HalInterruptRequestRegister = APC_LEVEL | DISPATCH_LEVEL;
 HalSystemInterrupt HalSystemInterrupts[MAX_BUS_INTERRUPT_LEVEL + 1];
+HANDLE HalInterruptEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+static std::atomic<uint32_t> HalPendingInterrupts(0);
+static std::atomic<uint32_t> HalInterruptLatency[INTERRUPT_LATENCY_BUCKETS + 1];
 
 // variables used by the SMC to know a reset / shutdown is pending
 uint8_t ResetOrShutdownCommandCode = 0;
@@ -72,6 +81,49 @@ xboxkrnl::LIST_ENTRY ShutdownRoutineList = { &ShutdownRoutineList , &ShutdownRou
 // ******************************************************************
 xboxkrnl::KPCR* WINAPI KeGetPcr();
 
+void HalSignalInterrupt(HalSystemInterrupt *Interrupt)
+{
+	HalPendingInterrupts.fetch_or(1 << (Interrupt - HalSystemInterrupts));
+	SetEvent(HalInterruptEvent);
+}
+
+uint32_t HalTakePendingInterrupts()
+{
+	return HalPendingInterrupts.exchange(0);
+}
+
+// Puts back interrupts that couldn't be delivered yet, without waking the interrupt thread : they are
+// retried on its next wake up, which happens at the latest on the next clock tick
+void HalKeepPendingInterrupts(uint32_t Mask)
+{
+	if (Mask != 0) {
+		HalPendingInterrupts.fetch_or(Mask);
+	}
+}
+
+void HalRecordInterruptLatency(LONGLONG AssertedTicks)
+{
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	uint64_t Microseconds = ((uint64_t)(Now.QuadPart - AssertedTicks) * 1000000) / HostClockFrequency;
+
+	unsigned Bucket = 0;
+	while (Bucket < INTERRUPT_LATENCY_BUCKETS && Microseconds >= (1ull << Bucket)) {
+		Bucket++;
+	}
+
+	HalInterruptLatency[Bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HalPrintInterruptStats()
+{
+	printf("Interrupt Delivery Latency: \n");
+	for (unsigned Bucket = 0; Bucket < INTERRUPT_LATENCY_BUCKETS; Bucket++) {
+		printf("- < %u us: %u\n", 1u << Bucket, HalInterruptLatency[Bucket].load());
+	}
+	printf("- >= %u us: %u\n", 1u << INTERRUPT_LATENCY_BUCKETS, HalInterruptLatency[INTERRUPT_LATENCY_BUCKETS].load());
+}
+
 #define TRAY_CLOSED_MEDIA_PRESENT 0x60
 #define TRAY_CLOSED_NO_MEDIA 0x40
 #define TRAY_OPEN 0x10
@@ -593,6 +645,8 @@ XBSYSAPI EXPORTNUM(49) xboxkrnl::VOID DECLSPEC_NORETURN NTAPI xboxkrnl::HalRetur
 
 				// Some titles (Xbox Dashboard and retail/demo discs) use ";" as a current directory path seperator
 				// This process is handled during initialization. No speical handling here required.
+				// Likewise, an xbe on a D: drive served from an XISO image resolves to "<image>.iso\\<xbe>" here,
+				// which CxbxKrnlEmulate splits into the image to mount and the xbe to boot from it.
 
 				cli_config::SetLoad(XbePath);
 				if (!CxbxExec(false, nullptr, false)) {
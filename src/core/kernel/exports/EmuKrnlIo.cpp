@@ -39,6 +39,7 @@ namespace xboxkrnl
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "core\kernel\support\Emu.h" // For EmuLog(LOG_LEVEL::WARNING, )
 #include "core\kernel\support\EmuFile.h" // For CxbxCreateSymbolicLink(), etc.
+#include "core\kernel\support\EmuXiso.h" // For CxbxXisoCreateFile()
 #include "CxbxDebugger.h"
 
 // ******************************************************************
@@ -269,7 +270,19 @@ XBSYSAPI EXPORTNUM(66) xboxkrnl::NTSTATUS NTAPI xboxkrnl::IoCreateFile
 	// Force ShareAccess to all 
 	ShareAccess = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
 
-    if (SUCCEEDED(ret))
+	NTSTATUS missingStatus;
+	if (SUCCEEDED(ret) && CxbxXisoCreateFile(nativeObjectAttributes, Disposition, CreateOptions, FileHandle, &ret))
+	{
+		// Served from a mounted XISO image
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = SUCCEEDED(ret) ? /*FILE_OPENED=*/1 : 0;
+	}
+	else if (SUCCEEDED(ret) && Disposition == FILE_OPEN && (missingStatus = CxbxLookupMissingPath(nativeObjectAttributes)) != STATUS_SUCCESS)
+	{
+		// The host already told us this file doesn't exist, and nothing was created since
+		ret = missingStatus;
+	}
+	else if (SUCCEEDED(ret))
     {
         // redirect to NtCreateFile
         ret = NtDll::NtCreateFile(
@@ -289,6 +302,16 @@ XBSYSAPI EXPORTNUM(66) xboxkrnl::NTSTATUS NTAPI xboxkrnl::IoCreateFile
         {
             CxbxDebugger::ReportFileOpened(*FileHandle, nativeObjectAttributes.NtUnicodeString.Buffer, SUCCEEDED(ret));
         }
+
+        if (Disposition == FILE_OPEN)
+        {
+            CxbxRememberMissingPath(nativeObjectAttributes, ret);
+        }
+        else if (SUCCEEDED(ret))
+        {
+            // This may have created a file or directory that was cached as missing
+            CxbxInvalidatePathCache(/*MissingPathsOnly=*/true);
+        }
     }
 
 	if (FAILED(ret))
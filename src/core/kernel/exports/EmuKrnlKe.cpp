@@ -85,22 +85,54 @@ namespace NtDll
 #include "EmuKrnlKi.h" // For KiRemoveTreeTimer(), KiInsertTreeTimer()
 #include "EmuKrnlKe.h"
 #include "core\kernel\support\EmuFile.h" // For IsEmuHandle(), NtStatusToString()
+#include "core\kernel\support\DpcStack.h"
 #include "Timer.h"
 
 #include <chrono>
 #include <thread>
 #include <windows.h>
+#include <atomic>
 #include <map>
+#include <mutex>
+
+// The Xbox kernel doesn't export KeSetImportanceDpc, but we still honour the importance of the dpc's
+#define DPC_LOW_IMPORTANCE 0
+#define DPC_MEDIUM_IMPORTANCE 1
+#define DPC_HIGH_IMPORTANCE 2
+
+// Dpc latency (from the insertion to the start of the routine) and execution time buckets : bucket n
+// counts the dpc's that took less than 2^n us, the last one counts everything slower
+#define DPC_STATS_BUCKETS 16
 
 // Copied over from Dxbx. 
 // TODO : Move towards thread-simulation based Dpc emulation
 typedef struct _DpcData {
-	CRITICAL_SECTION Lock;
-	HANDLE DpcEvent;
-	xboxkrnl::LIST_ENTRY DpcQueue; // TODO : Use KeGetCurrentPrcb()->DpcListHead instead
+	// The inserted dpc's, linked through DpcListEntry. The stamp of a dpc holds the low bits of the host ticks of its insertion
+	DpcStack Pending;
+	// Held while a thread runs the queue, since dpc's don't run concurrently
+	std::mutex DrainMtx;
+	ClockScale TicksToUs;
+	std::atomic<uint32_t> Latency[DPC_STATS_BUCKETS + 1];
+	std::atomic<uint32_t> RunTime[DPC_STATS_BUCKETS + 1];
 } DpcData;
 
-DpcData g_DpcData = { 0 }; // Note : g_DpcData is initialized in InitDpcThread()
+DpcData g_DpcData; // Note : g_DpcData is initialized in InitDpcThread()
+static thread_local bool g_DpcDraining = false; // Set while this thread runs the queue, since dpc's don't nest
+
+static inline DpcLink *DpcLinkOf(xboxkrnl::PKDPC Dpc)
+{
+	return reinterpret_cast<DpcLink *>(&Dpc->DpcListEntry);
+}
+
+static inline DpcState *DpcStateOf(xboxkrnl::PKDPC Dpc)
+{
+	return reinterpret_cast<DpcState *>(&Dpc->Inserted);
+}
+
+static inline xboxkrnl::PKDPC DpcOf(DpcLink *Link)
+{
+	return CONTAINING_RECORD(reinterpret_cast<xboxkrnl::PLIST_ENTRY>(Link), xboxkrnl::KDPC, DpcListEntry);
+}
 
 xboxkrnl::ULONGLONG LARGE_INTEGER2ULONGLONG(xboxkrnl::LARGE_INTEGER value)
 {
@@ -130,6 +162,13 @@ xboxkrnl::ULONGLONG LARGE_INTEGER2ULONGLONG(xboxkrnl::LARGE_INTEGER value)
         break; \
     }
 
+// NtQueueApcThread queues host apc's, which only run in an alertable host wait
+#define TestForHostApc(Alertable) \
+    if ((Alertable) && (WaitMode != KernelMode) && (SleepEx(0, TRUE) == WAIT_IO_COMPLETION)) { \
+        WaitStatus = STATUS_USER_APC; \
+        break; \
+    }
+
 
 // ******************************************************************
 // * KeGetPcr()
@@ -276,99 +315,157 @@ xboxkrnl::VOID NTAPI xboxkrnl::KeInitializeTimer
 #define KeRaiseIrql(NewIrql, OldIrql) \
 	*(OldIrql) = KfRaiseIrql(NewIrql)
 
+static void RecordDpcTime(std::atomic<uint32_t> *Buckets, uint64_t Ticks)
+{
+	uint64_t Microseconds = ClockScale_Convert(&g_DpcData.TicksToUs, Ticks);
+
+	unsigned Bucket = 0;
+	while (Bucket < DPC_STATS_BUCKETS && Microseconds >= (1ull << Bucket)) {
+		Bucket++;
+	}
+
+	Buckets[Bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void RunDpc(xboxkrnl::PKDPC pkdpc)
+{
+	LARGE_INTEGER StartTicks;
+	LARGE_INTEGER EndTicks;
+
+	// Take the dpc off the stack. The caller already read its next link, since a concurrent insertion can now push it again
+	ULONG InsertedTicks = (ULONG)DpcStack::Unlink(*DpcLinkOf(pkdpc));
+
+	// Copy the arguments before retiring it, since from then on a new insertion can overwrite them
+	xboxkrnl::PVOID DeferredContext = pkdpc->DeferredContext;
+	xboxkrnl::PVOID SystemArgument1 = pkdpc->SystemArgument1;
+	xboxkrnl::PVOID SystemArgument2 = pkdpc->SystemArgument2;
+
+	// Mark it as no longer inserted, unless it was removed in the meantime
+	if (!DpcStack::Retire(*DpcStateOf(pkdpc))) {
+		return;
+	}
+
+	QueryPerformanceCounter(&StartTicks);
+	RecordDpcTime(g_DpcData.Latency, (ULONG)(StartTicks.LowPart - InsertedTicks));
+
+	// Set DpcRoutineActive to support KeIsExecutingDpc:
+	KeGetCurrentPrcb()->DpcRoutineActive = TRUE; // Experimental
+	EmuLog(LOG_LEVEL::DEBUG, "Global DpcQueue, calling DPC at 0x%.8X", pkdpc->DeferredRoutine);
+	__try {
+		// Call the Deferred Procedure  :
+		pkdpc->DeferredRoutine(
+			pkdpc,
+			DeferredContext,
+			SystemArgument1,
+			SystemArgument2);
+	} __except (EmuException(GetExceptionInformation()))
+	{
+		EmuLog(LOG_LEVEL::WARNING, "Problem with ExceptionFilter!");
+	}
+
+	KeGetCurrentPrcb()->DpcRoutineActive = FALSE; // Experimental
+
+	QueryPerformanceCounter(&EndTicks);
+	RecordDpcTime(g_DpcData.RunTime, EndTicks.QuadPart - StartTicks.QuadPart);
+}
+
 void ExecuteDpcQueue()
 {
+	DpcLink *Entry;
+	DpcLink *Next;
+	DpcLink *Heads[DPC_HIGH_IMPORTANCE + 1];
+	DpcLink *Tails[DPC_HIGH_IMPORTANCE + 1];
 	xboxkrnl::PKDPC pkdpc;
+	int Importance;
 
-	// While we're working with the DpcQueue, we need to be thread-safe :
-	EnterCriticalSection(&(g_DpcData.Lock));
-
-//    if (g_DpcData._fShutdown)
-//        break; // while 
+	// A dpc that lowers the irql lands here again, the running loop below picks up what it inserted
+	if (g_DpcDraining) {
+		return;
+	}
 
-//    Assert(g_DpcData._dwThreadId == GetCurrentThreadId());
-//    Assert(g_DpcData._dwDpcThreadId == 0);
-//    g_DpcData._dwDpcThreadId = g_DpcData._dwThreadId;
-//    Assert(g_DpcData._dwDpcThreadId != 0);
+	// Dpc's run before the irql drops below DISPATCH_LEVEL, so when another thread is running the queue, wait
+	// for it to finish instead of returning while our dpc's may still be pending
+	std::lock_guard<std::mutex> lock(g_DpcData.DrainMtx);
+	g_DpcDraining = true;
 
-	// Are there entries in the DpqQueue?
-	while (!IsListEmpty(&(g_DpcData.DpcQueue)))
+	// Take all the pending dpc's at once, in their insertion order, which is kept inside each importance
+	while ((Entry = g_DpcData.Pending.TakeAll()) != nullptr)
 	{
-		// Extract the head entry and retrieve the containing KDPC pointer for it:
-		pkdpc = CONTAINING_RECORD(RemoveHeadList(&(g_DpcData.DpcQueue)), xboxkrnl::KDPC, DpcListEntry);
-		// Mark it as no longer linked into the DpcQueue
-		pkdpc->Inserted = FALSE;
-		// Set DpcRoutineActive to support KeIsExecutingDpc:
-		KeGetCurrentPrcb()->DpcRoutineActive = TRUE; // Experimental
-		EmuLog(LOG_LEVEL::DEBUG, "Global DpcQueue, calling DPC at 0x%.8X", pkdpc->DeferredRoutine);
-		__try {
-			// Call the Deferred Procedure  :
-			pkdpc->DeferredRoutine(
-				pkdpc,
-				pkdpc->DeferredContext,
-				pkdpc->SystemArgument1,
-				pkdpc->SystemArgument2);
-		} __except (EmuException(GetExceptionInformation()))
-		{
-			EmuLog(LOG_LEVEL::WARNING, "Problem with ExceptionFilter!");
+		for (Importance = 0; Importance <= DPC_HIGH_IMPORTANCE; Importance++) {
+			Heads[Importance] = nullptr;
+			Tails[Importance] = nullptr;
 		}
 
-		KeGetCurrentPrcb()->DpcRoutineActive = FALSE; // Experimental
+		// The links can still be changed here, since the dpc's only leave the stack in RunDpc
+		for (; Entry != nullptr; Entry = Next) {
+			Next = Entry->Next.load(std::memory_order_relaxed);
+			pkdpc = DpcOf(Entry);
+			Importance = (pkdpc->Importance > DPC_HIGH_IMPORTANCE) ? DPC_HIGH_IMPORTANCE : pkdpc->Importance;
+			Entry->Next.store(nullptr, std::memory_order_relaxed);
+			if (Tails[Importance] == nullptr) {
+				Heads[Importance] = Entry;
+			} else {
+				Tails[Importance]->Next.store(Entry, std::memory_order_relaxed);
+			}
+			Tails[Importance] = Entry;
+		}
+
+		for (Importance = DPC_HIGH_IMPORTANCE; Importance >= DPC_LOW_IMPORTANCE; Importance--) {
+			for (Entry = Heads[Importance]; Entry != nullptr; Entry = Next) {
+				Next = Entry->Next.load(std::memory_order_relaxed);
+				RunDpc(DpcOf(Entry));
+			}
+		}
 	}
 
-//    Assert(g_DpcData._dwThreadId == GetCurrentThreadId());
-//    Assert(g_DpcData._dwDpcThreadId == g_DpcData._dwThreadId);
-//    g_DpcData._dwDpcThreadId = 0;
-	LeaveCriticalSection(&(g_DpcData.Lock));
+	g_DpcDraining = false;
 }
 
-void InitDpcThread()
+void KePrintDpcStats()
 {
-	DWORD dwThreadId = 0;
+	printf("DPC Latency: \n");
+	for (unsigned Bucket = 0; Bucket < DPC_STATS_BUCKETS; Bucket++) {
+		printf("- < %u us: %u\n", 1u << Bucket, g_DpcData.Latency[Bucket].load());
+	}
+	printf("- >= %u us: %u\n", 1u << DPC_STATS_BUCKETS, g_DpcData.Latency[DPC_STATS_BUCKETS].load());
+
+	printf("DPC Execution Time: \n");
+	for (unsigned Bucket = 0; Bucket < DPC_STATS_BUCKETS; Bucket++) {
+		printf("- < %u us: %u\n", 1u << Bucket, g_DpcData.RunTime[Bucket].load());
+	}
+	printf("- >= %u us: %u\n", 1u << DPC_STATS_BUCKETS, g_DpcData.RunTime[DPC_STATS_BUCKETS].load());
+}
 
-	InitializeCriticalSection(&(g_DpcData.Lock));
-	InitializeListHead(&(g_DpcData.DpcQueue));
-	EmuLogEx(CXBXR_MODULE::INIT, LOG_LEVEL::DEBUG, "Creating DPC event\n");
-	g_DpcData.DpcEvent = CreateEvent(/*lpEventAttributes=*/nullptr, /*bManualReset=*/FALSE, /*bInitialState=*/FALSE, /*lpName=*/nullptr);
+void InitDpcThread()
+{
+	g_DpcData.Pending.Clear();
+	ClockScale_Init(&g_DpcData.TicksToUs, HostClockFrequency, SCALE_S_IN_US);
 }
 
 #define XBOX_TSC_FREQUENCY 733333333 // Xbox Time Stamp Counter Frequency = 733333333 (CPU Clock)
 #define XBOX_ACPI_FREQUENCY 3375000  // Xbox ACPI frequency (3.375 mhz)
-ULONGLONG NativeToXbox_FactorForRdtsc;
-ULONGLONG NativeToXbox_FactorForAcpi;
-
-ULONGLONG CxbxGetPerformanceCounter(bool acpi) {
-	LARGE_INTEGER tsc;
-	ULARGE_INTEGER scaledTsc;
+// Conversions of the host performance counter to the Xbox clocks, computed once by CxbxInitPerformanceCounters
+ClockScale NativeToXbox_ScaleForRdtsc;
+ClockScale NativeToXbox_ScaleForAcpi;
+
+ULONGLONG CxbxGetPerformanceCounter(bool acpi) {
+	LARGE_INTEGER tsc;
 
 	QueryPerformanceCounter(&tsc);
 
-	scaledTsc.QuadPart = 1000000000;
-	scaledTsc.QuadPart *= (ULONGLONG)tsc.QuadPart;
-
-	if (acpi == false && NativeToXbox_FactorForRdtsc) {
-		scaledTsc.QuadPart /= NativeToXbox_FactorForRdtsc;
-		return scaledTsc.QuadPart;
-	}	else if (acpi == true && NativeToXbox_FactorForRdtsc) {
-		scaledTsc.QuadPart /= NativeToXbox_FactorForAcpi;
-		return scaledTsc.QuadPart;
-	}
-
-	return (uint64_t)tsc.QuadPart;
-}
-
-void CxbxInitPerformanceCounters()
-{
-	uint64_t t;
-	t = 1000000000;
-	t *= HostClockFrequency;
-	t /= XBOX_TSC_FREQUENCY;
-	NativeToXbox_FactorForRdtsc = t;
+	if (acpi == false && NativeToXbox_ScaleForRdtsc.Multiplier) {
+		return ClockScale_Convert(&NativeToXbox_ScaleForRdtsc, tsc.QuadPart);
+	}	else if (acpi == true && NativeToXbox_ScaleForAcpi.Multiplier) {
+		return ClockScale_Convert(&NativeToXbox_ScaleForAcpi, tsc.QuadPart);
+	}
+
+	return (uint64_t)tsc.QuadPart;
+}
 
-	t = 1000000000;
-	t *= HostClockFrequency;
-	t /= XBOX_ACPI_FREQUENCY;
-	NativeToXbox_FactorForAcpi = t;
+void CxbxInitPerformanceCounters()
+{
+	ClockScale_Init(&NativeToXbox_ScaleForRdtsc, HostClockFrequency, XBOX_TSC_FREQUENCY);
+	ClockScale_Init(&NativeToXbox_ScaleForAcpi, HostClockFrequency, XBOX_ACPI_FREQUENCY);
 
 	// Let's initialize the Dpc handling thread too,
 	// here for now (should be called by our caller)
@@ -378,39 +475,57 @@ void CxbxInitPerformanceCounters()
 // ******************************************************************
 // * 0x005C - KeAlertResumeThread()
 // ******************************************************************
-// Source:Dxbx
-XBSYSAPI EXPORTNUM(92) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeAlertResumeThread
+// Sets a kernel mode alert, and wakes the thread when it waits
+XBSYSAPI EXPORTNUM(92) xboxkrnl::ULONG NTAPI xboxkrnl::KeAlertResumeThread
 (
-	IN HANDLE ThreadHandle,
-	IN OUT PULONG PreviousSuspendCount
+	IN PKTHREAD Thread
 )
 {
-	LOG_FUNC_BEGIN
-		LOG_FUNC_ARG(ThreadHandle)
-		LOG_FUNC_ARG_OUT(PreviousSuspendCount)
-		LOG_FUNC_END;
+	LOG_FUNC_ONE_ARG(Thread);
 
-	// TODO : Result = NtDll::NtAlertResumeThread(ThreadHandle, PreviousSuspendCount);
-	LOG_UNIMPLEMENTED();
+	KIRQL OldIrql;
+	KiLockDispatcherDatabase(&OldIrql);
 
-	RETURN(S_OK);
+	if (Thread->Alerted[KernelMode] == FALSE) {
+		Thread->Alerted[KernelMode] = TRUE;
+		KiWaitWakeThread(((PETHREAD)Thread)->UniqueThread);
+	}
+
+	// Suspension isn't modelled (see KeResumeThread), so there is no suspend count to lower
+	ULONG OldCount = Thread->SuspendCount;
+
+	KiUnlockDispatcherDatabase(OldIrql);
+
+	RETURN(OldCount);
 }
 
 // ******************************************************************
 // * 0x005D - KeAlertThread()
 // ******************************************************************
-// Source:Dxbx
-XBSYSAPI EXPORTNUM(93) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeAlertThread
+XBSYSAPI EXPORTNUM(93) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeAlertThread
 (
-	IN HANDLE ThreadHandle
+	IN PKTHREAD Thread,
+	IN KPROCESSOR_MODE AlertMode
 )
 {
-	LOG_FUNC_ONE_ARG(ThreadHandle);
+	LOG_FUNC_BEGIN
+		LOG_FUNC_ARG(Thread)
+		LOG_FUNC_ARG(AlertMode)
+		LOG_FUNC_END;
 
-// TODO : Result = NtDll::NtAlertThread(ThreadHandle);
-	LOG_UNIMPLEMENTED();
+	KIRQL OldIrql;
+	KiLockDispatcherDatabase(&OldIrql);
 
-	RETURN(S_OK);
+	// An alertable wait of the thread takes the alert once woken, otherwise its next alertable wait does
+	BOOLEAN Alerted = Thread->Alerted[AlertMode];
+	if (Alerted == FALSE) {
+		Thread->Alerted[AlertMode] = TRUE;
+		KiWaitWakeThread(((PETHREAD)Thread)->UniqueThread);
+	}
+
+	KiUnlockDispatcherDatabase(OldIrql);
+
+	RETURN(Alerted);
 }
 
 // ******************************************************************
@@ -726,6 +841,8 @@ XBSYSAPI EXPORTNUM(107) xboxkrnl::VOID NTAPI xboxkrnl::KeInitializeDpc
 	// inialize Dpc field values
 	Dpc->Type = DpcObject;
 	Dpc->Inserted = FALSE;
+	Dpc->Importance = DPC_MEDIUM_IMPORTANCE;
+	Dpc->DpcListEntry.Blink = nullptr; // not on the pending dpc stack
 	Dpc->DeferredRoutine = DeferredRoutine;
 	Dpc->DeferredContext = DeferredContext;
 }
@@ -1044,9 +1161,19 @@ XBSYSAPI EXPORTNUM(118) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeInsertQueueApc
 		LOG_FUNC_ARG(Increment)
 		LOG_FUNC_END;
 
-	LOG_UNIMPLEMENTED();
+	KIRQL OldIrql;
+	KiLockApcQueue(Apc->Thread, &OldIrql);
 
-	RETURN(TRUE);
+	BOOLEAN Inserted = FALSE;
+	if (Apc->Thread->ApcState.ApcQueueable) {
+		Apc->SystemArgument1 = SystemArgument1;
+		Apc->SystemArgument2 = SystemArgument2;
+		Inserted = KiInsertQueueApc(Apc, Increment);
+	}
+
+	KiUnlockApcQueue(Apc->Thread, OldIrql);
+
+	RETURN(Inserted);
 }
 
 // ******************************************************************
@@ -1065,18 +1192,18 @@ XBSYSAPI EXPORTNUM(119) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeInsertQueueDpc
 		LOG_FUNC_ARG(SystemArgument2)
 		LOG_FUNC_END;
 
-	// For thread safety, enter the Dpc lock:
-	EnterCriticalSection(&(g_DpcData.Lock));
-	// TODO : Instead, disable interrupts - use KeRaiseIrql(HIGH_LEVEL, &(KIRQL)OldIrql) ?
-
-	BOOLEAN NeedsInsertion = (Dpc->Inserted == FALSE);
+	// Only one thread can claim the dpc, the others see it as already inserted
+	BOOLEAN NeedsInsertion = DpcStack::Claim(*DpcStateOf(Dpc));
 
 	if (NeedsInsertion) {
-		// Remember the arguments and link it into our DpcQueue :
-		Dpc->Inserted = TRUE;
+		LARGE_INTEGER InsertedTicks;
+
+		// Remember the arguments, and only then allow ExecuteDpcQueue to run it
 		Dpc->SystemArgument1 = SystemArgument1;
 		Dpc->SystemArgument2 = SystemArgument2;
-		InsertTailList(&(g_DpcData.DpcQueue), &(Dpc->DpcListEntry));
+		QueryPerformanceCounter(&InsertedTicks);
+		g_DpcData.Pending.Push(*DpcStateOf(Dpc), *DpcLinkOf(Dpc), InsertedTicks.LowPart);
+
 		// TODO : Instead of DpcQueue, add the DPC to KeGetCurrentPrcb()->DpcListHead
 		// Signal the Dpc handling code there's work to do
 		HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
@@ -1085,10 +1212,6 @@ XBSYSAPI EXPORTNUM(119) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeInsertQueueDpc
 		//	pKPRCB->DpcInterruptRequested = TRUE;
 	}
 
-	// Thread-safety is no longer required anymore
-	LeaveCriticalSection(&(g_DpcData.Lock));
-	// TODO : Instead, enable interrupts - use KeLowerIrql(OldIrql) ?
-
 	RETURN(NeedsInsertion);
 }
 
@@ -1157,13 +1280,11 @@ XBSYSAPI EXPORTNUM(123) xboxkrnl::LONG NTAPI xboxkrnl::KePulseEvent
 	}
 
 	LONG OldState = Event->Header.SignalState;
-	if ((OldState == 0) && (IsListEmpty(&Event->Header.WaitListHead) == FALSE)) {
-		Event->Header.SignalState = 1;
+	if (OldState == 0) {
 		// TODO: KiWaitTest(Event, Increment);
-		// For now, we just sleep to give other threads time to wake
-		// KiWaitTest and related functions require correct thread scheduling to implement first
-		// This will have to wait until CPU emulation at v1.0
-		Sleep(1);
+		// For now, the waiting threads are readied through the host wait queues. The event goes back to
+		// the non-signalled state immediately, so they take the pulse itself as the signal
+		KiWaitPulseObject(Event, Increment, Event->Header.Type == NotificationEvent);
 	}
 
 	Event->Header.SignalState = 0;
@@ -1305,9 +1426,42 @@ XBSYSAPI EXPORTNUM(131) xboxkrnl::LONG NTAPI xboxkrnl::KeReleaseMutant
 		LOG_FUNC_ARG(Wait)
 		LOG_FUNC_END;
 
-	LOG_UNIMPLEMENTED();
-	
-	RETURN(0);
+	KIRQL OldIrql;
+	KiLockDispatcherDatabase(&OldIrql);
+
+	LONG OldState = Mutant->Header.SignalState;
+	if (Abandoned != FALSE) {
+		Mutant->Header.SignalState = 1;
+		Mutant->Abandoned = TRUE;
+	} else {
+		if (Mutant->OwnerThread != KeGetCurrentThread()) {
+			KiUnlockDispatcherDatabase(OldIrql);
+			ExRaiseStatus(Mutant->Abandoned ? STATUS_ABANDONED : STATUS_MUTANT_NOT_OWNED);
+		}
+
+		Mutant->Header.SignalState++;
+	}
+
+	// The last release hands the mutant back : take it off the owner's list and ready its waiters
+	if (Mutant->Header.SignalState == 1) {
+		if (OldState <= 0) {
+			RemoveEntryList(&Mutant->MutantListEntry);
+		}
+
+		Mutant->OwnerThread = NULL;
+		// TODO: KiWaitTest(Mutant, Increment);
+		KiWaitReadyObject(Mutant, Increment);
+	}
+
+	if (Wait != FALSE) {
+		PRKTHREAD Thread = KeGetCurrentThread();
+		Thread->WaitIrql = OldIrql;
+		Thread->WaitNext = Wait;
+	} else {
+		KiUnlockDispatcherDatabase(OldIrql);
+	}
+
+	RETURN(OldState);
 }
 
 XBSYSAPI EXPORTNUM(132) xboxkrnl::LONG NTAPI xboxkrnl::KeReleaseSemaphore
@@ -1336,6 +1490,7 @@ XBSYSAPI EXPORTNUM(132) xboxkrnl::LONG NTAPI xboxkrnl::KeReleaseSemaphore
 		ExRaiseStatus(STATUS_SEMAPHORE_LIMIT_EXCEEDED);
 	}
 	Semaphore->Header.SignalState = adjusted_signalstate;
+	KiWaitReadyObject(Semaphore, Increment);
 
 	//TODO: Implement KiWaitTest
 #if 0
@@ -1481,21 +1636,8 @@ XBSYSAPI EXPORTNUM(137) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeRemoveQueueDpc
 {
 	LOG_FUNC_ONE_ARG(Dpc);
 
-	// TODO : Instead of using a lock, emulate the Clear Interrupt Flag (cli) instruction
-	// See https://msdn.microsoft.com/is-is/library/y14401ab(v=vs.80).aspx
-	EnterCriticalSection(&(g_DpcData.Lock));
-
-	BOOLEAN Inserted = Dpc->Inserted;
-
-	if (Inserted)
-	{
-		RemoveEntryList(&(Dpc->DpcListEntry));
-		Dpc->Inserted = FALSE;
-	}
-
-	// TODO : Instead of using a lock, emulate the Set Interrupt Flag (sti) instruction
-	// See https://msdn.microsoft.com/en-us/library/ad820yz3(v=vs.80).aspx
-	LeaveCriticalSection(&(g_DpcData.Lock));
+	// The dpc stays on the pending stack, ExecuteDpcQueue skips it since it's no longer inserted
+	BOOLEAN Inserted = DpcStack::Remove(*DpcStateOf(Dpc));
 
 	RETURN(Inserted);
 }
@@ -1677,18 +1819,15 @@ XBSYSAPI EXPORTNUM(145) xboxkrnl::LONG NTAPI xboxkrnl::KeSetEvent
 			if (OldState == 0) {
 				Event->Header.SignalState = 1;
 				// TODO: KiWaitTest(Event, Increment);
-				// For now, we just sleep to give other threads time to wake
-				// See KePulseEvent
-				Sleep(1);
 			}
 		} else {
 			// TODO: KiUnwaitThread(WaitBlock->Thread, (NTSTATUS)WaitBlock->WaitKey, Increment);
-			// For now, we just sleep to give other threads time to wake
-			// See KePulseEvent
-			Sleep(1);
 		}
 	}
 
+	// Ready the threads waiting on this event so that they re-check it
+	KiWaitReadyObject(Event, Increment);
+
 	if (Wait != FALSE) {
 		PRKTHREAD Thread = KeGetCurrentThread();
 		Thread->WaitNext = Wait;
@@ -1724,6 +1863,7 @@ XBSYSAPI EXPORTNUM(146) xboxkrnl::VOID NTAPI xboxkrnl::KeSetEventBoostPriority
 
 	if (IsListEmpty(&Event->Header.WaitListHead) != FALSE) {
 		Event->Header.SignalState = 1;
+		KiWaitReadyObject(Event, 1);
 	} else {
 		PRKTHREAD WaitThread = CONTAINING_RECORD(Event->Header.WaitListHead.Flink, KWAIT_BLOCK, WaitListEntry)->Thread;
 
@@ -1733,9 +1873,7 @@ XBSYSAPI EXPORTNUM(146) xboxkrnl::VOID NTAPI xboxkrnl::KeSetEventBoostPriority
 
 		WaitThread->Quantum = WaitThread->ApcState.Process->ThreadQuantum;
 		// TODO: KiUnwaitThread(WaitThread, STATUS_SUCCESS, 1);
-		// For now, we just sleep to give other threads time to wake
-		// See KePulseEvent
-		Sleep(1);
+		KiWaitReadyObject(Event, 1);
 	}
 
 	KiUnlockDispatcherDatabase(OldIrql);
@@ -2008,10 +2146,14 @@ XBSYSAPI EXPORTNUM(158) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForMultipleObje
 	PKMUTANT ObjectMutant;
 	// Hack variable (remove this when the thread scheduler is here)
 	bool timeout_set = false;
+	// Set once the thread is registered in the host wait queues of the objects
+	bool wait_registered = false;
 	do {
 		// Check if we need to let an APC run. This should immediately trigger APC interrupt via a call to UnlockDispatcherDatabase
 		if (Thread->ApcState.KernelApcPending && (Thread->WaitIrql < APC_LEVEL)) {
 			KiUnlockDispatcherDatabase(Thread->WaitIrql);
+			// The apc interrupt isn't raised for apc's queued by other threads, so deliver them here
+			KiDeliverApc(KernelMode);
 		}
 		else {
 			WaitSatisfied = TRUE;
@@ -2073,6 +2215,7 @@ XBSYSAPI EXPORTNUM(158) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForMultipleObje
 			}	
 
 			TestForAlertPending(Alertable);
+			TestForHostApc(Alertable);
 
 			// Handle a Timeout if specified
 			if (Timeout != nullptr) {
@@ -2161,7 +2304,26 @@ XBSYSAPI EXPORTNUM(158) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForMultipleObje
 			//}
 
 			// TODO: Remove this after we have our own scheduler and the above is implemented
-			Sleep(0);
+			// Park until one of the objects or the thread timer gets signalled. The first pass only registers
+			// the thread and then re-checks the objects, so that a signal racing with the registration isn't lost
+			if (!wait_registered) {
+				KiWaitRegister(Object, Count, (Timeout != nullptr) ? &Thread->Timer : nullptr, WaitType == WaitAll);
+				wait_registered = true;
+			}
+			else {
+				KiWaitPark();
+
+				// A pulsed event is already unsignalled again, so the pulse satisfies a WaitAny by itself
+				PVOID PulsedObject = KiWaitTakePulse();
+				if ((PulsedObject != nullptr) && (WaitType == WaitAny)) {
+					for (ULONG Index = 0; Index < Count; Index += 1) {
+						if (Object[Index] == PulsedObject) {
+							WaitStatus = (NTSTATUS)(STATUS_SUCCESS + Index);
+							goto NoWait;
+						}
+					}
+				}
+			}
 
 			// Reduce the timout if necessary
 			if (Timeout != nullptr) {
@@ -2181,9 +2343,20 @@ XBSYSAPI EXPORTNUM(158) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForMultipleObje
 
 	// The waiting thead has been alerted, or an APC needs to be delivered
 	// So unlock the dispatcher database, lower the IRQ and return the status
+	// The thread timer stays inserted when the wait ends before it expires, remove it like NoWait does
+	if (timeout_set && Thread->Timer.Header.Inserted == TRUE) {
+		KiTimerLock();
+		KxRemoveTreeTimer(&Thread->Timer);
+		KiTimerUnlock();
+	}
+
+	if (wait_registered) {
+		KiWaitUnregister();
+	}
+
 	KiUnlockDispatcherDatabase(Thread->WaitIrql);
 	if (WaitStatus == STATUS_USER_APC) {
-		//TODO: KiDeliverUserApc();
+		KiDeliverApc(UserMode);
 	}
 
 	RETURN(WaitStatus);
@@ -2201,10 +2374,14 @@ NoWait:
 		KiTimerUnlock();
 	}
 
+	if (wait_registered) {
+		KiWaitUnregister();
+	}
+
 	KiUnlockDispatcherDatabase(Thread->WaitIrql);
 
 	if (WaitStatus == STATUS_USER_APC) {
-		// TODO: KiDeliverUserApc();
+		KiDeliverApc(UserMode);
 	}
 
 	RETURN(WaitStatus);
@@ -2248,10 +2425,14 @@ XBSYSAPI EXPORTNUM(159) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForSingleObject
 	NTSTATUS WaitStatus;
 	// Hack variable (remove this when the thread scheduler is here)
 	bool timeout_set = false;
+	// Set once the thread is registered in the host wait queues of the objects
+	bool wait_registered = false;
 	do {
 		// Check if we need to let an APC run. This should immediately trigger APC interrupt via a call to UnlockDispatcherDatabase
 		if (Thread->ApcState.KernelApcPending && (Thread->WaitIrql < APC_LEVEL)) {
 			KiUnlockDispatcherDatabase(Thread->WaitIrql);
+			// The apc interrupt isn't raised for apc's queued by other threads, so deliver them here
+			KiDeliverApc(KernelMode);
 		} else {
 			PKMUTANT ObjectMutant = (PKMUTANT)Object;
 			Thread->WaitStatus = STATUS_SUCCESS;
@@ -2286,6 +2467,7 @@ XBSYSAPI EXPORTNUM(159) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForSingleObject
 			WaitBlock->Thread = Thread;
 
 			TestForAlertPending(Alertable);
+			TestForHostApc(Alertable);
 
 			// Handle a Timeout if specified
 			if (Timeout != nullptr) {
@@ -2366,7 +2548,20 @@ XBSYSAPI EXPORTNUM(159) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForSingleObject
 			} */
 
 			// TODO: Remove this after we have our own scheduler and the above is implemented
-			Sleep(0);
+			// Park until the object or the thread timer gets signalled (see KeWaitForMultipleObjects)
+			if (!wait_registered) {
+				KiWaitRegister(&Object, 1, (Timeout != nullptr) ? &Thread->Timer : nullptr, false);
+				wait_registered = true;
+			}
+			else {
+				KiWaitPark();
+
+				// A pulsed event is already unsignalled again, so the pulse satisfies the wait by itself
+				if (KiWaitTakePulse() == Object) {
+					WaitStatus = STATUS_SUCCESS;
+					goto NoWait;
+				}
+			}
 
 			// Reduce the timout if necessary
 			if (Timeout != nullptr) {
@@ -2386,9 +2581,20 @@ XBSYSAPI EXPORTNUM(159) xboxkrnl::NTSTATUS NTAPI xboxkrnl::KeWaitForSingleObject
 
 	// The waiting thead has been alerted, or an APC needs to be delivered
 	// So unlock the dispatcher database, lower the IRQ and return the status
+	// The thread timer stays inserted when the wait ends before it expires, remove it like NoWait does
+	if (timeout_set && Thread->Timer.Header.Inserted == TRUE) {
+		KiTimerLock();
+		KxRemoveTreeTimer(&Thread->Timer);
+		KiTimerUnlock();
+	}
+
+	if (wait_registered) {
+		KiWaitUnregister();
+	}
+
 	KiUnlockDispatcherDatabase(Thread->WaitIrql);
 	if (WaitStatus == STATUS_USER_APC) {
-		//TODO: KiDeliverUserApc();
+		KiDeliverApc(UserMode);
 	}
 
 	RETURN(WaitStatus);
@@ -2406,10 +2612,14 @@ NoWait:
 		KiTimerUnlock();
 	}
 
+	if (wait_registered) {
+		KiWaitUnregister();
+	}
+
 	KiUnlockDispatcherDatabase(Thread->WaitIrql);
 
 	if (WaitStatus == STATUS_USER_APC) {
-		// TODO: KiDeliverUserApc();
+		KiDeliverApc(UserMode);
 	}
 
 	RETURN(WaitStatus);
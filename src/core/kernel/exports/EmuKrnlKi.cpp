@@ -87,6 +87,7 @@ namespace xboxkrnl
 #include "Logging.h" // For LOG_FUNC()
 #include "EmuKrnl.h" // for the list support functions
 #include "EmuKrnlKi.h"
+#include "core\kernel\support\DispatcherWaitTable.h"
 
 #define MAX_TIMER_DPCS   16
 
@@ -98,6 +99,15 @@ xboxkrnl::KI_TIMER_LOCK KiTimerMtx;
 xboxkrnl::KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
 xboxkrnl::LIST_ENTRY KiWaitInListHead;
 
+static DispatcherWaitTable KiWaitTable;
+
+// Unregisters when its thread exits, so the table never keeps a pointer to a destroyed waiter
+struct KiWaiter : DispatcherWaitTable::Waiter {
+	~KiWaiter() { KiWaitTable.Unregister(*this); }
+};
+
+static thread_local KiWaiter KiCurrentWaiter;
+
 
 xboxkrnl::VOID xboxkrnl::KiInitSystem()
 {
@@ -116,6 +126,183 @@ xboxkrnl::VOID xboxkrnl::KiInitSystem()
 	InitializeListHead(&IdexChannelObject.DeviceQueue.DeviceListHead);
 }
 
+void KiWaitRegister(void *Objects[], xboxkrnl::ULONG Count, void *TimerObject, bool WaitAll)
+{
+	KiWaitTable.Register(KiCurrentWaiter, GetCurrentThreadId(), Objects, Count, TimerObject, WaitAll);
+}
+
+void KiWaitPark()
+{
+	// Every path that signals a dispatcher object wakes its registered waiters, alerts and apc's wake the
+	// thread itself, and timeouts arrive through the expiry of the thread timer, so there is nothing to poll for
+	KiWaitTable.Park(KiCurrentWaiter);
+}
+
+void KiWaitUnregister()
+{
+	KiWaitTable.Unregister(KiCurrentWaiter);
+}
+
+void *KiWaitTakePulse()
+{
+	return KiWaitTable.TakePulse(KiCurrentWaiter);
+}
+
+// Models the priority boost of the readied threads: the signalling thread gives up the rest of its
+// time slice, so that the waiters get to run before it, like they would on the Xbox scheduler
+static void KiWaitBoost(unsigned Readied, xboxkrnl::KPRIORITY Increment)
+{
+	if ((Readied > 0) && (Increment > 0)) {
+		SwitchToThread();
+	}
+}
+
+void KiWaitWakeObject(void *Object)
+{
+	KiWaitTable.Wake(Object);
+}
+
+void KiWaitReadyObject(void *Object, xboxkrnl::KPRIORITY Increment)
+{
+	KiWaitBoost(KiWaitTable.Wake(Object), Increment);
+}
+
+void KiWaitPulseObject(void *Object, xboxkrnl::KPRIORITY Increment, bool WakeAll)
+{
+	KiWaitBoost(KiWaitTable.Pulse(Object, WakeAll), Increment);
+}
+
+bool KiWaitWakeThread(DWORD ThreadId)
+{
+	return KiWaitTable.WakeThread(ThreadId);
+}
+
+// Guards the apc queues of all threads, since KiLockApcQueue only raises the irql and apc's are queued from other host threads
+static std::mutex KiApcMtx;
+// Set while this thread delivers its apc's, since lowering the irql in between lands in KiDeliverApc again
+static thread_local bool KiApcDelivering = false;
+
+xboxkrnl::BOOLEAN xboxkrnl::KiInsertQueueApc
+(
+	IN PRKAPC Apc,
+	IN KPRIORITY Increment
+)
+{
+	PKTHREAD Thread = Apc->Thread;
+	KPROCESSOR_MODE ApcMode = Apc->ApcMode;
+	{
+		std::lock_guard<std::mutex> lock(KiApcMtx);
+		if (Apc->Inserted || !Thread->ApcState.ApcQueueable) {
+			return FALSE;
+		}
+
+		PLIST_ENTRY ListHead = &Thread->ApcState.ApcListHead[ApcMode];
+		if (Apc->NormalRoutine != NULL) {
+			InsertTailList(ListHead, &Apc->ApcListEntry);
+		}
+		else {
+			// Special apc's go ahead of the normal ones, behind the special ones queued before them
+			PLIST_ENTRY NextEntry = ListHead->Flink;
+			while ((NextEntry != ListHead) && (CONTAINING_RECORD(NextEntry, KAPC, ApcListEntry)->NormalRoutine == NULL)) {
+				NextEntry = NextEntry->Flink;
+			}
+			InsertTailList(NextEntry, &Apc->ApcListEntry);
+		}
+
+		Apc->Inserted = TRUE;
+		if (ApcMode == KernelMode) {
+			Thread->ApcState.KernelApcPending = TRUE;
+		}
+	}
+
+	if (Thread == KeGetCurrentThread()) {
+		// Runs once the irql drops below APC_LEVEL, user apc's wait for the next alertable wait
+		if (ApcMode == KernelMode) {
+			HalRequestSoftwareInterrupt(APC_LEVEL);
+		}
+	}
+	else {
+		// A waiting thread delivers its kernel apc's, and looks at its user apc's, once woken
+		KiWaitBoost(KiWaitWakeThread(((PETHREAD)Thread)->UniqueThread) ? 1 : 0, Increment);
+	}
+
+	return TRUE;
+}
+
+// Takes the first apc of a queue, or returns false when it's empty or its first apc can't run yet
+static bool KiRemoveApc(xboxkrnl::PKTHREAD Thread, xboxkrnl::KPROCESSOR_MODE ApcMode, xboxkrnl::KAPC &Copy, xboxkrnl::PKAPC &Apc)
+{
+	std::lock_guard<std::mutex> lock(KiApcMtx);
+
+	xboxkrnl::PLIST_ENTRY ListHead = &Thread->ApcState.ApcListHead[ApcMode];
+	if (ApcMode == xboxkrnl::KernelMode) {
+		Thread->ApcState.KernelApcPending = FALSE;
+	}
+	else {
+		Thread->ApcState.UserApcPending = FALSE;
+	}
+
+	if (IsListEmpty(ListHead)) {
+		return false;
+	}
+
+	Apc = CONTAINING_RECORD(ListHead->Flink, xboxkrnl::KAPC, ApcListEntry);
+	// Normal kernel apc's wait for the end of the critical region (KeLeaveCriticalRegion queues them again), and
+	// for the normal apc in progress
+	if ((ApcMode == xboxkrnl::KernelMode) && (Apc->NormalRoutine != NULL) &&
+		((Thread->KernelApcDisable != 0) || Thread->ApcState.KernelApcInProgress)) {
+		return false;
+	}
+
+	// Copy the apc, since the kernel routine may free or reuse it
+	Copy = *Apc;
+	RemoveEntryList(&Apc->ApcListEntry);
+	Apc->Inserted = FALSE;
+	return true;
+}
+
+xboxkrnl::VOID xboxkrnl::KiDeliverApc
+(
+	IN KPROCESSOR_MODE DeliveryMode
+)
+{
+	if (KiApcDelivering) {
+		return;
+	}
+
+	KiApcDelivering = true;
+	PKTHREAD Thread = KeGetCurrentThread();
+	KAPC Copy;
+	PKAPC Apc;
+
+	while (KiRemoveApc(Thread, KernelMode, Copy, Apc)) {
+		KIRQL OldIrql = KfRaiseIrql(APC_LEVEL);
+		Copy.KernelRoutine(Apc, &Copy.NormalRoutine, &Copy.NormalContext, &Copy.SystemArgument1, &Copy.SystemArgument2);
+		KfLowerIrql(OldIrql);
+
+		if (Copy.NormalRoutine != NULL) {
+			Thread->ApcState.KernelApcInProgress = TRUE;
+			Copy.NormalRoutine(Copy.NormalContext, Copy.SystemArgument1, Copy.SystemArgument2);
+			Thread->ApcState.KernelApcInProgress = FALSE;
+		}
+	}
+
+	// User apc's only run when an alertable user mode wait returns STATUS_USER_APC
+	if (DeliveryMode == UserMode) {
+		while (KiRemoveApc(Thread, UserMode, Copy, Apc)) {
+			KIRQL OldIrql = KfRaiseIrql(APC_LEVEL);
+			Copy.KernelRoutine(Apc, &Copy.NormalRoutine, &Copy.NormalContext, &Copy.SystemArgument1, &Copy.SystemArgument2);
+			KfLowerIrql(OldIrql);
+
+			if (Copy.NormalRoutine != NULL) {
+				Copy.NormalRoutine(Copy.NormalContext, Copy.SystemArgument1, Copy.SystemArgument2);
+			}
+		}
+	}
+
+	KiApcDelivering = false;
+}
+
 xboxkrnl::VOID xboxkrnl::KiTimerLock()
 {
 	KiTimerMtx.Mtx.lock();
@@ -444,6 +631,7 @@ xboxkrnl::BOOLEAN xboxkrnl::KiComputeDueTime
 			/* Cancel everything */
 			EmuLog(LOG_LEVEL::DEBUG, "Timer %p already expired", Timer);
 			Timer->Header.SignalState = TRUE;
+			KiWaitWakeObject(Timer);
 			Timer->DueTime.QuadPart = 0;
 			*Hand = 0;
 			return FALSE;
@@ -481,6 +669,7 @@ xboxkrnl::BOOLEAN FASTCALL xboxkrnl::KiSignalTimer
 	/* Set default values */
 	Timer->Header.Inserted = FALSE;
 	Timer->Header.SignalState = TRUE;
+	KiWaitWakeObject(Timer);
 
 	/* Check if the timer has waiters */
 	if (!IsListEmpty(&Timer->Header.WaitListHead))
@@ -592,6 +781,7 @@ xboxkrnl::VOID NTAPI xboxkrnl::KiTimerExpiration
 				/* Make it non-inserted and signal it */
 				Timer->Header.Inserted = FALSE;
 				Timer->Header.SignalState = 1;
+				KiWaitWakeObject(Timer);
 
 				/* Get the DPC and period */
 				TimerDpc = Timer->Dpc;
@@ -799,6 +989,7 @@ xboxkrnl::VOID FASTCALL xboxkrnl::KiTimerListExpire
 
 		/* Signal it */
 		Timer->Header.SignalState = 1;
+		KiWaitWakeObject(Timer);
 
 		/* Get the DPC and period */
 		TimerDpc = Timer->Dpc;
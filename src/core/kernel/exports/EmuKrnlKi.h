@@ -135,6 +135,19 @@ namespace xboxkrnl
 		IN KIRQL OldIrql
 	);
 
+	// Queues an apc of which the system arguments are set, and wakes its thread. False when the apc was already queued
+	BOOLEAN KiInsertQueueApc
+	(
+		IN PRKAPC Apc,
+		IN KPRIORITY Increment
+	);
+
+	// Runs the kernel apc's of the current thread, and its user apc's too when DeliveryMode is UserMode
+	VOID KiDeliverApc
+	(
+		IN KPROCESSOR_MODE DeliveryMode
+	);
+
 	VOID FASTCALL KiWaitSatisfyAll
 	(
 		IN PKWAIT_BLOCK WaitBlock
@@ -146,6 +159,24 @@ extern xboxkrnl::LIST_ENTRY KiWaitInListHead;
 extern xboxkrnl::KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
 extern xboxkrnl::KI_TIMER_LOCK KiTimerMtx;
 
+// Host side wait queues. A guest thread that can't satisfy its wait parks on a host condition variable
+// instead of spinning, and whoever changes the signal state of a dispatcher object wakes the threads
+// registered on it, which then re-evaluate their wait. The guest wait lists are left alone, because
+// KiLockDispatcherDatabase only raises the irql and doesn't stop other host threads from touching them.
+// WaitAll tells whether the wait needs all of its objects, in which case a pulse can't satisfy it
+void KiWaitRegister(void *Objects[], xboxkrnl::ULONG Count, void *TimerObject, bool WaitAll);
+void KiWaitPark();
+void KiWaitUnregister();
+void KiWaitWakeObject(void *Object);
+// Like KiWaitWakeObject, and lets the readied threads run ahead of the caller when Increment is positive
+void KiWaitReadyObject(void *Object, xboxkrnl::KPRIORITY Increment);
+// Readies the threads waiting on an object whose signal state is reset right after (KePulseEvent). The
+// readied threads see the pulse through KiWaitTakePulse, since the object itself is already unsignalled
+void KiWaitPulseObject(void *Object, xboxkrnl::KPRIORITY Increment, bool WakeAll);
+void *KiWaitTakePulse();
+// Wakes a waiting thread to look at its alerts and apc's. False when the thread isn't waiting
+bool KiWaitWakeThread(DWORD ThreadId);
+
 #define KiLockDispatcherDatabase(OldIrql)      \
 	*(OldIrql) = KeRaiseIrqlToDpcLevel()
 
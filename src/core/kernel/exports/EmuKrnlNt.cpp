@@ -45,8 +45,10 @@ namespace NtDll
 
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "core\kernel\exports\EmuKrnlKe.h"
+#include "core\kernel\exports\EmuKrnlKi.h" // For KiWaitWakeThread
 #include "core\kernel\support\Emu.h" // For EmuLog(LOG_LEVEL::WARNING, )
 #include "core\kernel\support\EmuFile.h" // For EmuNtSymbolicLinkObject, NtStatusToString(), etc.
+#include "core\kernel\support\EmuXiso.h" // For EmuNtXisoFileObject, CxbxXisoReadFile(), etc.
 #include "core\kernel\memory-manager\VMManager.h" // For g_VMManager
 #include "CxbxDebugger.h"
 
@@ -146,6 +148,9 @@ XBSYSAPI EXPORTNUM(187) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtClose
 
 	NTSTATUS ret = STATUS_SUCCESS;
 
+	// The handle value can be reused as soon as it's closed, so forget the paths cached relative to it
+	CxbxInvalidatePathCacheForHandle(Handle);
+
 	if (IsEmuHandle(Handle))
 	{
 		// delete 'special' handles
@@ -622,6 +627,17 @@ XBSYSAPI EXPORTNUM(196) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtDeviceIoControlFile
 
 	NTSTATUS ret = STATUS_SUCCESS;
 
+	// The media authentication below applies to an image just as well, everything else describes the image itself
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr && IoControlCode != 0x4D014) {
+		ret = CxbxXisoDeviceIoControlFile(xisoFile, IoStatusBlock, IoControlCode, OutputBuffer, OutputBufferLength);
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, nullptr);
+		}
+
+		RETURN(ret);
+	}
+
 	switch (IoControlCode)
 	{
 	case 0x4D014: // IOCTL_SCSI_PASS_THROUGH_DIRECT
@@ -804,6 +820,16 @@ XBSYSAPI EXPORTNUM(200) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtFsControlFile
 		LOG_FUNC_ARG(OutputBufferLength)
 		LOG_FUNC_END;
 
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr) {
+		NTSTATUS ret = CxbxXisoFsControlFile(xisoFile, IoStatusBlock, FsControlCode);
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, nullptr);
+		}
+
+		RETURN(ret);
+	}
+
 	NTSTATUS ret = STATUS_INVALID_PARAMETER;
 
 	switch (FsControlCode) {
@@ -1023,6 +1049,11 @@ XBSYSAPI EXPORTNUM(206) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueueApcThread
 		CloseHandle( g_DuplicateHandles[ThreadHandle] );
 		g_DuplicateHandles.erase( ThreadHandle );
 	}
+	else
+	{
+		// A parked alertable wait of the thread runs the apc once woken
+		KiWaitWakeThread(GetThreadId(ThreadHandle));
+	}
 
 	RETURN(ret);
 }
@@ -1062,6 +1093,16 @@ XBSYSAPI EXPORTNUM(207) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryDirectoryFile
 	if (FileInformationClass != FileDirectoryInformation)   // Due to unicode->string conversion
 		CxbxKrnlCleanup("Unsupported FileInformationClass");
 
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr) {
+		ret = CxbxXisoQueryDirectoryFile(xisoFile, IoStatusBlock, FileInformation, Length, FileMask, RestartScan);
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, nullptr);
+		}
+
+		RETURN(ret);
+	}
+
 	NtDll::UNICODE_STRING NtFileMask;
 
 	wchar_t wszObjectName[MAX_PATH];
@@ -1204,10 +1245,22 @@ XBSYSAPI EXPORTNUM(210) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryFullAttributes
 		/*var*/nativeObjectAttributes,
 		"NtQueryFullAttributesFile");
 
-	if (ret == STATUS_SUCCESS)
+	if (ret == STATUS_SUCCESS && CxbxXisoQueryFullAttributes(nativeObjectAttributes, Attributes, &ret))
+		RETURN(ret);
+
+	// Titles commonly probe for optional files; answer repeated misses from the cache
+	if (ret == STATUS_SUCCESS) {
+		ret = CxbxLookupMissingPath(nativeObjectAttributes);
+		if (ret != STATUS_SUCCESS)
+			RETURN(ret);
+	}
+
+	if (ret == STATUS_SUCCESS) {
 		ret = NtDll::NtQueryFullAttributesFile(
 			nativeObjectAttributes.NtObjAttrPtr,
 			&nativeNetOpenInfo);
+		CxbxRememberMissingPath(nativeObjectAttributes, ret);
+	}
 
 	// Convert Attributes to Xbox
 	NTToXboxFileInformation(&nativeNetOpenInfo, Attributes, FileNetworkOpenInformation, sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION));
@@ -1241,6 +1294,12 @@ XBSYSAPI EXPORTNUM(211) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryInformationFil
 	NTSTATUS ret;
 	PVOID ntFileInfo;
 
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr) {
+		ret = CxbxXisoQueryInformationFile(xisoFile, IoStatusBlock, FileInformation, Length, FileInformationClass);
+		RETURN(ret);
+	}
+
 	// Start with sizeof(corresponding struct)
 	size_t bufferSize = XboxFileInfoStructSizes[FileInformationClass];
 
@@ -1520,6 +1579,12 @@ XBSYSAPI EXPORTNUM(218) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryVolumeInformat
 		LOG_FUNC_ARG(FileInformationClass)
 		LOG_FUNC_END;
 
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr) {
+		NTSTATUS ret = CxbxXisoQueryVolumeInformationFile(xisoFile, IoStatusBlock, FileInformation, Length, FileInformationClass);
+		RETURN(ret);
+	}
+
 	// FileFsSizeInformation is a special case that should read from our emulated partition table
 	if ((DWORD)FileInformationClass == FileFsSizeInformation) {
 		PFILE_FS_SIZE_INFORMATION XboxSizeInfo = (PFILE_FS_SIZE_INFORMATION)FileInformation;
@@ -1652,6 +1717,27 @@ XBSYSAPI EXPORTNUM(219) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtReadFile
 		CxbxDebugger::ReportFileRead(FileHandle, Length, Offset);
 	}
 
+	// Reads from a mounted XISO image complete synchronously, straight into the caller's buffer
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr) {
+		NTSTATUS ret = CxbxXisoReadFile(xisoFile, IoStatusBlock, Buffer, Length, ByteOffset);
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, nullptr);
+		}
+
+		// Like a completed host read, queue the completion routine to this thread, to run on its next alertable wait
+		if (ApcRoutine != nullptr && !FAILED(ret)) {
+			NtDll::NtQueueApcThread(
+				(NtDll::HANDLE)GetCurrentThread(),
+				(NtDll::PIO_APC_ROUTINE)ApcRoutine,
+				ApcContext,
+				(NtDll::PIO_STATUS_BLOCK)IoStatusBlock,
+				0);
+		}
+
+		RETURN(ret);
+	}
+
 	NTSTATUS ret = NtDll::NtReadFile(
 		FileHandle,
 		Event,
@@ -1844,6 +1930,12 @@ XBSYSAPI EXPORTNUM(226) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtSetInformationFile
 		LOG_FUNC_ARG(Length)
 		LOG_FUNC_ARG(FileInformationClass)
 		LOG_FUNC_END;
+
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileObject(FileHandle);
+	if (xisoFile != nullptr) {
+		NTSTATUS ret = CxbxXisoSetInformationFile(xisoFile, IoStatusBlock, FileInformation, Length, FileInformationClass);
+		RETURN(ret);
+	}
 	
 	XboxToNTFileInformation(convertedFileInfo, FileInformation, FileInformationClass, &Length);
 
@@ -1854,6 +1946,10 @@ XBSYSAPI EXPORTNUM(226) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtSetInformationFile
 		Length,
 		FileInformationClass);
 
+	// A rename or link makes a new path appear
+	if (SUCCEEDED(ret) && (FileInformationClass == FileRenameInformation || FileInformationClass == FileLinkInformation))
+		CxbxInvalidatePathCache(/*MissingPathsOnly=*/true);
+
 	RETURN(ret);
 }
 
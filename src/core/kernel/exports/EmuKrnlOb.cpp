@@ -39,6 +39,7 @@ namespace xboxkrnl
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "EmuKrnl.h" // For OBJECT_TO_OBJECT_HEADER()
 #include "core\kernel\support\EmuFile.h" // For EmuNtSymbolicLinkObject, NtStatusToString(), etc.
+#include "core\kernel\support\ObjectNameIndex.h"
 #include <cassert>
 
 #pragma warning(disable:4005) // Ignore redefined status values
@@ -70,6 +71,19 @@ XBSYSAPI EXPORTNUM(245) xboxkrnl::OBJECT_HANDLE_TABLE xboxkrnl::ObpObjectHandleT
 
 xboxkrnl::PVOID ObpDosDevicesDriveLetterMap['Z' - 'A' + 1];
 
+static bool ObpNameEquals(const void *Name, const void *Key)
+{
+	return xboxkrnl::RtlEqualString(&((xboxkrnl::POBJECT_HEADER_NAME_INFO)Name)->Name, (xboxkrnl::POBJECT_STRING)Key, TRUE) != FALSE;
+}
+
+// The hash buckets of OBJECT_DIRECTORY are part of the Xbox layout, so they are still kept up to date, but their number is
+// fixed and small. Lookups go through this index of the names of all the directories instead, which also caches the objects
+// that ObpReferenceObjectByName found for absolute paths resolved by the directories alone
+static ObjectNameIndex ObpNameIndex(ObpNameEquals);
+
+static xboxkrnl::PVOID ObpPathCacheLookup(xboxkrnl::POBJECT_STRING ObjectName, xboxkrnl::BOOLEAN ResolveSymbolicLink);
+static void ObpPathCacheInsert(xboxkrnl::POBJECT_STRING ObjectName, xboxkrnl::BOOLEAN ResolveSymbolicLink, xboxkrnl::PVOID Object);
+
 xboxkrnl::BOOLEAN xboxkrnl::ObpCreatePermanentDirectoryObject(
 	IN xboxkrnl::POBJECT_STRING DirectoryName OPTIONAL,
 	OUT xboxkrnl::POBJECT_DIRECTORY *DirectoryObject
@@ -123,6 +137,7 @@ xboxkrnl::NTSTATUS xboxkrnl::ObpReferenceObjectByName(
 	}
 
 	BOOLEAN ResolveSymbolicLink = TRUE;
+	BOOLEAN PathCached = FALSE;
 	PVOID FoundObject;
 
 	if (RootDirectoryHandle != NULL) {
@@ -154,6 +169,18 @@ xboxkrnl::NTSTATUS xboxkrnl::ObpReferenceObjectByName(
 		goto CleanupAndExit;
 	}
 
+	// Fast path : the whole path was already resolved to an object by the directories
+	FoundObject = ObpPathCacheLookup(ObjectName, (ObjectType != &ObSymbolicLinkObjectType));
+	if (FoundObject != NULL) {
+		PathCached = TRUE;
+		RemainingName.Buffer += RemainingName.Length;
+		RemainingName.Length = 0;
+		RemainingName.MaximumLength = 0;
+		goto OpenRootDirectory;
+	}
+
+	FoundObject = ObpRootDirectoryObject;
+
 	if (RemainingName.Length == sizeof(CHAR)) {
 		RemainingName.Buffer++;
 		RemainingName.Length = 0;
@@ -196,6 +223,10 @@ OpenRootDirectory:
 				goto CleanupAndExit;
 			}
 
+			if (RootDirectoryHandle == NULL && !PathCached) {
+				ObpPathCacheInsert(ObjectName, ResolveSymbolicLink, FoundObject);
+			}
+
 			ObjectHeader->PointerCount++;
 			*ReturnedObject = FoundObject;
 			status = STATUS_SUCCESS;
@@ -498,17 +529,14 @@ xboxkrnl::PVOID xboxkrnl::ObpGetObjectHandleContents(HANDLE Handle)
 	return NULL;
 }
 
-xboxkrnl::ULONG FASTCALL xboxkrnl::ObpComputeHashIndex(
-	IN POBJECT_STRING ElementName
-)
+static uint32_t ObpComputeHashValue(xboxkrnl::POBJECT_STRING ElementName)
 {
+	uint32_t HashValue = 0;
+	xboxkrnl::PUCHAR Buffer = (xboxkrnl::PUCHAR)ElementName->Buffer;
+	xboxkrnl::PUCHAR BufferEnd = Buffer + ElementName->Length;
 
-	ULONG HashIndex = 0;
-	PUCHAR Buffer = (PUCHAR)ElementName->Buffer;
-	PUCHAR BufferEnd = Buffer + ElementName->Length;
-	
 	// Calculate hash of string data
-	UCHAR Char;
+	xboxkrnl::UCHAR Char;
 	while (Buffer < BufferEnd) {
 		Char = *Buffer++;
 		// Skip special characters
@@ -519,10 +547,28 @@ xboxkrnl::ULONG FASTCALL xboxkrnl::ObpComputeHashIndex(
 		// Force all characters to be lowercase
 		Char |= 0x20;
 
-		HashIndex += (HashIndex << 1) + (HashIndex >> 1) + Char;
+		HashValue += (HashValue << 1) + (HashValue >> 1) + Char;
 	}
 
-	return HashIndex % OB_NUMBER_HASH_BUCKETS;
+	return HashValue;
+}
+
+xboxkrnl::ULONG FASTCALL xboxkrnl::ObpComputeHashIndex(
+	IN POBJECT_STRING ElementName
+)
+{
+	return ObpComputeHashValue(ElementName) % OB_NUMBER_HASH_BUCKETS;
+}
+
+// Finds the object cached for an absolute path, or returns nullptr
+static xboxkrnl::PVOID ObpPathCacheLookup(xboxkrnl::POBJECT_STRING ObjectName, xboxkrnl::BOOLEAN ResolveSymbolicLink)
+{
+	return ObpNameIndex.FindPath(ObjectName->Buffer, ObjectName->Length, ObpComputeHashValue(ObjectName), ResolveSymbolicLink != FALSE);
+}
+
+static void ObpPathCacheInsert(xboxkrnl::POBJECT_STRING ObjectName, xboxkrnl::BOOLEAN ResolveSymbolicLink, xboxkrnl::PVOID Object)
+{
+	ObpNameIndex.CachePath(ObjectName->Buffer, ObjectName->Length, ObpComputeHashValue(ObjectName), ResolveSymbolicLink != FALSE, Object);
 }
 
 xboxkrnl::PVOID xboxkrnl::ObpGetObjectHandleReference(HANDLE Handle)
@@ -570,27 +616,58 @@ xboxkrnl::BOOLEAN xboxkrnl::ObpLookupElementNameInDirectory(
 		}
 	}
 	
-	ULONG HashIndex = ObpComputeHashIndex(ElementName);
-	POBJECT_HEADER_NAME_INFO ObjectHeaderNameInfo = Directory->HashBuckets[HashIndex];
-	
-	while (ObjectHeaderNameInfo != NULL) {
-		if (RtlEqualString(&ObjectHeaderNameInfo->Name, ElementName, TRUE)) {
-			Object = OBJECT_HEADER_NAME_INFO_TO_OBJECT(ObjectHeaderNameInfo);
-			if (ResolveSymbolicLink && (OBJECT_TO_OBJECT_HEADER(Object)->Type == &ObSymbolicLinkObjectType)) {
-				Object = ((POBJECT_SYMBOLIC_LINK)Object)->LinkTargetObject;
-			}
+	POBJECT_HEADER_NAME_INFO ObjectHeaderNameInfo = (POBJECT_HEADER_NAME_INFO)ObpNameIndex.Find(Directory, ObpComputeHashValue(ElementName), ElementName);
 
-			*ReturnedObject = Object;
-			return TRUE;
+	if (ObjectHeaderNameInfo != NULL) {
+		Object = OBJECT_HEADER_NAME_INFO_TO_OBJECT(ObjectHeaderNameInfo);
+		if (ResolveSymbolicLink && (OBJECT_TO_OBJECT_HEADER(Object)->Type == &ObSymbolicLinkObjectType)) {
+			Object = ((POBJECT_SYMBOLIC_LINK)Object)->LinkTargetObject;
 		}
 
-		ObjectHeaderNameInfo = ObjectHeaderNameInfo->ChainLink;
+		*ReturnedObject = Object;
+		return TRUE;
 	}
 
 	*ReturnedObject = NULL;
 	return FALSE;
 }
 
+// Takes a named object out of its directory, the irql must be raised. Returns the directory : the caller releases
+// the references of the attachment to it and to the object once the irql is lowered
+xboxkrnl::POBJECT_DIRECTORY xboxkrnl::ObpDetachNamedObject(
+	IN PVOID Object
+)
+{
+	POBJECT_HEADER ObjectHeader = OBJECT_TO_OBJECT_HEADER(Object);
+	POBJECT_HEADER_NAME_INFO ObjectHeaderNameInfo = OBJECT_TO_OBJECT_HEADER_NAME_INFO(Object);
+	POBJECT_DIRECTORY Directory = ObjectHeaderNameInfo->Directory;
+	ULONG HashValue = ObpComputeHashValue(&ObjectHeaderNameInfo->Name);
+
+	POBJECT_HEADER_NAME_INFO *Link = &Directory->HashBuckets[HashValue % OB_NUMBER_HASH_BUCKETS];
+	while (*Link != ObjectHeaderNameInfo) {
+		Link = &(*Link)->ChainLink;
+	}
+	*Link = ObjectHeaderNameInfo->ChainLink;
+
+	// This also flushes the cached paths, some of them may go through the name
+	ObpNameIndex.Remove(Directory, HashValue, ObjectHeaderNameInfo);
+
+	if ((Directory == ObpDosDevicesDirectoryObject) && (ObjectHeaderNameInfo->Name.Length == sizeof(CHAR) * 2) && (ObjectHeaderNameInfo->Name.Buffer[1] == (CHAR)':')) {
+		CHAR DriveLetter = ObjectHeaderNameInfo->Name.Buffer[0];
+		if (DriveLetter >= 'a' && DriveLetter <= 'z') {
+			ObpDosDevicesDriveLetterMap[DriveLetter - 'a'] = NULL;
+		} else if (DriveLetter >= 'A' && DriveLetter <= 'Z') {
+			ObpDosDevicesDriveLetterMap[DriveLetter - 'A'] = NULL;
+		}
+	}
+
+	ObjectHeaderNameInfo->ChainLink = NULL;
+	ObjectHeaderNameInfo->Directory = NULL;
+	ObjectHeader->Flags &= ~OB_FLAG_ATTACHED_OBJECT;
+
+	return Directory;
+}
+
 // ******************************************************************
 // * 0x00F1 - ObInsertObject()
 // ******************************************************************
@@ -705,12 +782,16 @@ XBSYSAPI EXPORTNUM(241) xboxkrnl::NTSTATUS NTAPI xboxkrnl::ObInsertObject
 
 	if (Directory != NULL) {
 		POBJECT_HEADER_NAME_INFO ObjectHeaderNameInfo = OBJECT_TO_OBJECT_HEADER_NAME_INFO(Object);
-		ULONG HashIndex = ObpComputeHashIndex(&ObjectHeaderNameInfo->Name);
+		ULONG HashValue = ObpComputeHashValue(&ObjectHeaderNameInfo->Name);
+		ULONG HashIndex = HashValue % OB_NUMBER_HASH_BUCKETS;
 		ObjectHeader->Flags |= OB_FLAG_ATTACHED_OBJECT;
 		ObjectHeaderNameInfo->Directory = Directory;
 		ObjectHeaderNameInfo->ChainLink = Directory->HashBuckets[HashIndex];
 		Directory->HashBuckets[HashIndex] = ObjectHeaderNameInfo;
 
+		// This also flushes the cached paths, since the new name can change what they resolve to (through the drive letters of \??)
+		ObpNameIndex.Insert(Directory, HashValue, ObjectHeaderNameInfo);
+
 		if ((Directory == ObpDosDevicesDirectoryObject) && (ObjectHeaderNameInfo->Name.Length == sizeof(CHAR) * 2) && (ObjectHeaderNameInfo->Name.Buffer[1] == (CHAR)':')) {
 			PVOID DosDevicesObject = Object;
 
@@ -756,8 +837,23 @@ XBSYSAPI EXPORTNUM(242) xboxkrnl::VOID NTAPI xboxkrnl::ObMakeTemporaryObject
 {
 	LOG_FUNC_ONE_ARG(Object);
 
-	LOG_UNIMPLEMENTED();
-	assert(false);
+	KIRQL OldIrql = KeRaiseIrqlToDpcLevel();
+	POBJECT_HEADER ObjectHeader = OBJECT_TO_OBJECT_HEADER(Object);
+	ObjectHeader->Flags &= ~OB_FLAG_PERMANENT_OBJECT;
+
+	// A temporary object loses its name with its last handle. Handles aren't closed through the object manager yet,
+	// so that only happens here, for an object without any
+	POBJECT_DIRECTORY Directory = NULL;
+	if ((ObjectHeader->HandleCount == 0) && ObpIsFlagSet(ObjectHeader->Flags, OB_FLAG_ATTACHED_OBJECT)) {
+		Directory = ObpDetachNamedObject(Object);
+	}
+
+	KfLowerIrql(OldIrql);
+
+	if (Directory != NULL) {
+		ObfDereferenceObject(Directory);
+		ObfDereferenceObject(Object);
+	}
 }
 
 // ******************************************************************
@@ -43,6 +43,7 @@ namespace xboxkrnl
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnl_TLS
 #include "core\kernel\support\Emu.h" // For EmuLog(LOG_LEVEL::WARNING, )
 #include "core\kernel\support\EmuFS.h" // For EmuGenerateFS
+#include "EmuKrnlKi.h" // For KiWaitWakeObject
 
 // prevent name collisions
 namespace NtDll
@@ -440,6 +441,17 @@ XBSYSAPI EXPORTNUM(258) xboxkrnl::VOID NTAPI xboxkrnl::PsTerminateSystemThread
 		}
 	}*/
 
+	// A terminated thread is a signalled dispatcher object, wake whoever waits on it
+	PKTHREAD Thread = KeGetCurrentThread();
+	KIRQL OldIrql;
+	KiLockDispatcherDatabase(&OldIrql);
+	Thread->Header.SignalState = 1;
+	KiUnlockDispatcherDatabase(OldIrql);
+	KiWaitWakeObject(Thread);
+
+	// _endthreadex doesn't return, so drop this thread's waiter record before the table outlives it
+	KiWaitUnregister();
+
 	_endthreadex(ExitStatus);
 	// ExitThread(ExitStatus);
 	// CxbxKrnlTerminateThread();
@@ -42,6 +42,7 @@ namespace xboxkrnl
 #include "devices\x86\EmuX86.h"
 #include "core\kernel\support\EmuFile.h"
 #include "core\kernel\support\EmuFS.h" // EmuInitFS
+#include "core\kernel\support\EmuXiso.h" // For XisoImage
 #include "EmuEEPROM.h" // For CxbxRestoreEEPROM, EEPROM, XboxFactoryGameRegion
 #include "core\kernel\exports\EmuKrnl.h"
 #include "core\kernel\exports\EmuKrnlKi.h"
@@ -58,6 +59,8 @@ namespace xboxkrnl
 #include "common/xbox/Types.hpp"
 
 #include <clocale>
+#include <chrono>
+#include <future>
 #include <process.h>
 #include <time.h> // For time()
 #include <sstream> // For std::ostringstream
@@ -68,6 +71,7 @@ namespace xboxkrnl
 #include "devices\SMCDevice.h" // For SMC Access
 #include "common\crypto\EmuSha.h" // For the SHA1 functions
 #include "Timer.h" // For Timer_Init
+#include "Tracing.h" // For Trace_Init
 #include "common\input\InputManager.h" // For the InputDeviceManager
 
 /*! thread local storage */
@@ -118,6 +122,51 @@ ULONG g_CxbxFatalErrorCode = FATAL_ERROR_NONE;
 // Define function located in EmuXApi so we can call it from here
 void SetupXboxDeviceTypes();
 
+// Time at which CxbxKrnlEmulate started, boot stages are reported relative to it
+static std::chrono::steady_clock::time_point CxbxBootStartTime = std::chrono::steady_clock::now();
+
+// Logs how long a boot stage took once it goes out of scope
+class CxbxBootStage
+{
+public:
+	CxbxBootStage(const char *Name) : m_Name(Name), m_Start(std::chrono::steady_clock::now()) {}
+	~CxbxBootStage()
+	{
+		auto End = std::chrono::steady_clock::now();
+		if (g_TraceEnabled) {
+			Trace_AddEvent(m_Name, "boot", m_Start, End);
+		}
+		EmuLogInit(LOG_LEVEL::INFO, "Boot stage %s took %.3f ms (%.3f ms since launch)", m_Name,
+			std::chrono::duration<double, std::milli>(End - m_Start).count(),
+			std::chrono::duration<double, std::milli>(End - CxbxBootStartTime).count());
+	}
+
+private:
+	const char *m_Name;
+	std::chrono::steady_clock::time_point m_Start;
+};
+
+// Runs Func(sectionIndex) for every executable section of the xbe concurrently, and returns
+// the results in section order. Sections never overlap, so workers can't interfere with each other
+template<typename T, typename F>
+std::vector<T> ForEachExecutableSection(F Func)
+{
+	std::vector<std::future<T>> Workers;
+	for (uint32_t sectionIndex = 0; sectionIndex < CxbxKrnl_Xbe->m_Header.dwSections; sectionIndex++) {
+		if (!CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwFlags.bExecutable) {
+			continue;
+		}
+		Workers.emplace_back(std::async(std::launch::async, Func, sectionIndex));
+	}
+
+	std::vector<T> Results;
+	for (auto &w : Workers) {
+		Results.emplace_back(w.get());
+	}
+
+	return Results;
+}
+
 void ApplyMediaPatches()
 {
 	// Patch the XBE Header to allow running from all media types
@@ -375,15 +424,30 @@ void InitSoftwareInterrupts()
 }
 #endif
 
-void TriggerPendingConnectedInterrupts()
+// Returns whether some interrupts are still pending after this pass
+bool TriggerPendingConnectedInterrupts()
 {
+	uint32_t Pending = HalTakePendingInterrupts();
+	uint32_t StillPending = 0;
+
 	for (int i = 0; i < MAX_BUS_INTERRUPT_LEVEL; i++) {
+		if ((Pending & (1 << i)) == 0) {
+			continue;
+		}
+
 		// If the interrupt is pending and connected, process it
 		if (HalSystemInterrupts[i].IsPending() && EmuInterruptList[i] && EmuInterruptList[i]->Connected) {
 			HalSystemInterrupts[i].Trigger(EmuInterruptList[i]);
 		}
-		SwitchToThread();
+
+		// Latched interrupts stay pending until deasserted, and the unconnected ones until they are connected
+		if (HalSystemInterrupts[i].IsPending()) {
+			StillPending |= (1 << i);
+		}
 	}
+
+	HalKeepPendingInterrupts(StillPending);
+	return StillPending != 0;
 }
 
 static unsigned int WINAPI CxbxKrnlInterruptThread(PVOID param)
@@ -397,11 +461,17 @@ static unsigned int WINAPI CxbxKrnlInterruptThread(PVOID param)
 	InitSoftwareInterrupts();
 #endif
 
+	// Block until a device raises an interrupt. Latched and unconnected interrupts that are still pending,
+	// and those raised while interrupts are disabled, are retried every ms like the old polling did
+	DWORD Timeout = INFINITE;
 	while (true) {
+		WaitForSingleObject(HalInterruptEvent, Timeout);
+
 		if (g_bEnableAllInterrupts) {
-			TriggerPendingConnectedInterrupts();
+			Timeout = TriggerPendingConnectedInterrupts() ? 1 : INFINITE;
+		} else {
+			Timeout = 1;
 		}
-		Sleep(1);
 	}
 
 	return 0;
@@ -410,29 +480,27 @@ static unsigned int WINAPI CxbxKrnlInterruptThread(PVOID param)
 static void CxbxKrnlClockThread(void* pVoid)
 {
 	LARGE_INTEGER CurrentTicks;
-	uint64_t Delta;
+	uint64_t CurrentMicroseconds;
 	uint64_t Microseconds;
 	unsigned int IncrementScaling;
-	static uint64_t LastTicks = 0;
-	static uint64_t Error = 0;
+	static ClockScale HostClockToUs;
+	static uint64_t LastMicroseconds = 0;
 	static uint64_t UnaccountedMicroseconds = 0;
 
 	// This keeps track of how many us have elapsed between two cycles, so that the xbox clocks are updated
-	// with the proper increment (instead of blindly adding a single increment at every step)
-
-	if (LastTicks == 0) {
-		QueryPerformanceCounter(&CurrentTicks);
-		LastTicks = CurrentTicks.QuadPart;
-		CurrentTicks.QuadPart = 0;
-	}
+	// with the proper increment (instead of blindly adding a single increment at every step). The host ticks
+	// are converted to us from the start of the clock, so that the rounding errors don't accumulate
 
 	QueryPerformanceCounter(&CurrentTicks);
-	Delta = CurrentTicks.QuadPart - LastTicks;
-	LastTicks = CurrentTicks.QuadPart;
 
-	Error += (Delta * SCALE_S_IN_US);
-	Microseconds = Error / HostClockFrequency;
-	Error -= (Microseconds * HostClockFrequency);
+	if (HostClockToUs.Multiplier == 0) {
+		ClockScale_Init(&HostClockToUs, HostClockFrequency, SCALE_S_IN_US);
+		HostClockToUs.BaseTicks = CurrentTicks.QuadPart;
+	}
+
+	CurrentMicroseconds = ClockScale_Convert(&HostClockToUs, CurrentTicks.QuadPart);
+	Microseconds = CurrentMicroseconds - LastMicroseconds;
+	LastMicroseconds = CurrentMicroseconds;
 
 	UnaccountedMicroseconds += Microseconds;
 	IncrementScaling = (unsigned int)(UnaccountedMicroseconds / 1000); // -> 1 ms = 1000us -> time between two xbox clock interrupts
@@ -502,74 +570,112 @@ const uint8_t rdtsc_pattern[] = {
 };
 const int sizeof_rdtsc_pattern = sizeof(rdtsc_pattern);
 
-void PatchRdtscInstructions()
-{
-	uint8_t rdtsc[2] = { 0x0F, 0x31 };
-	DWORD sizeOfImage = CxbxKrnl_XbeHeader->dwSizeofImage;
+// What the rdtsc scan found at a given address, replayed in order after the (parallel) scan
+enum class RdtscScanAction { Patch, FalsePositive, Unknown };
 
-	// Iterate through each CODE section
-	for (uint32_t sectionIndex = 0; sectionIndex < CxbxKrnl_Xbe->m_Header.dwSections; sectionIndex++) {
-		if (!CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwFlags.bExecutable) {
-			continue;
-		}
+struct RdtscScanEntry {
+	xbaddr addr;
+	uint8_t next_byte;
+	RdtscScanAction action;
+};
 
-		// Skip some segments known to never contain rdtsc (to avoid false positives)
-		if (std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "DSOUND"
-			|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "XGRPH"
-			|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == ".data"
-			|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == ".rdata"
-			|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "XMV"
-			|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "XONLINE"
-			|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "MDLPL") {
-			continue;
-		}
+struct RdtscScanResult {
+	uint32_t sectionIndex;
+	bool skipped;
+	std::vector<RdtscScanEntry> entries;
+};
 
-		EmuLogInit(LOG_LEVEL::INFO, "Searching for rdtsc in section %s", CxbxKrnl_Xbe->m_szSectionName[sectionIndex]);
-		xbaddr startAddr = CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwVirtualAddr;
-		//rdtsc is two bytes instruction, it needs at least one opcode byte after it to finish a function, so the endAddr need to substract 3 bytes.
-		xbaddr endAddr = startAddr + CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwSizeofRaw-3;
-		for (xbaddr addr = startAddr; addr <= endAddr; addr++) 
+RdtscScanResult ScanRdtscInSection(uint32_t sectionIndex)
+{
+	uint8_t rdtsc[2] = { 0x0F, 0x31 };
+	RdtscScanResult result = { sectionIndex, false };
+
+	// Skip some segments known to never contain rdtsc (to avoid false positives)
+	if (std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "DSOUND"
+		|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "XGRPH"
+		|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == ".data"
+		|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == ".rdata"
+		|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "XMV"
+		|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "XONLINE"
+		|| std::string(CxbxKrnl_Xbe->m_szSectionName[sectionIndex]) == "MDLPL") {
+		result.skipped = true;
+		return result;
+	}
+
+	xbaddr startAddr = CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwVirtualAddr;
+	//rdtsc is two bytes instruction, it needs at least one opcode byte after it to finish a function, so the endAddr need to substract 3 bytes.
+	xbaddr endAddr = startAddr + CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwSizeofRaw-3;
+	for (xbaddr addr = startAddr; addr <= endAddr; addr++) 
+	{
+		if (memcmp((void*)addr, rdtsc, 2) == 0) 
 		{
-			if (memcmp((void*)addr, rdtsc, 2) == 0) 
+			uint8_t next_byte = *(uint8_t*)(addr + 2);
+			// If the following byte matches the known pattern.
+			int i = 0;
+			for (i = 0; i<sizeof_rdtsc_pattern; i++) 
 			{
-				uint8_t next_byte = *(uint8_t*)(addr + 2);
-				// If the following byte matches the known pattern.
-				int i = 0;
-				for (i = 0; i<sizeof_rdtsc_pattern; i++) 
+				if (next_byte == rdtsc_pattern[i]) 
 				{
-					if (next_byte == rdtsc_pattern[i]) 
+					if (next_byte == 0x8B)
 					{
-						if (next_byte == 0x8B)
+						if (*(uint8_t*)(addr - 2) == 0x88 && *(uint8_t*)(addr - 1) == 0x5C)
 						{
-							if (*(uint8_t*)(addr - 2) == 0x88 && *(uint8_t*)(addr - 1) == 0x5C)
-							{
-								EmuLogInit(LOG_LEVEL::INFO, "Skipped false positive: rdtsc pattern  0x%.2X, @ 0x%.8X", next_byte, (DWORD)addr);
-								continue;
-							}
-
+							result.entries.push_back({ addr, next_byte, RdtscScanAction::FalsePositive });
+							continue;
 						}
-						if (next_byte == 0x50)
-						{
-							if (*(uint8_t*)(addr - 2) == 0x83 && *(uint8_t*)(addr - 1) == 0xE2)
-							{
-								EmuLogInit(LOG_LEVEL::INFO, "Skipped false positive: rdtsc pattern  0x%.2X, @ 0x%.8X", next_byte, (DWORD)addr);
-								continue;
-							}
 
+					}
+					if (next_byte == 0x50)
+					{
+						if (*(uint8_t*)(addr - 2) == 0x83 && *(uint8_t*)(addr - 1) == 0xE2)
+						{
+							result.entries.push_back({ addr, next_byte, RdtscScanAction::FalsePositive });
+							continue;
 						}
-						PatchRdtsc(addr);
-						//the first for loop already increment addr per loop. we only increment one more time so the addr will point to the byte next to the found rdtsc instruction. this is important since there is at least one case that two rdtsc instructions are next to each other.
-						addr += 1;
-						//if a match found, break the pattern matching loop and keep looping addr for next rdtsc.
-						break;
+
 					}
-				}
-				if (i>= sizeof_rdtsc_pattern)
-				{
-					//no pattern matched, keep record for detections we treat as non-rdtsc for future debugging.
-					EmuLogInit(LOG_LEVEL::INFO, "Skipped potential rdtsc: Unknown opcode pattern  0x%.2X, @ 0x%.8X", next_byte, (DWORD)addr);
+					// The patch itself is deferred, the bytes it overwrites are never looked at again by this scan
+					result.entries.push_back({ addr, next_byte, RdtscScanAction::Patch });
+					//the first for loop already increment addr per loop. we only increment one more time so the addr will point to the byte next to the found rdtsc instruction. this is important since there is at least one case that two rdtsc instructions are next to each other.
+					addr += 1;
+					//if a match found, break the pattern matching loop and keep looping addr for next rdtsc.
+					break;
 				}
 			}
+			if (i>= sizeof_rdtsc_pattern)
+			{
+				//no pattern matched, keep record for detections we treat as non-rdtsc for future debugging.
+				result.entries.push_back({ addr, next_byte, RdtscScanAction::Unknown });
+			}
+		}
+	}
+
+	return result;
+}
+
+void PatchRdtscInstructions()
+{
+	// Search each CODE section concurrently, then log and patch in section order
+	std::vector<RdtscScanResult> results = ForEachExecutableSection<RdtscScanResult>(ScanRdtscInSection);
+
+	for (const auto &result : results) {
+		if (result.skipped) {
+			continue;
+		}
+
+		EmuLogInit(LOG_LEVEL::INFO, "Searching for rdtsc in section %s", CxbxKrnl_Xbe->m_szSectionName[result.sectionIndex]);
+		for (const auto &entry : result.entries) {
+			switch (entry.action) {
+			case RdtscScanAction::Patch:
+				PatchRdtsc(entry.addr);
+				break;
+			case RdtscScanAction::FalsePositive:
+				EmuLogInit(LOG_LEVEL::INFO, "Skipped false positive: rdtsc pattern  0x%.2X, @ 0x%.8X", entry.next_byte, (DWORD)entry.addr);
+				break;
+			case RdtscScanAction::Unknown:
+				EmuLogInit(LOG_LEVEL::INFO, "Skipped potential rdtsc: Unknown opcode pattern  0x%.2X, @ 0x%.8X", entry.next_byte, (DWORD)entry.addr);
+				break;
+			}
 		}
 	}
 
@@ -666,6 +772,8 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 {
 	std::string tempStr;
 
+	CxbxBootStartTime = std::chrono::steady_clock::now();
+
 	// NOTE: This is designated for standalone kernel mode launch without GUI
 	if (g_Settings != nullptr) {
 
@@ -693,6 +801,12 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 	/* Initialize Cxbx File Paths */
 	CxbxInitFilePaths();
 
+	// Start the startup tracer if requested, the value is the length of the trace in seconds
+	if (cli_config::GetValue(cli_config::trace, &tempStr)) {
+		int TraceSeconds = std::atoi(tempStr.c_str());
+		Trace_Init(std::string(szFolder_CxbxReloadedData) + "\\StartupTrace.json", (TraceSeconds > 0 ? TraceSeconds : 10) * 1000);
+	}
+
 	// Skip '/load' switch
 	// Get XBE Name :
 	std::string xbePath;
@@ -727,6 +841,14 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 	// Set up the logging variables for the kernel process during initialization.
 	log_sync_config();
 
+	// From here on, send the log to the binary log if requested. Like the kernel debug
+	// log, the first boot starts a new file and a reboot appends to it.
+	bool LogBinary;
+	g_EmuShared->GetLogBinary(&LogBinary);
+	if (LogBinary && !log_init_binary(std::string(szFolder_CxbxReloadedData) + "\\EmuLog.bin", BootFlags != BOOT_NONE)) {
+		EmuLogInit(LOG_LEVEL::WARNING, "Could not open the binary log, logging to the console instead");
+	}
+
 	// When a reboot occur, we need to keep persistent memory buffer open before emulation process shutdown.
 	if ((BootFlags & BOOT_QUICK_REBOOT) != 0) {
 		g_VMManager.GetPersistentMemory();
@@ -984,6 +1106,30 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 		// Once clean up process is done, proceed set to global variable string.
 		strncpy(szFilePath_Xbe, xbePath.c_str(), MAX_PATH - 1);
 		std::replace(xbePath.begin(), xbePath.end(), ';', '/');
+
+		// An .iso image is booted directly : D: gets served from the image itself, only the xbe to run
+		// is copied out, as the Xbe class parses from a host file. That's the default.xbe of the image,
+		// unless a relaunching title named another xbe inside it (like "game.iso\\other.xbe")
+		std::string imagePath, imageXbePath;
+		if (XisoImage::IsImagePath(xbePath, &imagePath, &imageXbePath)) {
+			std::replace(imageXbePath.begin(), imageXbePath.end(), '/', '\\');
+			if (imageXbePath.empty()) {
+				imageXbePath = "default.xbe";
+			}
+
+			XisoImage image;
+			std::string cachedXbePath = std::string(szFolder_CxbxReloadedData) + "\\XisoDefault.xbe";
+			if (!image.Mount(imagePath) || !image.ExtractFile(imageXbePath, cachedXbePath)) {
+				CxbxKrnlCleanup(("Could not boot " + imageXbePath + " from XISO image " + imagePath).c_str());
+				return;
+			}
+
+			// D: is always the root of the image, so an xbe in a sub folder uses the ';' current directory notation
+			bool inSubFolder = imageXbePath.find('\\') != std::string::npos;
+			snprintf(szFilePath_Xbe, MAX_PATH, "%s%c%s", imagePath.c_str(), inSubFolder ? ';' : '\\', imageXbePath.c_str());
+			xbePath = cachedXbePath;
+		}
+
 		// Load Xbe (this one will reside above WinMain's virtual_memory_placeholder)
 		CxbxKrnl_Xbe = new Xbe(xbePath.c_str(), false); // TODO : Instead of using the Xbe class, port Dxbx _ReadXbeBlock()
 
@@ -992,17 +1138,23 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 			return;
 		}
 
-		// Check the signature of the xbe
-		if (CxbxKrnl_Xbe->CheckSignature()) {
-			EmuLogInit(LOG_LEVEL::INFO, "Valid xbe signature. Xbe is legit");
-		}
-		else {
-			EmuLogInit(LOG_LEVEL::WARNING, "Invalid xbe signature. Homebrew, tampered or pirated xbe?");
+		// Check the signature of the xbe, concurrently with the integrity of the xbe sections
+		std::vector<bool> sectionValid;
+		{
+			CxbxBootStage Stage("xbe verification");
+			std::future<bool> signatureValid = std::async(std::launch::async, &Xbe::CheckSignature, CxbxKrnl_Xbe);
+			CxbxKrnl_Xbe->CheckSectionsIntegrity(sectionValid);
+			if (signatureValid.get()) {
+				EmuLogInit(LOG_LEVEL::INFO, "Valid xbe signature. Xbe is legit");
+			}
+			else {
+				EmuLogInit(LOG_LEVEL::WARNING, "Invalid xbe signature. Homebrew, tampered or pirated xbe?");
+			}
 		}
 
-		// Check the integrity of the xbe sections
+		// Report the integrity of the xbe sections
 		for (uint32_t sectionIndex = 0; sectionIndex < CxbxKrnl_Xbe->m_Header.dwSections; sectionIndex++) {
-			if (CxbxKrnl_Xbe->CheckSectionIntegrity(sectionIndex)) {
+			if (sectionValid[sectionIndex]) {
 				EmuLogInit(LOG_LEVEL::INFO, "SHA hash check of section %s successful", CxbxKrnl_Xbe->m_szSectionName[sectionIndex]);
 			}
 			else {
@@ -1107,11 +1259,14 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 
 		// Load all sections marked as preload using the in-memory copy of the xbe header
 		xboxkrnl::PXBEIMAGE_SECTION sectionHeaders = (xboxkrnl::PXBEIMAGE_SECTION)CxbxKrnl_Xbe->m_Header.dwSectionHeadersAddr;
-		for (uint32_t i = 0; i < CxbxKrnl_Xbe->m_Header.dwSections; i++) {
-			if ((sectionHeaders[i].Flags & XBEIMAGE_SECTION_PRELOAD) != 0) {
-				NTSTATUS result = xboxkrnl::XeLoadSection(&sectionHeaders[i]);
-				if (FAILED(result)) {
-					EmuLogInit(LOG_LEVEL::WARNING, "Failed to preload XBE section: %s", CxbxKrnl_Xbe->m_szSectionName[i]);
+		{
+			CxbxBootStage Stage("section loading");
+			for (uint32_t i = 0; i < CxbxKrnl_Xbe->m_Header.dwSections; i++) {
+				if ((sectionHeaders[i].Flags & XBEIMAGE_SECTION_PRELOAD) != 0) {
+					NTSTATUS result = xboxkrnl::XeLoadSection(&sectionHeaders[i]);
+					if (FAILED(result)) {
+						EmuLogInit(LOG_LEVEL::WARNING, "Failed to preload XBE section: %s", CxbxKrnl_Xbe->m_szSectionName[i]);
+					}
 				}
 			}
 		}
@@ -1125,20 +1280,41 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 		// HACK: Attempt to patch out XBE header reads
 		// This works by searching for the XBEH signature and replacing it with what appears in host address space instead
 		// Test case: Half Life 2
-		// Iterate through each CODE section
-		for (uint32_t sectionIndex = 0; sectionIndex < CxbxKrnl_Xbe->m_Header.dwSections; sectionIndex++) {
-			if (!CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwFlags.bExecutable) {
-				continue;
+		// Iterate through each CODE section concurrently, logging afterwards in section order.
+		// Workers only read words that lie entirely inside their own section, because the next
+		// section may be patched at the same time. The last three offsets of each section, whose
+		// word reaches past its end, are scanned afterwards by this thread
+		CxbxBootStage Stage("XBEH patching");
+		auto PatchXbeh = [](xbaddr addr, std::vector<xbaddr> &patches) {
+			if (*(uint32_t*)addr == 0x48454258) {
+				*((uint32_t*)addr) = *(uint32_t*)XBE_IMAGE_BASE;
+				patches.push_back(addr);
 			}
+		};
 
-			EmuLogInit(LOG_LEVEL::INFO, "Searching for XBEH in section %s", CxbxKrnl_Xbe->m_szSectionName[sectionIndex]);
+		auto XbehPatches = ForEachExecutableSection<std::pair<uint32_t, std::vector<xbaddr>>>([&PatchXbeh](uint32_t sectionIndex) {
+			std::vector<xbaddr> patches;
 			xbaddr startAddr = CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwVirtualAddr;
 			xbaddr endAddr = startAddr + CxbxKrnl_Xbe->m_SectionHeader[sectionIndex].dwSizeofRaw;
-			for (xbaddr addr = startAddr; addr < endAddr; addr++) {
-				if (*(uint32_t*)addr == 0x48454258) {
-					EmuLogInit(LOG_LEVEL::INFO, "Patching XBEH at 0x%08X", addr);
-					*((uint32_t*)addr) = *(uint32_t*)XBE_IMAGE_BASE;
-				}
+			for (xbaddr addr = startAddr; addr + sizeof(uint32_t) <= endAddr; addr++) {
+				PatchXbeh(addr, patches);
+			}
+			return std::make_pair(sectionIndex, patches);
+		});
+
+		for (auto &section : XbehPatches) {
+			xbaddr startAddr = CxbxKrnl_Xbe->m_SectionHeader[section.first].dwVirtualAddr;
+			xbaddr endAddr = startAddr + CxbxKrnl_Xbe->m_SectionHeader[section.first].dwSizeofRaw;
+			xbaddr tailAddr = (endAddr - startAddr < sizeof(uint32_t)) ? startAddr : endAddr - (sizeof(uint32_t) - 1);
+			for (xbaddr addr = tailAddr; addr < endAddr; addr++) {
+				PatchXbeh(addr, section.second);
+			}
+		}
+
+		for (const auto &section : XbehPatches) {
+			EmuLogInit(LOG_LEVEL::INFO, "Searching for XBEH in section %s", CxbxKrnl_Xbe->m_szSectionName[section.first]);
+			for (xbaddr addr : section.second) {
+				EmuLogInit(LOG_LEVEL::INFO, "Patching XBEH at 0x%08X", addr);
 			}
 		}
 	}
@@ -1148,11 +1324,14 @@ void CxbxKrnlEmulate(unsigned int reserved_systems, blocks_reserved_t blocks_res
 	kt ^= XOR_KT_KEY[to_underlying(xbeType)];
 
 	// Process the Kernel thunk table to map Kernel function calls to their actual address :
-	MapThunkTable((uint32_t*)kt, CxbxKrnl_KernelThunkTable);
+	{
+		CxbxBootStage Stage("thunk mapping");
+		MapThunkTable((uint32_t*)kt, CxbxKrnl_KernelThunkTable);
 
-	// Does this xbe import any other libraries?
-	if (CxbxKrnl_Xbe->m_Header.dwNonKernelImportDirAddr) {
-		ImportLibraries((XbeImportEntry*)CxbxKrnl_Xbe->m_Header.dwNonKernelImportDirAddr);
+		// Does this xbe import any other libraries?
+		if (CxbxKrnl_Xbe->m_Header.dwNonKernelImportDirAddr) {
+			ImportLibraries((XbeImportEntry*)CxbxKrnl_Xbe->m_Header.dwNonKernelImportDirAddr);
+		}
 	}
 
 	// Launch the XBE :
@@ -1453,7 +1632,10 @@ __declspec(noreturn) void CxbxKrnlInit
 
 	// initialize graphics
 	EmuLogInit(LOG_LEVEL::DEBUG, "Initializing render window.");
-	CxbxInitWindow(true);
+	{
+		CxbxBootStage Stage("render window");
+		CxbxInitWindow(true);
+	}
 
 	// Now process the boot flags to see if there are any special conditions to handle
 	if (BootFlags & BOOT_EJECT_PENDING) {} // TODO
@@ -1468,15 +1650,24 @@ __declspec(noreturn) void CxbxKrnlInit
 	if (BootFlags & BOOT_SKIP_ANIMATION) {} // TODO
 	if (BootFlags & BOOT_RUN_DASHBOARD) {} // TODO
 
-    CxbxInitAudio();
+	{
+		CxbxBootStage Stage("audio");
+		CxbxInitAudio();
+	}
 
-	EmuHLEIntercept(pXbeHeader);
+	{
+		CxbxBootStage Stage("HLE interception");
+		EmuHLEIntercept(pXbeHeader);
+	}
 
 	if (!bLLE_USB) {
 		SetupXboxDeviceTypes();
 	}
 
-	InitXboxHardware(HardwareModel::Revision1_5); // TODO : Make configurable
+	{
+		CxbxBootStage Stage("hardware");
+		InitXboxHardware(HardwareModel::Revision1_5); // TODO : Make configurable
+	}
 
 	// Read Xbox video mode from the SMC, store it in HalBootSMCVideoMode
 	xboxkrnl::HalReadSMBusValue(SMBUS_ADDRESS_SYSTEM_MICRO_CONTROLLER, SMC_COMMAND_AV_PACK, FALSE, &xboxkrnl::HalBootSMCVideoMode);
@@ -1489,6 +1680,7 @@ __declspec(noreturn) void CxbxKrnlInit
 	if (!bLLE_GPU)
 	{
 		EmuLogInit(LOG_LEVEL::DEBUG, "Initializing Direct3D.");
+		CxbxBootStage Stage("Direct3D");
 		EmuD3DInit();
 	}
 	
@@ -1510,6 +1702,7 @@ __declspec(noreturn) void CxbxKrnlInit
 
 	if(!g_SkipRdtscPatching)
 	{ 
+		CxbxBootStage Stage("rdtsc patching");
 		PatchRdtscInstructions();
 	}
 
@@ -1526,10 +1719,13 @@ __declspec(noreturn) void CxbxKrnlInit
 	// Create the interrupt processing thread
 	DWORD dwThreadId;
 	HANDLE hThread = (HANDLE)_beginthreadex(NULL, NULL, CxbxKrnlInterruptThread, NULL, NULL, (unsigned int*)&dwThreadId);
-	// Start the kernel clock thread
+	// Start the kernel clock thread. It stays off the xbox core, where it would compete with the title
+	// threads and delay the ticks it delivers
 	TimerObject* KernelClockThr = Timer_Create(CxbxKrnlClockThread, nullptr, "Kernel clock thread", &g_CPUOthers);
 	Timer_Start(KernelClockThr, SCALE_MS_IN_NS);
 
+	EmuLogInit(LOG_LEVEL::INFO, "Reached XBE entry point %.3f ms after launch",
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - CxbxBootStartTime).count());
 	EmuLogInit(LOG_LEVEL::DEBUG, "Calling XBE entry point...");
 	CxbxLaunchXbe(Entry);
 
@@ -1648,7 +1844,11 @@ __declspec(noreturn) void CxbxKrnlCleanupEx(CXBXR_MODULE cxbxr_module, const cha
     }
 
 	EmuLogInit(LOG_LEVEL::INFO, "MAIN: Terminating Process");
+
+	// Report the repeats deduplication still holds back, then write out the remaining binary log records
+	log_flush_repeats();
     fflush(stdout);
+	BinaryLog_Close();
 
     // cleanup debug output
     {
@@ -1765,6 +1965,13 @@ void CxbxKrnlShutDown()
 	// Shutdown the memory manager
 	g_VMManager.Shutdown();
 
+	// Write out the startup trace, in case we exit before it's complete
+	Trace_Flush();
+
+	// Report the repeats deduplication still holds back, then write out the remaining binary log records
+	log_flush_repeats();
+	BinaryLog_Close();
+
 	CxbxUnlockFilePath();
 
 	if (CxbxKrnl_hEmuParent != NULL) {
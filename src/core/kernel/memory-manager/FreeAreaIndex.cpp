@@ -0,0 +1,214 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "FreeAreaIndex.h"
+#include <assert.h>
+
+
+FreeAreaIndex::~FreeAreaIndex()
+{
+	Destroy(m_Root);
+}
+
+uint32_t FreeAreaIndex::NextPriority()
+{
+	// xorshift32, the priorities only need to be well spread to keep the treap balanced
+	m_Seed ^= m_Seed << 13;
+	m_Seed ^= m_Seed >> 17;
+	m_Seed ^= m_Seed << 5;
+	return m_Seed;
+}
+
+void FreeAreaIndex::Update(Node* node)
+{
+	node->MaxSize = node->Size;
+	if (node->Left != nullptr && node->Left->MaxSize > node->MaxSize) { node->MaxSize = node->Left->MaxSize; }
+	if (node->Right != nullptr && node->Right->MaxSize > node->MaxSize) { node->MaxSize = node->Right->MaxSize; }
+}
+
+void FreeAreaIndex::Split(Node* node, uintptr_t Base, Node** Left, Node** Right)
+{
+	// Left receives the nodes below Base, Right the others
+	if (node == nullptr) {
+		*Left = *Right = nullptr;
+		return;
+	}
+
+	if (node->Base < Base) {
+		Split(node->Right, Base, &node->Right, Right);
+		*Left = node;
+	}
+	else {
+		Split(node->Left, Base, Left, &node->Left);
+		*Right = node;
+	}
+	Update(node);
+}
+
+FreeAreaIndex::Node* FreeAreaIndex::Merge(Node* Left, Node* Right)
+{
+	// all the nodes of Left must be below the ones of Right
+	if (Left == nullptr) { return Right; }
+	if (Right == nullptr) { return Left; }
+
+	if (Left->Priority > Right->Priority) {
+		Left->Right = Merge(Left->Right, Right);
+		Update(Left);
+		return Left;
+	}
+
+	Right->Left = Merge(Left, Right->Left);
+	Update(Right);
+	return Right;
+}
+
+FreeAreaIndex::Node* FreeAreaIndex::Find(Node* node, uintptr_t Base)
+{
+	while (node != nullptr && node->Base != Base) {
+		node = (Base < node->Base) ? node->Left : node->Right;
+	}
+	return node;
+}
+
+void FreeAreaIndex::Insert(uintptr_t Base, size_t Size)
+{
+	assert(Find(m_Root, Base) == nullptr);
+
+	Node* node = new Node;
+	node->Base = Base;
+	node->Size = node->MaxSize = Size;
+	node->Priority = NextPriority();
+	node->Left = node->Right = nullptr;
+
+	Node *Left, *Right;
+	Split(m_Root, Base, &Left, &Right);
+	m_Root = Merge(Merge(Left, node), Right);
+	m_BySize.emplace(Size, Base);
+}
+
+void FreeAreaIndex::Erase(uintptr_t Base)
+{
+	Node *Left, *Middle, *Right;
+	Split(m_Root, Base, &Left, &Middle);
+	Split(Middle, Base + 1, &Middle, &Right);
+
+	assert(Middle != nullptr && Middle->Left == nullptr && Middle->Right == nullptr);
+	m_BySize.erase(std::make_pair(Middle->Size, Base));
+	delete Middle;
+
+	m_Root = Merge(Left, Right);
+}
+
+void FreeAreaIndex::Resize(uintptr_t Base, size_t Size)
+{
+	Node *Left, *Middle, *Right;
+	Split(m_Root, Base, &Left, &Middle);
+	Split(Middle, Base + 1, &Middle, &Right);
+
+	assert(Middle != nullptr);
+	m_BySize.erase(std::make_pair(Middle->Size, Base));
+	m_BySize.emplace(Size, Base);
+	Middle->Size = Size;
+	Update(Middle);
+
+	m_Root = Merge(Merge(Left, Middle), Right);
+}
+
+void FreeAreaIndex::Clear()
+{
+	Destroy(m_Root);
+	m_Root = nullptr;
+	m_BySize.clear();
+}
+
+void FreeAreaIndex::Destroy(Node* node)
+{
+	// Recurse on the left subtrees and loop on the right ones, the depth of the treap stays logarithmic
+	while (node != nullptr) {
+		Destroy(node->Left);
+		Node* Next = node->Right;
+		delete node;
+		node = Next;
+	}
+}
+
+const FreeAreaIndex::Node* FreeAreaIndex::FindFirst(const Node* node, uintptr_t Low, uintptr_t High, size_t Size)
+{
+	// Subtrees without a large enough area are skipped entirely, which keeps the search logarithmic
+	if (node == nullptr || node->MaxSize < Size) { return nullptr; }
+
+	if (node->Base >= Low) {
+		const Node* Found = FindFirst(node->Left, Low, High, Size);
+		if (Found != nullptr) { return Found; }
+		if (node->Base >= High) { return nullptr; }
+		if (node->Size >= Size) { return node; }
+	}
+
+	return FindFirst(node->Right, Low, High, Size);
+}
+
+const FreeAreaIndex::Node* FreeAreaIndex::FindLast(const Node* node, uintptr_t Low, uintptr_t High, size_t Size)
+{
+	if (node == nullptr || node->MaxSize < Size) { return nullptr; }
+
+	if (node->Base < High) {
+		const Node* Found = FindLast(node->Right, Low, High, Size);
+		if (Found != nullptr) { return Found; }
+		if (node->Base < Low) { return nullptr; }
+		if (node->Size >= Size) { return node; }
+	}
+
+	return FindLast(node->Left, Low, High, Size);
+}
+
+bool FreeAreaIndex::FindFirst(uintptr_t Low, uintptr_t High, size_t Size, uintptr_t* Base, size_t* AreaSize) const
+{
+	const Node* node = FindFirst(m_Root, Low, High, Size);
+	if (node == nullptr) { return false; }
+
+	*Base = node->Base;
+	*AreaSize = node->Size;
+	return true;
+}
+
+bool FreeAreaIndex::FindLast(uintptr_t Low, uintptr_t High, size_t Size, uintptr_t* Base, size_t* AreaSize) const
+{
+	const Node* node = FindLast(m_Root, Low, High, Size);
+	if (node == nullptr) { return false; }
+
+	*Base = node->Base;
+	*AreaSize = node->Size;
+	return true;
+}
+
+bool FreeAreaIndex::FindBest(size_t Size, uintptr_t* Base, size_t* AreaSize) const
+{
+	auto it = m_BySize.lower_bound(std::make_pair(Size, (uintptr_t)0));
+	if (it == m_BySize.end()) { return false; }
+
+	*AreaSize = it->first;
+	*Base = it->second;
+	return true;
+}
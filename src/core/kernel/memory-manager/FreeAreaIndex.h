@@ -0,0 +1,91 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef FREE_AREA_INDEX_H
+#define FREE_AREA_INDEX_H
+
+
+#include <cstdint>
+#include <cstddef>
+#include <set>
+#include <utility>
+
+
+/* Index of the free vma's of a memory region, used to find free space without walking the vma map.
+   It only depends on the standard library, so that it can be built and tested outside of the emulator */
+class FreeAreaIndex
+{
+	public:
+		FreeAreaIndex() {};
+		~FreeAreaIndex();
+		FreeAreaIndex(const FreeAreaIndex&) = delete;
+		FreeAreaIndex& operator=(const FreeAreaIndex&) = delete;
+		// adds a free area (it must not overlap with the areas already in the index)
+		void Insert(uintptr_t Base, size_t Size);
+		// removes the free area starting at Base
+		void Erase(uintptr_t Base);
+		// changes the size of the free area starting at Base
+		void Resize(uintptr_t Base, size_t Size);
+		// removes all the free areas
+		void Clear();
+		// number of free areas in the index
+		size_t Count() const { return m_BySize.size(); }
+		// first-fit : finds the free area with the lowest base in [Low, High) that is at least Size bytes large
+		bool FindFirst(uintptr_t Low, uintptr_t High, size_t Size, uintptr_t* Base, size_t* AreaSize) const;
+		// same as FindFirst, but finds the free area with the highest base
+		bool FindLast(uintptr_t Low, uintptr_t High, size_t Size, uintptr_t* Base, size_t* AreaSize) const;
+		// best-fit : finds the smallest free area that is at least Size bytes large, the lowest one on ties
+		bool FindBest(size_t Size, uintptr_t* Base, size_t* AreaSize) const;
+
+	private:
+		// treap node keyed by base address, augmented with the largest size found in its subtree
+		struct Node
+		{
+			uintptr_t Base;
+			size_t Size;
+			size_t MaxSize;
+			uint32_t Priority;
+			Node* Left;
+			Node* Right;
+		};
+
+		// root of the treap of the free areas, ordered by address
+		Node* m_Root = nullptr;
+		// the free areas ordered by size, for best-fit searches
+		std::set<std::pair<size_t, uintptr_t>> m_BySize;
+		// state of the generator of the treap priorities
+		uint32_t m_Seed = 0x9E3779B9;
+
+		uint32_t NextPriority();
+		static void Update(Node* node);
+		static void Split(Node* node, uintptr_t Base, Node** Left, Node** Right);
+		static Node* Merge(Node* Left, Node* Right);
+		static Node* Find(Node* node, uintptr_t Base);
+		static const Node* FindFirst(const Node* node, uintptr_t Low, uintptr_t High, size_t Size);
+		static const Node* FindLast(const Node* node, uintptr_t Low, uintptr_t High, size_t Size);
+		static void Destroy(Node* node);
+};
+
+#endif
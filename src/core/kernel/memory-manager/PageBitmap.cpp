@@ -0,0 +1,168 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "PageBitmap.h"
+#include <assert.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+static inline int32_t HighestSetBit(uint32_t Value)
+{
+#ifdef _MSC_VER
+	unsigned long Index;
+	_BitScanReverse(&Index, Value);
+	return (int32_t)Index;
+#else
+	return 31 - __builtin_clz(Value);
+#endif
+}
+
+// Mask of the bits from First to Last (inclusive) of a word
+static inline uint32_t BitRangeMask(uint32_t First, uint32_t Last)
+{
+	uint32_t High = (Last == 31) ? 0xFFFFFFFF : ((1u << (Last + 1)) - 1);
+	return High & ~((1u << First) - 1);
+}
+
+void PageBitmap::Clear()
+{
+	for (uint32_t i = 0; i < PAGE_BITMAP_WORDS; i++) { m_Free[i] = 0; }
+	for (uint32_t i = 0; i < PAGE_BITMAP_SUMMARY_WORDS; i++) {
+		m_AnyFree[i] = 0;
+		m_AnyUsed[i] = 0xFFFFFFFF;
+	}
+}
+
+void PageBitmap::UpdateSummary(uint32_t Word)
+{
+	uint32_t Bit = 1u << (Word & 31);
+
+	if (m_Free[Word] != 0) { m_AnyFree[Word >> 5] |= Bit; }
+	else { m_AnyFree[Word >> 5] &= ~Bit; }
+
+	if (m_Free[Word] != 0xFFFFFFFF) { m_AnyUsed[Word >> 5] |= Bit; }
+	else { m_AnyUsed[Word >> 5] &= ~Bit; }
+}
+
+void PageBitmap::SetFree(uint32_t First, uint32_t Last)
+{
+	assert(First <= Last && Last < PAGE_BITMAP_MAX_PAGES);
+
+	for (uint32_t Word = First >> 5; Word <= (Last >> 5); Word++)
+	{
+		uint32_t Start = (Word == (First >> 5)) ? (First & 31) : 0;
+		uint32_t End = (Word == (Last >> 5)) ? (Last & 31) : 31;
+		m_Free[Word] |= BitRangeMask(Start, End);
+		UpdateSummary(Word);
+	}
+}
+
+void PageBitmap::SetUsed(uint32_t First, uint32_t Last)
+{
+	assert(First <= Last && Last < PAGE_BITMAP_MAX_PAGES);
+
+	for (uint32_t Word = First >> 5; Word <= (Last >> 5); Word++)
+	{
+		uint32_t Start = (Word == (First >> 5)) ? (First & 31) : 0;
+		uint32_t End = (Word == (Last >> 5)) ? (Last & 31) : 31;
+		m_Free[Word] &= ~BitRangeMask(Start, End);
+		UpdateSummary(Word);
+	}
+}
+
+bool PageBitmap::IsRangeUsed(uint32_t First, uint32_t Last) const
+{
+	int32_t Page = FindLast(Last, true);
+	return Page < (int32_t)First;
+}
+
+int32_t PageBitmap::FindLast(uint32_t High, bool bFree) const
+{
+	const uint32_t* Summary = bFree ? m_AnyFree : m_AnyUsed;
+	int32_t Word = High >> 5;
+
+	// First look in the word holding High, only at the bits not above it
+	uint32_t Bits = (bFree ? m_Free[Word] : ~m_Free[Word]) & BitRangeMask(0, High & 31);
+	if (Bits != 0) {
+		return (Word << 5) + HighestSetBit(Bits);
+	}
+
+	// Then use the summary to jump to the next word below with a matching page
+	Word--;
+	while (Word >= 0)
+	{
+		uint32_t SummaryBits = Summary[Word >> 5] & BitRangeMask(0, Word & 31);
+		if (SummaryBits != 0) {
+			Word = ((Word >> 5) << 5) + HighestSetBit(SummaryBits);
+			Bits = bFree ? m_Free[Word] : ~m_Free[Word];
+			return (Word << 5) + HighestSetBit(Bits);
+		}
+		Word = ((Word >> 5) << 5) - 1;
+	}
+
+	return -1;
+}
+
+bool PageBitmap::FindRunFromTop(uint32_t Count, uint32_t Alignment, uint32_t Low, uint32_t High, uint32_t* First) const
+{
+	int64_t AlignmentMask = 0;
+	int64_t AlignmentSubtraction = 0;
+
+	if (Count == 0 || High < Low) { return false; }
+	if (High >= PAGE_BITMAP_MAX_PAGES) { High = PAGE_BITMAP_MAX_PAGES - 1; }
+
+	if (Alignment)
+	{
+		AlignmentMask = ~(int64_t)(Alignment - 1);
+		AlignmentSubtraction = (((int64_t)Count + Alignment - 1) & AlignmentMask) - Count + 1;
+	}
+
+	int64_t Top = High;
+	while (Top >= (int64_t)Low)
+	{
+		// The free block below Top, clipped to the requested range
+		int64_t BlockEnd = FindLast((uint32_t)Top, true);
+		if (BlockEnd < (int64_t)Low) { return false; }
+		int64_t BlockStart = FindLast((uint32_t)BlockEnd, false) + 1;
+		if (BlockStart < (int64_t)Low) { BlockStart = Low; }
+
+		int64_t RunEnd = BlockEnd;
+		if (Alignment) {
+			RunEnd = ((BlockEnd + 1) & AlignmentMask) - AlignmentSubtraction;
+		}
+
+		if (RunEnd >= BlockStart && RunEnd - BlockStart + 1 >= (int64_t)Count)
+		{
+			*First = (uint32_t)(RunEnd - Count + 1);
+			return true;
+		}
+
+		Top = BlockStart - 1;
+	}
+
+	return false;
+}
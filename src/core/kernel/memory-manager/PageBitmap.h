@@ -0,0 +1,74 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef PAGE_BITMAP_H
+#define PAGE_BITMAP_H
+
+
+#include <cstdint>
+
+// Enough pages for the 128 MiB of the devkit and chihiro layouts (CHIHIRO_HIGHEST_PHYSICAL_PAGE + 1)
+#define PAGE_BITMAP_MAX_PAGES 0x8000
+#define PAGE_BITMAP_WORDS (PAGE_BITMAP_MAX_PAGES / 32)
+#define PAGE_BITMAP_SUMMARY_WORDS (PAGE_BITMAP_WORDS / 32)
+
+
+/* Two-level bitmap tracking the free physical pages. The first level has a bit per page, set when the page is free,
+   and the second level has a bit per word of the first level, set when that word has a free (or a used) page, so that
+   the searches can skip the fully used (or fully free) words. It only depends on the standard library, so that it
+   can be built and tested outside of the emulator */
+class PageBitmap
+{
+	public:
+		PageBitmap() { Clear(); };
+		// marks all the pages as used
+		void Clear();
+		// marks the pages from First to Last (inclusive) as free
+		void SetFree(uint32_t First, uint32_t Last);
+		// marks the pages from First to Last (inclusive) as used
+		void SetUsed(uint32_t First, uint32_t Last);
+		// checks if a page is free
+		bool IsFree(uint32_t Page) const { return (m_Free[Page >> 5] >> (Page & 31)) & 1; }
+		// checks if all the pages from First to Last (inclusive) are used
+		bool IsRangeUsed(uint32_t First, uint32_t Last) const;
+		// finds the highest run of Count free pages between Low and High (inclusive). The run starts on a multiple
+		// of Alignment if one is requested, and it's placed as high as possible inside the free block that holds it
+		bool FindRunFromTop(uint32_t Count, uint32_t Alignment, uint32_t Low, uint32_t High, uint32_t* First) const;
+
+	private:
+		// a bit per page, set if the page is free
+		uint32_t m_Free[PAGE_BITMAP_WORDS];
+		// a bit per word of m_Free, set if the word has at least a free page
+		uint32_t m_AnyFree[PAGE_BITMAP_SUMMARY_WORDS];
+		// a bit per word of m_Free, set if the word has at least a used page
+		uint32_t m_AnyUsed[PAGE_BITMAP_SUMMARY_WORDS];
+
+		// updates the summary bits of a word of m_Free
+		void UpdateSummary(uint32_t Word);
+		// finds the highest free (or used) page not above High, returns -1 if there is none
+		int32_t FindLast(uint32_t High, bool bFree) const;
+};
+
+#endif
@@ -30,19 +30,8 @@
 
 #include "PhysicalMemory.h"
 #include "Logging.h"
-#include "core\kernel\exports\EmuKrnl.h" // For InitializeListHead(), etc.
 #include <assert.h>
 
-// See the links below for the details about the kernel structure LIST_ENTRY and the related functions
-// https://www.codeproject.com/Articles/800404/Understanding-LIST-ENTRY-Lists-and-Its-Importance
-// https://docs.microsoft.com/en-us/windows-hardware/drivers/kernel/singly-and-doubly-linked-lists
-#define LIST_ENTRY_INITIALIZE(ListEntry) ((ListEntry)->Flink = (ListEntry)->Blink = nullptr)
-
-inline FreeBlock* ListEntryToFreeBlock(xboxkrnl::PLIST_ENTRY pListEntry)
-{
-	return CONTAINING_RECORD(pListEntry, FreeBlock, ListEntry);
-}
-
 void PhysicalMemory::InitializePageDirectory()
 {
 	PMMPTE pPde;
@@ -165,212 +154,48 @@ void PhysicalMemory::WritePte(PMMPTE pPteStart, PMMPTE pPteEnd, MMPTE Pte, PFN p
 
 bool PhysicalMemory::RemoveFree(PFN_COUNT NumberOfPages, PFN* result, PFN_COUNT PfnAlignment, PFN start, PFN end)
 {
-	xboxkrnl::PLIST_ENTRY ListEntry;
-	PFN PfnStart;
-	PFN PfnEnd;
-	PFN IntersectionStart;
-	PFN IntersectionEnd;
-	PFN_COUNT PfnCount;
-	PFN_COUNT PfnAlignmentMask;
-	PFN_COUNT PfnAlignmentSubtraction;
+	PFN pfn;
 
 	// The caller should already guarantee that there are enough free pages available
 	if (NumberOfPages == 0) { result = nullptr; return false; }
 
-	if (PfnAlignment)
-	{
-		// Calculate some alignment parameters if one is requested
-
-		PfnAlignmentMask = ~(PfnAlignment - 1);
-		PfnAlignmentSubtraction = ((NumberOfPages + PfnAlignment - 1) & PfnAlignmentMask) - NumberOfPages + 1;
+	// Search from the top for a free run with enough pages inside the requested range, honoring the alignment if
+	// one is requested
+	if (!m_FreePages.FindRunFromTop(NumberOfPages, PfnAlignment, start, end, &pfn)) {
+		result = nullptr;
+		return false;
 	}
 
-	ListEntry = FreeList.Blink; // search from the top
-
-	while (ListEntry != &FreeList)
-	{
-		if (ListEntryToFreeBlock(ListEntry)->size >= NumberOfPages) // search for a block with enough pages
-		{
-			PfnStart = ListEntryToFreeBlock(ListEntry)->start;
-			PfnCount = ListEntryToFreeBlock(ListEntry)->size;
-			PfnEnd = PfnStart + PfnCount - 1;
-			IntersectionStart = start >= PfnStart ? start : PfnStart;
-			IntersectionEnd = end <= PfnEnd ? end : PfnEnd;
-
-			if (IntersectionEnd < IntersectionStart)
-			{
-				// Not inside the requested range, keep searching
-
-				goto InvalidBlock;
-			}
-
-			if (IntersectionEnd - IntersectionStart + 1 < NumberOfPages)
-			{
-				// There is not enough free space inside the free block so this is an invalid block.
-				// We have to check again since the free size could have shrinked because of the intersection
-				// check done above
+	m_FreePages.SetUsed(pfn, pfn + NumberOfPages - 1);
 
-				goto InvalidBlock;
-			}
-
-			if (PfnAlignment)
-			{
-				IntersectionEnd = ((IntersectionEnd + 1) & PfnAlignmentMask) - PfnAlignmentSubtraction;
-
-				if (IntersectionEnd < IntersectionStart || IntersectionEnd - IntersectionStart + 1 < NumberOfPages)
-				{
-					// This free block doesn't honor the alignment requested, so this is another invalid block
-
-					goto InvalidBlock;
-				}
-			}
-
-			// Now we know that we have a usable free block with enough pages
-
-			if (IntersectionStart == PfnStart)
-			{
-				if (IntersectionEnd == PfnEnd)
-				{
-					// The block is totally inside the range, just shrink its size
-
-					PfnCount -= NumberOfPages;
-					if (!PfnCount)
-					{
-						// delete the entry if there is no free space left
-
-						RemoveEntryList(ListEntry);
-						delete ListEntryToFreeBlock(ListEntry);
-					}
-					else { ListEntryToFreeBlock(ListEntry)->size = PfnCount; }
-				}
-				else
-				{
-					// Create a new block with the remaining pages after the block
-
-					PFreeBlock block = new FreeBlock;
-					block->start = IntersectionEnd + 1;
-					block->size = PfnStart + PfnCount - IntersectionEnd - 1;
-					LIST_ENTRY_INITIALIZE(&block->ListEntry);
-					InsertHeadList(ListEntry, &block->ListEntry);
-
-					PfnCount = IntersectionEnd - PfnStart - NumberOfPages + 1;
-					if (!PfnCount)
-					{
-						// delete the entry if there is no free space left
-
-						RemoveEntryList(ListEntry);
-						delete ListEntryToFreeBlock(ListEntry);
-					}
-					else { ListEntryToFreeBlock(ListEntry)->size = PfnCount; }
-				}
-			}
-			else
-			{
-				// Starting address of the free block is lower than the intersection start
-
-				if (IntersectionEnd == PfnEnd)
-				{
-					// The free block extends before IntersectionStart
-
-					PfnCount -= NumberOfPages;
-					ListEntryToFreeBlock(ListEntry)->size = PfnCount;
-				}
-				else
-				{
-					// The free block extends in both directions
-
-					PFreeBlock block = new FreeBlock;
-					block->start = IntersectionEnd + 1;
-					block->size = PfnStart + PfnCount - IntersectionEnd - 1;
-					LIST_ENTRY_INITIALIZE(&block->ListEntry);
-					InsertHeadList(ListEntry, &block->ListEntry);
-
-					PfnCount = IntersectionEnd - PfnStart - NumberOfPages + 1;
-					ListEntryToFreeBlock(ListEntry)->size = PfnCount;
-				}
-			}
-			if (m_MmLayoutDebug && (PfnStart + PfnCount >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
-				m_DebuggerPagesAvailable -= NumberOfPages;
-				assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
-			}
-			else {
-				m_PhysicalPagesAvailable -= NumberOfPages;
-				assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
-			}
-			*result = PfnStart + PfnCount;
-			return true;
-		}
-		InvalidBlock:
-		ListEntry = ListEntry->Blink;
+	if (m_MmLayoutDebug && (pfn >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
+		m_DebuggerPagesAvailable -= NumberOfPages;
+		assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
 	}
-	result = nullptr;
-	return false;
+	else {
+		m_PhysicalPagesAvailable -= NumberOfPages;
+		assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
+	}
+	*result = pfn;
+	return true;
 }
 
 void PhysicalMemory::InsertFree(PFN start, PFN end)
 {
-	xboxkrnl::PLIST_ENTRY ListEntry;
 	PFN_COUNT size = end - start + 1;
 
-	ListEntry = FreeList.Blink; // search from the top
-
-	while (true)
-	{
-		if (ListEntryToFreeBlock(ListEntry)->start < start || ListEntry == &FreeList)
-		{
-			PFreeBlock block = new FreeBlock;
-			block->start = start;
-			block->size = size;
-			LIST_ENTRY_INITIALIZE(&block->ListEntry);
-			InsertHeadList(ListEntry, &block->ListEntry);
-
-			// Ensure that we are not freeing a part of the previous block
-			if (ListEntry != &FreeList) {
-				assert(ListEntryToFreeBlock(ListEntry)->start +
-					ListEntryToFreeBlock(ListEntry)->size - 1 < start);
-			}
+	// Ensure that we are not freeing pages that are already free
+	assert(m_FreePages.IsRangeUsed(start, end));
 
-			ListEntry = ListEntry->Flink; // move to the new created block
+	m_FreePages.SetFree(start, end);
 
-			// Ensure that we are not freeing a part of the next block
-			if (ListEntry->Flink != &FreeList) {
-				assert(ListEntryToFreeBlock(ListEntry->Flink)->start > end);
-			}
-
-			// Check if merging is possible
-			if (ListEntry->Flink != &FreeList &&
-				start + size == ListEntryToFreeBlock(ListEntry->Flink)->start)
-			{
-				// Merge forward
-				xboxkrnl::PLIST_ENTRY temp = ListEntry->Flink;
-				ListEntryToFreeBlock(ListEntry)->size +=
-					ListEntryToFreeBlock(temp)->size;
-				RemoveEntryList(temp);
-				delete ListEntryToFreeBlock(temp);
-			}
-			if (ListEntry->Blink != &FreeList &&
-				ListEntryToFreeBlock(ListEntry->Blink)->start +
-				ListEntryToFreeBlock(ListEntry->Blink)->size == start)
-			{
-				// Merge backward
-				ListEntryToFreeBlock(ListEntry->Blink)->size +=
-					ListEntryToFreeBlock(ListEntry)->size;
-				RemoveEntryList(ListEntry);
-				delete block;
-			}
-
-			if (m_MmLayoutDebug && (start >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
-				m_DebuggerPagesAvailable += size;
-				assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
-			}
-			else {
-				m_PhysicalPagesAvailable += size;
-				assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
-			}
-
-			return;
-		}
-		ListEntry = ListEntry->Blink;
+	if (m_MmLayoutDebug && (start >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
+		m_DebuggerPagesAvailable += size;
+		assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
+	}
+	else {
+		m_PhysicalPagesAvailable += size;
+		assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
 	}
 }
 
@@ -36,6 +36,7 @@ namespace xboxkrnl
 
 #include "core\kernel\support\Emu.h"
 #include "core\kernel\init\CxbxKrnl.h"
+#include "PageBitmap.h"
 #include <windows.h>
 #include <map>
 
@@ -48,15 +49,6 @@ typedef unsigned int PFN;
 typedef unsigned int PFN_COUNT;
 
 
-/* An entry of the list tracking the free pages on the system */
-typedef struct _FreeBlock
-{
-	PFN start;                        // starting page of the block
-	PFN_COUNT size;                   // number of pages in the block
-	xboxkrnl::LIST_ENTRY ListEntry;
-}FreeBlock, *PFreeBlock;
-
-
 /* The Xbox PTE, modelled around the Intel 386 PTE specification */
 typedef struct _XBOX_PTE
 {
@@ -200,8 +192,8 @@ typedef enum _MmLayout
 class PhysicalMemory
 {
 	protected:
-		// doubly linked list tracking the free physical pages
-		xboxkrnl::LIST_ENTRY FreeList = { &FreeList , &FreeList };
+		// bitmap tracking the free physical pages
+		PageBitmap m_FreePages;
 		// highest pfn available for contiguous allocations
 		PAddr m_MaxContiguousPfn = XBOX_CONTIGUOUS_MEMORY_LIMIT;
 		// amount of free physical pages available for non-debugger usage
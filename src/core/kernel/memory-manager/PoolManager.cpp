@@ -57,9 +57,13 @@ void PoolManager::InitializePool()
 	for (Index = 0; Index < POOL_SMALL_LISTS; Index++) {
 		Lookaside = &m_ExpSmallNPagedPoolLookasideLists[Index];
 		Lookaside->ListHead.Alignment = 0;
-		Lookaside->Depth = 2;
+		Lookaside->Depth = POOL_LOOKASIDE_MINIMUM_DEPTH;
 		Lookaside->TotalAllocates = 0;
 		Lookaside->AllocateHits = 0;
+		Lookaside->TotalFrees = 0;
+		Lookaside->FreeHits = 0;
+		Lookaside->LastTotalAllocates = 0;
+		Lookaside->LastAllocateHits = 0;
 	}
 
 	printf("Pool manager initialized!\n");
@@ -72,16 +76,12 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 		LOG_FUNC_ARG(Tag)
 	LOG_FUNC_END;
 
-	PVOID Block;
 	PPOOL_HEADER Entry;
 	PPOOL_LOOKASIDE_LIST LookasideList;
-	PPOOL_HEADER NextEntry;
 	PPOOL_HEADER SplitEntry;
 	PPOOL_DESCRIPTOR PoolDesc = &m_NonPagedPoolDescriptor;
-	ULONG Index;
 	ULONG ListNumber;
 	ULONG NeededSize;
-	xboxkrnl::PLIST_ENTRY ListHead;
 	ULONG NumberOfPages;
 
 	assert(Size);
@@ -115,18 +115,17 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 
 	if (NeededSize <= POOL_SMALL_LISTS) {
 
-		// Small size requested, try to use a lookaside list to satisfy the allocation. ergo720: however, on Windows NT lookaside lists
-		// are first created with ExXxxLookasideListEx and ExXxxLookasideList, which are not exported by the Xbox kernel and are likely
-		// not present. If so, then lookaside lists are never created and the following is likely dead code...
+		// Small size requested, try to use a lookaside list to satisfy the allocation. The lists are refilled in batches by the
+		// allocations that miss them, so that most of the small allocations don't need to acquire the critical section
 
 		LookasideList = &m_ExpSmallNPagedPoolLookasideLists[NeededSize - 1];
-		LookasideList->TotalAllocates += 1;
+		InterlockedIncrement(reinterpret_cast<volatile LONG*>(&LookasideList->TotalAllocates));
 
 		Entry = reinterpret_cast<PPOOL_HEADER>(xboxkrnl::KRNL(InterlockedPopEntrySList(&LookasideList->ListHead)));
 
 		if (Entry != nullptr) {
 			Entry -= 1;
-			LookasideList->AllocateHits += 1;
+			InterlockedIncrement(reinterpret_cast<volatile LONG*>(&LookasideList->AllocateHits));
 
 			Entry->PoolType = static_cast<UCHAR>(1);
 			MARK_POOL_HEADER_ALLOCATED(Entry);
@@ -141,11 +140,56 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 	Lock();
 
 	PoolDesc->RunningAllocs += 1;
-	ListHead = &PoolDesc->ListHeads[ListNumber];
 
 	// We failed to satisfy the request with a lookaside list, but the size is smaller then 4056 bytes. Try to use a pool descriptor for
 	// the allocation
 
+	Entry = AllocateBlock(NeededSize);
+
+	if (Entry == nullptr) {
+		EmuLog(LOG_LEVEL::WARNING, "AllocatePool returns nullptr");
+		Unlock();
+
+		RETURN(reinterpret_cast<VAddr>(Entry));
+	}
+
+	if (NeededSize <= POOL_SMALL_LISTS) {
+
+		// Since we already own the critical section, also carve the blocks of the next allocations of this size and push them to the
+		// lookaside list. The blocks stay allocated for the pool descriptor while they sit in the list
+
+		AdjustLookasideDepth(LookasideList);
+
+		while (QUERY_DEPTH_SLIST(&LookasideList->ListHead) < (LookasideList->Depth / 2)) {
+			SplitEntry = AllocateBlock(NeededSize);
+			if (SplitEntry == nullptr) {
+				break;
+			}
+
+			MARK_POOL_HEADER_FREED(SplitEntry);
+			SplitEntry += 1;
+			xboxkrnl::KRNL(InterlockedPushEntrySList)(&LookasideList->ListHead, reinterpret_cast<xboxkrnl::PSINGLE_LIST_ENTRY>(SplitEntry));
+		}
+	}
+
+	Unlock();
+
+	Entry->PoolTag = Tag;
+	(reinterpret_cast<PULONGLONG>((reinterpret_cast<PCHAR>(Entry) + POOL_OVERHEAD)))[0] = 0;
+
+	RETURN(reinterpret_cast<VAddr>(Entry) + POOL_OVERHEAD);
+}
+
+PPOOL_HEADER PoolManager::AllocateBlock(ULONG NeededSize)
+{
+	PVOID Block;
+	PPOOL_HEADER Entry;
+	PPOOL_HEADER NextEntry;
+	PPOOL_HEADER SplitEntry;
+	PPOOL_DESCRIPTOR PoolDesc = &m_NonPagedPoolDescriptor;
+	ULONG Index;
+	xboxkrnl::PLIST_ENTRY ListHead = &PoolDesc->ListHeads[NeededSize];
+
 	do {
 		do {
 			if (IsListEmpty(ListHead) == false) {
@@ -189,12 +233,7 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 
 				MARK_POOL_HEADER_ALLOCATED(Entry);
 
-				Unlock();
-
-				Entry->PoolTag = Tag;
-				(reinterpret_cast<PULONGLONG>((reinterpret_cast<PCHAR>(Entry) + POOL_OVERHEAD)))[0] = 0;
-
-				RETURN(reinterpret_cast<VAddr>(Entry) + POOL_OVERHEAD);
+				return Entry;
 			}
 			ListHead += 1;
 
@@ -205,10 +244,7 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 		Entry = reinterpret_cast<PPOOL_HEADER>(g_VMManager.AllocateSystemMemory(PoolType, XBOX_PAGE_READWRITE, PAGE_SIZE, false));
 
 		if (Entry == nullptr) {
-			EmuLog(LOG_LEVEL::WARNING, "AllocatePool returns nullptr");
-			Unlock();
-
-			RETURN(reinterpret_cast<VAddr>(Entry));
+			return nullptr;
 		}
 		PoolDesc->TotalPages += 1;
 		Entry->PoolType = 0;
@@ -228,6 +264,29 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 	} while (true);
 }
 
+void PoolManager::AdjustLookasideDepth(PPOOL_LOOKASIDE_LIST LookasideList)
+{
+	ULONG Allocates = LookasideList->TotalAllocates - LookasideList->LastTotalAllocates;
+	ULONG Misses = Allocates - (LookasideList->AllocateHits - LookasideList->LastAllocateHits);
+
+	if (Allocates < POOL_LOOKASIDE_ADJUST_PERIOD) {
+		return;
+	}
+
+	// Grow the list quickly when more than 1/8 of the allocations missed it, and shrink it slowly when they all hit it
+
+	if ((Misses * 8) > Allocates) {
+		LookasideList->Depth = static_cast<USHORT>((LookasideList->Depth * 2) < POOL_LOOKASIDE_MAXIMUM_DEPTH ?
+			(LookasideList->Depth * 2) : POOL_LOOKASIDE_MAXIMUM_DEPTH);
+	}
+	else if (Misses == 0 && LookasideList->Depth > POOL_LOOKASIDE_MINIMUM_DEPTH) {
+		LookasideList->Depth -= 1;
+	}
+
+	LookasideList->LastTotalAllocates = LookasideList->TotalAllocates;
+	LookasideList->LastAllocateHits = LookasideList->AllocateHits;
+}
+
 void PoolManager::DeallocatePool(VAddr addr)
 {
 	LOG_FUNC_ONE_ARG(addr);
@@ -270,8 +329,10 @@ void PoolManager::DeallocatePool(VAddr addr)
 
 	if (Index <= POOL_SMALL_LISTS) {
 		LookasideList = &m_ExpSmallNPagedPoolLookasideLists[Index - 1];
+		InterlockedIncrement(reinterpret_cast<volatile LONG*>(&LookasideList->TotalFrees));
 
 		if (QUERY_DEPTH_SLIST(&LookasideList->ListHead) < LookasideList->Depth) {
+			InterlockedIncrement(reinterpret_cast<volatile LONG*>(&LookasideList->FreeHits));
 			Entry += 1;
 			xboxkrnl::KRNL(InterlockedPushEntrySList)(&LookasideList->ListHead, reinterpret_cast<xboxkrnl::PSINGLE_LIST_ENTRY>(Entry));
 
@@ -348,9 +409,28 @@ size_t PoolManager::QueryPoolSize(VAddr addr)
 	RETURN(size);
 }
 
+void PoolManager::PrintPoolStats()
+{
+	PPOOL_LOOKASIDE_LIST Lookaside;
+
+	printf("Pool Allocations: %u, Deallocations: %u, Pages: %u, Big Pages: %u\n", m_NonPagedPoolDescriptor.RunningAllocs,
+		m_NonPagedPoolDescriptor.RunningDeAllocs, m_NonPagedPoolDescriptor.TotalPages, m_NonPagedPoolDescriptor.TotalBigPages);
+	printf("Pool Lock Acquires: %u, Contended: %u\n", m_LockAcquires, m_LockContentions);
+
+	for (ULONG Index = 0; Index < POOL_SMALL_LISTS; Index++) {
+		Lookaside = &m_ExpSmallNPagedPoolLookasideLists[Index];
+		printf("- Lookaside %u bytes: depth %u, allocates %u (hits %u), frees %u (hits %u)\n", (Index + 1) << POOL_BLOCK_SHIFT,
+			Lookaside->Depth, Lookaside->TotalAllocates, Lookaside->AllocateHits, Lookaside->TotalFrees, Lookaside->FreeHits);
+	}
+}
+
 void PoolManager::Lock()
 {
-	EnterCriticalSection(&m_CriticalSection);
+	if (TryEnterCriticalSection(&m_CriticalSection) == FALSE) {
+		EnterCriticalSection(&m_CriticalSection);
+		m_LockContentions += 1;
+	}
+	m_LockAcquires += 1;
 }
 
 void PoolManager::Unlock()
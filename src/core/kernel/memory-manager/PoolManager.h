@@ -35,6 +35,9 @@
 #define POOL_LIST_HEADS (PAGE_SIZE / (1 << POOL_BLOCK_SHIFT)) // 0x80
 #define POOL_SMALL_LISTS 8
 #define POOL_TYPE_MASK 3
+#define POOL_LOOKASIDE_MINIMUM_DEPTH 2
+#define POOL_LOOKASIDE_MAXIMUM_DEPTH 64
+#define POOL_LOOKASIDE_ADJUST_PERIOD 64 // number of allocations between two adjustments of the depth of a lookaside list
 
 
 typedef struct _POOL_DESCRIPTOR {
@@ -52,6 +55,10 @@ typedef struct _POOL_LOOKASIDE_LIST {
 	USHORT Padding;
 	ULONG TotalAllocates;
 	ULONG AllocateHits;
+	ULONG TotalFrees;
+	ULONG FreeHits;
+	ULONG LastTotalAllocates;
+	ULONG LastAllocateHits;
 } POOL_LOOKASIDE_LIST, *PPOOL_LOOKASIDE_LIST;
 
 
@@ -98,6 +105,8 @@ class PoolManager
 		void DeallocatePool(VAddr addr);
 		// queries the pool block size
 		size_t QueryPoolSize(VAddr addr);
+		// prints the allocation and contention counters of the pool
+		void PrintPoolStats();
 
 
 	private:
@@ -107,12 +116,20 @@ class PoolManager
 		POOL_LOOKASIDE_LIST m_ExpSmallNPagedPoolLookasideLists[POOL_SMALL_LISTS];
 		// critical section lock to synchronize accesses
 		CRITICAL_SECTION m_CriticalSection;
+		// number of times the critical section was acquired
+		ULONG m_LockAcquires = 0;
+		// number of times the critical section was already owned by another thread when acquiring it
+		ULONG m_LockContentions = 0;
 	
 	
 		// acquires the critical section
 		void Lock();
 		// releases the critical section
 		void Unlock();
+		// allocates a block from the pool descriptor, the critical section must be held
+		PPOOL_HEADER AllocateBlock(ULONG NeededSize);
+		// adapts the depth of a lookaside list to its recent hit rate, the critical section must be held
+		void AdjustLookasideDepth(PPOOL_LOOKASIDE_LIST LookasideList);
 };
 
 
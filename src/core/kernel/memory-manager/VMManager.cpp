@@ -134,6 +134,7 @@ void VMManager::Initialize(unsigned int SystemType, int BootFlags, blocks_reserv
 		m_HighestPage = CHIHIRO_HIGHEST_PHYSICAL_PAGE;
 		m_NV2AInstancePage = CHIHIRO_INSTANCE_PHYSICAL_PAGE;
 		m_MemoryRegionArray[ContiguousRegion].RegionMap[CONTIGUOUS_MEMORY_BASE].size = CHIHIRO_CONTIGUOUS_MEMORY_SIZE;
+		m_MemoryRegionArray[ContiguousRegion].FreeAreas.Resize(CONTIGUOUS_MEMORY_BASE, CHIHIRO_CONTIGUOUS_MEMORY_SIZE);
 	}
 	else if (m_MmLayoutDebug)
 	{
@@ -141,6 +142,7 @@ void VMManager::Initialize(unsigned int SystemType, int BootFlags, blocks_reserv
 		m_DebuggerPagesAvailable = X64M_PHYSICAL_PAGE;
 		m_HighestPage = CHIHIRO_HIGHEST_PHYSICAL_PAGE;
 		m_MemoryRegionArray[ContiguousRegion].RegionMap[CONTIGUOUS_MEMORY_BASE].size = CHIHIRO_CONTIGUOUS_MEMORY_SIZE;
+		m_MemoryRegionArray[ContiguousRegion].FreeAreas.Resize(CONTIGUOUS_MEMORY_BASE, CHIHIRO_CONTIGUOUS_MEMORY_SIZE);
 
 		// Note that even if this is true, only the heap/Nt functions of the title are affected, the Mm functions
 		// will still use only the lower 64 MiB and the same is true for the debugger pages, meaning they will only
@@ -148,13 +150,8 @@ void VMManager::Initialize(unsigned int SystemType, int BootFlags, blocks_reserv
 		if (CxbxKrnl_Xbe->m_Header.dwInitFlags.bLimit64MB) { m_bAllowNonDebuggerOnTop64MiB = false; }
 	}
 
-	// Insert all the pages available on the system in the free list
-	xboxkrnl::PLIST_ENTRY ListEntry = FreeList.Blink;
-	PFreeBlock block = new FreeBlock;
-	block->start = 0;
-	block->size = m_HighestPage + 1;
-	block->ListEntry.Flink = block->ListEntry.Blink = nullptr; // Was LIST_ENTRY_INITIALIZE()
-	InsertHeadList(ListEntry, &block->ListEntry);
+	// Mark all the pages available on the system as free
+	m_FreePages.SetFree(0, m_HighestPage);
 
 	if ((BootFlags & BOOT_QUICK_REBOOT) == 0) {
 		InitializeSystemAllocations();
@@ -188,6 +185,7 @@ void VMManager::ConstructMemoryRegion(VAddr Start, size_t Size, MemoryRegionType
 	vma.base = Start;
 	vma.size = Size;
 	m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.emplace(Start, vma).first;
+	m_MemoryRegionArray[Type].FreeAreas.Insert(Start, Size);
 }
 
 void VMManager::DestroyMemoryRegions()
@@ -2050,141 +2048,92 @@ xboxkrnl::NTSTATUS VMManager::XbVirtualMemoryStatistics(VAddr addr, xboxkrnl::PM
 VAddr VMManager::MapMemoryBlock(MemoryRegionType Type, PFN_COUNT PteNumber, DWORD Permissions, bool b64Blocks, VAddr HighestAddress)
 {
 	VAddr addr;
-	VMAIter it = m_MemoryRegionArray[Type].LastFree;
+	VAddr VmaBase;
+	size_t VmaSize;
 	size_t Size = PteNumber << PAGE_SHIFT;
+	FreeAreaIndex& FreeAreas = m_MemoryRegionArray[Type].FreeAreas;
 
+	// The free vma's too small for the block are skipped by the index, so this only visits the candidates that
+	// fit, in the same order as a walk of the vma map from the LastFree iterator would
 
-	VMAIter end_it = m_MemoryRegionArray[Type].RegionMap.end();
+	VAddr LastFreeBase = (m_MemoryRegionArray[Type].LastFree == m_MemoryRegionArray[Type].RegionMap.end()) ?
+		MAXUINT_PTR : m_MemoryRegionArray[Type].LastFree->first;
 
-	if (HighestAddress) // XbAllocateVirtualMemory specific
-	{
-		end_it = std::next(GetVMAIterator(HighestAddress, Type));
-	}
+	VAddr SearchEnd = HighestAddress ? HighestAddress + 1 : MAXUINT_PTR; // XbAllocateVirtualMemory specific
 
-	while (it != end_it)
+	VAddr SearchStart = LastFreeBase;
+	while (FreeAreas.FindFirst(SearchStart, SearchEnd, Size, &VmaBase, &VmaSize))
 	{
-		if (it->second.type != FreeVma) // already allocated by the VMManager
-		{
-			++it;
-			continue;
-		}
-		addr = it->first;
-		if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity)) // free vma
-		{
-			// addr is not aligned with the granularity of the host, jump to the next granularity boundary
-
-			addr = ROUND_UP(addr, m_AllocationGranularity);
-		}
-
-		if (Permissions == 0xFFFFFFFF) {
-			if (addr + Size - 1 < it->first + it->second.size) {
-				return addr;
-			}
-			++it;
-			continue;
-		}
-
 		// Note that, even in free regions, somebody outside the manager could have allocated the memory so we just
 		// keep on trying until we succeed or fail entirely.
 
 		size_t vma_end;
-		if (HighestAddress && (it->first + it->second.size > HighestAddress + 1)) { vma_end = HighestAddress + 1; }
-		else { vma_end = it->first + it->second.size; }
-
-		if (b64Blocks) {
-			if (addr + Size - 1 < vma_end) {
-				// The memory was reserved by the loader, commit it in 64kb blocks
-				VAddr start_addr = addr;
-				size_t start_size = 0;
-				while (addr < vma_end) {
-					addr = MapHostMemory(addr, m_AllocationGranularity, vma_end, Permissions);
-					assert(addr);
-					start_size += m_AllocationGranularity;
-					if (start_size >= Size) {
-						return start_addr;
-					}
-					addr += m_AllocationGranularity;
-				}
-				assert(0);
-			}
-		}
-		else {
-			addr = MapHostMemory(addr, Size, vma_end, Permissions);
-			if (addr) { return addr; }
-		}
+		if (HighestAddress && (VmaBase + VmaSize > HighestAddress + 1)) { vma_end = HighestAddress + 1; }
+		else { vma_end = VmaBase + VmaSize; }
+
+		addr = MapFreeVMA(VmaBase, VmaSize, vma_end, Size, Permissions, b64Blocks);
+		if (addr) { return addr; }
 
-		++it;
+		SearchStart = VmaBase + 1;
 	}
 
 	// If we are here, it means we reached the end of the memory region. In desperation, we also try to map it from the
 	// LastFree iterator and going backwards, since there could be holes created by deallocation operations...
 
-	VMAIter begin_it = m_MemoryRegionArray[Type].RegionMap.begin();
-
-	if (m_MemoryRegionArray[Type].LastFree == begin_it)
+	VAddr SearchLimit = LastFreeBase;
+	while (FreeAreas.FindLast(0, SearchLimit, Size, &VmaBase, &VmaSize))
 	{
-		// We are already at the beginning of the map, so bail out immediately
+		addr = MapFreeVMA(VmaBase, VmaSize, VmaBase + VmaSize, Size, Permissions, b64Blocks);
+		if (addr) { return addr; }
 
-		EmuLog(LOG_LEVEL::WARNING, "Failed to map a memory block in the virtual region %d!", Type);
-		return NULL;
+		SearchLimit = VmaBase;
 	}
 
-	it = std::prev(m_MemoryRegionArray[Type].LastFree);
+	// We have failed to map the block. This is likely because the virtual space is fragmented or there are too many
+	// host allocations in the memory region. Log this error and bail out
 
-	while (true)
-	{
-		if (it->second.type == FreeVma)
-		{
-			addr = it->first;
+	EmuLog(LOG_LEVEL::WARNING, "Failed to map a memory block in the virtual region %d!", Type);
 
-			if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity))
-			{
-				addr = ROUND_UP(addr, m_AllocationGranularity);
-			}
+	return NULL;
+}
 
-			size_t vma_end = it->first + it->second.size;
+VAddr VMManager::MapFreeVMA(VAddr Base, size_t VmaSize, size_t VmaEnd, size_t Size, DWORD Permissions, bool b64Blocks)
+{
+	VAddr addr = Base;
+	if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity))
+	{
+		// addr is not aligned with the granularity of the host, jump to the next granularity boundary
 
-			if (Permissions == 0xFFFFFFFF) {
-				if (addr + Size - 1 < vma_end) {
-					return addr;
-				}
-				--it;
-				continue;
-			}
+		addr = ROUND_UP(addr, m_AllocationGranularity);
+	}
 
-			if (b64Blocks) {
-				if (addr + Size - 1 < vma_end) {
-					// The memory was reserved by the loader, commit it in 64kb blocks
-					VAddr start_addr = addr;
-					size_t start_size = 0;
-					while (addr < vma_end) {
-						addr = MapHostMemory(addr, m_AllocationGranularity, vma_end, Permissions);
-						assert(addr);
-						start_size += m_AllocationGranularity;
-						if (start_size >= Size) {
-							return start_addr;
-						}
-						addr += m_AllocationGranularity;
-					}
-					assert(0);
+	if (Permissions == 0xFFFFFFFF) {
+		if (addr + Size - 1 < Base + VmaSize) {
+			return addr;
+		}
+		return NULL;
+	}
+
+	if (b64Blocks) {
+		if (addr + Size - 1 < VmaEnd) {
+			// The memory was reserved by the loader, commit it in 64kb blocks
+			VAddr start_addr = addr;
+			size_t start_size = 0;
+			while (addr < VmaEnd) {
+				addr = MapHostMemory(addr, m_AllocationGranularity, VmaEnd, Permissions);
+				assert(addr);
+				start_size += m_AllocationGranularity;
+				if (start_size >= Size) {
+					return start_addr;
 				}
-			}
-			else {
-				addr = MapHostMemory(addr, Size, vma_end, Permissions);
-				if (addr) { return addr; }
+				addr += m_AllocationGranularity;
 			}
+			assert(0);
 		}
-
-		if (it == begin_it) { break; }
-		--it;
+		return NULL;
 	}
 
-	// We have failed to map the block. This is likely because the virtual space is fragmented or there are too many
-	// host allocations in the memory region. Log this error and bail out
-
-	EmuLog(LOG_LEVEL::WARNING, "Failed to map a memory block in the virtual region %d!", Type);
-
-	return NULL;
+	return MapHostMemory(addr, Size, VmaEnd, Permissions);
 }
 
 VAddr VMManager::MapHostMemory(VAddr StartingAddr, size_t Size, size_t VmaEnd, DWORD Permissions)
@@ -2297,6 +2246,7 @@ VMAIter VMManager::UnmapVMA(VMAIter vma_handle, MemoryRegionType Type)
 	VirtualMemoryArea& vma = vma_handle->second;
 	vma.type = FreeVma;
 	vma.permissions = XBOX_PAGE_NOACCESS;
+	m_MemoryRegionArray[Type].FreeAreas.Insert(vma.base, vma.size);
 
 	return MergeAdjacentVMA(vma_handle, Type);
 }
@@ -2366,6 +2316,20 @@ VMAIter VMManager::GetVMAIterator(VAddr target, MemoryRegionType Type)
 	return std::prev(m_MemoryRegionArray[Type].RegionMap.upper_bound(target));
 }
 
+VMAIter VMManager::GetNearestFreeVMA(VAddr target, MemoryRegionType Type)
+{
+	VAddr FreeBase;
+	size_t FreeSize;
+
+	if (m_MemoryRegionArray[Type].FreeAreas.FindFirst(target, MAXUINT_PTR, 1, &FreeBase, &FreeSize) ||
+		m_MemoryRegionArray[Type].FreeAreas.FindLast(0, target, 1, &FreeBase, &FreeSize))
+	{
+		return m_MemoryRegionArray[Type].RegionMap.find(FreeBase);
+	}
+
+	return m_MemoryRegionArray[Type].RegionMap.end();
+}
+
 VMAIter VMManager::SplitVMA(VMAIter vma_handle, u32 offset_in_vma, MemoryRegionType Type)
 {
 	VirtualMemoryArea& old_vma = vma_handle->second;
@@ -2379,6 +2343,12 @@ VMAIter VMManager::SplitVMA(VMAIter vma_handle, u32 offset_in_vma, MemoryRegionT
 	new_vma.base += offset_in_vma;
 	new_vma.size -= offset_in_vma;
 
+	if (old_vma.type == FreeVma)
+	{
+		m_MemoryRegionArray[Type].FreeAreas.Resize(old_vma.base, old_vma.size);
+		m_MemoryRegionArray[Type].FreeAreas.Insert(new_vma.base, new_vma.size);
+	}
+
 	// add the new splitted vma to m_Vma_map
 	return m_MemoryRegionArray[Type].RegionMap.emplace_hint(std::next(vma_handle), new_vma.base, new_vma);
 }
@@ -2389,6 +2359,8 @@ VMAIter VMManager::MergeAdjacentVMA(VMAIter vma_handle, MemoryRegionType Type)
 	if (next_vma != m_MemoryRegionArray[Type].RegionMap.end() && vma_handle->second.CanBeMergedWith(next_vma->second))
 	{
 		vma_handle->second.size += next_vma->second.size;
+		m_MemoryRegionArray[Type].FreeAreas.Erase(next_vma->first);
+		m_MemoryRegionArray[Type].FreeAreas.Resize(vma_handle->first, vma_handle->second.size);
 		m_MemoryRegionArray[Type].RegionMap.erase(next_vma);
 	}
 
@@ -2398,6 +2370,8 @@ VMAIter VMManager::MergeAdjacentVMA(VMAIter vma_handle, MemoryRegionType Type)
 		if (prev_vma->second.CanBeMergedWith(vma_handle->second))
 		{
 			prev_vma->second.size += vma_handle->second.size;
+			m_MemoryRegionArray[Type].FreeAreas.Erase(vma_handle->first);
+			m_MemoryRegionArray[Type].FreeAreas.Resize(prev_vma->first, prev_vma->second.size);
 			m_MemoryRegionArray[Type].RegionMap.erase(vma_handle);
 			vma_handle = prev_vma;
 		}
@@ -2447,58 +2421,21 @@ VMAIter VMManager::CheckConflictingVMA(VAddr addr, size_t Size, MemoryRegionType
 
 void VMManager::ConstructVMA(VAddr Start, size_t Size, MemoryRegionType Type, VMAType VmaType, DWORD Perms)
 {
-	VMAIter it_begin = m_MemoryRegionArray[Type].RegionMap.begin();
-	VMAIter it_end = m_MemoryRegionArray[Type].RegionMap.end();
-	VMAIter it;
-
 	VMAIter vma_handle = CarveVMA(Start, Size, Type);
 	VirtualMemoryArea& vma = vma_handle->second;
 	vma.type = VmaType;
 	vma.permissions = Perms;
+	if (VmaType != FreeVma) { m_MemoryRegionArray[Type].FreeAreas.Erase(vma.base); }
 
 	// Depending on the splitting done by CarveVMA and the type of the adiacent vma's, there is no guarantee that the next
-	// or previous vma's are free. We are just going to iterate forward and backward until we find one.
+	// or previous vma's are free. We are just going to look for the nearest one, preferring the ones after this vma.
 
-	it = std::next(vma_handle);
+	m_MemoryRegionArray[Type].LastFree = GetNearestFreeVMA(vma.base + 1, Type);
 
-	while (it != it_end)
+	if (m_MemoryRegionArray[Type].LastFree == m_MemoryRegionArray[Type].RegionMap.end())
 	{
-		if (it->second.type == FreeVma)
-		{
-			m_MemoryRegionArray[Type].LastFree = it;
-			return;
-		}
-		++it;
-	}
-
-	if (vma_handle == it_begin)
-	{
-		// Already at the beginning of the map, bail out immediately
-
 		EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
-		m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
-		return;
 	}
-
-	it = std::prev(vma_handle);
-
-	while (true)
-	{
-		if (it->second.type == FreeVma)
-		{
-			m_MemoryRegionArray[Type].LastFree = it;
-			return;
-		}
-
-		if (it == it_begin) { break; }
-		--it;
-	}
-
-	EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
-
-	m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
-
-	return;
 }
 
 void VMManager::DestructVMA(VAddr addr, MemoryRegionType Type, size_t Size)
@@ -2557,36 +2494,13 @@ void VMManager::DestructVMA(VAddr addr, MemoryRegionType Type, size_t Size)
 	{
 		EmuLog(LOG_LEVEL::DEBUG, "std::prev(CarvedVmaIt) was not free");
 
-		it = CarvedVmaIt;
+		m_MemoryRegionArray[Type].LastFree = GetNearestFreeVMA((CarvedVmaIt != it_end) ? CarvedVmaIt->first : MAXUINT_PTR, Type);
 
-		while (it != it_end)
+		if (m_MemoryRegionArray[Type].LastFree == it_end)
 		{
-			if (it->second.type == FreeVma)
-			{
-				m_MemoryRegionArray[Type].LastFree = it;
-				return;
-			}
-			++it;
+			EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
 		}
 
-		it = std::prev(CarvedVmaIt);
-
-		while (true)
-		{
-			if (it->second.type == FreeVma)
-			{
-				m_MemoryRegionArray[Type].LastFree = it;
-				return;
-			}
-
-			if (it == it_begin) { break; }
-			--it;
-		}
-
-		EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
-
-		m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
-
 		return;
 	}
 }
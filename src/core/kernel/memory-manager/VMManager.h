@@ -29,6 +29,7 @@
 #define VMMANAGER_H
 
 #include "PhysicalMemory.h"
+#include "FreeAreaIndex.h"
 
 
 /* VMATypes */
@@ -67,6 +68,8 @@ typedef struct _MemoryRegion
 {
 	VMAIter LastFree;
 	std::map<VAddr, VirtualMemoryArea> RegionMap;
+	// the free vma's of RegionMap, kept in sync by the functions that split, merge or change the type of a vma
+	FreeAreaIndex FreeAreas;
 }MemoryRegion, *PMemoryRegion;
 
 
@@ -176,6 +179,8 @@ class VMManager : public PhysicalMemory
 		void DestroyMemoryRegions();
 		// map a memory block with the supplied allocation routine
 		VAddr MapMemoryBlock(MemoryRegionType Type, PFN_COUNT PteNumber, DWORD Permissions, bool b64Blocks, VAddr HighestAddress = 0);
+		// tries to map a memory block inside the given free vma
+		VAddr MapFreeVMA(VAddr Base, size_t VmaSize, size_t VmaEnd, size_t Size, DWORD Permissions, bool b64Blocks);
 		// helper function which allocates user memory with VirtualAlloc
 		VAddr MapHostMemory(VAddr StartingAddr, size_t Size, size_t VmaEnd, DWORD Permissions);
 		// constructs a vma
@@ -190,6 +195,8 @@ class VMManager : public PhysicalMemory
 		VMAIter CarveVMARange(VAddr base, size_t size, MemoryRegionType Type);
 		// gets the iterator of a vma in the specified memory region
 		VMAIter GetVMAIterator(VAddr target, MemoryRegionType Type);
+		// gets the first free vma at or after target, or the last one before it if there are none
+		VMAIter GetNearestFreeVMA(VAddr target, MemoryRegionType Type);
 		// splits a parent vma into two children
 		VMAIter SplitVMA(VMAIter vma_handle, u32 offset_in_vma, MemoryRegionType Type);
 		// merges the specified vma with adjacent ones if possible
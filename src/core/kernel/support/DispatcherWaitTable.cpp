@@ -0,0 +1,162 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "DispatcherWaitTable.h"
+
+void DispatcherWaitTable::Remove(Waiter &W)
+{
+	for (void *Object : W.Objects) {
+		auto range = m_Objects.equal_range(Object);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == &W) {
+				m_Objects.erase(it);
+				break;
+			}
+		}
+	}
+
+	auto thread = m_Threads.find(W.ThreadId);
+	if (thread != m_Threads.end() && thread->second == &W) {
+		m_Threads.erase(thread);
+	}
+
+	m_Registered.fetch_sub(W.Objects.size());
+	W.Objects.clear();
+}
+
+void DispatcherWaitTable::Register(Waiter &W, uint32_t ThreadId, void *const Objects[], size_t Count, void *TimerObject, bool WaitAll)
+{
+	std::lock_guard<std::mutex> lock(m_Mtx);
+
+	// Drop what a wait that left through an exception (like STATUS_MUTANT_LIMIT_EXCEEDED) registered
+	Remove(W);
+
+	W.ThreadId = ThreadId;
+	W.WaitAll = WaitAll;
+	W.Woken = false;
+	W.PulsedObject = nullptr;
+	W.Objects.assign(Objects, Objects + Count);
+	if (TimerObject != nullptr) {
+		W.Objects.push_back(TimerObject);
+	}
+
+	for (void *Object : W.Objects) {
+		m_Objects.emplace(Object, &W);
+	}
+	m_Threads[ThreadId] = &W;
+
+	// A locked increment is a full barrier : the caller re-reads the signal states after this, and
+	// NoWaiters fences between the signal state write of its caller and its read of the count
+	m_Registered.fetch_add(W.Objects.size());
+}
+
+void DispatcherWaitTable::Unregister(Waiter &W)
+{
+	std::lock_guard<std::mutex> lock(m_Mtx);
+	Remove(W);
+}
+
+void DispatcherWaitTable::Park(Waiter &W)
+{
+	std::unique_lock<std::mutex> lock(m_Mtx);
+	W.Cv.wait(lock, [&W] { return W.Woken; });
+	W.Woken = false;
+}
+
+void *DispatcherWaitTable::TakePulse(Waiter &W)
+{
+	std::lock_guard<std::mutex> lock(m_Mtx);
+	void *Object = W.PulsedObject;
+	W.PulsedObject = nullptr;
+	return Object;
+}
+
+void DispatcherWaitTable::Ready(Waiter &W)
+{
+	W.Woken = true;
+	W.Cv.notify_one();
+}
+
+bool DispatcherWaitTable::NoWaiters() const
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return m_Registered.load(std::memory_order_relaxed) == 0;
+}
+
+unsigned DispatcherWaitTable::Wake(void *Object)
+{
+	if (NoWaiters()) {
+		return 0;
+	}
+
+	unsigned Readied = 0;
+	std::lock_guard<std::mutex> lock(m_Mtx);
+	auto range = m_Objects.equal_range(Object);
+	for (auto it = range.first; it != range.second; ++it) {
+		Ready(*it->second);
+		Readied++;
+	}
+
+	return Readied;
+}
+
+unsigned DispatcherWaitTable::Pulse(void *Object, bool WakeAll)
+{
+	if (NoWaiters()) {
+		return 0;
+	}
+
+	unsigned Readied = 0;
+	std::lock_guard<std::mutex> lock(m_Mtx);
+	auto range = m_Objects.equal_range(Object);
+	for (auto it = range.first; it != range.second; ++it) {
+		Waiter &W = *it->second;
+		// Waits for all objects, and waiters satisfied by another pulse they haven't consumed yet, can't take it
+		if (W.WaitAll || W.PulsedObject != nullptr) {
+			continue;
+		}
+
+		W.PulsedObject = Object;
+		Ready(W);
+		Readied++;
+		if (!WakeAll) {
+			break;
+		}
+	}
+
+	return Readied;
+}
+
+bool DispatcherWaitTable::WakeThread(uint32_t ThreadId)
+{
+	std::lock_guard<std::mutex> lock(m_Mtx);
+	auto thread = m_Threads.find(ThreadId);
+	if (thread == m_Threads.end()) {
+		return false;
+	}
+
+	Ready(*thread->second);
+	return true;
+}
@@ -0,0 +1,87 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef DISPATCHERWAITTABLE_H
+#define DISPATCHERWAITTABLE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// ******************************************************************
+// * Host side wait queues of the dispatcher objects. A thread that
+// * can't satisfy its wait registers under each object it waits on and
+// * parks, and whoever changes the signal state of an object wakes the
+// * threads registered on it, which then re-evaluate their wait.
+// * It only depends on the standard library, so that it can be built
+// * and tested outside of the emulator
+// ******************************************************************
+class DispatcherWaitTable
+{
+public:
+	// One per thread, it must stay alive while registered
+	struct Waiter {
+		std::condition_variable Cv;
+		std::vector<void *> Objects;
+		uint32_t ThreadId = 0;
+		void *PulsedObject = nullptr; // Set when a pulse readied this waiter, see Pulse
+		bool WaitAll = false;
+		bool Woken = false;
+	};
+
+	// Registers the waiter under each object, the timer object (when not null) and its thread id, replacing
+	// what it registered before. The caller re-checks the signal states after this, and only then parks
+	void Register(Waiter &W, uint32_t ThreadId, void *const Objects[], size_t Count, void *TimerObject, bool WaitAll);
+	void Unregister(Waiter &W);
+	// Blocks until the waiter is woken, and consumes the wake
+	void Park(Waiter &W);
+	// Returns the object of the pulse that readied the waiter, or null, and consumes it
+	void *TakePulse(Waiter &W);
+
+	// Wakes every waiter of an object whose signal state changed, returns how many were woken
+	unsigned Wake(void *Object);
+	// Readies the waiters of an object whose signal state is reset right after (KePulseEvent): all of them,
+	// or only the first one that the pulse satisfies. Waits for all objects can't be satisfied by a pulse,
+	// since the object is already unsignalled again when they re-check it, so those are passed over
+	unsigned Pulse(void *Object, bool WakeAll);
+	// Wakes a thread for something that isn't an object, like an alert or an apc. False when it isn't waiting
+	bool WakeThread(uint32_t ThreadId);
+
+private:
+	// Must be called with m_Mtx held
+	void Remove(Waiter &W);
+	static void Ready(Waiter &W);
+	// Fenced, so that a signal state written before it is visible to a waiter registered after it
+	bool NoWaiters() const;
+
+	std::mutex m_Mtx;
+	std::unordered_multimap<void *, Waiter *> m_Objects;
+	std::unordered_map<uint32_t, Waiter *> m_Threads;
+	std::atomic<size_t> m_Registered { 0 }; // Lets signalling skip the lock when nobody waits
+};
+
+#endif
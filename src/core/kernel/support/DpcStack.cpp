@@ -0,0 +1,86 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "DpcStack.h"
+
+bool DpcStack::Claim(DpcState &State)
+{
+	char Expected = DPC_NOT_INSERTED;
+	return State.compare_exchange_strong(Expected, DPC_INSERTING);
+}
+
+void DpcStack::Push(DpcState &State, DpcLink &Link, uintptr_t Stamp)
+{
+	// Publishes the arguments written since the claim
+	State.store(DPC_INSERTED);
+
+	uintptr_t Expected = 0;
+	if (!Link.Stamp.compare_exchange_strong(Expected, Stamp | 1)) {
+		return;
+	}
+
+	DpcLink *Head = m_Pending.load(std::memory_order_relaxed);
+	do {
+		Link.Next.store(Head, std::memory_order_relaxed);
+	} while (!m_Pending.compare_exchange_weak(Head, &Link, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool DpcStack::Remove(DpcState &State)
+{
+	char Expected = DPC_INSERTED;
+	return State.compare_exchange_strong(Expected, DPC_NOT_INSERTED);
+}
+
+DpcLink *DpcStack::TakeAll()
+{
+	DpcLink *Link = m_Pending.exchange(nullptr, std::memory_order_acquire);
+
+	// The stack holds them newest first
+	DpcLink *Reversed = nullptr;
+	while (Link != nullptr) {
+		DpcLink *Next = Link->Next.load(std::memory_order_relaxed);
+		Link->Next.store(Reversed, std::memory_order_relaxed);
+		Reversed = Link;
+		Link = Next;
+	}
+
+	return Reversed;
+}
+
+uintptr_t DpcStack::Unlink(DpcLink &Link)
+{
+	return Link.Stamp.exchange(0);
+}
+
+bool DpcStack::Retire(DpcState &State)
+{
+	// Races with Remove, only one of them sees the dpc inserted
+	return Remove(State);
+}
+
+void DpcStack::Clear()
+{
+	m_Pending = nullptr;
+}
@@ -0,0 +1,81 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef DPCSTACK_H
+#define DPCSTACK_H
+
+#include <atomic>
+#include <cstdint>
+
+// Values of KDPC::Inserted : a dpc being inserted is already owned by the inserting thread, but its arguments
+// are not written yet, so it can't be run nor removed
+#define DPC_NOT_INSERTED 0
+#define DPC_INSERTED 1
+#define DPC_INSERTING 2
+
+// Overlays KDPC::DpcListEntry : Next is the Flink, Stamp the Blink
+struct DpcLink {
+	std::atomic<DpcLink *> Next;
+	std::atomic<uintptr_t> Stamp; // Non-zero while the dpc is on the stack
+};
+
+// Overlays KDPC::Inserted
+typedef std::atomic<char> DpcState;
+
+static_assert(sizeof(DpcLink) == 2 * sizeof(void *), "DpcLink must have the layout of a LIST_ENTRY");
+static_assert(sizeof(DpcState) == 1, "DpcState must have the layout of a BOOLEAN");
+
+// ******************************************************************
+// * Lock-free stack of the inserted dpc's. Any thread can insert and
+// * remove a dpc, only one thread at a time drains the stack. A removed
+// * dpc stays on the stack until the drain skips it, so a dpc is never
+// * on it twice. It only depends on the standard library, so that it
+// * can be built and tested outside of the emulator
+// ******************************************************************
+class DpcStack
+{
+public:
+	// Claims a dpc that isn't inserted, only one thread can succeed. The caller then writes its arguments and calls Push
+	static bool Claim(DpcState &State);
+	// Marks a claimed dpc as inserted, and pushes it unless it's still on the stack from an insertion that was removed.
+	// Stamp is kept in the link until the dpc runs, its low bit is forced to 1
+	void Push(DpcState &State, DpcLink &Link, uintptr_t Stamp);
+	// Cancels an insertion, false when the dpc wasn't inserted
+	static bool Remove(DpcState &State);
+
+	// Takes all the pending dpc's, in the order of their insertion. The links can be changed until each dpc is retired
+	DpcLink *TakeAll();
+	// Takes a dpc returned by TakeAll off the stack and returns its stamp. The caller must have read the next link
+	// already, since a concurrent insertion can push the dpc again from here on
+	static uintptr_t Unlink(DpcLink &Link);
+	// Marks an unlinked dpc as no longer inserted. False when it was removed, and must not run
+	static bool Retire(DpcState &State);
+
+	void Clear();
+
+private:
+	std::atomic<DpcLink *> m_Pending { nullptr };
+};
+
+#endif
@@ -640,6 +640,10 @@ void EmuGenerateFS(Xbe::TLS *pTLS, void *pTLSData)
 		Prcb->CurrentThread->Header.Type = xboxkrnl::ThreadObject;
 		Prcb->CurrentThread->Header.Size = sizeof(xboxkrnl::KTHREAD) / sizeof(xboxkrnl::LONG);
 		InitializeListHead(&Prcb->CurrentThread->Header.WaitListHead);
+		// Start with empty apc queues that accept apc's
+		InitializeListHead(&Prcb->CurrentThread->ApcState.ApcListHead[xboxkrnl::KernelMode]);
+		InitializeListHead(&Prcb->CurrentThread->ApcState.ApcListHead[xboxkrnl::UserMode]);
+		Prcb->CurrentThread->ApcState.ApcQueueable = TRUE;
 		// Also initialize the timer associated with the thread
 		xboxkrnl::KeInitializeTimer(&Prcb->CurrentThread->Timer);
 		xboxkrnl::PKWAIT_BLOCK WaitBlock = &Prcb->CurrentThread->TimerWaitBlock;
@@ -28,10 +28,13 @@
 #define LOG_PREFIX CXBXR_MODULE::FILE
 
 #include "EmuFile.h"
+#include "EmuXiso.h"
 #include <vector>
 #include <string>
 #include <sstream>
 #include <cassert>
+#include <shared_mutex>
+#include <unordered_map>
 #include <Shlobj.h>
 #include <Shlwapi.h>
 #pragma warning(disable:4005) // Ignore redefined status values
@@ -333,12 +336,112 @@ void replace_all(std::string& str, const std::string& from, const std::string& t
 	}
 }
 
+// Translated paths only depend on the symbolic links and devices, so the result of CxbxConvertFilePath
+// can be reused until one of those changes. Paths that host file APIs reported as missing are remembered
+// as well, until something creates or renames a file. Both are grouped by the root directory handle they
+// are relative to, since handle values get reused once closed : closing a handle drops its entries.
+struct CxbxTranslatedPath {
+	std::wstring RelativeHostPath;
+	NtDll::HANDLE RootDirectory;
+};
+
+static std::shared_mutex PathCacheMutex;
+static std::unordered_map<NtDll::HANDLE, std::unordered_map<std::string, CxbxTranslatedPath>> TranslatedPathCache;
+static std::unordered_map<NtDll::HANDLE, std::unordered_map<std::wstring, NTSTATUS>> MissingPathCache;
+
+static std::string TranslatedPathCacheKey(const std::string &RelativeXboxPath, bool partitionHeader)
+{
+	return (partitionHeader ? '|' : ':') + RelativeXboxPath;
+}
+
+void CxbxInvalidatePathCache(bool MissingPathsOnly)
+{
+	std::unique_lock<std::shared_mutex> lock(PathCacheMutex);
+	if (!MissingPathsOnly) {
+		TranslatedPathCache.clear();
+	}
+
+	MissingPathCache.clear();
+}
+
+void CxbxInvalidatePathCacheForHandle(NtDll::HANDLE RootDirectory)
+{
+	std::unique_lock<std::shared_mutex> lock(PathCacheMutex);
+	TranslatedPathCache.erase(RootDirectory);
+	MissingPathCache.erase(RootDirectory);
+}
+
+NTSTATUS CxbxLookupMissingPath(const NativeObjectAttributes &nativeObjectAttributes)
+{
+	std::shared_lock<std::shared_mutex> lock(PathCacheMutex);
+	auto paths = MissingPathCache.find(nativeObjectAttributes.NtObjAttr.RootDirectory);
+	if (paths == MissingPathCache.end()) {
+		return STATUS_SUCCESS;
+	}
+
+	auto it = paths->second.find(nativeObjectAttributes.wszObjectName);
+	return (it != paths->second.end()) ? it->second : STATUS_SUCCESS;
+}
+
+void CxbxRememberMissingPath(const NativeObjectAttributes &nativeObjectAttributes, NTSTATUS Status)
+{
+	if (Status != STATUS_OBJECT_NAME_NOT_FOUND && Status != STATUS_OBJECT_PATH_NOT_FOUND) {
+		return;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(PathCacheMutex);
+	MissingPathCache[nativeObjectAttributes.NtObjAttr.RootDirectory][nativeObjectAttributes.wszObjectName] = Status;
+}
+
+static NTSTATUS CxbxConvertFilePathUncached(
+	std::string RelativeXboxPath,
+	OUT std::wstring &RelativeHostPath,
+	IN OUT NtDll::HANDLE *RootDirectory,
+	std::string aFileAPIName,
+	bool partitionHeader);
+
 NTSTATUS CxbxConvertFilePath(
 	std::string RelativeXboxPath,
 	OUT std::wstring &RelativeHostPath,
 	IN OUT NtDll::HANDLE *RootDirectory,
 	std::string aFileAPIName,
 	bool partitionHeader)
+{
+	// Only file API translations do real work, the others just add a prefix
+	if (aFileAPIName.empty()) {
+		return CxbxConvertFilePathUncached(RelativeXboxPath, RelativeHostPath, RootDirectory, aFileAPIName, partitionHeader);
+	}
+
+	NtDll::HANDLE originalRootDirectory = *RootDirectory;
+	std::string key = TranslatedPathCacheKey(RelativeXboxPath, partitionHeader);
+	{
+		std::shared_lock<std::shared_mutex> lock(PathCacheMutex);
+		auto paths = TranslatedPathCache.find(originalRootDirectory);
+		if (paths != TranslatedPathCache.end()) {
+			auto it = paths->second.find(key);
+			if (it != paths->second.end()) {
+				RelativeHostPath = it->second.RelativeHostPath;
+				*RootDirectory = it->second.RootDirectory;
+				return STATUS_SUCCESS;
+			}
+		}
+	}
+
+	NTSTATUS result = CxbxConvertFilePathUncached(RelativeXboxPath, RelativeHostPath, RootDirectory, aFileAPIName, partitionHeader);
+	if (result == STATUS_SUCCESS) {
+		std::unique_lock<std::shared_mutex> lock(PathCacheMutex);
+		TranslatedPathCache[originalRootDirectory][std::move(key)] = { RelativeHostPath, *RootDirectory };
+	}
+
+	return result;
+}
+
+static NTSTATUS CxbxConvertFilePathUncached(
+	std::string RelativeXboxPath,
+	OUT std::wstring &RelativeHostPath,
+	IN OUT NtDll::HANDLE *RootDirectory,
+	std::string aFileAPIName,
+	bool partitionHeader)
 {
 	std::string OriginalPath = RelativeXboxPath;
 	std::string RelativePath = RelativeXboxPath;
@@ -562,14 +665,25 @@ int CxbxRegisterDeviceHostPath(std::string XboxDevicePath, std::string HostDevic
 		status = STATUS_SUCCESS;
 	}
 
+	// An .iso image is mounted and served from its index, instead of from a host directory
+	std::string imagePath;
+	if (XisoImage::IsImagePath(HostDevicePath, &imagePath)) {
+		newDevice.XisoMount = std::make_shared<XisoImage>();
+		if (!newDevice.XisoMount->Mount(imagePath)) {
+			return -1;
+		}
+
+		status = STATUS_SUCCESS;
+	}
 	// If this path is not a raw file partition, create the directory for it
-	if (!IsFile) {
+	else if (!IsFile) {
 		status = SHCreateDirectoryEx(NULL, HostDevicePath.c_str(), NULL);
 	}
 
 	if (status == STATUS_SUCCESS || status == ERROR_ALREADY_EXISTS) {
 		Devices.push_back(newDevice);
 		result = Devices.size() - 1;
+		CxbxInvalidatePathCache(/*MissingPathsOnly=*/false);
 	}
 
 	return result;
@@ -649,11 +763,17 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 					// Handle the case where a sub folder of the partition is mounted (instead of it's root) :
 					std::string ExtraPath = aFullPath.substr(Devices[DeviceIndex].XboxDevicePath.length(), std::string::npos);
 
-					if (!ExtraPath.empty())
+					if (Devices[DeviceIndex].XisoMount != nullptr) {
+						// Files inside an image have no host path; keep the image open as our root handle
+						XisoMount = Devices[DeviceIndex].XisoMount;
+						XisoRootPath = ExtraPath;
+					}
+					else if (!ExtraPath.empty())
 						HostSymbolicLinkPath = HostSymbolicLinkPath + ExtraPath;
 				}
 
-				SHCreateDirectoryEx(NULL, HostSymbolicLinkPath.c_str(), NULL);
+				if (XisoMount == nullptr)
+					SHCreateDirectoryEx(NULL, HostSymbolicLinkPath.c_str(), NULL);
 				RootDirectoryHandle = CreateFile(HostSymbolicLinkPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
 				if (RootDirectoryHandle == INVALID_HANDLE_VALUE)
 				{
@@ -663,6 +783,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 				else
 				{
 					NtSymbolicLinkObjects[DriveLetter - 'A'] = this;
+					CxbxInvalidatePathCache(/*MissingPathsOnly=*/false);
 					EmuLog(LOG_LEVEL::DEBUG, "Linked \"%s\" to \"%s\" (residing at \"%s\")", aSymbolicLinkName.c_str(), aFullPath.c_str(), HostSymbolicLinkPath.c_str());
 				}
 			}
@@ -677,6 +798,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 	if (DriveLetter >= 'A' && DriveLetter <= 'Z') {
 		NtSymbolicLinkObjects[DriveLetter - 'A'] = NULL;
 		NtDll::NtClose(RootDirectoryHandle);
+		CxbxInvalidatePathCache(/*MissingPathsOnly=*/false);
 	}
 }
 
@@ -147,6 +147,7 @@ const size_t XboxFileInfoStructSizes[xboxkrnl::FileMaximumInformation] = {
 
 
 class EmuNtObject;
+class XisoImage;
 
 struct NativeObjectAttributes {
 	wchar_t wszObjectName[160];
@@ -160,6 +161,15 @@ struct NativeObjectAttributes {
 NTSTATUS CxbxObjectAttributesToNT(xboxkrnl::POBJECT_ATTRIBUTES ObjectAttributes, NativeObjectAttributes& nativeObjectAttributes, std::string aFileAPIName = "", bool partitionHeader = false);
 NTSTATUS CxbxConvertFilePath(std::string RelativeXboxPath, OUT std::wstring &RelativeHostPath, IN OUT NtDll::HANDLE *RootDirectory, std::string aFileAPIName = "", bool partitionHeader = false);
 
+// Drops cached path translations; pass MissingPathsOnly after creating or renaming files,
+// and false after symbolic links or devices change
+void CxbxInvalidatePathCache(bool MissingPathsOnly);
+// Drops the cached paths relative to RootDirectory, call this when the handle gets closed
+void CxbxInvalidatePathCacheForHandle(NtDll::HANDLE RootDirectory);
+// Returns the failure status host file APIs last reported for these attributes, or STATUS_SUCCESS if unknown
+NTSTATUS CxbxLookupMissingPath(const NativeObjectAttributes &nativeObjectAttributes);
+void CxbxRememberMissingPath(const NativeObjectAttributes &nativeObjectAttributes, NTSTATUS Status);
+
 // ******************************************************************
 // * Wrapper of a handle object
 // ******************************************************************
@@ -200,6 +210,8 @@ public:
 	std::string XboxSymbolicLinkPath;
 	std::string HostSymbolicLinkPath;
 	HANDLE RootDirectoryHandle;
+	std::shared_ptr<XisoImage> XisoMount; // Set when the link points into a mounted XISO image
+	std::string XisoRootPath;             // The linked folder inside that image
 	NTSTATUS Init(std::string aSymbolicLinkName, std::string aFullPath);
 	~EmuNtSymbolicLinkObject();
 };
@@ -208,6 +220,7 @@ struct XboxDevice {
 	std::string XboxDevicePath;
 	std::string HostDevicePath;
 	HANDLE HostRootHandle;
+	std::shared_ptr<XisoImage> XisoMount; // Set when HostDevicePath is an .iso image instead of a folder
 };
 
 // ******************************************************************
@@ -0,0 +1,484 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#define LOG_PREFIX CXBXR_MODULE::FILE
+
+#include "EmuXiso.h"
+#include <algorithm>
+#include <vector>
+#include <Shlwapi.h>
+#pragma warning(disable:4005) // Ignore redefined status values
+#include <ntstatus.h>
+#pragma warning(default:4005)
+#include "Logging.h"
+
+XisoImage::~XisoImage()
+{
+	if (m_hImage != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hImage);
+	}
+}
+
+bool XisoImage::IsImagePath(const std::string &HostPath, std::string *ImagePath, std::string *InnerPath)
+{
+	// The image is the first path component ending in .iso, anything after it lives inside the image.
+	// A host folder which happens to be named like an image (an extracted disc, for example) is left alone
+	for (size_t pos = 1; pos + 4 <= HostPath.length(); pos++) {
+		size_t end = pos + 4;
+		if (_strnicmp(HostPath.c_str() + pos, ".iso", 4) != 0 || (end < HostPath.length() && HostPath[end] != '\\' && HostPath[end] != '/')) {
+			continue;
+		}
+
+		DWORD attributes = GetFileAttributes(HostPath.substr(0, end).c_str());
+		if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+			continue;
+		}
+
+		if (ImagePath != nullptr) {
+			*ImagePath = HostPath.substr(0, end);
+		}
+		if (InnerPath != nullptr) {
+			size_t inner = HostPath.find_first_not_of("\\/", end);
+			*InnerPath = (inner != std::string::npos) ? HostPath.substr(inner) : std::string();
+		}
+		return true;
+	}
+
+	return false;
+}
+
+bool XisoImage::ReadRaw(uint64_t Offset, void *Buffer, uint32_t Length, uint32_t *BytesRead) const
+{
+	// Positional read : no shared file pointer, so concurrent readers need no lock
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)Offset;
+	overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+
+	DWORD read = 0;
+	BOOL ok = ReadFile(m_hImage, Buffer, Length, &read, &overlapped);
+	if (BytesRead != nullptr) {
+		*BytesRead = read;
+	}
+
+	return ok && (BytesRead != nullptr || read == Length);
+}
+
+bool XisoImage::Mount(const std::string &HostImagePath)
+{
+	m_HostPath = HostImagePath;
+	m_hImage = CreateFile(HostImagePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (m_hImage == INVALID_HANDLE_VALUE) {
+		EmuLog(LOG_LEVEL::WARNING, "Could not open XISO image \"%s\"", HostImagePath.c_str());
+		return false;
+	}
+
+	auto read = [this](uint64_t Offset, void *Buffer, uint32_t Length) {
+		return ReadRaw(Offset, Buffer, Length);
+	};
+
+	if (!m_Index.Locate(read)) {
+		EmuLog(LOG_LEVEL::WARNING, "\"%s\" is not an XDVDFS image", HostImagePath.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER imageSize;
+	if (GetFileSizeEx(m_hImage, &imageSize) && (uint64_t)imageSize.QuadPart > m_Index.GetVolumeOffset()) {
+		m_VolumeSize = (uint64_t)imageSize.QuadPart - m_Index.GetVolumeOffset();
+	}
+
+	if (!m_Index.Build(read)) {
+		EmuLog(LOG_LEVEL::WARNING, "XISO image \"%s\" has a corrupt directory table", HostImagePath.c_str());
+		return false;
+	}
+
+	EmuLog(LOG_LEVEL::INFO, "Mounted XISO image \"%s\" (%u entries)", HostImagePath.c_str(), (unsigned)m_Index.GetEntryCount());
+	return true;
+}
+
+NTSTATUS XisoImage::Read(const XisoEntry &Entry, uint64_t Position, void *Buffer, uint32_t Length, uint32_t *BytesRead) const
+{
+	*BytesRead = 0;
+	if (Position >= Entry.Size) {
+		return STATUS_END_OF_FILE;
+	}
+
+	uint32_t length = (uint32_t)std::min<uint64_t>(Length, Entry.Size - Position);
+	if (!ReadRaw(Entry.Offset + Position, Buffer, length, BytesRead)) {
+		return STATUS_UNEXPECTED_IO_ERROR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+bool XisoImage::ExtractFile(const std::string &Path, const std::string &HostPath) const
+{
+	const XisoEntry *entry = Lookup(Path);
+	if (entry == nullptr || entry->IsDirectory()) {
+		return false;
+	}
+
+	HANDLE hFile = CreateFile(HostPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	std::vector<uint8_t> buffer(1024 * 1024);
+	uint64_t position = 0;
+	bool ok = true;
+	while (ok && position < entry->Size) {
+		uint32_t bytesRead = 0;
+		DWORD written = 0;
+		ok = Read(*entry, position, buffer.data(), (uint32_t)buffer.size(), &bytesRead) == STATUS_SUCCESS && bytesRead > 0 &&
+			WriteFile(hFile, buffer.data(), bytesRead, &written, NULL) && written == bytesRead;
+		position += bytesRead;
+	}
+
+	CloseHandle(hFile);
+	return ok;
+}
+
+EmuNtXisoFileObject::EmuNtXisoFileObject(std::shared_ptr<XisoImage> Image, const std::string &Path, const XisoEntry &Entry)
+	: Image(std::move(Image)), Path(Path), Entry(Entry), Position(0), ScanIndex(0)
+{
+}
+
+EmuNtXisoFileObject *CxbxXisoFileObject(HANDLE Handle)
+{
+	if (!IsEmuHandle(Handle)) {
+		return nullptr;
+	}
+
+	return dynamic_cast<EmuNtXisoFileObject *>(HandleToEmuHandle(Handle)->NtObject);
+}
+
+// Determines which image (and which path inside it) converted object attributes point at
+static bool CxbxXisoResolve(const NativeObjectAttributes &nativeObjectAttributes, std::shared_ptr<XisoImage> &Image, std::string &Path)
+{
+	HANDLE rootDirectory = nativeObjectAttributes.NtObjAttr.RootDirectory;
+	std::string relativePath;
+	for (const wchar_t *c = nativeObjectAttributes.wszObjectName; *c != L'\0'; c++) {
+		relativePath.push_back((char)*c);
+	}
+
+	// Relative to a directory that was opened inside an image
+	EmuNtXisoFileObject *directory = CxbxXisoFileObject(rootDirectory);
+	if (directory != nullptr) {
+		Image = directory->Image;
+		Path = directory->Path + '\\' + relativePath;
+		return true;
+	}
+
+	// Relative to a drive letter (or device) that is backed by an image
+	EmuNtSymbolicLinkObject *symbolicLink = FindNtSymbolicLinkObjectByRootHandle(rootDirectory);
+	if (symbolicLink != nullptr && symbolicLink->XisoMount != nullptr) {
+		Image = symbolicLink->XisoMount;
+		Path = symbolicLink->XisoRootPath + '\\' + relativePath;
+		return true;
+	}
+
+	return false;
+}
+
+bool CxbxXisoCreateFile(const NativeObjectAttributes &nativeObjectAttributes, ULONG Disposition, ULONG CreateOptions, PHANDLE FileHandle, NTSTATUS *Status)
+{
+	std::shared_ptr<XisoImage> image;
+	std::string path;
+	if (!CxbxXisoResolve(nativeObjectAttributes, image, path)) {
+		return false;
+	}
+
+	const XisoEntry *entry = image->Lookup(path);
+	if (entry == nullptr) {
+		*Status = (Disposition == FILE_OPEN || Disposition == FILE_OVERWRITE) ? STATUS_OBJECT_NAME_NOT_FOUND : STATUS_MEDIA_WRITE_PROTECTED;
+	}
+	else if (Disposition != FILE_OPEN && Disposition != FILE_OPEN_IF) {
+		*Status = (Disposition == FILE_CREATE) ? STATUS_OBJECT_NAME_COLLISION : STATUS_MEDIA_WRITE_PROTECTED;
+	}
+	else if ((CreateOptions & FILE_DIRECTORY_FILE) && !entry->IsDirectory()) {
+		*Status = STATUS_NOT_A_DIRECTORY;
+	}
+	else if ((CreateOptions & FILE_NON_DIRECTORY_FILE) && entry->IsDirectory()) {
+		*Status = STATUS_FILE_IS_A_DIRECTORY;
+	}
+	else {
+		EmuNtXisoFileObject *file = new EmuNtXisoFileObject(image, XisoIndex::NormalizePath(path), *entry);
+		*FileHandle = file->NewHandle();
+		file->NtClose(); // The handle now holds the only reference
+		*Status = STATUS_SUCCESS;
+	}
+
+	return true;
+}
+
+bool CxbxXisoQueryFullAttributes(const NativeObjectAttributes &nativeObjectAttributes, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Attributes, NTSTATUS *Status)
+{
+	std::shared_ptr<XisoImage> image;
+	std::string path;
+	if (!CxbxXisoResolve(nativeObjectAttributes, image, path)) {
+		return false;
+	}
+
+	const XisoEntry *entry = image->Lookup(path);
+	if (entry == nullptr) {
+		*Status = STATUS_OBJECT_NAME_NOT_FOUND;
+		return true;
+	}
+
+	memset(Attributes, 0, sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION));
+	Attributes->AllocationSize.QuadPart = (entry->Size + XISO_SECTOR_SIZE - 1) & ~(uint64_t)(XISO_SECTOR_SIZE - 1);
+	Attributes->EndOfFile.QuadPart = entry->Size;
+	Attributes->FileAttributes = entry->Attributes | FILE_ATTRIBUTE_READONLY;
+	*Status = STATUS_SUCCESS;
+	return true;
+}
+
+NTSTATUS CxbxXisoReadFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID Buffer, ULONG Length, xboxkrnl::PLARGE_INTEGER ByteOffset)
+{
+	if (File->Entry.IsDirectory()) {
+		return STATUS_INVALID_DEVICE_REQUEST;
+	}
+
+	uint64_t position = (ByteOffset != nullptr) ? ByteOffset->QuadPart : File->Position;
+	uint32_t bytesRead = 0;
+	NTSTATUS ret = File->Image->Read(File->Entry, position, Buffer, Length, &bytesRead);
+	File->Position = position + bytesRead;
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = bytesRead;
+	return ret;
+}
+
+NTSTATUS CxbxXisoQueryInformationFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass)
+{
+	NTSTATUS ret = STATUS_SUCCESS;
+	ULONG size = 0;
+	uint64_t allocationSize = (File->Entry.Size + XISO_SECTOR_SIZE - 1) & ~(uint64_t)(XISO_SECTOR_SIZE - 1);
+
+	switch (FileInformationClass) {
+	case xboxkrnl::FileStandardInformation: {
+		size = sizeof(xboxkrnl::FILE_STANDARD_INFORMATION);
+		if (Length < size) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		auto info = (xboxkrnl::PFILE_STANDARD_INFORMATION)FileInformation;
+		info->AllocationSize.QuadPart = allocationSize;
+		info->EndOfFile.QuadPart = File->Entry.Size;
+		info->NumberOfLinks = 1;
+		info->DeletePending = FALSE;
+		info->Directory = File->Entry.IsDirectory();
+		break;
+	}
+	case xboxkrnl::FilePositionInformation: {
+		size = sizeof(xboxkrnl::FILE_POSITION_INFORMATION);
+		if (Length < size) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		((xboxkrnl::PFILE_POSITION_INFORMATION)FileInformation)->CurrentByteOffset.QuadPart = File->Position;
+		break;
+	}
+	case xboxkrnl::FileNetworkOpenInformation: {
+		size = sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION);
+		if (Length < size) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		auto info = (xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION)FileInformation;
+		memset(info, 0, size);
+		info->AllocationSize.QuadPart = allocationSize;
+		info->EndOfFile.QuadPart = File->Entry.Size;
+		info->FileAttributes = File->Entry.Attributes | FILE_ATTRIBUTE_READONLY;
+		break;
+	}
+	default:
+		EmuLog(LOG_LEVEL::WARNING, "Unsupported information class %d on XISO file \"%s\"", FileInformationClass, File->Path.c_str());
+		ret = STATUS_INVALID_PARAMETER;
+		break;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = size;
+	return ret;
+}
+
+NTSTATUS CxbxXisoQueryDirectoryFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, xboxkrnl::FILE_DIRECTORY_INFORMATION *FileInformation, ULONG Length, xboxkrnl::PSTRING FileMask, BOOLEAN RestartScan)
+{
+	const std::vector<std::string> *children = File->Image->Children(File->Path);
+	if (children == nullptr) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	// Xbox expects directories to be listed when *.* is passed
+	std::string mask = (FileMask != nullptr) ? std::string(FileMask->Buffer, FileMask->Length) : "*";
+	if (mask == "*.*") {
+		mask = "*";
+	}
+	if (RestartScan) {
+		File->ScanIndex = 0;
+	}
+
+	NTSTATUS ret = STATUS_NO_MORE_FILES;
+	while (File->ScanIndex < children->size()) {
+		const std::string &name = (*children)[File->ScanIndex++];
+		if (!mask.empty() && !PathMatchSpec(name.c_str(), mask.c_str())) {
+			continue;
+		}
+
+		if (Length < offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName) + name.length()) {
+			File->ScanIndex--; // Let the caller retry this entry with a larger buffer
+			ret = STATUS_BUFFER_OVERFLOW;
+			break;
+		}
+
+		const XisoEntry *entry = File->Image->Lookup(File->Path + '\\' + name);
+		memset(FileInformation, 0, offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName));
+		FileInformation->FileIndex = (ULONG)File->ScanIndex;
+		FileInformation->EndOfFile.QuadPart = entry->Size;
+		FileInformation->AllocationSize.QuadPart = (entry->Size + XISO_SECTOR_SIZE - 1) & ~(uint64_t)(XISO_SECTOR_SIZE - 1);
+		FileInformation->FileAttributes = entry->Attributes | FILE_ATTRIBUTE_READONLY;
+		FileInformation->FileNameLength = (ULONG)name.length();
+		memcpy(FileInformation->FileName, name.data(), name.length());
+		ret = STATUS_SUCCESS;
+		break;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = (ret == STATUS_SUCCESS) ? offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName) + FileInformation->FileNameLength : 0;
+	return ret;
+}
+
+NTSTATUS CxbxXisoSetInformationFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass)
+{
+	NTSTATUS ret;
+
+	// The image is read-only, only the position can be changed
+	if (FileInformationClass == xboxkrnl::FilePositionInformation) {
+		if (Length < sizeof(xboxkrnl::FILE_POSITION_INFORMATION)) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		File->Position = ((xboxkrnl::PFILE_POSITION_INFORMATION)FileInformation)->CurrentByteOffset.QuadPart;
+		ret = STATUS_SUCCESS;
+	}
+	else {
+		ret = STATUS_MEDIA_WRITE_PROTECTED;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = 0;
+	return ret;
+}
+
+NTSTATUS CxbxXisoQueryVolumeInformationFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FS_INFORMATION_CLASS FileInformationClass)
+{
+	NTSTATUS ret = STATUS_SUCCESS;
+	ULONG size = 0;
+
+	switch (FileInformationClass) {
+	case xboxkrnl::FileFsSizeInformation: {
+		size = sizeof(xboxkrnl::FILE_FS_SIZE_INFORMATION);
+		if (Length < size) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		// A disc is full by definition, every sector is an allocation unit
+		auto info = (xboxkrnl::PFILE_FS_SIZE_INFORMATION)FileInformation;
+		info->TotalAllocationUnits.QuadPart = File->Image->GetVolumeSize() / XISO_SECTOR_SIZE;
+		info->AvailableAllocationUnits.QuadPart = 0;
+		info->SectorsPerAllocationUnit = 1;
+		info->BytesPerSector = XISO_SECTOR_SIZE;
+		break;
+	}
+	case xboxkrnl::FileFsVolumeInformation: {
+		size = offsetof(xboxkrnl::FILE_FS_VOLUME_INFORMATION, VolumeLabel);
+		if (Length < size) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		// XDVDFS has no volume label nor serial number
+		memset(FileInformation, 0, size);
+		break;
+	}
+	default:
+		EmuLog(LOG_LEVEL::WARNING, "Unsupported volume information class %d on XISO image \"%s\"", FileInformationClass, File->Image->GetHostPath().c_str());
+		ret = STATUS_INVALID_PARAMETER;
+		break;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = size;
+	return ret;
+}
+
+NTSTATUS CxbxXisoDeviceIoControlFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, ULONG IoControlCode, PVOID OutputBuffer, ULONG OutputBufferLength)
+{
+	NTSTATUS ret = STATUS_SUCCESS;
+	ULONG size = 0;
+
+	switch (IoControlCode) {
+	case 0x2404C: // IOCTL_CDROM_GET_DRIVE_GEOMETRY
+	case 0x70000: { // IOCTL_DISK_GET_DRIVE_GEOMETRY
+		size = sizeof(xboxkrnl::DISK_GEOMETRY);
+		if (OutputBufferLength < size) {
+			return STATUS_BUFFER_TOO_SMALL;
+		}
+
+		auto geometry = (xboxkrnl::PDISK_GEOMETRY)OutputBuffer;
+		geometry->MediaType = xboxkrnl::RemovableMedia;
+		geometry->TracksPerCylinder = 1;
+		geometry->SectorsPerTrack = 1;
+		geometry->BytesPerSector = XISO_SECTOR_SIZE;
+		geometry->Cylinders.QuadPart = File->Image->GetVolumeSize() / XISO_SECTOR_SIZE;
+		break;
+	}
+	default:
+		// The image has no partitions, and nothing to eject or lock
+		EmuLog(LOG_LEVEL::WARNING, "Unsupported io control code 0x%X on XISO image \"%s\"", IoControlCode, File->Image->GetHostPath().c_str());
+		ret = STATUS_INVALID_DEVICE_REQUEST;
+		break;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = size;
+	return ret;
+}
+
+NTSTATUS CxbxXisoFsControlFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, ULONG FsControlCode)
+{
+	NTSTATUS ret;
+
+	// Dismounting a read-only image has nothing to flush, and it must never reach the partition formatting of the host path
+	if (FsControlCode == 0x00090020) { // FSCTL_DISMOUNT_VOLUME
+		ret = STATUS_SUCCESS;
+	}
+	else {
+		ret = STATUS_INVALID_DEVICE_REQUEST;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = 0;
+	return ret;
+}
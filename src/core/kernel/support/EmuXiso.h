@@ -0,0 +1,107 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef EMUXISO_H
+#define EMUXISO_H
+
+#include "EmuFile.h"
+#include "XisoIndex.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ******************************************************************
+// * A read-only XDVDFS (XISO) image, indexed once at mount time
+// ******************************************************************
+class XisoImage
+{
+public:
+	XisoImage() = default;
+	~XisoImage();
+	XisoImage(const XisoImage &) = delete;
+	XisoImage &operator=(const XisoImage &) = delete;
+
+	// Opens the image, locates the XDVDFS volume and flattens all directory trees into the index
+	bool Mount(const std::string &HostImagePath);
+	// Finds an entry by its path inside the image, for example "media\\intro.xmv" (case insensitive)
+	const XisoEntry *Lookup(const std::string &Path) const { return m_Index.Lookup(Path); }
+	// Lists the names (as stored on disc) of the entries in a directory, sorted like the on-disc tree
+	const std::vector<std::string> *Children(const std::string &Path) const { return m_Index.Children(Path); }
+	// Reads file data straight into the caller's buffer, clamped to the end of the entry
+	NTSTATUS Read(const XisoEntry &Entry, uint64_t Position, void *Buffer, uint32_t Length, uint32_t *BytesRead) const;
+	// Copies a single file out of the image to the host
+	bool ExtractFile(const std::string &Path, const std::string &HostPath) const;
+
+	const std::string &GetHostPath() const { return m_HostPath; }
+	size_t GetEntryCount() const { return m_Index.GetEntryCount(); }
+	// Size in bytes of the XDVDFS partition, from its start to the end of the image file
+	uint64_t GetVolumeSize() const { return m_VolumeSize; }
+
+	// Returns true when HostPath names an .iso file that should be mounted instead of used as a folder,
+	// or a file inside one (like "game.iso\\other.xbe", which is how a relaunching title names its xbe).
+	// ImagePath receives the path of the image, InnerPath the path inside it (empty for the image itself)
+	static bool IsImagePath(const std::string &HostPath, std::string *ImagePath = nullptr, std::string *InnerPath = nullptr);
+
+private:
+	bool ReadRaw(uint64_t Offset, void *Buffer, uint32_t Length, uint32_t *BytesRead = nullptr) const;
+
+	std::string m_HostPath;
+	HANDLE m_hImage = INVALID_HANDLE_VALUE;
+	uint64_t m_VolumeSize = 0;
+	XisoIndex m_Index;
+};
+
+// ******************************************************************
+// * Emulated handle to a file or directory inside an XISO image
+// ******************************************************************
+class EmuNtXisoFileObject : public EmuNtObject {
+public:
+	EmuNtXisoFileObject(std::shared_ptr<XisoImage> Image, const std::string &Path, const XisoEntry &Entry);
+	std::shared_ptr<XisoImage> Image;
+	std::string Path;
+	XisoEntry Entry;
+	uint64_t Position;
+	size_t ScanIndex; // Next child returned by NtQueryDirectoryFile
+};
+
+// Returns the XISO file object behind Handle, or nullptr if it isn't one
+EmuNtXisoFileObject *CxbxXisoFileObject(HANDLE Handle);
+
+// Opens a file inside a mounted XISO image when the converted object attributes resolve to one.
+// Returns false (leaving Status untouched) when the path lives on the host file system instead.
+bool CxbxXisoCreateFile(const NativeObjectAttributes &nativeObjectAttributes, ULONG Disposition, ULONG CreateOptions, PHANDLE FileHandle, NTSTATUS *Status);
+// Same resolution as above, for NtQueryFullAttributesFile
+bool CxbxXisoQueryFullAttributes(const NativeObjectAttributes &nativeObjectAttributes, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Attributes, NTSTATUS *Status);
+
+// Serves the file APIs for an opened XISO handle
+NTSTATUS CxbxXisoReadFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID Buffer, ULONG Length, xboxkrnl::PLARGE_INTEGER ByteOffset);
+NTSTATUS CxbxXisoQueryInformationFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass);
+NTSTATUS CxbxXisoQueryDirectoryFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, xboxkrnl::FILE_DIRECTORY_INFORMATION *FileInformation, ULONG Length, xboxkrnl::PSTRING FileMask, BOOLEAN RestartScan);
+NTSTATUS CxbxXisoSetInformationFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass);
+NTSTATUS CxbxXisoQueryVolumeInformationFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FS_INFORMATION_CLASS FileInformationClass);
+NTSTATUS CxbxXisoDeviceIoControlFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, ULONG IoControlCode, PVOID OutputBuffer, ULONG OutputBufferLength);
+NTSTATUS CxbxXisoFsControlFile(EmuNtXisoFileObject *File, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, ULONG FsControlCode);
+
+#endif
@@ -0,0 +1,190 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "ObjectNameIndex.h"
+
+ObjectNameIndex::ObjectNameIndex(NameEquals Equals) : m_Equals(Equals), m_Entries(OBJECT_NAME_INDEX_MINIMUM_SIZE)
+{
+	Flush();
+}
+
+size_t ObjectNameIndex::Slot(const void *Directory, uint32_t Hash) const
+{
+	uint32_t Mixed = (Hash ^ ((uint32_t)(uintptr_t)Directory * 0x9E3779B1)) * 0x85EBCA6B;
+	return (Mixed ^ (Mixed >> 16)) & (m_Entries.size() - 1);
+}
+
+void ObjectNameIndex::Place(const Entry &E)
+{
+	size_t Slot = this->Slot(E.Directory, E.Hash);
+	while (m_Entries[Slot].Name != nullptr) {
+		Slot = (Slot + 1) & (m_Entries.size() - 1);
+	}
+
+	m_Entries[Slot] = E;
+}
+
+void ObjectNameIndex::Resize(size_t Size)
+{
+	std::vector<Entry> OldEntries(Size);
+	OldEntries.swap(m_Entries);
+	for (const Entry &E : OldEntries) {
+		if (E.Name != nullptr) {
+			Place(E);
+		}
+	}
+}
+
+void ObjectNameIndex::Flush()
+{
+	for (PathEntry &Path : m_Paths) {
+		Path.Object = nullptr;
+	}
+}
+
+void ObjectNameIndex::Insert(const void *Directory, uint32_t Hash, void *Name)
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+
+	// Keep the load below 3/4
+	if ((m_Count + 1) * 4 > m_Entries.size() * 3) {
+		Resize(m_Entries.size() * 2);
+	}
+
+	Place({ Directory, Hash, Name });
+	m_Count++;
+	Flush();
+}
+
+bool ObjectNameIndex::Remove(const void *Directory, uint32_t Hash, void *Name)
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+	size_t Mask = m_Entries.size() - 1;
+
+	size_t Hole = Slot(Directory, Hash);
+	while (m_Entries[Hole].Name != Name) {
+		if (m_Entries[Hole].Name == nullptr) {
+			return false;
+		}
+		Hole = (Hole + 1) & Mask;
+	}
+
+	// Shift back the entries of the probe run that follows, so that no tombstone is needed : an entry can fill the
+	// hole unless its home slot lies cyclically after the hole, up to the entry itself
+	size_t Next = (Hole + 1) & Mask;
+	while (m_Entries[Next].Name != nullptr) {
+		size_t Home = Slot(m_Entries[Next].Directory, m_Entries[Next].Hash);
+		if (((Next - Home) & Mask) >= ((Next - Hole) & Mask)) {
+			m_Entries[Hole] = m_Entries[Next];
+			Hole = Next;
+		}
+		Next = (Next + 1) & Mask;
+	}
+	m_Entries[Hole] = { nullptr, 0, nullptr };
+	m_Count--;
+
+	// Shrink below 1/8, so that a name added and removed at the boundary doesn't resize every time
+	if ((m_Entries.size() > OBJECT_NAME_INDEX_MINIMUM_SIZE) && (m_Count * 8 < m_Entries.size())) {
+		Resize(m_Entries.size() / 2);
+	}
+
+	Flush();
+	return true;
+}
+
+void *ObjectNameIndex::Find(const void *Directory, uint32_t Hash, const void *Key)
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+
+	size_t Slot = this->Slot(Directory, Hash);
+	while (m_Entries[Slot].Name != nullptr) {
+		const Entry &E = m_Entries[Slot];
+		if (E.Hash == Hash && E.Directory == Directory && m_Equals(E.Name, Key)) {
+			return E.Name;
+		}
+
+		Slot = (Slot + 1) & (m_Entries.size() - 1);
+	}
+
+	return nullptr;
+}
+
+size_t ObjectNameIndex::Count()
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+	return m_Count;
+}
+
+size_t ObjectNameIndex::Capacity()
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+	return m_Entries.size();
+}
+
+static bool PathEquals(const std::string &Cached, const char *Path, size_t Length)
+{
+	if (Cached.length() != Length) {
+		return false;
+	}
+
+	for (size_t i = 0; i < Length; i++) {
+		char a = Cached[i];
+		char b = Path[i];
+		if (a >= 'A' && a <= 'Z') {
+			a += 'a' - 'A';
+		}
+		if (b >= 'A' && b <= 'Z') {
+			b += 'a' - 'A';
+		}
+		if (a != b) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void *ObjectNameIndex::FindPath(const char *Path, size_t Length, uint32_t Hash, bool ResolveSymbolicLink)
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+	const PathEntry &E = m_Paths[Hash & (OBJECT_PATH_CACHE_SIZE - 1)];
+
+	if (E.Object == nullptr || E.Hash != Hash || E.ResolveSymbolicLink != ResolveSymbolicLink || !PathEquals(E.Path, Path, Length)) {
+		return nullptr;
+	}
+
+	return E.Object;
+}
+
+void ObjectNameIndex::CachePath(const char *Path, size_t Length, uint32_t Hash, bool ResolveSymbolicLink, void *Object)
+{
+	std::lock_guard<std::mutex> Lock(m_Mtx);
+	PathEntry &E = m_Paths[Hash & (OBJECT_PATH_CACHE_SIZE - 1)];
+
+	E.Hash = Hash;
+	E.ResolveSymbolicLink = ResolveSymbolicLink;
+	E.Object = Object;
+	E.Path.assign(Path, Length);
+}
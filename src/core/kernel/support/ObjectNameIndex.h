@@ -0,0 +1,98 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef OBJECTNAMEINDEX_H
+#define OBJECTNAMEINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define OBJECT_NAME_INDEX_MINIMUM_SIZE 64 // must be a power of two
+#define OBJECT_PATH_CACHE_SIZE 256 // must be a power of two
+
+// ******************************************************************
+// * Host side index of the names of all the object directories, and a
+// * cache of the objects that absolute paths resolved to. The index is
+// * an open addressing table that grows and shrinks with its load, and
+// * keeps the full hash of every name so that most mismatches skip the
+// * string compare. Adding or removing a name can change what a cached
+// * path resolves to, so it flushes the cache. The names are opaque to
+// * the index, it only compares them through the callback. It only
+// * depends on the standard library, so that it can be built and tested
+// * outside of the emulator
+// ******************************************************************
+class ObjectNameIndex
+{
+public:
+	// Returns true when Name (as passed to Insert) is the name Key (as passed to Find)
+	typedef bool (*NameEquals)(const void *Name, const void *Key);
+
+	explicit ObjectNameIndex(NameEquals Equals);
+
+	// Adds a name of a directory, the caller makes sure the directory doesn't have it yet
+	void Insert(const void *Directory, uint32_t Hash, void *Name);
+	// Removes a name added by Insert, false when it isn't in the index
+	bool Remove(const void *Directory, uint32_t Hash, void *Name);
+	// Finds the name of a directory that equals Key, or returns nullptr
+	void *Find(const void *Directory, uint32_t Hash, const void *Key);
+	size_t Count();
+	size_t Capacity();
+
+	// Finds the object cached for an absolute path, compared case insensitively, or returns nullptr
+	void *FindPath(const char *Path, size_t Length, uint32_t Hash, bool ResolveSymbolicLink);
+	// Caches the object a path resolved to, replacing the path that used the same slot
+	void CachePath(const char *Path, size_t Length, uint32_t Hash, bool ResolveSymbolicLink, void *Object);
+
+private:
+	struct Entry {
+		const void *Directory;
+		uint32_t Hash;
+		void *Name;
+	};
+
+	struct PathEntry {
+		uint32_t Hash;
+		bool ResolveSymbolicLink;
+		void *Object;
+		std::string Path;
+	};
+
+	// These must be called with m_Mtx held
+	size_t Slot(const void *Directory, uint32_t Hash) const;
+	void Place(const Entry &E);
+	void Resize(size_t Size);
+	void Flush();
+
+	NameEquals m_Equals;
+	// Raising the irql doesn't stop the other host threads, so the index and the cache need their own lock
+	std::mutex m_Mtx;
+	std::vector<Entry> m_Entries;
+	size_t m_Count = 0;
+	PathEntry m_Paths[OBJECT_PATH_CACHE_SIZE];
+};
+
+#endif
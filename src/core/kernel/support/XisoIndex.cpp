@@ -0,0 +1,202 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "XisoIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// XDVDFS layout, see also src/common/xdvdfs-tools
+#define XISO_VOLUME_DESCRIPTOR      32
+#define XISO_SIGNATURE              "MICROSOFT*XBOX*MEDIA"
+#define XISO_SIGNATURE_SIZE         20
+#define XISO_DIRENT_HEADER_SIZE     14
+#define XISO_DIRENT_PADDING         0xFFFF
+
+// Limits against damaged images : retail discs nest a handful of levels deep, and keep far smaller tables
+#define XISO_MAX_DIRECTORY_DEPTH    64
+#define XISO_MAX_TABLE_SIZE         (16 * 1024 * 1024)
+
+// Where the game partition starts, for plain xiso dumps and for full disc (redump) images of each disc generation
+static const uint64_t XisoVolumeOffsets[] = {
+	0x00000000, // xiso
+	0x18300000, // XGD1
+	0x0FD90000, // XGD2
+	0x02080000, // XGD3
+};
+
+std::string XisoIndex::NormalizePath(const std::string &Path)
+{
+	std::string result;
+	result.reserve(Path.length());
+	for (char c : Path) {
+		if (c == '/') {
+			c = '\\';
+		}
+
+		if (c == '\\' && (result.empty() || result.back() == '\\')) {
+			continue;
+		}
+
+		result.push_back((char)tolower((unsigned char)c));
+	}
+
+	if (!result.empty() && result.back() == '\\') {
+		result.pop_back();
+	}
+
+	return result;
+}
+
+bool XisoIndex::Locate(const ReadCallback &Read)
+{
+	uint8_t descriptor[XISO_SECTOR_SIZE];
+	for (uint64_t volumeOffset : XisoVolumeOffsets) {
+		if (!Read(volumeOffset + XISO_VOLUME_DESCRIPTOR * XISO_SECTOR_SIZE, descriptor, sizeof(descriptor))) {
+			continue;
+		}
+
+		if (memcmp(descriptor, XISO_SIGNATURE, XISO_SIGNATURE_SIZE) == 0 &&
+			memcmp(descriptor + XISO_SECTOR_SIZE - XISO_SIGNATURE_SIZE - 4, XISO_SIGNATURE, XISO_SIGNATURE_SIZE) == 0) {
+			uint32_t rootSector, rootSize;
+			memcpy(&rootSector, descriptor + XISO_SIGNATURE_SIZE, sizeof(rootSector));
+			memcpy(&rootSize, descriptor + XISO_SIGNATURE_SIZE + 4, sizeof(rootSize));
+
+			m_VolumeOffset = volumeOffset;
+			m_Root.Offset = volumeOffset + (uint64_t)rootSector * XISO_SECTOR_SIZE;
+			m_Root.Size = rootSize;
+			m_Root.Attributes = XISO_ATTRIBUTE_DIRECTORY;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool XisoIndex::Build(const ReadCallback &Read)
+{
+	m_Entries.clear();
+	m_Children.clear();
+	m_Tables.clear();
+	m_Entries.emplace("", m_Root);
+
+	bool ok = IndexDirectory(Read, "", m_Root, 0);
+	m_Tables.clear();
+	return ok;
+}
+
+bool XisoIndex::IndexDirectory(const ReadCallback &Read, const std::string &Prefix, const XisoEntry &Directory, unsigned Depth)
+{
+	// Empty directories have no dirent table at all
+	if (Directory.Size == 0) {
+		return true;
+	}
+
+	// A table that is already indexed means that directories contain each other, which would never end.
+	// The depth limit also bounds the recursion on a long chain of distinct (but bogus) directories
+	if (Depth >= XISO_MAX_DIRECTORY_DEPTH || Directory.Size > XISO_MAX_TABLE_SIZE || !m_Tables.insert(Directory.Offset).second) {
+		return false;
+	}
+
+	// Read the whole dirent table at once, then walk its binary tree from memory
+	std::vector<uint8_t> table(Directory.Size);
+	if (!Read(Directory.Offset, table.data(), Directory.Size)) {
+		return false;
+	}
+
+	std::vector<std::string> &children = m_Children[Prefix];
+	std::vector<uint32_t> pending = { 0 };
+	std::vector<bool> visited(Directory.Size / 4, false);
+	while (!pending.empty()) {
+		uint32_t offset = pending.back();
+		pending.pop_back();
+
+		// Bounds check and loop guard, so a damaged image can't run us off the table
+		if (offset + XISO_DIRENT_HEADER_SIZE > Directory.Size || visited[offset / 4]) {
+			return false;
+		}
+		visited[offset / 4] = true;
+
+		const uint8_t *dirent = &table[offset];
+		uint16_t left, right;
+		memcpy(&left, dirent + 0, sizeof(left));
+		memcpy(&right, dirent + 2, sizeof(right));
+		if (left == XISO_DIRENT_PADDING) {
+			continue;
+		}
+
+		uint8_t nameLength = dirent[13];
+		if (offset + XISO_DIRENT_HEADER_SIZE + nameLength > Directory.Size) {
+			return false;
+		}
+
+		uint32_t sector;
+		XisoEntry entry;
+		memcpy(&sector, dirent + 4, sizeof(sector));
+		memcpy(&entry.Size, dirent + 8, sizeof(entry.Size));
+		entry.Offset = m_VolumeOffset + (uint64_t)sector * XISO_SECTOR_SIZE;
+		entry.Attributes = dirent[12];
+
+		std::string name((const char *)dirent + XISO_DIRENT_HEADER_SIZE, nameLength);
+		std::string key = NormalizePath(name);
+		std::string path = Prefix.empty() ? key : Prefix + '\\' + key;
+		children.push_back(std::move(name));
+		if (entry.IsDirectory() && !IndexDirectory(Read, path, entry, Depth + 1)) {
+			return false;
+		}
+
+		m_Entries.emplace(std::move(path), entry);
+
+		// Subtree offsets are in dwords, zero means no subtree
+		if (left != 0) {
+			pending.push_back((uint32_t)left * 4);
+		}
+
+		if (right != 0) {
+			pending.push_back((uint32_t)right * 4);
+		}
+	}
+
+	// An in-order walk of the tree would yield this order too, which is what the Xbox enumerates
+	std::sort(children.begin(), children.end(), [](const std::string &a, const std::string &b) {
+		return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+			return tolower((unsigned char)x) < tolower((unsigned char)y);
+		});
+	});
+
+	return true;
+}
+
+const XisoEntry *XisoIndex::Lookup(const std::string &Path) const
+{
+	auto it = m_Entries.find(NormalizePath(Path));
+	return (it != m_Entries.end()) ? &it->second : nullptr;
+}
+
+const std::vector<std::string> *XisoIndex::Children(const std::string &Path) const
+{
+	auto it = m_Children.find(NormalizePath(Path));
+	return (it != m_Children.end()) ? &it->second : nullptr;
+}
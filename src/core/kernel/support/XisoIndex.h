@@ -0,0 +1,85 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef XISOINDEX_H
+#define XISOINDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define XISO_SECTOR_SIZE            2048
+#define XISO_ATTRIBUTE_DIRECTORY    0x10 // Same value as FILE_ATTRIBUTE_DIRECTORY
+
+// ******************************************************************
+// * A file or directory inside an XISO image
+// ******************************************************************
+struct XisoEntry {
+	uint64_t Offset;     // Absolute byte offset of the data inside the image file
+	uint32_t Size;       // Size in bytes (for directories, the size of the dirent table)
+	uint8_t  Attributes; // XDVDFS attributes, these match the FILE_ATTRIBUTE_* values
+	bool IsDirectory() const { return (Attributes & XISO_ATTRIBUTE_DIRECTORY) != 0; }
+};
+
+// ******************************************************************
+// * The directory trees of an XDVDFS volume, flattened into hash tables.
+// * It reads the image through a callback and only depends on the
+// * standard library, so that it can be built and tested outside of
+// * the emulator
+// ******************************************************************
+class XisoIndex
+{
+public:
+	// Reads exactly Length bytes at an absolute offset of the image, and returns false when it can't
+	typedef std::function<bool(uint64_t Offset, void *Buffer, uint32_t Length)> ReadCallback;
+
+	// Looks for the volume descriptor, at the start of the image and at the game partition of full disc images
+	bool Locate(const ReadCallback &Read);
+	// Walks all directory tables of the volume found by Locate, and fails when one of them is damaged
+	bool Build(const ReadCallback &Read);
+	// Finds an entry by its path inside the image, for example "media\\intro.xmv" (case insensitive)
+	const XisoEntry *Lookup(const std::string &Path) const;
+	// Lists the names (as stored on disc) of the entries in a directory, sorted like the on-disc tree
+	const std::vector<std::string> *Children(const std::string &Path) const;
+
+	uint64_t GetVolumeOffset() const { return m_VolumeOffset; }
+	size_t GetEntryCount() const { return m_Entries.size(); }
+
+	// Index keys are lower case, backslash separated and without leading or trailing separators
+	static std::string NormalizePath(const std::string &Path);
+
+private:
+	bool IndexDirectory(const ReadCallback &Read, const std::string &Prefix, const XisoEntry &Directory, unsigned Depth);
+
+	uint64_t m_VolumeOffset = 0; // Start of the XDVDFS partition inside the image (non-zero for redump style images)
+	XisoEntry m_Root = {};
+	std::unordered_map<std::string, XisoEntry> m_Entries;
+	std::unordered_map<std::string, std::vector<std::string>> m_Children;
+	std::unordered_set<uint64_t> m_Tables; // Directory tables indexed so far, to catch entries that point back into each other
+};
+
+#endif
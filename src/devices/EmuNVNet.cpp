@@ -335,11 +335,11 @@ void EmuNVNet_DMAPacketFromGuest()
 
 		memcpy(&desc, (void*)(tx_ring_addr | CONTIGUOUS_MEMORY_BASE), sizeof(desc));
 
-		EmuLog(LOG_LEVEL::DEBUG, "Looking at ring desc %d (%llx): "
-		                         "\n   Buffer: 0x%x "
-		                         "\n   Length: 0x%x "
-		                         "\n   Flags:  0x%x ",
-		                         s->tx_ring_index, tx_ring_addr, desc.packet_buffer, desc.length, desc.flags);
+		EmuLogSampled(LOG_LEVEL::DEBUG, "Looking at ring desc %d (%llx): "
+		                                "\n   Buffer: 0x%x "
+		                                "\n   Length: 0x%x "
+		                                "\n   Flags:  0x%x ",
+		                                s->tx_ring_index, tx_ring_addr, desc.packet_buffer, desc.length, desc.flags);
 
 		s->tx_ring_index += 1;
 
@@ -348,7 +348,7 @@ void EmuNVNet_DMAPacketFromGuest()
 		}
 
 		/* Transfer packet from guest memory */
-		EmuLog(LOG_LEVEL::DEBUG, "Sending packet...");
+		EmuLogSampled(LOG_LEVEL::DEBUG, "Sending packet...");
 
 		memcpy(s->txrx_dma_buf, (void*)(desc.packet_buffer | CONTIGUOUS_MEMORY_BASE), desc.length + 1);
 		g_NVNet->PCAPSend(s->txrx_dma_buf, desc.length + 1);
@@ -363,14 +363,14 @@ void EmuNVNet_DMAPacketFromGuest()
 		memcpy((void*)(tx_ring_addr | CONTIGUOUS_MEMORY_BASE), &desc, sizeof(desc));
 
 		if (is_last_packet) {
-			EmuLog(LOG_LEVEL::DEBUG, "  -- Last packet");
+			EmuLogSampled(LOG_LEVEL::DEBUG, "  -- Last packet");
 			break;
 		}
 	}
 
 	if (packet_sent) {
 		/* Trigger interrupt */
-		EmuLog(LOG_LEVEL::DEBUG, "Triggering interrupt");
+		EmuLogSampled(LOG_LEVEL::DEBUG, "Triggering interrupt");
 		EmuNVNet_SetRegister(NvRegIrqStatus, NVREG_IRQSTAT_BIT4, 4);
 		EmuNVNet_UpdateIRQ();
 	}
@@ -390,11 +390,11 @@ bool EmuNVNet_DMAPacketToGuest(void* packet, size_t size)
 		
 		memcpy(&desc, (void*)(rx_ring_addr | CONTIGUOUS_MEMORY_BASE), sizeof(desc));
 
-        EmuLog(LOG_LEVEL::DEBUG, "Looking at ring descriptor %d (0x%llx): "
-                                 "\n   Buffer: 0x%x "
-                                 "\n   Length: 0x%x "
-                                 "\n   Flags:  0x%x ",
-                                 s->rx_ring_index, rx_ring_addr, desc.packet_buffer, desc.length, desc.flags);
+        EmuLogSampled(LOG_LEVEL::DEBUG, "Looking at ring descriptor %d (0x%llx): "
+                                        "\n   Buffer: 0x%x "
+                                        "\n   Length: 0x%x "
+                                        "\n   Flags:  0x%x ",
+                                        s->rx_ring_index, rx_ring_addr, desc.packet_buffer, desc.length, desc.flags);
 
 		s->rx_ring_index += 1;
 
@@ -403,27 +403,27 @@ bool EmuNVNet_DMAPacketToGuest(void* packet, size_t size)
 		}
 
 		/* Transfer packet from device to memory */
-		EmuLog(LOG_LEVEL::DEBUG, "Transferring packet, size 0x%zx, to memory at 0x%x", size, desc.packet_buffer);
+		EmuLogSampled(LOG_LEVEL::DEBUG, "Transferring packet, size 0x%zx, to memory at 0x%x", size, desc.packet_buffer);
 		memcpy((void*)(desc.packet_buffer | CONTIGUOUS_MEMORY_BASE), packet, size);
 
 		/* Update descriptor indicating the packet is waiting */
 		desc.length = (uint16_t)size;
 		desc.flags = NV_RX_BIT4 | NV_RX_DESCRIPTORVALID;
 		memcpy((void*)(rx_ring_addr | CONTIGUOUS_MEMORY_BASE), &desc, sizeof(desc));
-        EmuLog(LOG_LEVEL::DEBUG, "Updated ring descriptor: "
-                                 "\n   Length: 0x%x "
-                                 "\n   Flags:  0x%x ",
-                                 desc.flags, desc.length);
+        EmuLogSampled(LOG_LEVEL::DEBUG, "Updated ring descriptor: "
+                                        "\n   Length: 0x%x "
+                                        "\n   Flags:  0x%x ",
+                                        desc.flags, desc.length);
 
 		/* Trigger interrupt */
-		EmuLog(LOG_LEVEL::DEBUG, "Triggering interrupt");
+		EmuLogSampled(LOG_LEVEL::DEBUG, "Triggering interrupt");
 		EmuNVNet_SetRegister(NvRegIrqStatus, NVREG_IRQSTAT_BIT1, 4);
 		EmuNVNet_UpdateIRQ();
 		return true;
 	}
 
 	/* Could not find free buffer, or packet too large. */
-	EmuLog(LOG_LEVEL::DEBUG, "Could not find free buffer!");
+	EmuLogSampled(LOG_LEVEL::DEBUG, "Could not find free buffer!");
 	return false;
 }
 
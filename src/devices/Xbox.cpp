@@ -36,6 +36,7 @@ SMCDevice* g_SMC;
 EEPROMDevice* g_EEPROM;
 NVNetDevice* g_NVNet;
 NV2ADevice* g_NV2A;
+APUDevice* g_APU;
 ADM1032Device* g_ADM1032;
 USBDevice* g_USB0;
 
@@ -128,6 +129,9 @@ void InitXboxHardware(HardwareModel hardwareModel)
 	if (bLLE_USB) {
 		g_USB0 = new USBDevice();
 	}
+	if (bLLE_APU) {
+		g_APU = new APUDevice();
+	}
 
 	// Connect devices to SM bus
 	g_SMBus->ConnectDevice(SMBUS_ADDRESS_SYSTEM_MICRO_CONTROLLER, g_SMC); // W 0x20 R 0x21
@@ -153,7 +157,9 @@ void InitXboxHardware(HardwareModel hardwareModel)
 	g_PCIBus->ConnectDevice(PCI_DEVID(0, PCI_DEVFN(1, 1)), g_SMBus);
 	g_PCIBus->ConnectDevice(PCI_DEVID(0, PCI_DEVFN(4, 0)), g_NVNet);
 	//g_PCIBus->ConnectDevice(PCI_DEVID(0, PCI_DEVFN(4, 1)), g_MCPX); // MCPX device ID = 0x0808 ?
-	//g_PCIBus->ConnectDevice(PCI_DEVID(0, PCI_DEVFN(5, 0)), g_NVAPU);
+	if (bLLE_APU) {
+		g_PCIBus->ConnectDevice(PCI_DEVID(0, PCI_DEVFN(5, 0)), g_APU);
+	}
 	//g_PCIBus->ConnectDevice(PCI_DEVID(0, PCI_DEVFN(6, 0)), g_AC97);
 	g_PCIBus->ConnectDevice(PCI_DEVID(1, PCI_DEVFN(0, 0)), g_NV2A);
 	if (bLLE_USB) {
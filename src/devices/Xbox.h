@@ -34,6 +34,7 @@
 #include "EmuNVNet.h" // For NVNetDevice
 #include "ADM1032Device.h" // For ADM1032
 #include "devices\video\nv2a.h" // For NV2ADevice
+#include "devices\audio\APUDevice.h" // For APUDevice
 #include "Usb\USBDevice.h" // For USBDevice
 
 #define SMBUS_ADDRESS_MCPX 0x10 // = Write; Read = 0x11
@@ -70,6 +71,7 @@ extern SMCDevice* g_SMC;
 extern EEPROMDevice* g_EEPROM;
 extern NVNetDevice* g_NVNet;
 extern NV2ADevice* g_NV2A;
+extern APUDevice* g_APU;
 extern USBDevice* g_USB0;
 
 extern void InitXboxHardware(HardwareModel hardwareModel);
@@ -26,13 +26,17 @@
 // ******************************************************************
 
 #include <cstdio>
+#include <chrono>
 
 #include "APUDevice.h"
+#include "common\AddressRanges.h" // For CONTIGUOUS_MEMORY_BASE
+#include "core\kernel\init\CxbxKrnl.h" // For g_SystemMaxMemory
+#include "core\kernel\support\Emu.h" // For g_CPUOthers
+#include "Cxbx.h" // For CxbxSetThreadName
 
 extern uint32_t GetAPUTime();
 
-// TODO: Everything :P
-// TODO: Audio Processing/Thread
+// The GP and EP DSPs are not modelled, so the VP mixbins are not consumed
 
 #define APU_VP_BASE 0x20000
 #define APU_VP_SIZE 0x10000
@@ -60,11 +64,69 @@ void APUDevice::Init()
 
 	m_DeviceId = 0x01B0;
 	m_VendorId = PCI_VENDOR_ID_NVIDIA;
+
+	// Guest physical memory is identity mapped at the contiguous region
+	m_pVoiceProcessor = new APUVoiceProcessor((uint8_t*)CONTIGUOUS_MEMORY_BASE, (uint32_t)g_SystemMaxMemory);
+	m_FrameThread = std::thread(FrameThread, this);
+}
+
+APUDevice::~APUDevice()
+{
+	// The frame thread checks the flag once per frame, so this waits for at most one frame
+	m_bExiting = true;
+	if (m_FrameThread.joinable()) {
+		m_FrameThread.join();
+	}
+
+	delete m_pVoiceProcessor;
 }
 	
 void APUDevice::Reset()
 {
+	// The frame thread keeps running, the voice processor resets its state under its own lock
+	if (m_pVoiceProcessor != nullptr) {
+		m_pVoiceProcessor->Reset();
+	}
+}
+
+bool APUDevice::SaveVoiceDump(const char* szPath)
+{
+	if (m_pVoiceProcessor == nullptr) {
+		return false;
+	}
+
+	FILE* pFile = fopen(szPath, "wb");
+	if (pFile == nullptr) {
+		return false;
+	}
 
+	bool bSaved = m_pVoiceProcessor->SaveDump(pFile);
+	fclose(pFile);
+	return bSaved;
+}
+
+void APUDevice::FrameThread(APUDevice* pDevice)
+{
+	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
+	CxbxSetThreadName("Cxbx APU VP");
+
+	const auto framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>((double)APU_VP_FRAME_SAMPLES / APU_VP_SAMPLE_RATE));
+	auto nextFrameTime = std::chrono::steady_clock::now() + framePeriod;
+
+	while (!pDevice->m_bExiting) {
+		std::this_thread::sleep_until(nextFrameTime);
+
+		// Catch up on frames missed while the host was busy, but don't try to replay a long stall
+		auto now = std::chrono::steady_clock::now();
+		if (now - nextFrameTime > framePeriod * 64) {
+			nextFrameTime = now;
+		}
+		while (nextFrameTime <= now) {
+			pDevice->m_pVoiceProcessor->ProcessFrame();
+			nextFrameTime += framePeriod;
+		}
+	}
 }
 
 uint32_t APUDevice::IORead(int barIndex, uint32_t addr, unsigned size)
@@ -96,6 +158,11 @@ uint32_t APUDevice::MMIORead(int barIndex, uint32_t addr, unsigned size)
 		case 0x200C: return GetAPUTime();	
 	}
 
+	uint32_t value;
+	if (m_pVoiceProcessor->RegisterRead(addr, value)) {
+		return value;
+	}
+
 	printf("APUDevice: Unimplemented MMIORead %X\n", addr);
 	return 0;
 }
@@ -117,6 +184,10 @@ void APUDevice::MMIOWrite(int barIndex, uint32_t addr, uint32_t value, unsigned
 		return;
 	}
 
+	if (m_pVoiceProcessor->RegisterWrite(addr, value)) {
+		return;
+	}
+
 	printf("APUDevice: Unimplemented MMIOWrite %X\n", addr);
 }
 
@@ -135,17 +206,13 @@ void APUDevice::GPWrite(uint32_t addr, uint32_t value, unsigned size)
 
 uint32_t APUDevice::VPRead(uint32_t addr, unsigned size)
 {
-	switch (addr) {
-		case 0x10: return 0x80; // HACK: Pretend the FIFO is always empty, bypasses hangs when APU isn't fully implemented
-	}
-
-	printf("APUDevice: Unimplemented VP MMIORead %X\n", addr);
-	return 0;
+	// Methods run as soon as they are written, so the FIFO always reads as empty
+	return m_pVoiceProcessor->MethodRead(addr);
 }
 
 void APUDevice::VPWrite(uint32_t addr, uint32_t value, unsigned size)
 {
-	printf("APUDevice: Unimplemented VP MMIOWrite %X\n", addr);
+	m_pVoiceProcessor->MethodWrite(addr, value);
 }
 
 
@@ -28,10 +28,16 @@
 #ifndef _APU_H_
 #define _APU_H_
 
+#include <atomic>
+#include <thread>
+
 #include "../PCIDevice.h"
+#include "APUVoiceProcessor.h"
+
 class APUDevice : public PCIDevice {
 public:
 	using PCIDevice::PCIDevice;
+	~APUDevice();
 
 	// PCI Functions
 	void Init();
@@ -42,6 +48,9 @@ public:
 
 	uint32_t MMIORead(int barIndex, uint32_t addr, unsigned size);
 	void MMIOWrite(int barIndex, uint32_t addr, uint32_t value, unsigned size);
+
+	// Writes the voice processor state and guest memory, for cxbxr-tool render-apu
+	bool SaveVoiceDump(const char* szPath);
 private:
 	uint32_t GPRead(uint32_t addr, unsigned size);
 	void GPWrite(uint32_t addr, uint32_t value, unsigned size);
@@ -49,6 +58,13 @@ private:
 	void EPWrite(uint32_t addr, uint32_t value, unsigned size);
 	uint32_t VPRead(uint32_t addr, unsigned size);
 	void VPWrite(uint32_t addr, uint32_t value, unsigned size);
+
+	// Runs the voice processor at the hardware frame rate, 32 samples at 48 KHz
+	static void FrameThread(APUDevice* pDevice);
+
+	APUVoiceProcessor* m_pVoiceProcessor = nullptr;
+	std::thread m_FrameThread;
+	std::atomic_bool m_bExiting = false;
 };
 
 #endif
@@ -0,0 +1,717 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <cstring>
+
+#include "APUVoiceProcessor.h"
+#include "common/audio/converter.hpp"
+#include "common/XADPCM.h"
+
+#define GET_MASK(v, mask) (((v) & (mask)) >> ctz32(mask))
+#define SET_MASK(v, mask, val) ((v) = ((v) & ~(mask)) | (((val) << ctz32(mask)) & (mask)))
+
+static inline unsigned ctz32(uint32_t mask)
+{
+	unsigned shift = 0;
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		shift++;
+	}
+	return shift;
+}
+
+// Envelope times and rates count in units of 16 samples.
+#define APU_VP_ENVELOPE_UNITS_PER_FRAME (APU_VP_FRAME_SAMPLES / 16)
+
+// Voice volumes are 12 bit attenuation in 1/64 dB, 0xFFF mutes.
+static inline float VoiceVolumeToGain(uint32_t volume)
+{
+	if (volume >= 0xFFF) {
+		return 0.0f;
+	}
+	return converter_volume2gain(-(int32_t)(volume * 100 / 64));
+}
+
+APUVoiceProcessor::APUVoiceProcessor(uint8_t* pMemory, uint32_t MemorySize)
+	: m_pMemory(pMemory), m_MemoryMask(MemorySize - 1)
+{
+	Reset();
+}
+
+void APUVoiceProcessor::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	memset(m_Regs, 0, sizeof(m_Regs));
+	m_Regs[(NV_PAPU_TVL2D - NV_PAPU_VP_REGS_BASE) / 4] = APU_VP_VOICE_NONE;
+	m_Regs[(NV_PAPU_TVL3D - NV_PAPU_VP_REGS_BASE) / 4] = APU_VP_VOICE_NONE;
+	m_Regs[(NV_PAPU_TVLMP - NV_PAPU_VP_REGS_BASE) / 4] = APU_VP_VOICE_NONE;
+	m_CurrentVoice = 0;
+	m_AntecedentVoice = APU_VP_VOICE_NONE;
+	memset(m_VoiceFraction, 0, sizeof(m_VoiceFraction));
+	memset(m_VoiceReleaseLevel, 0, sizeof(m_VoiceReleaseLevel));
+	memset(m_VoiceStream, 0, sizeof(m_VoiceStream));
+	m_SslBasePage = 0;
+	memset(m_MixBins, 0, sizeof(m_MixBins));
+	m_FrameCount = 0;
+	m_VoicesLastFrame = 0;
+}
+
+bool APUVoiceProcessor::RegisterRead(uint32_t addr, uint32_t &value)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	switch (addr) {
+		case NV_PAPU_FECV: value = m_CurrentVoice; return true;
+		case NV_PAPU_FEAV: value = m_AntecedentVoice; return true;
+	}
+	if (addr >= NV_PAPU_VP_REGS_BASE && addr < NV_PAPU_VP_REGS_BASE + NV_PAPU_VP_REGS_SIZE) {
+		value = m_Regs[(addr - NV_PAPU_VP_REGS_BASE) / 4];
+		return true;
+	}
+	return false;
+}
+
+bool APUVoiceProcessor::RegisterWrite(uint32_t addr, uint32_t value)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	switch (addr) {
+		case NV_PAPU_FECV: m_CurrentVoice = value; return true;
+		case NV_PAPU_FEAV: m_AntecedentVoice = value; return true;
+	}
+	if (addr >= NV_PAPU_VP_REGS_BASE && addr < NV_PAPU_VP_REGS_BASE + NV_PAPU_VP_REGS_SIZE) {
+		m_Regs[(addr - NV_PAPU_VP_REGS_BASE) / 4] = value;
+		return true;
+	}
+	return false;
+}
+
+uint32_t APUVoiceProcessor::MethodRead(uint32_t addr)
+{
+	switch (addr) {
+		case NV1BA0_PIO_FREE: return 0x80;
+	}
+	return 0;
+}
+
+void APUVoiceProcessor::MethodWrite(uint32_t addr, uint32_t value)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	uint32_t handle = value & 0xFFFF;
+	switch (addr) {
+		case NV1BA0_PIO_SET_ANTECEDENT_VOICE:
+			m_AntecedentVoice = value;
+			break;
+		case NV1BA0_PIO_VOICE_ON:
+			VoiceOn(handle);
+			break;
+		case NV1BA0_PIO_VOICE_OFF:
+			VoiceOff(handle);
+			break;
+		case NV1BA0_PIO_VOICE_RELEASE:
+			VoiceRelease(handle);
+			break;
+		case NV1BA0_PIO_VOICE_PAUSE:
+			VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_PAUSED, (value & NV1BA0_PIO_VOICE_PAUSE_ACTION) ? 1 : 0);
+			break;
+		case NV1BA0_PIO_SET_CURRENT_SSL:
+			// Byte offset of the list in the stream segment list table, 8 bytes per entry
+			m_SslBasePage = value >> 3;
+			break;
+		case NV1BA0_PIO_SET_CURRENT_VOICE:
+			m_CurrentVoice = value;
+			break;
+		case NV1BA0_PIO_SET_VOICE_SSL_A:
+		case NV1BA0_PIO_SET_VOICE_SSL_B:
+			if (m_CurrentVoice < APU_VP_MAX_VOICES) {
+				unsigned list = (addr == NV1BA0_PIO_SET_VOICE_SSL_A) ? 0 : 1;
+				m_VoiceStream[m_CurrentVoice].Base[list] = GET_MASK(value, NV1BA0_PIO_SET_VOICE_SSL_BASE);
+				m_VoiceStream[m_CurrentVoice].Count[list] = (uint8_t)GET_MASK(value, NV1BA0_PIO_SET_VOICE_SSL_COUNT);
+			}
+			break;
+		case NV1BA0_PIO_SET_VOICE_CFG_VBIN:
+		case NV1BA0_PIO_SET_VOICE_CFG_FMT:
+		case NV1BA0_PIO_SET_VOICE_CFG_ENV0:
+		case NV1BA0_PIO_SET_VOICE_CFG_ENVA:
+		case NV1BA0_PIO_SET_VOICE_CFG_ENV1:
+		case NV1BA0_PIO_SET_VOICE_CFG_ENVF:
+		case NV1BA0_PIO_SET_VOICE_CFG_MISC:
+			VoiceSet(m_CurrentVoice, addr - NV1BA0_PIO_SET_VOICE_CFG_VBIN + NV_PAVS_VOICE_CFG_VBIN, 0xFFFFFFFF, value);
+			break;
+		case NV1BA0_PIO_SET_VOICE_TAR_VOLA:
+		case NV1BA0_PIO_SET_VOICE_TAR_VOLB:
+		case NV1BA0_PIO_SET_VOICE_TAR_VOLC:
+		case NV1BA0_PIO_SET_VOICE_LFO_ENV:
+			VoiceSet(m_CurrentVoice, addr - NV1BA0_PIO_SET_VOICE_TAR_VOLA + NV_PAVS_VOICE_TAR_VOLA, 0xFFFFFFFF, value);
+			break;
+		case NV1BA0_PIO_SET_VOICE_TAR_FCA:
+		case NV1BA0_PIO_SET_VOICE_TAR_FCB:
+			VoiceSet(m_CurrentVoice, addr - NV1BA0_PIO_SET_VOICE_TAR_FCA + NV_PAVS_VOICE_TAR_FCA, 0xFFFFFFFF, value);
+			break;
+		case NV1BA0_PIO_SET_VOICE_TAR_PITCH:
+			VoiceSet(m_CurrentVoice, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_PITCH, value >> 16);
+			break;
+		case NV1BA0_PIO_SET_VOICE_CFG_BUF_BASE:
+			VoiceSet(m_CurrentVoice, NV_PAVS_VOICE_CUR_PSL_START, NV_PAVS_VOICE_CUR_PSL_START_BA, value);
+			break;
+		case NV1BA0_PIO_SET_VOICE_CFG_BUF_LBO:
+			VoiceSet(m_CurrentVoice, NV_PAVS_VOICE_CUR_PSH_SAMPLE, NV_PAVS_VOICE_CUR_PSH_SAMPLE_LBO, value);
+			break;
+		case NV1BA0_PIO_SET_VOICE_BUF_CBO:
+			VoiceSet(m_CurrentVoice, NV_PAVS_VOICE_PAR_OFFSET, NV_PAVS_VOICE_PAR_OFFSET_CBO, value);
+			break;
+		case NV1BA0_PIO_SET_VOICE_CFG_BUF_EBO:
+			VoiceSet(m_CurrentVoice, NV_PAVS_VOICE_PAR_NEXT, NV_PAVS_VOICE_PAR_NEXT_EBO, value);
+			break;
+		default:
+			if (addr >= NV1BA0_PIO_SET_SSL_SEGMENT_OFFSET && addr < NV1BA0_PIO_SET_SSL_SEGMENT_OFFSET + APU_VP_SSL_SEGMENTS * 8) {
+				uint32_t entry = m_SslBasePage + (addr - NV1BA0_PIO_SET_SSL_SEGMENT_OFFSET) / 8;
+				WritePhysical32(m_Regs[(NV_PAPU_VPSSLADDR - NV_PAPU_VP_REGS_BASE) / 4] + entry * 8 + (addr & 4), value);
+			}
+			break;
+	}
+}
+
+uint32_t APUVoiceProcessor::ReadPhysical32(uint32_t addr) const
+{
+	uint32_t value;
+	memcpy(&value, m_pMemory + (addr & m_MemoryMask & ~3), sizeof(value));
+	return value;
+}
+
+void APUVoiceProcessor::WritePhysical32(uint32_t addr, uint32_t value)
+{
+	memcpy(m_pMemory + (addr & m_MemoryMask & ~3), &value, sizeof(value));
+}
+
+uint32_t APUVoiceProcessor::VoiceGet(uint32_t handle, uint32_t offset, uint32_t mask) const
+{
+	uint32_t addr = m_Regs[(NV_PAPU_VPVADDR - NV_PAPU_VP_REGS_BASE) / 4] + handle * NV_PAVS_SIZE + offset;
+	return GET_MASK(ReadPhysical32(addr), mask);
+}
+
+void APUVoiceProcessor::VoiceSet(uint32_t handle, uint32_t offset, uint32_t mask, uint32_t value)
+{
+	uint32_t addr = m_Regs[(NV_PAPU_VPVADDR - NV_PAPU_VP_REGS_BASE) / 4] + handle * NV_PAVS_SIZE + offset;
+	uint32_t data = ReadPhysical32(addr);
+	SET_MASK(data, mask, value);
+	WritePhysical32(addr, data);
+}
+
+void APUVoiceProcessor::ReadBuffer(uint32_t offset, uint8_t* pDst, uint32_t length) const
+{
+	uint32_t sge = m_Regs[(NV_PAPU_VPSGEADDR - NV_PAPU_VP_REGS_BASE) / 4];
+	while (length > 0) {
+		uint32_t page = ReadPhysical32(sge + (offset >> 12) * 8) & ~0xFFF;
+		uint32_t pageOffset = offset & 0xFFF;
+		uint32_t chunk = 0x1000 - pageOffset;
+		if (chunk > length) {
+			chunk = length;
+		}
+		memcpy(pDst, m_pMemory + ((page + pageOffset) & m_MemoryMask), chunk);
+		pDst += chunk;
+		offset += chunk;
+		length -= chunk;
+	}
+}
+
+void APUVoiceProcessor::ReadPhysical(uint32_t addr, uint8_t* pDst, uint32_t length) const
+{
+	while (length > 0) {
+		uint32_t offset = addr & m_MemoryMask;
+		uint32_t chunk = m_MemoryMask - offset + 1;
+		if (chunk > length) {
+			chunk = length;
+		}
+		memcpy(pDst, m_pMemory + offset, chunk);
+		pDst += chunk;
+		addr += chunk;
+		length -= chunk;
+	}
+}
+
+void APUVoiceProcessor::VoiceOn(uint32_t handle)
+{
+	if (handle >= APU_VP_MAX_VOICES) {
+		return;
+	}
+
+	// Voice is added on top of the selected list, or after the antecedent voice when no list is given.
+	unsigned list = GET_MASK(m_AntecedentVoice, NV_PAPU_FEAV_LST);
+	if (list != 0) {
+		static const uint32_t top[] = { NV_PAPU_TVL2D, NV_PAPU_TVL3D, NV_PAPU_TVLMP };
+		uint32_t &top_handle = m_Regs[(top[(list - 1) % 3] - NV_PAPU_VP_REGS_BASE) / 4];
+		VoiceSet(handle, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE, top_handle);
+		top_handle = handle;
+	} else {
+		uint32_t antecedent = GET_MASK(m_AntecedentVoice, NV_PAPU_FEAV_VALUE);
+		if (antecedent < APU_VP_MAX_VOICES) {
+			uint32_t next = VoiceGet(antecedent, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE);
+			VoiceSet(handle, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE, next);
+			VoiceSet(antecedent, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE, handle);
+		}
+	}
+
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE, 1);
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_NEW_VOICE, 1);
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_PAUSED, 0);
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_EACUR, ENVELOPE_DELAY);
+	VoiceSet(handle, NV_PAVS_VOICE_CUR_ECNT, NV_PAVS_VOICE_CUR_ECNT_EACOUNT, 0);
+	m_VoiceFraction[handle] = 0;
+	m_VoiceStream[handle].Current = 0;
+	m_VoiceStream[handle].Segment = 0;
+}
+
+void APUVoiceProcessor::VoiceOff(uint32_t handle)
+{
+	if (handle >= APU_VP_MAX_VOICES) {
+		return;
+	}
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE, 0);
+}
+
+void APUVoiceProcessor::VoiceRelease(uint32_t handle)
+{
+	if (handle >= APU_VP_MAX_VOICES) {
+		return;
+	}
+
+	// Release fades out from wherever the envelope is right now.
+	uint32_t state = VoiceGet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_EACUR);
+	uint32_t count = VoiceGet(handle, NV_PAVS_VOICE_CUR_ECNT, NV_PAVS_VOICE_CUR_ECNT_EACOUNT);
+	float level = StepEnvelope(handle);
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_EACUR, state);
+	VoiceSet(handle, NV_PAVS_VOICE_CUR_ECNT, NV_PAVS_VOICE_CUR_ECNT_EACOUNT, count);
+
+	m_VoiceReleaseLevel[handle] = (uint8_t)(level * 255.0f + 0.5f);
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_EACUR, ENVELOPE_RELEASE);
+	VoiceSet(handle, NV_PAVS_VOICE_CUR_ECNT, NV_PAVS_VOICE_CUR_ECNT_EACOUNT, 0);
+}
+
+float APUVoiceProcessor::StepEnvelope(uint32_t handle)
+{
+	uint32_t env0 = VoiceGet(handle, NV_PAVS_VOICE_CFG_ENV0, 0xFFFFFFFF);
+	uint32_t enva = VoiceGet(handle, NV_PAVS_VOICE_CFG_ENVA, 0xFFFFFFFF);
+	uint32_t state = VoiceGet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_EACUR);
+	uint32_t count = VoiceGet(handle, NV_PAVS_VOICE_CUR_ECNT, NV_PAVS_VOICE_CUR_ECNT_EACOUNT);
+
+	// Titles without an amplitude envelope leave it all zero, play those at full level.
+	if (env0 == 0 && enva == 0 && state != ENVELOPE_RELEASE) {
+		return 1.0f;
+	}
+
+	uint32_t attack = env0 & 0xFFF;
+	uint32_t delay = (env0 >> 12) & 0xFFF;
+	uint32_t decay = enva & 0xFFF;
+	uint32_t hold = (enva >> 12) & 0xFFF;
+	uint32_t sustain = enva >> 24;
+	uint32_t release = VoiceGet(handle, NV_PAVS_VOICE_TAR_LFO_ENV, NV_PAVS_VOICE_TAR_LFO_ENV_EA_RELEASERATE);
+
+	uint32_t level;
+	uint32_t next_state = state;
+	switch (state) {
+		case ENVELOPE_DELAY:
+			level = 0;
+			if (count >= delay) {
+				next_state = ENVELOPE_ATTACK;
+			}
+			break;
+		case ENVELOPE_ATTACK:
+			level = attack == 0 || count >= attack ? 255 : count * 255 / attack;
+			if (count >= attack) {
+				next_state = ENVELOPE_HOLD;
+			}
+			break;
+		case ENVELOPE_HOLD:
+			level = 255;
+			if (count >= hold) {
+				next_state = ENVELOPE_DECAY;
+			}
+			break;
+		case ENVELOPE_DECAY:
+			level = decay == 0 || count >= decay ? sustain : 255 - (255 - sustain) * count / decay;
+			if (count >= decay) {
+				next_state = ENVELOPE_SUSTAIN;
+			}
+			break;
+		case ENVELOPE_SUSTAIN:
+			level = sustain;
+			break;
+		case ENVELOPE_RELEASE:
+			level = release == 0 || count >= release ? 0 : m_VoiceReleaseLevel[handle] * (release - count) / release;
+			if (level == 0) {
+				VoiceOff(handle);
+			}
+			break;
+		default:
+			level = 255;
+			break;
+	}
+
+	if (next_state != state) {
+		VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_EACUR, next_state);
+		count = 0;
+	} else if (count < 0xFFFF - APU_VP_ENVELOPE_UNITS_PER_FRAME) {
+		count += APU_VP_ENVELOPE_UNITS_PER_FRAME;
+	}
+	VoiceSet(handle, NV_PAVS_VOICE_CUR_ECNT, NV_PAVS_VOICE_CUR_ECNT_EACOUNT, count);
+
+	return level / 255.0f;
+}
+
+bool APUVoiceProcessor::FetchSamples(uint32_t handle, float (&Samples)[2][APU_VP_FRAME_SAMPLES])
+{
+	uint32_t fmt = VoiceGet(handle, NV_PAVS_VOICE_CFG_FMT, 0xFFFFFFFF);
+	bool stream = (fmt & NV_PAVS_VOICE_CFG_FMT_DATA_TYPE) != 0;
+
+	unsigned channels = (fmt & NV_PAVS_VOICE_CFG_FMT_STEREO) ? 2 : 1;
+	unsigned container = GET_MASK(fmt, NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE);
+	unsigned sample_size = GET_MASK(fmt, NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE);
+	bool loop = (fmt & NV_PAVS_VOICE_CFG_FMT_LOOP) != 0;
+	uint32_t ba = VoiceGet(handle, NV_PAVS_VOICE_CUR_PSL_START, NV_PAVS_VOICE_CUR_PSL_START_BA);
+	uint32_t lbo = VoiceGet(handle, NV_PAVS_VOICE_CUR_PSH_SAMPLE, NV_PAVS_VOICE_CUR_PSH_SAMPLE_LBO);
+	uint32_t cbo = VoiceGet(handle, NV_PAVS_VOICE_PAR_OFFSET, NV_PAVS_VOICE_PAR_OFFSET_CBO);
+	uint32_t ebo = VoiceGet(handle, NV_PAVS_VOICE_PAR_NEXT, NV_PAVS_VOICE_PAR_NEXT_EBO);
+	int16_t pitch = (int16_t)VoiceGet(handle, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_PITCH);
+
+	// Source samples are stepped in 32.32 fixed point, pitch 0 plays at 48 KHz.
+	uint64_t step = (uint64_t)(converter_pitch2freq_exact(pitch) / APU_VP_SAMPLE_RATE * 4294967296.0);
+	uint64_t fraction = m_VoiceFraction[handle];
+	// Source samples covered by this frame, plus the next one to interpolate toward.
+	uint32_t needed = (uint32_t)((fraction + step * (APU_VP_FRAME_SAMPLES - 1)) >> 32) + 2;
+
+	m_Source.resize(needed * channels);
+	float* pSource = m_Source.data();
+	uint32_t index = cbo;
+	uint32_t filled = 0;
+	bool ended = false;
+	if (stream) {
+		filled = ReadStream(handle, needed, channels, container, sample_size, pSource, false);
+	}
+	while (!stream && filled < needed) {
+		if (index > ebo) {
+			if (!loop || lbo > ebo) {
+				ended = true;
+				break;
+			}
+			index = lbo;
+		}
+		uint32_t count = ebo - index + 1;
+		if (count > needed - filled) {
+			count = needed - filled;
+		}
+		DecodeSource(ba, index, count, channels, container, sample_size, pSource + filled * channels, false);
+		filled += count;
+		index += count;
+	}
+	// Past the end of a one shot buffer, or of the data queued on a stream, is silence.
+	memset(pSource + filled * channels, 0, (needed - filled) * channels * sizeof(float));
+
+	for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+		uint64_t position = fraction + step * i;
+		uint32_t k = (uint32_t)(position >> 32);
+		float f = (uint32_t)position / 4294967296.0f;
+		for (unsigned c = 0; c < channels; c++) {
+			float s0 = pSource[k * channels + c];
+			float s1 = pSource[(k + 1) * channels + c];
+			Samples[c][i] = s0 + (s1 - s0) * f;
+		}
+	}
+	if (channels == 1) {
+		memcpy(Samples[1], Samples[0], sizeof(Samples[0]));
+	}
+
+	// Advance the buffer offset, wrapping around the loop region.
+	uint64_t advanced = fraction + step * APU_VP_FRAME_SAMPLES;
+	m_VoiceFraction[handle] = (uint32_t)advanced;
+	if (stream) {
+		// A stream that ran dry stays on, and picks up again once the driver queues more segments
+		ReadStream(handle, (uint32_t)(advanced >> 32), channels, container, sample_size, nullptr, true);
+		return true;
+	}
+	uint64_t next = cbo + (advanced >> 32);
+	if (next > ebo) {
+		if (loop && lbo <= ebo) {
+			next = lbo + (next - ebo - 1) % (ebo - lbo + 1);
+		} else {
+			ended = true;
+		}
+	}
+	if (ended) {
+		VoiceOff(handle);
+	} else {
+		VoiceSet(handle, NV_PAVS_VOICE_PAR_OFFSET, NV_PAVS_VOICE_PAR_OFFSET_CBO, (uint32_t)next);
+	}
+	return true;
+}
+
+uint32_t APUVoiceProcessor::ReadStream(uint32_t handle, uint32_t count, unsigned channels, unsigned container,
+                                       unsigned sample_size, float* pDst, bool advance)
+{
+	uint32_t ssl = m_Regs[(NV_PAPU_VPSSLADDR - NV_PAPU_VP_REGS_BASE) / 4];
+	VoiceStream stream = m_VoiceStream[handle];
+	uint32_t cbo = VoiceGet(handle, NV_PAVS_VOICE_PAR_OFFSET, NV_PAVS_VOICE_PAR_OFFSET_CBO);
+	uint32_t done = 0;
+
+	// An underrun left the voice on an empty list, resume with the other one once the driver queued it
+	if (stream.Count[stream.Current] == 0 && stream.Count[stream.Current ^ 1] != 0) {
+		stream.Current ^= 1;
+		stream.Segment = 0;
+		cbo = 0;
+	}
+
+	// Both lists are cleared once played, so this ends on an underrun at the latest
+	while (done < count && stream.Count[stream.Current] != 0) {
+		uint32_t entry = ssl + (stream.Base[stream.Current] + stream.Segment) * 8;
+		uint32_t address = ReadPhysical32(entry);
+		uint32_t length = ReadPhysical32(entry + 4) & APU_VP_SSL_LENGTH;
+		if (cbo >= length) {
+			cbo = 0;
+			if (++stream.Segment >= stream.Count[stream.Current]) {
+				stream.Segment = 0;
+				stream.Count[stream.Current] = 0;
+				stream.Current ^= 1;
+			}
+			continue;
+		}
+
+		uint32_t n = length - cbo;
+		if (n > count - done) {
+			n = count - done;
+		}
+		if (pDst != nullptr) {
+			DecodeSource(address, cbo, n, channels, container, sample_size, pDst + done * channels, true);
+		}
+		cbo += n;
+		done += n;
+	}
+
+	if (advance) {
+		m_VoiceStream[handle] = stream;
+		VoiceSet(handle, NV_PAVS_VOICE_PAR_OFFSET, NV_PAVS_VOICE_PAR_OFFSET_CBO, cbo);
+	}
+	return done;
+}
+
+void APUVoiceProcessor::DecodeSource(uint32_t ba, uint32_t index, uint32_t count, unsigned channels,
+                                     unsigned container, unsigned sample_size, float* pDst, bool stream)
+{
+	if (container == APU_VP_CONTAINER_ADPCM) {
+		// 65 samples per block of 36 bytes per channel, decode every block the range touches.
+		int16_t block[XBOX_ADPCM_DSTSIZE];
+		uint8_t encoded[XBOX_ADPCM_SRCSIZE * 2];
+		uint32_t block_bytes = XBOX_ADPCM_SRCSIZE * channels;
+		uint32_t block_samples = XBOX_ADPCM_DSTSIZE / 2;
+		while (count > 0) {
+			uint32_t block_index = index / block_samples;
+			uint32_t first = index % block_samples;
+			uint32_t n = block_samples - first;
+			if (n > count) {
+				n = count;
+			}
+			if (stream) {
+				ReadPhysical(ba + block_index * block_bytes, encoded, block_bytes);
+			} else {
+				ReadBuffer(ba + block_index * block_bytes, encoded, block_bytes);
+			}
+			TXboxAdpcmDecoder_DecodeBlock(encoded, block, channels);
+			for (uint32_t i = 0; i < n * channels; i++) {
+				*pDst++ = block[first * channels + i] / 32768.0f;
+			}
+			index += n;
+			count -= n;
+		}
+		return;
+	}
+
+	static const unsigned container_bytes[] = { 1, 2, 0, 4 };
+	unsigned bytes = container_bytes[container];
+	uint32_t total = count * channels;
+	m_Encoded.resize(total * bytes);
+	if (stream) {
+		ReadPhysical(ba + index * channels * bytes, m_Encoded.data(), total * bytes);
+	} else {
+		ReadBuffer(ba + index * channels * bytes, m_Encoded.data(), total * bytes);
+	}
+
+	const uint8_t* pSrc = m_Encoded.data();
+	for (uint32_t i = 0; i < total; i++, pSrc += bytes) {
+		switch (bytes) {
+			case 1:
+				*pDst++ = (pSrc[0] - 128) / 128.0f;
+				break;
+			case 2:
+				*pDst++ = (int16_t)(pSrc[0] | (pSrc[1] << 8)) / 32768.0f;
+				break;
+			default: {
+				uint32_t value = pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16) | ((uint32_t)pSrc[3] << 24);
+				if (sample_size == APU_VP_SAMPLE_S24) {
+					// Sign extend the low 24 bits
+					*pDst++ = (int32_t)(value << 8) / 2147483648.0f;
+				} else {
+					*pDst++ = (int32_t)value / 2147483648.0f;
+				}
+				break;
+			}
+		}
+	}
+}
+
+bool APUVoiceProcessor::ProcessVoice(uint32_t handle)
+{
+	uint32_t state = VoiceGet(handle, NV_PAVS_VOICE_PAR_STATE, 0xFFFFFFFF);
+	if ((state & NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE) == 0) {
+		return false;
+	}
+	VoiceSet(handle, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_NEW_VOICE, 0);
+	if (state & NV_PAVS_VOICE_PAR_STATE_PAUSED) {
+		return true;
+	}
+
+	float envelope = StepEnvelope(handle);
+	float samples[2][APU_VP_FRAME_SAMPLES];
+	if (!FetchSamples(handle, samples) || envelope == 0.0f) {
+		return true;
+	}
+
+	// Eight mixbins per voice, stereo voices send left to even and right to odd ones.
+	uint32_t vbin = VoiceGet(handle, NV_PAVS_VOICE_CFG_VBIN, 0xFFFFFFFF);
+	uint32_t fmt = VoiceGet(handle, NV_PAVS_VOICE_CFG_FMT, 0xFFFFFFFF);
+	uint32_t vola = VoiceGet(handle, NV_PAVS_VOICE_TAR_VOLA, 0xFFFFFFFF);
+	uint32_t volb = VoiceGet(handle, NV_PAVS_VOICE_TAR_VOLB, 0xFFFFFFFF);
+	uint32_t volc = VoiceGet(handle, NV_PAVS_VOICE_TAR_VOLC, 0xFFFFFFFF);
+	bool stereo = (fmt & NV_PAVS_VOICE_CFG_FMT_STEREO) != 0;
+
+	unsigned bins[8] = {
+		vbin & 0x1F, (vbin >> 5) & 0x1F, (vbin >> 10) & 0x1F, (vbin >> 16) & 0x1F,
+		(vbin >> 21) & 0x1F, (vbin >> 26) & 0x1F, fmt & 0x1F, (fmt >> 5) & 0x1F,
+	};
+	uint32_t volumes[8] = {
+		(vola >> 4) & 0xFFF, vola >> 20, (volb >> 4) & 0xFFF, volb >> 20, (volc >> 4) & 0xFFF, volc >> 20,
+		(vola & 0xF) | ((volb & 0xF) << 4) | ((volc & 0xF) << 8),
+		((vola >> 16) & 0xF) | (((volb >> 16) & 0xF) << 4) | (((volc >> 16) & 0xF) << 8),
+	};
+
+	for (unsigned b = 0; b < 8; b++) {
+		float gain = envelope * VoiceVolumeToGain(volumes[b]);
+		if (gain == 0.0f) {
+			continue;
+		}
+		const float* pSamples = samples[stereo ? (b & 1) : 0];
+		float* pMix = m_Mix[bins[b]];
+		for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+			pMix[i] += pSamples[i] * gain;
+		}
+	}
+	return true;
+}
+
+void APUVoiceProcessor::ProcessFrame()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	memset(m_Mix, 0, sizeof(m_Mix));
+	unsigned voices = 0;
+
+	static const uint32_t lists[] = { NV_PAPU_TVL2D, NV_PAPU_TVL3D, NV_PAPU_TVLMP };
+	for (uint32_t list : lists) {
+		uint32_t handle = m_Regs[(list - NV_PAPU_VP_REGS_BASE) / 4] & 0xFFFF;
+		// Bounded walk, a corrupt list must not hang the frame clock.
+		for (unsigned n = 0; handle < APU_VP_MAX_VOICES && n < APU_VP_MAX_VOICES; n++) {
+			if (ProcessVoice(handle)) {
+				voices++;
+			}
+			handle = VoiceGet(handle, NV_PAVS_VOICE_TAR_PITCH_LINK, NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE);
+		}
+	}
+
+	// Mixbins hold 24 bit samples.
+	for (unsigned bin = 0; bin < APU_VP_MIXBINS; bin++) {
+		for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+			float sample = m_Mix[bin][i];
+			sample = sample > 1.0f ? 1.0f : sample;
+			sample = sample < -1.0f ? -1.0f : sample;
+			m_MixBins[bin][i] = (int32_t)(sample * 8388607.0f);
+		}
+	}
+
+	m_VoicesLastFrame = voices;
+	m_FrameCount++;
+}
+
+struct APUVoiceDumpHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t MemorySize;
+};
+
+bool APUVoiceProcessor::SaveDump(FILE* pFile)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	APUVoiceDumpHeader header = { APU_VP_DUMP_MAGIC, APU_VP_DUMP_VERSION, m_MemoryMask + 1 };
+	return fwrite(&header, sizeof(header), 1, pFile) == 1
+		&& fwrite(m_Regs, sizeof(m_Regs), 1, pFile) == 1
+		&& fwrite(&m_CurrentVoice, sizeof(m_CurrentVoice), 1, pFile) == 1
+		&& fwrite(&m_AntecedentVoice, sizeof(m_AntecedentVoice), 1, pFile) == 1
+		&& fwrite(m_VoiceFraction, sizeof(m_VoiceFraction), 1, pFile) == 1
+		&& fwrite(m_VoiceReleaseLevel, sizeof(m_VoiceReleaseLevel), 1, pFile) == 1
+		&& fwrite(m_VoiceStream, sizeof(m_VoiceStream), 1, pFile) == 1
+		&& fwrite(&m_SslBasePage, sizeof(m_SslBasePage), 1, pFile) == 1
+		&& fwrite(m_pMemory, m_MemoryMask + 1, 1, pFile) == 1;
+}
+
+bool APUVoiceProcessor::PeekDump(FILE* pFile, uint32_t &MemorySize)
+{
+	APUVoiceDumpHeader header;
+	long start = ftell(pFile);
+	bool valid = fread(&header, sizeof(header), 1, pFile) == 1
+		&& header.Magic == APU_VP_DUMP_MAGIC && header.Version == APU_VP_DUMP_VERSION
+		&& header.MemorySize != 0 && (header.MemorySize & (header.MemorySize - 1)) == 0;
+	fseek(pFile, start, SEEK_SET);
+
+	MemorySize = valid ? header.MemorySize : 0;
+	return valid;
+}
+
+bool APUVoiceProcessor::LoadDump(FILE* pFile)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	APUVoiceDumpHeader header;
+	if (fread(&header, sizeof(header), 1, pFile) != 1 || header.Magic != APU_VP_DUMP_MAGIC ||
+		header.Version != APU_VP_DUMP_VERSION || header.MemorySize != m_MemoryMask + 1) {
+		return false;
+	}
+
+	return fread(m_Regs, sizeof(m_Regs), 1, pFile) == 1
+		&& fread(&m_CurrentVoice, sizeof(m_CurrentVoice), 1, pFile) == 1
+		&& fread(&m_AntecedentVoice, sizeof(m_AntecedentVoice), 1, pFile) == 1
+		&& fread(m_VoiceFraction, sizeof(m_VoiceFraction), 1, pFile) == 1
+		&& fread(m_VoiceReleaseLevel, sizeof(m_VoiceReleaseLevel), 1, pFile) == 1
+		&& fread(m_VoiceStream, sizeof(m_VoiceStream), 1, pFile) == 1
+		&& fread(&m_SslBasePage, sizeof(m_SslBasePage), 1, pFile) == 1
+		&& fread(m_pMemory, m_MemoryMask + 1, 1, pFile) == 1;
+}
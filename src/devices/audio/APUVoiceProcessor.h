@@ -0,0 +1,243 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef _APU_VOICE_PROCESSOR_H_
+#define _APU_VOICE_PROCESSOR_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// APU registers used by the voice processor, offsets within APU MMIO.
+// Register and voice descriptor layout as documented by XQEMU (mcpx_apu.c).
+#define NV_PAPU_VP_REGS_BASE            0x2000
+#define NV_PAPU_VP_REGS_SIZE            0x100
+#define NV_PAPU_FECV                    0x1110 // Current voice
+#define NV_PAPU_FEAV                    0x1118 // Antecedent voice
+#	define NV_PAPU_FEAV_VALUE           0x0000FFFF
+#	define NV_PAPU_FEAV_LST             0x00030000
+#define NV_PAPU_VPVADDR                 0x202C // Voice array
+#define NV_PAPU_VPSGEADDR               0x2030 // Buffer scatter gather entries
+#define NV_PAPU_VPSSLADDR               0x2034 // Stream segment lists, entries of the physical address of the samples and their count
+#define NV_PAPU_TVL2D                   0x2054 // Top of the 2D, 3D and multipass voice lists
+#define NV_PAPU_TVL3D                   0x2060
+#define NV_PAPU_TVLMP                   0x206C
+
+// VP front end methods, offsets within VP range
+#define NV1BA0_PIO_FREE                         0x010
+#define NV1BA0_PIO_SET_ANTECEDENT_VOICE         0x120
+#define NV1BA0_PIO_VOICE_ON                     0x124
+#define NV1BA0_PIO_VOICE_OFF                    0x128
+#define NV1BA0_PIO_VOICE_RELEASE                0x12C
+#define NV1BA0_PIO_VOICE_PAUSE                  0x140
+#	define NV1BA0_PIO_VOICE_PAUSE_ACTION        (1 << 18)
+#define NV1BA0_PIO_SET_CURRENT_SSL              0x190
+#define NV1BA0_PIO_SET_CURRENT_VOICE            0x2F8
+#define NV1BA0_PIO_SET_VOICE_CFG_VBIN           0x300
+#define NV1BA0_PIO_SET_VOICE_CFG_FMT            0x304
+#define NV1BA0_PIO_SET_VOICE_CFG_ENV0           0x308
+#define NV1BA0_PIO_SET_VOICE_CFG_ENVA           0x30C
+#define NV1BA0_PIO_SET_VOICE_CFG_ENV1           0x310
+#define NV1BA0_PIO_SET_VOICE_CFG_ENVF           0x314
+#define NV1BA0_PIO_SET_VOICE_CFG_MISC           0x318
+#define NV1BA0_PIO_SET_VOICE_SSL_A              0x320
+#	define NV1BA0_PIO_SET_VOICE_SSL_COUNT       0x000000FF
+#	define NV1BA0_PIO_SET_VOICE_SSL_BASE        0xFFFFFF00
+#define NV1BA0_PIO_SET_VOICE_SSL_B              0x35C
+#define NV1BA0_PIO_SET_VOICE_TAR_VOLA           0x360
+#define NV1BA0_PIO_SET_VOICE_TAR_VOLB           0x364
+#define NV1BA0_PIO_SET_VOICE_TAR_VOLC           0x368
+#define NV1BA0_PIO_SET_VOICE_LFO_ENV            0x36C
+#define NV1BA0_PIO_SET_VOICE_TAR_FCA            0x374
+#define NV1BA0_PIO_SET_VOICE_TAR_FCB            0x378
+#define NV1BA0_PIO_SET_VOICE_TAR_PITCH          0x37C
+#define NV1BA0_PIO_SET_VOICE_CFG_BUF_BASE       0x3A0
+#define NV1BA0_PIO_SET_VOICE_CFG_BUF_LBO        0x3A4
+#define NV1BA0_PIO_SET_VOICE_BUF_CBO            0x3D8
+#define NV1BA0_PIO_SET_VOICE_CFG_BUF_EBO        0x3DC
+#define NV1BA0_PIO_SET_SSL_SEGMENT_OFFSET       0x600 // Pairs of offset and length, one per segment of the current list
+#define NV1BA0_PIO_SET_SSL_SEGMENT_LENGTH       0x604
+
+// Voice descriptor, one per voice handle in the voice array
+#define NV_PAVS_SIZE                            0x80
+#define NV_PAVS_VOICE_CFG_VBIN                  0x00
+#define NV_PAVS_VOICE_CFG_FMT                   0x04
+#	define NV_PAVS_VOICE_CFG_FMT_SAMPLES_PER_BLOCK  0x001F0000
+#	define NV_PAVS_VOICE_CFG_FMT_DATA_TYPE          (1 << 24) // Stream when set
+#	define NV_PAVS_VOICE_CFG_FMT_LOOP               (1 << 25)
+#	define NV_PAVS_VOICE_CFG_FMT_STEREO             (1 << 27)
+#	define NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE        0x30000000
+#	define NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE     0xC0000000
+#define NV_PAVS_VOICE_CFG_ENV0                  0x08
+#define NV_PAVS_VOICE_CFG_ENVA                  0x0C
+#define NV_PAVS_VOICE_CFG_ENV1                  0x10
+#define NV_PAVS_VOICE_CFG_ENVF                  0x14
+#define NV_PAVS_VOICE_CFG_MISC                  0x18
+#define NV_PAVS_VOICE_CUR_PSL_START             0x20
+#	define NV_PAVS_VOICE_CUR_PSL_START_BA           0x00FFFFFF
+#define NV_PAVS_VOICE_CUR_PSH_SAMPLE            0x24
+#	define NV_PAVS_VOICE_CUR_PSH_SAMPLE_LBO         0x00FFFFFF
+#define NV_PAVS_VOICE_CUR_ECNT                  0x3C
+#	define NV_PAVS_VOICE_CUR_ECNT_EACOUNT           0x0000FFFF
+#	define NV_PAVS_VOICE_CUR_ECNT_EFCOUNT           0xFFFF0000
+#define NV_PAVS_VOICE_PAR_STATE                 0x54
+#	define NV_PAVS_VOICE_PAR_STATE_PAUSED           (1 << 18)
+#	define NV_PAVS_VOICE_PAR_STATE_NEW_VOICE        (1 << 20)
+#	define NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE     (1 << 21)
+#	define NV_PAVS_VOICE_PAR_STATE_EACUR            0xF0000000
+#define NV_PAVS_VOICE_PAR_OFFSET                0x58
+#	define NV_PAVS_VOICE_PAR_OFFSET_CBO             0x00FFFFFF
+#define NV_PAVS_VOICE_PAR_NEXT                  0x5C
+#	define NV_PAVS_VOICE_PAR_NEXT_EBO               0x00FFFFFF
+#define NV_PAVS_VOICE_TAR_VOLA                  0x60
+#define NV_PAVS_VOICE_TAR_VOLB                  0x64
+#define NV_PAVS_VOICE_TAR_VOLC                  0x68
+#define NV_PAVS_VOICE_TAR_LFO_ENV               0x6C
+#	define NV_PAVS_VOICE_TAR_LFO_ENV_EA_RELEASERATE 0x00000FFF
+#define NV_PAVS_VOICE_TAR_FCA                   0x70
+#define NV_PAVS_VOICE_TAR_FCB                   0x74
+#define NV_PAVS_VOICE_TAR_PITCH_LINK            0x7C
+#	define NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE 0x0000FFFF
+#	define NV_PAVS_VOICE_TAR_PITCH_LINK_PITCH       0xFFFF0000
+
+#define APU_VP_SAMPLE_RATE      48000
+#define APU_VP_FRAME_SAMPLES    32
+#define APU_VP_MIXBINS          32
+#define APU_VP_MAX_VOICES       256
+#define APU_VP_VOICE_NONE       0xFFFF
+#define APU_VP_SSL_SEGMENTS     64
+#define APU_VP_SSL_LENGTH       0x00FFFFFF // Sample frames in a stream segment
+
+// Voice processor dumps, read by cxbxr-tool render-apu
+#define APU_VP_DUMP_MAGIC       0x56555041 // "APUV"
+#define APU_VP_DUMP_VERSION     1
+
+// NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE and NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE values
+#define APU_VP_CONTAINER_B8     0
+#define APU_VP_CONTAINER_B16    1
+#define APU_VP_CONTAINER_ADPCM  2
+#define APU_VP_CONTAINER_B32    3
+#define APU_VP_SAMPLE_U8        0
+#define APU_VP_SAMPLE_S16       1
+#define APU_VP_SAMPLE_S24       2
+#define APU_VP_SAMPLE_S32       3
+
+// Software model of the APU voice processor. Walks the voice lists in guest memory once per
+// frame of 32 samples, decodes buffer sources, applies pitch, amplitude envelope and volume,
+// and sums the result into 32 mixbins of 24 bit samples, which is what GP would consume.
+// Guest memory is reached through a plain pointer, so it runs the same on captured memory dumps.
+class APUVoiceProcessor {
+public:
+	// pMemory maps guest physical address 0, MemorySize must be a power of two.
+	APUVoiceProcessor(uint8_t* pMemory, uint32_t MemorySize);
+
+	void Reset();
+
+	// APU registers in NV_PAPU_VP_REGS_BASE range, returns false for anything else.
+	bool RegisterRead(uint32_t addr, uint32_t &value);
+	bool RegisterWrite(uint32_t addr, uint32_t value);
+
+	// Methods are executed as they are written, so the FIFO never fills up.
+	uint32_t MethodRead(uint32_t addr);
+	void MethodWrite(uint32_t addr, uint32_t value);
+
+	// Mixes one frame of all active voices into the mixbins.
+	void ProcessFrame();
+
+	// Writes the registers, the voice state and the whole guest memory, so that the voice lists can be
+	// rendered offline. LoadDump needs a processor on memory of the size PeekDump returns.
+	bool SaveDump(FILE* pFile);
+	bool LoadDump(FILE* pFile);
+	static bool PeekDump(FILE* pFile, uint32_t &MemorySize);
+
+	// Only stable between ProcessFrame calls.
+	const int32_t* GetMixBin(unsigned MixBin) const { return m_MixBins[MixBin]; }
+	uint64_t GetFrameCount() const { return m_FrameCount; }
+	unsigned GetVoicesLastFrame() const { return m_VoicesLastFrame; }
+
+private:
+	enum EnvelopeState {
+		ENVELOPE_OFF = 0,
+		ENVELOPE_DELAY,
+		ENVELOPE_ATTACK,
+		ENVELOPE_HOLD,
+		ENVELOPE_DECAY,
+		ENVELOPE_SUSTAIN,
+		ENVELOPE_RELEASE,
+	};
+
+	uint32_t ReadPhysical32(uint32_t addr) const;
+	void WritePhysical32(uint32_t addr, uint32_t value);
+	uint32_t VoiceGet(uint32_t handle, uint32_t offset, uint32_t mask) const;
+	void VoiceSet(uint32_t handle, uint32_t offset, uint32_t mask, uint32_t value);
+	// Copies from the buffer's virtual space, which is mapped in pages through scatter gather entries.
+	void ReadBuffer(uint32_t offset, uint8_t* pDst, uint32_t length) const;
+	void ReadPhysical(uint32_t addr, uint8_t* pDst, uint32_t length) const;
+
+	void VoiceOn(uint32_t handle);
+	void VoiceOff(uint32_t handle);
+	void VoiceRelease(uint32_t handle);
+	// Returns false for voices that are not active. Those stay linked until the title removes them.
+	bool ProcessVoice(uint32_t handle);
+	float StepEnvelope(uint32_t handle);
+	bool FetchSamples(uint32_t handle, float (&Samples)[2][APU_VP_FRAME_SAMPLES]);
+	// Decodes count sample frames of a stream voice from its segment lists, without pDst it only skips them.
+	// The position only moves when advance is set. Returns the frames available, fewer on an underrun.
+	uint32_t ReadStream(uint32_t handle, uint32_t count, unsigned channels, unsigned container,
+	                    unsigned sample_size, float* pDst, bool advance);
+	// Decodes count sample frames starting at index into interleaved floats. Buffer voices address ba
+	// through the scatter gather entries, stream segments are physical.
+	void DecodeSource(uint32_t ba, uint32_t index, uint32_t count, unsigned channels,
+	                  unsigned container, unsigned sample_size, float* pDst, bool stream);
+
+	uint8_t*    m_pMemory;
+	uint32_t    m_MemoryMask;
+	std::mutex  m_Mutex;
+	uint32_t    m_Regs[NV_PAPU_VP_REGS_SIZE / 4];
+	uint32_t    m_CurrentVoice;
+	uint32_t    m_AntecedentVoice;
+	// Sub sample position of each voice, 32 bit fraction. Not part of the voice descriptor.
+	uint32_t    m_VoiceFraction[APU_VP_MAX_VOICES];
+	// Envelope level a release started from, 0 to 255.
+	uint8_t     m_VoiceReleaseLevel[APU_VP_MAX_VOICES];
+	// Stream voices play segment list A, then B, then A again. A list is handed back to the driver by
+	// clearing its count once it's played. Kept here like XQEMU does, the voice descriptor has no room.
+	struct VoiceStream {
+		uint32_t Base[2];  // First entry in the stream segment lists
+		uint8_t  Count[2];
+		uint8_t  Current;
+		uint8_t  Segment;
+	};
+	VoiceStream m_VoiceStream[APU_VP_MAX_VOICES];
+	uint32_t    m_SslBasePage; // Entry the NV1BA0_PIO_SET_SSL_SEGMENT_* methods write to
+	float       m_Mix[APU_VP_MIXBINS][APU_VP_FRAME_SAMPLES];
+	int32_t     m_MixBins[APU_VP_MIXBINS][APU_VP_FRAME_SAMPLES];
+	// Scratch space for the source samples of one voice
+	std::vector<float>   m_Source;
+	std::vector<uint8_t> m_Encoded;
+	uint64_t    m_FrameCount;
+	unsigned    m_VoicesLastFrame;
+};
+
+#endif
@@ -1137,7 +1137,7 @@ void pgraph_handle_method(NV2AState *d,
 			context_surfaces_2d->dest_offset = parameter & 0x07FFFFFF;
 			break;
 		default:
-			EmuLog(LOG_LEVEL::WARNING, "Unknown NV_CONTEXT_SURFACES_2D Method: 0x%08X", method);
+			EmuLogSampled(LOG_LEVEL::WARNING, "Unknown NV_CONTEXT_SURFACES_2D Method: 0x%08X", method);
 		}
 	
 		break; 
@@ -1228,7 +1228,7 @@ void pgraph_handle_method(NV2AState *d,
 
 			break;
 		default:
-			EmuLog(LOG_LEVEL::WARNING, "Unknown NV_IMAGE_BLIT Method: 0x%08X", method);
+			EmuLogSampled(LOG_LEVEL::WARNING, "Unknown NV_IMAGE_BLIT Method: 0x%08X", method);
 		}
 		break;
 	}
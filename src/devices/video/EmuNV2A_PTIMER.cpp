@@ -42,12 +42,21 @@ static uint64_t ptimer_get_clock(NV2AState * d)
 {
 	// Get time in nanoseconds
     uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-	
-	return Muldiv64(Muldiv64(time,
-					(uint32_t)d->pramdac.core_clock_freq, // TODO : Research how this can be updated to accept uint64_t
-					NANOSECONDS_PER_SECOND), // Was CLOCKS_PER_SEC
-				d->ptimer.denominator,
-				d->ptimer.numerator);
+
+	// The counter runs at core_clock_freq * denominator / numerator, so only rebuild its conversion when one of them changes.
+	// It's rebased at the current time, so that the counter keeps counting up from its current value instead of jumping
+	if (d->ptimer.scale_core_clock_freq != d->pramdac.core_clock_freq ||
+		d->ptimer.scale_numerator != d->ptimer.numerator ||
+		d->ptimer.scale_denominator != d->ptimer.denominator) {
+		d->ptimer.scale_core_clock_freq = d->pramdac.core_clock_freq;
+		d->ptimer.scale_numerator = d->ptimer.numerator;
+		d->ptimer.scale_denominator = d->ptimer.denominator;
+		ClockScale_Rebase(&d->ptimer.scale, time,
+			(uint64_t)NANOSECONDS_PER_SECOND * d->ptimer.numerator, // Was CLOCKS_PER_SEC
+			d->pramdac.core_clock_freq * d->ptimer.denominator);
+	}
+
+	return ClockScale_Convert(&d->ptimer.scale, time);
 }
 
 DEVICE_READ32(PTIMER)
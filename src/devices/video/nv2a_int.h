@@ -39,6 +39,7 @@
 #include "common\util\gloffscreen\gloffscreen.h" // For GloContext, etc
 
 #include "swizzle.h"
+#include "Timer.h" // For ClockScale
 
 #include "nv2a_debug.h" // For HWADDR_PRIx, NV2A_DPRINTF, NV2A_GL_DPRINTF, etc.
 #include "nv2a_shaders.h" // For ShaderBinding, etc
@@ -410,6 +411,11 @@ typedef struct NV2AState {
         uint32_t numerator;
         uint32_t denominator;
         uint32_t alarm_time;
+		// Conversion of the host time to the counter, and the rates it was computed for
+		ClockScale scale;
+		uint64_t scale_core_clock_freq;
+		uint32_t scale_numerator;
+		uint32_t scale_denominator;
 		uint32_t regs[NV_PTIMER_SIZE]; // Not in xqemu/openxbox? TODO : union
     } ptimer;
 
@@ -50,6 +50,7 @@
 
 extern uint32_t GetAPUTime();
 extern std::atomic_bool g_bEnableAllInterrupts;
+ULONGLONG CxbxGetPerformanceCounter(bool acpi); // implemented in EmuKrnlKe.cpp
 
 //
 // Read & write handlers handlers for I/O
@@ -62,12 +63,8 @@ uint32_t EmuX86_IORead(xbaddr addr, int size)
 	switch (addr) {
 	case 0x8008: { // TODO : Move 0x8008 TIMER to a device
 		if (size == sizeof(uint32_t)) {
-			// HACK: This is very wrong.
-			// This timer should count at a specific frequency (3579.545 ticks per ms)
-			// But this is enough to keep NXDK from hanging for now.
-			LARGE_INTEGER performanceCount;
-			QueryPerformanceCounter(&performanceCount);
-			return static_cast<uint32_t>(performanceCount.QuadPart);
+			// This is the ACPI timer read by KeQueryPerformanceCounter, so it counts at the same rate
+			return static_cast<uint32_t>(CxbxGetPerformanceCounter(/*acpi=*/true));
 		}
 		break;
 	}
@@ -1289,7 +1286,6 @@ bool EmuX86_Opcode_PUSH(LPEXCEPTION_POINTERS e, _DInst& info)
 	return true;
 }
 
-ULONGLONG CxbxGetPerformanceCounter(bool acpi); // implemented in EmuKrnlKe.cpp
 void EmuX86_Opcode_RDTSC(LPEXCEPTION_POINTERS e)
 {
 	// We use CxbxGetPerformanceCounter. KeQueryPerformanceCounter is a differnet frequency and cannot be used!
@@ -2929,9 +2925,7 @@ bool EmuX86_DecodeException(LPEXCEPTION_POINTERS e)
 	// that case may be logged, but it shouldn't fail the opcode handler.
 	_DInst info;
 	DWORD StartingEip = e->ContextRecord->Eip;
-	LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) {
-			EmuLog(LOG_LEVEL::DEBUG, "Starting instruction emulation from 0x%08X", e->ContextRecord->Eip);
-	}
+	EmuLogSampled(LOG_LEVEL::DEBUG, "Starting instruction emulation from 0x%08X", e->ContextRecord->Eip);
 
 	// Execute op-codes until we hit an unhandled instruction, or an error occurs
 	//while (true)
@@ -2946,7 +2940,8 @@ bool EmuX86_DecodeException(LPEXCEPTION_POINTERS e)
 			return false;
 		}
 
-		LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) {
+		// Sampled before the disassembly is rendered, since this runs for every emulated instruction
+		LOG_CHECK_SAMPLED(LOG_LEVEL::DEBUG) {
 			EmuX86_DistormLogInstruction((uint8_t*)e->ContextRecord->Eip, info);
 		}
 
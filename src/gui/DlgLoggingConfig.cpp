@@ -23,6 +23,8 @@
 // *
 // ******************************************************************
 
+#include <algorithm>
+#include <string>
 #include "Logging.h"
 #include "EmuShared.h"
 #include "DlgLoggingConfig.h"
@@ -32,6 +34,7 @@
 
 static bool g_bHasChanges = false;
 static HWND g_ChildWnd = NULL;
+static unsigned int g_LogRateLimits[NUM_INTEGERS_LOG_RATE]; // Rate limits being edited, see log_get_rate_step
 INT_PTR CALLBACK DlgLogConfigProc(HWND hWndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 static int g_DlgIndexes[] = {
@@ -103,6 +106,14 @@ static int g_DlgIndexes[] = {
 };
 
 
+// Selects the rate limit of the module chosen in the rate limit module list
+static void LogRateShowModule(HWND hWndDlg)
+{
+	HWND hControl = GetDlgItem(hWndDlg, IDC_LOG_RATE_MODULE);
+	CXBXR_MODULE Module = (CXBXR_MODULE)SendMessage(hControl, CB_GETITEMDATA, SendMessage(hControl, CB_GETCURSEL, 0, 0), 0);
+	SendMessage(GetDlgItem(hWndDlg, IDC_LOG_RATE_LIMIT), CB_SETCURSEL, log_get_rate_step(g_LogRateLimits, Module), 0);
+}
+
 VOID ShowLoggingConfig(HWND hwnd, HWND ChildWnd)
 {
 	g_ChildWnd = ChildWnd;
@@ -150,6 +161,32 @@ INT_PTR CALLBACK DlgLogConfigProc(HWND hWndDlg, UINT uMsg, WPARAM wParam, LPARAM
 				(void)SendMessage(GetDlgItem(hWndDlg, IDC_LOG_POPUP_TESTCASE), BM_SETCHECK, BST_CHECKED, 0);
 			}
 
+			// Log governor, the sampling counts are stored in 16 bits
+			SendMessage(GetDlgItem(hWndDlg, IDC_LOG_SAMPLE_FIRST), EM_SETLIMITTEXT, 5, 0);
+			SendMessage(GetDlgItem(hWndDlg, IDC_LOG_SAMPLE_EVERY), EM_SETLIMITTEXT, 5, 0);
+			SetDlgItemInt(hWndDlg, IDC_LOG_SAMPLE_FIRST, g_Settings->m_core.LogSampleFirst, FALSE);
+			SetDlgItemInt(hWndDlg, IDC_LOG_SAMPLE_EVERY, g_Settings->m_core.LogSampleEvery, FALSE);
+			if (g_Settings->m_core.bLogDeduplicate) {
+				(void)SendMessage(GetDlgItem(hWndDlg, IDC_LOG_DEDUPLICATE), BM_SETCHECK, BST_CHECKED, 0);
+			}
+
+			std::copy(std::begin(g_Settings->m_core.LogRateLimits), std::end(g_Settings->m_core.LogRateLimits), g_LogRateLimits);
+			hHandle = GetDlgItem(hWndDlg, IDC_LOG_RATE_MODULE);
+			for (index = to_underlying(CXBXR_MODULE::CXBXR); index < to_underlying(CXBXR_MODULE::MAX); index++) {
+				char ModuleName[16];
+				GetDlgItemText(hWndDlg, g_DlgIndexes[index], ModuleName, sizeof(ModuleName));
+				LRESULT item = SendMessage(hHandle, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(ModuleName));
+				SendMessage(hHandle, CB_SETITEMDATA, item, index);
+			}
+			SendMessage(hHandle, CB_SETCURSEL, 0, 0);
+			hHandle = GetDlgItem(hWndDlg, IDC_LOG_RATE_LIMIT);
+			for (unsigned int step = 0; step < std::size(LOG_RATE_LIMIT_STEPS); step++) {
+				std::string RateText = (step == 0) ? "No limit" : std::to_string(LOG_RATE_LIMIT_STEPS[step]);
+				LRESULT item = SendMessage(hHandle, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(RateText.c_str()));
+				SendMessage(hHandle, CB_SETITEMDATA, item, step);
+			}
+			LogRateShowModule(hWndDlg);
+
 			counter = 0;
 			for (index = to_underlying(CXBXR_MODULE::CXBXR); index < to_underlying(CXBXR_MODULE::KRNL); index++) {
 				if (LoggedModules[index / 32] & (1 << (index % 32))) {
@@ -244,13 +281,25 @@ INT_PTR CALLBACK DlgLogConfigProc(HWND hWndDlg, UINT uMsg, WPARAM wParam, LPARAM
 							LogPopupTestCase = true;
 						}
 
+						unsigned int LogSampleFirst = std::min(GetDlgItemInt(hWndDlg, IDC_LOG_SAMPLE_FIRST, nullptr, FALSE), 0xFFFFu);
+						unsigned int LogSampleEvery = std::min(GetDlgItemInt(hWndDlg, IDC_LOG_SAMPLE_EVERY, nullptr, FALSE), 0xFFFFu);
+						bool LogDeduplicate = false;
+						if (SendMessage(GetDlgItem(hWndDlg, IDC_LOG_DEDUPLICATE), BM_GETCHECK, 0, 0) == BST_CHECKED) {
+							LogDeduplicate = true;
+						}
+
 						g_Settings->m_core.LoggedModules[0] = LoggedModules[0];
 						g_Settings->m_core.LoggedModules[1] = LoggedModules[1];
 						g_Settings->m_core.LogLevel = LogLevel;
 						g_Settings->m_core.bLogPopupTestCase = LogPopupTestCase;
+						g_Settings->m_core.LogSampleFirst = (unsigned short)LogSampleFirst;
+						g_Settings->m_core.LogSampleEvery = (unsigned short)LogSampleEvery;
+						std::copy(std::begin(g_LogRateLimits), std::end(g_LogRateLimits), g_Settings->m_core.LogRateLimits);
+						g_Settings->m_core.bLogDeduplicate = LogDeduplicate;
 
 						// Update the logging variables for the GUI process
 						log_set_config(LogLevel, LoggedModules, LogPopupTestCase);
+						log_set_governor(LogSampleFirst, LogSampleEvery, g_LogRateLimits, LogDeduplicate);
 						log_generate_active_filter_output(CXBXR_MODULE::GUI);
 
 						// Also inform the kernel process if it exists
@@ -259,6 +308,9 @@ INT_PTR CALLBACK DlgLogConfigProc(HWND hWndDlg, UINT uMsg, WPARAM wParam, LPARAM
 							g_EmuShared->SetLogLv(&LogLevel);
 							g_EmuShared->SetLogModules(LoggedModules);
 							g_EmuShared->SetLogPopupTestCase(LogPopupTestCase);
+							g_EmuShared->SetLogSampling(LogSampleFirst, LogSampleEvery);
+							g_EmuShared->SetLogRateLimits(g_LogRateLimits);
+							g_EmuShared->SetLogDeduplicate(LogDeduplicate);
 							ipc_send_kernel_update(IPC_UPDATE_KERNEL::CONFIG_LOGGING_SYNC, 0, reinterpret_cast<std::uintptr_t>(g_ChildWnd));
 						}
 					}
@@ -273,7 +325,32 @@ INT_PTR CALLBACK DlgLogConfigProc(HWND hWndDlg, UINT uMsg, WPARAM wParam, LPARAM
 					break;
 
 				case IDC_LOG_POPUP_TESTCASE:
-					if (HIWORD(wParam) == BN_CLICKED) {
+				case IDC_LOG_DEDUPLICATE:
+					if (HIWORD(wParam) == BN_CLICKED) {
+						g_bHasChanges = true;
+					}
+					break;
+
+				case IDC_LOG_SAMPLE_FIRST:
+				case IDC_LOG_SAMPLE_EVERY:
+					if (HIWORD(wParam) == EN_CHANGE) {
+						g_bHasChanges = true;
+					}
+					break;
+
+				case IDC_LOG_RATE_MODULE:
+					if (HIWORD(wParam) == CBN_SELCHANGE) {
+						LogRateShowModule(hWndDlg);
+					}
+					break;
+
+				case IDC_LOG_RATE_LIMIT:
+					if (HIWORD(wParam) == CBN_SELCHANGE) {
+						HWND hControl = GetDlgItem(hWndDlg, IDC_LOG_RATE_MODULE);
+						CXBXR_MODULE Module = (CXBXR_MODULE)SendMessage(hControl, CB_GETITEMDATA, SendMessage(hControl, CB_GETCURSEL, 0, 0), 0);
+						hControl = GetDlgItem(hWndDlg, IDC_LOG_RATE_LIMIT);
+						unsigned int Step = (unsigned int)SendMessage(hControl, CB_GETITEMDATA, SendMessage(hControl, CB_GETCURSEL, 0, 0), 0);
+						log_set_rate_step(g_LogRateLimits, Module, Step);
 						g_bHasChanges = true;
 					}
 					break;
@@ -2017,14 +2017,9 @@ void WndMain::OpenXbe(const char *x_filename)
 	}
 
 	if (!g_Settings->m_gui.bIgnoreInvalidXbeSec) {
-		for (uint32_t sectionIndex = 0; sectionIndex < m_Xbe->m_Header.dwSections; sectionIndex++) {
-			if (!m_Xbe->CheckSectionIntegrity(sectionIndex)) {
-				errorMsg += "- One or more XBE section(s) are corrupted!\n";
-
-				// if we find a corrupted section, we won't bother checking the remaining sections since we know
-				// already at this point that the xbe is invalid
-				break;
-			}
+		std::vector<bool> sectionValid;
+		if (m_Xbe->CheckSectionsIntegrity(sectionValid) != 0) {
+			errorMsg += "- One or more XBE section(s) are corrupted!\n";
 		}
 	}
 
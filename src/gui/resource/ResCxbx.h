@@ -304,6 +304,12 @@
 #define IDC_RUMBLE_TEST                 1302
 #define IDC_NETWORK_ADAPTER             1303
 #define IDC_LOG_POPUP_TESTCASE          1304
+#define IDC_LOG_GOVERNOR                1305
+#define IDC_LOG_SAMPLE_FIRST            1306
+#define IDC_LOG_SAMPLE_EVERY            1307
+#define IDC_LOG_DEDUPLICATE             1308
+#define IDC_LOG_RATE_MODULE             1309
+#define IDC_LOG_RATE_LIMIT              1310
 #define ID_FILE_EXIT                    40005
 #define ID_HELP_ABOUT                   40008
 #define ID_EMULATION_START              40009
@@ -374,7 +380,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        136
 #define _APS_NEXT_COMMAND_VALUE         40117
-#define _APS_NEXT_CONTROL_VALUE         1305
+#define _APS_NEXT_CONTROL_VALUE         1311
 #define _APS_NEXT_SYMED_VALUE           109
 #endif
 #endif
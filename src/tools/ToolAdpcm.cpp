@@ -0,0 +1,248 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "common/XADPCM.h"
+#include "Tools.h"
+
+#define ADPCM_TEST_BLOCKS       20000 // Per channel count
+#define ADPCM_TEST_MAX_CHANNELS 6
+#define ADPCM_TEST_BENCH_BLOCKS 4096
+#define ADPCM_TEST_BENCH_ROUNDS 200
+
+// The streaming decoder that the per block ones replaced, kept as the reference. It only had room for
+// two channels, the loops are the same for more
+static int ReferenceDecode(const uint8_t *in, int inlen, uint8_t *out, const int FChannels)
+{
+	TAdpcmState FAdpcmState[ADPCM_TEST_MAX_CHANNELS];
+	int16_t Buffers[ADPCM_TEST_MAX_CHANNELS][8];
+	uint32_t CodeBuf;
+	int outlen;
+
+	inlen = (inlen / XBOX_ADPCM_SRCSIZE) / FChannels;
+
+	for (outlen = 0; inlen--; outlen++) {
+		for (int c = 0; c < FChannels; c++) {
+			*out++ = in[0];
+			*out++ = in[1];
+			FAdpcmState[c].Predictor = in[0] | (in[1] << 8);    in += 2;
+			FAdpcmState[c].Index = in[0] | (in[1] << 8);    in += 2;
+			if (FAdpcmState[c].Index > 88) {
+				FAdpcmState[c].Index = 88;
+			} else if (FAdpcmState[c].Index < 0) {
+				FAdpcmState[c].Index = 0;
+			}
+			FAdpcmState[c].StepSize = StepTable[FAdpcmState[c].Index];
+		}
+		for (int i = 0; i < 8; i++) {
+			for (int c = 0; c < FChannels; c++) {
+				CodeBuf = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+				in += 4;
+				for (int j = 0; j < 8; j++) {
+					Buffers[c][j] = TXboxAdpcmDecoder_DecodeSample(CodeBuf & 15, &FAdpcmState[c]);
+					CodeBuf >>= 4;
+				}
+			}
+			for (int j = 0; j < 8; j++) {
+				for (int c = 0; c < FChannels; c++) {
+					*out++ = (Buffers[c][j]) & 0xff;
+					*out++ = (Buffers[c][j] >> 8) & 0xff;
+				}
+			}
+		}
+	}
+	return(outlen * XBOX_ADPCM_DSTSIZE * FChannels);
+}
+
+// Random blocks, with headers that also cover the clamping : predictors at the limits, and indices
+// above 88, negative, or with garbage in the high byte that the decoders ignore
+static void RandomBlocks(std::vector<uint8_t>& Data, std::mt19937& Random)
+{
+	for (uint8_t& Byte : Data) {
+		Byte = (uint8_t)Random();
+	}
+
+	for (size_t Header = 0; Header + 4 <= Data.size(); Header += XBOX_ADPCM_SRCSIZE) {
+		static const int16_t Predictors[] = { 32767, -32768, 0, -1 };
+		static const uint8_t Indices[] = { 0, 88, 89, 127, 128, 255 };
+		unsigned Kind = Random() % 4;
+		if (Kind == 0) {
+			int16_t Predictor = Predictors[Random() % 4];
+			Data[Header] = (uint8_t)Predictor;
+			Data[Header + 1] = (uint8_t)(Predictor >> 8);
+		}
+		if (Kind <= 1) {
+			Data[Header + 2] = Indices[Random() % 6];
+		} else {
+			Data[Header + 2] = (uint8_t)(Random() % 89);
+		}
+	}
+}
+
+// An FNV-1a digest of the reference output for seed 1, so that a change to the reference itself shows up too
+static uint32_t Digest(const std::vector<uint8_t>& Data)
+{
+	uint32_t Hash = 2166136261u;
+	for (uint8_t Byte : Data) {
+		Hash = (Hash ^ Byte) * 16777619u;
+	}
+	return Hash;
+}
+
+#define ADPCM_TEST_REFERENCE_DIGEST 0x56e1e650u
+
+// Known blocks : silence stays at the predictor, and a run of the largest code saturates
+static int KnownVectors()
+{
+	int failures = 0;
+	uint8_t Block[XBOX_ADPCM_SRCSIZE] = {};
+	int16_t Samples[XBOX_ADPCM_DSTSIZE / 2];
+
+	Block[0] = 0x34;
+	Block[1] = 0x12;
+	TXboxAdpcmDecoder_DecodeBlock(Block, Samples, 1);
+	bool passed = true;
+	for (int16_t Sample : Samples) {
+		// Code 0 adds Step >> 3, which is 0 while the index stays at 0 (step 7)
+		passed = passed && (Sample == 0x1234);
+	}
+	printf("Adpcm: a silent block holds its predictor %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	memset(Block + 4, 0x77, XBOX_ADPCM_SRCSIZE - 4);
+	Block[0] = 0;
+	Block[1] = 0;
+	TXboxAdpcmDecoder_DecodeBlock(Block, Samples, 1);
+	// Code 7 at step 7 adds 7 + (7 >> 1) + (7 >> 2) + (7 >> 3)
+	passed = (Samples[0] == 0) && (Samples[1] == 11) && (Samples[XBOX_ADPCM_DSTSIZE / 2 - 1] == 32767);
+	printf("Adpcm: the largest code climbs the steps and saturates at 32767 %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	return failures;
+}
+
+int ToolAdpcm(int argc, char** argv)
+{
+	unsigned Blocks = (argc > 0) ? (unsigned)strtoul(argv[0], nullptr, 0) : ADPCM_TEST_BLOCKS;
+	unsigned Seed = (argc > 1) ? (unsigned)strtoul(argv[1], nullptr, 0) : 1;
+	int failures = KnownVectors();
+
+	std::mt19937 Random(Seed);
+	std::vector<uint8_t> All;
+	for (int Channels = 1; Channels <= ADPCM_TEST_MAX_CHANNELS; Channels++) {
+		std::vector<uint8_t> In(Blocks * Channels * XBOX_ADPCM_SRCSIZE);
+		RandomBlocks(In, Random);
+		size_t OutBytes = Blocks * Channels * XBOX_ADPCM_DSTSIZE;
+		std::vector<uint8_t> Expected(OutBytes);
+		std::vector<uint8_t> Out(OutBytes);
+		int ExpectedLength = ReferenceDecode(In.data(), (int)In.size(), Expected.data(), Channels);
+		All.insert(All.end(), Expected.begin(), Expected.end());
+
+		// Every entry point that applies to the channel count, one block at a time and in bulk
+		unsigned Mismatches = 0;
+		unsigned Paths = 0;
+		auto Compare = [&](const char* Path) {
+			bool Same = (memcmp(Out.data(), Expected.data(), OutBytes) == 0);
+			Mismatches += !Same;
+			Paths++;
+			if (!Same) {
+				printf("Adpcm: %s differs from the reference with %d channels\n", Path, Channels);
+			}
+			memset(Out.data(), 0xCD, OutBytes);
+		};
+
+		for (unsigned b = 0; b < Blocks; b++) {
+			TXboxAdpcmDecoder_DecodeBlock(In.data() + b * Channels * XBOX_ADPCM_SRCSIZE, (int16_t*)(Out.data() + b * Channels * XBOX_ADPCM_DSTSIZE), Channels);
+		}
+		Compare("DecodeBlock");
+
+		if (Channels == 2) {
+			for (unsigned b = 0; b < Blocks; b++) {
+				TXboxAdpcmDecoder_DecodeBlockStereo(In.data() + b * 2 * XBOX_ADPCM_SRCSIZE, (int16_t*)(Out.data() + b * 2 * XBOX_ADPCM_DSTSIZE));
+			}
+			Compare("DecodeBlockStereo");
+		}
+		if (Channels == 1) {
+			for (unsigned b = 0; b + 1 < Blocks; b += 2) {
+				TXboxAdpcmDecoder_DecodeBlockMonoPair(In.data() + b * XBOX_ADPCM_SRCSIZE, (int16_t*)(Out.data() + b * XBOX_ADPCM_DSTSIZE));
+			}
+			if (Blocks & 1) {
+				TXboxAdpcmDecoder_DecodeBlock(In.data() + (Blocks - 1) * XBOX_ADPCM_SRCSIZE, (int16_t*)(Out.data() + (Blocks - 1) * XBOX_ADPCM_DSTSIZE), 1);
+			}
+			Compare("DecodeBlockMonoPair");
+
+			// An odd count leaves a single block for the tail of DecodeBlocks
+			if (Blocks > 1) {
+				TXboxAdpcmDecoder_DecodeBlocks(In.data(), (int16_t*)Out.data(), Blocks - 1, 1);
+				memcpy(Out.data() + (Blocks - 1) * XBOX_ADPCM_DSTSIZE, Expected.data() + (Blocks - 1) * XBOX_ADPCM_DSTSIZE, XBOX_ADPCM_DSTSIZE);
+				Compare("DecodeBlocks (odd count)");
+			}
+		}
+
+		TXboxAdpcmDecoder_DecodeBlocks(In.data(), (int16_t*)Out.data(), Blocks, Channels);
+		Compare("DecodeBlocks");
+
+		int Length = TXboxAdpcmDecoder_Decode_Memory(In.data(), (int)In.size(), Out.data(), Channels);
+		Mismatches += (Length != ExpectedLength);
+		Compare("Decode_Memory");
+
+		bool passed = (Mismatches == 0);
+		printf("Adpcm, %d channel%s: %u blocks through %u paths, bit exact with the reference decoder %s\n",
+			Channels, Channels > 1 ? "s" : "", Blocks, Paths, passed ? "passed" : "FAILED");
+		failures += !passed;
+	}
+
+	if ((Blocks == ADPCM_TEST_BLOCKS) && (Seed == 1)) {
+		uint32_t Hash = Digest(All);
+		bool passed = (Hash == ADPCM_TEST_REFERENCE_DIGEST);
+		printf("Adpcm: reference output digest %08x %s\n", Hash, passed ? "passed" : "FAILED");
+		failures += !passed;
+	}
+
+	// Throughput of the reference and of the fast paths, in decoded samples per second
+	for (int Channels = 1; Channels <= 2; Channels++) {
+		std::vector<uint8_t> In(ADPCM_TEST_BENCH_BLOCKS * Channels * XBOX_ADPCM_SRCSIZE);
+		std::vector<uint8_t> Out(ADPCM_TEST_BENCH_BLOCKS * Channels * XBOX_ADPCM_DSTSIZE);
+		RandomBlocks(In, Random);
+		double Samples = (double)ADPCM_TEST_BENCH_ROUNDS * ADPCM_TEST_BENCH_BLOCKS * Channels * (XBOX_ADPCM_DSTSIZE / 2);
+
+		auto Start = std::chrono::steady_clock::now();
+		for (unsigned Round = 0; Round < ADPCM_TEST_BENCH_ROUNDS; Round++) {
+			ReferenceDecode(In.data(), (int)In.size(), Out.data(), Channels);
+		}
+		auto Middle = std::chrono::steady_clock::now();
+		for (unsigned Round = 0; Round < ADPCM_TEST_BENCH_ROUNDS; Round++) {
+			TXboxAdpcmDecoder_DecodeBlocks(In.data(), (int16_t*)Out.data(), ADPCM_TEST_BENCH_BLOCKS, Channels);
+		}
+		auto End = std::chrono::steady_clock::now();
+		printf("Adpcm %s: %.0f M samples/s reference, %.0f M samples/s per block\n", Channels == 1 ? "mono" : "stereo",
+			Samples / std::chrono::duration<double>(Middle - Start).count() / 1e6, Samples / std::chrono::duration<double>(End - Middle).count() / 1e6);
+	}
+
+	return failures;
+}
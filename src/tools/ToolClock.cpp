@@ -0,0 +1,273 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "common/ClockScale.h"
+#include "Tools.h"
+
+#define CLOCK_TEST_SAMPLES     200000    // Tick values checked per frequency pair
+#define CLOCK_TEST_PRODUCTS    2000000   // Random products checked between the two multiply paths
+#define CLOCK_TEST_BENCH_TICKS (1 << 22)
+
+// The exact 128 bit arithmetic the conversions are checked against, written out on hosts without a 128 bit type
+struct U128
+{
+	uint64_t High;
+	uint64_t Low;
+};
+
+static U128 Multiply(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 Product = (unsigned __int128)a * b;
+	return { (uint64_t)(Product >> 64), (uint64_t)Product };
+#else
+	// Schoolbook over 16 bit digits, so that no partial sum can overflow
+	uint32_t Digits[8] = {};
+	for (int i = 0; i < 4; i++) {
+		uint32_t Carry = 0;
+		for (int j = 0; j < 4; j++) {
+			uint32_t Sum = ((uint32_t)(a >> (16 * i)) & 0xFFFF) * ((uint32_t)(b >> (16 * j)) & 0xFFFF);
+			uint64_t Total = (uint64_t)Digits[i + j] + (Sum & 0xFFFF) + Carry;
+			Digits[i + j] = (uint32_t)(Total & 0xFFFF);
+			Carry = (uint32_t)(Total >> 16) + (Sum >> 16);
+		}
+		for (int k = i + 4; Carry != 0 && k < 8; k++) {
+			uint32_t Total = Digits[k] + Carry;
+			Digits[k] = Total & 0xFFFF;
+			Carry = Total >> 16;
+		}
+	}
+	U128 Result = { 0, 0 };
+	for (int k = 0; k < 4; k++) {
+		Result.Low |= (uint64_t)Digits[k] << (16 * k);
+		Result.High |= (uint64_t)Digits[k + 4] << (16 * k);
+	}
+	return Result;
+#endif
+}
+
+// Low 64 bits of Value >> Shift
+static uint64_t ShiftRight(U128 Value, unsigned Shift)
+{
+	if (Shift == 0) {
+		return Value.Low;
+	}
+	if (Shift >= 64) {
+		return Value.High >> (Shift - 64);
+	}
+	return (Value.Low >> Shift) | (Value.High << (64 - Shift));
+}
+
+// Value / Divisor, one bit at a time, and only the low 64 bits of the quotient
+static uint64_t Divide(U128 Value, uint64_t Divisor)
+{
+	uint64_t Remainder = 0;
+	uint64_t Quotient = 0;
+	for (int Bit = 127; Bit >= 0; Bit--) {
+		uint64_t Top = Remainder >> 63;
+		Remainder = (Remainder << 1) | (((Bit >= 64 ? Value.High >> (Bit - 64) : Value.Low >> Bit)) & 1);
+		Quotient <<= 1;
+		if (Top || Remainder >= Divisor) {
+			Remainder -= Divisor;
+			Quotient |= 1;
+		}
+	}
+	return Quotient;
+}
+
+// Floor of Ticks * To / From, when it fits in 64 bits
+static uint64_t ExactConvert(uint64_t Ticks, uint64_t From, uint64_t To)
+{
+	return Divide(Multiply(Ticks, To), From);
+}
+
+// The 128 bit path of ClockScale_Convert, also on hosts where the header picks the partial products
+static inline uint64_t Convert128(const ClockScale* Scale, uint64_t Ticks)
+{
+	return Scale->BaseValue + ShiftRight(Multiply(Ticks - Scale->BaseTicks, Scale->Multiplier), Scale->Shift);
+}
+
+struct FrequencyPair
+{
+	const char* Name;
+	uint64_t From;
+	uint64_t To;
+};
+
+static const FrequencyPair Pairs[] = {
+	{ "10 MHz host clock to ns", 10000000, 1000000000 },
+	{ "10 MHz host clock to us", 10000000, 1000000 },
+	{ "3 GHz host tsc to ns", 3000000000ull, 1000000000 },
+	{ "host clock to Xbox tsc", 10000000, 733333333 },
+	{ "host clock to Xbox acpi", 10000000, 3375000 },
+	{ "2.4 GHz tsc to Xbox tsc", 2400000000ull, 733333333 },
+	{ "nv2a ptimer 16.6 MHz", 733333333, 16666666 },
+	{ "1 Hz to 1 Hz", 1, 1 },
+	{ "3 Hz to 7 Hz", 3, 7 },
+	{ "2^32 - 1 Hz to ns", 0xFFFFFFFFull, 1000000000 },
+	{ "ns to 2^40 Hz", 1000000000, 1ull << 40 },
+};
+
+// Checks the conversion of one frequency pair against the exact result, over ticks that keep the result in 64 bits.
+// ClockScale truncates the multiplier, so it may come out short, but by no more than Ticks / 2^Shift + 1
+static int CheckPair(const FrequencyPair& Pair, std::mt19937_64& Random)
+{
+	ClockScale Scale;
+	ClockScale_Init(&Scale, Pair.From, Pair.To);
+
+	// The largest tick count whose result still fits
+	uint64_t MaxTicks = (Pair.To <= Pair.From) ? UINT64_MAX : ExactConvert(UINT64_MAX, Pair.To, Pair.From);
+	uint64_t MaxError = 0;
+	unsigned Bad = 0;
+	for (unsigned i = 0; i < CLOCK_TEST_SAMPLES; i++) {
+		// Mostly uniform over the bits, so small and huge tick counts are both covered, and a few edges
+		uint64_t Ticks = Random() >> (Random() % 64);
+		if (i < 4) {
+			const uint64_t Edges[] = { 0, 1, MaxTicks - 1, MaxTicks };
+			Ticks = Edges[i];
+		}
+		if (Ticks > MaxTicks) {
+			Ticks %= MaxTicks;
+		}
+
+		uint64_t Exact = ExactConvert(Ticks, Pair.From, Pair.To);
+		uint64_t Value = ClockScale_Convert(&Scale, Ticks);
+		uint64_t Bound = (Scale.Shift >= 64 ? 0 : Ticks >> Scale.Shift) + 1;
+		uint64_t Error = Exact - Value;
+		if ((Value > Exact) || (Error > Bound) || (Value != Convert128(&Scale, Ticks)) ||
+			(Value != Scale.BaseValue + ClockScale_MulShift32(Ticks, Scale.Multiplier, Scale.Shift))) {
+			Bad++;
+		}
+		if (Value <= Exact && Error > MaxError) {
+			MaxError = Error;
+		}
+	}
+
+	// One second of source ticks must give one second of destination ticks, give or take a tick
+	uint64_t Second = ClockScale_Convert(&Scale, Pair.From);
+	bool passed = (Bad == 0) && (Second + 1 >= Pair.To) && (Second <= Pair.To);
+	printf("%-26s shift %2u, largest error %llu ticks %s\n", Pair.Name, Scale.Shift, (unsigned long long)MaxError, passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+// Rebasing keeps the value continuous at the rebase point, and continues at the new rate from there
+static int CheckRebase(std::mt19937_64& Random)
+{
+	unsigned Bad = 0;
+	for (unsigned i = 0; i < 10000; i++) {
+		uint64_t From = (Random() % 4000000000ull) + 1;
+		uint64_t To = (Random() % 4000000000ull) + 1;
+		uint64_t NewTo = (Random() % 4000000000ull) + 1;
+		uint64_t Ticks = Random() >> 20;
+		uint64_t Later = Random() >> 24;
+
+		ClockScale Scale;
+		ClockScale_Init(&Scale, From, To);
+		uint64_t Before = ClockScale_Convert(&Scale, Ticks);
+		ClockScale_Rebase(&Scale, Ticks, From, NewTo);
+		uint64_t After = ClockScale_Convert(&Scale, Ticks);
+		uint64_t Elapsed = ClockScale_Convert(&Scale, Ticks + Later) - After;
+		uint64_t Exact = ExactConvert(Later, From, NewTo);
+		if ((After != Before) || (Elapsed > Exact) || (Exact - Elapsed > (Later >> Scale.Shift) + 1)) {
+			Bad++;
+		}
+	}
+
+	printf("Rebase continuity and rate %s\n", (Bad == 0) ? "passed" : "FAILED");
+	return (Bad == 0) ? 0 : 1;
+}
+
+// The 32 bit partial products must match the 128 bit product bit for bit, for any operands and shift
+static int CheckPartialProducts(std::mt19937_64& Random)
+{
+	unsigned Bad = 0;
+	for (unsigned i = 0; i < CLOCK_TEST_PRODUCTS; i++) {
+		uint64_t Delta = Random() >> (Random() % 64);
+		uint64_t Multiplier = Random() >> (Random() % 64);
+		unsigned Shift = (unsigned)(Random() % 64);
+		if (i < 64) {
+			Delta = UINT64_MAX;
+			Multiplier = UINT64_MAX;
+			Shift = i;
+		}
+		if (ClockScale_MulShift32(Delta, Multiplier, Shift) != ShiftRight(Multiply(Delta, Multiplier), Shift)) {
+			Bad++;
+		}
+	}
+
+	printf("32 bit partial products match the 128 bit product %s (%u of %u differ)\n", (Bad == 0) ? "passed" : "FAILED", Bad, CLOCK_TEST_PRODUCTS);
+	return (Bad == 0) ? 0 : 1;
+}
+
+// Times a conversion over the same ticks, returns ns per conversion
+template<typename Function>
+static double Time(const std::vector<uint64_t>& Ticks, uint64_t& Sink, Function Convert)
+{
+	auto Start = std::chrono::steady_clock::now();
+	uint64_t Sum = 0;
+	for (uint64_t t : Ticks) {
+		Sum += Convert(t);
+	}
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	Sink += Sum;
+	return Seconds * 1e9 / Ticks.size();
+}
+
+int ToolClockScale(int argc, char** argv)
+{
+	std::mt19937_64 Random(1);
+	int failures = 0;
+
+	for (const auto& Pair : Pairs) {
+		failures += CheckPair(Pair, Random);
+	}
+	failures += CheckRebase(Random);
+	failures += CheckPartialProducts(Random);
+
+	// Benchmark the host clock to ns conversion, the one behind every GetTime_NS
+	ClockScale Scale;
+	ClockScale_Init(&Scale, 10000000, 1000000000);
+	std::vector<uint64_t> Ticks(CLOCK_TEST_BENCH_TICKS);
+	uint64_t Now = 123456789012ull;
+	for (auto& t : Ticks) {
+		Now += Random() % 1000;
+		t = Now;
+	}
+
+	// The division is timed with frequencies the compiler can't see, like the ones read from the host at run time
+	volatile uint64_t Frequencies[2] = { 10000000, 1000000000 };
+	uint64_t From = Frequencies[0], To = Frequencies[1];
+	uint64_t Sink = 0;
+	double Native = Time(Ticks, Sink, [&Scale](uint64_t t) { return ClockScale_Convert(&Scale, t); });
+	double Partial = Time(Ticks, Sink, [&Scale](uint64_t t) { return Scale.BaseValue + ClockScale_MulShift32(t - Scale.BaseTicks, Scale.Multiplier, Scale.Shift); });
+	double Division = Time(Ticks, Sink, [From, To](uint64_t t) { return ExactConvert(t, From, To); });
+	double Split = Time(Ticks, Sink, [From, To](uint64_t t) { return (t / From) * To + (t % From) * To / From; });
+	printf("Conversion: %.2f ns ClockScale_Convert, %.2f ns 32 bit partial products, %.2f ns quotient and remainder division, %.1f ns 128 bit long division (checksum %llx)\n",
+		Native, Partial, Split, Division, (unsigned long long)(Sink & 0xFFFF));
+
+	return failures;
+}
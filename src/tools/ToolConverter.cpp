@@ -0,0 +1,212 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "common/audio/converter.hpp"
+#include "Tools.h"
+
+#define CONVERTER_TEST_FREQUENCIES  (1u << 22) // Every frequency up to this one is checked, beyond it a sample
+#define CONVERTER_TEST_SAMPLE_STEP  4099
+#define CONVERTER_TEST_BENCH_CALLS  10000000
+
+// The conversions before the tables, in float math
+static int32_t FloatFreq2Pitch(uint32_t freq)
+{
+	return static_cast<int32_t>(log2(freq / 48000.0f) * 4096.0f);
+}
+
+static uint32_t FloatPitch2Freq(int32_t pitch)
+{
+	return static_cast<uint32_t>(exp((pitch / 4096.0f) * log(2)) * 48000.0f);
+}
+
+static float FloatVolume2Gain(int32_t volume)
+{
+	return powf(10.0f, volume / 2000.0f);
+}
+
+// The references are computed in long double. Where that is no wider than double (msvc), a result that lands
+// within a few ulps of a rounding boundary can't be decided by it, those are counted apart instead of as errors
+static bool NearBoundary(long double Value, long double Tolerance)
+{
+	return fabsl(Value - roundl(Value)) <= Tolerance;
+}
+
+// 48000 * 2^n, where log2 is exact
+static bool IsWholeOctave(uint32_t Freq)
+{
+	return (Freq % 375 == 0) && (((Freq / 375) & (Freq / 375 - 1)) == 0);
+}
+
+static int CheckTables()
+{
+	const converter_tables& Tables = converter_get_tables();
+	double Worst[4] = {};
+
+	for (int i = 0; i < 4096; i++) {
+		long double Exact = exp2l(i / 4096.0L);
+		Worst[0] = fmax(Worst[0], (double)(fabsl(Tables.pitch2ratio[i] - Exact) / Exact));
+	}
+	for (int i = 0; i <= 1024; i++) {
+		long double Exact = log2l(1.0L + i / 1024.0L);
+		Worst[1] = fmax(Worst[1], (double)fabsl(Tables.log2_mantissa[i] - Exact));
+	}
+	for (int i = 0; i < 35; i++) {
+		Worst[2] = fmax(Worst[2], fabs(Tables.octave2freq[i] - ldexp(48000.0, i - 17)));
+	}
+	for (int i = 0; i < 2000; i++) {
+		long double Exact = powl(10.0L, -i / 2000.0L);
+		Worst[3] = fmax(Worst[3], (double)(fabsl(Tables.volume2gain[i] - Exact) / Exact));
+	}
+
+	// Doubles within an ulp (2^-52 relative), the octaves exact, the gains within half a float ulp (2^-24)
+	bool passed = (Worst[0] <= ldexp(1.0, -52)) && (Worst[1] <= ldexp(1.0, -52)) && (Worst[2] == 0.0) && (Worst[3] <= ldexp(1.0, -24));
+	printf("Tables: pitch ratio %.2g, log2 mantissa %.2g, octave %.2g, gain %.2g worst error %s\n",
+		Worst[0], Worst[1], Worst[2], Worst[3], passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+// freq2pitch truncates log2(freq / 48000) * 4096 toward zero
+static int CheckFreq2Pitch()
+{
+	uint64_t Checked = 0, Undecided = 0, Wrong = 0, FloatWrong = 0;
+	uint32_t FirstWrong = 0;
+
+	auto Check = [&](uint32_t Freq) {
+		long double Exact = log2l(Freq / 48000.0L) * 4096.0L;
+		if (!IsWholeOctave(Freq) && NearBoundary(Exact, 1e6L * LDBL_EPSILON)) {
+			Undecided++;
+			return;
+		}
+		int32_t Expected = (int32_t)Exact;
+		if (converter_freq2pitch(Freq) != Expected) {
+			FirstWrong = (Wrong == 0) ? Freq : FirstWrong;
+			Wrong++;
+		}
+		FloatWrong += (FloatFreq2Pitch(Freq) != Expected);
+		Checked++;
+	};
+
+	for (uint32_t Freq = 1; Freq <= CONVERTER_TEST_FREQUENCIES; Freq++) {
+		Check(Freq);
+	}
+	for (uint64_t Freq = CONVERTER_TEST_FREQUENCIES; Freq <= UINT32_MAX; Freq += CONVERTER_TEST_SAMPLE_STEP) {
+		Check((uint32_t)Freq);
+	}
+	Check(UINT32_MAX);
+
+	bool passed = (Wrong == 0) && (converter_freq2pitch(0) == INT32_MIN) && (converter_freq2pitch(48000) == 0);
+	printf("freq2pitch: %llu frequencies (all up to %u), %llu wrong, %llu undecided, float math was wrong for %llu %s\n",
+		(unsigned long long)Checked, CONVERTER_TEST_FREQUENCIES, (unsigned long long)Wrong, (unsigned long long)Undecided, (unsigned long long)FloatWrong, passed ? "passed" : "FAILED");
+	if (Wrong != 0) {
+		printf("First wrong frequency %u\n", FirstWrong);
+	}
+	return passed ? 0 : 1;
+}
+
+// pitch2freq truncates 48000 * 2^(pitch / 4096), and saturates outside of 16 octaves
+static int CheckPitch2Freq()
+{
+	uint64_t Checked = 0, Undecided = 0, Wrong = 0, FloatWrong = 0;
+	int32_t FirstWrong = 0;
+
+	for (int32_t Pitch = -16 * 4096; Pitch < 16 * 4096; Pitch++) {
+		long double Exact = exp2l(Pitch / 4096.0L) * 48000.0L;
+		uint32_t Expected = (Exact < 4294967295.0L) ? (uint32_t)Exact : UINT32_MAX;
+		// A pitch that is a whole number of octaves gives an exact frequency, all others are irrational
+		if (((Pitch & 0xFFF) != 0) && NearBoundary(Exact, Exact * 64 * LDBL_EPSILON)) {
+			Undecided++;
+			continue;
+		}
+		if (converter_pitch2freq(Pitch) != Expected) {
+			FirstWrong = (Wrong == 0) ? Pitch : FirstWrong;
+			Wrong++;
+		}
+		FloatWrong += (FloatPitch2Freq(Pitch) != Expected);
+		Checked++;
+	}
+
+	bool Saturated = (converter_pitch2freq(16 * 4096) == UINT32_MAX) && (converter_pitch2freq(INT32_MAX) == UINT32_MAX) &&
+		(converter_pitch2freq(-16 * 4096 - 1) == 0) && (converter_pitch2freq(INT32_MIN) == 0);
+	bool passed = (Wrong == 0) && Saturated;
+	printf("pitch2freq: %llu pitches (all of 32 octaves), %llu wrong, %llu undecided, float math was wrong for %llu, saturation %s %s\n",
+		(unsigned long long)Checked, (unsigned long long)Wrong, (unsigned long long)Undecided, (unsigned long long)FloatWrong,
+		Saturated ? "ok" : "wrong", passed ? "passed" : "FAILED");
+	if (Wrong != 0) {
+		printf("First wrong pitch %d\n", FirstWrong);
+	}
+	return passed ? 0 : 1;
+}
+
+// volume2gain is 10^(volume / 2000), 1 above 0 mB and 0 below 8 decades
+static int CheckVolume2Gain()
+{
+	double Worst = 0.0;
+	for (int32_t Volume = -16000 + 1; Volume <= 0; Volume++) {
+		long double Exact = powl(10.0L, Volume / 2000.0L);
+		Worst = fmax(Worst, (double)(fabsl(converter_volume2gain(Volume) - Exact) / Exact));
+	}
+
+	bool Limits = (converter_volume2gain(1) == 1.0f) && (converter_volume2gain(INT32_MAX) == 1.0f) &&
+		(converter_volume2gain(-16000) == 0.0f) && (converter_volume2gain(INT32_MIN) == 0.0f);
+	// The table entry and the decade are each rounded to float, and so is their product
+	bool passed = (Worst <= 3 * ldexp(1.0, -24)) && Limits;
+	printf("volume2gain: every volume down to -160 dB within %.2g relative, limits %s %s\n", Worst, Limits ? "ok" : "wrong", passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+template<typename Function>
+static double NanosecondsPerCall(Function Call)
+{
+	volatile uint64_t Sink = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (int32_t i = 0; i < CONVERTER_TEST_BENCH_CALLS; i++) {
+		Sink = Sink + (uint64_t)Call(i);
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / CONVERTER_TEST_BENCH_CALLS;
+}
+
+int ToolConverter(int argc, char** argv)
+{
+	int failures = CheckTables();
+	failures += CheckFreq2Pitch();
+	failures += CheckPitch2Freq();
+	failures += CheckVolume2Gain();
+
+	// Frequencies from 1 kHz to 200 kHz, pitches over +-8 octaves and volumes over 100 dB, like games set them
+	auto Freq = [](int32_t i) { return (uint32_t)(1000 + ((uint32_t)i * 7919u) % 199000); };
+	auto Pitch = [](int32_t i) { return (int32_t)(((uint32_t)i * 7919u) % 65536) - 32768; };
+	auto Volume = [](int32_t i) { return -(int32_t)(((uint32_t)i * 7919u) % 10000); };
+	printf("freq2pitch: %.1f ns table, %.1f ns float math\n",
+		NanosecondsPerCall([&](int32_t i) { return converter_freq2pitch(Freq(i)); }), NanosecondsPerCall([&](int32_t i) { return FloatFreq2Pitch(Freq(i)); }));
+	printf("pitch2freq: %.1f ns table, %.1f ns float math\n",
+		NanosecondsPerCall([&](int32_t i) { return converter_pitch2freq(Pitch(i)); }), NanosecondsPerCall([&](int32_t i) { return FloatPitch2Freq(Pitch(i)); }));
+	printf("volume2gain: %.1f ns table, %.1f ns float math\n",
+		NanosecondsPerCall([&](int32_t i) { return converter_volume2gain(Volume(i)) * 1e6f; }), NanosecondsPerCall([&](int32_t i) { return FloatVolume2Gain(Volume(i)) * 1e6f; }));
+
+	return failures;
+}
@@ -0,0 +1,302 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/BinaryLog.h"
+#include "Tools.h"
+
+// Records per thread of the self test, in each of its two sessions
+#define DECODE_LOG_TEST_RECORDS 250000
+#define DECODE_LOG_TEST_THREADS 4
+// Logged calls timed with the binary log closed and open
+#define DECODE_LOG_TEST_DISABLED_CALLS 20000000
+#define DECODE_LOG_TEST_ENABLED_CALLS 1000000
+
+static const std::vector<std::string> DecodeLogModules = { "TOOL    : " };
+static const std::vector<std::string> DecodeLogLevels = { "DEBUG: ", "INFO : " };
+
+static void DecodeLogWrite(uint32_t ThreadId, const char* Format, ...)
+{
+	va_list Args;
+	va_start(Args, Format);
+	BinaryLog_WriteArgs(ThreadId, 0, 1, Format, Args);
+	va_end(Args);
+}
+
+// Makes the calls LOG_FUNC_BEGIN, LOG_FUNC_ARG and LOG_FUNC_END make for a function with a
+// handle, a size, a buffer and a name, when the binary log is open
+static void DecodeLogCall(uint32_t Handle, uint32_t Size, void* Buffer, char* Name)
+{
+	if (g_BinaryLogEnabled.load(std::memory_order_relaxed)) {
+		BinaryLog_BeginCall(1, 0, 0, "DecodeLogCall", false);
+		BinaryLog_CallArg("Handle", false, BINARY_LOG_ARG_HEX32, Handle);
+		BinaryLog_CallArgValue("Size", false, Size);
+		BinaryLog_CallArgValue("Buffer", false, Buffer);
+		BinaryLog_CallArgString("Name", false, Name, 80);
+		BinaryLog_EndCall();
+	}
+}
+
+// Logs one session from a few threads, returns the records per second
+static double DecodeLogSession(const std::string& Path, bool Append)
+{
+	if (!BinaryLog_Open(Path, Append, DecodeLogModules, DecodeLogLevels)) {
+		return 0.0;
+	}
+
+	auto Start = std::chrono::steady_clock::now();
+	std::vector<std::thread> Threads;
+	for (uint32_t t = 0; t < DECODE_LOG_TEST_THREADS; t++) {
+		Threads.emplace_back([t]() {
+			for (uint32_t i = 0; i < DECODE_LOG_TEST_RECORDS; i++) {
+				DecodeLogWrite(t + 1, "Record %u of thread %u, handle 0x%08X, %s", i, t + 1, i * 16, "name");
+			}
+		});
+	}
+	for (auto& Thread : Threads) {
+		Thread.join();
+	}
+	// Closing drains everything to disk, which is part of the cost
+	BinaryLog_Close();
+
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	return (double)DECODE_LOG_TEST_RECORDS * DECODE_LOG_TEST_THREADS / Seconds;
+}
+
+// Decodes Path, returns its text or an empty string if it's not a valid log
+static std::string DecodeLogText(const std::string& Path)
+{
+	std::string Text;
+	FILE* In = fopen(Path.c_str(), "rb");
+	FILE* Out = tmpfile();
+	if (In != nullptr && Out != nullptr && BinaryLog_Decode(In, Out, false)) {
+		rewind(Out);
+		char Buffer[4096];
+		size_t Length;
+		while ((Length = fread(Buffer, 1, sizeof(Buffer), Out)) > 0) {
+			Text.append(Buffer, Length);
+		}
+	}
+	if (In != nullptr) {
+		fclose(In);
+	}
+	if (Out != nullptr) {
+		fclose(Out);
+	}
+	return Text;
+}
+
+// Logs calls with each kind of argument, and compares their decoded text with what the
+// text log renders for them. Then times a logged call with the binary log closed and open
+static int SelfTestCalls(const std::string& Path)
+{
+	int failures = 0;
+
+	char Name[] = "a \"b\"\\\n";
+	wchar_t Wide[] = L"w\x263A";
+	bool passed = BinaryLog_Open(Path, false, DecodeLogModules, DecodeLogLevels);
+	if (passed) {
+		BinaryLog_BeginCall(1, 0, 0, "Call", false);
+		BinaryLog_CallArg("Byte", false, BINARY_LOG_ARG_HEX8, 0x1F);
+		BinaryLog_CallArg("Word", false, BINARY_LOG_ARG_HEX16, 0xBEEF);
+		BinaryLog_CallArgValue("Count", false, -5);
+		BinaryLog_CallArgValue("Total", false, (uint64_t)1 << 40);
+		BinaryLog_CallArgValue("Ratio", false, 0.25);
+		BinaryLog_CallArgValue("Buffer", false, (void*)0x1000);
+		BinaryLog_CallArgString("Name", false, Name, 80);
+		BinaryLog_CallArgString("Null", false, nullptr, 80);
+		BinaryLog_CallArgWString("Wide", false, Wide, 80);
+		BinaryLog_CallArgText("Flags", false, "A|B", 3);
+		BinaryLog_CallArg("pResult", true, BINARY_LOG_ARG_HEX32, 0x2000);
+		BinaryLog_EndCall();
+		BinaryLog_BeginCall(1, 0, 0, "Call", true);
+		BinaryLog_CallArgValue(nullptr, false, 0u);
+		BinaryLog_EndCall();
+		BinaryLog_BeginCall(2, 0, 0, "Empty", false);
+		BinaryLog_EndCall();
+		BinaryLog_Close();
+	}
+
+	// What LOG_FUNC_ARG, LOG_FUNC_ARG_OUT and LOG_FUNC_RESULT render, with names padded by LOG_ARG_START and LOG_ARG_OUT_START
+	auto Arg = [](const char* Start, const char* Name, const std::string& Value) {
+		size_t Width = (strcmp(Start, " OUT ") == 0) ? 18 : 20;
+		return Start + (Name + std::string(Width - strlen(Name), ' ')) + " : " + Value + "\n";
+	};
+	char Address[2][32];
+	snprintf(Address[0], sizeof(Address[0]), "0x%08llX", (unsigned long long)(uintptr_t)Name);
+	snprintf(Address[1], sizeof(Address[1]), "0x%08llX", (unsigned long long)(uintptr_t)Wide);
+	std::string Expected = "[0x0001] " + DecodeLogModules[0] + "Call(\n" +
+		Arg("   ", "Byte", "0x1F") +
+		Arg("   ", "Word", "0xBEEF") +
+		Arg("   ", "Count", "-5") +
+		Arg("   ", "Total", "1099511627776") +
+		Arg("   ", "Ratio", "0.25") +
+		Arg("   ", "Buffer", "0x00001000") +
+		Arg("   ", "Name", std::string("(char *)") + Address[0] + " = \"a \\\"b\\\"\\\\\\n\"") +
+		Arg("   ", "Null", "(char *)NULL") +
+		Arg("   ", "Wide", std::string("(wchar *)") + Address[1] + " = \"w?\"") +
+		Arg("   ", "Flags", "A|B") +
+		Arg(" OUT ", "pResult", "0x00002000") +
+		");\n" +
+		"[0x0001] " + DecodeLogModules[0] + "Call returns 0\n" +
+		"[0x0002] " + DecodeLogModules[0] + "Empty();\n";
+	std::string Decoded = passed ? DecodeLogText(Path) : "";
+	passed = (Decoded == Expected);
+	failures += passed ? 0 : 1;
+	printf("Decoded calls with each kind of argument %s\n", passed ? "passed" : "FAILED");
+	if (!passed) {
+		printf("Expected:\n%sDecoded:\n%s", Expected.c_str(), Decoded.c_str());
+	}
+
+	// A disabled call costs the load of g_BinaryLogEnabled
+	auto Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < DECODE_LOG_TEST_DISABLED_CALLS; i++) {
+		DecodeLogCall(i, i * 16, &Name[i & 7], Name);
+	}
+	double DisabledSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	BinaryLogStats Before = BinaryLog_GetStats();
+	passed = BinaryLog_Open(Path, false, DecodeLogModules, DecodeLogLevels);
+	Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; passed && i < DECODE_LOG_TEST_ENABLED_CALLS; i++) {
+		DecodeLogCall(i, i * 16, &Name[i & 7], Name);
+	}
+	double EnabledSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	BinaryLog_Close();
+	BinaryLogStats After = BinaryLog_GetStats();
+
+	passed = passed && (After.Records - Before.Records == DECODE_LOG_TEST_ENABLED_CALLS) && (After.Dropped == Before.Dropped);
+	failures += passed ? 0 : 1;
+	printf("Logged call with 4 arguments: %.2f ns disabled, %.1f ns enabled including the drain (%.1f MB) %s\n",
+		DisabledSeconds * 1e9 / DECODE_LOG_TEST_DISABLED_CALLS, EnabledSeconds * 1e9 / DECODE_LOG_TEST_ENABLED_CALLS,
+		(After.Bytes - Before.Bytes) / 1e6, passed ? "passed" : "FAILED");
+
+	std::filesystem::remove(Path);
+	return failures;
+}
+
+// Writes two sessions, the second one appended like after a reboot, then decodes
+// them and compares every line with what vsnprintf renders
+static int SelfTest()
+{
+	const std::string Path = (std::filesystem::temp_directory_path() / "cxbxr-tool-EmuLog.bin").string();
+	const std::string TextPath = Path + ".txt";
+	int failures = 0;
+
+	BinaryLogStats Before = BinaryLog_GetStats();
+	double FirstRate = DecodeLogSession(Path, false);
+	double SecondRate = DecodeLogSession(Path, true);
+	BinaryLogStats After = BinaryLog_GetStats();
+
+	bool passed = (FirstRate > 0.0) && (SecondRate > 0.0);
+	failures += passed ? 0 : 1;
+	printf("Logging, %u threads: %.2fM and %.2fM records/s %s\n", DECODE_LOG_TEST_THREADS, FirstRate / 1e6, SecondRate / 1e6, passed ? "passed" : "FAILED");
+
+	uint64_t Records = After.Records - Before.Records;
+	passed = (Records == 2ull * DECODE_LOG_TEST_RECORDS * DECODE_LOG_TEST_THREADS) && (After.Dropped == Before.Dropped);
+	failures += passed ? 0 : 1;
+	printf("Statistics: %llu records, %.1f MB, %llu dropped %s\n", (unsigned long long)Records,
+		(After.Bytes - Before.Bytes) / 1e6, (unsigned long long)(After.Dropped - Before.Dropped), passed ? "passed" : "FAILED");
+
+	FILE* In = fopen(Path.c_str(), "rb");
+	FILE* Out = fopen(TextPath.c_str(), "w+b");
+	auto Start = std::chrono::steady_clock::now();
+	passed = (In != nullptr) && (Out != nullptr) && BinaryLog_Decode(In, Out, false);
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	failures += passed ? 0 : 1;
+	printf("Decoding: %.2f s %s\n", Seconds, passed ? "passed" : "FAILED");
+
+	// Each thread logs in order, so its lines must come out in order too
+	unsigned Sessions = 0, Mismatches = 0, Lines = 0;
+	std::vector<uint32_t> Next(DECODE_LOG_TEST_THREADS);
+	if (passed) {
+		rewind(Out);
+		char Line[256], Expected[256];
+		while (fgets(Line, sizeof(Line), Out) != nullptr) {
+			unsigned ThreadId;
+			if (sscanf(Line, "[0x%04X] ", &ThreadId) != 1 || ThreadId == 0 || ThreadId > DECODE_LOG_TEST_THREADS) {
+				if (strncmp(Line, "------REBOOT", 12) == 0) {
+					Sessions++;
+					std::fill(Next.begin(), Next.end(), 0);
+				}
+				continue;
+			}
+			uint32_t i = Next[ThreadId - 1]++;
+			snprintf(Expected, sizeof(Expected), "[0x%04X] %s%sRecord %u of thread %u, handle 0x%08X, %s\n", ThreadId,
+				DecodeLogLevels[1].c_str(), DecodeLogModules[0].c_str(), i, ThreadId, i * 16, "name");
+			Mismatches += (strcmp(Line, Expected) != 0) ? 1 : 0;
+			Lines++;
+		}
+	}
+	if (In != nullptr) {
+		fclose(In);
+	}
+	if (Out != nullptr) {
+		fclose(Out);
+	}
+	std::filesystem::remove(Path);
+	std::filesystem::remove(TextPath);
+
+	passed = (Lines == Records) && (Mismatches == 0);
+	failures += passed ? 0 : 1;
+	printf("Decoded %u lines, %u mismatches with vsnprintf %s\n", Lines, Mismatches, passed ? "passed" : "FAILED");
+
+	passed = (Sessions == 1);
+	failures += passed ? 0 : 1;
+	printf("Appended session after a reboot separator %s\n", passed ? "passed" : "FAILED");
+
+	failures += SelfTestCalls(Path);
+
+	return failures;
+}
+
+int ToolDecodeLog(int argc, char** argv)
+{
+	if (argc == 0) {
+		return SelfTest();
+	}
+
+	bool Timestamps = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+	FILE* In = fopen(argv[0], "rb");
+	if (In == nullptr) {
+		fprintf(stderr, "Can't open %s\n", argv[0]);
+		return 1;
+	}
+
+	bool Decoded = BinaryLog_Decode(In, stdout, Timestamps);
+	fclose(In);
+	if (!Decoded) {
+		fprintf(stderr, "%s is not a valid binary log\n", argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
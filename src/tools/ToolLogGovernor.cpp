@@ -0,0 +1,313 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/LogGovernor.h"
+#include "Tools.h"
+
+#define LOG_GOVERNOR_TEST_THREADS      4
+#define LOG_GOVERNOR_TEST_THREAD_CALLS 100000
+#define LOG_GOVERNOR_BENCH_CALLS       10000000
+
+// A steady clock time well past the first second, like the ones log_rate_admit passes
+static constexpr uint64_t LOG_GOVERNOR_TEST_T0 = 100000000000ull;
+static constexpr uint64_t LOG_GOVERNOR_MS = 1000000;
+
+static std::string FormatIndices(const std::vector<uint32_t>& Indices)
+{
+	std::string Text;
+	for (uint32_t Index : Indices) {
+		Text += (Text.empty() ? "" : " ") + std::to_string(Index);
+	}
+	return Text;
+}
+
+// Checks which messages a site logs, for a few first N / every M settings
+static int SelfTestSampling()
+{
+	struct {
+		uint32_t First;
+		uint32_t Every;
+		uint32_t Calls;
+		std::vector<uint32_t> Logged;
+	} Cases[] = {
+		{ 0, 0, 6, { 0, 1, 2, 3, 4, 5 } },
+		{ 3, 4, 20, { 0, 1, 2, 6, 10, 14, 18 } },
+		{ 0, 5, 20, { 4, 9, 14, 19 } },
+		{ 5, 0, 20, { 0, 1, 2, 3, 4 } },
+		{ 1, 1, 5, { 0, 1, 2, 3, 4 } },
+	};
+	int failures = 0;
+
+	for (const auto& Case : Cases) {
+		LogSite Site;
+		std::vector<uint32_t> Logged;
+		for (uint32_t i = 0; i < Case.Calls; i++) {
+			if (Site.Sample(Case.First, Case.Every)) {
+				Logged.push_back(i);
+			}
+		}
+
+		bool passed = (Logged == Case.Logged);
+		failures += passed ? 0 : 1;
+		printf("Sampling first %u then every %u of %u messages: logged %s %s\n", Case.First, Case.Every, Case.Calls,
+			FormatIndices(Logged).c_str(), passed ? "passed" : "FAILED");
+	}
+
+	// Threads sharing a site must not lose or duplicate a count
+	const uint32_t First = 10, Every = 100;
+	LogSite Site;
+	std::atomic<uint32_t> Logged = 0;
+	std::vector<std::thread> Threads;
+	for (int t = 0; t < LOG_GOVERNOR_TEST_THREADS; t++) {
+		Threads.emplace_back([&]() {
+			uint32_t Count = 0;
+			for (uint32_t i = 0; i < LOG_GOVERNOR_TEST_THREAD_CALLS; i++) {
+				Count += Site.Sample(First, Every) ? 1 : 0;
+			}
+			Logged += Count;
+		});
+	}
+	for (auto& Thread : Threads) {
+		Thread.join();
+	}
+
+	const uint32_t Calls = LOG_GOVERNOR_TEST_THREADS * LOG_GOVERNOR_TEST_THREAD_CALLS;
+	const uint32_t Expected = First + (Calls - First) / Every;
+	bool passed = (Logged == Expected);
+	failures += passed ? 0 : 1;
+	printf("Sampling first %u then every %u from %d threads: %u of %u messages logged (expected %u) %s\n", First, Every,
+		LOG_GOVERNOR_TEST_THREADS, Logged.load(), Calls, Expected, passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+// Calls Admit Calls times at Now, returns the number of admitted messages
+static uint32_t Admit(LogRateLimiter& Limiter, uint32_t Rate, uint64_t Now, uint32_t Calls)
+{
+	uint32_t Admitted = 0;
+	for (uint32_t i = 0; i < Calls; i++) {
+		Admitted += Limiter.Admit(Rate, Now) ? 1 : 0;
+	}
+	return Admitted;
+}
+
+// Checks the token bucket on a simulated clock : the burst, the rate, the cap on idle time and the first refill
+static int SelfTestRateLimit()
+{
+	const uint32_t Rate = 100;
+	int failures = 0;
+
+	// The first refill counts from time 0, which fills the bucket with one second (the burst) of messages
+	LogRateLimiter Limiter;
+	uint32_t Burst = Admit(Limiter, Rate, LOG_GOVERNOR_TEST_T0, 1000);
+	bool passed = (Burst == Rate);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s, first refill from t=0: burst of %u of 1000 messages %s\n", Rate, Burst, passed ? "passed" : "FAILED");
+
+	// A message every ms for 10 s, of which one in 10 gets a token
+	uint32_t Admitted = 0;
+	uint64_t Now = LOG_GOVERNOR_TEST_T0;
+	for (uint32_t ms = 0; ms < 10000; ms++) {
+		Now += LOG_GOVERNOR_MS;
+		Admitted += Admit(Limiter, Rate, Now, 1);
+	}
+	passed = (Admitted == 10 * Rate);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s, a message per ms for 10 s: %u admitted %s\n", Rate, Admitted, passed ? "passed" : "FAILED");
+
+	uint32_t Suppressed = Limiter.TakeSuppressed();
+	passed = (Suppressed == 1000 + 10000 - Burst - Admitted) && (Limiter.TakeSuppressed() == 0);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s: %u messages suppressed %s\n", Rate, Suppressed, passed ? "passed" : "FAILED");
+
+	// Tokens don't pile up beyond the burst while the module is quiet
+	Now += 5000 * LOG_GOVERNOR_MS;
+	Burst = Admit(Limiter, Rate, Now, 1000);
+	passed = (Burst == Rate);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s, after 5 s idle: burst of %u %s\n", Rate, Burst, passed ? "passed" : "FAILED");
+
+	// A bucket that is half full after a second of refill holds no more than the burst
+	LogRateLimiter Partial;
+	Admitted = Admit(Partial, Rate, LOG_GOVERNOR_TEST_T0, Rate / 2);
+	Burst = Admit(Partial, Rate, LOG_GOVERNOR_TEST_T0 + 1000 * LOG_GOVERNOR_MS, 1000);
+	passed = (Admitted == Rate / 2) && (Burst == Rate);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s, half used then a second later: burst of %u %s\n", Rate, Burst, passed ? "passed" : "FAILED");
+
+	// A clock that started a quarter second ago only refills a quarter of the burst
+	LogRateLimiter Early;
+	Burst = Admit(Early, Rate, 250 * LOG_GOVERNOR_MS, 1000);
+	passed = (Burst == Rate / 4);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s, first refill at t=0.25 s: burst of %u %s\n", Rate, Burst, passed ? "passed" : "FAILED");
+
+	LogRateLimiter Unlimited;
+	Admitted = Admit(Unlimited, 0, LOG_GOVERNOR_TEST_T0, 1000);
+	passed = (Admitted == 1000) && (Unlimited.TakeSuppressed() == 0);
+	failures += passed ? 0 : 1;
+	printf("No rate limit: %u of 1000 messages admitted %s\n", Admitted, passed ? "passed" : "FAILED");
+
+	// Threads racing for the tokens of one second must share exactly the burst
+	LogRateLimiter Shared;
+	std::atomic<uint32_t> SharedAdmitted = 0;
+	std::vector<std::thread> Threads;
+	for (int t = 0; t < LOG_GOVERNOR_TEST_THREADS; t++) {
+		Threads.emplace_back([&]() {
+			SharedAdmitted += Admit(Shared, Rate, LOG_GOVERNOR_TEST_T0, LOG_GOVERNOR_TEST_THREAD_CALLS);
+		});
+	}
+	for (auto& Thread : Threads) {
+		Thread.join();
+	}
+	passed = (SharedAdmitted == Rate);
+	failures += passed ? 0 : 1;
+	printf("Rate limit %u/s from %d threads: burst of %u %s\n", Rate, LOG_GOVERNOR_TEST_THREADS, SharedAdmitted.load(), passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+// Checks a deduplicator against the lines it's given and the repeats it must report
+static int SelfTestDeduplication()
+{
+	const char* Line = "Message A";
+	int failures = 0;
+
+	LogDeduplicator Deduplicator;
+	LogDeduplicator::Repeats Report;
+	bool IsNew = Deduplicator.Check(1, 2, Line, strlen(Line), Report);
+	bool passed = IsNew && (Report.Count == 0);
+
+	// A long run of repeats is reported every LOG_DEDUPLICATE_REPORT_EVERY repeats...
+	std::vector<uint32_t> Reports;
+	uint32_t Logged = 0;
+	for (uint32_t i = 0; i < 2500; i++) {
+		Logged += Deduplicator.Check(1, 2, Line, strlen(Line), Report) ? 1 : 0;
+		if (Report.Count != 0) {
+			passed = passed && (Report.Module == 1) && (Report.Level == 2);
+			Reports.push_back(Report.Count);
+		}
+	}
+	// ...and the rest when the line changes
+	IsNew = Deduplicator.Check(1, 2, "Message B", 9, Report);
+	Reports.push_back(Report.Count);
+	passed = passed && IsNew && (Logged == 0) && (Reports == std::vector<uint32_t>{ LOG_DEDUPLICATE_REPORT_EVERY, LOG_DEDUPLICATE_REPORT_EVERY, 500 });
+	failures += passed ? 0 : 1;
+	printf("Deduplication of 2500 repeats: reported %s, then on a changed line %s\n", FormatIndices(Reports).c_str(), passed ? "passed" : "FAILED");
+
+	// The same text is a changed line in another module or level, or with a different length
+	passed = Deduplicator.Check(1, 3, "Message B", 9, Report) && (Report.Count == 0);
+	passed = passed && Deduplicator.Check(4, 3, "Message B", 9, Report) && (Report.Count == 0);
+	passed = passed && Deduplicator.Check(4, 3, "Message BB", 10, Report) && (Report.Count == 0);
+	passed = passed && Deduplicator.Check(4, 3, "Message B", 9, Report) && (Report.Count == 0);
+	failures += passed ? 0 : 1;
+	printf("Deduplication of a changed module, level or length %s\n", passed ? "passed" : "FAILED");
+
+	// Flushing takes the pending repeats, and the next repeat counts from 1 again
+	Deduplicator.Check(4, 3, "Message B", 9, Report);
+	Deduplicator.Check(4, 3, "Message B", 9, Report);
+	Deduplicator.TakeRepeats(Report);
+	passed = (Report.Count == 2);
+	IsNew = Deduplicator.Check(4, 3, "Message B", 9, Report);
+	Deduplicator.TakeRepeats(Report);
+	passed = passed && !IsNew && (Report.Count == 1);
+	failures += passed ? 0 : 1;
+	printf("Deduplication flush of pending repeats %s\n", passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+// Times a suppressed message of each control, the cost a hot site pays for every message it doesn't log
+static int Benchmark()
+{
+	int failures = 0;
+
+	LogSite Site;
+	uint32_t Sampled = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < LOG_GOVERNOR_BENCH_CALLS; i++) {
+		Sampled += Site.Sample(10, 1000000) ? 1 : 0;
+	}
+	double SiteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	// Like log_rate_admit, which reads the clock for every message
+	LogRateLimiter Limiter;
+	uint32_t Admitted = 0;
+	Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < LOG_GOVERNOR_BENCH_CALLS; i++) {
+		uint64_t Now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		Admitted += Limiter.Admit(1, Now) ? 1 : 0;
+	}
+	double LimiterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	// The same with the refill time moving forward, but without reading the clock
+	LogRateLimiter Stepped;
+	uint32_t SteppedAdmitted = 0;
+	Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < LOG_GOVERNOR_BENCH_CALLS; i++) {
+		SteppedAdmitted += Stepped.Admit(1, LOG_GOVERNOR_TEST_T0 + i) ? 1 : 0;
+	}
+	double SteppedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	// A typical line of function logging
+	const std::string Line = "[0x0004] KRNL    : KeWaitForSingleObject(Object : 0x80012340, Timeout : 0x00000000);";
+	LogDeduplicator Deduplicator;
+	LogDeduplicator::Repeats Report;
+	uint32_t NewLines = 0, Reports = 0;
+	Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < LOG_GOVERNOR_BENCH_CALLS; i++) {
+		NewLines += Deduplicator.Check(1, 0, Line.data(), Line.size(), Report) ? 1 : 0;
+		Reports += (Report.Count != 0) ? 1 : 0;
+	}
+	double DeduplicatorSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	// A limiter of 1 message per second admits its burst and then one message per second of the run,
+	// the stepped one only its burst since its run lasts 10 ms of simulated time
+	const uint32_t MaxAdmitted = 1 + (uint32_t)LimiterSeconds + 1;
+	bool passed = (Sampled == 10 + (LOG_GOVERNOR_BENCH_CALLS - 10) / 1000000) && (Admitted >= 1) && (Admitted <= MaxAdmitted) && (SteppedAdmitted == 1) &&
+		(NewLines == 1) && (Reports == (LOG_GOVERNOR_BENCH_CALLS - 1) / LOG_DEDUPLICATE_REPORT_EVERY);
+	failures += passed ? 0 : 1;
+	printf("Suppressed message: %.2f ns sampled out, %.2f ns rate limited (%.2f ns without reading the clock),\n\t%.2f ns deduplicated (%zu characters) %s\n",
+		SiteSeconds * 1e9 / LOG_GOVERNOR_BENCH_CALLS, LimiterSeconds * 1e9 / LOG_GOVERNOR_BENCH_CALLS, SteppedSeconds * 1e9 / LOG_GOVERNOR_BENCH_CALLS,
+		DeduplicatorSeconds * 1e9 / LOG_GOVERNOR_BENCH_CALLS, Line.size(), passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+int ToolLogGovernor(int argc, char** argv)
+{
+	int failures = 0;
+
+	failures += SelfTestSampling();
+	failures += SelfTestRateLimit();
+	failures += SelfTestDeduplication();
+	failures += Benchmark();
+
+	return failures;
+}
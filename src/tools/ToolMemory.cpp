@@ -0,0 +1,371 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+#include "core/kernel/memory-manager/FreeAreaIndex.h"
+#include "core/kernel/memory-manager/PageBitmap.h"
+#include "Tools.h"
+
+#define FREE_AREA_TEST_OPERATIONS 400000
+#define FREE_AREA_TEST_SLOTS      100000 // Bases are picked among this many pages
+#define FREE_AREA_TEST_MAX_PAGES  64     // Largest area or request, in pages
+#define FREE_AREA_TEST_PAGE       4096
+
+#define PAGE_BITMAP_TEST_OPERATIONS 200000
+#define PAGE_BITMAP_TEST_MAX_RANGE  512 // Largest range freed or used at once, in pages
+
+// The reference for FreeAreaIndex : the free areas in address order, searched by walking all of them, like the
+// vma map was before the index
+struct LinearFreeAreas
+{
+	std::map<uintptr_t, size_t> Areas;
+
+	bool Overlaps(uintptr_t Base, size_t Size) const
+	{
+		auto Next = Areas.lower_bound(Base);
+		if ((Next != Areas.end()) && (Next->first < Base + Size)) {
+			return true;
+		}
+		return (Next != Areas.begin()) && (std::prev(Next)->first + std::prev(Next)->second > Base);
+	}
+
+	bool FindFirst(uintptr_t Low, uintptr_t High, size_t Size, uintptr_t* Base) const
+	{
+		for (const auto& Area : Areas) {
+			if ((Area.first >= Low) && (Area.first < High) && (Area.second >= Size)) {
+				*Base = Area.first;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool FindLast(uintptr_t Low, uintptr_t High, size_t Size, uintptr_t* Base) const
+	{
+		for (auto Area = Areas.rbegin(); Area != Areas.rend(); ++Area) {
+			if ((Area->first >= Low) && (Area->first < High) && (Area->second >= Size)) {
+				*Base = Area->first;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool FindBest(size_t Size, uintptr_t* Base) const
+	{
+		size_t BestSize = SIZE_MAX;
+		for (const auto& Area : Areas) {
+			if ((Area.second >= Size) && (Area.second < BestSize)) {
+				BestSize = Area.second;
+				*Base = Area.first;
+			}
+		}
+		return BestSize != SIZE_MAX;
+	}
+};
+
+// Checks a search result of the index against the reference, including the size it reports
+static bool SameResult(bool Found, uintptr_t Base, size_t AreaSize, bool Expected, uintptr_t ExpectedBase, const LinearFreeAreas& Reference)
+{
+	if (Found != Expected) {
+		return false;
+	}
+	return !Found || ((Base == ExpectedBase) && (AreaSize == Reference.Areas.at(Base)));
+}
+
+int ToolFreeAreas(int argc, char** argv)
+{
+	unsigned Operations = (argc > 0) ? (unsigned)strtoul(argv[0], nullptr, 0) : FREE_AREA_TEST_OPERATIONS;
+	unsigned Seed = (argc > 1) ? (unsigned)strtoul(argv[1], nullptr, 0) : 1;
+
+	std::mt19937 Random(Seed);
+	auto Pages = [&Random](unsigned Limit) { return (size_t)(Random() % Limit + 1) * FREE_AREA_TEST_PAGE; };
+	FreeAreaIndex Index;
+	LinearFreeAreas Reference;
+	unsigned Counts[4] = {};
+	unsigned Mismatches = 0;
+	unsigned FirstMismatch = 0;
+	double IndexSeconds = 0, LinearSeconds = 0;
+	unsigned Searches = 0;
+
+	for (unsigned i = 0; i < Operations; i++) {
+		uintptr_t Base = (uintptr_t)(Random() % FREE_AREA_TEST_SLOTS) * FREE_AREA_TEST_PAGE;
+		size_t Size = Pages(FREE_AREA_TEST_MAX_PAGES);
+		bool Good = true;
+
+		// Out of 9 : 4 inserts, an erase, a resize and 3 searches, so that the index fills up to a few thousand areas
+		static const unsigned OperationMix[9] = { 0, 0, 0, 0, 1, 2, 3, 3, 3 };
+		unsigned Operation = OperationMix[Random() % 9];
+
+		if (Operation == 0) {
+			if (!Reference.Overlaps(Base, Size)) {
+				Reference.Areas[Base] = Size;
+				Index.Insert(Base, Size);
+				Counts[0]++;
+			}
+		}
+		else if ((Operation == 1) && !Reference.Areas.empty()) {
+			auto Area = Reference.Areas.lower_bound(Base);
+			if (Area == Reference.Areas.end()) {
+				Area = Reference.Areas.begin();
+			}
+			Index.Erase(Area->first);
+			Reference.Areas.erase(Area);
+			Counts[1]++;
+		}
+		else if ((Operation == 2) && !Reference.Areas.empty()) {
+			// Grow or shrink an area, without reaching into the next one
+			auto Area = Reference.Areas.lower_bound(Base);
+			if (Area != Reference.Areas.end()) {
+				auto Next = std::next(Area);
+				size_t Room = (Next == Reference.Areas.end()) ? Size : (size_t)(Next->first - Area->first);
+				Area->second = (Size < Room) ? Size : Room;
+				Index.Resize(Area->first, Area->second);
+				Counts[2]++;
+			}
+		}
+		else {
+			uintptr_t High = Base + (uintptr_t)(Random() % (FREE_AREA_TEST_SLOTS / 2)) * FREE_AREA_TEST_PAGE;
+			size_t Needed = Pages(FREE_AREA_TEST_MAX_PAGES);
+			uintptr_t Found = 0, Expected = 0;
+			size_t AreaSize = 0;
+
+			auto Start = std::chrono::steady_clock::now();
+			bool First = Index.FindFirst(Base, High, Needed, &Found, &AreaSize);
+			auto Middle = std::chrono::steady_clock::now();
+			bool ExpectedFirst = Reference.FindFirst(Base, High, Needed, &Expected);
+			auto End = std::chrono::steady_clock::now();
+			IndexSeconds += std::chrono::duration<double>(Middle - Start).count();
+			LinearSeconds += std::chrono::duration<double>(End - Middle).count();
+			Searches++;
+			Good = SameResult(First, Found, AreaSize, ExpectedFirst, Expected, Reference);
+
+			bool Last = Index.FindLast(Base, High, Needed, &Found, &AreaSize);
+			bool ExpectedLast = Reference.FindLast(Base, High, Needed, &Expected);
+			Good = Good && SameResult(Last, Found, AreaSize, ExpectedLast, Expected, Reference);
+
+			bool Best = Index.FindBest(Needed, &Found, &AreaSize);
+			bool ExpectedBest = Reference.FindBest(Needed, &Expected);
+			Good = Good && SameResult(Best, Found, AreaSize, ExpectedBest, Expected, Reference);
+			Counts[3]++;
+		}
+
+		Good = Good && (Index.Count() == Reference.Areas.size());
+		if (!Good) {
+			FirstMismatch = (Mismatches == 0) ? i : FirstMismatch;
+			Mismatches++;
+		}
+	}
+
+	bool passed = (Mismatches == 0);
+	printf("Free area index, seed %u: %u inserts, %u erases, %u resizes, %u searches, %zu areas left\n",
+		Seed, Counts[0], Counts[1], Counts[2], Counts[3], Reference.Areas.size());
+	if (!passed) {
+		printf("First mismatch at operation %u\n", FirstMismatch);
+	}
+	printf("Results match the linear reference %s (%u mismatches)\n", passed ? "passed" : "FAILED", Mismatches);
+
+	// Emptying the index through Clear leaves nothing to find
+	Index.Clear();
+	uintptr_t Found;
+	size_t AreaSize;
+	bool cleared = (Index.Count() == 0) && !Index.FindBest(FREE_AREA_TEST_PAGE, &Found, &AreaSize) &&
+		!Index.FindFirst(0, UINTPTR_MAX, FREE_AREA_TEST_PAGE, &Found, &AreaSize);
+	printf("Clear %s\n", cleared ? "passed" : "FAILED");
+
+	if (Searches > 0) {
+		printf("First-fit search: %.0f ns indexed, %.0f ns linear\n", IndexSeconds * 1e9 / Searches, LinearSeconds * 1e9 / Searches);
+	}
+
+	return (passed ? 0 : 1) + (cleared ? 0 : 1);
+}
+
+// The reference for PageBitmap : a flag per page, searched like the free list walk of PhysicalMemory::RemoveFree did
+// before the bitmap, with the free blocks clipped to the range before aligning the end of the run
+struct PlainPageBitmap
+{
+	std::vector<bool> Free = std::vector<bool>(PAGE_BITMAP_MAX_PAGES, false);
+
+	void Set(uint32_t First, uint32_t Last, bool bFree)
+	{
+		for (uint32_t Page = First; Page <= Last; Page++) {
+			Free[Page] = bFree;
+		}
+	}
+
+	bool IsRangeUsed(uint32_t First, uint32_t Last) const
+	{
+		for (uint32_t Page = First; Page <= Last; Page++) {
+			if (Free[Page]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool FindRunFromTop(uint32_t Count, uint32_t Alignment, uint32_t Low, uint32_t High, uint32_t* First) const
+	{
+		if ((Count == 0) || (High < Low)) {
+			return false;
+		}
+		int64_t End = (High < PAGE_BITMAP_MAX_PAGES) ? High : PAGE_BITMAP_MAX_PAGES - 1;
+
+		// Walk the free blocks from the top, each one as a whole before clipping it
+		for (int64_t BlockEnd = PAGE_BITMAP_MAX_PAGES - 1; BlockEnd >= (int64_t)Low; ) {
+			if (!Free[(size_t)BlockEnd]) {
+				BlockEnd--;
+				continue;
+			}
+			int64_t BlockStart = BlockEnd;
+			while ((BlockStart > 0) && Free[(size_t)BlockStart - 1]) {
+				BlockStart--;
+			}
+
+			int64_t IntersectionStart = (BlockStart > (int64_t)Low) ? BlockStart : Low;
+			int64_t IntersectionEnd = (BlockEnd < End) ? BlockEnd : End;
+			if (Alignment && (IntersectionEnd >= IntersectionStart)) {
+				int64_t Mask = ~(int64_t)(Alignment - 1);
+				IntersectionEnd = ((IntersectionEnd + 1) & Mask) - ((((int64_t)Count + Alignment - 1) & Mask) - Count + 1);
+			}
+			if ((IntersectionEnd >= IntersectionStart) && (IntersectionEnd - IntersectionStart + 1 >= (int64_t)Count)) {
+				*First = (uint32_t)(IntersectionEnd - Count + 1);
+				return true;
+			}
+
+			BlockEnd = BlockStart - 1;
+		}
+
+		return false;
+	}
+};
+
+int ToolPageBitmap(int argc, char** argv)
+{
+	unsigned Operations = (argc > 0) ? (unsigned)strtoul(argv[0], nullptr, 0) : PAGE_BITMAP_TEST_OPERATIONS;
+	unsigned Seed = (argc > 1) ? (unsigned)strtoul(argv[1], nullptr, 0) : 1;
+
+	std::mt19937 Random(Seed);
+	auto Pick = [&Random](uint32_t Limit) { return (uint32_t)(Random() % Limit); };
+	// Mostly short ranges, so that the pages get fragmented, with a full sweep now and then
+	auto Range = [&](uint32_t* First, uint32_t* Last) {
+		uint32_t Length = (Pick(64) == 0) ? Pick(PAGE_BITMAP_MAX_PAGES) + 1 : Pick(PAGE_BITMAP_TEST_MAX_RANGE) + 1;
+		*First = Pick(PAGE_BITMAP_MAX_PAGES);
+		*Last = (*First + Length - 1 < PAGE_BITMAP_MAX_PAGES) ? *First + Length - 1 : PAGE_BITMAP_MAX_PAGES - 1;
+	};
+
+	PageBitmap* Bitmap = new PageBitmap();
+	PlainPageBitmap Reference;
+	unsigned Counts[4] = {};
+	unsigned Mismatches = 0;
+	unsigned FirstMismatch = 0;
+	unsigned Found = 0;
+	double BitmapSeconds = 0, PlainSeconds = 0;
+
+	for (unsigned i = 0; i < Operations; i++) {
+		uint32_t First, Last;
+		Range(&First, &Last);
+		bool Good = true;
+
+		switch (Pick(8)) {
+		case 0: case 1:
+			Bitmap->SetFree(First, Last);
+			Reference.Set(First, Last, true);
+			Counts[0]++;
+			break;
+		case 2: case 3:
+			Bitmap->SetUsed(First, Last);
+			Reference.Set(First, Last, false);
+			Counts[1]++;
+			break;
+		case 4:
+			Good = (Bitmap->IsRangeUsed(First, Last) == Reference.IsRangeUsed(First, Last));
+			for (uint32_t Page = First; Good && (Page <= Last); Page++) {
+				Good = (Bitmap->IsFree(Page) == Reference.Free[Page]);
+			}
+			Counts[2]++;
+			break;
+		default: {
+			// Alignments are powers of two up to 64 pages, or none. High can go past the last page, which is clipped
+			uint32_t Count = (Pick(16) == 0) ? Pick(PAGE_BITMAP_TEST_MAX_RANGE) + 1 : Pick(32) + 1;
+			uint32_t Alignment = (Pick(2) == 0) ? 0 : 1u << Pick(7);
+			uint32_t High = (Pick(8) == 0) ? 0xFFFFFFFF : Last;
+			uint32_t BitmapFirst = 0, PlainFirst = 0;
+
+			auto Start = std::chrono::steady_clock::now();
+			bool BitmapFound = Bitmap->FindRunFromTop(Count, Alignment, First, High, &BitmapFirst);
+			auto Middle = std::chrono::steady_clock::now();
+			bool PlainFound = Reference.FindRunFromTop(Count, Alignment, First, High, &PlainFirst);
+			auto End = std::chrono::steady_clock::now();
+			BitmapSeconds += std::chrono::duration<double>(Middle - Start).count();
+			PlainSeconds += std::chrono::duration<double>(End - Middle).count();
+
+			Good = (BitmapFound == PlainFound) && (!BitmapFound || (BitmapFirst == PlainFirst));
+			if (BitmapFound) {
+				// The run must be free, inside the range and aligned
+				Good = Good && (BitmapFirst >= First) && (BitmapFirst + Count - 1 <= High) &&
+					((Alignment == 0) || (BitmapFirst % Alignment == 0));
+				for (uint32_t Page = BitmapFirst; Good && (Page < BitmapFirst + Count); Page++) {
+					Good = Reference.Free[Page];
+				}
+				Found++;
+			}
+			Counts[3]++;
+			break;
+		}
+		}
+
+		if (!Good) {
+			FirstMismatch = (Mismatches == 0) ? i : FirstMismatch;
+			Mismatches++;
+		}
+	}
+
+	// Every page must agree at the end
+	unsigned FreePages = 0;
+	for (uint32_t Page = 0; Page < PAGE_BITMAP_MAX_PAGES; Page++) {
+		if (Bitmap->IsFree(Page) != Reference.Free[Page]) {
+			Mismatches++;
+		}
+		FreePages += Reference.Free[Page] ? 1 : 0;
+	}
+
+	bool passed = (Mismatches == 0);
+	printf("Page bitmap, seed %u: %u frees, %u uses, %u range checks, %u run searches (%u found), %u pages free at the end\n",
+		Seed, Counts[0], Counts[1], Counts[2], Counts[3], Found, FreePages);
+	if (!passed) {
+		printf("First mismatch at operation %u\n", FirstMismatch);
+	}
+	printf("Results match the plain bitmap %s (%u mismatches)\n", passed ? "passed" : "FAILED", Mismatches);
+	if (Counts[3] > 0) {
+		printf("Run search: %.0f ns with the summary bits, %.0f ns page by page\n", BitmapSeconds * 1e9 / Counts[3], PlainSeconds * 1e9 / Counts[3]);
+	}
+
+	delete Bitmap;
+	return passed ? 0 : 1;
+}
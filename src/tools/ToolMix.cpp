@@ -0,0 +1,141 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "core/hle/DSOUND/common/SoftwareMixer.hpp"
+#include "Tools.h"
+
+#define MIX_TEST_VOICES  64
+#define MIX_TEST_SECONDS 10
+
+// Keeps what a null sink would drop : how many frames arrived and how loud they were
+class MixMeterSink : public SoftwareMixerSink {
+public:
+	MixMeterSink(SoftwareMixerSink* pNext) : m_Next(pNext) {}
+
+	void Write(const int16_t* pFrames, uint32_t FrameCount) override
+	{
+		for (uint32_t i = 0; i < FrameCount * 2; i++) {
+			int Sample = (pFrames[i] < 0) ? -pFrames[i] : pFrames[i];
+			Peak = (Sample > Peak) ? Sample : Peak;
+		}
+		Frames += FrameCount;
+		if (m_Next != nullptr) {
+			m_Next->Write(pFrames, FrameCount);
+		}
+	}
+
+	uint64_t Frames = 0;
+	int Peak = 0;
+
+private:
+	std::unique_ptr<SoftwareMixerSink> m_Next;
+};
+
+// A second of a tone, in one of the layouts a game buffer can have
+static void FillVoice(SoftwareMixerVoice* pVoice, unsigned Voice)
+{
+	float Step = 2.0f * 3.14159265f * (110.0f + 20.0f * Voice) / pVoice->Frequency;
+	for (uint32_t Frame = 0; Frame < pVoice->FrameCount; Frame++) {
+		float Value = sinf(Step * Frame) * 4000.0f;
+		for (uint16_t Channel = 0; Channel < pVoice->Channels; Channel++) {
+			if (pVoice->BitsPerSample == 8) {
+				pVoice->Data[Frame * pVoice->BlockAlign + Channel] = (uint8_t)(128 + (int)Value / 256);
+			} else {
+				((int16_t*)pVoice->Data.data())[Frame * pVoice->Channels + Channel] = (int16_t)Value;
+			}
+		}
+	}
+}
+
+int ToolMix(int argc, char** argv)
+{
+	unsigned Voices = (argc > 0) ? (unsigned)strtoul(argv[0], nullptr, 0) : MIX_TEST_VOICES;
+	double Seconds = (argc > 1) ? atof(argv[1]) : MIX_TEST_SECONDS;
+	const char* szWavPath = (argc > 2) ? argv[2] : nullptr;
+
+	SoftwareMixerSink* pOutput = nullptr;
+	if (szWavPath != nullptr) {
+		SoftwareMixerWavSink* pWav = new SoftwareMixerWavSink(szWavPath);
+		if (!pWav->IsOpen()) {
+			printf("Can't create %s\n", szWavPath);
+			delete pWav;
+			return 1;
+		}
+		pOutput = pWav;
+	}
+	MixMeterSink* pMeter = new MixMeterSink(pOutput);
+	SoftwareMixer Mixer { std::unique_ptr<SoftwareMixerSink>(pMeter) };
+
+	// Mono and stereo, 8 and 16 bit, at the usual rates, some positioned in 3D and some routed to mixbins
+	static const uint32_t Frequencies[] = { 22050, 44100, 48000, 32000 };
+	for (unsigned v = 0; v < Voices; v++) {
+		uint16_t Channels = (v & 1) ? 2 : 1;
+		uint16_t BitsPerSample = (v & 2) ? 8 : 16;
+		uint32_t Frequency = Frequencies[(v >> 2) & 3];
+		SoftwareMixerVoice* pVoice = Mixer.CreateVoice(Frequency * Channels * (BitsPerSample / 8), Channels, BitsPerSample, Frequency);
+		FillVoice(pVoice, v);
+
+		std::lock_guard<std::mutex> Lock(Mixer.Mutex);
+		pVoice->Playing = true;
+		pVoice->Looping = true;
+		pVoice->Volume = -600 - (int32_t)(v % 8) * 100;
+		pVoice->Pan = ((int32_t)(v % 5) - 2) * 1000;
+		if ((v % 3) == 1) {
+			pVoice->Is3D = true;
+			pVoice->Mode3D = SOFTWARE_MIXER_3D_NORMAL;
+			pVoice->Position3D = { (float)(v % 7) - 3.0f, 0.0f, 2.0f + (float)(v % 4) };
+		} else if ((v % 3) == 2) {
+			pVoice->MixBinCount = 2;
+			pVoice->MixBins[0] = { 0, -300 };
+			pVoice->MixBins[1] = { 1, -900 };
+		}
+	}
+
+	uint64_t Frames = (uint64_t)(Seconds * SOFTWARE_MIXER_RATE);
+	auto Start = std::chrono::steady_clock::now();
+	for (uint64_t Done = 0; Done < Frames; Done += SOFTWARE_MIXER_PERIOD) {
+		Mixer.Process((uint32_t)((Frames - Done < SOFTWARE_MIXER_PERIOD) ? Frames - Done : SOFTWARE_MIXER_PERIOD));
+	}
+	Mixer.Flush();
+	double Elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	// Every voice loops, so every one of them is mixed for every output frame
+	double VoiceSeconds = (double)Mixer.GetVoiceFrames() / SOFTWARE_MIXER_RATE;
+	bool passed = (Mixer.GetMixedFrames() == Frames) && (pMeter->Frames == Frames) && (Mixer.GetVoiceFrames() == Frames * Voices) &&
+		((Voices == 0) || (pMeter->Peak > 0));
+	printf("Mixed %u voices for %.1f s: %llu frames out, peak %d %s\n", Voices, Frames / (double)SOFTWARE_MIXER_RATE,
+		(unsigned long long)pMeter->Frames, pMeter->Peak, passed ? "passed" : "FAILED");
+	// A voice second mixed per second of cpu is a voice that can play in real time
+	printf("%.2f s for %.0f voice seconds: %.0f voices/s, %.1f us per 10 ms period\n",
+		Elapsed, VoiceSeconds, VoiceSeconds / Elapsed, Elapsed * 1e6 * SOFTWARE_MIXER_PERIOD / (Frames ? Frames : 1));
+	if (szWavPath != nullptr) {
+		printf("Wrote %s\n", szWavPath);
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "core/kernel/support/ObjectNameIndex.h"
+#include "Tools.h"
+
+#define OBJECT_NAME_TEST_OPERATIONS  400000
+#define OBJECT_NAME_TEST_DIRECTORIES 8
+#define OBJECT_NAME_TEST_NAMES       4096  // Names are picked among this many per directory
+#define OBJECT_NAME_TEST_HASH_BITS   6     // The hash of a test name keeps only this many bits, so that names collide
+
+struct TestName {
+	std::string Text;
+};
+
+static bool TestNameEquals(const void* Name, const void* Key)
+{
+	const std::string& a = ((const TestName*)Name)->Text;
+	const std::string& b = *(const std::string*)Key;
+	if (a.length() != b.length()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.length(); i++) {
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Case insensitive, like ObpComputeHashValue, and weak on purpose
+static uint32_t TestHash(const std::string& Text)
+{
+	uint32_t Hash = 2166136261u;
+	for (char c : Text) {
+		Hash = (Hash ^ (uint32_t)tolower((unsigned char)c)) * 16777619u;
+	}
+	return Hash & ((1u << OBJECT_NAME_TEST_HASH_BITS) - 1);
+}
+
+static std::string Lower(std::string Text)
+{
+	for (char& c : Text) {
+		c = (char)tolower((unsigned char)c);
+	}
+	return Text;
+}
+
+// Randomizes the case, lookups ignore it
+static std::string MixCase(std::string Text, std::mt19937& Random)
+{
+	for (char& c : Text) {
+		if (Random() & 1) {
+			c = (char)toupper((unsigned char)c);
+		}
+	}
+	return Text;
+}
+
+// Checks the path cache on its own : case insensitive hits, the symbolic link flag, slot replacement, and the
+// flush by every name added or removed (which is what keeps ObInsertObject and ObMakeTemporaryObject coherent)
+static int PathCacheRules()
+{
+	int failures = 0;
+	ObjectNameIndex Index(TestNameEquals);
+	int Objects[2];
+	std::string Path = "\\Device\\Harddisk0\\Partition1";
+	std::string Upper = "\\DEVICE\\harddisk0\\PARTITION1";
+	uint32_t Hash = 0x1234;
+
+	Index.CachePath(Path.data(), Path.length(), Hash, true, &Objects[0]);
+	bool passed = (Index.FindPath(Upper.data(), Upper.length(), Hash, true) == &Objects[0]) &&
+		(Index.FindPath(Path.data(), Path.length(), Hash, false) == nullptr) &&
+		(Index.FindPath(Path.data(), Path.length() - 1, Hash, true) == nullptr) &&
+		(Index.FindPath(Path.data(), Path.length(), Hash + 1, true) == nullptr);
+	printf("Path cache: hits ignore the case and respect the symbolic link flag %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	std::string Other = "\\??\\D:";
+	Index.CachePath(Other.data(), Other.length(), Hash + OBJECT_PATH_CACHE_SIZE, true, &Objects[1]);
+	passed = (Index.FindPath(Path.data(), Path.length(), Hash, true) == nullptr) &&
+		(Index.FindPath(Other.data(), Other.length(), Hash + OBJECT_PATH_CACHE_SIZE, true) == &Objects[1]);
+	printf("Path cache: a path in the same slot replaces the previous one %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	TestName Name { "D:" };
+	Index.Insert(&Index, TestHash(Name.Text), &Name);
+	passed = (Index.FindPath(Other.data(), Other.length(), Hash + OBJECT_PATH_CACHE_SIZE, true) == nullptr);
+	Index.CachePath(Other.data(), Other.length(), Hash + OBJECT_PATH_CACHE_SIZE, true, &Objects[1]);
+	passed = passed && (Index.FindPath(Other.data(), Other.length(), Hash + OBJECT_PATH_CACHE_SIZE, true) == &Objects[1]);
+	passed = passed && Index.Remove(&Index, TestHash(Name.Text), &Name) &&
+		(Index.FindPath(Other.data(), Other.length(), Hash + OBJECT_PATH_CACHE_SIZE, true) == nullptr);
+	printf("Path cache: adding or removing a name flushes it %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	return failures;
+}
+
+int ToolObjectNames(int argc, char** argv)
+{
+	unsigned Operations = (argc > 0) ? (unsigned)strtoul(argv[0], nullptr, 0) : OBJECT_NAME_TEST_OPERATIONS;
+	unsigned Seed = (argc > 1) ? (unsigned)strtoul(argv[1], nullptr, 0) : 1;
+
+	int failures = PathCacheRules();
+
+	std::mt19937 Random(Seed);
+	ObjectNameIndex Index(TestNameEquals);
+	char Directories[OBJECT_NAME_TEST_DIRECTORIES];
+	// The reference : the names of each directory by their lower case text
+	std::map<std::pair<const void*, std::string>, std::unique_ptr<TestName>> Reference;
+	unsigned Counts[4] = {};
+	unsigned Mismatches = 0;
+	unsigned FirstMismatch = 0;
+	unsigned Overloaded = 0;
+	unsigned Grown = 0, Shrunk = 0;
+	size_t Capacity = Index.Capacity();
+	size_t MaximumCapacity = Capacity;
+
+	for (unsigned i = 0; i < Operations; i++) {
+		const void* Directory = &Directories[Random() % OBJECT_NAME_TEST_DIRECTORIES];
+		std::string Text = "Name" + std::to_string(Random() % OBJECT_NAME_TEST_NAMES);
+		auto Key = std::make_pair(Directory, Lower(Text));
+		auto Found = Reference.find(Key);
+		bool Good = true;
+
+		// The first half mostly adds names and the second half mostly removes them, so that the index grows to a
+		// few thousand names and shrinks back to nothing. Out of 8 : 4 inserts, 1 remove, 3 lookups, then the reverse
+		unsigned Roll = Random() % 8;
+		unsigned Operation = (Roll < 4) ? ((i < Operations / 2) ? 0 : 1) : (Roll < 5) ? ((i < Operations / 2) ? 1 : 0) : 2;
+
+		if (Operation == 0) {
+			if (Found == Reference.end()) {
+				TestName* Name = new TestName { Text };
+				Reference[Key].reset(Name);
+				Index.Insert(Directory, TestHash(Text), Name);
+				Counts[0]++;
+			}
+		}
+		else if (Operation == 1) {
+			// Remove a name that is there, or check that removing one that isn't fails
+			if ((Found == Reference.end()) && (Random() & 1)) {
+				TestName Absent { Text };
+				Good = !Index.Remove(Directory, TestHash(Text), &Absent);
+			} else if (!Reference.empty()) {
+				if (Found == Reference.end()) {
+					Found = Reference.lower_bound(Key);
+					Found = (Found == Reference.end()) ? Reference.begin() : Found;
+				}
+				Good = Index.Remove(Found->first.first, TestHash(Found->first.second), Found->second.get());
+				Reference.erase(Found);
+				Counts[1]++;
+			}
+		}
+		else {
+			std::string Mixed = MixCase(Text, Random);
+			void* Name = Index.Find(Directory, TestHash(Mixed), &Mixed);
+			Good = (Name == ((Found == Reference.end()) ? nullptr : Found->second.get()));
+			Counts[2]++;
+		}
+
+		size_t NewCapacity = Index.Capacity();
+		Grown += (NewCapacity > Capacity);
+		Shrunk += (NewCapacity < Capacity);
+		Capacity = NewCapacity;
+		MaximumCapacity = (Capacity > MaximumCapacity) ? Capacity : MaximumCapacity;
+		Overloaded += (Index.Count() * 4 > Capacity * 3);
+
+		Good = Good && (Index.Count() == Reference.size());
+		if (!Good) {
+			FirstMismatch = (Mismatches == 0) ? i : FirstMismatch;
+			Mismatches++;
+		}
+
+		// Every name must stay reachable after the entries around it were shifted or moved by a resize
+		if ((i % 20000) == 0 || (i == Operations - 1)) {
+			for (const auto& Entry : Reference) {
+				if (Index.Find(Entry.first.first, TestHash(Entry.first.second), &Entry.first.second) != Entry.second.get()) {
+					FirstMismatch = (Mismatches == 0) ? i : FirstMismatch;
+					Mismatches++;
+				}
+			}
+			Counts[3]++;
+		}
+	}
+
+	bool passed = (Mismatches == 0);
+	printf("Object name index, seed %u: %u inserts, %u removes, %u lookups, %u full checks, %zu names at the end\n",
+		Seed, Counts[0], Counts[1], Counts[2], Counts[3], Reference.size());
+	if (!passed) {
+		printf("First mismatch at operation %u\n", FirstMismatch);
+	}
+	printf("Results match the reference %s (%u mismatches)\n", passed ? "passed" : "FAILED", Mismatches);
+	failures += !passed;
+
+	// Emptied, the index must be back to its minimum size
+	size_t Left = Reference.size();
+	unsigned Failed = 0;
+	for (const auto& Entry : Reference) {
+		Failed += !Index.Remove(Entry.first.first, TestHash(Entry.first.second), Entry.second.get());
+		size_t NewCapacity = Index.Capacity();
+		Shrunk += (NewCapacity < Capacity);
+		Capacity = NewCapacity;
+	}
+	Reference.clear();
+	passed = (Failed == 0) && (Overloaded == 0) && (Grown > 0) && (Shrunk > 0) && (Index.Count() == 0) && (Capacity == OBJECT_NAME_INDEX_MINIMUM_SIZE);
+	printf("Resizes: grew %u times up to %zu slots, shrank %u times down to %zu slots after removing the %zu names left, load above 3/4 %u times %s\n",
+		Grown, MaximumCapacity, Shrunk, Capacity, Left, Overloaded, passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	// Lookup cost with a full index and a real hash
+	ObjectNameIndex Timed(TestNameEquals);
+	std::vector<std::unique_ptr<TestName>> Names;
+	std::vector<std::string> Keys;
+	for (unsigned n = 0; n < OBJECT_NAME_TEST_NAMES; n++) {
+		Names.emplace_back(new TestName { "Name" + std::to_string(n) });
+		Timed.Insert(Directories, std::hash<std::string>()(Lower(Names.back()->Text)) & 0xFFFFFFFF, Names.back().get());
+		Keys.push_back(MixCase(Names.back()->Text, Random));
+	}
+	std::vector<uint32_t> Hashes;
+	for (const std::string& Key : Keys) {
+		Hashes.push_back(std::hash<std::string>()(Lower(Key)) & 0xFFFFFFFF);
+	}
+	unsigned Hits = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (unsigned Round = 0; Round < 100; Round++) {
+		for (size_t n = 0; n < Keys.size(); n++) {
+			Hits += (Timed.Find(Directories, Hashes[n], &Keys[n]) != nullptr);
+		}
+	}
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	printf("Lookup: %.0f ns per name among %u (%u hits)\n", Seconds * 1e9 / (100.0 * Keys.size()), OBJECT_NAME_TEST_NAMES, Hits);
+
+	return failures;
+}
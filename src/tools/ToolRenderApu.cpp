@@ -0,0 +1,581 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "common/XADPCM.h"
+#include "devices/audio/APUVoiceProcessor.h"
+#include "Tools.h"
+
+// Mixbins played as the left and right channel of the rendered wav
+#define RENDER_APU_LEFT_BIN  0 // FRONT_LEFT
+#define RENDER_APU_RIGHT_BIN 1 // FRONT_RIGHT
+
+static void WriteWavHeader(FILE* pFile, uint32_t DataBytes)
+{
+	const uint16_t channels = 2, bitsPerSample = 16, formatTag = 1 /*WAVE_FORMAT_PCM*/;
+	const uint16_t blockAlign = channels * bitsPerSample / 8;
+	const uint32_t sampleRate = APU_VP_SAMPLE_RATE, byteRate = sampleRate * blockAlign;
+	const uint32_t fmtSize = 16, riffSize = 36 + DataBytes;
+
+	fseek(pFile, 0, SEEK_SET);
+	fwrite("RIFF", 1, 4, pFile);
+	fwrite(&riffSize, 4, 1, pFile);
+	fwrite("WAVEfmt ", 1, 8, pFile);
+	fwrite(&fmtSize, 4, 1, pFile);
+	fwrite(&formatTag, 2, 1, pFile);
+	fwrite(&channels, 2, 1, pFile);
+	fwrite(&sampleRate, 4, 1, pFile);
+	fwrite(&byteRate, 4, 1, pFile);
+	fwrite(&blockAlign, 2, 1, pFile);
+	fwrite(&bitsPerSample, 2, 1, pFile);
+	fwrite("data", 1, 4, pFile);
+	fwrite(&DataBytes, 4, 1, pFile);
+	fseek(pFile, 0, SEEK_END);
+}
+
+// Renders the voice lists of a dump written by APUDevice::SaveVoiceDump (F3 in the emulator)
+static int RenderDump(const char* szDumpPath, const char* szWavPath, double Seconds)
+{
+	FILE* pDump = fopen(szDumpPath, "rb");
+	if (pDump == nullptr) {
+		fprintf(stderr, "Can't open %s\n", szDumpPath);
+		return 1;
+	}
+
+	uint32_t memorySize;
+	if (!APUVoiceProcessor::PeekDump(pDump, memorySize)) {
+		fprintf(stderr, "%s is not an APU voice dump\n", szDumpPath);
+		fclose(pDump);
+		return 1;
+	}
+
+	std::vector<uint8_t> memory(memorySize);
+	APUVoiceProcessor processor(memory.data(), memorySize);
+	bool loaded = processor.LoadDump(pDump);
+	fclose(pDump);
+	if (!loaded) {
+		fprintf(stderr, "%s is truncated\n", szDumpPath);
+		return 1;
+	}
+
+	FILE* pWav = fopen(szWavPath, "wb");
+	if (pWav == nullptr) {
+		fprintf(stderr, "Can't create %s\n", szWavPath);
+		return 1;
+	}
+	WriteWavHeader(pWav, 0);
+
+	uint64_t frames = (uint64_t)(Seconds * APU_VP_SAMPLE_RATE / APU_VP_FRAME_SAMPLES);
+	unsigned minVoices = APU_VP_MAX_VOICES, maxVoices = 0;
+	uint64_t totalVoices = 0;
+	std::vector<int16_t> output(APU_VP_FRAME_SAMPLES * 2);
+	double processSeconds = 0.0;
+
+	for (uint64_t frame = 0; frame < frames; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		processor.ProcessFrame();
+		processSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		unsigned voices = processor.GetVoicesLastFrame();
+		minVoices = std::min(minVoices, voices);
+		maxVoices = std::max(maxVoices, voices);
+		totalVoices += voices;
+
+		// Mixbins hold 24 bit samples
+		const int32_t* pLeft = processor.GetMixBin(RENDER_APU_LEFT_BIN);
+		const int32_t* pRight = processor.GetMixBin(RENDER_APU_RIGHT_BIN);
+		for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+			output[i * 2] = (int16_t)(pLeft[i] >> 8);
+			output[i * 2 + 1] = (int16_t)(pRight[i] >> 8);
+		}
+		fwrite(output.data(), sizeof(int16_t), output.size(), pWav);
+	}
+
+	WriteWavHeader(pWav, (uint32_t)(frames * APU_VP_FRAME_SAMPLES * 4));
+	fclose(pWav);
+
+	double audioSeconds = (double)(frames * APU_VP_FRAME_SAMPLES) / APU_VP_SAMPLE_RATE;
+	printf("Rendered %llu frames (%.2f s at %u Hz) to %s\n", (unsigned long long)frames, audioSeconds, APU_VP_SAMPLE_RATE, szWavPath);
+	printf("Voices per frame: min %u, average %.2f, max %u\n", frames ? minVoices : 0,
+		frames ? (double)totalVoices / frames : 0.0, maxVoices);
+	printf("Processing took %.3f s, %.1fx real time\n", processSeconds, processSeconds > 0.0 ? audioSeconds / processSeconds : 0.0);
+	return 0;
+}
+
+// Synthetic guest memory for the self test
+#define SELFTEST_MEMORY_SIZE   0x100000
+#define SELFTEST_VOICE_ARRAY   0x10000
+#define SELFTEST_SGE_TABLE     0x20000
+#define SELFTEST_SSL_TABLE     0x30000
+#define SELFTEST_BUFFER_DATA   0x40000
+#define SELFTEST_BUFFER_FRAMES 4096
+#define SELFTEST_BUFFER_PAGES  2
+#define SELFTEST_STREAM_DATA   0x50000
+#define SELFTEST_SEGMENT_FRAMES 960
+
+// Peak of one mixbin over a frame, in 24 bit units
+static int32_t MixBinPeak(const APUVoiceProcessor& Processor, unsigned MixBin)
+{
+	const int32_t* pBin = Processor.GetMixBin(MixBin);
+	int32_t peak = 0;
+	for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+		peak = std::max(peak, std::abs(pBin[i]));
+	}
+	return peak;
+}
+
+static void SelfTestVoice(APUVoiceProcessor& Processor, uint32_t Handle, uint32_t Format, unsigned MixBin)
+{
+	// Every volume muted except the one of the first or second mixbin
+	uint32_t vola = 0xF | (0xFFF << 4) | (0xF << 16) | (0xFFFu << 20);
+	vola &= (MixBin == 0) ? ~(0xFFFu << 4) : ~(0xFFFu << 20);
+	uint32_t volb = 0xF | (0xFFF << 4) | (0xF << 16) | (0xFFFu << 20);
+
+	Processor.MethodWrite(NV1BA0_PIO_SET_CURRENT_VOICE, Handle);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_VBIN, 0 | (1 << 5) | (2 << 10) | (3 << 16) | (4 << 21) | (5 << 26));
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_FMT, Format | 6 | (7 << 5));
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_ENV0, 0);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_ENVA, 0);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLA, vola);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLB, volb);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLC, volb);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_PITCH, 0);
+}
+
+// Points the processor at the voice array and tables, and maps the buffer pages
+static void SelfTestMemory(std::vector<uint8_t>& Memory, APUVoiceProcessor& Processor)
+{
+	Processor.RegisterWrite(NV_PAPU_VPVADDR, SELFTEST_VOICE_ARRAY);
+	Processor.RegisterWrite(NV_PAPU_VPSGEADDR, SELFTEST_SGE_TABLE);
+	Processor.RegisterWrite(NV_PAPU_VPSSLADDR, SELFTEST_SSL_TABLE);
+	for (uint32_t page = 0; page < SELFTEST_BUFFER_PAGES; page++) {
+		uint32_t address = SELFTEST_BUFFER_DATA + page * 0x1000;
+		memcpy(&Memory[SELFTEST_SGE_TABLE + page * 8], &address, sizeof(address));
+	}
+}
+
+// Plays a buffer voice of Frames sample frames at SELFTEST_BUFFER_DATA, once, on mixbin 0 at full volume
+static void SelfTestBufferVoice(APUVoiceProcessor& Processor, uint32_t Format, uint32_t Frames, int16_t Pitch)
+{
+	SelfTestVoice(Processor, 0, Format, 0);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_PITCH, (uint32_t)(uint16_t)Pitch << 16);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_BUF_BASE, 0);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_BUF_LBO, 0);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_BUF_CBO, 0);
+	Processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_BUF_EBO, Frames - 1);
+	Processor.MethodWrite(NV1BA0_PIO_SET_ANTECEDENT_VOICE, 1 << 16);
+	Processor.MethodWrite(NV1BA0_PIO_VOICE_ON, 0);
+}
+
+static uint32_t SelfTestVoiceOffset(const std::vector<uint8_t>& Memory, uint32_t Handle)
+{
+	uint32_t offset;
+	memcpy(&offset, &Memory[SELFTEST_VOICE_ARRAY + Handle * NV_PAVS_SIZE + NV_PAVS_VOICE_PAR_OFFSET], sizeof(offset));
+	return offset & NV_PAVS_VOICE_PAR_OFFSET_CBO;
+}
+
+// Every PCM container at pitch 0 has to reach mixbin 0 sample for sample. Values are multiples
+// of 1/128, which all containers hold exactly, and S24 has garbage in the unused top byte.
+static int SelfTestPcmFormats()
+{
+	struct Format { const char* Name; unsigned Container, SampleSize, Bytes; };
+	static const Format formats[] = {
+		{ "PCM8", APU_VP_CONTAINER_B8, APU_VP_SAMPLE_U8, 1 },
+		{ "PCM16", APU_VP_CONTAINER_B16, APU_VP_SAMPLE_S16, 2 },
+		{ "PCM24", APU_VP_CONTAINER_B32, APU_VP_SAMPLE_S24, 4 },
+		{ "PCM32", APU_VP_CONTAINER_B32, APU_VP_SAMPLE_S32, 4 },
+	};
+	const uint32_t frames = APU_VP_FRAME_SAMPLES * 2;
+	int failures = 0;
+
+	for (const Format& format : formats) {
+		std::vector<uint8_t> memory(SELFTEST_MEMORY_SIZE);
+		APUVoiceProcessor processor(memory.data(), SELFTEST_MEMORY_SIZE);
+		SelfTestMemory(memory, processor);
+
+		std::vector<int32_t> expected(frames);
+		for (uint32_t i = 0; i < frames; i++) {
+			int32_t value = (int32_t)((i * 37) % 256) - 128; // In 1/128 units
+			uint32_t encoded;
+			if (format.Bytes == 1) {
+				encoded = (uint32_t)(value + 128);
+			} else if (format.Bytes == 2) {
+				encoded = (uint32_t)(value * 256) & 0xFFFF;
+			} else if (format.SampleSize == APU_VP_SAMPLE_S24) {
+				encoded = ((uint32_t)(value * 65536) & 0xFFFFFF) | 0xA5000000;
+			} else {
+				encoded = (uint32_t)value << 24;
+			}
+			memcpy(&memory[SELFTEST_BUFFER_DATA + i * format.Bytes], &encoded, format.Bytes);
+			expected[i] = (int32_t)(value / 128.0f * 8388607.0f);
+		}
+
+		SelfTestBufferVoice(processor, (format.Container << 30) | (format.SampleSize << 28), frames, 0);
+		uint32_t wrong = 0;
+		for (uint32_t frame = 0; frame < frames / APU_VP_FRAME_SAMPLES; frame++) {
+			processor.ProcessFrame();
+			const int32_t* pBin = processor.GetMixBin(0);
+			for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+				wrong += (pBin[i] != expected[frame * APU_VP_FRAME_SAMPLES + i]) ? 1 : 0;
+			}
+		}
+		processor.ProcessFrame();
+
+		bool passed = (wrong == 0) && (processor.GetVoicesLastFrame() == 0);
+		failures += passed ? 0 : 1;
+		printf("%s buffer voice, %u of %u samples wrong, off at the end %s\n", format.Name, wrong, frames, passed ? "passed" : "FAILED");
+	}
+
+	return failures;
+}
+
+// ADPCM buffers have to decode like TXboxAdpcmDecoder_DecodeBlock does, across block boundaries,
+// with stereo left on the even and right on the odd mixbin
+static int SelfTestAdpcm()
+{
+	const uint32_t blocks = 6;
+	const uint32_t frames = 12 * APU_VP_FRAME_SAMPLES; // Ends inside the last block
+	const uint32_t blockSamples = XBOX_ADPCM_DSTSIZE / 2;
+	std::mt19937 random(0x41504155);
+	int failures = 0;
+
+	for (unsigned channels = 1; channels <= 2; channels++) {
+		std::vector<uint8_t> memory(SELFTEST_MEMORY_SIZE);
+		APUVoiceProcessor processor(memory.data(), SELFTEST_MEMORY_SIZE);
+		SelfTestMemory(memory, processor);
+
+		uint8_t* pEncoded = &memory[SELFTEST_BUFFER_DATA];
+		std::vector<int16_t> decoded(blocks * blockSamples * channels);
+		for (uint32_t block = 0; block < blocks; block++) {
+			uint8_t* pBlock = pEncoded + block * XBOX_ADPCM_SRCSIZE * channels;
+			for (uint32_t i = 0; i < XBOX_ADPCM_SRCSIZE * channels; i++) {
+				pBlock[i] = (uint8_t)random();
+			}
+			for (unsigned c = 0; c < channels; c++) {
+				pBlock[c * 4 + 2] = (uint8_t)(random() % 89); // Step index
+				pBlock[c * 4 + 3] = 0;
+			}
+			TXboxAdpcmDecoder_DecodeBlock(pBlock, &decoded[block * blockSamples * channels], channels);
+		}
+
+		uint32_t stereo = (channels == 2) ? NV_PAVS_VOICE_CFG_FMT_STEREO : 0;
+		SelfTestBufferVoice(processor, (APU_VP_CONTAINER_ADPCM << 30) | (APU_VP_SAMPLE_S16 << 28) | stereo, blocks * blockSamples, 0);
+		processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLA, 0xF | (0xF << 16)); // Mixbins 0 and 1 at full volume
+
+		uint32_t wrong = 0;
+		for (uint32_t frame = 0; frame < frames / APU_VP_FRAME_SAMPLES; frame++) {
+			processor.ProcessFrame();
+			for (unsigned bin = 0; bin < 2; bin++) {
+				const int32_t* pBin = processor.GetMixBin(bin);
+				for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+					// Mono voices send the same samples to both mixbins
+					int16_t sample = decoded[(frame * APU_VP_FRAME_SAMPLES + i) * channels + (channels == 2 ? bin : 0)];
+					wrong += (pBin[i] != (int32_t)(sample / 32768.0f * 8388607.0f)) ? 1 : 0;
+				}
+			}
+		}
+
+		bool passed = (wrong == 0);
+		failures += passed ? 0 : 1;
+		printf("ADPCM %s buffer voice, %u blocks, %u of %u samples wrong %s\n", channels == 2 ? "stereo" : "mono", blocks, wrong,
+			frames * 2, passed ? "passed" : "FAILED");
+	}
+
+	return failures;
+}
+
+// Pitch -4096 is an octave down and has to step half a sample per output sample, interpolating
+// halfway in between, +4096 an octave up and two samples per output sample
+static int SelfTestPitch()
+{
+	const uint32_t frames = 512;
+	int failures = 0;
+
+	for (int16_t pitch : { (int16_t)-4096, (int16_t)4096 }) {
+		std::vector<uint8_t> memory(SELFTEST_MEMORY_SIZE);
+		APUVoiceProcessor processor(memory.data(), SELFTEST_MEMORY_SIZE);
+		SelfTestMemory(memory, processor);
+
+		// Ramp, so that every position reads as a different level
+		int16_t* pRamp = (int16_t*)&memory[SELFTEST_BUFFER_DATA];
+		for (uint32_t i = 0; i < frames; i++) {
+			pRamp[i] = (int16_t)(i * 64);
+		}
+		SelfTestBufferVoice(processor, (APU_VP_CONTAINER_B16 << 30) | (APU_VP_SAMPLE_S16 << 28), frames, pitch);
+
+		const unsigned outputFrames = 4;
+		uint32_t wrong = 0;
+		for (uint32_t frame = 0; frame < outputFrames; frame++) {
+			processor.ProcessFrame();
+			const int32_t* pBin = processor.GetMixBin(0);
+			for (unsigned i = 0; i < APU_VP_FRAME_SAMPLES; i++) {
+				uint32_t n = frame * APU_VP_FRAME_SAMPLES + i;
+				float level;
+				if (pitch < 0) {
+					float s0 = pRamp[n / 2] / 32768.0f, s1 = pRamp[n / 2 + 1] / 32768.0f;
+					level = (n & 1) ? s0 + (s1 - s0) * 0.5f : s0;
+				} else {
+					level = pRamp[n * 2] / 32768.0f;
+				}
+				wrong += (std::abs(pBin[i] - (int32_t)(level * 8388607.0f)) > 1) ? 1 : 0;
+			}
+		}
+
+		uint32_t expectedOffset = (pitch < 0) ? outputFrames * APU_VP_FRAME_SAMPLES / 2 : outputFrames * APU_VP_FRAME_SAMPLES * 2;
+		uint32_t offset = SelfTestVoiceOffset(memory, 0);
+		bool passed = (wrong == 0) && (offset == expectedOffset);
+		failures += passed ? 0 : 1;
+		printf("Pitch %d, %u of %u samples wrong, played %u of %u source samples %s\n", pitch, wrong,
+			outputFrames * APU_VP_FRAME_SAMPLES, offset, expectedOffset, passed ? "passed" : "FAILED");
+	}
+
+	return failures;
+}
+
+// Envelope level of every frame through delay, attack, hold, decay and sustain, then through the
+// release, in 1/255. Envelope times count 16 samples, so two units per frame.
+static int SelfTestEnvelope()
+{
+	std::vector<uint8_t> memory(SELFTEST_MEMORY_SIZE);
+	APUVoiceProcessor processor(memory.data(), SELFTEST_MEMORY_SIZE);
+	SelfTestMemory(memory, processor);
+
+	int16_t* pLevel = (int16_t*)&memory[SELFTEST_BUFFER_DATA];
+	for (unsigned i = 0; i < SELFTEST_BUFFER_FRAMES; i++) {
+		pLevel[i] = 0x4000;
+	}
+	SelfTestBufferVoice(processor, (APU_VP_CONTAINER_B16 << 30) | (APU_VP_SAMPLE_S16 << 28) | NV_PAVS_VOICE_CFG_FMT_LOOP,
+		SELFTEST_BUFFER_FRAMES, 0);
+	const uint32_t delay = 4, attack = 8, hold = 4, decay = 8, sustain = 128, release = 8;
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_ENV0, attack | (delay << 12));
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_ENVA, decay | (hold << 12) | (sustain << 24));
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_LFO_ENV, release);
+
+	static const unsigned stages[] = {
+		0, 0, 0,             // Delay
+		0, 63, 127, 191,     // Attack
+		255, 255, 255, 255,  // Hold
+		255, 224, 192, 160,  // Decay
+		128, 128, 128,       // Sustain
+	};
+	static const unsigned released[] = { 128, 96, 64, 32 };
+
+	auto level = [&]() {
+		// The source is half scale, so a full envelope is half of the mixbin range
+		return (unsigned)lround(MixBinPeak(processor, 0) / (0.5 * 8388607.0) * 255.0);
+	};
+
+	unsigned wrong = 0;
+	for (unsigned expected : stages) {
+		processor.ProcessFrame();
+		wrong += (level() != expected) ? 1 : 0;
+	}
+	bool passed = (wrong == 0);
+	int failures = passed ? 0 : 1;
+	printf("Envelope, %u of %u frames off through delay, attack, hold, decay and sustain %s\n", wrong,
+		(unsigned)(sizeof(stages) / sizeof(stages[0])), passed ? "passed" : "FAILED");
+
+	processor.MethodWrite(NV1BA0_PIO_VOICE_RELEASE, 0);
+	wrong = 0;
+	for (unsigned expected : released) {
+		processor.ProcessFrame();
+		wrong += (level() != expected) ? 1 : 0;
+	}
+	// The release reaches zero on the next frame, which turns the voice off
+	processor.ProcessFrame();
+	bool silent = (MixBinPeak(processor, 0) == 0);
+	processor.ProcessFrame();
+	passed = (wrong == 0) && silent && (processor.GetVoicesLastFrame() == 0);
+	failures += passed ? 0 : 1;
+	printf("Envelope release from sustain, %u of %u frames off, then off %s\n", wrong,
+		(unsigned)(sizeof(released) / sizeof(released[0])), passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+// Each of the eight mixbins of a voice has its own volume, the last two of them are made of
+// nibbles of VOLA, VOLB and VOLC. Volumes count 1/64 dB, so slot n at n * 64 is n dB down.
+static int SelfTestMixBinVolumes()
+{
+	std::vector<uint8_t> memory(SELFTEST_MEMORY_SIZE);
+	APUVoiceProcessor processor(memory.data(), SELFTEST_MEMORY_SIZE);
+	SelfTestMemory(memory, processor);
+
+	int16_t* pLevel = (int16_t*)&memory[SELFTEST_BUFFER_DATA];
+	for (unsigned i = 0; i < SELFTEST_BUFFER_FRAMES; i++) {
+		pLevel[i] = 0x4000;
+	}
+	const uint32_t pcm16 = (APU_VP_CONTAINER_B16 << 30) | (APU_VP_SAMPLE_S16 << 28) | NV_PAVS_VOICE_CFG_FMT_LOOP;
+	SelfTestBufferVoice(processor, pcm16, SELFTEST_BUFFER_FRAMES, 0);
+
+	static const unsigned bins[8] = { 3, 7, 11, 15, 19, 23, 27, 31 };
+	uint32_t volumes[8];
+	for (unsigned slot = 0; slot < 8; slot++) {
+		volumes[slot] = slot * 64;
+	}
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_VBIN,
+		bins[0] | (bins[1] << 5) | (bins[2] << 10) | (bins[3] << 16) | (bins[4] << 21) | (bins[5] << 26));
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_FMT, pcm16 | bins[6] | (bins[7] << 5));
+	uint32_t vola = (volumes[0] << 4) | (volumes[1] << 20) | (volumes[6] & 0xF) | ((volumes[7] & 0xF) << 16);
+	uint32_t volb = (volumes[2] << 4) | (volumes[3] << 20) | ((volumes[6] >> 4) & 0xF) | (((volumes[7] >> 4) & 0xF) << 16);
+	uint32_t volc = (volumes[4] << 4) | (volumes[5] << 20) | (volumes[6] >> 8) | ((volumes[7] >> 8) << 16);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLA, vola);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLB, volb);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_TAR_VOLC, volc);
+	processor.ProcessFrame();
+
+	unsigned wrong = 0;
+	for (unsigned bin = 0; bin < APU_VP_MIXBINS; bin++) {
+		int32_t expected = 0;
+		for (unsigned slot = 0; slot < 8; slot++) {
+			if (bins[slot] == bin) {
+				expected = (int32_t)(0.5 * pow(10.0, -(double)slot / 20.0) * 8388607.0);
+			}
+		}
+		// Volume gains are good to about 1e-7, a few units of a 24 bit sample at most
+		wrong += (std::abs(MixBinPeak(processor, bin) - expected) > 4) ? 1 : 0;
+	}
+
+	bool passed = (wrong == 0);
+	int failures = passed ? 0 : 1;
+	printf("Mixbin volumes, 0 to 7 dB down on 8 of 32 mixbins, %u mixbins off %s\n", wrong, passed ? "passed" : "FAILED");
+	return failures;
+}
+
+// Drives the processor like the DirectSound driver would: a looping buffer voice on the front left
+// mixbin and a stream voice on the front right one, whose segment lists run dry and are queued again
+static int SelfTest()
+{
+	std::vector<uint8_t> memory(SELFTEST_MEMORY_SIZE);
+	APUVoiceProcessor processor(memory.data(), SELFTEST_MEMORY_SIZE);
+	int failures = 0;
+
+	SelfTestMemory(memory, processor);
+
+	// 1 KHz sine in a buffer of two pages
+	int16_t* pSine = (int16_t*)&memory[SELFTEST_BUFFER_DATA];
+	for (unsigned i = 0; i < SELFTEST_BUFFER_FRAMES; i++) {
+		pSine[i] = (int16_t)(32767.0 * sin(2.0 * 3.14159265358979 * 1000.0 * i / APU_VP_SAMPLE_RATE));
+	}
+
+	// Constant half scale stream, three segments
+	int16_t* pStream = (int16_t*)&memory[SELFTEST_STREAM_DATA];
+	for (unsigned i = 0; i < SELFTEST_SEGMENT_FRAMES * 3; i++) {
+		pStream[i] = 0x4000;
+	}
+
+	const uint32_t pcm16 = (APU_VP_CONTAINER_B16 << 30) | (APU_VP_SAMPLE_S16 << 28);
+	SelfTestVoice(processor, 0, pcm16 | NV_PAVS_VOICE_CFG_FMT_LOOP, 0);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_BUF_BASE, 0);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_BUF_LBO, 0);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_BUF_CBO, 0);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_CFG_BUF_EBO, SELFTEST_BUFFER_FRAMES - 1);
+	processor.MethodWrite(NV1BA0_PIO_SET_ANTECEDENT_VOICE, 1 << 16); // On top of the 2D list
+	processor.MethodWrite(NV1BA0_PIO_VOICE_ON, 0);
+
+	// List A holds the first two segments, list B the third one
+	for (uint32_t segment = 0; segment < 3; segment++) {
+		if (segment != 2) {
+			processor.MethodWrite(NV1BA0_PIO_SET_CURRENT_SSL, 0);
+		} else {
+			processor.MethodWrite(NV1BA0_PIO_SET_CURRENT_SSL, 2 * 8);
+		}
+		uint32_t method = NV1BA0_PIO_SET_SSL_SEGMENT_OFFSET + (segment % 2) * 8;
+		processor.MethodWrite(method, SELFTEST_STREAM_DATA + segment * SELFTEST_SEGMENT_FRAMES * 2);
+		processor.MethodWrite(method + 4, SELFTEST_SEGMENT_FRAMES);
+	}
+	SelfTestVoice(processor, 1, pcm16 | NV_PAVS_VOICE_CFG_FMT_DATA_TYPE, 1);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_SSL_A, (0 << 8) | 2);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_SSL_B, (2 << 8) | 1);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_BUF_CBO, 0);
+	processor.MethodWrite(NV1BA0_PIO_SET_ANTECEDENT_VOICE, 1 << 16);
+	processor.MethodWrite(NV1BA0_PIO_VOICE_ON, 1);
+
+	const unsigned streamFrames = SELFTEST_SEGMENT_FRAMES * 3 / APU_VP_FRAME_SAMPLES;
+	const int32_t halfScale = 0x400000;
+	int32_t sinePeak = 0;
+	unsigned streamPlayed = 0, leaks = 0;
+	for (unsigned frame = 0; frame < streamFrames + 10; frame++) {
+		processor.ProcessFrame();
+		sinePeak = std::max(sinePeak, MixBinPeak(processor, 0));
+		int32_t streamPeak = MixBinPeak(processor, 1);
+		if (frame < streamFrames) {
+			streamPlayed += (std::abs(streamPeak - halfScale) < 0x100) ? 1 : 0;
+		} else {
+			leaks += (streamPeak != 0) ? 1 : 0;
+		}
+	}
+
+	bool passed = sinePeak > 0x780000;
+	failures += passed ? 0 : 1;
+	printf("Buffer voice, looping sine: peak %.3f %s\n", sinePeak / 8388607.0, passed ? "passed" : "FAILED");
+
+	passed = (streamPlayed == streamFrames) && (processor.GetVoicesLastFrame() == 2);
+	failures += passed ? 0 : 1;
+	printf("Stream voice, %u of %u frames from segment lists A and B %s\n", streamPlayed, streamFrames, passed ? "passed" : "FAILED");
+
+	passed = (leaks == 0);
+	failures += passed ? 0 : 1;
+	printf("Stream voice, silent and still on after an underrun %s\n", passed ? "passed" : "FAILED");
+
+	// Queue list A again, the voice has to pick it up
+	processor.MethodWrite(NV1BA0_PIO_SET_CURRENT_VOICE, 1);
+	processor.MethodWrite(NV1BA0_PIO_SET_VOICE_SSL_A, (0 << 8) | 2);
+	processor.ProcessFrame();
+	passed = std::abs(MixBinPeak(processor, 1) - halfScale) < 0x100;
+	failures += passed ? 0 : 1;
+	printf("Stream voice, resumes once a list is queued again %s\n", passed ? "passed" : "FAILED");
+
+	failures += SelfTestPcmFormats();
+	failures += SelfTestAdpcm();
+	failures += SelfTestPitch();
+	failures += SelfTestEnvelope();
+	failures += SelfTestMixBinVolumes();
+	return failures;
+}
+
+int ToolRenderApu(int argc, char** argv)
+{
+	if (argc == 0) {
+		return SelfTest();
+	}
+	if (argc < 2) {
+		fprintf(stderr, "Missing the output wav\n");
+		return 1;
+	}
+
+	double seconds = (argc > 2) ? strtod(argv[2], nullptr) : 10.0;
+	if (seconds <= 0.0) {
+		fprintf(stderr, "Invalid duration: %s\n", argv[2]);
+		return 1;
+	}
+
+	return RenderDump(argv[0], argv[1], seconds);
+}
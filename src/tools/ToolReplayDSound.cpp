@@ -0,0 +1,672 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "common/audio/converter.hpp"
+#include "common/XADPCM.h"
+#include "core/hle/DSOUND/common/DSoundBufferCache.hpp"
+#include "core/hle/DSOUND/common/DSoundTrace.hpp"
+#include "core/hle/DSOUND/common/SoftwareMixer.hpp"
+#include "Tools.h"
+
+// Host side of a format, same conversion as GeneratePCMFormat does: XADPCM is decoded
+// to 16 bit PCM, PCM is kept as is. Anything the mixer can't take has no host voice.
+static inline bool TraceFormatIsXADPCM(const DSoundTraceFormat& Format)
+{
+	return Format.FormatTag == DSOUND_TRACE_FORMAT_XADPCM;
+}
+
+static inline uint16_t TraceFormatHostBits(const DSoundTraceFormat& Format)
+{
+	if (Format.FormatTag == 0 || Format.Channels == 0) {
+		return 0;
+	}
+	if (TraceFormatIsXADPCM(Format)) {
+		return 16;
+	}
+	return (Format.BitsPerSample == 8 || Format.BitsPerSample == 16) ? Format.BitsPerSample : 0;
+}
+
+static inline uint32_t TraceFormatHostBytes(const DSoundTraceFormat& Format, uint32_t XboxBytes)
+{
+	if (TraceFormatIsXADPCM(Format)) {
+		return XboxBytes / XBOX_ADPCM_SRCSIZE * XBOX_ADPCM_DSTSIZE;
+	}
+	return XboxBytes;
+}
+
+static inline uint32_t TraceFormatXboxAlign(const DSoundTraceFormat& Format)
+{
+	if (TraceFormatIsXADPCM(Format)) {
+		return XBOX_ADPCM_SRCSIZE * Format.Channels;
+	}
+	return Format.BlockAlign != 0 ? Format.BlockAlign : 1;
+}
+
+// Converts whole blocks of Xbox data that fit in the host range, returns the Xbox bytes converted.
+static uint32_t TraceConvertToHost(const DSoundTraceFormat& Format, const uint8_t* pXbox, uint32_t XboxBytes, uint8_t* pHost, uint32_t HostBytes)
+{
+	if (TraceFormatIsXADPCM(Format)) {
+		uint32_t blockBytes = XBOX_ADPCM_SRCSIZE * Format.Channels;
+		uint32_t blocks = XboxBytes / blockBytes;
+		uint32_t hostBlockBytes = XBOX_ADPCM_DSTSIZE * Format.Channels;
+		if (blocks > HostBytes / hostBlockBytes) {
+			blocks = HostBytes / hostBlockBytes;
+		}
+		TXboxAdpcmDecoder_DecodeBlocks(pXbox, reinterpret_cast<int16_t*>(pHost), blocks, Format.Channels);
+		return blocks * blockBytes;
+	}
+
+	uint32_t bytes = XboxBytes < HostBytes ? XboxBytes : HostBytes;
+	memcpy(pHost, pXbox, bytes);
+	return bytes;
+}
+
+struct DSoundTraceReplayStats {
+	uint64_t Records;
+	uint64_t TraceTime;         // Microseconds covered by the trace
+	uint64_t ConvertedBytes;    // Xbox bytes of buffer data and packets converted to PCM
+	uint64_t MixedFrames;
+	uint32_t MaxVoices;
+	double   ConvertSeconds;    // Host time spent on conversion
+	// One entry per mix call of SOFTWARE_MIXER_PERIOD frames
+	std::vector<float>    PeriodSeconds;
+	std::vector<uint16_t> PeriodVoices;
+};
+
+// Rebuilds the voices of a trace on the software mixer and mixes them as fast as possible,
+// in steps of SOFTWARE_MIXER_PERIOD frames following the trace timestamps. Buffer contents
+// go through DSoundBufferCache dirty range uploads and the XADPCM decoder like they do in
+// DSoundBufferUploadDirty, voice properties through the same converters as the HLE.
+class DSoundTraceReplayer {
+public:
+	DSoundTraceReplayer(std::unique_ptr<SoftwareMixerSink> Sink) : m_Mixer(std::move(Sink)) {}
+	~DSoundTraceReplayer();
+
+	// Returns false if the file isn't a trace of a known version.
+	bool Run(FILE* pFile);
+	const DSoundTraceReplayStats& GetStats() const { return m_Stats; }
+	void PrintStats() const;
+
+private:
+	struct Voice {
+		bool IsStream = false;
+		DSoundTraceFormat Format = {};
+		SoftwareMixerVoice* pVoice = nullptr; // nullptr when the format can't be mixed
+		DSoundBufferCache Cache;              // Buffers only, Xbox side contents
+		uint32_t XboxBytes = 0;
+		uint32_t Frequency = 0;
+		int32_t  Volume = 0;
+		bool     Started = false;
+		bool     Looping = false;
+		bool     Paused = false;
+
+		// Streams write packets one after another into a looping host voice, which
+		// stops once it played everything queued.
+		uint32_t WriteOffset = 0;
+		uint64_t QueuedFrames = 0;
+		uint64_t PlayedFrames = 0;
+		uint32_t LastFrame = 0;
+	};
+
+	void Apply(const DSoundTraceRecord& Record, const uint8_t* pPayload);
+	void CreateVoice(uint32_t Object, bool IsStream, uint32_t XboxBytes, const DSoundTraceFormat& Format);
+	void DestroyVoice(uint32_t Object);
+	// Converts everything written since the last upload into the host voice.
+	void UploadBufferData(Voice& voice);
+	void QueuePacket(Voice& voice, const uint8_t* pData, uint32_t Bytes);
+	void AdvanceTo(uint64_t Time);
+	unsigned UpdateStreams();
+
+	SoftwareMixer m_Mixer;
+	std::unordered_map<uint32_t, std::unique_ptr<Voice>> m_Voices;
+	std::vector<uint8_t> m_Scratch;
+	DSoundTraceReplayStats m_Stats = {};
+};
+
+static double TraceClockSeconds(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+}
+
+DSoundTraceReplayer::~DSoundTraceReplayer()
+{
+	for (auto& entry : m_Voices) {
+		if (entry.second->pVoice != nullptr) {
+			m_Mixer.DestroyVoice(entry.second->pVoice);
+		}
+	}
+}
+
+bool DSoundTraceReplayer::Run(FILE* pFile)
+{
+	DSoundTraceHeader header;
+	if (fread(&header, sizeof(header), 1, pFile) != 1 || header.Magic != DSOUND_TRACE_MAGIC || header.Version != DSOUND_TRACE_VERSION) {
+		return false;
+	}
+
+	DSoundTraceRecord record;
+	std::vector<uint8_t> payload;
+	while (fread(&record, sizeof(record), 1, pFile) == 1) {
+		payload.resize(record.PayloadBytes);
+		if (record.PayloadBytes != 0 && fread(payload.data(), record.PayloadBytes, 1, pFile) != 1) {
+			break; // Capture got cut short
+		}
+
+		AdvanceTo(record.Time);
+		Apply(record, payload.data());
+		m_Stats.Records++;
+		m_Stats.TraceTime = record.Time;
+	}
+
+	m_Mixer.Flush();
+	return true;
+}
+
+void DSoundTraceReplayer::PrintStats() const
+{
+	size_t periods = m_Stats.PeriodSeconds.size();
+	double total = 0.0;
+	for (float seconds : m_Stats.PeriodSeconds) {
+		total += seconds;
+	}
+	std::vector<float> sorted(m_Stats.PeriodSeconds);
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double p) { return periods ? sorted[std::min(periods - 1, (size_t)(p * periods))] * 1e6 : 0.0; };
+	double audioSeconds = (double)m_Stats.MixedFrames / SOFTWARE_MIXER_RATE;
+
+	printf("Replayed %llu records, %.3f s of audio, %llu frames mixed, %u voices at most\n",
+		(unsigned long long)m_Stats.Records, m_Stats.TraceTime / 1000000.0, (unsigned long long)m_Stats.MixedFrames, m_Stats.MaxVoices);
+	printf("Converted %llu bytes in %.3f ms\n", (unsigned long long)m_Stats.ConvertedBytes, m_Stats.ConvertSeconds * 1000.0);
+	printf("Mix per %u frames: %.2f us average, %.2f us median, %.2f us 99th percentile, %.2f us worst\n", SOFTWARE_MIXER_PERIOD,
+		periods ? total * 1e6 / periods : 0.0, percentile(0.5), percentile(0.99), percentile(1.0));
+	printf("Mix per frame: %.1f ns, %.0fx real time\n", m_Stats.MixedFrames ? total * 1e9 / m_Stats.MixedFrames : 0.0,
+		total > 0.0 ? audioSeconds / total : 0.0);
+}
+
+void DSoundTraceReplayer::Apply(const DSoundTraceRecord& Record, const uint8_t* pPayload)
+{
+	switch (Record.Type) {
+		case DSOUND_TRACE_BUFFER_CREATE:
+		case DSOUND_TRACE_STREAM_CREATE:
+			if (Record.PayloadBytes >= sizeof(DSoundTraceFormat)) {
+				DSoundTraceFormat format;
+				memcpy(&format, pPayload, sizeof(format));
+				bool isStream = Record.Type == DSOUND_TRACE_STREAM_CREATE;
+				CreateVoice(Record.Object, isStream, isStream ? 0 : Record.Args[1], format);
+			}
+			return;
+		case DSOUND_TRACE_BUFFER_RELEASE:
+		case DSOUND_TRACE_STREAM_RELEASE:
+			DestroyVoice(Record.Object);
+			return;
+	}
+
+	auto it = m_Voices.find(Record.Object);
+	if (it == m_Voices.end()) {
+		return; // Created before the capture started
+	}
+	Voice& voice = *it->second;
+
+	switch (Record.Type) {
+		case DSOUND_TRACE_BUFFER_DATA: {
+			uint32_t offset = Record.Args[0];
+			uint32_t bytes = Record.PayloadBytes;
+			if (voice.IsStream || offset >= voice.XboxBytes) {
+				break;
+			}
+			if (bytes > voice.XboxBytes - offset) {
+				bytes = voice.XboxBytes - offset;
+			}
+			memcpy(static_cast<uint8_t*>(voice.Cache.GetData()) + offset, pPayload, bytes);
+			voice.Cache.MarkDirty(offset, bytes);
+			UploadBufferData(voice);
+			break;
+		}
+		case DSOUND_TRACE_BUFFER_RESIZE:
+			if (voice.IsStream) {
+				break;
+			}
+			voice.Cache.Resize(Record.Args[0]);
+			voice.XboxBytes = Record.Args[0];
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice.pVoice->Data.resize(TraceFormatHostBytes(voice.Format, voice.XboxBytes));
+				SoftwareMixer::SetVoiceFormat(voice.pVoice, voice.pVoice->Channels, voice.pVoice->BitsPerSample, voice.pVoice->Frequency);
+			}
+			voice.Cache.MarkDirty(0, voice.XboxBytes);
+			UploadBufferData(voice);
+			break;
+		case DSOUND_TRACE_BUFFER_PLAY:
+			voice.Started = true;
+			voice.Looping = (Record.Args[0] & DSOUND_TRACE_PLAY_LOOPING) != 0;
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice.pVoice->Looping = voice.Looping;
+				if (Record.Args[0] & DSOUND_TRACE_PLAY_FROMSTART) {
+					voice.pVoice->Position = 0;
+				}
+				voice.pVoice->Playing = !voice.Paused;
+			}
+			break;
+		case DSOUND_TRACE_BUFFER_STOP:
+			voice.Started = false;
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice.pVoice->Playing = false;
+				voice.pVoice->Position = 0;
+			}
+			break;
+		case DSOUND_TRACE_BUFFER_POSITION:
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				uint64_t frame = TraceFormatHostBytes(voice.Format, Record.Args[0]) / voice.pVoice->BlockAlign;
+				voice.pVoice->Position = frame < voice.pVoice->FrameCount ? frame << 32 : 0;
+			}
+			break;
+		case DSOUND_TRACE_STREAM_PACKET:
+			if (voice.IsStream) {
+				QueuePacket(voice, pPayload, Record.PayloadBytes);
+			}
+			break;
+		case DSOUND_TRACE_STREAM_FLUSH:
+			voice.WriteOffset = 0;
+			voice.QueuedFrames = 0;
+			voice.PlayedFrames = 0;
+			voice.LastFrame = 0;
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice.pVoice->Playing = false;
+				voice.pVoice->Position = 0;
+			}
+			break;
+		case DSOUND_TRACE_STREAM_DISCONTINUITY:
+			// Streams already stop once all queued packets are played.
+			break;
+		case DSOUND_TRACE_PAUSE:
+			voice.Paused = Record.Args[0] != 0;
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				bool pending = voice.IsStream ? voice.PlayedFrames < voice.QueuedFrames : voice.Started;
+				voice.pVoice->Playing = pending && !voice.Paused;
+			}
+			break;
+		case DSOUND_TRACE_FORMAT:
+			if (Record.PayloadBytes >= sizeof(DSoundTraceFormat)) {
+				DSoundTraceFormat format;
+				memcpy(&format, pPayload, sizeof(format));
+				// Host voice gets re-created like HybridDirectSoundBuffer_SetFormat does.
+				std::unique_ptr<Voice> old = std::move(it->second);
+				m_Voices.erase(it);
+				if (old->pVoice != nullptr) {
+					m_Mixer.DestroyVoice(old->pVoice);
+				}
+				CreateVoice(Record.Object, old->IsStream, old->XboxBytes, format);
+				Voice& recreated = *m_Voices[Record.Object];
+				recreated.Volume = old->Volume;
+				recreated.Paused = old->Paused;
+				recreated.Started = old->Started;
+				recreated.Looping = old->Looping;
+				if (!recreated.IsStream && old->XboxBytes != 0) {
+					memcpy(recreated.Cache.GetData(), old->Cache.GetData(), old->XboxBytes);
+					recreated.Cache.MarkDirty(0, old->XboxBytes);
+					UploadBufferData(recreated);
+				}
+				if (recreated.pVoice != nullptr) {
+					std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+					recreated.pVoice->Volume = recreated.Volume;
+					if (!recreated.IsStream) {
+						recreated.pVoice->Looping = recreated.Looping;
+						recreated.pVoice->Playing = recreated.Started && !recreated.Paused;
+					}
+				}
+			}
+			break;
+		case DSOUND_TRACE_FREQUENCY:
+		case DSOUND_TRACE_PITCH:
+			if (Record.Type == DSOUND_TRACE_PITCH) {
+				voice.Frequency = converter_pitch2freq(static_cast<int32_t>(Record.Args[0]));
+			} else {
+				// Zero restores the frequency of the format.
+				voice.Frequency = Record.Args[0] != 0 ? Record.Args[0] : voice.Format.SamplesPerSec;
+			}
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice.pVoice->Frequency = voice.Frequency;
+			}
+			break;
+		case DSOUND_TRACE_VOLUME: {
+			int32_t volume = static_cast<int32_t>(Record.Args[0]);
+			voice.Volume = volume > 0 ? 0 : (volume < -10000 ? -10000 : volume);
+			if (voice.pVoice != nullptr) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice.pVoice->Volume = voice.Volume;
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void DSoundTraceReplayer::CreateVoice(uint32_t Object, bool IsStream, uint32_t XboxBytes, const DSoundTraceFormat& Format)
+{
+	// Address got reused without a release in the trace.
+	DestroyVoice(Object);
+
+	std::unique_ptr<Voice> voice(new Voice);
+	voice->IsStream = IsStream;
+	voice->Format = Format;
+	voice->XboxBytes = XboxBytes;
+	voice->Frequency = Format.SamplesPerSec;
+	if (!IsStream) {
+		voice->Cache.Resize(XboxBytes);
+	}
+
+	uint16_t bits = TraceFormatHostBits(Format);
+	if (bits != 0) {
+		// Streams get 5 seconds worth of host buffer, same as DirectSoundCreateStream.
+		uint32_t hostBytes = IsStream ? Format.SamplesPerSec * Format.Channels * (bits / 8) * 5
+		                              : TraceFormatHostBytes(Format, XboxBytes);
+		if (hostBytes != 0) {
+			voice->pVoice = m_Mixer.CreateVoice(hostBytes, Format.Channels, bits, Format.SamplesPerSec);
+			if (IsStream) {
+				std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+				voice->pVoice->Looping = true;
+			}
+		}
+	}
+
+	m_Voices[Object] = std::move(voice);
+}
+
+void DSoundTraceReplayer::DestroyVoice(uint32_t Object)
+{
+	auto it = m_Voices.find(Object);
+	if (it == m_Voices.end()) {
+		return;
+	}
+	if (it->second->pVoice != nullptr) {
+		m_Mixer.DestroyVoice(it->second->pVoice);
+	}
+	m_Voices.erase(it);
+}
+
+void DSoundTraceReplayer::UploadBufferData(Voice& voice)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	const uint8_t* pXbox = static_cast<const uint8_t*>(voice.Cache.GetData());
+	uint32_t align = TraceFormatXboxAlign(voice.Format);
+
+	std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+	uint8_t* pHost = voice.pVoice != nullptr ? voice.pVoice->Data.data() : nullptr;
+	uint32_t hostSize = voice.pVoice != nullptr ? static_cast<uint32_t>(voice.pVoice->Data.size()) : 0;
+
+	// Same dirty range walk as DSoundBufferUploadDirty, a title rewriting the same bytes over and
+	// over only pays for the conversion once. What the host side has no room for stays dirty.
+	uint32_t converted = voice.Cache.Upload(0, voice.XboxBytes, align, [&](uint32_t RangeOffset, uint32_t RangeBytes) -> uint32_t {
+		if (pHost == nullptr) {
+			return 0;
+		}
+		uint32_t hostOffset = TraceFormatHostBytes(voice.Format, RangeOffset);
+		if (hostOffset >= hostSize) {
+			return 0;
+		}
+		return TraceConvertToHost(voice.Format, pXbox + RangeOffset, RangeBytes, pHost + hostOffset, hostSize - hostOffset);
+	});
+
+	m_Stats.ConvertedBytes += converted;
+	m_Stats.ConvertSeconds += TraceClockSeconds(start);
+}
+
+void DSoundTraceReplayer::QueuePacket(Voice& voice, const uint8_t* pData, uint32_t Bytes)
+{
+	if (voice.pVoice == nullptr || Bytes == 0) {
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	m_Scratch.resize(TraceFormatHostBytes(voice.Format, Bytes));
+	uint32_t converted = TraceConvertToHost(voice.Format, pData, Bytes, m_Scratch.data(), static_cast<uint32_t>(m_Scratch.size()));
+	uint32_t hostBytes = TraceFormatHostBytes(voice.Format, converted);
+
+	std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+	SoftwareMixerVoice& host = *voice.pVoice;
+	uint32_t ringBytes = static_cast<uint32_t>(host.Data.size());
+
+	// Packet data starts right where the voice resumes when it ran dry.
+	if (voice.PlayedFrames >= voice.QueuedFrames) {
+		host.Position = static_cast<uint64_t>(voice.WriteOffset / host.BlockAlign) << 32;
+		voice.LastFrame = voice.WriteOffset / host.BlockAlign;
+		voice.PlayedFrames = voice.QueuedFrames;
+	}
+
+	// Packets larger than the ring keep only their tail, like the partial upload of the packet manager.
+	uint32_t skip = hostBytes > ringBytes ? hostBytes - ringBytes : 0;
+	for (uint32_t copied = skip; copied < hostBytes;) {
+		uint32_t chunk = ringBytes - voice.WriteOffset;
+		if (chunk > hostBytes - copied) {
+			chunk = hostBytes - copied;
+		}
+		memcpy(host.Data.data() + voice.WriteOffset, m_Scratch.data() + copied, chunk);
+		copied += chunk;
+		voice.WriteOffset = (voice.WriteOffset + chunk) % ringBytes;
+	}
+	voice.QueuedFrames += hostBytes / host.BlockAlign;
+	host.Playing = !voice.Paused;
+
+	m_Stats.ConvertedBytes += converted;
+	m_Stats.ConvertSeconds += TraceClockSeconds(start);
+}
+
+// Stops streams that played everything queued, returns the voices playing.
+unsigned DSoundTraceReplayer::UpdateStreams()
+{
+	std::lock_guard<std::mutex> lock(m_Mixer.Mutex);
+
+	unsigned playing = 0;
+	for (auto& entry : m_Voices) {
+		Voice& voice = *entry.second;
+		if (voice.pVoice == nullptr) {
+			continue;
+		}
+		SoftwareMixerVoice& host = *voice.pVoice;
+		if (voice.IsStream && host.FrameCount != 0) {
+			uint32_t frame = static_cast<uint32_t>(host.Position >> 32);
+			voice.PlayedFrames += (frame + host.FrameCount - voice.LastFrame) % host.FrameCount;
+			voice.LastFrame = frame;
+			if (voice.PlayedFrames >= voice.QueuedFrames) {
+				// Starved, wait for the next packet.
+				voice.PlayedFrames = voice.QueuedFrames;
+				host.Playing = false;
+			}
+		}
+		if (host.Playing) {
+			playing++;
+		}
+	}
+	m_Stats.MaxVoices = std::max(m_Stats.MaxVoices, playing);
+	return playing;
+}
+
+void DSoundTraceReplayer::AdvanceTo(uint64_t Time)
+{
+	uint64_t targetFrames = Time * SOFTWARE_MIXER_RATE / 1000000;
+
+	while (m_Stats.MixedFrames + SOFTWARE_MIXER_PERIOD <= targetFrames) {
+		unsigned voices = UpdateStreams();
+
+		auto start = std::chrono::steady_clock::now();
+		m_Mixer.Process(SOFTWARE_MIXER_PERIOD);
+		m_Stats.PeriodSeconds.push_back((float)TraceClockSeconds(start));
+		m_Stats.PeriodVoices.push_back((uint16_t)std::min(voices, 0xFFFFu));
+		m_Stats.MixedFrames += SOFTWARE_MIXER_PERIOD;
+	}
+	UpdateStreams();
+}
+
+static void WriteTraceRecord(FILE* pFile, uint32_t Type, uint32_t Object, uint64_t Time, uint32_t Arg0 = 0, uint32_t Arg1 = 0,
+	const void* pPayload = nullptr, uint32_t PayloadBytes = 0)
+{
+	DSoundTraceRecord record = { Type, Object, Time, { Arg0, Arg1 }, PayloadBytes, 0 };
+	fwrite(&record, sizeof(record), 1, pFile);
+	if (PayloadBytes != 0) {
+		fwrite(pPayload, PayloadBytes, 1, pFile);
+	}
+}
+
+// Replays a synthetic trace of a second: a looping PCM buffer, partly rewritten while it plays and
+// stopped at 0.5 s, and an ADPCM stream fed ten packets ahead of time, which then starves
+#define REPLAY_TEST_BUFFER       0x1000
+#define REPLAY_TEST_STREAM       0x2000
+#define REPLAY_TEST_BUFFER_BYTES 4800
+#define REPLAY_TEST_PACKETS      10
+#define REPLAY_TEST_PACKET_BLOCKS 20
+
+static int SelfTest()
+{
+	FILE* pTrace = tmpfile();
+	if (pTrace == nullptr) {
+		printf("Can't create a temporary trace\n");
+		return 1;
+	}
+
+	DSoundTraceHeader header = { DSOUND_TRACE_MAGIC, DSOUND_TRACE_VERSION };
+	fwrite(&header, sizeof(header), 1, pTrace);
+	unsigned records = 0;
+
+	DSoundTraceFormat pcm = { 1 /*WAVE_FORMAT_PCM*/, 1, 24000, 16, 2 };
+	std::vector<int16_t> level(REPLAY_TEST_BUFFER_BYTES / 2, 0x2000);
+	WriteTraceRecord(pTrace, DSOUND_TRACE_BUFFER_CREATE, REPLAY_TEST_BUFFER, 0, 0, REPLAY_TEST_BUFFER_BYTES, &pcm, sizeof(pcm));
+	WriteTraceRecord(pTrace, DSOUND_TRACE_BUFFER_DATA, REPLAY_TEST_BUFFER, 0, 0, 0, level.data(), REPLAY_TEST_BUFFER_BYTES);
+	WriteTraceRecord(pTrace, DSOUND_TRACE_BUFFER_PLAY, REPLAY_TEST_BUFFER, 0, DSOUND_TRACE_PLAY_LOOPING);
+	records += 3;
+
+	DSoundTraceFormat adpcm = { DSOUND_TRACE_FORMAT_XADPCM, 2, 48000, 4, XBOX_ADPCM_SRCSIZE * 2 };
+	WriteTraceRecord(pTrace, DSOUND_TRACE_STREAM_CREATE, REPLAY_TEST_STREAM, 0, 0, 16, &adpcm, sizeof(adpcm));
+	records++;
+
+	// Packets are 1300 frames, 27 ms, and arrive every 25 ms
+	std::mt19937 random(0x44535452);
+	std::vector<uint8_t> packet(REPLAY_TEST_PACKET_BLOCKS * XBOX_ADPCM_SRCSIZE * 2);
+	for (unsigned p = 0; p < REPLAY_TEST_PACKETS; p++) {
+		for (uint8_t& byte : packet) {
+			byte = (uint8_t)random();
+		}
+		for (unsigned block = 0; block < REPLAY_TEST_PACKET_BLOCKS; block++) {
+			for (unsigned c = 0; c < 2; c++) {
+				packet[block * XBOX_ADPCM_SRCSIZE * 2 + c * 4 + 2] = (uint8_t)(random() % 89);
+			}
+		}
+		WriteTraceRecord(pTrace, DSOUND_TRACE_STREAM_PACKET, REPLAY_TEST_STREAM, p * 25000, (uint32_t)packet.size(), 0,
+			packet.data(), (uint32_t)packet.size());
+		records++;
+	}
+
+	// Only the rewritten half is converted again
+	WriteTraceRecord(pTrace, DSOUND_TRACE_BUFFER_DATA, REPLAY_TEST_BUFFER, 250000, REPLAY_TEST_BUFFER_BYTES / 2, 0,
+		level.data(), REPLAY_TEST_BUFFER_BYTES / 2);
+	WriteTraceRecord(pTrace, DSOUND_TRACE_BUFFER_STOP, REPLAY_TEST_BUFFER, 500000);
+	WriteTraceRecord(pTrace, DSOUND_TRACE_VOLUME, REPLAY_TEST_BUFFER, 1000000, (uint32_t)-600);
+	records += 3;
+	rewind(pTrace);
+
+	DSoundTraceReplayer replayer(std::unique_ptr<SoftwareMixerSink>(new SoftwareMixerNullSink));
+	bool read = replayer.Run(pTrace);
+	fclose(pTrace);
+	const DSoundTraceReplayStats& stats = replayer.GetStats();
+	replayer.PrintStats();
+	int failures = 0;
+
+	bool passed = read && (stats.Records == records) && (stats.TraceTime == 1000000) && (stats.MixedFrames == SOFTWARE_MIXER_RATE);
+	failures += passed ? 0 : 1;
+	printf("Replayed %llu of %u records and %llu of %u frames %s\n", (unsigned long long)stats.Records, records,
+		(unsigned long long)stats.MixedFrames, SOFTWARE_MIXER_RATE, passed ? "passed" : "FAILED");
+
+	uint64_t expectedBytes = REPLAY_TEST_BUFFER_BYTES + REPLAY_TEST_BUFFER_BYTES / 2 + (uint64_t)REPLAY_TEST_PACKETS * packet.size();
+	passed = (stats.ConvertedBytes == expectedBytes);
+	failures += passed ? 0 : 1;
+	printf("Converted %llu of %llu bytes, buffer rewrites only convert what changed %s\n", (unsigned long long)stats.ConvertedBytes,
+		(unsigned long long)expectedBytes, passed ? "passed" : "FAILED");
+
+	// The stream plays 13000 frames, until period 27, the buffer until it's stopped at period 50
+	const unsigned streamEnd = REPLAY_TEST_PACKETS * REPLAY_TEST_PACKET_BLOCKS * (XBOX_ADPCM_DSTSIZE / 2) / SOFTWARE_MIXER_PERIOD;
+	const unsigned bufferEnd = SOFTWARE_MIXER_RATE / 2 / SOFTWARE_MIXER_PERIOD;
+	unsigned wrong = 0;
+	for (unsigned period = 0; period < stats.PeriodVoices.size(); period++) {
+		unsigned expected = (period < streamEnd) ? 2 : (period < bufferEnd) ? 1 : 0;
+		if (period != streamEnd) { // Starvation shows up within the period it happens in
+			wrong += (stats.PeriodVoices[period] != expected) ? 1 : 0;
+		}
+	}
+	passed = (wrong == 0) && (stats.MaxVoices == 2);
+	failures += passed ? 0 : 1;
+	printf("Voices per period, stream until it starves and buffer until it stops, %u periods off %s\n", wrong, passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+int ToolReplayDSound(int argc, char** argv)
+{
+	if (argc == 0) {
+		return SelfTest();
+	}
+
+	FILE* pTrace = fopen(argv[0], "rb");
+	if (pTrace == nullptr) {
+		fprintf(stderr, "Can't open %s\n", argv[0]);
+		return 1;
+	}
+
+	std::unique_ptr<SoftwareMixerSink> sink(new SoftwareMixerNullSink);
+	if (argc > 1) {
+		SoftwareMixerWavSink* pWav = new SoftwareMixerWavSink(argv[1]);
+		if (!pWav->IsOpen()) {
+			fprintf(stderr, "Can't create %s\n", argv[1]);
+			delete pWav;
+			fclose(pTrace);
+			return 1;
+		}
+		sink.reset(pWav);
+	}
+
+	DSoundTraceReplayer replayer(std::move(sink));
+	bool read = replayer.Run(pTrace);
+	fclose(pTrace);
+	if (!read) {
+		fprintf(stderr, "%s is not a DirectSound trace\n", argv[0]);
+		return 1;
+	}
+
+	replayer.PrintStats();
+	return 0;
+}
@@ -0,0 +1,64 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "common/crypto/EmuSha.h"
+#include "Tools.h"
+
+// Verifies and benchmarks the SHA-1 cores which are supported by the host cpu
+int ToolSha(int argc, char** argv)
+{
+	uint32_t megabytes = (argc > 0) ? strtoul(argv[0], nullptr, 0) : 256;
+	if (megabytes == 0) {
+		fprintf(stderr, "Invalid size: %s\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<unsigned char> data(1024 * 1024);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (unsigned char)(i * 2654435761u >> 24);
+	}
+
+	printf("Active core: %s\n", SHA1GetActiveCore().Name);
+
+	int failures = 0;
+	for (const SHA1Core& core : SHA1GetCores()) {
+		bool passed = SHA1TestCore(core.Transform);
+		failures += passed ? 0 : 1;
+
+		uint32_t state[5] = {};
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < megabytes; i++) {
+			core.Transform(state, data.data(), (uint32_t)(data.size() / 64));
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		printf("%-8s test vectors %s, %6.2f GB/s\n", core.Name, passed ? "passed" : "FAILED",
+			(megabytes / 1024.0) / elapsed.count());
+	}
+
+	return failures;
+}
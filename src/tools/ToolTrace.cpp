@@ -0,0 +1,331 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/Tracing.h"
+#include "Tools.h"
+
+// Just enough of a json reader to validate the files written by Trace_Flush
+typedef struct _JsonValue
+{
+	enum { Null, Bool, Number, String, Array, Object } Type = Null;
+	double Num = 0;
+	std::string Str;
+	std::vector<std::string> Keys;
+	std::vector<_JsonValue> Items; // the array items, or the values of Keys
+
+	const _JsonValue* Find(const char* Key) const
+	{
+		for (size_t i = 0; i < Keys.size(); i++) {
+			if (Keys[i] == Key) {
+				return &Items[i];
+			}
+		}
+		return nullptr;
+	}
+}
+JsonValue;
+
+class JsonReader
+{
+public:
+	JsonReader(const std::string& Text) : m_Text(Text), m_Pos(0) {}
+
+	bool Parse(JsonValue& Value, std::string& Error)
+	{
+		if (!ParseValue(Value, 0) || (SkipSpace(), m_Pos != m_Text.size())) {
+			Error = "invalid json at offset " + std::to_string(m_Pos);
+			return false;
+		}
+		return true;
+	}
+
+private:
+	void SkipSpace()
+	{
+		while (m_Pos < m_Text.size() && strchr(" \t\r\n", m_Text[m_Pos]) != nullptr) {
+			m_Pos++;
+		}
+	}
+
+	bool Expect(const char* Literal)
+	{
+		size_t Length = strlen(Literal);
+		if (m_Text.compare(m_Pos, Length, Literal) != 0) {
+			return false;
+		}
+		m_Pos += Length;
+		return true;
+	}
+
+	bool ParseString(std::string& Str)
+	{
+		if (!Expect("\"")) {
+			return false;
+		}
+		while (m_Pos < m_Text.size()) {
+			unsigned char c = m_Text[m_Pos++];
+			if (c == '"') {
+				return true;
+			}
+			if (c < 0x20) {
+				return false;
+			}
+			if (c != '\\') {
+				Str += c;
+				continue;
+			}
+			if (m_Pos >= m_Text.size()) {
+				return false;
+			}
+			c = m_Text[m_Pos++];
+			switch (c) {
+			case '"': case '\\': case '/': Str += c; break;
+			case 'b': Str += '\b'; break;
+			case 'f': Str += '\f'; break;
+			case 'n': Str += '\n'; break;
+			case 'r': Str += '\r'; break;
+			case 't': Str += '\t'; break;
+			case 'u': {
+				// The tracer only escapes control characters, so code points above 0xFF aren't expected
+				unsigned CodePoint;
+				if (m_Pos + 4 > m_Text.size() || sscanf(m_Text.c_str() + m_Pos, "%4x", &CodePoint) != 1 || CodePoint > 0xFF) {
+					return false;
+				}
+				Str += (char)CodePoint;
+				m_Pos += 4;
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool ParseValue(JsonValue& Value, int Depth)
+	{
+		SkipSpace();
+		if (m_Pos >= m_Text.size() || Depth > 64) {
+			return false;
+		}
+
+		char c = m_Text[m_Pos];
+		if (c == '{' || c == '[') {
+			bool IsObject = (c == '{');
+			Value.Type = IsObject ? JsonValue::Object : JsonValue::Array;
+			m_Pos++;
+			SkipSpace();
+			if (Expect(IsObject ? "}" : "]")) {
+				return true;
+			}
+			do {
+				SkipSpace();
+				if (IsObject) {
+					Value.Keys.emplace_back();
+					if (!ParseString(Value.Keys.back()) || (SkipSpace(), !Expect(":"))) {
+						return false;
+					}
+				}
+				Value.Items.emplace_back();
+				if (!ParseValue(Value.Items.back(), Depth + 1)) {
+					return false;
+				}
+				SkipSpace();
+			} while (Expect(","));
+			return Expect(IsObject ? "}" : "]");
+		}
+		if (c == '"') {
+			Value.Type = JsonValue::String;
+			return ParseString(Value.Str);
+		}
+		if (Expect("true") || Expect("false")) {
+			Value.Type = JsonValue::Bool;
+			Value.Num = (m_Text[m_Pos - 1] == 'e' && m_Text[m_Pos - 2] == 'u');
+			return true;
+		}
+		if (Expect("null")) {
+			return true;
+		}
+
+		const char* Start = m_Text.c_str() + m_Pos;
+		char* End;
+		Value.Type = JsonValue::Number;
+		Value.Num = strtod(Start, &End);
+		m_Pos += End - Start;
+		return End != Start;
+	}
+
+	const std::string& m_Text;
+	size_t m_Pos;
+};
+
+// Checks that FilePath holds a trace-event json file as written by the tracer: every event has a name,
+// a category, a phase, a timestamp and a thread, and complete events on one thread nest properly
+static bool ValidateTrace(const std::string& FilePath, size_t& NumEvents, std::vector<std::string>* Names, std::string& Error)
+{
+	FILE* fp = fopen(FilePath.c_str(), "rb");
+	if (fp == nullptr) {
+		Error = "can't open " + FilePath;
+		return false;
+	}
+	std::string Text;
+	char Buffer[4096];
+	for (size_t Read; (Read = fread(Buffer, 1, sizeof(Buffer), fp)) > 0;) {
+		Text.append(Buffer, Read);
+	}
+	fclose(fp);
+
+	JsonValue Root;
+	if (!JsonReader(Text).Parse(Root, Error)) {
+		return false;
+	}
+	const JsonValue* Events = (Root.Type == JsonValue::Object) ? Root.Find("traceEvents") : nullptr;
+	if (Events == nullptr || Events->Type != JsonValue::Array) {
+		Error = "no traceEvents array";
+		return false;
+	}
+
+	// Per thread intervals of the complete events which aren't enclosed by another one (yet)
+	std::map<double, std::vector<std::pair<double, double>>> Outer;
+	for (const JsonValue& Event : Events->Items) {
+		const JsonValue* Name = Event.Find("name");
+		const JsonValue* Category = Event.Find("cat");
+		const JsonValue* Phase = Event.Find("ph");
+		const JsonValue* Timestamp = Event.Find("ts");
+		const JsonValue* ThreadId = Event.Find("tid");
+		if (Name == nullptr || Name->Type != JsonValue::String || Category == nullptr || Category->Type != JsonValue::String
+			|| Phase == nullptr || (Phase->Str != "X" && Phase->Str != "i") || Timestamp == nullptr || Timestamp->Type != JsonValue::Number
+			|| ThreadId == nullptr || ThreadId->Type != JsonValue::Number || Event.Find("pid") == nullptr) {
+			Error = "malformed event #" + std::to_string(NumEvents);
+			return false;
+		}
+		if (Phase->Str == "X") {
+			const JsonValue* Duration = Event.Find("dur");
+			if (Duration == nullptr || Duration->Type != JsonValue::Number || Duration->Num < 0) {
+				Error = "complete event #" + std::to_string(NumEvents) + " has no duration";
+				return false;
+			}
+			// Events are recorded when they end, so an enclosing event follows the events it contains.
+			// Every earlier event which ends after this one started must lie within it (give or take the
+			// microsecond lost by rounding the start and the duration separately)
+			double Start = Timestamp->Num, End = Timestamp->Num + Duration->Num;
+			auto& Intervals = Outer[ThreadId->Num];
+			while (!Intervals.empty() && Intervals.back().second > Start) {
+				if (Intervals.back().first < Start || Intervals.back().second > End + 1) {
+					Error = "complete event #" + std::to_string(NumEvents) + " partially overlaps an earlier one";
+					return false;
+				}
+				Intervals.pop_back();
+			}
+			Intervals.emplace_back(Start, End);
+		}
+		if (Names != nullptr) {
+			Names->push_back(Name->Str);
+		}
+		NumEvents++;
+	}
+
+	return true;
+}
+
+// Records nested scopes from several threads, plus names which need escaping, and validates the written file
+static bool SelfTestTrace(const std::string& FilePath, std::string& Error)
+{
+	static const char* const EscapedName = "quote \" backslash \\ tab \t";
+	const int NumThreads = 4, NumScopes = 1000;
+
+	Trace_Init(FilePath, 60 * 1000);
+	{
+		TRACE_SCOPE("self test", "tool");
+
+		std::vector<std::thread> Threads;
+		for (int i = 0; i < NumThreads; i++) {
+			Threads.emplace_back([]() {
+				for (int j = 0; j < NumScopes; j++) {
+					TRACE_SCOPE("outer", "tool");
+					TRACE_SCOPE("inner", "tool");
+				}
+			});
+		}
+		for (auto& Thread : Threads) {
+			Thread.join();
+		}
+
+		TRACE_INSTANT("instant", "tool");
+		auto Now = std::chrono::steady_clock::now();
+		Trace_AddEvent(EscapedName, "tool", Now, Now);
+	}
+	Trace_Flush();
+
+	size_t NumEvents = 0;
+	std::vector<std::string> Names;
+	if (!ValidateTrace(FilePath, NumEvents, &Names, Error)) {
+		return false;
+	}
+
+	size_t Expected = NumThreads * NumScopes * 2 + 3;
+	if (NumEvents != Expected) {
+		Error = "expected " + std::to_string(Expected) + " events, found " + std::to_string(NumEvents);
+		return false;
+	}
+	if (std::find(Names.begin(), Names.end(), EscapedName) == Names.end()) {
+		Error = "escaped event name didn't survive the round trip";
+		return false;
+	}
+
+	return true;
+}
+
+// Validates a trace written by the emulator, or without arguments runs the tracer itself and validates its output
+int ToolTrace(int argc, char** argv)
+{
+	std::string Error;
+	if (argc > 0) {
+		size_t NumEvents = 0;
+		if (!ValidateTrace(argv[0], NumEvents, nullptr, Error)) {
+			fprintf(stderr, "%s: %s\n", argv[0], Error.c_str());
+			return 1;
+		}
+		printf("%s: %zu valid events\n", argv[0], NumEvents);
+		return 0;
+	}
+
+	std::string FilePath = (std::filesystem::temp_directory_path() / "cxbxr-tool-trace.json").string();
+	bool Passed = SelfTestTrace(FilePath, Error);
+	std::filesystem::remove(FilePath);
+	if (!Passed) {
+		fprintf(stderr, "Tracer self test failed: %s\n", Error.c_str());
+		return 1;
+	}
+	printf("Tracer self test passed\n");
+	return 0;
+}
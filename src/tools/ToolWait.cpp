@@ -0,0 +1,546 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+#include "core/kernel/support/DispatcherWaitTable.h"
+#include "core/kernel/support/DpcStack.h"
+#include "Tools.h"
+
+#define WAIT_TEST_CONSUMERS        8
+#define WAIT_TEST_PRODUCERS        4
+#define WAIT_TEST_ITEMS            200000    // Per producer
+#define WAIT_TEST_ROUND_TRIPS      20000
+#define WAIT_TEST_IDLE_THREADS     16
+#define WAIT_TEST_IDLE_MS          1000
+#define WAIT_TEST_WATCHDOG_SECONDS 30
+
+#define DPC_TEST_PRODUCERS         4
+#define DPC_TEST_INSERTIONS        500000    // Per producer
+#define DPC_TEST_POOL              64        // Dpc's shared by the producers
+
+// Process time spent on the cpu, by all threads together
+static double ProcessCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME Creation, Exit, Kernel, User;
+	GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User);
+	auto Seconds = [](const FILETIME& Time) { return ((uint64_t(Time.dwHighDateTime) << 32) | Time.dwLowDateTime) / 1e7; };
+	return Seconds(Kernel) + Seconds(User);
+#else
+	rusage Usage;
+	getrusage(RUSAGE_SELF, &Usage);
+	return Usage.ru_utime.tv_sec + Usage.ru_utime.tv_usec / 1e6 + Usage.ru_stime.tv_sec + Usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+// A lost wake leaves threads parked forever, and a dpc pushed twice loops the drain, so the threaded tests
+// run under a watchdog that ends the process
+class Watchdog
+{
+public:
+	explicit Watchdog(const char* Test) : m_Test(Test), m_Thread([this] { Run(); }) {}
+
+	~Watchdog()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mtx);
+			m_Done = true;
+		}
+		m_Cv.notify_one();
+		m_Thread.join();
+	}
+
+private:
+	void Run()
+	{
+		std::unique_lock<std::mutex> lock(m_Mtx);
+		if (!m_Cv.wait_for(lock, std::chrono::seconds(WAIT_TEST_WATCHDOG_SECONDS), [this] { return m_Done; })) {
+			printf("%s: no progress after %d seconds FAILED\n", m_Test, WAIT_TEST_WATCHDOG_SECONDS);
+			fflush(stdout);
+			std::_Exit(1);
+		}
+	}
+
+	const char* m_Test;
+	std::mutex m_Mtx;
+	std::condition_variable m_Cv;
+	bool m_Done = false;
+	std::thread m_Thread;
+};
+
+// The single threaded checks of the wake rules
+static int WakeRules()
+{
+	int failures = 0;
+	DispatcherWaitTable Table;
+	int Objects[3];
+	void* Object = &Objects[0];
+	void* Other = &Objects[1];
+	void* Timer = &Objects[2];
+
+	// A signal between the registration and the park isn't lost
+	DispatcherWaitTable::Waiter Early;
+	Table.Register(Early, 1, &Object, 1, Timer, false);
+	bool passed = (Table.Wake(Object) == 1) && Early.Woken;
+	Table.Park(Early);
+	passed = passed && !Early.Woken && (Table.Wake(Timer) == 1);
+	Table.Park(Early);
+	Table.Unregister(Early);
+	failures += passed ? 0 : 1;
+	printf("Signal before park %s\n", passed ? "passed" : "FAILED");
+
+	// A pulse passes over waits for all objects, and readies the first wait for any object
+	DispatcherWaitTable::Waiter All, Any, Later;
+	void* Pair[] = { Object, Other };
+	Table.Register(All, 2, Pair, 2, nullptr, true);
+	Table.Register(Any, 3, Pair, 2, nullptr, false);
+	passed = (Table.Pulse(Object, false) == 1) && !All.Woken && Any.Woken && (All.PulsedObject == nullptr) && (Any.PulsedObject == Object);
+	failures += passed ? 0 : 1;
+	printf("Pulse skips wait all waiters %s\n", passed ? "passed" : "FAILED");
+
+	// A waiter holding a pulse it hasn't consumed doesn't take another one, which goes to the next waiter
+	Table.Register(Later, 4, &Object, 1, nullptr, false);
+	passed = (Table.Pulse(Object, false) == 1) && Later.Woken && (Later.PulsedObject == Object) && (Table.Pulse(Object, true) == 0);
+	passed = passed && (Table.TakePulse(Any) == Object) && (Table.TakePulse(Any) == nullptr) && (Table.Pulse(Object, true) == 1);
+	failures += passed ? 0 : 1;
+	printf("Pulse goes to a waiter without one %s\n", passed ? "passed" : "FAILED");
+
+	// A wake of the object itself reaches every waiter, wait all included
+	All.Woken = Any.Woken = Later.Woken = false;
+	passed = (Table.Wake(Object) == 3) && All.Woken && Any.Woken && Later.Woken && (Table.Wake(Other) == 2);
+	failures += passed ? 0 : 1;
+	printf("Wake reaches all waiters %s\n", passed ? "passed" : "FAILED");
+
+	// Threads waiting on nothing but an alert or an apc are woken by their thread id
+	DispatcherWaitTable::Waiter Alertable;
+	Table.Register(Alertable, 5, nullptr, 0, nullptr, false);
+	passed = Table.WakeThread(5) && Alertable.Woken && !Table.WakeThread(6);
+	Table.Park(Alertable);
+	failures += passed ? 0 : 1;
+	printf("Wake by thread id %s\n", passed ? "passed" : "FAILED");
+
+	// Unregistered waiters are out of reach, and registering again replaces the previous objects
+	Table.Unregister(Alertable);
+	Table.Unregister(All);
+	Table.Unregister(Later);
+	Table.Register(Any, 3, &Other, 1, nullptr, false);
+	passed = !Table.WakeThread(5) && !Table.WakeThread(2) && (Table.Wake(Object) == 0) && (Table.Wake(Other) == 1);
+	Table.Unregister(Any);
+	passed = passed && (Table.Wake(Other) == 0) && !Table.WakeThread(3);
+	failures += passed ? 0 : 1;
+	printf("Unregister %s\n", passed ? "passed" : "FAILED");
+
+	return failures;
+}
+
+// Producers release items into a counter, like a semaphore, and consumers wait for them the way the
+// kernel waits do : register, re-check the signal state, and only then park
+static int Stress()
+{
+	DispatcherWaitTable Table;
+	std::atomic<int64_t> Available(0);
+	std::atomic<int64_t> Consumed(0);
+	std::atomic<bool> Stop(false);
+	void* Object = &Available;
+	const int64_t Total = (int64_t)WAIT_TEST_PRODUCERS * WAIT_TEST_ITEMS;
+	std::atomic<uint64_t> Parks(0);
+
+	auto TryTake = [&Available]() {
+		int64_t Count = Available.load();
+		while (Count > 0) {
+			if (Available.compare_exchange_weak(Count, Count - 1)) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	Watchdog Guard("Multi-producer stress");
+	auto Start = std::chrono::steady_clock::now();
+	std::vector<std::thread> Threads;
+	for (unsigned c = 0; c < WAIT_TEST_CONSUMERS; c++) {
+		Threads.emplace_back([&, c]() {
+			DispatcherWaitTable::Waiter Self;
+			while (true) {
+				if (TryTake()) {
+					Consumed++;
+					continue;
+				}
+				if (Stop) {
+					break;
+				}
+				Table.Register(Self, 100 + c, &Object, 1, nullptr, false);
+				if ((Available.load() > 0) || Stop) {
+					Table.Unregister(Self);
+					continue;
+				}
+				Table.Park(Self);
+				Parks++;
+			}
+			Table.Unregister(Self);
+		});
+	}
+
+	std::vector<std::thread> Producers;
+	for (unsigned p = 0; p < WAIT_TEST_PRODUCERS; p++) {
+		Producers.emplace_back([&]() {
+			for (unsigned i = 0; i < WAIT_TEST_ITEMS; i++) {
+				Available++;
+				Table.Wake(Object);
+			}
+		});
+	}
+	for (auto& Producer : Producers) {
+		Producer.join();
+	}
+
+	// Consumers only stop once everything is taken, so the last wake is the one that lets them out
+	while (Consumed.load() < Total) {
+		std::this_thread::yield();
+	}
+	Stop = true;
+	Table.Wake(Object);
+	for (auto& Consumer : Threads) {
+		Consumer.join();
+	}
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	bool passed = (Consumed.load() == Total) && (Available.load() == 0);
+	printf("Multi-producer stress: %d producers, %d consumers, %lld items, %llu parks in %.2f s %s\n",
+		WAIT_TEST_PRODUCERS, WAIT_TEST_CONSUMERS, (long long)Consumed.load(), (unsigned long long)Parks.load(), Seconds, passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+// Two threads hand a token back and forth, each parking until the other signals its object
+static int WakeLatency()
+{
+	DispatcherWaitTable Table;
+	std::atomic<uint32_t> Turn(0);
+	int Objects[2];
+	void* Ping = &Objects[0];
+	void* Pong = &Objects[1];
+
+	auto Player = [&](uint32_t ThreadId, uint32_t Mine, void* Wait, void* Signal) {
+		DispatcherWaitTable::Waiter Self;
+		for (uint32_t Round = 0; Round < WAIT_TEST_ROUND_TRIPS; Round++) {
+			while (true) {
+				Table.Register(Self, ThreadId, &Wait, 1, nullptr, false);
+				if ((Turn.load() & 1) == Mine) {
+					break;
+				}
+				Table.Park(Self);
+			}
+			Table.Unregister(Self);
+			Turn++;
+			Table.Wake(Signal);
+		}
+	};
+
+	Watchdog Guard("Wake latency");
+	auto Start = std::chrono::steady_clock::now();
+	std::thread Other(Player, 201, 1, Pong, Ping);
+	Player(200, 0, Ping, Pong);
+	Other.join();
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	bool passed = (Turn.load() == 2 * WAIT_TEST_ROUND_TRIPS);
+	printf("Wake latency: %.2f us per wake over %d round trips %s\n", Seconds * 1e6 / (2.0 * WAIT_TEST_ROUND_TRIPS), WAIT_TEST_ROUND_TRIPS, passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+// Parked threads must not burn any cpu while nothing is signalled
+static int IdleCpu()
+{
+	DispatcherWaitTable Table;
+	std::atomic<bool> Signalled(false);
+	std::atomic<unsigned> Parked(0);
+	void* Object = &Signalled;
+
+	Watchdog Guard("Idle cpu");
+	std::vector<std::thread> Threads;
+	for (unsigned t = 0; t < WAIT_TEST_IDLE_THREADS; t++) {
+		Threads.emplace_back([&, t]() {
+			DispatcherWaitTable::Waiter Self;
+			bool Counted = false;
+			while (true) {
+				Table.Register(Self, 300 + t, &Object, 1, nullptr, false);
+				if (Signalled) {
+					break;
+				}
+				if (!Counted) {
+					Parked++;
+					Counted = true;
+				}
+				Table.Park(Self);
+			}
+			Table.Unregister(Self);
+		});
+	}
+	while (Parked.load() < WAIT_TEST_IDLE_THREADS) {
+		std::this_thread::yield();
+	}
+
+	double Cpu = ProcessCpuSeconds();
+	auto Start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TEST_IDLE_MS));
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	Cpu = ProcessCpuSeconds() - Cpu;
+
+	Signalled = true;
+	unsigned Woken = Table.Wake(Object);
+	for (auto& Thread : Threads) {
+		Thread.join();
+	}
+
+	// Anything above a percent of a core means somebody is polling
+	bool passed = (Cpu / Seconds < 0.01) && (Woken == WAIT_TEST_IDLE_THREADS);
+	printf("Idle cpu: %d parked threads used %.2f%% of a core, %u woken %s\n", WAIT_TEST_IDLE_THREADS, Cpu * 100 / Seconds, Woken, passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+int ToolWait(int argc, char** argv)
+{
+	int failures = WakeRules();
+	failures += Stress();
+	failures += WakeLatency();
+	failures += IdleCpu();
+	return failures;
+}
+
+struct TestDpc {
+	DpcState State;
+	DpcLink Link;
+	uint64_t Argument;
+	uint64_t Check;     // ~Argument, a torn copy of the arguments doesn't match
+	uint64_t Batch;     // The last drain that took it, a dpc pushed twice shows up twice in one drain
+
+	TestDpc() : State(DPC_NOT_INSERTED), Argument(0), Check(~0ull), Batch(0)
+	{
+		Link.Next = nullptr;
+		Link.Stamp = 0;
+	}
+};
+
+static TestDpc* TestDpcOf(DpcLink* Link)
+{
+	return reinterpret_cast<TestDpc*>(reinterpret_cast<char*>(Link) - offsetof(TestDpc, Link));
+}
+
+static uint64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The single threaded checks of the insertion rules
+static int DpcRules()
+{
+	int failures = 0;
+	DpcStack Stack;
+	TestDpc Dpcs[4];
+	Watchdog Guard("Dpc rules");
+
+	for (unsigned i = 0; i < 4; i++) {
+		DpcStack::Claim(Dpcs[i].State);
+		Stack.Push(Dpcs[i].State, Dpcs[i].Link, i * 2);
+	}
+	bool passed = !DpcStack::Claim(Dpcs[0].State);
+	printf("Dpc rules: an inserted dpc can't be claimed again %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	// A removed dpc that is inserted again before the drain stays where it was, and runs once
+	passed = DpcStack::Remove(Dpcs[1].State) && !DpcStack::Remove(Dpcs[1].State) && DpcStack::Claim(Dpcs[1].State);
+	Stack.Push(Dpcs[1].State, Dpcs[1].Link, 100);
+	passed = passed && DpcStack::Remove(Dpcs[2].State);
+	printf("Dpc rules: a dpc is only removed once, and can then be claimed %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	unsigned Order[4];
+	unsigned Count = 0;
+	bool Stamped = true;
+	unsigned Runs = 0;
+	DpcLink* Next;
+	for (DpcLink* Link = Stack.TakeAll(); Link != nullptr; Link = Next) {
+		Next = Link->Next;
+		TestDpc* Dpc = TestDpcOf(Link);
+		if (Count < 4) {
+			Order[Count] = (unsigned)(Dpc - Dpcs);
+		}
+		Count++;
+		Stamped = Stamped && ((DpcStack::Unlink(*Link) & 1) != 0);
+		Runs += DpcStack::Retire(Dpc->State);
+	}
+	passed = (Count == 4) && (Order[0] == 0) && (Order[1] == 1) && (Order[2] == 2) && (Order[3] == 3) && Stamped;
+	printf("Dpc rules: the drain takes each dpc once, in the order of insertion, with its stamp %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	passed = (Runs == 3) && (Stack.TakeAll() == nullptr) && (Dpcs[2].State == DPC_NOT_INSERTED);
+	printf("Dpc rules: a removed dpc doesn't run %s\n", passed ? "passed" : "FAILED");
+	failures += !passed;
+
+	return failures;
+}
+
+// Producers insert (and in the second run also remove) dpc's of a shared pool while a drainer runs them, like
+// ExecuteDpcQueue does. Every insertion must end up either run or removed, exactly once
+static int DpcStress(bool Removes)
+{
+	DpcStack Stack;
+	std::vector<TestDpc> Dpcs(DPC_TEST_POOL);
+	std::atomic<uint64_t> Inserted(0);
+	std::atomic<uint64_t> Removed(0);
+	std::atomic<bool> Go(false);
+	std::atomic<bool> Done(false);
+	uint64_t Runs = 0;
+	uint64_t Batches = 0;
+	uint64_t Duplicates = 0;
+	uint64_t Unstamped = 0;
+	uint64_t Torn = 0;
+	uint64_t OutOfOrder = 0;
+	uint64_t Latency = 0;
+
+	Watchdog Guard(Removes ? "Dpc stress with removes" : "Dpc stress");
+	auto Start = std::chrono::steady_clock::now();
+
+	std::thread Drainer([&]() {
+		uint64_t LastSequence[DPC_TEST_PRODUCERS] = {};
+		Go = true;
+		while (true) {
+			bool Last = Done.load();
+			DpcLink* Link = Stack.TakeAll();
+			if (Link == nullptr) {
+				if (Last) {
+					break;
+				}
+				std::this_thread::yield();
+				continue;
+			}
+
+			Batches++;
+			DpcLink* Next;
+			for (; Link != nullptr; Link = Next) {
+				Next = Link->Next;
+				TestDpc* Dpc = TestDpcOf(Link);
+				if (Dpc->Batch == Batches) {
+					Duplicates++;
+					break;
+				}
+				Dpc->Batch = Batches;
+
+				uintptr_t Stamp = DpcStack::Unlink(*Link);
+				uint64_t Argument = Dpc->Argument;
+				uint64_t Check = Dpc->Check;
+				if (!DpcStack::Retire(Dpc->State)) {
+					continue;
+				}
+
+				Runs++;
+				Unstamped += ((Stamp & 1) == 0);
+				Latency += NowNs() - (Stamp & ~(uintptr_t)1);
+				// With removes, a dpc can be removed and claimed again while its arguments are copied above, which the
+				// kernel doesn't guard against either, so the arguments and the order are only checked without them
+				if (!Removes) {
+					Torn += (Check != ~Argument);
+					unsigned Producer = (unsigned)(Argument >> 48);
+					uint64_t Sequence = Argument & 0xFFFFFFFFFFFFull;
+					if (Producer < DPC_TEST_PRODUCERS) {
+						OutOfOrder += (Sequence <= LastSequence[Producer]);
+						LastSequence[Producer] = Sequence;
+					}
+				}
+			}
+		}
+	});
+
+	std::vector<std::thread> Producers;
+	for (unsigned p = 0; p < DPC_TEST_PRODUCERS; p++) {
+		Producers.emplace_back([&, p]() {
+			uint32_t Random = 0x9E3779B9u * (p + 1);
+			uint64_t MyInserted = 0;
+			uint64_t MyRemoved = 0;
+			while (!Go) {
+				std::this_thread::yield();
+			}
+			// Tries random dpc's until one can be claimed, so the pool stays full and the claims contend
+			while (MyInserted < DPC_TEST_INSERTIONS) {
+				Random = Random * 1664525u + 1013904223u;
+				TestDpc& Dpc = Dpcs[(Random >> 8) % DPC_TEST_POOL];
+				if (Removes && ((Random >> 28) == 0)) {
+					MyRemoved += DpcStack::Remove(Dpc.State);
+					continue;
+				}
+				if (DpcStack::Claim(Dpc.State)) {
+					MyInserted++;
+					Dpc.Argument = ((uint64_t)p << 48) | MyInserted;
+					Dpc.Check = ~Dpc.Argument;
+					Stack.Push(Dpc.State, Dpc.Link, (uintptr_t)NowNs());
+				} else {
+					// Leave the cpu to the drainer when the pool is full
+					std::this_thread::yield();
+				}
+			}
+			Inserted += MyInserted;
+			Removed += MyRemoved;
+		});
+	}
+	for (auto& Producer : Producers) {
+		Producer.join();
+	}
+	Done = true;
+	Drainer.join();
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	unsigned Leftover = 0;
+	for (const TestDpc& Dpc : Dpcs) {
+		Leftover += (Dpc.State != DPC_NOT_INSERTED) || (Dpc.Link.Stamp != 0);
+	}
+
+	bool passed = (Inserted.load() == Runs + Removed.load()) && (Duplicates == 0) && (Unstamped == 0) && (Torn == 0) && (OutOfOrder == 0) && (Leftover == 0);
+	printf("%s: %d producers, %llu inserted, %llu removed, %llu run in %llu drains, %llu duplicated, %llu torn, %llu out of order, %u left %s\n",
+		Removes ? "Dpc stress with removes" : "Dpc stress", DPC_TEST_PRODUCERS, (unsigned long long)Inserted.load(), (unsigned long long)Removed.load(),
+		(unsigned long long)Runs, (unsigned long long)Batches, (unsigned long long)Duplicates, (unsigned long long)Torn, (unsigned long long)OutOfOrder,
+		Leftover, passed ? "passed" : "FAILED");
+	printf("%s: %.1f M insertions/s, %.1f us average latency\n", Removes ? "Dpc stress with removes" : "Dpc stress",
+		Inserted.load() / Seconds / 1e6, Runs ? Latency / 1e3 / Runs : 0.0);
+	return passed ? 0 : 1;
+}
+
+int ToolDpc(int argc, char** argv)
+{
+	int failures = DpcRules();
+	failures += DpcStress(false);
+	failures += DpcStress(true);
+	return failures;
+}
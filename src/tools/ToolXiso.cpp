@@ -0,0 +1,363 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "core/kernel/support/XisoIndex.h"
+#include "Tools.h"
+
+// Layout of the synthetic image : directories of files, each file filled with a pattern that identifies it
+#define XISO_TEST_DIRECTORIES   16
+#define XISO_TEST_FILE_SIZE     (24 * 1024)
+#define XISO_TEST_LOOKUPS       1000000
+#define XISO_TEST_READ_CHUNK    (64 * 1024)
+
+// Writes an XDVDFS volume into memory, with each directory table laid out as a balanced tree
+class XisoBuilder
+{
+public:
+	struct Node {
+		std::string Name;
+		uint32_t Size;                 // File size, ignored for directories
+		uint32_t FileId;               // Seeds the file contents
+		std::vector<Node> Children;
+		bool Directory;
+	};
+
+	XisoBuilder()
+	{
+		// The volume descriptor lives in sector 32, everything before it is unused
+		m_Image.resize((32 + 1) * XISO_SECTOR_SIZE, 0);
+	}
+
+	static uint8_t Pattern(uint32_t FileId, uint64_t Position)
+	{
+		return (uint8_t)(FileId * 31 + (Position * 7) + (Position >> 11));
+	}
+
+	// Writes the whole tree, and returns the image
+	std::vector<uint8_t>& Build(std::vector<Node>& Root)
+	{
+		uint32_t Size;
+		uint32_t Sector = WriteDirectory(Root, Size);
+
+		uint8_t* Descriptor = &m_Image[32 * XISO_SECTOR_SIZE];
+		memcpy(Descriptor, "MICROSOFT*XBOX*MEDIA", 20);
+		memcpy(Descriptor + 20, &Sector, 4);
+		memcpy(Descriptor + 24, &Size, 4);
+		memcpy(Descriptor + XISO_SECTOR_SIZE - 24, "MICROSOFT*XBOX*MEDIA", 20);
+		return m_Image;
+	}
+
+	// Writes a dirent by hand, for the damaged images
+	static void WriteDirent(uint8_t* Dirent, uint16_t Left, uint16_t Right, uint32_t Sector, uint32_t Size, uint8_t Attributes, const std::string& Name)
+	{
+		memcpy(Dirent + 0, &Left, 2);
+		memcpy(Dirent + 2, &Right, 2);
+		memcpy(Dirent + 4, &Sector, 4);
+		memcpy(Dirent + 8, &Size, 4);
+		Dirent[12] = Attributes;
+		Dirent[13] = (uint8_t)Name.length();
+		memcpy(Dirent + 14, Name.data(), Name.length());
+	}
+
+	static uint32_t DirentSize(const std::string& Name)
+	{
+		return (14 + (uint32_t)Name.length() + 3) & ~3u;
+	}
+
+private:
+	uint32_t Allocate(uint32_t Bytes, uint8_t Fill)
+	{
+		uint32_t Sector = (uint32_t)(m_Image.size() / XISO_SECTOR_SIZE);
+		uint32_t Sectors = (Bytes + XISO_SECTOR_SIZE - 1) / XISO_SECTOR_SIZE;
+		m_Image.resize(m_Image.size() + (size_t)Sectors * XISO_SECTOR_SIZE, Fill);
+		return Sector;
+	}
+
+	uint32_t WriteDirectory(std::vector<Node>& Entries, uint32_t& Size)
+	{
+		// Children first, so that their location is known when the table gets written
+		std::vector<uint32_t> Sectors(Entries.size()), Sizes(Entries.size());
+		for (size_t i = 0; i < Entries.size(); i++) {
+			if (Entries[i].Directory) {
+				Sectors[i] = WriteDirectory(Entries[i].Children, Sizes[i]);
+			}
+			else {
+				Sizes[i] = Entries[i].Size;
+				Sectors[i] = Allocate(Sizes[i], 0);
+				uint8_t* Data = &m_Image[(size_t)Sectors[i] * XISO_SECTOR_SIZE];
+				for (uint32_t p = 0; p < Sizes[i]; p++) {
+					Data[p] = Pattern(Entries[i].FileId, p);
+				}
+			}
+		}
+
+		if (Entries.empty()) {
+			Size = 0;
+			return 0;
+		}
+
+		std::vector<uint32_t> Order(Entries.size());
+		for (uint32_t i = 0; i < Order.size(); i++) {
+			Order[i] = i;
+		}
+		std::sort(Order.begin(), Order.end(), [&Entries](uint32_t a, uint32_t b) { return Entries[a].Name < Entries[b].Name; });
+
+		std::vector<uint8_t> Table;
+		WriteTree(Table, Entries, Order, Sectors, Sizes, 0, (int)Order.size() - 1);
+		Size = (uint32_t)((Table.size() + XISO_SECTOR_SIZE - 1) & ~(size_t)(XISO_SECTOR_SIZE - 1));
+		uint32_t Sector = Allocate(Size, 0xFF);
+		memcpy(&m_Image[(size_t)Sector * XISO_SECTOR_SIZE], Table.data(), Table.size());
+		return Sector;
+	}
+
+	// Writes the middle entry, then both halves as its subtrees. Returns the offset of the written dirent
+	uint32_t WriteTree(std::vector<uint8_t>& Table, const std::vector<Node>& Entries, const std::vector<uint32_t>& Order,
+		const std::vector<uint32_t>& Sectors, const std::vector<uint32_t>& Sizes, int Low, int High)
+	{
+		int Mid = (Low + High) / 2;
+		const Node& Entry = Entries[Order[Mid]];
+		uint32_t Offset = (uint32_t)Table.size();
+		Table.resize(Offset + DirentSize(Entry.Name), 0xFF);
+
+		uint16_t Left = (Low < Mid) ? (uint16_t)(WriteTree(Table, Entries, Order, Sectors, Sizes, Low, Mid - 1) / 4) : 0;
+		uint16_t Right = (Mid < High) ? (uint16_t)(WriteTree(Table, Entries, Order, Sectors, Sizes, Mid + 1, High) / 4) : 0;
+		WriteDirent(&Table[Offset], Left, Right, Sectors[Order[Mid]], Sizes[Order[Mid]], Entry.Directory ? XISO_ATTRIBUTE_DIRECTORY : 0x80, Entry.Name);
+		return Offset;
+	}
+
+	std::vector<uint8_t> m_Image;
+};
+
+static XisoIndex::ReadCallback MemoryReader(const std::vector<uint8_t>& Image)
+{
+	return [&Image](uint64_t Offset, void* Buffer, uint32_t Length) {
+		if (Offset + Length > Image.size()) {
+			return false;
+		}
+		memcpy(Buffer, &Image[Offset], Length);
+		return true;
+	};
+}
+
+static bool MountImage(const std::vector<uint8_t>& Image)
+{
+	XisoIndex Index;
+	return Index.Locate(MemoryReader(Image)) && Index.Build(MemoryReader(Image));
+}
+
+// Images whose directory tables point back into each other, or nest without end, must fail to mount
+static int DamagedImages()
+{
+	int failures = 0;
+
+	// A subdirectory whose table is the root table
+	std::vector<XisoBuilder::Node> Root = { { "loop", 0, 0, { { "file", 16, 1, {}, false } }, true } };
+	std::vector<uint8_t> Image = XisoBuilder().Build(Root);
+	uint32_t RootSector, RootSize;
+	memcpy(&RootSector, &Image[32 * XISO_SECTOR_SIZE + 20], 4);
+	memcpy(&RootSize, &Image[32 * XISO_SECTOR_SIZE + 24], 4);
+	XisoBuilder::WriteDirent(&Image[(size_t)RootSector * XISO_SECTOR_SIZE], 0, 0, RootSector, RootSize, XISO_ATTRIBUTE_DIRECTORY, "loop");
+	bool passed = !MountImage(Image);
+	failures += passed ? 0 : 1;
+	printf("Directory containing itself rejected %s\n", passed ? "passed" : "FAILED");
+
+	// Two directories containing each other
+	Root = { { "a", 0, 0, { { "b", 0, 0, { { "file", 16, 1, {}, false } }, true } }, true } };
+	Image = XisoBuilder().Build(Root);
+	memcpy(&RootSector, &Image[32 * XISO_SECTOR_SIZE + 20], 4);
+	uint32_t ASector, ASize;
+	memcpy(&ASector, &Image[(size_t)RootSector * XISO_SECTOR_SIZE + 4], 4);
+	memcpy(&ASize, &Image[(size_t)RootSector * XISO_SECTOR_SIZE + 8], 4);
+	uint32_t BSector;
+	memcpy(&BSector, &Image[(size_t)ASector * XISO_SECTOR_SIZE + 4], 4);
+	XisoBuilder::WriteDirent(&Image[(size_t)BSector * XISO_SECTOR_SIZE], 0, 0, ASector, ASize, XISO_ATTRIBUTE_DIRECTORY, "a");
+	passed = !MountImage(Image);
+	failures += passed ? 0 : 1;
+	printf("Directories containing each other rejected %s\n", passed ? "passed" : "FAILED");
+
+	// A dirent whose subtree is itself
+	Root = { { "file", 16, 1, {}, false } };
+	Image = XisoBuilder().Build(Root);
+	memcpy(&RootSector, &Image[32 * XISO_SECTOR_SIZE + 20], 4);
+	uint16_t Next = XisoBuilder::DirentSize("file") / 4;
+	memcpy(&Image[(size_t)RootSector * XISO_SECTOR_SIZE + 2], &Next, 2);
+	XisoBuilder::WriteDirent(&Image[(size_t)RootSector * XISO_SECTOR_SIZE + Next * 4], Next, 0, 0, 0, 0x80, "next");
+	passed = !MountImage(Image);
+	failures += passed ? 0 : 1;
+	printf("Dirent tree loop rejected %s\n", passed ? "passed" : "FAILED");
+
+	// Distinct directories nested far deeper than any disc, which would otherwise exhaust the stack
+	for (unsigned Depth : { 32u, 1000u }) {
+		XisoBuilder::Node Leaf = { "file", 16, 1, {}, false };
+		std::vector<XisoBuilder::Node> Chain = { Leaf };
+		for (unsigned d = 0; d < Depth; d++) {
+			Chain = { { "d", 0, 0, std::move(Chain), true } };
+		}
+		Image = XisoBuilder().Build(Chain);
+		passed = MountImage(Image) == (Depth < 64);
+		failures += passed ? 0 : 1;
+		printf("Directories nested %u deep %s %s\n", Depth, (Depth < 64) ? "mounted" : "rejected", passed ? "passed" : "FAILED");
+	}
+
+	return failures;
+}
+
+int ToolXiso(int argc, char** argv)
+{
+	uint32_t Files = (argc > 0) ? strtoul(argv[0], nullptr, 0) : 4096;
+	if (Files == 0) {
+		fprintf(stderr, "Invalid file count: %s\n", argv[0]);
+		return 1;
+	}
+
+	// Build the synthetic image, with file sizes spread around the average
+	std::mt19937 Random(1234);
+	std::vector<XisoBuilder::Node> Root;
+	std::vector<std::string> Paths;
+	std::vector<uint32_t> PathFiles;
+	uint64_t DataBytes = 0;
+	for (uint32_t d = 0; d < XISO_TEST_DIRECTORIES; d++) {
+		Root.push_back({ "Dir" + std::to_string(d), 0, 0, {}, true });
+	}
+	for (uint32_t f = 0; f < Files; f++) {
+		XisoBuilder::Node File = { "File" + std::to_string(f) + ".bin", (uint32_t)(Random() % (2 * XISO_TEST_FILE_SIZE)), f, {}, false };
+		XisoBuilder::Node& Directory = Root[f % XISO_TEST_DIRECTORIES];
+		Paths.push_back(Directory.Name + "\\" + File.Name);
+		PathFiles.push_back(f);
+		DataBytes += File.Size;
+		Directory.Children.push_back(std::move(File));
+	}
+	std::vector<uint8_t> Image = XisoBuilder().Build(Root);
+
+	const std::string ImagePath = (std::filesystem::temp_directory_path() / "cxbxr-tool-xiso.iso").string();
+	{
+		std::ofstream Out(ImagePath, std::ios::binary);
+		Out.write((const char*)Image.data(), Image.size());
+	}
+	Image.clear();
+	Image.shrink_to_fit();
+
+	std::ifstream In(ImagePath, std::ios::binary);
+	XisoIndex::ReadCallback Read = [&In](uint64_t Offset, void* Buffer, uint32_t Length) {
+		In.clear();
+		In.seekg((std::streamoff)Offset);
+		In.read((char*)Buffer, Length);
+		return In.gcount() == (std::streamsize)Length;
+	};
+
+	printf("Image: %u files in %u directories, %.1f MB\n", Files, XISO_TEST_DIRECTORIES, DataBytes / 1e6);
+	int failures = 0;
+
+	XisoIndex Index;
+	auto Start = std::chrono::steady_clock::now();
+	bool passed = Index.Locate(Read) && Index.Build(Read);
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	passed = passed && (Index.GetEntryCount() == 1 + XISO_TEST_DIRECTORIES + Files);
+	failures += passed ? 0 : 1;
+	printf("Mount: %zu entries in %.2f ms %s\n", Index.GetEntryCount(), Seconds * 1e3, passed ? "passed" : "FAILED");
+
+	// Every directory lists its children once, in case insensitive order
+	unsigned Listed = 0;
+	passed = true;
+	for (const auto& Directory : Root) {
+		const std::vector<std::string>* Children = Index.Children(Directory.Name);
+		if (Children == nullptr) {
+			passed = false;
+			continue;
+		}
+		Listed += (unsigned)Children->size();
+		for (size_t i = 1; i < Children->size(); i++) {
+			std::string a = XisoIndex::NormalizePath((*Children)[i - 1]), b = XisoIndex::NormalizePath((*Children)[i]);
+			passed = passed && (a < b);
+		}
+	}
+	passed = passed && (Listed == Files) && (Index.Children("")->size() == XISO_TEST_DIRECTORIES);
+	failures += passed ? 0 : 1;
+	printf("Directory listings: %u entries, sorted %s\n", Listed, passed ? "passed" : "FAILED");
+
+	// Random lookups, in mixed case and with forward slashes now and then
+	std::vector<std::string> Queries;
+	for (size_t i = 0; i < Paths.size(); i++) {
+		std::string Query = Paths[i];
+		if (i % 3 == 1) {
+			std::transform(Query.begin(), Query.end(), Query.begin(), [](unsigned char c) { return (char)toupper(c); });
+		}
+		if (i % 3 == 2) {
+			std::replace(Query.begin(), Query.end(), '\\', '/');
+		}
+		Queries.push_back(Query);
+	}
+	std::uniform_int_distribution<size_t> Pick(0, Queries.size() - 1);
+	std::vector<uint32_t> Picks(XISO_TEST_LOOKUPS);
+	for (auto& p : Picks) {
+		p = (uint32_t)Pick(Random);
+	}
+	unsigned Found = 0;
+	Start = std::chrono::steady_clock::now();
+	for (uint32_t p : Picks) {
+		Found += (Index.Lookup(Queries[p]) != nullptr) ? 1 : 0;
+	}
+	Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	passed = (Found == XISO_TEST_LOOKUPS) && (Index.Lookup("Dir0\\Missing.bin") == nullptr);
+	failures += passed ? 0 : 1;
+	printf("Lookups: %u found, %.0f ns per lookup %s\n", Found, Seconds * 1e9 / XISO_TEST_LOOKUPS, passed ? "passed" : "FAILED");
+
+	// Sequential reads of every file, checking their contents
+	std::vector<uint8_t> Buffer(XISO_TEST_READ_CHUNK);
+	uint64_t BytesRead = 0;
+	unsigned BadFiles = 0;
+	Start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < Paths.size(); i++) {
+		const XisoEntry* Entry = Index.Lookup(Paths[i]);
+		bool Good = (Entry != nullptr) && !Entry->IsDirectory();
+		for (uint64_t Position = 0; Good && Position < Entry->Size; Position += Buffer.size()) {
+			uint32_t Length = (uint32_t)std::min<uint64_t>(Buffer.size(), Entry->Size - Position);
+			Good = Read(Entry->Offset + Position, Buffer.data(), Length);
+			for (uint32_t b = 0; Good && b < Length; b++) {
+				Good = (Buffer[b] == XisoBuilder::Pattern(PathFiles[i], Position + b));
+			}
+			BytesRead += Length;
+		}
+		BadFiles += Good ? 0 : 1;
+	}
+	Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	passed = (BadFiles == 0) && (BytesRead == DataBytes);
+	failures += passed ? 0 : 1;
+	printf("Sequential reads: %.1f MB at %.0f MB/s, %u bad files %s\n", BytesRead / 1e6, BytesRead / 1e6 / Seconds, BadFiles, passed ? "passed" : "FAILED");
+
+	In.close();
+	std::filesystem::remove(ImagePath);
+
+	failures += DamagedImages();
+	return failures;
+}
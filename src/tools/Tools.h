@@ -0,0 +1,44 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+// Commands of cxbxr-tool, an offline companion of the emulator which only
+// builds portable sources, so that it also runs on hosts other than Windows.
+// Each command receives the arguments following its name, and returns the exit code.
+
+int ToolSha(int argc, char** argv);
+int ToolTrace(int argc, char** argv);
+int ToolRenderApu(int argc, char** argv);
+int ToolAdpcm(int argc, char** argv);
+int ToolMix(int argc, char** argv);
+int ToolReplayDSound(int argc, char** argv);
+int ToolConverter(int argc, char** argv);
+int ToolDecodeLog(int argc, char** argv);
+int ToolLogGovernor(int argc, char** argv);
+int ToolXiso(int argc, char** argv);
+int ToolWait(int argc, char** argv);
+int ToolDpc(int argc, char** argv);
+int ToolFreeAreas(int argc, char** argv);
+int ToolPageBitmap(int argc, char** argv);
+int ToolObjectNames(int argc, char** argv);
+int ToolClockScale(int argc, char** argv);
@@ -0,0 +1,78 @@
+// ******************************************************************
+// *
+// *  This file is part of Cxbx-Reloaded.
+// *
+// *  Cxbx-Reloaded is free software; you can redistribute it
+// *  and/or modify it under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+// cxbxr-tool.cpp : Defines the entry point of the offline tool.
+
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include "Tools.h"
+
+static const struct {
+	const char* Name;
+	const char* Usage;
+	int(*Run)(int argc, char** argv);
+} ToolCommands[] = {
+	{ "sha", "sha [megabytes]\n\tVerify every SHA-1 core against the test vectors and measure its throughput", ToolSha },
+	{ "trace", "trace [StartupTrace.json]\n\tValidate a startup trace, or without a file run the tracer and validate its output", ToolTrace },
+	{ "render-apu", "render-apu [APUVoices.bin out.wav [seconds]]\n\tRender an APU voice dump (F3 in the emulator) to a wav and report the voices per frame,\n\tor without a dump run the voice processor self test of streams, PCM and ADPCM formats, pitch, envelope\n\tand mixbin volumes", ToolRenderApu },
+	{ "adpcm", "adpcm [blocks [seed]]\n\tDecode random Xbox ADPCM blocks of 1 to 6 channels through every decoder entry point, compare\n\tthem bit for bit with the streaming decoder they replaced, and measure their throughput", ToolAdpcm },
+	{ "mix", "mix [voices [seconds [out.wav]]]\n\tRender looping voices of every format through the DirectSound software mixer and report the voices\n\tmixed per second of cpu time", ToolMix },
+	{ "replay-dsound", "replay-dsound [DSoundTrace.bin [out.wav]]\n\tReplay a DirectSound trace (CaptureTrace=true in [audio]) on the software mixer as fast as possible and report\n\tthe mix time per frame, or without a trace replay a synthetic one and check it", ToolReplayDSound },
+	{ "converter", "converter\n\tCheck the audio pitch, frequency and volume conversions against long double math, every table entry,\n\tfrequency up to 4 MHz, pitch and volume, and time them against the float math they replaced", ToolConverter },
+	{ "decode-log", "decode-log [EmuLog.bin [-t]]\n\tRender a binary log as text, optionally with timestamps, or without a file\n\tmeasure the logging throughput and check the decoded output", ToolDecodeLog },
+	{ "log-governor", "log-governor\n\tCheck the first N / every M sampling of log sites, the token bucket of the rate limit and the repeat\n\treports of deduplication, and measure the cost of a suppressed message for each of them", ToolLogGovernor },
+	{ "xiso", "xiso [files]\n\tBuild a synthetic XISO image and measure its mount time, random lookups and sequential reads,\n\tthen check that damaged directory tables are rejected", ToolXiso },
+	{ "wait", "wait\n\tCheck the wake rules of the dispatcher wait table, stress it with several producers,\n\tand measure the wake latency and the cpu used by parked threads", ToolWait },
+	{ "dpc", "dpc\n\tCheck the insertion rules of the pending dpc stack, and stress it with several producers inserting\n\tand removing dpc's while one thread drains it", ToolDpc },
+	{ "free-areas", "free-areas [operations [seed]]\n\tRun random inserts, erases, resizes and searches on the free area index of the memory manager\n\tand compare every result with a linear search", ToolFreeAreas },
+	{ "page-bitmap", "page-bitmap [operations [seed]]\n\tRun random frees, uses and run searches on the physical page bitmap and compare every result\n\twith a plain bitmap searched page by page", ToolPageBitmap },
+	{ "object-names", "object-names [operations [seed]]\n\tRun random inserts, removes and lookups on the object name index, with colliding hashes, and compare\n\tevery result with a map, then check the path cache and its flushing", ToolObjectNames },
+	{ "clock-scale", "clock-scale\n\tCheck the clock conversions against exact 128 bit math, including the 32 bit partial product\n\tfallback, and measure the cost of a conversion", ToolClockScale },
+};
+
+static int PrintUsage()
+{
+	printf("Usage: cxbxr-tool <command> [arguments]\n\n");
+	for (const auto& command : ToolCommands) {
+		printf("%s\n", command.Usage);
+	}
+
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		return PrintUsage();
+	}
+
+	for (const auto& command : ToolCommands) {
+		if (strcmp(argv[1], command.Name) == 0) {
+			return command.Run(argc - 2, argv + 2);
+		}
+	}
+
+	fprintf(stderr, "Unknown command: %s\n\n", argv[1]);
+	return PrintUsage();
+}